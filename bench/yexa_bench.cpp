@@ -0,0 +1,605 @@
+/*! \file    yexa_bench.cpp
+ *  \brief   Benchmarks of the editor's core data structures.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * This program times the operations the editor leans on most: editing an EditBuffer, moving
+ * around a List or an EditList, reading and writing files, searching, reformatting paragraphs
+ * and looking up command words. The text worked on is generated from a fixed seed so every run
+ * does the same work and runs on different builds or machines can be compared.
+ *
+ * Each benchmark is run with a growing number of operations until it takes at least the
+ * minimum time, and the time of each operation is reported. The program is used as follows.
+ *
+ *     yexa_bench [-t seconds] [-s megabytes,...] [name...]
+ *
+ * The -t option sets the minimum time of each benchmark (half a second by default). The -s
+ * option lists the sizes of the files read, written and searched (1 and 16 MB by default; 1024
+ * MB times a gigabyte file). Only the benchmarks whose names contain one of the given names
+ * are run. The screen is not used, so the program can be run from scripts.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "EditFile.hpp"
+#include "MappedFile.hpp"
+#include "Timer.hpp"
+#include "command_table.hpp"
+#include "mylist.hpp"
+#include "Utf8.hpp"
+#include "special.hpp"
+
+#define SEED 20240601UL                      // Seeds the generated text.
+#define TEMPORARY_NAME "yexa_bench.tmp"      // The file read and written by the benchmarks.
+#define LIST_SIZE 10000L                     // Items in the Lists that are jumped around.
+#define EDIT_LIST_SIZE 1000000L              // Items in the EditLists.
+#define REFLOW_LINES 2000                    // Lines in the paragraphs that are reformatted.
+#define MAXIMUM_OPERATIONS 1000000000L       // The most operations run in one benchmark.
+#define KEYSTROKE_BATCH 1024L                // Keystrokes typed between clearing the undo log.
+
+namespace {
+
+    //! Runs count operations and returns the nanoseconds they took.
+    using Body = std::function<long long(long count)>;
+
+    //! A benchmark with the name by which it is selected and reported.
+    struct Benchmark {
+        std::string name;
+        Body body;
+        long long bytes; //!< Bytes handled by each operation (zero if that means nothing).
+    };
+
+    double minimum_seconds = 0.5;
+    volatile long sink = 0; // Results are stored here so that the work isn't optimized away.
+
+    //! A file that can be filled without a document being loaded through the screen.
+    /*!
+     * DiskEditFile::load and save show their progress on the screen. The benchmarks use the
+     * functions they call to do the reading and writing, which are where the time goes.
+     */
+    class BenchFile : public DOC_YEditFile {
+      public:
+        BenchFile() : DOC_YEditFile("*bench*") {}
+
+        //! Removes all of the text.
+        void clear() { erase(); }
+
+        //! Adds a file's text, as load does for files that are mapped.
+        bool read(const char *name)
+        {
+            MappedFile image;
+            if (!image.open(name))
+                return false;
+            return read_memory(image.data(), image.size());
+        }
+
+        //! Writes the text to a file, as save does for plain files.
+        bool write(const char *name)
+        {
+            std::FILE *const disk = std::fopen(name, "wb");
+            if (disk == nullptr)
+                return false;
+            const bool result = write_disk(disk);
+            return (std::fclose(disk) == 0) && result;
+        }
+
+        //! Forgets the changes recorded for undo, which would otherwise pile up.
+        void forget_undo() { undo_log.clear(); }
+    };
+
+    //! The keystroke edits of CharacterEditFile, composed at compile time.
+    /*!
+     * The mixins of YEditFile share EditFile as a virtual base, so they find file_data and
+     * current_point through an offset looked up at run time. Here the same edits are layered
+     * over Base as an ordinary base, so every member is at a fixed offset and the edits can be
+     * inlined. Only what typing at a single cursor needs is reproduced: inserting a character
+     * into a line and erasing one from inside a line. The other cases are refused.
+     */
+    template <class Base> class ComposedCharacters : public Base {
+      public:
+        FilePosition &CP() { return this->current_point; }
+
+        bool insert_char(const char letter)
+        {
+            if (!this->carets.empty() || this->block)
+                return false;
+            settle_edited_line();
+            this->is_changed = true;
+            const long line_number = this->current_point.cursor_line();
+            this->mark_damaged(line_number, line_number);
+            if (!this->top_of_block())
+                return false;
+            EditBuffer *const line = this->file_data.get();
+            const std::size_t offset =
+                line->offset_of(this->current_point.cursor_column(), this->tab_stop);
+            this->record_text(
+                line_number, offset, line->length(), "", std::string_view(&letter, 1));
+            line->insert(letter, offset);
+            this->file_data.next();
+            return true;
+        }
+
+        bool backspace()
+        {
+            const unsigned column = this->current_point.cursor_column();
+            if (!this->carets.empty() || this->block || column == 0)
+                return false;
+            settle_edited_line();
+            this->is_changed = true;
+            const long line_number = this->current_point.cursor_line();
+            if (line_number >= this->file_data.size())
+                return true;
+            this->mark_damaged(line_number, line_number);
+            this->file_data.jump_to(line_number);
+            EditBuffer *const line = this->file_data.get();
+            const std::size_t offset = line->offset_of(column - 1, this->tab_stop);
+            const std::string_view old_text = line->view();
+            unsigned target = column - 1;
+            if (offset < old_text.size()) {
+                target = static_cast<unsigned>(line->column_of(offset, this->tab_stop));
+                const std::size_t count = Utf8::next(old_text, offset) - offset;
+                this->record_text(line_number, offset, old_text.size(),
+                                  old_text.substr(offset, count), "");
+                line->splice(offset, count, "");
+            }
+            this->file_data.next();
+            this->current_point.jump_to_column(target);
+            return true;
+        }
+
+      private:
+        long edited_line = -1L; //!< Line most recently edited (-1 if none).
+
+        void settle_edited_line()
+        {
+            const long line = this->current_point.cursor_line();
+            if (edited_line != line && edited_line >= 0) {
+                this->file_data.jump_to(edited_line);
+                if (this->file_data.get() != nullptr)
+                    this->file_data.get()->compact();
+            }
+            edited_line = line;
+        }
+    };
+
+    //! The language hook of a file that does nothing special with the characters typed.
+    struct PlainLanguage {
+        template <class File> static void typed(File &, char) {}
+    };
+
+    //! A file whose keystroke edits and language hook are all bound at compile time.
+    /*!
+     * This is what a composed YEditFile would do in place of the virtual insert_char that the
+     * language classes in special.hpp override. Language supplies a static typed() function
+     * that is called after each character is inserted.
+     */
+    template <class Language> class ComposedFile : public ComposedCharacters<EditFile> {
+      public:
+        bool insert_char(const char letter)
+        {
+            const bool result = ComposedCharacters::insert_char(letter);
+            Language::typed(*this, letter);
+            return result;
+        }
+
+        //! Adds lines of text, each ending with a newline.
+        void fill(const std::string &text)
+        {
+            for (std::size_t start = 0; start < text.size();) {
+                std::size_t end = text.find('\n', start);
+                if (end == std::string::npos)
+                    end = text.size();
+                file_data.insert(new EditBuffer(text.data() + start, end - start));
+                start = end + 1;
+            }
+        }
+
+        //! Forgets the changes recorded for undo, which would otherwise pile up.
+        void forget_undo() { undo_log.clear(); }
+    };
+
+    //! Types count characters into file, erasing each one, and returns the nanoseconds taken.
+    /*!
+     * Each character is typed in the middle of a line and the cursor stepped past it, as the
+     * keyboard handler does, before it is erased. So the text and the cursor end up where they
+     * started. The undo log of owner, which is the file under another type, is cleared every
+     * KEYSTROKE_BATCH keystrokes, outside the timing.
+     */
+    template <class File, class Owner>
+    long long type_and_erase(File &file, Owner &owner, const long count)
+    {
+        file.CP().jump_to_line(100);
+        spica::Timer stopwatch;
+        for (long i = 0; i < count; i += KEYSTROKE_BATCH) {
+            const long end = std::min(count, i + KEYSTROKE_BATCH);
+            stopwatch.start();
+            for (long j = i; j < end; ++j) {
+                file.CP().jump_to_column(40);
+                file.insert_char('x');
+                file.CP().jump_to_column(41);
+                file.backspace();
+            }
+            stopwatch.stop();
+            owner.forget_undo();
+        }
+        return stopwatch.nanoseconds();
+    }
+
+    //! Supplies random words, the same ones on every run.
+    class Words {
+      public:
+        Words() : generator(SEED) {}
+
+        //! Appends words to text until it has grown by at least length characters.
+        void append(std::string &text, const std::size_t length)
+        {
+            static const char *const words[] = {
+                "the",    "editor", "buffer", "line",  "of",      "text",  "and",    "a",
+                "window", "file",   "search", "macro", "command", "block", "cursor", "to",
+                "is",     "in",     "screen", "key",   "word",    "undo",  "page",   "list"};
+            const std::size_t end = text.size() + length;
+            while (text.size() < end) {
+                text.append(words[generator() % (sizeof(words) / sizeof(words[0]))]);
+                text.push_back(' ');
+            }
+        }
+
+        //! Returns a number from low to high inclusive.
+        int between(const int low, const int high)
+        {
+            return low + static_cast<int>(generator() % static_cast<unsigned>(high - low + 1));
+        }
+
+      private:
+        std::mt19937 generator;
+    };
+
+    //! Returns lines of up to 100 characters, about size bytes in all.
+    std::string generate_text(const std::size_t size)
+    {
+        Words words;
+        std::string text;
+        text.reserve(size + 128);
+        while (text.size() < size) {
+            words.append(text, static_cast<std::size_t>(words.between(0, 100)));
+            text.push_back('\n');
+        }
+        return text;
+    }
+
+    //! Returns paragraphs of ragged lines, each paragraph followed by a blank line.
+    std::string generate_paragraphs(const int line_count)
+    {
+        Words words;
+        std::string text;
+        for (int line = 0; line < line_count; ++line) {
+            const int paragraph_lines = words.between(3, 12);
+            for (int i = 0; i < paragraph_lines; ++i, ++line) {
+                text.append("Some");
+                words.append(text, static_cast<std::size_t>(words.between(20, 90)));
+                text.push_back('\n');
+            }
+            text.push_back('\n');
+        }
+        return text;
+    }
+
+    //! Writes text to the temporary file and returns false if that fails.
+    bool write_temporary(const std::string &text)
+    {
+        std::FILE *const file = std::fopen(TEMPORARY_NAME, "wb");
+        if (file == nullptr)
+            return false;
+        const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        return (std::fclose(file) == 0) && written;
+    }
+
+    //! Returns a body that times all of the operations done by op together.
+    Body timed(std::function<void(long count)> op)
+    {
+        return [op](const long count) {
+            spica::Timer stopwatch;
+            stopwatch.start();
+            op(count);
+            stopwatch.stop();
+            return stopwatch.nanoseconds();
+        };
+    }
+
+    //! Returns indices to jump to in a list of size items, visited in the given pattern.
+    std::vector<long> jump_pattern(const char *const pattern, const long size)
+    {
+        std::mt19937 generator(SEED);
+        std::vector<long> indices(4096);
+        long index = 0;
+        for (long &target : indices) {
+            if (std::strcmp(pattern, "sequential") == 0)
+                index = (index + 1) % size;
+            else if (std::strcmp(pattern, "nearby") == 0)
+                index = (index + size + static_cast<long>(generator() % 17) - 8) % size;
+            else
+                index = static_cast<long>(generator() % static_cast<unsigned long>(size));
+            target = index;
+        }
+        return indices;
+    }
+
+    void add_buffer_benchmarks(std::vector<Benchmark> &benchmarks)
+    {
+        // Edits are made in the middle of an ordinary line, which stays the same length.
+        benchmarks.push_back({"buffer_insert", timed([](const long count) {
+                                  EditBuffer line(generate_text(100).c_str());
+                                  for (long i = 0; i < count; ++i) {
+                                      line.insert('x', 40);
+                                      line.erase(41);
+                                  }
+                              }),
+                              0});
+        benchmarks.push_back({"buffer_erase", timed([](const long count) {
+                                  EditBuffer line(generate_text(100).c_str());
+                                  for (long i = 0; i < count; ++i) {
+                                      line.erase(40);
+                                      line.append('x');
+                                  }
+                              }),
+                              0});
+        benchmarks.push_back({"buffer_append", timed([](const long count) {
+                                  EditBuffer line;
+                                  for (long i = 0; i < count; ++i) {
+                                      if (line.length() == 4096)
+                                          line.erase();
+                                      line.append('x');
+                                  }
+                              }),
+                              0});
+    }
+
+    void add_list_benchmarks(std::vector<Benchmark> &benchmarks)
+    {
+        for (const char *pattern : {"sequential", "nearby", "random"}) {
+            benchmarks.push_back({std::string("list_jump_") + pattern,
+                                  timed([pattern](const long count) {
+                                      List<long> list;
+                                      for (long i = 0; i < LIST_SIZE; ++i)
+                                          list.insert(i);
+                                      const std::vector<long> targets =
+                                          jump_pattern(pattern, LIST_SIZE);
+                                      for (long i = 0; i < count; ++i)
+                                          list.jump_to(targets[i % targets.size()]);
+                                  }),
+                                  0});
+            benchmarks.push_back({std::string("edit_list_jump_") + pattern,
+                                  [pattern](const long count) {
+                                      EditList list;
+                                      for (long i = 0; i < EDIT_LIST_SIZE; ++i)
+                                          list.insert(new EditBuffer("line"));
+                                      const std::vector<long> targets =
+                                          jump_pattern(pattern, EDIT_LIST_SIZE);
+                                      spica::Timer stopwatch;
+                                      stopwatch.start();
+                                      for (long i = 0; i < count; ++i) {
+                                          list.jump_to(targets[i % targets.size()]);
+                                          list.get();
+                                      }
+                                      stopwatch.stop();
+                                      return stopwatch.nanoseconds();
+                                  },
+                                  0});
+        }
+    }
+
+    void add_file_benchmarks(std::vector<Benchmark> &benchmarks, const std::size_t megabytes)
+    {
+        const long long bytes = static_cast<long long>(megabytes) * 1024 * 1024;
+        const std::string size = "_" + std::to_string(megabytes) + "mb";
+
+        // The text is made once for the benchmarks of each size, when the first one runs.
+        auto text = std::make_shared<std::string>();
+        auto prepare = [text, bytes]() {
+            if (text->empty()) {
+                *text = generate_text(static_cast<std::size_t>(bytes));
+                if (!write_temporary(*text)) {
+                    std::fprintf(stderr, "Can't write %s\n", TEMPORARY_NAME);
+                    std::exit(EXIT_FAILURE);
+                }
+            }
+        };
+
+        benchmarks.push_back({"load" + size,
+                              [prepare](const long count) {
+                                  prepare();
+                                  BenchFile file;
+                                  spica::Timer stopwatch;
+                                  for (long i = 0; i < count; ++i) {
+                                      stopwatch.start();
+                                      file.read(TEMPORARY_NAME);
+                                      stopwatch.stop();
+                                      file.clear();
+                                  }
+                                  return stopwatch.nanoseconds();
+                              },
+                              bytes});
+        benchmarks.push_back({"save" + size,
+                              [prepare](const long count) {
+                                  prepare();
+                                  BenchFile file;
+                                  file.read(TEMPORARY_NAME);
+                                  spica::Timer stopwatch;
+                                  stopwatch.start();
+                                  for (long i = 0; i < count; ++i)
+                                      file.write(TEMPORARY_NAME);
+                                  stopwatch.stop();
+                                  return stopwatch.nanoseconds();
+                              },
+                              bytes});
+
+        // A hit is on a line added at the end. A miss scans every line.
+        for (const bool hit : {true, false}) {
+            benchmarks.push_back({(hit ? "search_hit" : "search_miss") + size,
+                                  [prepare, hit](const long count) {
+                                      prepare();
+                                      BenchFile file;
+                                      file.read(TEMPORARY_NAME);
+                                      if (hit) {
+                                          const EditBuffer needle("needle in the haystack");
+                                          file.bottom_of_file();
+                                          file.insert_line(&needle);
+                                      }
+                                      spica::Timer stopwatch;
+                                      for (long i = 0; i < count; ++i) {
+                                          file.top_of_file();
+                                          stopwatch.start();
+                                          file.simple_search("needle");
+                                          stopwatch.stop();
+                                      }
+                                      return stopwatch.nanoseconds();
+                                  },
+                                  bytes});
+        }
+    }
+
+    void add_other_benchmarks(std::vector<Benchmark> &benchmarks)
+    {
+        // Reformatting text that is already formatted does the same work each time.
+        benchmarks.push_back({"reflow",
+                              [](const long count) {
+                                  if (!write_temporary(generate_paragraphs(REFLOW_LINES))) {
+                                      std::fprintf(stderr, "Can't write %s\n", TEMPORARY_NAME);
+                                      std::exit(EXIT_FAILURE);
+                                  }
+                                  BenchFile file;
+                                  file.read(TEMPORARY_NAME);
+                                  spica::Timer stopwatch;
+                                  for (long i = 0; i < count; ++i) {
+                                      stopwatch.start();
+                                      file.reformat_block();
+                                      stopwatch.stop();
+                                      file.forget_undo();
+                                  }
+                                  return stopwatch.nanoseconds();
+                              },
+                              0});
+
+        // A character is typed and erased in the middle of a line, first through the YEditFile
+        // hierarchy and then in a file composed at compile time. The hierarchy is used through
+        // a reference the compiler can't see through, as the keyboard handler does, so its
+        // calls are virtual and its members are found through the virtual base. The difference
+        // between the two is the cost of that dispatch.
+        benchmarks.push_back({"keystroke_virtual",
+                              [](const long count) {
+                                  if (!write_temporary(generate_text(64 * 1024))) {
+                                      std::fprintf(stderr, "Can't write %s\n", TEMPORARY_NAME);
+                                      std::exit(EXIT_FAILURE);
+                                  }
+                                  BenchFile file;
+                                  file.read(TEMPORARY_NAME);
+                                  YEditFile *volatile hidden = &file;
+                                  return type_and_erase(*hidden, file, count);
+                              },
+                              0});
+        benchmarks.push_back({"keystroke_composed",
+                              [](const long count) {
+                                  ComposedFile<PlainLanguage> file;
+                                  file.fill(generate_text(64 * 1024));
+                                  return type_and_erase(file, file, count);
+                              },
+                              0});
+
+        // The words looked up are spread over the table, and one of them is not a command.
+        benchmarks.push_back({"command_lookup", timed([](const long count) {
+                                  static const char *const words[] = {
+                                      "add",      "cursor_down", "follow_file", "paste",
+                                      "set_mark", "yexit",       "not_a_word",  "top_of_file"};
+                                  long found = 0;
+                                  for (long i = 0; i < count; ++i)
+                                      found += find_command(words[i % 8]);
+                                  sink = found;
+                              }),
+                              0});
+    }
+
+    //! Runs a benchmark long enough to be timed and reports the time of each operation.
+    void run(const Benchmark &benchmark)
+    {
+        long count = 1;
+        long long nanoseconds = 0;
+        const long long minimum = static_cast<long long>(minimum_seconds * 1e9);
+        while ((nanoseconds = benchmark.body(count)) < minimum && count < MAXIMUM_OPERATIONS) {
+            // Aim just past the minimum, growing at least tenfold while the times are tiny.
+            const double per_operation = static_cast<double>(nanoseconds) / count;
+            const double wanted = (per_operation > 0.0) ? 1.2 * minimum / per_operation : 0.0;
+            count = (nanoseconds < minimum / 100 || wanted > 10.0 * count)
+                        ? count * 10
+                        : static_cast<long>(wanted) + 1;
+        }
+
+        const double per_operation = static_cast<double>(nanoseconds) / count;
+        std::printf("%-28s %12ld %16.1f", benchmark.name.c_str(), count, per_operation);
+        if (benchmark.bytes > 0 && per_operation > 0.0)
+            std::printf(" %12.1f", benchmark.bytes / (1024.0 * 1024.0) / (per_operation / 1e9));
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+
+    void usage()
+    {
+        std::fprintf(stderr, "Usage: yexa_bench [-t seconds] [-s megabytes,...] [name...]\n");
+        std::exit(EXIT_FAILURE);
+    }
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::size_t> sizes = {1, 16};
+    std::vector<std::string> names;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            minimum_seconds = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            sizes.clear();
+            for (char *size = std::strtok(argv[++i], ","); size != nullptr;
+                 size = std::strtok(nullptr, ",")) {
+                const long megabytes = std::atol(size);
+                if (megabytes <= 0)
+                    usage();
+                sizes.push_back(static_cast<std::size_t>(megabytes));
+            }
+        }
+        else if (argv[i][0] == '-') {
+            usage();
+        }
+        else {
+            names.push_back(argv[i]);
+        }
+    }
+
+    std::vector<Benchmark> benchmarks;
+    add_buffer_benchmarks(benchmarks);
+    add_list_benchmarks(benchmarks);
+    for (const std::size_t megabytes : sizes)
+        add_file_benchmarks(benchmarks, megabytes);
+    add_other_benchmarks(benchmarks);
+
+    std::printf("%-28s %12s %16s %12s\n", "Benchmark", "Operations", "ns/operation", "MB/s");
+    for (const Benchmark &benchmark : benchmarks) {
+        bool selected = names.empty();
+        for (const std::string &name : names)
+            selected = selected || benchmark.name.find(name) != std::string::npos;
+        if (selected)
+            run(benchmark);
+    }
+    std::remove(TEMPORARY_NAME);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/*! \file    Allocations.hpp
+ *  \brief   Interface to the Allocations abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef ALLOCATIONS_HPP
+#define ALLOCATIONS_HPP
+
+#include <string>
+#include <vector>
+
+//! Encloses functions that report how much the editor allocates, and for what.
+/*!
+ * The global operator new and operator delete are replaced by versions that count the
+ * allocations made with them before using std::malloc and std::free. Objects taken from a
+ * FixedPool (such as EditBuffers) are not counted except when the pool takes another slab.
+ *
+ * Each allocation is charged to the subsystem (tag) that is current on the allocating thread
+ * when it is made, and its release is credited to the same tag on whatever thread it happens.
+ * A Scope declared at the start of a block makes a tag current for the block; scopes nest and
+ * the innermost one wins. For each tag the bytes that are live, the most that were ever live
+ * at once, and the number of allocations and bytes allocated are kept. The size and tag of
+ * each block are kept in a small header in front of it.
+ */
+namespace Allocations {
+
+    //! The subsystems to which allocations are charged.
+    enum Tag {
+        OTHER,     //!< Anything not made in one of the scopes below.
+        DOCUMENT,  //!< The text of files and what is kept about it (undo, indexes, ...).
+        CLIPBOARD, //!< The text cut or copied to the clipboard.
+        MACRO,     //!< Compiled macros and the keystrokes of a learned macro.
+        SCREEN,    //!< The windows and the images composed from them.
+        TAG_COUNT
+    };
+
+    //! Returns the number of allocations made with the global operator new.
+    unsigned long long count();
+
+    //! Returns the number of bytes allocated by a subsystem that are not yet released.
+    unsigned long long live_bytes(Tag tag);
+
+    //! Charges the allocations made in the block in which it is declared to a subsystem.
+    class Scope {
+      public:
+        explicit Scope(Tag tag);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        Tag previous;
+    };
+
+    //! Records the live bytes of each subsystem as counters in the trace (see Trace).
+    void trace();
+
+    //! Returns lines of text describing the memory of each subsystem.
+    /*!
+     * Rates are over the time since the previous report (or since the editor started).
+     */
+    std::vector<std::string> report();
+
+} // namespace Allocations
+
+#endif
@@ -0,0 +1,58 @@
+/*! \file    BackgroundJob.hpp
+ *  \brief   Interface to class BackgroundJob
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef BACKGROUNDJOB_HPP
+#define BACKGROUNDJOB_HPP
+
+#include <string>
+
+#include <screen/environ.hpp>
+
+//! A shell command running in the background with its output read through a pipe.
+/*!
+ * The command's standard output and standard error share one pipe and its standard input is
+ * empty. The pipe is never waited on; `collect` takes only what the command has written so far
+ * so the editor can call it between keystrokes without blocking. Destroying a job that is still
+ * running stops the command (and any programs it started).
+ */
+class BackgroundJob {
+  public:
+    explicit BackgroundJob(std::string command);
+    ~BackgroundJob();
+
+    // A job owns its process.
+    BackgroundJob(const BackgroundJob &) = delete;
+    BackgroundJob &operator=(const BackgroundJob &) = delete;
+
+    bool start();
+    bool collect(std::string &text);
+    void stop();
+
+    //! Returns the command given to the shell.
+    const std::string &command() const { return command_text; }
+
+    //! Returns true if the command has not yet finished.
+    bool running() const { return active; }
+
+    //! Returns the command's exit status (-1 if it did not exit normally).
+    int status() const { return exit_status; }
+
+  private:
+    std::string command_text;
+    std::string partial; //!< Output following the last complete line.
+    bool active;         //!< =true while the command is running or its output is unread.
+    int exit_status;
+#if eOPSYS == ePOSIX
+    int output_fd; //!< The reading end of the pipe (-1 at end of file).
+    int process;   //!< The process ID of the shell, which leads its own process group.
+#elif eOPSYS == eWINDOWS
+    void *output_handle;  //!< The reading end of the pipe (nullptr at end of file).
+    void *process_handle; //!< Handle of the command's process.
+#endif
+
+    bool finished();
+};
+
+#endif
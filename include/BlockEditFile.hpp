@@ -6,7 +6,11 @@
 #ifndef BLOCKEDITFILE_HPP
 #define BLOCKEDITFILE_HPP
 
+#include <vector>
+
 #include "EditFile.hpp"
+#include "LineSort.hpp"
+#include "LineTransform.hpp"
 
 //! Adds block handling to EditFile.
 /*!
@@ -18,6 +22,11 @@
  * EditFile. Those block handling functions are not virtual because Borland's Turbo C++ 1.0 had
  * problems with virtual functions in virtual base classes.
  *
+ * A block is normally a range of whole lines. A rectangular (column) block also spans a range
+ * of columns on those lines. The column operations work out each line's edit before making it
+ * so that every line changes with a single splice. Lines shorter than the block's columns are
+ * treated as if they ended with spaces, as EditBuffer does.
+ *
  * This class has no private data. Class EditFile contains the data needed for blocks in its
  * protected section. An ideal implementation would have that private data here with a
  * constructor here to initialize it. Right now, EditFile's constructor is initializing block
@@ -30,16 +39,24 @@ class BlockEditFile : private virtual EditFile {
 
       private:
         bool is_on;         //!< true if block mode was on.
+        bool columns;       //!< true if the block was rectangular.
         long anchor;        //!< The anchor line number of block mode.
+        unsigned anchor_column; //!< The anchor column of a rectangular block.
         FilePosition limit; //!< The current point of the other end of the block.
     };
 
     void get_blockinfo(BlockInfo &);
     void set_blockinfo(const BlockInfo &);
     void toggle_block();
+    void toggle_column_block();
     bool get_block(EditList &);
     void delete_block();
     bool insert_block(EditList &);
+    void get_columns(EditList &);
+    void delete_columns();
+    void insert_columns(EditList &);
+    bool arrange_lines(const LineSort::Options &);
+    bool transform_lines(const std::vector<LineTransform::Kind> &, unsigned tab, long &changed);
 };
 
 #endif
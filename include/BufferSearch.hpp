@@ -0,0 +1,69 @@
+/*! \file    BufferSearch.hpp
+ *  \brief   Interface to class BufferSearch.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef BUFFERSEARCH_HPP
+#define BUFFERSEARCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DocumentSnapshot.hpp"
+#include "SearchPattern.hpp"
+#include "TaskPool.hpp"
+
+//! A version of a file's text that can be read safely by other threads.
+struct TextSnapshot {
+    std::string name;                              //!< Name of the file.
+    std::shared_ptr<const DocumentSnapshot> lines; //!< The lines of the file.
+};
+
+//! Searches a collection of file snapshots on the worker threads (see TaskPool).
+/*!
+ * The search begins when the object is constructed. Each task takes the next unsearched file
+ * and searches it with its own copy of the pattern (regular expressions update a cache as they
+ * search). Hits are queued as they are found so the caller can show them while the
+ * search continues. Destroying the object cancels a search in progress.
+ */
+class BufferSearch {
+  public:
+    struct Hit {
+        std::size_t file; //!< Index of the snapshot containing the hit.
+        long line;        //!< Line number of the hit (zero based).
+        unsigned column;  //!< Column of the hit (zero based).
+    };
+
+    BufferSearch(const SearchPattern &pattern, std::vector<TextSnapshot> &&files);
+    ~BufferSearch();
+
+    BufferSearch(const BufferSearch &) = delete;
+    BufferSearch &operator=(const BufferSearch &) = delete;
+
+    //! Returns the snapshot with the given index.
+    const TextSnapshot &file(std::size_t index) const { return snapshots[index]; }
+
+    //! Returns the text of the given line in the given snapshot.
+    std::string_view line(std::size_t index, long line_number) const;
+
+    bool collect(std::vector<Hit> &hits);
+
+  private:
+    const std::vector<TextSnapshot> snapshots;
+    TaskPool::Group workers;
+    std::atomic<std::size_t> next_file; //!< Index of the next snapshot to search.
+    std::atomic<bool> cancelled;        //!< Set to stop the tasks early.
+
+    std::mutex queue_lock;      //!< Protects the members below.
+    std::vector<Hit> queue;     //!< Hits found but not yet collected.
+    unsigned running;           //!< Number of tasks still searching.
+
+    void work(SearchPattern pattern);
+};
+
+#endif
@@ -6,12 +6,20 @@
 #ifndef CHARACTEREDITFILE_HPP
 #define CHARACTEREDITFILE_HPP
 
+#include <cstddef>
+#include <string_view>
+
 #include "EditFile.hpp"
 
 //! Adds character handling to EditFile.
 /*!
  * CharacterEditFile adds basic character manipulations to EditFile objects. It is this class
  * that is responsible for extending short lines as necessary.
+ *
+ * It also manages the file's carets. While there are carets (and block mode is off) each
+ * character manipulation is done at the current point and at every caret in a single pass
+ * over the lines involved, in order. Each line is rewritten once no matter how many cursors
+ * are on it, and the whole pass is undone as one command.
  */
 class CharacterEditFile : private virtual EditFile {
 
@@ -20,25 +28,51 @@ class CharacterEditFile : private virtual EditFile {
     enum InsertMode { INSERT, REPLACE };
 
   private:
-    int tab_stop;            //!< Distance between tab stops for this file.
     InsertMode insert_state; //!< Current mode for this file.
+    long edited_line;        //!< Line most recently edited (-1 if none).
+
+    //! The manipulations that can be done at every cursor at once.
+    enum CaretEdit { CARET_INSERT, CARET_REPLACE, CARET_BACKSPACE, CARET_DELETE };
+
+    void settle_edited_line();
+    bool edit_carets(CaretEdit edit, char letter);
 
   public:
-    CharacterEditFile(int tab_distance) : tab_stop(tab_distance), insert_state(INSERT) {}
+    CharacterEditFile(int tab_distance) : insert_state(INSERT), edited_line(-1)
+    {
+        set_tab(tab_distance);
+    }
 
-    int tab_distance() { return tab_stop; }
+    int tab_distance() { return static_cast<int>(tab_stop); }
     InsertMode insert_mode() { return insert_state; }
 
-    //! Change the tab distance.
-    void set_tab(int new_tab) { tab_stop = new_tab; }
+    //! Change the tab distance. Distances less than one are ignored.
+    /*!
+     * Tabs in the text are displayed using the new distance, so the whole file is redrawn.
+     */
+    void set_tab(int new_tab)
+    {
+        if (new_tab < 1 || static_cast<unsigned>(new_tab) == tab_stop)
+            return;
+        tab_stop = static_cast<unsigned>(new_tab);
+        mark_damaged_from(0L);
+    }
 
     void toggle_insert();
     void set_insert(InsertMode new_mode);
     bool new_line();
     bool insert_char(char letter);
     bool replace_char(char letter);
+    bool paste_text(std::string_view text);
     bool backspace();
     bool delete_char();
+
+    bool toggle_caret();
+    void clear_carets();
+    bool column_carets();
+
+    //! Returns the number of cursors in addition to the current point.
+    std::size_t caret_count() { return carets.size(); }
 };
 
 #endif
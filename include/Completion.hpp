@@ -0,0 +1,46 @@
+/*! \file    Completion.hpp
+ *  \brief   Interface to the Completion abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef COMPLETION_HPP
+#define COMPLETION_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+class YEditFile;
+
+//! Encloses functions that complete words using the identifiers in the open files.
+/*!
+ * The identifiers in every file are counted in one sorted index, so the words starting with a
+ * prefix are found with a single search. The words on each line are remembered as well. When
+ * lines are modified (see EditFile::take_modifications) only their old words are removed and
+ * their new words added; files are never scanned again. New files are scanned a few thousand
+ * lines at a time while the editor is idle.
+ */
+namespace Completion {
+
+    //! Indexes lines of the open files that are new or modified. Returns true if more remain.
+    /*!
+     * This is an idle task (see EventLoop::add_idle).
+     */
+    bool update();
+
+    //! Returns the words that complete a prefix, best first.
+    /*!
+     * Words used more often, and words used near the given line of the given file, come first.
+     * The prefix itself is not included.
+     */
+    std::vector<std::string> candidates(YEditFile &file, long line, std::string_view prefix);
+
+    //! Returns true if the byte may be part of a word.
+    bool is_word_character(char ch);
+
+    //! Removes a file's words from the index. Call before destroying it.
+    void forget(YEditFile &file);
+
+} // namespace Completion
+
+#endif
@@ -0,0 +1,83 @@
+/*! \file    CompressedFile.hpp
+ *  \brief   Interface to the CompressedFile abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef COMPRESSEDFILE_HPP
+#define COMPRESSEDFILE_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+//! Encloses functions that read and write files compressed with gzip or zstd.
+/*!
+ * A file is known to be compressed by its first few bytes (its "magic number"). A file that is
+ * created is compressed according to its extension (".gz" or ".zst"). Each format is only
+ * available if its library was found when the editor was built (zlib for gzip, libzstd for
+ * zstd). Files in a format that is not available are reported as such rather than being read
+ * as text.
+ */
+namespace CompressedFile {
+
+    enum Format {
+        PLAIN, //!< Not compressed.
+        GZIP,  //!< The gzip format of RFC 1952, possibly several members concatenated.
+        ZSTD   //!< The Zstandard format of RFC 8878, possibly several frames concatenated.
+    };
+
+    //! Returns the format of the named file according to its contents (PLAIN if unreadable).
+    Format detect(const char *name);
+
+    //! Returns the format implied by a file name's extension.
+    Format format_for(const char *name);
+
+    //! Returns the name of a format, suitable for messages.
+    const char *format_name(Format format);
+
+    //! Returns true if files in the given format can be read and written.
+    bool available(Format format);
+
+    //! Reads and decompresses a file, giving its text to consume one block at a time.
+    /*!
+     * The file is read and decompressed by another thread while consume handles the blocks
+     * already decompressed on the calling thread. Consume returns false to stop early.
+     *
+     * \return false if the file could not be read or is damaged. Blocks that were decompressed
+     * before the problem was found have been consumed.
+     */
+    bool read(const char *name, Format format,
+              const std::function<bool(std::string_view)> &consume);
+
+    //! Reads and decompresses an entire file into text.
+    /*!
+     * \return false if the file could not be read (entirely). Text holds whatever was read.
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    bool read_all(const char *name, Format format, std::string &text);
+
+    //! Compresses text written to a file.
+    class Encoder {
+      public:
+        Encoder(std::FILE *disk, Format format);
+        ~Encoder();
+
+        Encoder(const Encoder &) = delete;
+        Encoder &operator=(const Encoder &) = delete;
+
+        bool write(const char *data, std::size_t size);
+        bool finish();
+
+      private:
+        struct Stream;
+        std::unique_ptr<Stream> stream; //!< The library's state (nullptr if unavailable).
+        std::FILE *disk;                //!< The file receiving the compressed output.
+        bool failed;                    //!< =true once an error has been encountered.
+    };
+
+} // namespace CompressedFile
+
+#endif
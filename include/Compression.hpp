@@ -0,0 +1,38 @@
+/*! \file    Compression.hpp
+ *  \brief   Interface to the Compression functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef COMPRESSION_HPP
+#define COMPRESSION_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//! Encloses functions that compress blocks of text held in memory.
+/*!
+ * The format is that of LZ4 blocks: runs of literal bytes alternate with copies of earlier
+ * output at most 64 KiB back. Compression finds matches with a small hash table in a single
+ * pass and expansion is a loop of memory copies, so both run at memory speeds. Text of the
+ * sort people edit typically shrinks to between a third and a half of its size. Blocks are
+ * meant to be kilobytes to a few megabytes long; they carry no header so the caller must
+ * remember how large each one was before it was compressed.
+ */
+namespace Compression {
+
+    //! Appends the compressed form of text to packed.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    void compress(std::string_view text, std::string &packed);
+
+    //! Restores the size bytes of text that were compressed into packed.
+    /*!
+     * \return false if packed is not the compressed form of exactly size bytes.
+     */
+    bool expand(std::string_view packed, char *text, std::size_t size);
+
+} // namespace Compression
+
+#endif
@@ -18,6 +18,17 @@ class CursorEditFile : private virtual EditFile {
      */
     FilePosition &CP() { return current_point; }
 
+    //! Moves current point to the previous character on the line.
+    /*!
+     * This is one column to the left except after a tab, where the current point moves to the
+     * start of the tab. Past the end of the line, where there are no characters, the current
+     * point moves one column.
+     */
+    void character_left();
+
+    //! Moves current point to the next character on the line (see character_left).
+    void character_right();
+
     //! Moves current point to the beginning of the line.
     void home();
 
@@ -0,0 +1,68 @@
+/*! \file    Diagnostics.hpp
+ *  \brief   Interface to class Diagnostics
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef DIAGNOSTICS_HPP
+#define DIAGNOSTICS_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! The problems a language server has found in a file, kept by line for the display.
+/*!
+ * Each diagnostic covers a range of text. The range is kept as a mark on each line it touches
+ * (up to a limit) with the byte offsets it covers on that line, sorted by line, so the marks on
+ * a row are found with a binary search without consulting the server. When lines are replaced
+ * the marks on them are dropped and the marks after them are moved with the text until the
+ * server reports again.
+ */
+class Diagnostics {
+  public:
+    enum Severity { ERROR = 1, WARNING, INFORMATION, HINT };
+
+    //! The part of one diagnostic on one line.
+    struct Mark {
+        long line;
+        std::size_t start;   //!< Offset of the first byte covered.
+        std::size_t end;     //!< Offset after the last byte covered (may be past the text).
+        Severity severity;
+        bool first;          //!< =true on the line where the diagnostic starts.
+        std::size_t message; //!< Index of the message (see message).
+    };
+
+    typedef std::vector<Mark>::const_iterator Iterator;
+
+    void clear();
+    void add(long first_line, std::size_t first_offset, long last_line,
+             std::size_t last_offset, Severity severity, std::string message);
+    void finish();
+    void move_lines(long first, long old_count, long new_count);
+
+    //! Returns the marks on a line.
+    std::pair<Iterator, Iterator> on_line(long line) const;
+
+    //! Returns the first diagnostic that starts after a position, or nullptr if none does.
+    const Mark *following(long line, std::size_t offset) const;
+
+    //! Returns the first diagnostic in the file, or nullptr if there are none.
+    const Mark *first() const { return following(-1, 0); }
+
+    //! Returns the text of a diagnostic.
+    const std::string &message(const Mark &mark) const { return messages[mark.message]; }
+
+    //! Returns the number of marks.
+    std::size_t size() const { return marks.size(); }
+
+    //! Returns the first and last lines that have marks (-1 and -2 if none do).
+    long top() const { return marks.empty() ? -1L : marks.front().line; }
+    long bottom() const { return marks.empty() ? -2L : marks.back().line; }
+
+  private:
+    std::vector<Mark> marks;           //!< Sorted by line, then by start.
+    std::vector<std::string> messages; //!< The text of each diagnostic.
+};
+
+#endif
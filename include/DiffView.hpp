@@ -0,0 +1,49 @@
+/*! \file    DiffView.hpp
+ *  \brief   Interface to the DiffView abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef DIFFVIEW_HPP
+#define DIFFVIEW_HPP
+
+class FilePosition;
+class YEditFile;
+
+//! Encloses functions that compare two files whose windows are shown side by side.
+/*!
+ * The lines of the files are compared by their hashes (see LineDiff). The comparison works
+ * from snapshots of the files (see DocumentSnapshot), so large files are compared on a worker
+ * thread while the editor goes on. The lines that differ are marked in both files, and while
+ * one of them is shown in the active window any window showing the other keeps level with it
+ * (see follow). When either file is modified they are compared again once the editor is idle.
+ *
+ * There is one comparison at a time. Starting another ends the one before it.
+ */
+namespace DiffView {
+
+    //! Compares two files. The lines of left are the old version.
+    /*!
+     * \return false if there was insufficient memory. An error message has been displayed.
+     */
+    bool start(YEditFile &left, YEditFile &right);
+
+    //! Ends the comparison of a file that is being removed from the file list, if any.
+    void forget(const YEditFile *file);
+
+    //! Moves a position in one file to the place matching a position in the other.
+    /*!
+     * The position goes to the line that corresponds to the leader's cursor line, at the same
+     * distance from the top of the window, and to the same column.
+     *
+     * \param leader The file whose position is followed.
+     * \param from The position followed.
+     * \param follower The file whose position is moved.
+     * \param to [in, out] The position moved.
+     * \return false if the files are not being compared. The position is not moved.
+     */
+    bool follow(const YEditFile &leader, const FilePosition &from, const YEditFile &follower,
+                FilePosition &to);
+
+} // namespace DiffView
+
+#endif
@@ -6,12 +6,23 @@
 #ifndef DISKEDITFILE_HPP
 #define DISKEDITFILE_HPP
 
+#include <cstddef>
 #include <cstdio>
 #include <ctime>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <screen/environ.hpp>
 
+#include "CompressedFile.hpp"
 #include "EditFile.hpp"
+#include "LineInterner.hpp"
+#include "Recovery.hpp"
+
+class HexImage;
 
 //! Adds disk I/O features to EditFile.
 /*!
@@ -21,6 +32,21 @@
  */
 class DiskEditFile : private virtual EditFile {
 
+  public:
+    //! The ways the lines of a file can end.
+    enum LineEnding {
+        LF,   //!< A line feed, as on POSIX systems.
+        CRLF, //!< A carriage return and line feed, as on Windows.
+        CR    //!< A carriage return alone, as on classic Mac OS.
+    };
+
+    //! The number of lines read with each kind of ending.
+    struct EndingCounts {
+        long lf = 0;
+        long crlf = 0;
+        long cr = 0;
+    };
+
   private:
 #if eOPSYS == ePOSIX
     time_t file_time;
@@ -29,12 +55,52 @@ class DiskEditFile : private virtual EditFile {
     unsigned file_time; //!< Time stamp of file.
 #endif
 
+    struct ReloadJob;
+    std::shared_ptr<ReloadJob> reload_job; //!< Background reload in progress, if any.
+
+    //! How much of a file being followed has been read.
+    struct FollowState {
+        std::size_t size = 0;     //!< Bytes read.
+        std::size_t complete = 0; //!< Bytes in the complete lines read.
+        bool partial = false;     //!< =true if the last line was read before its newline.
+    };
+    bool following = false; //!< =true if text appended to the file is read (read_appended).
+    long follow_limit = 0;  //!< The most lines kept while following (0 for no limit).
+    FollowState followed;   //!< The part of the file read while following.
+
+    Recovery::Slot recovery_slot = 0; //!< Where unsaved changes are kept (zero if nowhere).
+    std::string recovery_name;        //!< The name under which they are kept.
+
+    //! How the file was compressed when it was loaded. Saves keep the format.
+    CompressedFile::Format disk_format = CompressedFile::PLAIN;
+
+    //! The endings of the lines read into the object. Saves use the most common one.
+    EndingCounts endings;
+
+    //! What sharing the text of repeated lines saved when they were read (see set_interning).
+    LineInterner::Savings interned;
+
+    //! The bytes shown if the file is viewed as bytes (see load_hex), else nullptr.
+    std::unique_ptr<HexImage> hex;
+
+    //! =true if lines of an evicted file couldn't be read back (see evict).
+    bool lines_lost = false;
+
+    void hash_lines(std::vector<std::size_t> &hashes);
+    bool apply_reload(ReloadJob &job);
+    void cancel_reload();
+    void drop_leading_lines();
+    static void measure(std::string_view text, FollowState &state);
+
   protected:
-    bool read_disk(std::FILE *);
-    bool write_disk(std::FILE *);
-    bool write_disk_block(std::FILE *);
+    bool read_disk(std::FILE *, LineInterner *interner = nullptr);
+    bool read_memory(const char *text, std::size_t length, LineInterner *interner = nullptr);
+    bool write_disk(std::FILE *, CompressedFile::Format format = CompressedFile::PLAIN);
+    bool write_disk_block(std::FILE *, CompressedFile::Format format = CompressedFile::PLAIN);
 
   public:
+    ~DiskEditFile();
+
 #if eOPSYS == ePOSIX
     time_t time() { return file_time; }
 #else
@@ -43,13 +109,67 @@ class DiskEditFile : private virtual EditFile {
 #endif
 
     bool changed() { return is_changed; }
+    LineEnding line_ending() const;
+    void set_line_ending(LineEnding ending);
     void set_timestamp(const char *name);
     void mark_as_changed();
     void mark_as_unchanged();
 
     enum Mode { ALL, BLOCK_ONLY };
     bool load(const char *the_name);
+    bool insert_file(const char *the_name);
+    bool reload(const char *the_name);
+    bool evict(const char *the_name);
+    void reload_in_background(const char *the_name, std::function<void()> finished);
+    bool start_following(const char *the_name, long line_limit);
+    //! Stops reading text appended to the file.
+    void stop_following() { following = false; }
+    bool is_following() { return following; }
+    bool read_appended(const char *the_name);
+    static void set_background_loading(bool enabled);
+    static int background_loads();
+    static void set_interning(bool enabled);
+    static bool is_interning();
+    static void set_keeping_history(bool enabled);
+    static bool is_keeping_history();
+    void open_history(const char *the_name);
+    const LineInterner::Savings &interned_lines() const { return interned; }
+    //! Returns the bytes shown if the file is viewed as bytes, else nullptr.
+    HexImage *hex_image() { return hex.get(); }
     bool save(const char *the_name, Mode save_mode = ALL);
+
+    //! A file to be saved by save_all and the name under which it is saved.
+    struct SaveRequest {
+        DiskEditFile *file;
+        const char *name;
+    };
+    static bool save_all(const std::vector<SaveRequest> &requests);
+    void get_text(std::string &text, Mode text_mode = ALL);
+    bool insert_text(const char *text, std::size_t length);
+    bool append_text(const char *text, std::size_t length);
+    void checkpoint(const char *the_name);
+    void autosave(const char *the_name);
+    bool restore(EditList &lines);
+
+  private:
+    //! What write_file did to the file on disk.
+    enum WriteStatus {
+        WRITTEN,     //!< The file now holds the data.
+        NOT_OPENED,  //!< The file could not be opened for output.
+        NOT_WRITTEN, //!< The write failed but the file was not changed.
+        DAMAGED,     //!< The write failed after the file was opened in place.
+        UNSUPPORTED  //!< The file's compression format is not available.
+    };
+    WriteStatus write_file(const char *the_name, Mode save_mode, long &byte_count);
+    void write_history(const char *the_name);
+    bool load_compressed(const char *the_name, CompressedFile::Format format,
+                         LineInterner *interner);
+    bool load_remote(const char *the_name, std::unique_ptr<LineInterner> interner);
+    bool load_hex(const char *the_name);
+    bool reload_hex(const char *the_name);
+    WriteStatus write_remote(const char *the_name, Mode save_mode, long &byte_count);
+    WriteStatus write_hex(const char *the_name, Mode save_mode, long &byte_count);
+    CompressedFile::Format save_format(const char *the_name, Mode save_mode);
 };
 
 #endif
@@ -0,0 +1,64 @@
+/*! \file    DocumentSnapshot.hpp
+ *  \brief   Interface to class DocumentSnapshot
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef DOCUMENTSNAPSHOT_HPP
+#define DOCUMENTSNAPSHOT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "EditBuffer.hpp"
+#include "EditDelta.hpp"
+
+class EditList;
+
+//! An unchanging version of a file's lines that other threads can read while it is edited.
+/*!
+ * The lines are copies of the file's EditBuffers, so long lines share their text with the file
+ * until it modifies them (see EditBuffer). They are held in blocks of a few hundred lines that
+ * are never modified once the snapshot is made. A snapshot of a file that differs from an
+ * earlier one in a range of lines shares the earlier snapshot's blocks outside that range, so
+ * taking it costs about as much as the lines modified and a pointer per block.
+ *
+ * A snapshot is made on the thread that owns the list. Thereafter any number of threads may
+ * read it at once without locking, since nothing in it changes. It may be destroyed on any
+ * thread; its lines are not allocated from the EditBuffer pool.
+ */
+class DocumentSnapshot {
+  public:
+    //! Copies all the lines of a list, including any pending lines.
+    /*!
+     * \throws std::bad_alloc if there is insufficient memory.
+     */
+    explicit DocumentSnapshot(EditList &data);
+
+    //! Copies a list whose lines differ from an earlier snapshot only by a change.
+    /*!
+     * The other lines are shared with the earlier snapshot, which is not changed.
+     *
+     * \throws std::bad_alloc if there is insufficient memory.
+     */
+    DocumentSnapshot(const DocumentSnapshot &earlier, EditList &data, const EditDelta &change);
+
+    //! Returns the number of lines.
+    long size() const { return line_count; }
+
+    //! Returns the text of a line, which must exist. It is valid as long as the snapshot.
+    std::string_view line(long line_number) const;
+
+  private:
+    using Block = std::vector<EditBuffer>;
+
+    std::vector<std::shared_ptr<const Block>> blocks; //!< The lines in order. None is empty.
+    std::vector<long> block_start; //!< The number of the first line of each block.
+    long line_count = 0;
+
+    void append(std::shared_ptr<const Block> block);
+    void append_lines(Block &pending, bool finished);
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*! \file    DocumentStats.hpp
+ *  \brief   Interface to class DocumentStats.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef DOCUMENTSTATS_HPP
+#define DOCUMENTSTATS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "EditDelta.hpp"
+
+class EditList;
+
+//! The size of a file's text, kept up to date as the file is modified.
+/*!
+ * The lines are divided into blocks of up to a few hundred lines, and the characters, words,
+ * and longest line of each block are kept. When lines are modified (see
+ * EditFile::take_modifications) only the blocks holding them are counted again, so the
+ * statistics of a large file cost little once they have been counted for the first time. The
+ * lines are counted only when the statistics are asked for.
+ */
+class DocumentStats {
+  public:
+    //! The statistics of some lines.
+    struct Totals {
+        long lines = 0;
+        std::uint64_t characters = 0; //!< Bytes of text, not counting the line breaks.
+        std::uint64_t words = 0;      //!< Runs of characters other than spaces and tabs.
+        std::size_t longest = 0;      //!< The length of the longest line in bytes.
+    };
+
+    //! Forgets the counts of the lines modified.
+    void invalidate(const EditDelta &change);
+
+    //! Counts the lines that have not been counted and returns the statistics of them all.
+    /*!
+     * The list's current point is moved.
+     *
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    const Totals &update(EditList &data);
+
+  private:
+    //! A run of lines. The lines of a stale block have not been counted.
+    struct Block {
+        Totals totals;
+        bool stale;
+    };
+
+    std::vector<Block> blocks; //!< The lines in order.
+    Totals sum;                //!< The statistics of the blocks that are not stale.
+    bool counted = false;      //!< =true if the lines have been divided into blocks.
+    bool longest_lost = false; //!< =true if sum.longest must be found again.
+
+    void count_block(EditList &data, long first, std::size_t block_index);
+};
+
+#endif
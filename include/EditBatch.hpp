@@ -0,0 +1,76 @@
+/*! \file    EditBatch.hpp
+ *  \brief   Interface to class EditBatch
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef EDITBATCH_HPP
+#define EDITBATCH_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Edits collected so that they can be made to a file together (see EditFile::apply_edits).
+/*!
+ * Each edit replaces the text between two positions with new text. Positions are a line and a
+ * byte offset in it, and refer to the file as it is before any of the edits are made, so that
+ * the edits need not allow for one another. Every line of the file is taken to end with a line
+ * break. The new text may contain '\n' to break lines, and a range that ends at offset zero of
+ * a later line takes in the line breaks before it. Offsets past the end of a line stand for the
+ * end of the line. Positions past the end of the file stand for the end of the file.
+ *
+ * The edits must not overlap, although several may insert text at one position. Their text is
+ * then inserted in the order the edits were added.
+ */
+class EditBatch {
+  public:
+    //! Replaces length bytes at offset in line with text.
+    void replace(long line, std::size_t offset, std::size_t length, std::string_view text)
+    {
+        replace(line, offset, line, offset + length, text);
+    }
+
+    //! Replaces the text from the first position up to the last position with text.
+    void replace(long first_line, std::size_t first_offset, long last_line,
+                 std::size_t last_offset, std::string_view text)
+    {
+        edits.push_back(
+            Edit{first_line, first_offset, last_line, last_offset, std::string(text)});
+    }
+
+    //! Replaces count lines starting at first with new_lines.
+    void replace_lines(long first, long count, const std::vector<std::string> &new_lines)
+    {
+        std::string text;
+        for (const std::string &line : new_lines) {
+            text.append(line);
+            text.push_back('\n');
+        }
+        replace(first, 0, first + count, 0, text);
+    }
+
+    //! Returns the number of edits collected.
+    std::size_t size() const { return edits.size(); }
+
+    //! Returns true if no edits have been collected.
+    bool empty() const { return edits.empty(); }
+
+    //! Forgets the edits collected.
+    void clear() { edits.clear(); }
+
+  private:
+    friend class EditFile;
+
+    struct Edit {
+        long first_line;
+        std::size_t first_offset;
+        long last_line;
+        std::size_t last_offset;
+        std::string text; //!< Replaces the text between the positions.
+    };
+
+    std::vector<Edit> edits; //!< In the order they were added.
+};
+
+#endif
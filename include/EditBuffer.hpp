@@ -8,6 +8,7 @@
 
 #include <cstddef>
 #include <string>
+#include <string_view>
 
 //! String-like class offering basic editing features.
 /*!
@@ -25,22 +26,64 @@
  * references or pointers to the internal state can be obtained via this interface. This design
  * is intentional to allow future flexibility; do not make changes that remove this flexibility
  * without appropriate consideration.
+ *
+ * The one exception is `view`, which returns a std::string_view of the text so that callers
+ * can examine it without making a copy. The view is only valid until the EditBuffer is next
+ * modified or destroyed. An implementation using external storage would need to materialize
+ * the text to support it. A view of part of the text can be taken as well, which on a long
+ * line being edited costs only as much as the part (see below).
+ *
+ * Short texts are stored inside the EditBuffer object itself so that typical lines of source
+ * code do not require a separate heap allocation.
+ *
+ * Copies of an EditBuffer share its heap allocation, if any, which is reference counted. The
+ * text is copied only when one of the sharing objects is modified. Thus copying a large block
+ * of lines, as when using the clipboard, does not copy the text of the lines.
+ *
+ * Long texts switch to a gap buffer representation when they are edited. The unused space is
+ * kept at the point of the most recent insertion or deletion so that repeated edits near the
+ * same offset (such as typing on a very long line) do not move the rest of the text. The gap
+ * is closed by `compact` and by operations that need the text to be contiguous.
+ *
+ * The text is UTF-8 and may contain tabs (see Utf8). Offsets count bytes while the cursor and
+ * the screen count columns, which depend on the distance between tab stops. Mapping between
+ * them is constant time for ASCII text without tabs (plain text). Otherwise an index of the
+ * characters occupying every 64th column is built the first time it is needed and kept until
+ * the text is modified or a different tab distance is used, so moving along a line or
+ * displaying part of it does not rescan the text before it.
  */
 class EditBuffer {
   public:
     // Constructors and destructor.
     EditBuffer();
     EditBuffer(const char *);
+    EditBuffer(const char *, std::size_t);
     EditBuffer(const EditBuffer &);
     EditBuffer &operator=(const EditBuffer &);
-    // EditBuffer( EditBuffer && );
-    // EditBuffer &operator=( EditBuffer && );
+    EditBuffer(EditBuffer &&) noexcept;
+    EditBuffer &operator=(EditBuffer &&) noexcept;
     ~EditBuffer();
 
+    // EditBuffer objects are allocated from a shared pool.
+    static void *operator new(std::size_t size);
+    static void operator delete(void *block, std::size_t size) noexcept;
+    static std::size_t memory_in_use();
+
     // Access.
     char operator[](std::size_t offset) const;
     std::size_t length() const;
     std::string to_string() const;
+    std::string_view view() const;
+    std::string_view view(std::size_t offset, std::size_t count) const;
+    std::size_t copy(char *destination, std::size_t count, std::size_t offset = 0) const;
+    void compact() const;
+    std::size_t storage() const;
+
+    // Columns.
+    bool is_plain() const;
+    std::size_t columns(unsigned tab) const;
+    std::size_t offset_of(std::size_t column, unsigned tab) const;
+    std::size_t column_of(std::size_t offset, unsigned tab) const;
 
     // Manipulation.
     void insert(char letter, std::size_t offset);
@@ -50,17 +93,49 @@ class EditBuffer {
     void append(char);
     void append(const char *);
     void append(const EditBuffer &);
+    void splice(std::size_t offset, std::size_t count, std::string_view text);
     EditBuffer subbuffer(std::size_t start_offset, std::size_t end_offset) const;
     void trim(std::size_t offset);
 
   private:
-    char *workspace;      //!< Pointer to buffer data.
-    std::size_t capacity; //!< Size of the raw buffer.
-    std::size_t size;     //!< Number of bytes in buffer, not including null.
-
-    // Invariant: If workspace == nullptr, capacity and size are zero; otherwise capacity > size.
-    // The buffer's contents are null terminated. The capacity must always contain space for
-    // the null byte.
+    //! Size of the internal buffer used for short texts (including the null byte).
+    static constexpr std::size_t local_capacity = 40;
+
+    //! Texts at least this long use a gap when they are edited.
+    static constexpr std::size_t gap_threshold = 256;
+
+    char *workspace;            //!< Pointer to buffer data (local or on the heap).
+    std::size_t capacity;       //!< Size of the raw buffer.
+    std::size_t size;           //!< Number of bytes in buffer, not including null.
+    char local[local_capacity]; //!< Storage for short texts.
+
+    mutable std::size_t gap_start;  //!< Offset of the gap in the workspace.
+    mutable std::size_t gap_length; //!< Size of the gap (zero if there is no gap).
+
+    struct ColumnIndex;
+    static ColumnIndex plain_index; //!< Stands for the index of every plain text.
+    mutable ColumnIndex *index;     //!< Locates the columns (nullptr until it is needed).
+
+    bool is_local() const { return workspace == local; }
+    static char *allocate(std::size_t capacity);
+    void release();
+    bool is_shared() const;
+    void unshare();
+    void share(const EditBuffer &existing);
+    void initialize(const char *text, std::size_t count);
+    void move_gap(std::size_t offset) const;
+    void grow_gap();
+    const ColumnIndex &column_index(unsigned tab) const;
+    void forget_columns() const;
+    void forget_columns(char letter) const;
+
+    // Invariant: capacity > size + gap_length. The buffer's contents are null terminated (the
+    // null byte is at offset size + gap_length). The capacity must always contain space for
+    // the null byte. If workspace == local then capacity is local_capacity and gap_length is
+    // zero, otherwise workspace points at a heap allocation of more than local_capacity bytes.
+    // A heap allocation shared by several EditBuffers never has a gap.
+    // The text is workspace[0 .. gap_start) followed by workspace[gap_start + gap_length ..
+    // size + gap_length).
 
     // TODO: Remove the null termination requirement in the invariant.
 
@@ -69,14 +144,6 @@ class EditBuffer {
     // meant that such a pointer could be safely passed to functions expecting a C style string.
     // However the current design of EditBuffer no longer provides a way to get such a pointer.
     // Thus the requirement to keep the text internally null terminated is now pointless.
-
-    // TODO: Remove the workspace == nullptr condition in the invariant.
-
-    // When Y was first written operator new returned nullptr on failure. This lead to the
-    // possibility of an EditBuffer with a nullptr workspace. However, modern C++ throws an
-    // exception if operator new fails. Thus I believe it is no longer possible for a fully
-    // constructed EditBuffer to have workspace == nullptr. The invariant should be reworded
-    // accordingly and the implementation adjusted to take advantage of the modern rules.
 };
 
 // ==============
@@ -85,8 +152,8 @@ class EditBuffer {
 
 inline EditBuffer::~EditBuffer()
 {
-    delete[] workspace;
-    return;
+    forget_columns();
+    release();
 }
 
 /*!
@@ -96,7 +163,7 @@ inline EditBuffer::~EditBuffer()
  */
 inline char EditBuffer::operator[](const std::size_t offset) const
 {
-    return (workspace[offset]);
+    return (offset < gap_start ? workspace[offset] : workspace[offset + gap_length]);
 }
 
 /*!
@@ -117,7 +184,21 @@ inline std::size_t EditBuffer::length() const
  */
 inline std::string EditBuffer::to_string() const
 {
-    return (std::string(workspace));
+    if (gap_length == 0)
+        return (std::string(workspace, size));
+    std::string result(workspace, gap_start);
+    result.append(workspace + gap_start + gap_length, size - gap_start);
+    return result;
+}
+
+/*!
+ * Returns a view of the text in this EditBuffer without copying it. The view is invalidated by
+ * any operation that modifies or destroys the EditBuffer. This closes the gap, if any.
+ */
+inline std::string_view EditBuffer::view() const
+{
+    compact();
+    return (std::string_view(workspace, size));
 }
 
 // ==============
@@ -0,0 +1,28 @@
+/*! \file    EditDelta.hpp
+ *  \brief   Definition of struct EditDelta
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef EDITDELTA_HPP
+#define EDITDELTA_HPP
+
+//! The lines of a file modified since one of its observers last looked (see EditFile).
+/*!
+ * The old_count lines starting at first have been replaced by new_count lines. The lines
+ * before and after them are as the observer last saw them, although those after may have
+ * moved. Several modifications are combined into the one range that covers them all.
+ */
+struct EditDelta {
+    long first;            //!< The first line replaced (-1 if nothing was modified).
+    long old_count;        //!< The number of lines replaced.
+    long new_count;        //!< The number of lines that replaced them.
+    unsigned long version; //!< The number of modifications ever made to the file.
+
+    //! Returns true if nothing was modified.
+    bool empty() const { return first < 0L; }
+
+    //! Returns the change in the number of lines.
+    long moved() const { return new_count - old_count; }
+};
+
+#endif
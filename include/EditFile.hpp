@@ -6,8 +6,37 @@
 #ifndef EDITFILE_HPP
 #define EDITFILE_HPP
 
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "EditDelta.hpp"
 #include "EditList.hpp"
 #include "FilePosition.hpp"
+#include "MarkSet.hpp"
+#include "UndoLog.hpp"
+
+class DocumentSnapshot;
+class EditBatch;
+
+//! A cursor in addition to a file's current point.
+struct Caret {
+    long line;
+    unsigned column;
+};
+
+inline bool operator==(const Caret &left, const Caret &right)
+{
+    return left.line == right.line && left.column == right.column;
+}
+
+inline bool operator<(const Caret &left, const Caret &right)
+{
+    return left.line < right.line || (left.line == right.line && left.column < right.column);
+}
 
 /*===================================================*/
 /*           Definition of class EditFile           */
@@ -20,6 +49,31 @@
  * manner. Several derived classes can be pasted together with multiple inheritance to give the
  * final, fully functional class.
  *
+ * The lines modified since the file was last displayed are tracked as a single range so the
+ * display can repaint only the rows that actually changed. Derived classes that modify
+ * file_data must report the lines they touch with mark_damaged() or mark_damaged_from().
+ *
+ * Similarly, derived classes must describe each modification to undo_log before making it,
+ * using record_text() for changes within a line and record_lines() for anything else. Those
+ * functions also note the lines modified for each of the file's observers: the recovery
+ * journal, the language server, the completion index, the plugins, the display's information
+ * derived from the text (rows of wrapped or folded lines, colors, procedures and occurrences),
+ * the snapshots, and the statistics. Modifications that are not recorded for undo must be
+ * noted with mark_modified() instead. An observer takes the lines modified since it last looked
+ * as an EditDelta, with take_modifications(), and can bring itself up to date from that alone.
+ *
+ * Many edits can be made together with apply_edits() (see EditBatch), which rebuilds the lines
+ * they touch in one pass and records them once for undo, rather than once for each edit.
+ *
+ * Other threads read the file through snapshots (see DocumentSnapshot). The file remembers the
+ * latest snapshot for as long as someone holds it, and a new one shares its unmodified lines.
+ *
+ * A file may have additional cursors (carets) besides its current point. Since they are kept
+ * as line numbers they are forgotten whenever a modification may move the lines they are on.
+ * Positions that must outlive modifications, such as the anchor of the block and the bookmark
+ * (see FileList::set_bookmark), are kept as marks instead (see MarkSet). The marks are moved
+ * as each modification is noted, before the next one is made.
+ *
  * In addition, this class knows enough about blocks to allow derived classes access to the
  * block information they need. Ideally, these block handling functions should be virtual with
  * implementations in Block_EditFile. However, Borland's Turbo C++ version 1.0 manifests
@@ -35,6 +89,19 @@ class EditFile {
     bool constructed_ok; //!< True if this object is ok.
 
   protected:
+    //! The users of the exact record of modifications (see take_modifications).
+    enum Observer {
+        RECOVERY, LANGUAGE_SERVER, COMPLETION, PLUGINS, DISPLAY, SNAPSHOTS, STATISTICS, MARKS,
+        FIELDS, WORDS, OBSERVERS
+    };
+
+    //! The lines modified since an observer last looked.
+    struct Modifications {
+        long top;  //!< First line modified (-1 if none).
+        long tail; //!< Lines at the end not modified.
+        long size; //!< The number of lines when the observer last looked.
+    };
+
     // Constructors and destructors.
     EditFile();
     virtual ~EditFile();
@@ -42,17 +109,90 @@ class EditFile {
     EditList file_data;         //!< The actual data in the file.
     FilePosition current_point; //!< This file's current point.
     bool block;                 //!< True when block mode is ON.
-    long anchor;                //!< Line number of one side of the block.
+    MarkSet marks;              //!< Positions that move with the lines they are on.
+    MarkSet::Mark anchor;       //!< One side of the block (see set_anchor).
+    bool columns;               //!< True if the block is rectangular.
+    unsigned anchor_column;     //!< Column of one side of a rectangular block.
     bool is_changed;            //!< True if data "changed."
+    long damage_top;            //!< First line modified since the last display (-1 if none).
+    long damage_bottom;         //!< Last line modified since the last display.
+    Modifications modified[OBSERVERS]; //!< Lines modified since each observer last looked.
+    unsigned long edit_version; //!< The number of modifications made.
+    UndoLog undo_log;           //!< Modifications that can be undone.
+    unsigned tab_stop;          //!< Distance between tab stops (at least one).
+    std::vector<Caret> carets;  //!< Additional cursors on existing lines, in order.
+    std::weak_ptr<const DocumentSnapshot> latest_snapshot; //!< The last snapshot taken.
+    long virtual_tail;          //!< Lines at the end added by extend_to_line (see saved_size).
+    long virtual_first;         //!< Where those lines start while that is known (else -1).
 
     void erase();
     bool extend_to_line(long);
     bool built_ok();
 
+    void mark_damaged(long first_line, long last_line);
+    //! Records that every line from first_line to the end of the file may have moved.
+    void mark_damaged_from(long first_line) { mark_damaged(first_line, LONG_MAX); }
+    //! Forgets the recorded damage. Used once the display reflects the file's data.
+    void clear_damage() { damage_top = damage_bottom = -1L; }
+
+    //! Notes that lines from first on, except for the last tail lines, are being modified.
+    /*!
+     * Unlike the damage this must be exact since the lines are journaled for recovery (see
+     * DiskEditFile::checkpoint). Either bound may be given before or after the modification.
+     */
+    void mark_modified(long first, long tail)
+    {
+        if (!marks.empty())
+            move_marks();
+        if (virtual_tail != 0 || virtual_first >= 0)
+            note_virtual(first, tail);
+        ++edit_version;
+        for (Modifications &observed : modified) {
+            if (observed.top < 0L || tail < observed.tail)
+                observed.tail = tail;
+            if (observed.top < 0L || first < observed.top)
+                observed.top = first;
+        }
+    }
+    EditDelta take_modifications(Observer observer);
+    void move_marks();
+    void set_anchor(long line);
+    long anchor_line();
+    void note_virtual(long first, long tail);
+    long trailing_virtual();
+    long saved_size();
+
+    //! Records that removed, at column of line, is about to be replaced by inserted.
+    void record_text(long line, std::size_t column, std::size_t old_length,
+                     std::string_view removed, std::string_view inserted)
+    {
+        mark_modified(line, std::max(file_data.size() - line - 1, 0L));
+        undo_log.record_text(
+            file_data, current_point, line, column, old_length, removed, inserted);
+    }
+    //! Records that count lines starting at first are about to be replaced. Moves file_data.
+    void record_lines(long first, long count)
+    {
+        mark_modified(first, std::max(file_data.size() - first - count, 0L));
+        undo_log.record_lines(file_data, current_point, first, count);
+    }
+
   public:
+    std::shared_ptr<const DocumentSnapshot> snapshot();
+    //! Returns the number of modifications ever made to the file (see EditDelta::version).
+    unsigned long version() const { return edit_version; }
+    bool apply_edits(const EditBatch &batch);
+
+    MarkSet::Mark add_mark(long line, unsigned column);
+    void remove_mark(MarkSet::Mark mark);
+    bool mark_position(MarkSet::Mark mark, Caret &position);
+
     // NOTE **** The following functions should really be virtual ****
 
     void block_limits(long &top_line, long &bottom_line);
+    void column_limits(unsigned &left_column, unsigned &right_column);
+    //! Returns true if block mode is on and the block is rectangular.
+    bool column_block() { return block && columns; }
     void set_block_state(bool);
     bool get_block_state();
     bool top_of_block();
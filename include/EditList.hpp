@@ -6,26 +6,69 @@
 #ifndef EDITLIST_HPP
 #define EDITLIST_HPP
 
-#include "mylist.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
 
 class EditBuffer;
 
+//! A source of lines that are appended to an EditList only when they are first needed.
+/*!
+ * Huge files are loaded this way so that the editor can show the first lines at once.
+ */
+class PendingLines {
+  public:
+    virtual ~PendingLines() = default;
+
+    //! Returns the next line (dynamically allocated) or nullptr if there are no more.
+    virtual EditBuffer *next_line() = 0;
+
+    //! Returns the number of lines that next_line() has yet to return.
+    virtual long remaining() = 0;
+
+    //! Returns true if the lines are taken from a file on disk rather than held in memory.
+    virtual bool is_mapped() const { return false; }
+};
+
 //! List of pointers to EditBuffer objects.
 /*!
- *  This class is a wrapper around List that implements a list of pointers to EditBuffer
- *  objects. The EditBuffers pointed at by the elements of this list must be dynamically
- *  allocated. They should not be shared between two instances of EditList, except perhaps
- *  temporarily. The destructor of EditList deletes all the pointers on the list as a service.
+ *  This class implements a list of pointers to EditBuffer objects. The EditBuffers pointed at
+ *  by the elements of this list must be dynamically allocated. They should not be shared
+ *  between two instances of EditList, except perhaps temporarily. The destructor of EditList
+ *  deletes all the pointers on the list as a service.
+ *
+ *  Like List, an EditList maintains a "current point." However, the pointers are stored in a
+ *  sequence of bounded chunks rather than in a linked list. The chunk sizes are kept in a
+ *  Fenwick (binary indexed) tree so that `jump_to` can locate the chunk holding any line in
+ *  logarithmic time and then index into the chunk directly. Insertions and deletions touch a
+ *  single chunk and update the tree in logarithmic time. Only splitting or merging chunks,
+ *  which happens at most once per several hundred edits, rebuilds the tree. Moving the current
+ *  point with `next` and `previous` remains a constant time operation. Ranges of items are
+ *  moved between lists with `splice_out` and `splice_in`, which transfer whole chunks.
  *
- *  Note that the underlying List template allows one to put nullptr pointers on the list. However,
- *  EditList do not allow this, trading in generality for an easier interface. In effect,
- *  EditList removes a level of indirection allowing its clients to deal with pointers to
- *  EditBuffers rather than pointers to pointers to EditBuffers.
+ *  A list may also have pending lines (see PendingLines) logically following its last item.
+ *  They are appended in batches when the current point first reaches them. Thus traversing a
+ *  huge file only converts the lines actually visited.
+ *
+ *  A list may also keep most of its chunks compressed (see `set_warm_limit`). The lines of a
+ *  compressed chunk are stored as one block of compressed text and have no EditBuffers. A
+ *  chunk is expanded when the current point reaches it, and the chunks visited least recently
+ *  are compressed again to stay within the limit. Pointers to the EditBuffers of a chunk
+ *  expanded this way are thus only valid until a few more chunks have been visited.
+ *
+ *  Empty lines may be appended without EditBuffers (see `append_blank`), so that lines past
+ *  the end of a file cost almost nothing until they are used. Their chunks are expanded like
+ *  compressed ones, but `read_next` passes over them without expanding them.
+ *
+ *  EditList does not allow nullptr pointers on the list, trading in generality for an easier
+ *  interface. Clients deal with pointers to EditBuffers rather than pointers to pointers to
+ *  EditBuffers.
  */
-class EditList : private List<EditBuffer *> {
+class EditList {
   public:
-    // lint -e{1509} The base class is private so virtualness of its destructor is not
-    // important.
+    EditList();
+
     //! Destructor
     /*!
      * Deletes all the EditBuffers pointed at by the elements of the list. Be sure no EditBuffer
@@ -33,56 +76,148 @@ class EditList : private List<EditBuffer *> {
      */
     virtual ~EditList() { clear(); }
 
+    // EditLists own their EditBuffers so copying them is not supported.
+    EditList(const EditList &) = delete;
+    EditList &operator=(const EditList &) = delete;
+
     //! Returns the next EditBuffer* in the list.
     /*!
      * \return nullptr if there are no other elements.
      */
     EditBuffer *next()
     {
-        EditBuffer *const *const result = List<EditBuffer *>::next();
-        return (result == nullptr ? nullptr : *result);
+        if (index == item_count && !supply(index))
+            return nullptr;
+
+        EditBuffer *result = chunks[chunk][offset];
+        if (result == nullptr)
+            result = expand(chunk)[offset];
+        ++index;
+        if (++offset == chunks[chunk].size()) {
+            chunks[chunk].touched = clock;
+            ++chunk;
+            offset = 0;
+        }
+        return result;
     }
 
-    //! Returns the previous EditBuffer* in the list.
+    //! Returns the next EditBuffer* in the list for reading only.
     /*!
+     * Unlike next() this does not make EditBuffers for the lines added by append_blank. Each
+     * of those lines is returned as the same empty EditBuffer, which must not be modified.
+     *
      * \return nullptr if there are no other elements.
      */
-    EditBuffer *previous()
+    const EditBuffer *read_next()
     {
-        EditBuffer *const *const result = List<EditBuffer *>::previous();
-        return (result == nullptr ? nullptr : *result);
+        if (index == item_count || !chunks[chunk].blank)
+            return next();
+        ++index;
+        if (++offset == chunks[chunk].size()) {
+            chunks[chunk].touched = clock;
+            ++chunk;
+            offset = 0;
+        }
+        return blank_line();
     }
 
-    //! Inserts a new EditBuffer* before the list's current point.
+    //! Returns the previous EditBuffer* in the list.
     /*!
-     * \param item A pointer to a dynamically allocated EditBuffer to be added to the list
-     * before the list's current point.
-     * \return The same pointer it is given.
-     * \throws std::bad_alloc if insufficient memory.
+     * \return nullptr if there are no other elements.
      */
-    EditBuffer *insert(EditBuffer *const item)
+    EditBuffer *previous()
     {
-        EditBuffer *const *const result = List<EditBuffer *>::insert(item);
-        return (*result);
+        if (index == 0)
+            return nullptr;
+
+        if (offset == 0) {
+            if (chunk < chunks.size())
+                chunks[chunk].touched = clock;
+            --chunk;
+            offset = chunks[chunk].size();
+        }
+        --offset;
+        --index;
+        EditBuffer *const result = chunks[chunk][offset];
+        return result != nullptr ? result : expand(chunk)[offset];
     }
 
+    EditBuffer *insert(EditBuffer *item);
+    void erase();
+    void clear();
+    void jump_to(long new_index);
+
     //! Returns the EditBuffer* at the list's current point.
+    /*!
+     * \return nullptr if the current point is just past the end of the list.
+     */
     EditBuffer *get()
     {
-        EditBuffer *const *const result = List<EditBuffer *>::get();
-        return (result == nullptr ? nullptr : *result);
+        if (index == item_count && !supply(index))
+            return nullptr;
+        EditBuffer *const result = chunks[chunk][offset];
+        return result != nullptr ? result : expand(chunk)[offset];
     }
 
-    void clear();
-
     //! Moves the list's current point to just past the end.
-    void set_end() { List<EditBuffer *>::jump_to(size()); }
+    void set_end() { jump_to(size()); }
+
+    //! Returns the index of the current point.
+    long current_index() const { return index; }
+
+    //! Returns the number of EditBuffers in the list, including any pending lines.
+    long size() const { return item_count + (pending ? pending->remaining() : 0L); }
+
+    //! Returns true if none of the lines are in memory, all being pending in a file on disk.
+    bool all_mapped() const { return item_count == 0 && pending && pending->is_mapped(); }
+
+    void append_blank(long count);
+    void set_pending(std::unique_ptr<PendingLines> source);
+    void splice_out(long count, EditList &destination);
+    void splice_in(EditList &source);
+    void set_warm_limit(std::size_t chunk_count);
+
+  private:
+    //! A run of consecutive items.
+    /*!
+     * The items of a compressed chunk are all nullptr and its lines are held in packed
+     * instead. Each line is preceded by its length (seven bits per byte, low bits first). The
+     * items of a blank chunk are also nullptr but its lines are all empty and nothing is held.
+     */
+    struct Chunk : std::vector<EditBuffer *> {
+        using std::vector<EditBuffer *>::vector;
+        std::string packed;        //!< The compressed lines (empty unless compressed).
+        std::size_t text_size = 0; //!< The size of the lines before they were compressed.
+        unsigned long touched = 0; //!< The value of clock when the chunk was last visited.
+        bool blank = false;        //!< =true if the lines are empty and have no EditBuffers.
+        bool compressed() const { return !packed.empty() || blank; }
+    };
+
+    std::vector<Chunk> chunks;       //!< The list's contents in order. No chunk is empty.
+    std::vector<long> chunk_tree;    //!< Fenwick tree of chunk sizes (one based).
+    bool tree_valid;                 //!< False if chunk_tree must be rebuilt before use.
+    long item_count;                 //!< Number of items on the list ( >= 0).
+    long index;                      //!< Index of current point ( >= 0).
+    std::size_t chunk;               //!< Chunk of the current point (chunks.size() at end).
+    std::size_t offset;              //!< Offset of the current point in its chunk.
+    std::unique_ptr<PendingLines> pending; //!< Lines following the last item, if any.
+    std::size_t warm_limit;          //!< Most chunks left uncompressed (zero for no limit).
+    unsigned long clock;             //!< Counts the chunks expanded (see Chunk::touched).
 
-    // Make these names from the private base class public.
-    using List<EditBuffer *>::current_index;
-    using List<EditBuffer *>::erase;
-    using List<EditBuffer *>::size;
-    using List<EditBuffer *>::jump_to;
+    void rebuild_tree();
+    void adjust_tree(std::size_t chunk_index, long delta);
+    void append_to_tree();
+    long tree_prefix(std::size_t count) const;
+    void split_chunk();
+    void merge_chunk(std::size_t chunk_index);
+    std::size_t find_chunk(long position, std::size_t &item_offset);
+    std::size_t split_at(long position);
+    void reposition(long new_index);
+    bool supply(long through_index);
+    Chunk &expand(std::size_t chunk_index);
+    static const EditBuffer *blank_line();
+    void compress_cold(std::size_t keep);
+    bool compress_chunk(std::size_t chunk_index);
 };
 
 #endif
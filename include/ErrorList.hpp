@@ -0,0 +1,79 @@
+/*! \file    ErrorList.hpp
+ *  \brief   Interface to the ErrorList abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef ERRORLIST_HPP
+#define ERRORLIST_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//! Encloses functions that collect the problems reported in the output of a build.
+/*!
+ * The output of the job started most recently (see JobList) is scanned as it arrives. Each
+ * line is compared with the formats used by gcc, clang, MSVC, and the GNU and Microsoft
+ * linkers. The comparisons are made directly, without regular expressions, since a build can
+ * produce a great deal of output. Lines in other formats are ignored. The problems found can be
+ * chosen from a list (error_list) or visited one after another (next_error).
+ */
+namespace ErrorList {
+
+    enum Severity { ERROR, WARNING, NOTE };
+
+    //! One problem reported by a compiler or linker.
+    struct Entry {
+        std::string file;    //!< The file with the problem (empty if none is named).
+        long line;           //!< The line of the problem (-1 if none is given). Zero based.
+        long column;         //!< The byte offset in the line (-1 if none is given).
+        Severity severity;
+        std::string message; //!< The compiler's description of the problem.
+    };
+
+    //! Recognizes a line of output that reports a problem.
+    /*!
+     * \return false if the line is not in any of the formats understood.
+     */
+    bool parse(std::string_view line, Entry &entry);
+
+    //! Forgets the problems found so far. Output scanned after this starts a new list.
+    void start();
+
+    //! Scans more output. A line left incomplete is scanned once the rest of it arrives.
+    void scan(std::string_view text);
+
+    //! Scans the last line of the output, even though it has no line break.
+    void finish();
+
+    //! Returns the number of problems found.
+    long count();
+
+    //! Returns one of the problems found.
+    const Entry &entry(long index);
+
+    //! Formats a problem as a compiler would, shortened to at most width characters.
+    std::string describe(const Entry &entry, std::size_t width);
+
+    //! Returns the index of the problem last visited (-1 if none has been).
+    long current();
+
+    //! Returns the index of the first error or warning after the one last visited, if any.
+    /*!
+     * The search wraps around to the start of the list. Notes are skipped.
+     *
+     * \return -1 if the list holds no errors or warnings.
+     */
+    long next();
+
+    //! Visits a problem, making its file active with the cursor where the problem is.
+    /*!
+     * The file is loaded if necessary. The problem's description is displayed.
+     *
+     * \return false if the file could not be loaded.
+     */
+    bool jump(long index);
+
+} // namespace ErrorList
+
+#endif
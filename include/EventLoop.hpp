@@ -0,0 +1,85 @@
+/*! \file    EventLoop.hpp
+ *  \brief   Interface to the EventLoop abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef EVENTLOOP_HPP
+#define EVENTLOOP_HPP
+
+#include <functional>
+
+#include <screen/environ.hpp>
+
+//! Encloses functions that dispatch the work done while the editor waits for a keystroke.
+/*!
+ * The keyboard handler calls `wait_for_key` instead of blocking on the terminal. Until a key is
+ * pressed the loop runs, all on the main thread:
+ *
+ * - Callbacks posted by other threads (for example, to report that a worker has finished).
+ * - Timers that have come due.
+ * - Callbacks for sources (pipes, change notifications, and the like) that are ready.
+ * - Idle tasks, a slice at a time, when there is nothing else to do.
+ *
+ * When there is nothing at all to do the thread sleeps until the terminal, a source, a post, or
+ * the next timer wakes it. Callbacks may use the screen and the file list freely but should
+ * return promptly since keystrokes are not read while they run.
+ */
+namespace EventLoop {
+
+    typedef std::function<void()> Callback;
+
+    //! Something whose readiness can be waited for: a descriptor or a waitable handle.
+#if eOPSYS == ePOSIX
+    typedef int Source;
+#elif eOPSYS == eWINDOWS
+    typedef void *Source;
+#endif
+
+    //! Runs the callback on the main thread soon. May be called from any thread.
+    void post(Callback callback);
+
+    //! Runs the callback after the given delay (and every delay thereafter if repeat is true).
+    /*!
+     * \return An identifier for cancel_timer. It is never zero.
+     */
+    unsigned add_timer(long milliseconds, Callback callback, bool repeat = false);
+
+    //! Stops a timer. Unknown identifiers (such as zero) are ignored.
+    void cancel_timer(unsigned id);
+
+    //! Runs the callback whenever the source is ready, until remove_source is called.
+    void add_source(Source source, Callback callback);
+
+    //! Stops waiting for a source.
+    void remove_source(Source source);
+
+    //! Adds a task that is called repeatedly while the editor is otherwise idle.
+    /*!
+     * The task does a small amount of work (a few milliseconds at most) each time it is called.
+     * It returns false when it has nothing to do, in which case it is not called again until
+     * some other event (a keystroke, timer, post, or source) has been handled.
+     */
+    void add_idle(std::function<bool()> task);
+
+    //! Dispatches events until a keystroke is available.
+    void wait_for_key();
+
+    //! Runs the posted callbacks, the timers that are due, and the sources that are ready.
+    /*!
+     * Nothing is waited for and idle tasks are not run. A macro that runs for long calls this
+     * between commands now and then so that the work finished in the background is taken in.
+     */
+    void run_pending();
+
+    //! Runs what is ready as run_pending does, first sleeping until there is something.
+    /*!
+     * The sleep ends early if a keystroke is available. This is used while a macro is
+     * suspended (see WordSource::ready).
+     *
+     * \param milliseconds The longest time to sleep.
+     */
+    void wait_for_event(int milliseconds);
+
+} // namespace EventLoop
+
+#endif
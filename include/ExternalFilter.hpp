@@ -0,0 +1,42 @@
+/*! \file    ExternalFilter.hpp
+ *  \brief   Interface to class ExternalFilter
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef EXTERNALFILTER_HPP
+#define EXTERNALFILTER_HPP
+
+#include <string>
+#include <string_view>
+
+//! Runs a shell command with its standard streams connected to the editor by pipes.
+/*!
+ * The command is started directly by the shell (/bin/sh on POSIX, cmd.exe on Windows) rather
+ * than through std::system so no temporary files are needed. Its standard input is fed from
+ * memory while its standard output and standard error are collected, all concurrently, so a
+ * command that produces output before reading all of its input can't deadlock. The display is
+ * left as it is; the command's streams never reach the terminal.
+ */
+class ExternalFilter {
+  public:
+    explicit ExternalFilter(std::string command);
+
+    bool run(std::string_view input);
+
+    //! Returns the text the command wrote to its standard output.
+    const std::string &output() const { return output_text; }
+
+    //! Returns the text the command wrote to its standard error.
+    const std::string &errors() const { return error_text; }
+
+    //! Returns the command's exit status (-1 if it did not exit normally).
+    int status() const { return exit_status; }
+
+  private:
+    std::string command;    //!< The command given to the shell.
+    std::string output_text;
+    std::string error_text;
+    int exit_status;
+};
+
+#endif
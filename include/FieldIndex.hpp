@@ -0,0 +1,71 @@
+/*! \file    FieldIndex.hpp
+ *  \brief   Interface to class FieldIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FIELDINDEX_HPP
+#define FIELDINDEX_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "EditDelta.hpp"
+
+class EditBuffer;
+
+//! Where the fields of the lines of a table (such as a CSV file) start.
+/*!
+ * Fields are separated by a delimiter character. A delimiter between double quotes is part of
+ * its field, as in CSV files; the quotes themselves are kept in the field. A line is scanned
+ * only when it is first asked about (typically because it is shown), 16 characters at a time
+ * where SSE2 is available, and its fields are remembered until it is modified. Thus even a huge
+ * table costs only the lines that have been looked at. Each line is scanned by itself, so a
+ * quoted field can't span lines.
+ *
+ * The index also keeps the widest each field has been on the lines scanned. When the table is
+ * aligned its lines are shown (see render) with each field padded to that width, and the
+ * delimiter (shown as a space if it is a tab) followed by a space.
+ */
+class FieldIndex {
+  public:
+    explicit FieldIndex(char delimiter) : separator(delimiter) {}
+
+    //! Returns the character that separates the fields.
+    char delimiter() const { return separator; }
+
+    static void split(std::string_view text, char delimiter, std::vector<std::size_t> &starts);
+    static std::string_view field(std::string_view text, char delimiter, std::size_t number);
+
+    const std::vector<std::size_t> &starts(long line, const EditBuffer &text, unsigned tab);
+
+    //! Returns true if the fields are aligned when the lines are shown.
+    bool is_aligned() const { return aligned; }
+    void set_aligned(bool flag) { aligned = flag; }
+
+    bool prepare(long line, const EditBuffer &text, unsigned tab);
+    void render(long line, const EditBuffer &text, unsigned tab, std::string &row);
+    unsigned shown_column(long line, const EditBuffer &text, unsigned column, unsigned tab);
+    void invalidate(const EditDelta &change);
+
+  private:
+    //! The lines whose fields are remembered are forgotten when there are this many.
+    static constexpr std::size_t maximum_lines = 4096;
+
+    struct Line {
+        std::vector<std::size_t> starts; //!< The offset of each field (there is at least one).
+        std::vector<unsigned> widths;    //!< The number of columns each field takes.
+    };
+
+    char separator;
+    bool aligned = false;
+    std::map<long, Line> lines;  //!< The lines scanned since they were last modified.
+    std::vector<unsigned> widest; //!< The widest each field has been.
+    bool widened = false;         //!< True if a field has widened since prepare last said so.
+
+    const Line &scan(long line, const EditBuffer &text, unsigned tab);
+};
+
+#endif
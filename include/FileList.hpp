@@ -6,6 +6,8 @@
 #ifndef FILELIST_HPP
 #define FILELIST_HPP
 
+#include <cstddef>
+
 class YEditFile;
 
 //! Encloses functions that manipulate the file list abstract object.
@@ -34,9 +36,15 @@ namespace FileList {
     //! Returns a reference to the active YEditFile.
     YEditFile &active_file();
 
+    //! Returns true if the given file is in the list.
+    bool contains(const YEditFile *file);
+
     //! Returns the number of files currently in the list.
     unsigned count();
 
+    //! Returns the file at the given position in the list (zero based) or nullptr.
+    YEditFile *file(unsigned index);
+
     //! Inserts active file into specified file.
     /*!
      * This is a somewhat strange function. Is there a better (more general) way to handle the
@@ -48,6 +56,10 @@ namespace FileList {
     void kill();
 
     //! Activates a currently loaded file with the given name.
+    /*!
+     * Names are matched by their name_key, so a name that differs from the one under which the
+     * file was loaded (by case, or by another path to the same file) still finds it.
+     */
     bool lookup(const char *name);
 
     //! Makes the next file in the list the focus of user interaction (active).
@@ -62,13 +74,39 @@ namespace FileList {
     //! Makes the previous file in the list the focus of user interaction (active).
     void previous();
 
+    //! Restores the unsaved changes left by editors that ended abnormally.
+    /*!
+     * The files concerned are loaded if necessary. The restored changes are left unsaved.
+     */
+    void recover_files();
+
+    //! Makes the file that was active before the active one active again.
+    /*!
+     * Repeated use switches back and forth between the two files used most recently. Returns
+     * false if no other file has been active.
+     */
+    bool recent();
+
     //! Read more recent files from disk.
     bool reload_files();
 
     //! Save all files that have changed and resets their changed flag.
     bool save_changes();
 
+    //! Limits the memory held by the text of files, or removes the limit if bytes is zero.
+    /*!
+     * While the lines in memory (see EditBuffer::memory_in_use) take more than the limit, the
+     * lines of unchanged files that are not shown in any window are discarded, those used
+     * least recently first. Their lines are mapped from disk again as they are needed (see
+     * DiskEditFile::evict). The limit is checked while the editor waits for keys.
+     */
+    void set_memory_budget(std::size_t bytes);
+
     //! Remembers current file and position.
+    /*!
+     * While the file is loaded the position is kept as a mark (see EditFile::add_mark), so it
+     * stays on its line as lines are inserted or deleted above it.
+     */
     void set_bookmark();
 
     //! Exchanges bookmark and current point.
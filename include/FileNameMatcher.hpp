@@ -7,6 +7,8 @@
 #define FILENAMEMATCHER_HPP
 
 #include <ctime>
+#include <string>
+#include <vector>
 
 #include <screen/environ.hpp>
 
@@ -57,6 +59,9 @@ class FileNameMatcher {
     //! Returns pointer to next matching name. Full path required.
     char *next();
 
+    //! Returns all the names of regular files matching a wildcard spec, sorted.
+    static std::vector<std::string> expand(const char *wild_name);
+
     // Return information on file after successful call to next().
     int actual_attribute() { return (int)NORMAL; }
     time_t modify_time();
@@ -109,6 +114,9 @@ class FileNameMatcher {
     //! Returns pointer to next matching name. Full path required.
     char *next();
 
+    //! Returns all the names matching a wildcard spec.
+    static std::vector<std::string> expand(const char *wild_name);
+
     //! Return information on file after successful call to next().
     int actual_attribute() { return (int)file_data.dwFileAttributes; }
     unsigned modify_time() { return file_data.ftLastWriteTime.dwHighDateTime; }
@@ -155,6 +163,9 @@ class FileNameMatcher {
     //! Returns pointer to next matching name. Full path required.
     char *next();
 
+    //! Returns all the names matching a wildcard spec.
+    static std::vector<std::string> expand(const char *wild_name);
+
     //! Return information on file after successful call to next().
     int actual_attribute() { return (int)file_data.attrib; }
     unsigned modify_time() { return file_data.wr_time; }
@@ -12,10 +12,9 @@
  * the file is column zero. Line numbers are of type long (negative numbers treated like zero),
  * and column numbers are of type unsigned.
  *
- * This implementation is simple in that the dimensions of the window are hard coded to satisfy
- * Ys needs. Obviously one can do better than that. In a future version, FilePosition objects
- * may be able to deal with various sized windows. Certainly, this situation will need
- * correcting before Y could become multiwindowed (should that ever become desirable).
+ * The window initially fills the screen except for its border. Its size can be changed with
+ * set_size() so that several FilePositions can view files in windows that share the screen
+ * (see WindowList).
  */
 
 #ifndef FILEPOSITION_HPP
@@ -28,6 +27,7 @@ class FilePosition {
     unsigned c_column; //!< Column number of current point (0..whatever).
     long w_line;       //!< Line number of top line in display.
     unsigned w_column; //!< Column number of left column in display.
+    unsigned w_row;    //!< Row of the top line at the top of the display if wrapping.
 
     int w_heigth; //!< Dimensions of the window area were printing is allowed.
     unsigned w_width;
@@ -42,6 +42,12 @@ class FilePosition {
     unsigned cursor_column() const { return c_column; }
     long window_line() const { return w_line; }
     unsigned window_column() const { return w_column; }
+    unsigned window_row() const { return w_row; }
+    int window_height() const { return w_heigth; }
+    unsigned window_width() const { return w_width; }
+
+    // Window size. The window is moved if necessary so that the cursor stays inside it.
+    void set_size(int height, unsigned width);
 
     // Cursor relative jumping (-1 implies a window sized jump).
     void page_down(long jump_distance = -1L);
@@ -59,6 +65,12 @@ class FilePosition {
     void cursor_right(unsigned count = 1);
     void cursor_left(unsigned count = 1);
 
+    // Window placement when lines are wrapped or folded (see WrapIndex). It is not checked.
+    void set_window(long new_line, unsigned new_row);
+
+    // Window placement when columns are shown elsewhere (see FieldIndex). It is not checked.
+    void set_window_column(unsigned new_column) { w_column = new_column; }
+
     // Cursor absolute jumping.
     void jump_to_line(long new_line);
     void jump_to_column(unsigned new_column);
@@ -0,0 +1,45 @@
+/*! \file    FileWatcher.hpp
+ *  \brief   Interface to the FileWatcher abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FILEWATCHER_HPP
+#define FILEWATCHER_HPP
+
+#include <functional>
+#include <string>
+
+//! Encloses functions that notice when files are changed by other programs.
+/*!
+ * The operating system's change notifications (inotify on Linux, kqueue on the BSDs and macOS,
+ * and change notification handles on Windows) are received through the EventLoop, so files are
+ * marked stale while the editor waits for keystrokes without examining any file that hasn't
+ * changed. A stale file may not really be different; its time stamp should still be checked.
+ *
+ * Files that can't be watched (on other systems, or when the notifications can't be set up)
+ * are always considered stale so that callers fall back to checking every file.
+ */
+namespace FileWatcher {
+
+    //! Starts watching the named file. It need not exist yet.
+    void watch(const std::string &name);
+
+    //! Stops watching the named file.
+    void forget(const std::string &name);
+
+    //! Returns true if the file may have changed since it was last marked checked.
+    bool stale(const std::string &name);
+
+    //! Notes that the file's time stamp has been examined.
+    void checked(const std::string &name);
+
+    //! Sets the function called, on the main thread, after watched files have changed.
+    /*!
+     * Changes are collected for a short time first so that a program writing a file in
+     * several steps causes a single call.
+     */
+    void set_change_handler(std::function<void()> handler);
+
+} // namespace FileWatcher
+
+#endif
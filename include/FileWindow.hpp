@@ -0,0 +1,52 @@
+/*! \file    FileWindow.hpp
+ *  \brief   Interface to class FileWindow
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FILEWINDOW_HPP
+#define FILEWINDOW_HPP
+
+#include <screen/Manager.hpp>
+#include <screen/Window.hpp>
+
+#include "FilePosition.hpp"
+#include "YEditFile.hpp"
+
+//! A managed window showing a YEditFile.
+/*!
+ * Several windows can show the same file; they share its text and differ only in their
+ * positions. The window's image includes its border, which it draws itself so that it can show
+ * the file name and other information in it. The image is painted by paint() rather than by
+ * get_image() so that the manager only composites images that are already up to date.
+ *
+ * The window the user is working in shows its file at the file's own current point. The others
+ * keep their own positions, remembered when they were last active.
+ */
+class FileWindow : public scr::Window {
+  public:
+    FileWindow(scr::Manager *manager, YEditFile *file, const FilePosition &position, int row,
+               int column, int width, int height);
+
+    //! Returns the file shown in the window (nullptr if that file has been removed).
+    YEditFile *file() const { return viewed; }
+
+    //! Returns the position in the file where the window was when it was last active.
+    const FilePosition &position() const { return point; }
+
+    void show(YEditFile *file, const FilePosition &position);
+    void forget(const YEditFile *file);
+    void paint(bool active);
+
+    int cursor_row() override { return cursor_offset_row; }
+    int cursor_column() override { return cursor_offset_column; }
+    bool resize(int new_width, int new_height) override;
+
+  private:
+    YEditFile *viewed;              //!< The file shown (nullptr if it has been removed).
+    FilePosition point;             //!< The position in the file when the window is inactive.
+    YEditFile::DisplayState shown;  //!< What the image shows.
+    int cursor_offset_row;          //!< Cursor coordinates relative to the image.
+    int cursor_offset_column;
+};
+
+#endif
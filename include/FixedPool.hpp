@@ -0,0 +1,52 @@
+/*! \file    FixedPool.hpp
+ *  \brief   Interface to class FixedPool
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FIXEDPOOL_HPP
+#define FIXEDPOOL_HPP
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+//! Allocator for many small objects of the same size.
+/*!
+ * A FixedPool carves large slabs of memory into fixed size blocks. Allocating and releasing a
+ * block is a matter of popping it from or pushing it onto a free list. Compared to using the
+ * general purpose allocator for each object this avoids per-allocation overhead and keeps
+ * objects that are allocated together (such as the lines of a file being loaded) close
+ * together in memory.
+ *
+ * Released blocks are retained by the pool for reuse; the slabs are only returned to the
+ * system when the pool itself is destroyed. The pool is safe to use from multiple threads.
+ */
+class FixedPool {
+  public:
+    explicit FixedPool(std::size_t object_size, std::size_t blocks_per_slab = 1024);
+    ~FixedPool();
+
+    FixedPool(const FixedPool &) = delete;
+    FixedPool &operator=(const FixedPool &) = delete;
+
+    void *allocate();
+    void deallocate(void *block);
+
+    //! Returns the number of blocks currently allocated from the pool.
+    std::size_t allocated() const { return in_use; }
+
+  private:
+    //! Overlays a block that is on the free list.
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    std::size_t block_size;    //!< Size of each block (a multiple of the maximum alignment).
+    std::size_t slab_blocks;   //!< Number of blocks in each slab.
+    std::vector<char *> slabs; //!< All slabs obtained from the system.
+    FreeBlock *free_list;      //!< Blocks available for allocation.
+    std::size_t in_use;        //!< Number of blocks handed out.
+    std::mutex lock;           //!< Protects the free list.
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*! \file    FuzzyMatcher.hpp
+ *  \brief   Interface to class FuzzyMatcher.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef FUZZYMATCHER_HPP
+#define FUZZYMATCHER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "PathIndex.hpp"
+
+//! Ranks the paths in a PathIndex by how well they match an abbreviated name.
+/*!
+ * A path matches if the characters of the query appear in it in order, ignoring the case of
+ * ASCII letters. Matches score more when the characters are consecutive, start words, or lie
+ * in the file's name rather than its directories (see `score`). The best matches are kept in
+ * order, shortest paths first among equal scores.
+ *
+ * The work is incremental. When a character is added to the query only the paths that matched
+ * before are examined again, and paths added to the index since the last update are examined
+ * once each. Each update also stops when its time is up, so that typing stays responsive with
+ * very large indices. The ranking then covers the paths examined so far and a later update
+ * continues the work.
+ */
+class FuzzyMatcher {
+  public:
+    explicit FuzzyMatcher(std::size_t limit) : best_limit(limit) {}
+
+    void set_query(std::string_view new_query);
+    bool update(const PathIndex &index, std::chrono::steady_clock::duration budget);
+
+    //! Returns the indices of the best matching paths, best first.
+    const std::vector<std::size_t> &best() const { return ranked; }
+
+    //! Returns the number of paths that match the query.
+    std::size_t match_count() const { return matches.size(); }
+
+    static bool score(std::string_view path, std::string_view folded_path,
+                      std::string_view folded_query, int &points);
+
+  private:
+    struct Match {
+        int points;
+        std::uint32_t length;
+        std::uint32_t index;
+    };
+
+    std::size_t best_limit;          //!< Number of matches ranked.
+    std::string query;               //!< The query, with its letters in lower case.
+    std::uint64_t query_mask = 0;    //!< The characters in the query.
+    std::vector<Match> matches;      //!< Every path that matches, in no particular order.
+    std::size_t scanned = 0;         //!< Paths in the index examined for this query.
+    bool rescoring = false;          //!< True while the matches are checked again.
+    std::size_t rescored = 0;        //!< Number of matches checked again.
+    std::size_t kept = 0;            //!< Number of those that still match.
+    std::vector<std::size_t> ranked; //!< Indices of the best matches.
+
+    void scan(const PathIndex &index, std::size_t first, std::size_t last);
+    void rescore(const PathIndex &index, std::size_t last);
+    void rank();
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*! \file    HexImage.hpp
+ *  \brief   Interface to class HexImage
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef HEXIMAGE_HPP
+#define HEXIMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "MappedFile.hpp"
+
+//! The bytes of a file shown as rows of offsets, hexadecimal digits, and characters.
+/*!
+ * A file named hex:path is shown this way (see HEX_YEditFile) so that files that are not text
+ * can be viewed and patched without losing any of their bytes. The file is mapped into memory
+ * and each row is made from the mapping only when it is shown, so even a huge file opens at
+ * once. The bytes changed are kept in a sparse overlay until they are written, which is done
+ * in place. Thus the size of the file never changes and writing costs no more than the bytes
+ * changed. Note that the file must not be truncated by another program while it is mapped.
+ */
+class HexImage {
+  public:
+    //! The number of bytes on each row.
+    static constexpr unsigned row_bytes = 16;
+
+    //! A place on a row where a byte can be changed.
+    struct Cell {
+        std::uint64_t offset; //!< The byte's offset in the file.
+        bool character;       //!< =true if the byte is shown as a character, not as digits.
+        unsigned digit;       //!< Which digit, if not a character (0 for the high one).
+    };
+
+    //! What write did to the file.
+    enum WriteStatus {
+        WRITTEN,    //!< The file now holds the bytes changed.
+        NOT_OPENED, //!< The file could not be opened for output. It was not changed.
+        DAMAGED     //!< The write failed after some bytes may have been written.
+    };
+
+    HexImage();
+
+    static bool is_hex(const char *name);
+    static const char *path_of(const char *name);
+
+    bool open(const char *path);
+
+    //! Returns the number of bytes in the file.
+    std::uint64_t size() const { return image.size(); }
+
+    //! Returns the number of rows needed to show the file.
+    long rows() const { return static_cast<long>((size() + row_bytes - 1) / row_bytes); }
+
+    //! Returns the number of bytes changed since the file was opened or written.
+    std::size_t patched() const { return overlay.size(); }
+
+    unsigned char byte(std::uint64_t offset) const;
+    void patch(std::uint64_t offset, unsigned char value);
+    void render(long row, std::string &text) const;
+    bool locate(long row, unsigned column, Cell &cell) const;
+    unsigned column_of(const Cell &cell) const;
+    WriteStatus write(const char *path);
+
+  private:
+    MappedFile image;                               //!< The file as it was last written.
+    std::map<std::uint64_t, unsigned char> overlay; //!< The bytes changed since, by offset.
+    unsigned offset_digits;                         //!< Digits shown in each row's offset.
+
+    //! Returns the column of the first digit of the row's first byte.
+    unsigned digits_start() const { return offset_digits + 2; }
+
+    //! Returns the column of the row's first character.
+    unsigned characters_start() const { return digits_start() + 3 * row_bytes + 2; }
+};
+
+#endif
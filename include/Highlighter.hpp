@@ -0,0 +1,69 @@
+/*! \file    Highlighter.hpp
+ *  \brief   Interface to class Highlighter
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef HIGHLIGHTER_HPP
+#define HIGHLIGHTER_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "EditDelta.hpp"
+
+class EditList;
+
+//! The lexical features of a language that matter for syntax highlighting.
+struct Language {
+    const char *line_comment;    //!< Starts a comment ending with the line (nullptr if none).
+    const char *comment_start;   //!< Starts a comment that may span lines (nullptr if none).
+    const char *comment_end;     //!< Ends such a comment.
+    const char *quotes;          //!< The characters that delimit strings.
+    bool escapes;                //!< True if a backslash escapes a character in a string.
+    char directive;              //!< Starts a directive if first on a line ('\0' if none).
+    bool ignore_case;            //!< True if keywords are not case sensitive.
+    const char *const *keywords; //!< The keywords, sorted (and in lower case if ignore_case).
+    std::size_t keyword_count;   //!< The number of keywords.
+};
+
+extern const Language ada_language;
+extern const Language asm_language;
+extern const Language c_language;
+extern const Language pcd_language;
+extern const Language scala_language;
+
+//! Divides the lines of a file into tokens for display in different colors.
+/*!
+ * The lexer state at the end of every line (for example, "inside a comment") is cached so a
+ * line can be colored without examining the lines before it. States are computed only as far
+ * as the display needs them. When lines are modified the states from the first modified line
+ * are computed again. The old states of the unmodified lines after the modification are kept.
+ * Once a line ends in the same state as before, the states that follow are known to be correct
+ * and are not computed again.
+ */
+class Highlighter {
+  public:
+    enum Token : unsigned char { PLAIN, KEYWORD, COMMENT, STRING, NUMBER, DIRECTIVE };
+
+    Highlighter();
+
+    void invalidate(const EditDelta &change);
+    long update(const Language &language, EditList &data, long through_line);
+    void color_line(const Language &language, long line_number, std::string_view text,
+                    std::vector<Token> &tokens) const;
+
+  private:
+    typedef unsigned char State;
+    static constexpr State NORMAL = 0;     //!< Not inside anything that spans lines.
+    static constexpr State IN_COMMENT = 1; //!< Inside a block comment.
+
+    std::vector<State> states; //!< The state at the end of each line computed so far.
+    long valid;                //!< Number of leading states known to be correct.
+    long resume;               //!< First of the states kept from before a modification.
+
+    static State scan(const Language &language, std::string_view text, State state,
+                      Token *tokens);
+};
+
+#endif
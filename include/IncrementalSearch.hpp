@@ -0,0 +1,49 @@
+/*! \file    IncrementalSearch.hpp
+ *  \brief   Interface to the IncrementalSearch abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef INCREMENTALSEARCH_HPP
+#define INCREMENTALSEARCH_HPP
+
+#include <string>
+
+#include "SearchPattern.hpp"
+
+class YEditFile;
+
+//! Encloses the search that moves to the pattern as each character of it is typed.
+/*!
+ * Each pattern typed is a step on a stack. A literal pattern one character longer than the last
+ * is looked for from where the last was found, since each of its occurrences is also one of the
+ * shorter pattern, and not at all if the shorter one was not found. Deleting a character pops
+ * the stack back to a step whose outcome is already known, so nothing is searched again.
+ * Regular expressions don't have that property and are searched for from the start each time.
+ *
+ * The searching is done by an idle task (see EventLoop::add_idle) a megabyte at a time, so the
+ * keys typed are handled at once however large the file is. Work on a pattern that has been
+ * extended is simply continued by the longer one. The occurrences in the lines shown are
+ * highlighted while the search goes on (see YEditFile::show_matches), in place of whatever
+ * pattern was highlighted before.
+ */
+namespace IncrementalSearch {
+
+    //! Reads a pattern from the keyboard, moving the cursor to it as it is typed.
+    /*!
+     * Typing adds to the pattern, backspace takes the last character off (or goes back to the
+     * previous occurrence), the down arrow moves on to the next occurrence (going back to the
+     * top of the file after the last), and Enter or any other key ends the search at the
+     * occurrence found.
+     *
+     * \param file The file to search, from its cursor.
+     * \param mode How the pattern is interpreted.
+     * \param options The SearchPattern options with which it is compiled.
+     * \param text [out] The pattern typed.
+     * \return false if the search was cancelled with Esc. The cursor and window are then put
+     * back where they were.
+     */
+    bool run(YEditFile &file, SearchPattern::Mode mode, unsigned options, std::string &text);
+
+} // namespace IncrementalSearch
+
+#endif
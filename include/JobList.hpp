@@ -0,0 +1,34 @@
+/*! \file    JobList.hpp
+ *  \brief   Interface to the JobList abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef JOBLIST_HPP
+#define JOBLIST_HPP
+
+#include <string>
+
+//! Encloses functions that manage the external commands running in the background.
+/*!
+ * Each job's output streams into a read only file of its own on the file list. The output is
+ * gathered by `poll`, which the keyboard handler calls while it waits for keystrokes, so the
+ * editor remains usable while the commands run. Killing a job's file stops the job. The output
+ * of the latest job is also scanned for the problems a build reports (see ErrorList).
+ */
+namespace JobList {
+
+    //! Starts a command in the background and makes its output file active.
+    bool start(const std::string &command);
+
+    //! Adds any new output to the jobs' files. Returns true if the active file received some.
+    bool poll();
+
+    //! Returns the number of jobs still running.
+    unsigned count();
+
+    //! Returns a one line description of the running jobs for the status line.
+    const char *status();
+
+} // namespace JobList
+
+#endif
@@ -0,0 +1,115 @@
+/*! \file    Json.hpp
+ *  \brief   Interface to classes JsonValue and JsonParser
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! A JSON value: null, a boolean, a number, a string, an array, or an object.
+/*!
+ * Looking up a member that is missing (or indexing something that is not an array or object)
+ * yields null rather than failing, so nested members can be reached without checking each
+ * level. The members of an object are kept in order and found by a linear search, which suits
+ * the small objects exchanged with language servers.
+ */
+class JsonValue {
+  public:
+    enum Kind { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    JsonValue() : type(NUL), flag(false), amount(0.0) {}
+
+    Kind kind() const { return type; }
+    bool is_null() const { return type == NUL; }
+    bool is_number() const { return type == NUMBER; }
+    bool is_string() const { return type == STRING; }
+    bool is_array() const { return type == ARRAY; }
+    bool is_object() const { return type == OBJECT; }
+
+    //! Returns the value of a boolean (false for anything else).
+    bool boolean() const { return type == BOOLEAN && flag; }
+
+    //! Returns the value of a number, or the given default for anything else.
+    double number(double otherwise = 0.0) const { return type == NUMBER ? amount : otherwise; }
+
+    //! Returns the text of a string (empty for anything else).
+    const std::string &string() const { return text; }
+
+    //! Returns the number of elements of an array or members of an object.
+    std::size_t size() const { return elements.size(); }
+
+    //! Returns an element of an array (or the value of a member of an object) by position.
+    const JsonValue &operator[](std::size_t index) const;
+
+    //! Returns the value of a member of an object.
+    const JsonValue &operator[](const char *key) const;
+
+    //! Returns true if an object has the named member.
+    bool has(const char *key) const;
+
+  private:
+    friend class JsonParser;
+
+    Kind type;
+    bool flag;                       //!< BOOLEAN: The value.
+    double amount;                   //!< NUMBER: The value.
+    std::string text;                //!< STRING: The value.
+    std::vector<JsonValue> elements; //!< ARRAY: The elements. OBJECT: The values of members.
+    std::vector<std::string> keys;   //!< OBJECT: The names of the members.
+};
+
+//! Reads a JSON value from text that arrives a piece at a time.
+/*!
+ * Each call to feed continues from where the previous one stopped, so a large value is parsed
+ * as its text comes in rather than all at once when the last of it arrives. A number at the top
+ * level is only known to be complete when the character after it is seen.
+ */
+class JsonParser {
+  public:
+    JsonParser();
+
+    std::size_t feed(const char *data, std::size_t length);
+    void reset();
+
+    //! Returns true once a complete value has been read.
+    bool done() const { return complete; }
+
+    //! Returns true if the text is not valid JSON. Nothing more is read until reset.
+    bool failed() const { return broken; }
+
+    //! Returns the value read. Use only when done() is true.
+    JsonValue &value() { return result; }
+
+  private:
+    enum Expect { VALUE, FIRST_VALUE, FIRST_KEY, KEY, COLON, SEPARATOR };
+    enum Token { NONE, STRING, NUMBER, LITERAL };
+
+    Expect expect;                //!< What the next token must be.
+    Token token;                  //!< The kind of token being read, if any.
+    bool key_token;               //!< =true if the string being read names a member.
+    bool escape;                  //!< =true after a backslash in a string.
+    int hex_digits;               //!< Digits of a \u escape still to come (0 if none).
+    unsigned code_point;          //!< The value of the \u escape being read.
+    unsigned high_surrogate;      //!< The first half of a surrogate pair (0 if none).
+    std::string text;             //!< The text of the token being read.
+    std::vector<JsonValue> open;  //!< The arrays and objects not yet closed, outermost first.
+    std::vector<std::string> key; //!< The key of the member being read in each open object.
+    JsonValue result;
+    bool complete;
+    bool broken;
+
+    bool take(char ch);
+    bool finish_token();
+    void finish_value(JsonValue &&value);
+    void append_code_point(unsigned code);
+};
+
+//! Appends text to a JSON document as a quoted string.
+void json_quote(std::string &output, std::string_view text);
+
+#endif
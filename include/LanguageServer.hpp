@@ -0,0 +1,44 @@
+/*! \file    LanguageServer.hpp
+ *  \brief   Interface to the LanguageServer abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef LANGUAGESERVER_HPP
+#define LANGUAGESERVER_HPP
+
+#include <string>
+
+class YEditFile;
+
+//! Encloses functions that keep language servers informed of the files being edited.
+/*!
+ * A language server is a program that understands some language and talks to the editor with
+ * the Language Server Protocol over its standard input and output. Each server is configured
+ * for a set of file name extensions and is started when a file with one of them is first
+ * shown in a window. Its messages are read as they arrive (see EventLoop::add_source) and what
+ * is written to it is queued when the pipe is full, so the editor never waits for a server.
+ *
+ * A file is sent to its server in full only when it is opened. After that, while the editor is
+ * idle, the lines modified since the last report (see EditFile::take_modifications) are sent
+ * as one change replacing whole lines. The problems the server reports are kept with the file
+ * (see Diagnostics) and shown by YEditFile::display. Files too large to send are left alone.
+ *
+ * Language servers are only supported on POSIX systems.
+ */
+namespace LanguageServer {
+
+    //! Sets the command that starts the language server for files with the given extensions.
+    /*!
+     * \param extensions The extensions, including the dots, separated by spaces (".c .h").
+     * \param command The command given to the shell to start the server. If it is empty, no
+     * server is used for these extensions.
+     * \return false if language servers aren't supported.
+     */
+    bool configure(const std::string &extensions, const std::string &command);
+
+    //! Tells the file's server, if any, that the file is closed. Call before destroying it.
+    void forget(YEditFile &file);
+
+} // namespace LanguageServer
+
+#endif
@@ -0,0 +1,63 @@
+/*! \file    LineDiff.hpp
+ *  \brief   Interface to the LineDiff functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef LINEDIFF_HPP
+#define LINEDIFF_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+//! Encloses functions that find the differences between two versions of a file's lines.
+/*!
+ * Lines are compared by their hashes so neither version needs to be held as text while the
+ * differences are found (for example, one version may be in a file's EditList while the other
+ * is on disk).
+ */
+namespace LineDiff {
+
+    //! A run of old lines replaced by a run of new lines. Either run may be empty.
+    struct Hunk {
+        long old_first; //!< Index of the first old line replaced.
+        long old_count; //!< Number of old lines replaced.
+        long new_first; //!< Index of the first new line replacing them.
+        long new_count; //!< Number of new lines replacing them.
+    };
+
+    //! Returns the hash by which a line is compared.
+    inline std::size_t hash(const std::string_view line)
+    {
+        return std::hash<std::string_view>()(line);
+    }
+
+    //! Finds hunks that, applied to old_lines, give new_lines.
+    /*!
+     * The hunks are in order and do not touch one another. The number of lines they remove and
+     * insert is minimal (Myers' algorithm) unless the versions are so different that finding
+     * the minimum would take too long. In that case some hunks replace more than necessary.
+     *
+     * \param old_lines The hashes of the lines in the old version.
+     * \param new_lines The hashes of the lines in the new version.
+     */
+    std::vector<Hunk> compare(const std::vector<std::size_t> &old_lines,
+                              const std::vector<std::size_t> &new_lines);
+
+    //! Returns the line of the new version that corresponds to a line of the old version.
+    /*!
+     * Lines outside the hunks move with the lines around them. A line that a hunk replaces
+     * corresponds to the line at the same place in its replacement, or to the last line of a
+     * shorter replacement (the line after the hunk if the replacement is empty).
+     *
+     * \param hunks The hunks found by compare.
+     * \param line The line to look up.
+     * \param forward True to look up a line of the old version in the new, false for the
+     * reverse.
+     */
+    long follow(const std::vector<Hunk> &hunks, long line, bool forward = true);
+
+} // namespace LineDiff
+
+#endif
@@ -6,6 +6,9 @@
 #ifndef LINEEDITFILE_HPP
 #define LINEEDITFILE_HPP
 
+#include <string>
+#include <vector>
+
 #include "EditFile.hpp"
 
 class LineEditFile : private virtual EditFile {
@@ -18,7 +21,7 @@ class LineEditFile : private virtual EditFile {
      */
     const EditBuffer *get_line();
 
-    //! Returns length of current line.
+    //! Returns length of current line in columns.
     unsigned CP_line_length();
 
     //! Inserts parameter before current line. Returns false if out of memory.
@@ -32,6 +35,17 @@ class LineEditFile : private virtual EditFile {
 
     //! Deletes to the end of the line.
     void delete_to_EOL();
+
+    // Whole line access by line number, for macros that process many lines at once.
+
+    //! Returns the number of lines in the file.
+    long line_count() { return file_data.size(); }
+
+    //! Returns the text of the given line, or nullptr if it is past the end of the file.
+    const EditBuffer *line_at(long line);
+
+    //! Replaces count lines starting at first with new_lines. Returns false if out of memory.
+    bool replace_lines(long first, long count, const std::vector<std::string> &new_lines);
 };
 
 #endif
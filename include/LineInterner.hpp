@@ -0,0 +1,47 @@
+/*! \file    LineInterner.hpp
+ *  \brief   Interface to class LineInterner
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef LINEINTERNER_HPP
+#define LINEINTERNER_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+
+#include "EditBuffer.hpp"
+
+//! Makes the lines of a file being read, sharing the text of lines that repeat.
+/*!
+ * Log files and the like contain many identical lines (repeated headers, stack frames, and so
+ * on). The interner remembers the lines it has made by their hashes. A line identical to one
+ * made earlier is made as a copy of it, so the two share one workspace until either is edited
+ * (see EditBuffer). Short lines are stored inside their EditBuffers anyway and so are not
+ * remembered. So that a file of distinct lines does not fill a huge table, only the first
+ * max_remembered distinct lines are remembered.
+ *
+ * An interner is used by one thread at a time. The lines it makes don't depend on it and may
+ * outlive it.
+ */
+class LineInterner {
+  public:
+    //! What sharing has saved.
+    struct Savings {
+        long lines = 0;        //!< Lines made sharing the text of an earlier line.
+        std::size_t bytes = 0; //!< The heap memory they would otherwise have used.
+    };
+
+    //! The interner adds what it saves to savings, which must outlive it.
+    explicit LineInterner(Savings &savings) : savings(savings) {}
+
+    EditBuffer *make(std::string_view text);
+
+  private:
+    static constexpr std::size_t max_remembered = 65536;
+
+    std::unordered_multimap<std::size_t, EditBuffer> remembered; //!< Lines keyed by hash.
+    Savings &savings;
+};
+
+#endif
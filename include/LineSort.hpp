@@ -0,0 +1,52 @@
+/*! \file    LineSort.hpp
+ *  \brief   Interface to the LineSort functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef LINESORT_HPP
+#define LINESORT_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "EditBuffer.hpp"
+
+//! Encloses functions that sort, reverse, and remove duplicates from lists of lines.
+/*!
+ * The lines themselves are never copied. Each is represented by a small handle holding its
+ * position and its sort key, and only the handles are moved. Large lists are sorted by a
+ * merge sort that runs on several threads.
+ */
+namespace LineSort {
+
+    //! Describes how lines are arranged.
+    struct Options {
+        bool sort = true;         //!< Sort the lines.
+        bool numeric = false;     //!< Order by the number the key starts with.
+        bool ignore_case = false; //!< Order as my_stricmp does.
+        bool unique = false;      //!< Remove lines equal to the line before them.
+        bool reverse = false;     //!< Reverse the (sorted) lines.
+        unsigned column = 0;      //!< The column where the key starts.
+        unsigned tab = 8;         //!< The tab distance used to find the column.
+        char delimiter = '\0';    //!< If not '\0', the key is a field of a table instead.
+        std::size_t field = 0;    //!< The key field (counting from zero), if delimiter is set.
+    };
+
+    //! Compares strings as my_stricmp does, eight bytes at a time.
+    int compare_folded(std::string_view left, std::string_view right);
+
+    //! Arranges the lines. Lines removed as duplicates are destroyed.
+    /*!
+     * The sort is stable, so lines with equal keys keep their order. Duplicates are lines
+     * whose keys are equal in the sort's order. Only adjacent duplicates are removed, so that
+     * without sorting this works like uniq.
+     *
+     * \throws std::bad_alloc if insufficient memory. The lines are then unchanged.
+     */
+    void arrange(std::vector<std::unique_ptr<EditBuffer>> &lines, const Options &options);
+
+} // namespace LineSort
+
+#endif
@@ -0,0 +1,48 @@
+/*! \file    LineTransform.hpp
+ *  \brief   Interface to the LineTransform functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef LINETRANSFORM_HPP
+#define LINETRANSFORM_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Encloses functions that clean up or convert the text of lines.
+/*!
+ * Each transform is a kernel that first checks whether a line needs changing, usually sixteen
+ * bytes at a time, and produces new text only if it does. Most lines of a file usually need
+ * no change, so they cost little more than a scan. Case is changed for ASCII letters only;
+ * other characters, including the bytes of UTF-8 sequences, are left as they are.
+ */
+namespace LineTransform {
+
+    enum Kind {
+        TRIM,        //!< Removes trailing spaces and tabs.
+        EXPAND_TABS, //!< Replaces each tab with the spaces that reach the same column.
+        INDENT_TABS, //!< Uses tabs, then spaces, for the indentation.
+        UPPER_CASE,
+        LOWER_CASE,
+        REMOVE_CR //!< Removes carriage returns left by mixed line endings.
+    };
+
+    //! Finds the transform with the given name (as in the transform_lines command).
+    /*!
+     * \return false if there is no such transform.
+     */
+    bool find(std::string_view name, Kind &kind);
+
+    //! Applies transforms, in order, to a line.
+    /*!
+     * \param tab The distance between tab stops.
+     * \return false if the transforms don't change the line. The result is then unspecified.
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    bool apply(const std::vector<Kind> &pipeline, std::string_view text, unsigned tab,
+               std::string &result);
+
+} // namespace LineTransform
+
+#endif
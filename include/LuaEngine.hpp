@@ -0,0 +1,46 @@
+/*! \file    LuaEngine.hpp
+ *  \brief   Interface to the LuaEngine abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef LUAENGINE_HPP
+#define LUAENGINE_HPP
+
+#include <string_view>
+
+//! Encloses functions that run macros written in Lua.
+/*!
+ * Lua support is compiled in when the build finds LuaJIT or Lua (5.1 or later). Otherwise the
+ * functions below only display an error message.
+ *
+ * Scripts share one interpreter so that functions defined by one script (a startup script, for
+ * example) can be used by later ones. The editor is reached through the global table `yexa`:
+ *
+ * - `line_count()` returns the number of lines in the active file.
+ * - `get_line(n)` returns line n, or nil past the end. `set_line(n, text)` replaces it.
+ * - `get_lines(first [, last])` returns an array of lines. `set_lines(first, last, array)`
+ *   replaces lines first through last with those in the array; last may be first - 1 to
+ *   insert. Working on many lines at once this way is much faster than line by line.
+ * - `cursor()` returns the line and column of the cursor. `set_cursor(line [, column])`
+ *   moves it.
+ * - `block()` returns the first and last lines of the block, or nil if block mode is off.
+ * - `search(text [, regex])` moves the cursor to the next match at or after it and returns
+ *   its line, column, and length, or nil if there is none.
+ * - `command(name, ...)` executes a macro command. Its parameters are given in the order the
+ *   command prompts for them; numbers are passed as integers. Commands that start other macros
+ *   (such as execute_macro) run them after the script has finished.
+ *
+ * Lines and columns are numbered from 1. Changes to the file are undone with the command that
+ * ran the script.
+ */
+namespace LuaEngine {
+
+    //! Runs the Lua script in the named file. Returns false (and reports why) on failure.
+    bool run_file(const char *file_name);
+
+    //! Runs the given Lua code. Returns false (after an error message) on failure.
+    bool run_text(std::string_view code);
+
+} // namespace LuaEngine
+
+#endif
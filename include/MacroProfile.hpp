@@ -0,0 +1,84 @@
+/*! \file    MacroProfile.hpp
+ *  \brief   Interface to the MacroProfile abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MACROPROFILE_HPP
+#define MACROPROFILE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Encloses functions that count and time the commands and word sources of macros.
+/*!
+ * While the profile is running, each command executed (see execute_command) and each word
+ * source popped from the macro stack is counted with the time it took in all (inclusive) and
+ * the time it took less the time of the commands, or the sources, it ran meanwhile (exclusive).
+ * The deepest the parameter stack was at the start and end of each command, and whenever a
+ * source gave a word, is also kept. A source's times leave out the time the macro was
+ * suspended waiting for it. Keeping the profile costs two readings of the clock for each
+ * command, so it can be left running for long.
+ */
+namespace MacroProfile {
+
+    //! The orders in which report can list the commands and sources.
+    enum Order {
+        BY_CALLS,     //!< Most often run first.
+        BY_INCLUSIVE, //!< Most time in all first.
+        BY_EXCLUSIVE, //!< Most time of its own first.
+        BY_DEPTH,     //!< Deepest parameter stack first.
+        BY_NAME       //!< Alphabetically.
+    };
+
+    //! Starts the profile, forgetting anything counted before.
+    void start();
+
+    //! Stops the profile. What was counted is kept for report.
+    void stop();
+
+    //! Returns true if the profile is running.
+    bool active();
+
+    //! Notes that the command with the given dispatch table index is starting.
+    void enter_command(int index);
+
+    //! Notes that the command last entered has ended.
+    void leave_command();
+
+    //! Counts the command in the block in which it is declared, if the profile is running.
+    class Command {
+      public:
+        explicit Command(int index) : counted(active())
+        {
+            if (counted)
+                enter_command(index);
+        }
+        ~Command()
+        {
+            if (counted)
+                leave_command();
+        }
+
+        Command(const Command &) = delete;
+        Command &operator=(const Command &) = delete;
+
+      private:
+        bool counted;
+    };
+
+    //! Notes that the given source, at the top of the macro stack, is about to give a word.
+    void source_word(const void *source, std::string_view name);
+
+    //! Notes that the given source has been popped from the macro stack.
+    void source_popped(const void *source);
+
+    //! Notes that the macro was suspended for the given time, in nanoseconds.
+    void suspended(long long nanoseconds);
+
+    //! Returns lines of text describing the commands and then the sources, in the given order.
+    std::vector<std::string> report(Order order);
+
+} // namespace MacroProfile
+
+#endif
@@ -0,0 +1,56 @@
+/*! \file    MacroProgram.hpp
+ *  \brief   Interface to class MacroProgram
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MACROPROGRAM_HPP
+#define MACROPROGRAM_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "parameter_stack.hpp"
+
+//! Macro text translated into a sequence of pre-resolved instructions.
+/*!
+ * Compiling macro text scans it once with a MacroTokenizer. Strings and words that are not
+ * commands are collected into a constant pool, with numbers decoded into integers; command
+ * words are replaced by their index in the dispatch table. Executing the resulting program
+ * thus involves neither tokenizing nor looking up words by name.
+ */
+class MacroProgram {
+  public:
+    enum Opcode : unsigned char {
+        PUSH_CONSTANT,  //!< Push the constant with index operand onto the parameter stack.
+        EXECUTE_COMMAND //!< Execute the dispatch table entry with index operand.
+    };
+
+    struct Instruction {
+        Opcode opcode;
+        unsigned operand;
+    };
+
+    void compile(const char *text, std::size_t length);
+
+    //! Returns the number of instructions in the program.
+    std::size_t size() const { return code.size(); }
+
+    //! Returns the instruction at the given index.
+    const Instruction &operator[](std::size_t index) const { return code[index]; }
+
+    //! Returns the constant at the given index.
+    const ParameterStack::Value &constant(std::size_t index) const { return constants[index]; }
+
+    void add_constant(std::string_view text);
+    void add_word(std::string_view word);
+
+  private:
+    std::vector<Instruction> code;     //!< The instructions in order of execution.
+    std::vector<ParameterStack::Value> constants; //!< Pushed by PUSH_CONSTANT instructions.
+};
+
+std::shared_ptr<const MacroProgram> load_macro_program(const char *file_name);
+
+#endif
@@ -0,0 +1,48 @@
+/*! \file    MacroTokenizer.hpp
+ *  \brief   Interface to class MacroTokenizer.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MACROTOKENIZER_HPP
+#define MACROTOKENIZER_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//! Splits macro text held in memory into words and strings.
+/*!
+ * The text is a sequence of names and strings separated by white space. A '#' starts a comment
+ * that runs to the end of the line. Strings are either quoted ("...", where a backslash makes
+ * the next character literal) or enclosed in braces ({...}, which may nest). In a brace string
+ * comments and runs of white space each become a single space while quoted parts are copied
+ * as they are, quotes and backslashes included. A brace string that is not closed is dropped.
+ *
+ * Tokens refer to the text being scanned wherever possible. Only strings that must be
+ * transformed (quoted strings with escapes and brace strings) are copied, into a workspace
+ * that is reused from token to token. A token is thus valid until the next call to next.
+ */
+class MacroTokenizer {
+  public:
+    enum Kind { NAME, STRING };
+
+    struct Token {
+        Kind kind;
+        std::string_view text;
+    };
+
+    //! Scans the given text, which must outlive the tokenizer.
+    explicit MacroTokenizer(std::string_view source) : source(source), offset(0) {}
+
+    bool next(Token &token);
+
+  private:
+    std::string_view source; //!< The text being scanned.
+    std::size_t offset;      //!< Offset of the next character to examine.
+    std::string workspace;   //!< Holds the text of strings that are transformed.
+
+    std::string_view quoted_string();
+    bool brace_string(std::string_view &text);
+};
+
+#endif
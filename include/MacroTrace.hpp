@@ -0,0 +1,81 @@
+/*! \file    MacroTrace.hpp
+ *  \brief   Interface to class MacroTrace
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MACROTRACE_HPP
+#define MACROTRACE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MacroProgram.hpp"
+
+//! A learned keyboard macro, kept as what its keystrokes did rather than as the keystrokes.
+/*!
+ * While a macro is recorded each keystroke is stored as the compiled program it was bound to
+ * (or the character it inserted), together with the answers typed into any prompts. Replaying
+ * the trace thus runs the programs directly, without reading or translating keys, and supplies
+ * the recorded answers instead of prompting again. Programs are shared with the key map; a key
+ * redefined after recording keeps its old meaning in the macro.
+ */
+class MacroTrace {
+  public:
+    enum Kind : unsigned char {
+        PROGRAM,        //!< Run programs[operand] using a ProgramWord.
+        DIRECT_PROGRAM, //!< Run programs[operand] in place (it has one command, at the end).
+        CHARACTER,      //!< Add the character operand to the file.
+        ANSWER,         //!< answers[operand] was entered at a prompt.
+        CANCEL          //!< A prompt was cancelled.
+    };
+
+    struct Event {
+        Kind kind;
+        unsigned operand;
+    };
+
+    MacroTrace() : next(0), is_recording(false), is_defined(false), is_replaying(false) {}
+
+    void start_recording();
+    void finish_recording();
+
+    //! Returns true while a macro is being recorded.
+    bool recording() const { return is_recording; }
+
+    //! Returns true if a macro has been recorded.
+    bool defined() const { return is_defined; }
+
+    void record_program(const std::shared_ptr<const MacroProgram> &program, bool direct);
+    void record_character(char letter);
+    void record_answer(std::string_view answer);
+    void record_cancel();
+
+    void start_replay();
+    void finish_replay();
+    const Event *next_event();
+    bool take_answer(std::string &answer, bool &cancelled);
+
+    //! Returns the program recorded for a PROGRAM or DIRECT_PROGRAM event.
+    const std::shared_ptr<const MacroProgram> &program(const Event &event) const
+    {
+        return programs[event.operand];
+    }
+
+  private:
+    std::vector<Event> events;                                //!< What happened, in order.
+    std::vector<std::shared_ptr<const MacroProgram>> programs; //!< Each program once.
+    std::vector<std::string> answers;                         //!< Text entered at prompts.
+    std::size_t next;  //!< Index of the next event to replay.
+    bool is_recording; //!< =true while recording.
+    bool is_defined;   //!< =true once a macro has been recorded.
+    bool is_replaying; //!< =true while replaying (answers are taken from the trace).
+
+    bool add(Kind kind, unsigned operand);
+};
+
+extern MacroTrace keyboard_macro;
+
+#endif
@@ -0,0 +1,47 @@
+/*! \file    MappedFile.hpp
+ *  \brief   Interface to class MappedFile
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+
+#include <screen/environ.hpp>
+
+//! Read-only view of an entire disk file mapped into memory.
+/*!
+ * A MappedFile gives direct access to the bytes of a file without copying them through the
+ * standard I/O library. The mapping is released when the object is closed or destroyed so
+ * clients should copy out whatever they wish to retain. Only regular files can be mapped;
+ * clients should fall back to ordinary stream I/O if `open` fails.
+ */
+class MappedFile {
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    // A mapping can't sensibly be shared between two objects.
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const char *name);
+    void close();
+
+    //! Returns a pointer to the first byte of the file (nullptr if the file is empty).
+    const char *data() const { return base; }
+
+    //! Returns the number of bytes in the file.
+    std::size_t size() const { return length; }
+
+  private:
+    const char *base;   //!< Start of the mapped view.
+    std::size_t length; //!< Size of the mapped view.
+#if eOPSYS == eWINDOWS
+    void *file_handle;    //!< Handle of the open file.
+    void *mapping_handle; //!< Handle of the file mapping object.
+#endif
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*! \file    MarkSet.hpp
+ *  \brief   Interface to class MarkSet
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MARKSET_HPP
+#define MARKSET_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "EditDelta.hpp"
+
+//! Positions in a file that stay on their lines as lines are inserted and deleted around them.
+/*!
+ * Each mark has a line and a column. When the lines of the file move (see move) the marks on
+ * the lines that follow the lines replaced move with them. Marks on lines that were deleted
+ * move to the first line after those that replaced them, at its first column. A mark's column
+ * is otherwise left alone.
+ *
+ * The marks are kept in order of their lines, with the distance of each mark from the one
+ * before it held in a Fenwick (binary indexed) tree. Thus moving every mark after a line, and
+ * finding the line of a mark, take logarithmic time however many marks there are. Marks that
+ * are added or placed again are held aside and sorted into the others, all at once, the next
+ * time the marks are moved.
+ */
+class MarkSet {
+  public:
+    //! Identifies a mark. It stays the same for as long as the mark exists.
+    using Mark = std::size_t;
+
+    //! A value that identifies no mark.
+    static constexpr Mark none = static_cast<Mark>(-1);
+
+    MarkSet() = default;
+
+    //! Returns true if there are no marks.
+    bool empty() const { return count == 0; }
+
+    //! Returns the number of marks.
+    std::size_t size() const { return count; }
+
+    Mark add(long line, unsigned column);
+    void place(Mark mark, long line, unsigned column);
+    void remove(Mark mark);
+    bool contains(Mark mark) const;
+    long line(Mark mark) const;
+    unsigned column(Mark mark) const;
+    void move(const EditDelta &change);
+    void clear();
+
+  private:
+    //! What a mark's slot holds.
+    enum State { FREE, HELD, SORTED };
+
+    struct Slot {
+        State state;
+        std::size_t index; //!< The mark's position in order, if it is sorted.
+        long line;         //!< The mark's line, if it is held aside.
+        unsigned column;
+    };
+
+    std::vector<Slot> slots;       //!< Indexed by mark.
+    std::vector<Mark> free_slots;  //!< Slots that may be used again.
+    std::vector<Mark> held;        //!< The marks added or placed since the last sort.
+    std::vector<Mark> order;       //!< Sorted marks, by line. Others may be left among them.
+    std::vector<long> steps;       //!< The distance of each of those from the one before it.
+    std::size_t count = 0;         //!< The number of marks.
+
+    //! The Fenwick tree of steps. Element i covers positions [i - (i & -i), i) of order.
+    std::vector<long> tree;
+
+    void add_step(std::size_t index, long distance);
+    long line_at(std::size_t index) const;
+    std::size_t first_at(long line) const;
+    void sort();
+};
+
+#endif
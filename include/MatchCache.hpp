@@ -0,0 +1,62 @@
+/*! \file    MatchCache.hpp
+ *  \brief   Interface to class MatchCache.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef MATCHCACHE_HPP
+#define MATCHCACHE_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "EditDelta.hpp"
+#include "SearchPattern.hpp"
+
+//! The occurrences of a search pattern on the lines of a file that have been displayed.
+/*!
+ * A line is searched the first time it is shown and its occurrences are kept until the line is
+ * modified or the pattern changes, so scrolling back over lines already seen searches nothing.
+ * Modifications are passed on exactly (see EditFile::take_modifications): the lines modified
+ * are forgotten and the results for the lines after them move with them. Very long lines are
+ * not kept; their callers search only the part displayed.
+ */
+class MatchCache {
+  public:
+    //! An occurrence, in bytes.
+    struct Match {
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    //! Forgets every line.
+    void reset();
+
+    //! Starts a display of occurrences of the pattern.
+    /*!
+     * The lines are forgotten if the pattern's text or mode has changed since the last call.
+     * The pattern is not copied; it must remain valid until the display is finished.
+     */
+    void prepare(const SearchPattern &pattern);
+
+    //! Forgets the lines modified and moves those after them.
+    void invalidate(const EditDelta &change);
+
+    //! Returns the occurrences of the prepared pattern on a line, searching it if needed.
+    /*!
+     * Occurrences that are empty are not included.
+     *
+     * \return nullptr if the line is too long to be kept.
+     */
+    const std::vector<Match> *matches(long line, std::string_view text);
+
+  private:
+    const SearchPattern *pattern = nullptr;
+    std::string text;                 //!< The text of the pattern the lines were searched for.
+    SearchPattern::Mode mode = SearchPattern::LITERAL;
+    std::map<long, std::vector<Match>> lines; //!< The occurrences on each line searched.
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*! \file    PathIndex.hpp
+ *  \brief   Interface to class PathIndex.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PATHINDEX_HPP
+#define PATHINDEX_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "TaskPool.hpp"
+
+//! The paths of every file in a directory tree, listed on a pool of worker threads.
+/*!
+ * The walk begins when the object is constructed. As with ProjectSearch the workers share a
+ * queue of directories still to be listed and prune the same directories. Paths found by the
+ * workers are added to the index by `update`, which is only called by the thread that owns
+ * the index. Thus the index can be read without locking while the walk continues.
+ *
+ * The paths are stored end to end in one string, and again with their ASCII letters folded to
+ * lower case so that matchers need not fold them. Each also has a mask of the characters it
+ * contains (see `character_mask`) so that matchers can reject most paths without looking at
+ * their text. Destroying the object cancels a walk in progress.
+ */
+class PathIndex {
+  public:
+    explicit PathIndex(const std::string &root);
+    ~PathIndex();
+
+    PathIndex(const PathIndex &) = delete;
+    PathIndex &operator=(const PathIndex &) = delete;
+
+    bool update();
+
+    //! Returns the number of paths in the index.
+    std::size_t size() const { return masks.size(); }
+
+    //! Returns a path, relative to the root when possible.
+    std::string_view path(std::size_t index) const
+    {
+        return std::string_view(text).substr(starts[index], starts[index + 1] - starts[index]);
+    }
+
+    //! Returns a path with its letters in lower case.
+    std::string_view folded_path(std::size_t index) const
+    {
+        const std::size_t length = starts[index + 1] - starts[index];
+        return std::string_view(folded).substr(starts[index], length);
+    }
+
+    //! Returns the mask of the characters in a path.
+    std::uint64_t mask(std::size_t index) const { return masks[index]; }
+
+    static char fold(char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; }
+    static std::uint64_t character_mask(std::string_view characters);
+
+  private:
+    std::string text;                 //!< The paths, end to end.
+    std::string folded;               //!< The paths with their letters in lower case.
+    std::vector<std::size_t> starts;  //!< Offset of each path in text, and of the end.
+    std::vector<std::uint64_t> masks; //!< The characters in each path.
+
+    TaskPool::Group workers;
+    std::atomic<bool> cancelled;      //!< Set to stop the workers early.
+    std::mutex queue_lock;            //!< Protects the members below.
+    std::condition_variable changed;  //!< Signaled when directories are added or finished.
+    std::vector<std::string> pending; //!< Directories not yet listed.
+    unsigned busy;                    //!< Number of workers listing a directory.
+    std::vector<std::string> queue;   //!< Paths found but not yet added to the index.
+    std::size_t path_count;           //!< Number of paths found so far.
+    unsigned running;                 //!< Number of workers still listing.
+
+    void work();
+};
+
+#endif
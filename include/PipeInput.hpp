@@ -0,0 +1,40 @@
+/*! \file    PipeInput.hpp
+ *  \brief   Interface to the PipeInput abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PIPEINPUT_HPP
+#define PIPEINPUT_HPP
+
+//! Encloses functions that read standard input and named pipes into files as text arrives.
+/*!
+ * The name "-" stands for the editor's standard input. The text of a pipe is put into a file of
+ * its own, named *stdin* for standard input and *name* for a named pipe since the pipe itself
+ * can't be read again or saved. The lines are added to the end of the file as the program
+ * writing the pipe produces them (see EventLoop), so they can be viewed, searched, and edited
+ * while more are on the way. A final line without a newline is added once the pipe is closed.
+ * Killing the file stops the reading. Only POSIX systems are supported.
+ */
+namespace PipeInput {
+
+    //! Moves standard input aside so that the keyboard can be read from the terminal.
+    /*!
+     * This is called before the screen is initialized if "-" is on the command line. Nothing is
+     * done if standard input is the terminal.
+     *
+     * \return false if standard input can't be read as a pipe.
+     */
+    bool claim_standard_input();
+
+    //! Returns true if name is "-" (and standard input was claimed) or names a named pipe.
+    bool is_pipe(const char *name);
+
+    //! Makes the file holding the text of the named pipe active, starting to read if needed.
+    /*!
+     * \return false if the pipe can't be opened. An error message has been displayed.
+     */
+    bool open(const char *name);
+
+} // namespace PipeInput
+
+#endif
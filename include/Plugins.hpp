@@ -0,0 +1,32 @@
+/*! \file    Plugins.hpp
+ *  \brief   Interface to the Plugins abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PLUGINS_HPP
+#define PLUGINS_HPP
+
+class YEditFile;
+
+//! Encloses functions that load plugins and run their hooks.
+/*!
+ * Plugins are shared libraries that use the C interface in yexa_plugin.h. The commands they
+ * register are added to the dispatch table (see add_command) and run like the editor's own.
+ * Plugins that subscribe to modifications are told of them in batches while the editor is
+ * idle, one range of replaced lines per file.
+ *
+ * Every call into a plugin is timed in the profiler's PLUGIN zone. A plugin whose calls take
+ * too long several times is disabled: its commands report that it is, and it is told of no
+ * more modifications. Plugins are never unloaded since their code may still be referenced.
+ */
+namespace Plugins {
+
+    //! Loads and starts a plugin. Returns false (and reports why) on failure.
+    bool load(const char *file_name);
+
+    //! Forgets what plugins have been told about a file. Call before destroying it.
+    void forget(YEditFile &file);
+
+} // namespace Plugins
+
+#endif
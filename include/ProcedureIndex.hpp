@@ -0,0 +1,78 @@
+/*! \file    ProcedureIndex.hpp
+ *  \brief   Interface to class ProcedureIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PROCEDUREINDEX_HPP
+#define PROCEDUREINDEX_HPP
+
+#include <vector>
+
+//! The structure of a file: its procedures and the nested scopes that contain them.
+/*!
+ * The index is built by examining the lines of a file from the top. Each line may open or close
+ * scopes (for example, with braces) and may start a procedure. The scopes form a tree: each
+ * records the lines holding its delimiters and the scope enclosing it. When a line is modified
+ * only what was learned from that line on is forgotten. The scopes still open before the line
+ * are found by following the tree upward from the last scope opened, so examination resumes at
+ * the modified line itself. Procedures and scopes before that line remain valid.
+ *
+ * The index does not look at the file itself. Its owner examines the lines and reports them
+ * with `open_scope`, `close_scope`, `add`, and `advance`.
+ */
+class ProcedureIndex {
+  public:
+    struct Procedure {
+        long head;  //!< The first line of the procedure.
+        long start; //!< The line that identified the procedure (for example, its open brace).
+    };
+
+    struct Scope {
+        long open;   //!< The line holding the scope's opening delimiter.
+        long close;  //!< The line holding its closing delimiter (-1 if not yet found).
+        long parent; //!< The index of the enclosing scope in scopes() (-1 if there is none).
+    };
+
+    ProcedureIndex();
+
+    void invalidate(long first_line);
+    void add(long head, long start);
+    void open_scope();
+    void close_scope();
+
+    //! Records that the next line has been examined.
+    void advance() { ++scanned_lines; }
+
+    //! Records that the end of the file was reached. The index is complete.
+    void finish() { finished = true; }
+
+    //! Returns true if every line of the file has been examined.
+    bool complete() const { return finished; }
+
+    //! Returns the number of lines examined. The next line to examine has this index.
+    long scanned() const { return scanned_lines; }
+
+    //! Returns the number of scopes open at the current point of the examination.
+    int depth() const { return static_cast<int>(open_scopes.size()); }
+
+    //! Returns the procedures found so far, ordered by their start lines.
+    const std::vector<Procedure> &procedures() const { return found; }
+
+    //! Returns the scopes found so far, ordered by their open lines.
+    const std::vector<Scope> &scopes() const { return tree; }
+
+    const Procedure *following(long line) const;
+    const Procedure *preceding(long line) const;
+    const Procedure *headed_at(long line) const;
+    const Scope *enclosing(long line) const;
+    bool opens_scope(long line) const;
+
+  private:
+    std::vector<Procedure> found;   //!< Procedures in lines [0, scanned_lines).
+    std::vector<Scope> tree;        //!< Scopes opened in lines [0, scanned_lines).
+    std::vector<long> open_scopes;  //!< Indices in tree of the scopes open, outermost first.
+    long scanned_lines;             //!< Number of lines examined.
+    bool finished;                  //!< True if the end of the file was reached.
+};
+
+#endif
@@ -0,0 +1,64 @@
+/*! \file    Profiler.hpp
+ *  \brief   Interface to the Profiler abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <string>
+#include <vector>
+
+#include "Timer.hpp"
+
+//! Encloses functions that measure the time the editor spends in its main activities.
+/*!
+ * Each activity is a zone. A Scope declared at the start of a block times the block with a
+ * spica::Timer and adds the time to its zone when the block ends. For each zone the number of
+ * times, their total, the shortest and longest, and a histogram of the times (by powers of two
+ * microseconds) are kept. Scopes of the same zone may be nested, as when a macro runs another
+ * macro; each is counted with the time it took in all. Zones can be timed on any thread.
+ */
+namespace Profiler {
+
+    //! The activities that are timed.
+    enum Zone {
+        LOAD,    //!< Reading a file from disk.
+        SAVE,    //!< Writing files to disk.
+        SEARCH,  //!< Searching a file (and replacing in it).
+        DISPLAY, //!< Painting the windows with the damage to their files.
+        FLUSH,   //!< Composing the screen from the windows and writing it to the terminal.
+        MACRO,   //!< Running the command for a macro word or a key.
+        PLUGIN,  //!< Running a plugin's command or hook.
+        ZONE_COUNT
+    };
+
+    //! Adds a time, in nanoseconds, to a zone.
+    void record(Zone zone, long long nanoseconds);
+
+    //! Returns the time, in nanoseconds, last added to a zone (zero if none has been).
+    long long latest(Zone zone);
+
+    //! Times the block in which it is declared.
+    class Scope {
+      public:
+        explicit Scope(Zone zone) : zone(zone) { timer.start(); }
+        ~Scope() { record(zone, timer.nanoseconds()); }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+      private:
+        Zone zone;
+        spica::Timer timer;
+    };
+
+    //! Forgets everything that has been timed.
+    void reset();
+
+    //! Returns lines of text describing the times of each zone.
+    std::vector<std::string> report();
+
+} // namespace Profiler
+
+#endif
@@ -0,0 +1,72 @@
+/*! \file    ProjectSearch.hpp
+ *  \brief   Interface to class ProjectSearch.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PROJECTSEARCH_HPP
+#define PROJECTSEARCH_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SearchPattern.hpp"
+#include "TaskPool.hpp"
+
+//! Searches every file in a directory tree on a pool of worker threads.
+/*!
+ * The search begins when the object is constructed. The workers share a queue of directories
+ * still to be listed. A worker takes a directory, searches the files in it, and adds its
+ * subdirectories to the queue. Directories whose names begin with '.' (such as .git) and a few
+ * well known bulky directories are pruned. Files are mapped into memory and those that look
+ * binary are skipped.
+ *
+ * As with BufferSearch, each worker has its own copy of the pattern and hits are queued as
+ * they are found. Destroying the object cancels a search in progress.
+ */
+class ProjectSearch {
+  public:
+    struct Hit {
+        std::string path; //!< Path of the file, relative to the root when possible.
+        long line;        //!< Line number of the hit (zero based).
+        unsigned column;  //!< Column of the hit (zero based).
+        std::string text; //!< Text of the line, shortened if very long.
+    };
+
+    ProjectSearch(const SearchPattern &pattern, const std::string &root);
+    ~ProjectSearch();
+
+    ProjectSearch(const ProjectSearch &) = delete;
+    ProjectSearch &operator=(const ProjectSearch &) = delete;
+
+    bool collect(std::vector<Hit> &hits);
+
+    //! Returns the number of files searched so far.
+    std::size_t files_searched() const { return searched; }
+
+    static void list_directory(const std::string &directory,
+                               std::vector<std::string> &directories,
+                               std::vector<std::string> &files);
+
+  private:
+    TaskPool::Group workers;
+    std::atomic<bool> cancelled;       //!< Set to stop the workers early.
+    std::atomic<std::size_t> searched; //!< Number of files examined.
+
+    std::mutex queue_lock;            //!< Protects the members below.
+    std::condition_variable changed;  //!< Signaled when directories are added or finished.
+    std::vector<std::string> pending; //!< Directories not yet listed.
+    unsigned busy;                    //!< Number of workers listing a directory.
+    std::vector<Hit> queue;           //!< Hits found but not yet collected.
+    std::size_t hit_count;            //!< Number of hits found so far.
+    unsigned running;                 //!< Number of workers still searching.
+
+    void work(SearchPattern pattern);
+    void search_file(const std::string &path, const SearchPattern &pattern,
+                     std::vector<Hit> &hits);
+};
+
+#endif
@@ -0,0 +1,54 @@
+/*! \file    PromptHistory.hpp
+ *  \brief   Interface to the PromptHistory abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef PROMPTHISTORY_HPP
+#define PROMPTHISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+//! Encloses the text entered at each prompt (see Parameter), kept from one session to the next.
+/*!
+ * Each prompt has a ring holding its latest entries. Entries are numbered in the order they
+ * were entered, so the entry entered last has the highest number. Text entered again is moved
+ * to the front rather than kept twice. The entries of each prompt are also indexed by their
+ * text, so that those starting with a given prefix are found without looking at the others.
+ * The history is saved with filelist.yfy (see write_yfile) and read back when it is read.
+ */
+namespace PromptHistory {
+
+    //! The most entries kept for each prompt.
+    constexpr std::size_t capacity = 1024;
+
+    //! Adds text to the history of a prompt as its latest entry.
+    void add(std::string_view prompt, std::string_view text);
+
+    //! Returns the number of entries in the history of a prompt.
+    std::size_t size(std::string_view prompt);
+
+    //! Finds the entry of a prompt starting with prefix next to a given entry.
+    /*!
+     * \param prompt The prompt whose history is searched.
+     * \param prefix What the entry must start with. Every entry starts with "".
+     * \param older True to find the next older entry, false the next newer one.
+     * \param entry [in, out] The number of the entry to start from, or 0 to start (when
+     * looking for an older entry) from the latest. Set to the number of the entry found.
+     * \param text [out] The text of the entry found.
+     * \return false if there is no such entry. Then entry and text are unchanged.
+     */
+    bool find(std::string_view prompt, std::string_view prefix, bool older,
+              std::uint64_t &entry, std::string &text);
+
+    //! Replaces the history with that read from a file. Returns false if it can't be read.
+    bool read(const char *path);
+
+    //! Writes the history to a file. Returns false if that fails; the file is then removed.
+    bool write(const char *path);
+
+} // namespace PromptHistory
+
+#endif
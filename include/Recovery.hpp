@@ -0,0 +1,72 @@
+/*! \file    Recovery.hpp
+ *  \brief   Interface to the Recovery abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef RECOVERY_HPP
+#define RECOVERY_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "EditList.hpp"
+
+//! Encloses functions that keep unsaved changes where they survive a crash.
+/*!
+ * Each file with unsaved changes has a snapshot of its lines and a journal of the lines
+ * modified since the snapshot, both kept in a recovery directory. The directory is named by
+ * the YRECOVERY environment variable. Otherwise it is ~/.yexa-recovery (on Windows,
+ * %LOCALAPPDATA%\\yexa-recovery).
+ *
+ * Snapshots and journal records are taken on the main thread by copying EditBuffers, which
+ * share their text, so even a snapshot of a large file costs little more than a pointer per
+ * line. A worker thread writes them out. Records that arrive together are written as a batch
+ * and then flushed to the disk (with fsync) once. A file's data is discarded when the file no
+ * longer has unsaved changes, and everything is discarded when the editor exits normally. Data
+ * left behind by an editor that did not exit normally is found by recover() the next time the
+ * editor starts.
+ */
+namespace Recovery {
+
+    //! Identifies the recovery data of one file. Zero means there is none.
+    typedef unsigned long Slot;
+
+    //! Starts keeping recovery data for the named file, beginning with a snapshot of data.
+    /*!
+     * \return The file's slot or zero if recovery data can't be kept.
+     */
+    Slot open(const std::string &name, EditList &data);
+
+    //! Replaces the file's snapshot with one of data. The journal starts again after it.
+    void snapshot(Slot slot, EditList &data);
+
+    //! Journals that old_count lines at first were replaced by the new_count lines now there.
+    void append(Slot slot, long first, long old_count, EditList &data, long new_count);
+
+    //! Returns true if the journal has grown large enough that a new snapshot is worthwhile.
+    bool needs_snapshot(Slot slot);
+
+    //! Stops keeping recovery data for a file and discards what has been kept.
+    void close(Slot slot);
+
+    //! The lines of a file as they were when an editor ended without saving them.
+    struct Recovered {
+        std::string name;                //!< The name of the file.
+        std::unique_ptr<EditList> lines; //!< The file's lines.
+        std::string stem;                //!< Locates the data in the recovery directory.
+    };
+
+    //! Reads the recovery data left behind by editors that are no longer running.
+    /*!
+     * The data stays in the recovery directory until remove is called, so it survives another
+     * crash in the meantime.
+     */
+    std::vector<Recovered> recover();
+
+    //! Discards recovered data that is no longer needed.
+    void remove(const Recovered &recovered);
+
+} // namespace Recovery
+
+#endif
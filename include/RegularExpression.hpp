@@ -0,0 +1,120 @@
+/*! \file    RegularExpression.hpp
+ *  \brief   Interface to class RegularExpression.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef REGULAREXPRESSION_HPP
+#define REGULAREXPRESSION_HPP
+
+#include <bitset>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! A regular expression compiled for searching single lines of text.
+/*!
+ * The expression is compiled into a Thompson NFA. Searching never backtracks so its time is
+ * linear in the length of the text. Each line is first checked with a DFA that is built lazily
+ * from the NFA as characters are encountered; its states are cached and reused by later
+ * searches. Only lines that contain a match are then examined by a simulation of the NFA
+ * that locates the leftmost-longest match.
+ *
+ * The supported syntax is: literal characters, '.', bracketed classes with ranges and '^'
+ * negation, the anchors '^' and '$', grouping with parentheses, alternation with '|', and the
+ * repetition operators '*', '+' and '?'. A backslash quotes the following character, except
+ * that \d, \w, \s (and their upper case complements) denote the usual classes and \t denotes
+ * a tab.
+ */
+class RegularExpression {
+  public:
+    RegularExpression();
+
+    bool compile(std::string_view text, bool fold_case = false);
+
+    //! Returns a description of the syntax error found by the last failing compile().
+    const std::string &error() const { return error_text; }
+
+    bool find(std::string_view subject, std::size_t start, std::size_t &match_start,
+              std::size_t &match_length);
+
+  private:
+    enum StateType : unsigned char {
+        CHARACTER_SET, //!< Consumes a character in sets[set].
+        SPLIT,         //!< Continues at both out and out2.
+        EMPTY,         //!< Continues at out.
+        LINE_START,    //!< Continues at out only at the start of the line.
+        LINE_END,      //!< Continues at out only at the end of the line.
+        MATCH          //!< The expression has matched.
+    };
+
+    struct State {
+        StateType type;
+        int set;  //!< Index into sets for CHARACTER_SET states.
+        int out;  //!< Next state.
+        int out2; //!< Alternate next state for SPLIT states.
+    };
+
+    // A partially built piece of the NFA. The dangling exits are patched to the next piece.
+    struct Fragment {
+        int start;
+        std::vector<std::pair<int, int>> exits; //!< (State index, 0 for out or 1 for out2).
+    };
+
+    struct DFAState {
+        std::vector<int> nfa_states; //!< Sorted, excluding pure epsilon states.
+        bool accepting;              //!< True if a match has ended here.
+        bool accepting_at_end;       //!< True if a match ends here when the line ends.
+        int next[256];               //!< Transitions; -1 if not yet computed.
+    };
+
+    // Lazily built DFAs are discarded and restarted when they grow beyond this many states.
+    static constexpr std::size_t maximum_dfa_states = 2048;
+
+    std::vector<State> states;
+    std::vector<std::bitset<256>> sets;
+    int start_state;
+    std::string error_text;
+
+    // Parser state.
+    std::string_view source;
+    std::size_t position;
+    bool ignore_case; //!< =true if letters are added to sets in both cases (see fold).
+
+    // Cache of DFA states.
+    std::vector<DFAState> dfa;
+    std::map<std::vector<int>, int> dfa_index;
+    int initial_state[2]; //!< DFA start state when not at / at the start of the line.
+
+    // Scratch space for the closure computations.
+    std::vector<unsigned> marks;
+    unsigned generation;
+
+    int new_state(StateType type, int set = -1);
+    static void patch(std::vector<State> &state_list,
+                      const std::vector<std::pair<int, int>> &exits, int target);
+    bool parse_alternation(Fragment &result);
+    bool parse_concatenation(Fragment &result);
+    bool parse_repetition(Fragment &result);
+    bool parse_atom(Fragment &result);
+    bool parse_escape(std::bitset<256> &set);
+    bool parse_class(std::bitset<256> &set);
+    void fold(std::bitset<256> &set) const;
+    bool syntax_error(const char *message);
+
+    void add_closure(std::vector<int> &result, int state, bool at_start);
+    int dfa_state(std::vector<int> &nfa_states);
+    int initial(bool at_start);
+    int transition(int from, unsigned char character);
+    bool contains_match(std::string_view subject, std::size_t start);
+
+    struct Thread {
+        int state;
+        std::size_t start;
+    };
+    void add_thread(std::vector<Thread> &list, int state, std::size_t start,
+                    std::size_t position, std::size_t length);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*! \file    RemoteFile.hpp
+ *  \brief   Interface to class RemoteFile
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef REMOTEFILE_HPP
+#define REMOTEFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <screen/environ.hpp>
+
+//! A file on another host, read and written through ssh.
+/*!
+ * A remote file is named ssh://host/path, where the host may include a user name as in
+ * user@host. The path is absolute unless it starts with ~/, in which case it is relative to the
+ * user's home directory on the host. The editor runs ssh (or the program named by the YSSH
+ * environment variable) with a small shell script that stays running and answers requests
+ * written to its standard input. The host needs only a POSIX shell and the usual utilities
+ * (dd, head, wc, cksum, cp and mv). Since ssh is run in batch mode, logging in must not need a
+ * password; use keys or an agent.
+ *
+ * The file is read in blocks of block_size bytes. Several blocks may be requested before the
+ * first is received so that the round trips to the host overlap. Writing compares checksums of
+ * the blocks of the file on the host with those of the new text and sends only the blocks that
+ * differ. They are written into a copy of the file made on the host, which then replaces the
+ * file, so a failed upload leaves the original alone. Only POSIX systems are supported.
+ */
+class RemoteFile {
+  public:
+    //! The number of bytes in each block read.
+    static constexpr std::size_t block_size = 64 * 1024;
+
+    RemoteFile();
+    ~RemoteFile();
+
+    // The connection can't sensibly be shared between two objects.
+    RemoteFile(const RemoteFile &) = delete;
+    RemoteFile &operator=(const RemoteFile &) = delete;
+
+    static bool is_remote(const char *name);
+    static std::unique_ptr<RemoteFile> connect(const char *name);
+    static void keep(std::unique_ptr<RemoteFile> file);
+
+    bool open(const char *name);
+    void close();
+    bool refresh();
+
+    //! Returns true if the file exists on the host (as of the last open or refresh).
+    bool exists() const { return length >= 0; }
+
+    //! Returns the number of bytes in the file (zero if it does not exist).
+    std::uint64_t size() const { return length >= 0 ? static_cast<std::uint64_t>(length) : 0; }
+
+    //! Returns the number of blocks in the file.
+    std::uint64_t blocks() const { return (size() + block_size - 1) / block_size; }
+
+    //! Returns the number of blocks requested but not yet received.
+    std::size_t outstanding() const { return requested; }
+
+    bool request(std::uint64_t block);
+    bool receive(std::string &text);
+    bool read_all(std::string &text);
+    bool count_lines(bool cr_endings, long &count);
+    bool write(std::string_view image);
+
+  private:
+    std::string name;        //!< The name of the file, as given to open.
+    std::int64_t length;     //!< The size of the file (-1 if it does not exist).
+    std::size_t requested;   //!< Blocks requested but not yet received.
+    std::string input;       //!< Received from the host but not yet used.
+    bool failed;             //!< =true once the connection has broken.
+#if eOPSYS == ePOSIX
+    int to_host;             //!< The helper's standard input (-1 if not connected).
+    int from_host;           //!< The helper's standard output.
+    long helper;             //!< The process running ssh.
+#endif
+
+    bool send(std::string_view text);
+    bool read_line(std::string &line);
+    bool read_exact(std::size_t count, std::string &text);
+    bool fill(int timeout);
+};
+
+#endif
@@ -0,0 +1,67 @@
+/*! \file    Renderer.hpp
+ *  \brief   Interface to the Renderer abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <string>
+#include <vector>
+
+//! Encloses functions that decide when the display is brought up to date.
+/*!
+ * The editor core only records what changed (the damage of each file). The keyboard handler
+ * asks for a frame, which paints the damage into the windows and flushes the screen, at most
+ * once per frame interval. Keystrokes arriving sooner are handled first so their effects are
+ * shown together.
+ *
+ * The time from reading each keystroke to the end of the flush that shows its effect (the
+ * key-to-photon latency, as far as the editor can see it) is kept in a histogram.
+ *
+ * A terminal that is being resized reports many sizes in quick succession. The screen takes on
+ * the terminal's size only once the reports have stopped for a moment; the windows are then
+ * arranged for the new size and painted in a single frame.
+ */
+namespace Renderer {
+
+    //! Notes that a keystroke was just read. Its latency is measured by the next frame.
+    /*!
+     * \param keys The number of keys read with scr::key for the keystroke (two when quoted).
+     * Keystrokes are not measured if something else read keys since the previous one: that was
+     * a dialog box, which kept the frame waiting for the user.
+     */
+    void note_input(int keys = 1);
+
+    //! Returns the number of milliseconds before the next frame is due (zero if it is now).
+    int time_to_frame();
+
+    //! Paints the windows and flushes the screen, then records the latency of the keystrokes.
+    void frame();
+
+    //! Notices changes in the size of the terminal. This is an idle task for the EventLoop.
+    /*!
+     * \return false, always. The new size is taken on by a timer.
+     */
+    bool follow_size();
+
+    //! Returns the least number of milliseconds between frames.
+    int interval();
+
+    //! Sets the least number of milliseconds between frames (zero for no limit).
+    void set_interval(int milliseconds);
+
+    //! Returns the lines shown by the performance overlay (see WindowList::toggle_overlay).
+    /*!
+     * They describe the times of the recent frames, what the last frame wrote to the terminal,
+     * the allocations made since the frame before it, the memory holding lines of text, and
+     * the work queued for background threads.
+     */
+    std::vector<std::string> overlay();
+
+    //! Returns lines of text describing the frames and the latency histogram.
+    std::vector<std::string> report();
+
+} // namespace Renderer
+
+#endif
@@ -0,0 +1,49 @@
+/*! \file    Replay.hpp
+ *  \brief   Interface to the Replay abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+//! Encloses functions that run the editor from a script of keystrokes, timing each one.
+/*!
+ * A replay runs the editor on a headless screen (see scr::use_headless) with its keystrokes
+ * taken from a script, so that typing, paging, searching and the like can be benchmarked from
+ * end to end without a terminal. Each keystroke is timed from when it is handed to the editor
+ * until the editor asks for the next one, which includes painting the frame that shows its
+ * effect. The bytes that a terminal would have been sent meanwhile are counted too. When the
+ * script runs out a summary is printed on the standard output and the editor exits without
+ * saving anything.
+ *
+ * A script is a text file of keys separated by white space. A key is given by the name used
+ * with define_key (K_PGDN, K_CTRLT, and so on) or by text in double quotes, which stands for
+ * its characters typed one at a time; a backslash in the text quotes the following character.
+ * Either may be followed by *count to repeat it. A # outside of quotes starts a comment that
+ * runs to the end of the line. Scripts can also be recorded from a session (see record).
+ */
+namespace Replay {
+
+    //! Prepares to replay the named script on a screen of the given size.
+    /*!
+     * This must be called before the screen is initialized.
+     *
+     * \param script_name The name of the script.
+     * \param log_name The name of a file to which the time and bytes of every keystroke are
+     * written as comma separated values, or nullptr for none.
+     * \param rows The number of rows on the screen.
+     * \param columns The number of columns on the screen.
+     * \return false if the script could not be read. The reason is printed on the standard
+     * error.
+     */
+    bool start(const char *script_name, const char *log_name, int rows, int columns);
+
+    //! Writes the keystrokes read from the keyboard to the named file as a script.
+    /*!
+     * \return false if the file could not be opened.
+     */
+    bool record(const char *file_name);
+
+} // namespace Replay
+
+#endif
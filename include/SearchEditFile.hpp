@@ -6,13 +6,28 @@
 #ifndef SEARCHEDITFILE_HPP
 #define SEARCHEDITFILE_HPP
 
+#include <cstddef>
+#include <string_view>
+
 #include "EditFile.hpp"
+#include "SearchPattern.hpp"
 
 //! Adds simple search abilities to class EditFile.
 class SearchEditFile : private virtual EditFile {
   public:
     //! Adjusts current point to start of string if found.
     bool simple_search(const char *search_string);
+
+    //! Adjusts current point to start of the pattern if found.
+    bool search(const SearchPattern &pattern, std::size_t *match_length = nullptr);
+
+    //! Searches part of the file, for a search that is spread over several calls.
+    bool search_part(const SearchPattern &pattern, long &line, std::size_t &offset,
+                     std::size_t budget, std::size_t *match_length = nullptr);
+
+    //! Replaces every occurrence from the current point through the given line.
+    long replace_all(const SearchPattern &pattern, std::string_view replacement,
+                     long last_line);
 };
 
 #endif
@@ -0,0 +1,83 @@
+/*! \file    SearchPattern.hpp
+ *  \brief   Interface to class SearchPattern.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SEARCHPATTERN_HPP
+#define SEARCHPATTERN_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "RegularExpression.hpp"
+
+//! A search string prepared for repeated searching.
+/*!
+ * A pattern is either a literal string or a regular expression. Regular expressions are
+ * handled by class RegularExpression. Literal patterns are searched as follows.
+ *
+ * Compiling a pattern builds a Boyer-Moore-Horspool skip table. Single characters are located
+ * with memchr (which the library vectorizes on most platforms). Where SSE2 is available the
+ * first and last characters of the pattern are compared against 16 positions at a time and
+ * only the positions where both match are examined further. Otherwise the skip table is used
+ * to move past mismatches. The text being searched is examined in place; nothing is copied.
+ *
+ * A pattern may also ignore the case of ASCII letters, or match only whole words. Ignoring
+ * case, the text is folded to lower case 16 characters at a time as it is compared (regular
+ * expressions are instead compiled to match either case). A whole word match is one that is
+ * not continued by word characters on either side where it begins or ends with one. Word
+ * characters are letters, digits, '_' and the bytes of non-ASCII characters.
+ */
+class SearchPattern {
+  public:
+    static constexpr std::size_t npos = std::string_view::npos;
+
+    enum Mode { LITERAL, REGULAR_EXPRESSION };
+
+    //! Options that change what the pattern matches. They may be combined.
+    enum Option : unsigned {
+        IGNORE_CASE = 1U << 0, //!< ASCII letters of either case match each other.
+        WHOLE_WORD = 1U << 1   //!< Matches within longer words are skipped.
+    };
+
+    SearchPattern() { compile(std::string_view()); }
+    explicit SearchPattern(std::string_view text, Mode mode = LITERAL, unsigned options = 0U)
+    {
+        compile(text, mode, options);
+    }
+
+    bool compile(std::string_view text, Mode mode = LITERAL, unsigned options = 0U);
+
+    //! Returns the text of the pattern.
+    const std::string &text() const { return pattern; }
+
+    //! Returns the way in which the text of the pattern is interpreted.
+    Mode mode() const { return pattern_mode; }
+
+    //! Returns the options (a combination of Option values) the pattern was compiled with.
+    unsigned options() const { return pattern_options; }
+
+    //! Returns a description of the syntax error found by the last failing compile().
+    const std::string &error() const { return expression.error(); }
+
+    std::size_t find(std::string_view subject, std::size_t start = 0,
+                     std::size_t *match_length = nullptr) const;
+
+  private:
+    std::string pattern;      //!< The search string.
+    std::string folded;       //!< The search string in lower case, when ignoring case.
+    Mode pattern_mode;        //!< How pattern is interpreted.
+    unsigned pattern_options; //!< The Option values in effect.
+    std::size_t skip[256];    //!< Distance to shift when a character ends the window.
+
+    // Searching a regular expression updates its cache of DFA states.
+    mutable RegularExpression expression;
+
+    std::size_t find_match(std::string_view subject, std::size_t start,
+                           std::size_t &match_length) const;
+    std::size_t find_literal(std::string_view subject, std::size_t start) const;
+    std::size_t find_folded(std::string_view subject, std::size_t start) const;
+};
+
+#endif
@@ -0,0 +1,50 @@
+/*! \file    Server.hpp
+ *  \brief   Interface to the Server abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+#include <vector>
+
+//! Encloses functions that let one editor open the files named by later invocations.
+/*!
+ * Server mode is used when the YSERVER environment variable is set (to anything but an empty
+ * string). The first editor started in a directory listens on a local socket named for the
+ * user and the directory. An editor started later in the same directory hands its command
+ * line to the first one and exits at once, so the files are opened by the editor already
+ * running, with its files, indices, and caches, and nothing is started up again. If there is
+ * no editor to take the command line, or it does not answer, the new editor runs as usual.
+ *
+ * File names are relative to the directory shared by both editors, so an editor that has
+ * since changed its directory refuses the command line. The socket is kept in XDG_RUNTIME_DIR,
+ * or else in a directory under /tmp that only the user can enter, and connections from other
+ * users are ignored on both ends. Only POSIX systems are supported.
+ */
+namespace Server {
+
+    //! Hands the command line to the editor listening in this directory, if there is one.
+    /*!
+     * This is called before the editor is initialized since nothing else is needed if it
+     * succeeds.
+     *
+     * \param argc The number of arguments, including the program's name.
+     * \param argv The arguments, as given to main.
+     * \return true if the command line was accepted. The program should exit.
+     */
+    bool hand_over(int argc, char *argv[]);
+
+    //! Starts listening for the command lines of later invocations.
+    /*!
+     * The arguments of each command line, without the program name, are passed to open on the
+     * main thread (see EventLoop). It returns false to refuse them, in which case the later
+     * editor runs by itself. Nothing is done if server mode is not in use or the socket can't
+     * be made.
+     */
+    void listen(bool (*open)(std::vector<std::string> &arguments));
+
+} // namespace Server
+
+#endif
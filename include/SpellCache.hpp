@@ -0,0 +1,41 @@
+/*! \file    SpellCache.hpp
+ *  \brief   Interface to class SpellCache.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SPELLCACHE_HPP
+#define SPELLCACHE_HPP
+
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "EditDelta.hpp"
+#include "Spelling.hpp"
+
+//! The misspelled words on the lines of a file that have been displayed.
+/*!
+ * A line is checked the first time it is shown and its misspellings are kept until the line
+ * is modified, so only the lines modified and those scrolled into view for the first time are
+ * checked again. Modifications are passed on exactly (see EditFile::take_modifications), as
+ * for MatchCache. Very long lines are not checked.
+ */
+class SpellCache {
+  public:
+    //! Forgets every line.
+    void reset() { lines.clear(); }
+
+    //! Forgets the lines modified and moves those after them.
+    void invalidate(const EditDelta &change);
+
+    //! Returns the misspelled words on a line, checking it if needed.
+    /*!
+     * \return nullptr if the line is too long to be kept.
+     */
+    const std::vector<Spelling::Word> *misspellings(long line, std::string_view text);
+
+  private:
+    std::map<long, std::vector<Spelling::Word>> lines; //!< The misspellings on each line.
+};
+
+#endif
@@ -0,0 +1,50 @@
+/*! \file    Spelling.hpp
+ *  \brief   Interface to the Spelling abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SPELLING_HPP
+#define SPELLING_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+//! Encloses functions that find the misspelled words in prose.
+/*!
+ * The dictionary is a list of words, one to a line, named by the YDICTIONARY environment
+ * variable (/usr/share/dict/words by default on POSIX systems). The first time a list is used
+ * its words are put into a hash table kept in the user's home directory (.yexa-words.yxd, or
+ * yexa-words.yxd in LOCALAPPDATA on Windows). After that the table is mapped into memory as it
+ * is, so loading the dictionary reads nothing until words are looked up. The table is made
+ * again when the list changes.
+ *
+ * Words are compared without regard to case. Words holding digits, underscores, or characters
+ * outside of ASCII are not checked.
+ */
+namespace Spelling {
+
+    //! A word, in bytes.
+    struct Word {
+        std::size_t offset;
+        std::size_t length;
+    };
+
+    //! Makes sure the dictionary is open, making its table if necessary.
+    /*!
+     * \return false if there is no dictionary. An error message has been displayed.
+     */
+    bool open();
+
+    //! Returns true if the dictionary is open (see open).
+    bool is_open();
+
+    //! Returns true if word is in the dictionary, or if the dictionary is not open.
+    bool is_word(std::string_view word);
+
+    //! Adds the words of text that are not in the dictionary to misspelled.
+    void check(std::string_view text, std::vector<Word> &misspelled);
+
+} // namespace Spelling
+
+#endif
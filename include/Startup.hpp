@@ -0,0 +1,41 @@
+/*! \file    Startup.hpp
+ *  \brief   Interface to the Startup abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+#include <string>
+#include <vector>
+
+//! Encloses functions that time the phases of starting the editor, up to the first frame.
+/*!
+ * The main program names each phase as it finishes; a phase begins where the one before it
+ * finished, so the phases account for all of the time from begin to the first frame. Each
+ * phase is also recorded as a complete event in the trace (see Trace) if tracing is on. The
+ * timeline is shown with the profile (see profile_info_command) and the summary of a replay.
+ */
+namespace Startup {
+
+    //! Notes that the editor has started. The first phase begins now.
+    void begin();
+
+    //! Notes that a phase of startup has just finished.
+    /*!
+     * \param name What was done in the phase. It must be a string literal (see Trace).
+     */
+    void finished(const char *name);
+
+    //! Notes that the first frame has been shown. Startup is then over; later calls do nothing.
+    void first_frame();
+
+    //! Returns the number of nanoseconds from begin to the first frame (zero before it).
+    long long total();
+
+    //! Returns lines of text describing the time taken by each phase.
+    std::vector<std::string> report();
+
+} // namespace Startup
+
+#endif
@@ -0,0 +1,69 @@
+/*! \file    SymbolIndex.hpp
+ *  \brief   Interface to the SymbolIndex abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef SYMBOLINDEX_HPP
+#define SYMBOLINDEX_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Encloses functions that find where the symbols of a project are defined.
+/*!
+ * The definitions are listed in a tags file in the format of ctags, named "tags" in the
+ * current directory. The first time a tags file is used its lines are sorted into a binary
+ * table kept beside it (.tags.yxs). The table is mapped into memory and holds an array of the
+ * offsets of its records in order of their names, so finding a symbol is a binary search. The
+ * tags file is not read again until it changes. A tags file can be made by ctags or generated
+ * by the editor itself (see generate).
+ *
+ * Files modified after the tags file was written are indexed again, one at a time, when they
+ * might hold a symbol being looked up: open files that have been modified, and those named by
+ * the symbol's definitions that have changed on disk. Their definitions are kept in memory and
+ * take the place of those in the table.
+ */
+namespace SymbolIndex {
+
+    //! Where a symbol is defined.
+    struct Symbol {
+        std::string name;
+        std::string file;    //!< Relative to the directory holding the tags file.
+        long line;           //!< The line of the definition (-1 if only pattern is known).
+        std::string pattern; //!< The text of the line, as a ctags search pattern "/^...$/".
+        char kind;           //!< The kind of definition as ctags gives it (for example 'f').
+    };
+
+    //! Finds the definitions in the text of a source file in a language like C.
+    /*!
+     * As for C_YEditFile a definition is found where a line opens a brace at the outermost
+     * level, although braces opened by namespaces and extern "C" are not counted. Functions,
+     * classes, structures, unions, and enumerations are recognized.
+     */
+    void scan(std::string_view text, const std::string &file, std::vector<Symbol> &symbols);
+
+    //! Writes a tags file for the sources in the current directory and those below it.
+    /*!
+     * The files are scanned by worker threads.
+     *
+     * \return false if the tags file could not be written. An error message has been displayed.
+     */
+    bool generate();
+
+    //! Finds the definitions of a symbol.
+    /*!
+     * \return false if there is no tags file. An error message has been displayed.
+     */
+    bool find(const std::string &name, std::vector<Symbol> &found);
+
+    //! Makes the file holding a definition active with the cursor at the definition.
+    /*!
+     * The file is loaded if necessary. The line is found from the pattern if no line is given
+     * or the line given does not match.
+     */
+    bool jump(const Symbol &symbol);
+
+} // namespace SymbolIndex
+
+#endif
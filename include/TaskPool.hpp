@@ -0,0 +1,97 @@
+/*! \file    TaskPool.hpp
+ *  \brief   Interface to the TaskPool abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef TASKPOOL_HPP
+#define TASKPOOL_HPP
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "EventLoop.hpp"
+
+//! Encloses the threads that do the editor's work in the background.
+/*!
+ * There is one worker thread for each core, started when the first task is submitted. Each
+ * worker has a queue of its own for each priority. Tasks submitted by a worker go on its own
+ * queue and it takes the latest first, since their data is likely still in its cache. Tasks
+ * submitted by other threads go on a shared queue. A worker with nothing of its own to do
+ * takes the oldest task of another worker (work stealing), so a task that splits itself up
+ * keeps every core busy. Workers always take the most urgent task they can find.
+ *
+ * Tasks that wait for something other than the CPU (a pipe, a lock held for long, or another
+ * task not in their group) would keep a worker from the others and should have a thread of
+ * their own instead. A task must not let an exception escape.
+ */
+namespace TaskPool {
+
+    //! How urgent a task is.
+    enum Priority {
+        INTERACTIVE, //!< The user is waiting for the result.
+        BACKGROUND,  //!< The result is wanted soon but nobody is waiting for it.
+        IDLE,        //!< Run only when nothing else is to be done.
+        PRIORITIES
+    };
+
+    typedef std::function<void()> Task;
+
+    //! Tells work that it is no longer wanted. Copies share one flag.
+    class CancelToken {
+      public:
+        CancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void cancel() const { flag->store(true, std::memory_order_relaxed); }
+        bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+      private:
+        std::shared_ptr<std::atomic<bool>> flag;
+    };
+
+    //! Returns the number of worker threads.
+    unsigned size();
+
+    //! Runs the task on a worker thread. May be called from any thread.
+    void submit(Task task, Priority priority = BACKGROUND);
+
+    //! Runs work on a worker thread and then finished on the main thread (see EventLoop::post).
+    /*!
+     * Neither is run if the token is cancelled first. Work that takes long should check the
+     * token itself now and then.
+     */
+    void submit(Task work, EventLoop::Callback finished, CancelToken token,
+                Priority priority = BACKGROUND);
+
+    //! Tasks that are waited for together.
+    /*!
+     * A thread waiting for a group runs the group's tasks that no worker has started yet, so
+     * waiting keeps the thread busy and can't deadlock, even on a worker. If no worker can be
+     * started at all, the waiting thread runs every task. The tasks of a group may add more
+     * tasks to it. Destroying a group waits for it.
+     */
+    class Group {
+      public:
+        explicit Group(Priority priority = INTERACTIVE);
+        ~Group() { wait(); }
+
+        Group(const Group &) = delete;
+        Group &operator=(const Group &) = delete;
+
+        void run(Task task);
+        void cancel();
+        bool busy() const;
+        void wait();
+
+        //! Returns the token cancelled by cancel(), which running tasks may check.
+        const CancelToken &token() const { return cancel_token; }
+
+      private:
+        struct State;
+        CancelToken cancel_token;
+        std::shared_ptr<State> state; //!< Shared with the tasks queued on the workers.
+    };
+
+} // namespace TaskPool
+
+#endif
@@ -6,30 +6,19 @@
 #ifndef TIMER_HPP
 #define TIMER_HPP
 
-#include <screen/environ.hpp>
-
-#if eOPSYS == eWINDOWS
-#include <windows.h>
-#endif
-
-#if eOPSYS == ePOSIX
-#ifndef _XOPEN_SOURCE_EXTENDED
-#define _XOPEN_SOURCE_EXTENDED
-#endif
-#include <sys/time.h>
-#endif
+#include <chrono>
 
 namespace spica {
 
     //! Stopwatch-like timer objects.
     /*!
-     * Objects from class Timer are useful for timing relatively long events in programs. They
-     * use the system clock as a base for generating time delays and thus are not suitable (in
-     * most cases) for short delays.
+     * Objects from class Timer are useful for timing events in programs, from the long to the
+     * very short. They use a monotonic clock (std::chrono::steady_clock) and keep time to the
+     * nanosecond, as far as the system's clock allows. They are not fooled if the system clock
+     * is changed during the timing interval.
      *
      * Timers do not load the system in any way while they are timing. Only when they are
-     * started and stopped do they check the system clock. They can thus be fooled if the system
-     * clock is changed during the timing interval.
+     * started and stopped do they check the clock.
      *
      * Timers allow for multiple starts and stops. In addition, their internal state can be
      * obtained by client code.
@@ -43,21 +32,12 @@ namespace spica {
             STOPPED  //!< Timer is not active. Accumulated time remembered.
         };
 
-#if eOPSYS == eWINDOWS
-        typedef LARGE_INTEGER timer_t;
-#endif
-
-#if eOPSYS == ePOSIX
-        struct timer_t {
-            time_t seconds;
-            int milliseconds;
-        };
-#endif
+        typedef std::chrono::steady_clock clock_type;
 
       private:
-        timer_t start_time;         //!< Time that the timer was last started.
-        timer_t accumulated;        //!< Total accumulated time.
-        timer_state internal_state; //!< Current state of timer object.
+        clock_type::time_point start_time; //!< Time that the timer was last started.
+        clock_type::duration accumulated;  //!< Total accumulated time.
+        timer_state internal_state;        //!< Current state of timer object.
 
       public:
         //! Constructs a Timer object.
@@ -101,6 +81,13 @@ namespace spica {
          * time. The state of the timer is unchanged.
          */
         long time();
+
+        //! Read the timer in nanoseconds.
+        /*!
+         * This function is like `time` except that the accumulated time is returned in
+         * nanoseconds. It is meant for timing short events.
+         */
+        long long nanoseconds();
     };
 
 } // namespace spica
@@ -0,0 +1,65 @@
+/*! \file    Trace.hpp
+ *  \brief   Interface to the Trace abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+//! Encloses functions that record a timeline of what the editor does, for later study.
+/*!
+ * Tracing is off until start() is called. While it is on, the profiling zones (see Profiler),
+ * the keystrokes read from the keyboard, the tasks done on worker threads, and the memory of
+ * each subsystem (see Allocations) are recorded as events with the time they happened. Each
+ * thread records into a ring of its own without locking; once a ring is full its oldest events
+ * are overwritten. Rings are allocated when a thread first records an event and are reused by
+ * later threads once their thread ends.
+ *
+ * The events are written by stop() in the Chrome trace event format, which can be viewed with
+ * chrome://tracing or Perfetto. The names and categories given to these functions must be
+ * string literals (or otherwise outlive the trace) that need no escaping in JSON.
+ */
+namespace Trace {
+
+    //! Starts recording events, forgetting any recorded before.
+    void start();
+
+    //! Returns true if events are being recorded.
+    bool active();
+
+    //! Returns the time in nanoseconds, on the clock used for the events.
+    long long now();
+
+    //! Records something that started at start and took duration nanoseconds.
+    void complete(const char *name, const char *category, long long start, long long duration);
+
+    //! Records something that happened now, with a value to show with it.
+    void instant(const char *name, const char *category, long value);
+
+    //! Records the value a counter has now. Counters are drawn as charts by the viewers.
+    void counter(const char *name, const char *category, long value);
+
+    //! Stops recording events and writes those recorded to a file.
+    long stop(const char *file_name);
+
+    //! Records the task done by the block in which it is declared.
+    class Span {
+      public:
+        explicit Span(const char *name) : name(name), start(active() ? now() : -1) {}
+        ~Span()
+        {
+            if (start >= 0)
+                complete(name, "task", start, now() - start);
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+      private:
+        const char *name;
+        long long start; // Negative if tracing was off when the task started.
+    };
+
+} // namespace Trace
+
+#endif
@@ -0,0 +1,25 @@
+/*! \file    UndoEditFile.hpp
+ *  \brief   Interface to class UndoEditFile.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef UNDOEDITFILE_HPP
+#define UNDOEDITFILE_HPP
+
+#include "EditFile.hpp"
+
+//! Adds undo and redo to an EditFile.
+/*!
+ * The modifications themselves are recorded in EditFile's undo_log by the classes that make
+ * them. This class replays that log.
+ */
+class UndoEditFile : private virtual EditFile {
+  public:
+    //! Reverses the most recent command's modifications. Returns false if there are none.
+    bool undo();
+
+    //! Performs again the most recently undone modifications. Returns false if there are none.
+    bool redo();
+};
+
+#endif
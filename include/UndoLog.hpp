@@ -0,0 +1,115 @@
+/*! \file    UndoLog.hpp
+ *  \brief   Interface to class UndoLog
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef UNDOLOG_HPP
+#define UNDOLOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "EditList.hpp"
+#include "FilePosition.hpp"
+#include "MappedFile.hpp"
+
+//! Journal of the modifications made to a file's data.
+/*!
+ * Each modification is recorded as a compact operation rather than as a copy of the file.
+ * Changes within a line are splices (the text removed and the text inserted at a column).
+ * Changes to whole lines, such as splitting or joining lines and inserting or deleting blocks,
+ * save copies of the lines they replace. Since copies of an EditBuffer share its text, saving
+ * even a large block of lines does not copy any text. Operations are grouped by the command
+ * that performed them so that one undo reverses everything done by one keystroke (or macro).
+ * Consecutive typing, backspacing, or deleting on one line coalesces into a single operation.
+ *
+ * The memory used by each log is bounded. When the limit is exceeded the oldest groups are
+ * forgotten. An operation too large to fit under the limit can't be undone at all; it clears
+ * the log instead.
+ *
+ * A log can also be kept with its file between sessions (see write_history). The groups kept by
+ * an earlier session stay in the mapped image of the history until they are undone, and are
+ * then decoded one group at a time. The image records a hash of the file's lines at the end of
+ * each session, so an image that no longer matches the file is dropped when it is reached.
+ */
+class UndoLog {
+  public:
+    UndoLog();
+
+    // Operations refer to lines of one particular file.
+    UndoLog(const UndoLog &) = delete;
+    UndoLog &operator=(const UndoLog &) = delete;
+
+    void record_text(EditList &data, const FilePosition &cursor, long line,
+                     std::size_t column, std::size_t old_length, std::string_view removed,
+                     std::string_view inserted);
+    void record_lines(EditList &data, const FilePosition &cursor, long first, long count);
+
+    bool undo(EditList &data, long &first_line, long &tail, long &cursor_line,
+              unsigned &cursor_column);
+    bool redo(EditList &data, long &first_line, long &tail, long &cursor_line,
+              unsigned &cursor_column, unsigned tab);
+    void clear();
+
+    bool open_history(std::unique_ptr<MappedFile> image);
+    bool write_history(EditList &data, std::string &image);
+
+    //! Starts a new group. Modifications made until the next call are undone together.
+    static void next_command() { ++current_command; }
+
+    //! Sets the number of bytes each log may use.
+    static void set_limit(std::size_t bytes) { limit = bytes; }
+
+    //! Returns the number of bytes each log may use.
+    static std::size_t get_limit() { return limit; }
+
+  private:
+    enum Kind { TEXT, LINES, CHECK }; // CHECK only appears in history images.
+
+    struct Operation {
+        Kind kind;
+        unsigned long command;  //!< The group to which this operation belongs.
+        long line;              //!< TEXT: The line. LINES: The first line replaced.
+        std::size_t column;     //!< TEXT: The column of the splice.
+        std::size_t old_length; //!< TEXT: The length of the line before the splice.
+        long old_count;         //!< LINES: The number of lines saved in lines.
+        long new_count;         //!< LINES: Lines that replaced them (-1 if unknown).
+        long size_before;       //!< LINES: The size of the file when recorded.
+        std::string removed;    //!< TEXT: The text removed by the operation.
+        std::string inserted;   //!< TEXT: The text inserted by the operation.
+        std::unique_ptr<EditList> lines; //!< LINES: The lines replaced.
+        std::size_t line_bytes; //!< LINES: The approximate length of the saved lines.
+        long cursor_line;       //!< The current point when the operation was recorded.
+        unsigned cursor_column;
+
+        std::size_t bytes() const;
+    };
+
+    std::deque<Operation> done;   //!< Operations that can be undone, oldest first.
+    std::deque<Operation> undone; //!< Operations that can be redone, most recent last.
+    std::size_t used;             //!< Bytes used by the operations in both lists.
+    bool sealed;                  //!< True if the last done operation must not be extended.
+    unsigned long discarded;      //!< A group that was too large to record (0 if none).
+    std::unique_ptr<MappedFile> history; //!< Groups kept by earlier sessions (if any).
+    std::size_t history_end;      //!< The end of the part of history not yet undone.
+    bool history_checked;         //!< True once the history has been found to match the file.
+
+    static unsigned long current_command;
+    static unsigned long history_command;
+    static std::size_t limit;
+
+    void close(EditList &data);
+    bool can_extend(long line) const;
+    void add(Operation &operation);
+    void enforce_limit();
+    bool take_history(EditList &data);
+    void drop_history() { history.reset(); }
+    static std::uint64_t content_hash(EditList &data);
+    static void apply(EditList &data, Operation &operation, bool forward, long &tail);
+};
+
+#endif
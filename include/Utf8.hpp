@@ -0,0 +1,51 @@
+/*! \file    Utf8.hpp
+ *  \brief   Interface to the Utf8 functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <cstddef>
+#include <string_view>
+
+//! Encloses functions that locate the characters of UTF-8 text and the columns they occupy.
+/*!
+ * A character starts at every byte that is not a continuation byte (10xxxxxx) and at the start
+ * of the text; continuation bytes belong to the character before them. Thus text that is not
+ * valid UTF-8 is still divided into characters consistently and none of its bytes are lost.
+ *
+ * Each character occupies one column on the screen except a tab, which extends to the next tab
+ * stop. Tab stops are every tab columns, where tab is at least one. EditBuffer uses these
+ * functions to map between the columns and offsets of its text.
+ */
+namespace Utf8 {
+
+    //! Returns true if the byte is a continuation byte of a multi-byte character.
+    inline bool is_continuation(const char byte)
+    {
+        return (static_cast<unsigned char>(byte) & 0xC0) == 0x80;
+    }
+
+    //! Returns true if none of the size bytes at text have the high bit set.
+    bool is_ascii(const char *text, std::size_t size);
+
+    //! Returns the number of characters in text.
+    std::size_t characters(std::string_view text);
+
+    //! Returns the column following a character that starts with first_byte at column.
+    inline std::size_t advance(const std::size_t column, const char first_byte,
+                               const unsigned tab)
+    {
+        return (first_byte == '\t') ? column + tab - column % tab : column + 1;
+    }
+
+    //! Returns the offset of the character following the one at offset.
+    std::size_t next(std::string_view text, std::size_t offset);
+
+    //! Returns the offset of the character preceding the one at offset (zero stays zero).
+    std::size_t previous(std::string_view text, std::size_t offset);
+
+} // namespace Utf8
+
+#endif
@@ -13,6 +13,7 @@ class WPEditFile : private virtual EditFile {
   public:
     //! Reformats paragraph containing the current point.
     bool reformat_paragraph();
+    bool reformat_block();
 };
 
 #endif
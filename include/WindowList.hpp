@@ -0,0 +1,84 @@
+/*! \file    WindowList.hpp
+ *  \brief   Interface to the WindowList abstract object
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef WINDOWLIST_HPP
+#define WINDOWLIST_HPP
+
+#include <string>
+
+class YEditFile;
+
+//! Encloses functions that arrange the windows showing files on the screen.
+/*!
+ * The screen is tiled with windows (see FileWindow) managed by a scr::Manager. Initially there
+ * is one window filling the screen. Windows are divided in two by split(), either one above the
+ * other or side by side, and the space of a closed window is given back to the window it was
+ * divided from. Any window can show any file, and several windows can show the same file.
+ *
+ * One window is active. It shows FileList::active_file() and the commands work there, so
+ * switching to another window also makes its file the active file. Each frame, display()
+ * paints every window's image and the manager composites them on the screen.
+ *
+ * The performance overlay is a small window in front of the others, at the top right of the
+ * screen, showing the figures from Renderer::overlay(). They are brought up to date by each
+ * display() before the screen is. A prompt line (see show_prompt) may likewise be kept in
+ * front of the bottom row while a command reads keys of its own.
+ */
+namespace WindowList {
+
+    //! Paints every window and brings the screen up to date.
+    void display();
+
+    //! Makes the next display() redraw the entire screen (for example after a shell escape).
+    void invalidate();
+
+    //! Returns true if the file is shown in some window.
+    bool shows(const YEditFile *file);
+
+    //! Forgets a file that is being removed from the file list.
+    /*!
+     * The windows showing it show the active file instead once the file list has been updated.
+     */
+    void forget(const YEditFile *file);
+
+    //! Divides the active window in two. The new window shows the active file and is active.
+    /*!
+     * \param side_by_side True to put the new window to the right of the old one rather than
+     * below it.
+     * \return false if the window is too small to divide. An error message has been displayed.
+     */
+    bool split(bool side_by_side);
+
+    //! Makes the next window active, and with it the file it shows.
+    void next();
+
+    //! Closes the active window and activates one of its neighbours.
+    /*!
+     * \return false if this is the only window. An error message has been displayed.
+     */
+    bool close();
+
+    //! Returns the number of windows on the screen.
+    unsigned count();
+
+    //! Returns the screen coordinates of the top left corner of the active window's text.
+    void text_origin(int &row, int &column);
+
+    //! Shows the performance overlay if it is hidden, otherwise hides it.
+    void toggle_overlay();
+
+    //! Shows a line of text in a box across the bottom of the screen, in front of the windows.
+    /*!
+     * The cursor stays in the active window. The line is kept until hide_prompt is called, and
+     * calling this again replaces its text.
+     */
+    void show_prompt(const std::string &text);
+
+    //! Removes the line shown by show_prompt, if any.
+    void hide_prompt();
+
+} // namespace WindowList
+
+#endif
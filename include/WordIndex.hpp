@@ -0,0 +1,46 @@
+/*! \file    WordIndex.hpp
+ *  \brief   Interface to class WordIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef WORDINDEX_HPP
+#define WORDINDEX_HPP
+
+#include <cstddef>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "EditDelta.hpp"
+
+class EditBuffer;
+
+//! Where the words of the lines of a file start and end.
+/*!
+ * A word is a run of letters and digits, with every character outside of ASCII taken to be a
+ * letter (as word_right does). A line is scanned when it is first asked about and its words
+ * are remembered until it is modified, so moving by words along a long line, or repeating the
+ * motion in a macro, looks the words up instead of examining the characters again.
+ */
+class WordIndex {
+  public:
+    static void split(std::string_view text, std::vector<std::size_t> &bounds);
+
+    std::size_t start_from(long line, const EditBuffer &text, std::size_t offset);
+    std::size_t start_before(long line, const EditBuffer &text, std::size_t offset);
+    bool word_at(long line, const EditBuffer &text, std::size_t offset, std::size_t &start,
+                 std::size_t &end);
+    void invalidate(const EditDelta &change);
+
+  private:
+    //! The lines whose words are remembered are forgotten when there are this many.
+    static constexpr std::size_t maximum_lines = 4096;
+
+    //! The lines scanned since they were last modified. For each line, the offset where each
+    //! word starts followed by the offset just past its end.
+    std::map<long, std::vector<std::size_t>> lines;
+
+    const std::vector<std::size_t> &scan(long line, const EditBuffer &text);
+};
+
+#endif
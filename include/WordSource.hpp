@@ -7,9 +7,16 @@
 #define WORDSOURCE_HPP
 
 #include <cstddef>
-#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "EditBuffer.hpp"
+#include "MacroProgram.hpp"
+#include "MacroTokenizer.hpp"
+#include "parameter_stack.hpp"
 
 /*!
  * An abstract base class from which the various types that can provide macro words are defined.
@@ -18,87 +25,176 @@
  */
 class WordSource {
   public:
-    WordSource() : current_state(NORMAL) {}
     virtual ~WordSource() { return; }
 
     /*!
      * Returns the next word from the word source by way of its parameter. Returns false if
      * there are no more words left (in which case the parameter is unchanged); otherwise it
-     * returns true. This function makes multiple calls on the virtual functions get() and
-     * unget() to read the actual word source.
+     * returns true. Strings in the source are pushed onto the parameter stack as they are
+     * passed. A true result with a null word means the source did the work of a word itself.
      */
-    virtual bool get_word(EditBuffer &word);
-
-  private:
-    // These states are used by the finite state machine in get_word() used to extract words.
-    enum State {
-        NORMAL,
-        COMMENT,
-        COLLECT_NAME,
-        STRING,
-        ESC,
-        BIG_STRING,
-        BIG_WHITE,
-        BIG_COMMENT,
-        BIG_QUOTE,
-        BIG_ESC
-    };
-
-    // Initially NORMAL.
-    State current_state;
+    virtual bool get_word(EditBuffer &word) = 0;
 
+    //! Returns false if the source must wait for something before it can give its next word.
     /*!
-     * Returns the next character from the word source or EOF if source is empty. Repeated calls
-     * against an empty source will continue to return EOF.
+     * While the source at the top of the macro stack is waiting the macro is suspended: the
+     * main loop runs the event loop instead (see get_word in macro_stack.cpp). A source that
+     * waits for anything other than a keystroke must be ready once a key has been pressed.
      */
-    virtual int get() = 0;
+    virtual bool ready() { return true; }
 
-    /*!
-     * Pushs the given character back into the word source so that the next call to get() will
-     * return that character. It is undefined to unget() to a word source for which has not yet
-     * had a call to get(). Only one level of push back is supported.
-     */
-    virtual void unget(int ch) = 0;
+    //! Returns the name under which the source is counted (see MacroProfile).
+    virtual std::string_view name() const = 0;
 };
 
 //! The following class encapsulates a source of words that are stored in a string.
+/*!
+ * The text is scanned in place by a MacroTokenizer, so taking a word involves no allocation
+ * beyond what the parameter stack and the word itself need.
+ */
 class StringWord : public WordSource {
   public:
-    explicit StringWord(const char *const source_string)
-        : WordSource(), string_buffer(source_string), length(string_buffer.length()), offset(0)
+    explicit StringWord(std::string_view source_string)
+        : WordSource(), text(source_string), tokens(text)
     {
     }
 
-  private:
-    EditBuffer string_buffer; //!< The text in question.
-    std::size_t length;       //!< The number of characters in string_buffer.
-    std::size_t offset;       //!< Current get() location.
+    StringWord(const StringWord &) = delete;
+    StringWord &operator=(const StringWord &) = delete;
 
-    virtual int get();
-    virtual void unget(int ch);
+    virtual bool get_word(EditBuffer &word);
+    virtual std::string_view name() const { return "string"; }
+
+  protected:
+    StringWord() : WordSource(), tokens(text) {}
+
+    //! Replaces the text (and starts scanning it from the beginning).
+    void set_text(std::string new_text)
+    {
+        text = std::move(new_text);
+        tokens = MacroTokenizer(text);
+    }
+
+  private:
+    std::string text;      //!< The text in question.
+    MacroTokenizer tokens; //!< Scans text.
 };
 
 //! Objects of this class take words from the keyboard.
 class KeyboardWord : public WordSource {
   public:
     virtual bool get_word(EditBuffer &word);
-
-  private:
-    virtual int get();
-    virtual void unget(int ch);
+    virtual std::string_view name() const { return "keyboard"; }
 };
 
 //! The following class encapsulates a source of words that are stored in a text file.
-class FileWord : public WordSource {
+/*!
+ * The whole file is read when the object is constructed.
+ */
+class FileWord : public StringWord {
   public:
     explicit FileWord(const char *file_name);
-    ~FileWord();
+
+    virtual std::string_view name() const { return file_name; }
+
+  private:
+    std::string file_name;
+};
+
+/*!
+ * Objects of this class execute a compiled macro program. Constants are pushed onto the
+ * parameter stack directly and commands are executed by their dispatch table index. The origin
+ * names where the program came from, such as the file it was compiled from.
+ */
+class ProgramWord : public WordSource {
+  public:
+    ProgramWord(std::shared_ptr<const MacroProgram> program, std::string origin)
+        : WordSource(), program(std::move(program)), origin(std::move(origin)),
+          next_instruction(0)
+    {
+    }
+
+    virtual bool get_word(EditBuffer &word);
+    virtual std::string_view name() const { return origin; }
+
+  private:
+    std::shared_ptr<const MacroProgram> program; //!< The program being executed.
+    std::string origin;                          //!< Where the program came from.
+    std::size_t next_instruction;                //!< Index of the next instruction.
+};
+
+//! Objects of this class replay the learned keyboard macro (see MacroTrace).
+/*!
+ * The keystrokes' programs are run as a KeyboardWord would run them. The screen is only
+ * updated when keys are next read from the terminal, or now and then if the replay runs for
+ * long, so however many times the macro is replayed the display is painted about once.
+ */
+class TraceWord : public WordSource {
+  public:
+    explicit TraceWord(int repeats);
+    virtual ~TraceWord();
+
+    virtual bool get_word(EditBuffer &word);
+    virtual std::string_view name() const { return "keyboard macro"; }
+
+  private:
+    int repeats_left; //!< Replays to do after the current one.
+};
+
+//! Objects of this class let the user type a line of input, with the macro suspended meanwhile.
+/*!
+ * The input is read a keystroke at a time, so events are dispatched while the user types. The
+ * text typed is pushed onto the parameter stack when the user presses Enter, or an empty
+ * string if the input is cancelled.
+ */
+class PromptWord : public WordSource {
+  public:
+    //! Opens the input box, or takes the input from a keyboard macro being replayed.
+    explicit PromptWord(std::string prompt);
+
+    PromptWord(const PromptWord &) = delete;
+    PromptWord &operator=(const PromptWord &) = delete;
+
+    virtual bool get_word(EditBuffer &word);
+    virtual bool ready();
+    virtual std::string_view name() const { return "input"; }
+
+  private:
+    std::string prompt_text;  //!< The prompt shown. It must outlive the input.
+    Parameter input;          //!< The line being typed.
+    Parameter::Status status; //!< Updated as keys are handled.
+};
+
+//! Objects of this class push the next keystroke onto the parameter stack (see getch).
+class KeyWord : public WordSource {
+  public:
+    virtual bool get_word(EditBuffer &word);
+    virtual bool ready();
+    virtual std::string_view name() const { return "getch"; }
 
   private:
-    std::FILE *input_file;
+    bool shown = false; //!< =true once the display has been brought up to date.
+};
 
-    virtual int get();
-    virtual void unget(int ch);
+//! Objects of this class suspend the macro until some work in the background is finished.
+/*!
+ * A keystroke ends the wait early. It is left for whatever reads keys next.
+ */
+class WaitWord : public WordSource {
+  public:
+    //! The wait lasts until finished returns true. It is called on the main thread.
+    explicit WaitWord(std::function<bool()> finished)
+        : WordSource(), finished(std::move(finished))
+    {
+    }
+
+    virtual bool get_word(EditBuffer &word);
+    virtual bool ready();
+    virtual std::string_view name() const { return "wait_background"; }
+
+  private:
+    std::function<bool()> finished;
+    bool shown = false; //!< =true once the display has been brought up to date.
 };
 
 /*!
@@ -108,4 +204,10 @@ class FileWord : public WordSource {
  */
 void modify_key_association(const char *key_name, const char *new_macro_text);
 
+//! Returns the code of the key with the given name (as used by define_key), or -1 if none.
+int key_code(const char *key_name);
+
+//! Returns the name of the key with the given code, or nullptr if it has no name.
+const char *key_name(int key_code);
+
 #endif
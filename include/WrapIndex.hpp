@@ -0,0 +1,94 @@
+/*! \file    WrapIndex.hpp
+ *  \brief   Interface to class WrapIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef WRAPINDEX_HPP
+#define WRAPINDEX_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "EditDelta.hpp"
+
+class EditBuffer;
+class EditList;
+
+//! The rows that the lines of a file occupy on the screen when lines are wrapped or folded.
+/*!
+ * When long lines are wrapped a line wider than the window is broken into rows after the last
+ * space that fits, or at the window's edge if a word is wider than the window. The points where
+ * each line breaks are cached. They are computed again only for the lines that are modified, or
+ * for every line when the width of the window or the distance between tab stops changes. Lines
+ * that are not wrapped occupy one row each.
+ *
+ * Lines hidden in a fold occupy no rows. A fold is a run of hidden lines; the visible line just
+ * before it is the fold's header. Lines inserted into a fold are not hidden.
+ *
+ * The numbers of rows are kept in a Fenwick (binary indexed) tree so that the row on which a
+ * line starts, and the line shown on a given row, are found in logarithmic time however long
+ * the file is and however many lines are hidden. The lines past the end of the file occupy one
+ * row each.
+ */
+class WrapIndex {
+  public:
+    //! Where a row of a wrapped line starts.
+    struct Break {
+        std::size_t offset; //!< The offset of the first character on the row.
+        std::size_t column; //!< The column of that character.
+    };
+
+    WrapIndex() = default;
+
+    void reset();
+    void invalidate(const EditDelta &change);
+    void update(EditList &data, unsigned width, unsigned tab);
+
+    void hide(long first_line, long last_line);
+    long unfold(long header);
+    long reveal(long line);
+
+    //! Returns true if the line is hidden in a fold.
+    bool hidden(const long line) const
+    {
+        return line >= 0 && line < static_cast<long>(lines.size()) && lines[line].hidden;
+    }
+
+    //! Returns true if the line is visible and the lines after it are folded.
+    bool folded_after(const long line) const { return !hidden(line) && hidden(line + 1); }
+
+    //! Returns the number of lines hidden in folds.
+    long hidden_lines() const { return hidden_count; }
+
+    long row_of(long line) const;
+    long line_at(long row) const;
+    unsigned rows(long line) const;
+    Break row_start(long line, unsigned row) const;
+    unsigned row_containing(long line, std::size_t column) const;
+
+  private:
+    struct Line {
+        std::vector<Break> breaks; //!< The starts of the rows after the first.
+        bool hidden = false;
+    };
+
+    bool ready = false; //!< =true if the lines have been wrapped.
+    unsigned width = 0; //!< The width of the rows (zero if lines are not wrapped).
+    unsigned tab = 0;   //!< The distance between tab stops used.
+
+    std::vector<Line> lines;
+    long hidden_count = 0;
+    long stale_first = 0; //!< The lines [stale_first, stale_end) must be wrapped again.
+    long stale_end = 0;
+    bool recount = false; //!< =true if the tree must be built again.
+
+    //! The Fenwick tree of the numbers of rows. Element i covers lines [i - (i & -i), i).
+    std::vector<long> tree;
+
+    void wrap_line(const EditBuffer &line, std::vector<Break> &result) const;
+    void set_hidden(long line, bool flag);
+    void add_rows(long line, long count);
+    void build_tree();
+};
+
+#endif
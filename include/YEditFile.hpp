@@ -6,18 +6,34 @@
 #ifndef YEDITFILE_HPP
 #define YEDITFILE_HPP
 
+#include <climits>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <screen/ImageBuffer.hpp>
 
 #include "BlockEditFile.hpp"
 #include "CharacterEditFile.hpp"
 #include "CursorEditFile.hpp"
+#include "Diagnostics.hpp"
+#include "DocumentStats.hpp"
 #include "DiskEditFile.hpp"
 #include "EditBuffer.hpp"
 #include "EditFile.hpp"
+#include "Highlighter.hpp"
+#include "LineDiff.hpp"
 #include "LineEditFile.hpp"
+#include "MatchCache.hpp"
+#include "ProcedureIndex.hpp"
 #include "SearchEditFile.hpp"
+#include "SpellCache.hpp"
+#include "UndoEditFile.hpp"
 #include "WPEditFile.hpp"
+#include "WordIndex.hpp"
+#include "WrapIndex.hpp"
 
+class FieldIndex;
 class FileDescriptor;
 
 class YEditFile : public virtual EditFile,  // Needed to ctor and dtor virtual base.
@@ -27,13 +43,93 @@ class YEditFile : public virtual EditFile,  // Needed to ctor and dtor virtual b
                   public DiskEditFile,      //    ... disk I/O.
                   public LineEditFile,      //    ... line operations.
                   public SearchEditFile,    //    ... search and replace.
+                  public UndoEditFile,      //    ... undo and redo.
                   public WPEditFile         //    ... simple word processing.
 {
   private:
     std::string file_name; // Name of file.
     int color;             // Color attribute for text.
+    bool read_only;        // True if the user may not modify the text.
+    unsigned long use_stamp = 0; // When the file was last seen in use (see FileList).
+
+    ProcedureIndex outline; // Procedures and scopes in the file, if this type has them.
+    Highlighter highlighter; // Lexer states of the lines, if files of this type are colored.
+    std::vector<Highlighter::Token> tokens; // The tokens of the line being displayed.
+    Diagnostics problems;   // Reported by the language server for the file, if any.
+    std::vector<LineDiff::Hunk> differences; // From another file (see set_differences).
+    bool differences_old = false; // True if this file is the old version in the hunks.
+    long redecorate_top = -1L; // Rows whose diagnostics changed since the last display...
+    long redecorate_bottom = -2L; //   ... through this one.
+    MatchCache matches;     // Occurrences of the highlighted pattern on the lines shown.
+    DocumentStats counts;   // Characters, words, and the longest line, once asked for.
+    SpellCache misspelled;  // Misspelled words on the lines shown, if spelling is checked.
+    bool wrapping = false;  // True if long lines are wrapped to the window's width...
+    WrapIndex wraps;        //   ... at these points. Also records the folded lines.
+    WordIndex words;        // Where the words start and end on the lines moved along.
+
+    static unsigned long display_epoch; // Changed when every image must be repainted.
+    static const SearchPattern *highlighted; // Pattern whose occurrences are shown, if any.
+    static bool spelling;   // True if misspelled words are shown in files that are prose.
+
+    void collect_changes();
+    bool differs(long line) const;
+    void update_rows(unsigned width);
+    long fold_header(long head);
+    long fold_range(long line, long &last);
+    FieldIndex *aligned_fields();
+    unsigned shown_column(const FilePosition &position);
+    bool move_to_field(bool forward);
+    WordIndex &word_index();
+
+  protected:
+    bool find_procedure(bool forward);
+    void index_through(long line);
+    bool opens_scope(long line);
+
+    //! Returns the language used to color files of this type, or nullptr if they aren't.
+    virtual const Language *language() { return nullptr; }
+
+    //! Returns true if files of this type contain procedures that can be indexed.
+    virtual bool has_procedures() { return false; }
+
+    //! Returns true if the line starts a procedure.
+    /*!
+     * \param line The text of the line.
+     * \param outline The index being built. Scopes opened and closed by the line are reported
+     * to it with open_scope and close_scope.
+     */
+    virtual bool procedure_line(std::string_view line, ProcedureIndex &outline);
+
+    //! Returns the first line of the procedure identified by the given line.
+    virtual long procedure_head(long line) { return line; }
+
+    //! Returns true if files of this type are prose whose spelling can be checked.
+    virtual bool checks_spelling() { return false; }
 
   public:
+    // What an image showed after the last call to display(). Used to repaint incrementally.
+    struct DisplayState {
+        bool valid = false;     // False if the image must be completely repainted.
+        unsigned long epoch = 0; // Value of display_epoch when the image was painted.
+        int rows = 0;           // Image dimensions.
+        int columns = 0;
+        int color = 0;          // Color attribute used for the text.
+        bool active = false;    // True if the image was painted for the active window.
+        long window_line = 0;   // Window position.
+        unsigned window_column = 0;
+        unsigned window_row = 0; // Row of the top line at the top, if lines are wrapped.
+        long scrolled = 0;      // Rows the text moved up in the last display (down if < 0).
+        bool changed = false;   // State of the modified flag.
+        bool insert = false;    // True if insert mode was shown.
+        bool block = false;     // True if a block was highlighted...
+        long block_top = 0;     //   ... and its limits.
+        long block_bottom = -1;
+        unsigned block_left = 0; //   ... and columns (the whole row if not rectangular).
+        unsigned block_right = UINT_MAX;
+        std::string position;   // Text of the cursor position indicator.
+        std::vector<Caret> carets; // Extra cursors shown.
+    };
+
     //! Constructor.
     YEditFile(const char *name_of_file, int tab_distance, int file_color);
 
@@ -44,6 +140,28 @@ class YEditFile : public virtual EditFile,  // Needed to ctor and dtor virtual b
     const char *name() { return file_name.c_str(); }
     int color_attribute() { return color; }
 
+    //! Prevents (or allows) modifications by commands. See execute_command.
+    void set_read_only(bool flag) { read_only = flag; }
+    bool is_read_only() { return read_only; }
+
+    //! Returns true if read only means the lines can't change even once the file is modified.
+    /*!
+     * The modifications that files of this type make to themselves, rather than to their
+     * lines, are then allowed. See execute_command.
+     */
+    virtual bool has_fixed_lines() { return false; }
+
+    //! Returns the index of the fields of the lines if files of this type are tables.
+    virtual FieldIndex *fields() { return nullptr; }
+
+    //! Moves the cursor to the start of the next (or previous) field of its line in a table.
+    bool next_field();
+    bool previous_field();
+
+    //! Records when the file was in use. Files used least recently are evicted first.
+    void note_use(unsigned long stamp) { use_stamp = stamp; }
+    unsigned long last_use() { return use_stamp; }
+
     //! Adjusting color attribute. This function must update Screen also.
     void set_color(int new_column);
 
@@ -62,8 +180,106 @@ class YEditFile : public virtual EditFile,  // Needed to ctor and dtor virtual b
     virtual bool extra_indent();
     virtual bool insert_char(char);
 
-    //! Redraws entire display.
-    void display();
+    bool enclosing_scope();
+    bool index_procedures(long count);
+
+    // Moving by words and working on them (see WordIndex).
+    bool next_word();
+    bool previous_word();
+    bool delete_word();
+    bool select_word();
+
+    //! Wraps long lines to the window's width, or stops wrapping them.
+    void toggle_wrap();
+    bool is_wrapping() { return wrapping; }
+
+    //! Folds the procedure or scope around the cursor, or opens the fold the cursor heads.
+    bool toggle_fold();
+
+    //! Folds every procedure to its first line.
+    bool fold_procedures();
+
+    //! Opens every fold.
+    void unfold_all();
+
+    //! Returns true if the cursor moves by screen rows rather than lines (see WrapIndex).
+    bool moves_by_rows() { return wrapping || wraps.hidden_lines() != 0; }
+
+    //! Moves a window on a file whose lines are wrapped or folded so the cursor is inside it.
+    void align_window(FilePosition &position);
+
+    //! Gives the cursor's row and column in a window's text area, counted from zero.
+    void cursor_cell(const FilePosition &position, long &row, long &column);
+
+    //! Moves the cursor count rows down (up if negative). See moves_by_rows.
+    void move_rows(long count, bool page);
+
+    //! Paints this file into a window's image, repainting only what has changed.
+    bool display(scr::ImageBuffer &image, const FilePosition &position, bool active,
+                 DisplayState &shown);
+
+    //! Forgets the modifications once every window showing this file has been painted.
+    void finish_display()
+    {
+        clear_damage();
+        redecorate_top = -1L;
+        redecorate_bottom = -2L;
+    }
+
+    //! Returns the lines modified since the last call, for a language server.
+    EditDelta take_server_edits() { return take_modifications(LANGUAGE_SERVER); }
+
+    //! Returns the lines modified since the last call, for completion.
+    EditDelta take_word_edits() { return take_modifications(COMPLETION); }
+
+    //! Returns the lines modified since the last call, for plugins.
+    EditDelta take_plugin_edits() { return take_modifications(PLUGINS); }
+
+    //! Returns the statistics of the file's text, counting only the lines modified.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    const DocumentStats::Totals &statistics()
+    {
+        counts.invalidate(take_modifications(STATISTICS));
+        return counts.update(file_data);
+    }
+
+    //! Returns the problems reported by the file's language server.
+    const Diagnostics &diagnostics() const { return problems; }
+
+    //! Replaces the problems shown in the file.
+    void set_diagnostics(Diagnostics &&reported);
+
+    //! Moves the problems shown with the text when old_count lines at first become new_count.
+    void move_diagnostics(long first, long old_count, long new_count);
+
+    //! Shows the lines that differ from those of another file.
+    /*!
+     * \param hunks The differences between the files (see LineDiff::compare). An empty list
+     * shows none.
+     * \param old_version True if this file is the old version in the hunks.
+     */
+    void set_differences(const std::vector<LineDiff::Hunk> &hunks, bool old_version);
+
+    //! Highlights the occurrences of a pattern in every file (nullptr for none).
+    /*!
+     * The pattern is not copied. It must remain valid until this is called again, and this must
+     * be called again whenever it is recompiled.
+     */
+    static void show_matches(const SearchPattern *pattern);
+
+    //! Returns the pattern whose occurrences are highlighted (nullptr if none).
+    static const SearchPattern *shown_matches() { return highlighted; }
+
+    //! Shows (or stops showing) the misspelled words in files that are prose (see Spelling).
+    static void show_misspellings(bool flag);
+
+    //! Returns true if misspelled words are shown.
+    static bool shown_misspellings() { return spelling; }
+
+    //! Forces the next display() to repaint everything (for example after a shell escape).
+    static void invalidate_display() { ++display_epoch; }
 };
 
 #endif
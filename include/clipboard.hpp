@@ -11,4 +11,7 @@
 // TODO: The clipboard should probably be made into a class at some point.
 extern EditList clipboard;
 
+// True if the clipboard holds the columns of a rectangular block rather than whole lines.
+extern bool clipboard_columns;
+
 #endif
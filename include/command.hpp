@@ -13,9 +13,14 @@
 #define COMMAND_HPP
 
 extern bool add_text_command();
+extern bool align_fields_command();
 extern bool background_color_command();
 extern bool backspace_command();
 extern bool block_off_command();
+extern bool clear_cursors_command();
+extern bool close_window_command();
+extern bool column_cursors_command();
+extern bool complete_word_command();
 extern bool copy_block_command();
 extern bool CP_down_command();
 extern bool CP_left_command();
@@ -26,9 +31,15 @@ extern bool delete_command();
 extern bool delete_EOL_command();
 extern bool delete_SOL_command();
 extern bool delete_block_command();
+extern bool delete_word_command();
+extern bool diff_files_command();
 extern bool editor_info_command();
+extern bool enclosing_scope_command();
+extern bool error_list_command();
 extern bool error_message_command();
 extern bool execute_file_command();
+extern bool execute_lua_command();
+extern bool execute_lua_file_command();
 extern bool execute_macro_command();
 extern bool exit_command();
 extern bool external_command_command();
@@ -37,7 +48,12 @@ extern bool file_info_command();
 extern bool file_insert_command();
 extern bool filter_command();
 extern bool find_file_command();
+extern bool find_symbol_command();
+extern bool fold_procedures_command();
+extern bool follow_file_command();
 extern bool foreground_color_command();
+extern bool frame_info_command();
+extern bool fuzzy_find_command();
 extern bool goto_column_command();
 extern bool goto_file_end_command();
 extern bool goto_file_start_command();
@@ -45,40 +61,86 @@ extern bool goto_line_command();
 extern bool goto_line_end_command();
 extern bool goto_line_start_command();
 extern bool help_command();
+extern bool help_search_command();
+extern bool index_symbols_command();
 extern bool input_command();
 extern bool insert_command();
 extern bool insert_file_command();
 extern bool kill_file_command();
 extern bool legal_info_command();
+extern bool load_plugin_command();
+extern bool macro_profile_command();
+extern bool macro_profile_info_command();
+extern bool memory_info_command();
 extern bool new_line_command();
+extern bool next_diagnostic_command();
+extern bool next_error_command();
+extern bool next_field_command();
 extern bool next_file_command();
 extern bool next_procedure_command();
+extern bool next_window_command();
 extern bool page_down_command();
 extern bool page_up_command();
 extern bool pan_left_command();
 extern bool pan_right_command();
 extern bool paste_block_command();
+extern bool paste_text_command();
+extern bool previous_field_command();
 extern bool previous_file_command();
 extern bool previous_procedure_command();
+extern bool profile_info_command();
 extern bool quit_command();
-extern bool redirect_from_command();
+extern bool recent_file_command();
+bool redirect_from_command();
 extern bool redirect_to_command();
+extern bool redo_command();
+extern bool reformat_block_command();
 extern bool reformat_command();
 extern bool refresh_file_command();
 extern bool remove_file_command();
 extern bool rename_file_command();
 extern bool restricted_mode_command();
+extern bool reverse_lines_command();
 extern bool save_file_command();
 extern bool search_and_replace_command();
+extern bool search_all_command();
+extern bool search_files_command();
 extern bool search_first_command();
+extern bool search_highlight_command();
+extern bool search_incremental_command();
 extern bool search_next_command();
+extern bool select_word_command();
 extern bool set_bookmark_command();
+extern bool set_frame_interval_command();
+extern bool set_language_server_command();
+extern bool set_line_ending_command();
+extern bool set_memory_budget_command();
 extern bool set_tab_command();
+extern bool set_undo_limit_command();
 extern bool skip_left_command();
 extern bool skip_right_command();
+extern bool sort_lines_command();
+extern bool spell_check_command();
+extern bool split_window_command();
+extern bool split_window_beside_command();
 extern bool tab_command();
 extern bool toggle_block_command();
+extern bool toggle_column_block_command();
+extern bool toggle_cursor_command();
+extern bool toggle_fold_command();
+extern bool toggle_ignore_case_command();
+extern bool toggle_interning_command();
 extern bool toggle_bookmark_command();
+extern bool toggle_overlay_command();
+extern bool toggle_regex_command();
+extern bool toggle_undo_history_command();
+extern bool toggle_whole_word_command();
+extern bool toggle_wrap_command();
+extern bool trace_command();
+extern bool transform_lines_command();
+extern bool undo_command();
+extern bool unfold_all_command();
+extern bool unique_lines_command();
 extern bool yexit_command();
 
 // Experimental commands and "draft" commands.
@@ -86,6 +148,13 @@ extern bool yexit_command();
 extern bool drop_command();
 extern bool dup_command();
 extern bool xchg_command();
+extern bool add_command();
+extern bool subtract_command();
+extern bool multiply_command();
+extern bool divide_command();
+extern bool current_column_command();
+extern bool current_line_command();
 extern bool getch_command();
+extern bool wait_background_command();
 
 #endif
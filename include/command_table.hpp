@@ -6,8 +6,30 @@
 #ifndef COMMAND_TABLE_HPP
 #define COMMAND_TABLE_HPP
 
+#include <string_view>
+#include <utility>
+
 #include "EditBuffer.hpp"
 
 extern void handle_word(const EditBuffer &word);
 
+//! Returns the dispatch table index of the given command word or -1 if it is not a command.
+extern int find_command(std::string_view word);
+
+//! Returns the dispatch table indices [first, last) of the built in commands with a prefix.
+extern std::pair<int, int> find_commands(std::string_view prefix);
+
+//! Returns the name of the command with the given dispatch table index.
+extern std::string_view command_name(int index);
+
+//! Adds a command, such as one provided by a plugin. Returns false if the word is taken.
+/*!
+ * The command is given an index like those in the dispatch table, so compiled macros run it
+ * without looking up its name again. The context is passed to the function.
+ */
+extern bool add_command(std::string_view word, bool (*function)(void *), void *context);
+
+//! Executes the command with the given dispatch table index.
+extern void execute_command(int index);
+
 #endif
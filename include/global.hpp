@@ -6,7 +6,6 @@
 #ifndef GLOBAL_HPP
 #define GLOBAL_HPP
 
-#include "mystack.hpp"
 #include "parameter_stack.hpp"
 
 extern bool yfile_flag;
@@ -20,12 +19,16 @@ extern Parameter replace_parameter;
 
 extern bool search_set;  // =true when search string is set.
 extern bool replace_set; // =true when replace string is set.
+extern bool regex_search; // =true when search strings are regular expressions.
+extern bool search_ignore_case; // =true when searches ignore the case of letters.
+extern bool search_whole_word;  // =true when searches match only whole words.
+extern bool highlight_matches; // =true when the search string is highlighted in the files.
 
 extern int box_size;     // The number of columns used for the input box.
 extern int start_row;    // The row number of the top row of the box.
 extern int start_column; // The col number of the left col of the box.
 
-extern Stack<EditBuffer> parameter_stack;
+extern ParameterStack parameter_stack;
 
 extern bool restricted_mode;
 // =true when restricted mode is active. In restricted mode, the editor protects against the
@@ -10,6 +10,9 @@
 #ifndef HELP_HPP
 #define HELP_HPP
 
+#include <cstddef>
+#include <string_view>
+
 struct HelpScreen {
     const char *const *current_screen;
     const HelpScreen *next_screen;
@@ -20,7 +23,28 @@ extern const HelpScreen h_screens[]; // Help screens.
 extern const HelpScreen e_screens[]; // Editor information screens.
 extern const HelpScreen l_screens[]; // Legal information screens.
 
-//! Displays a set of help screens.
-const HelpScreen *display_screens(const HelpScreen *base, const HelpScreen *current, int size);
+//! A line of a help screen.
+struct HelpTopic {
+    const HelpScreen *base; //!< The set of screens it is in.
+    int size;               //!< The number of screens in the set.
+    const HelpScreen *screen;
+    int line;
+    const char *text;
+};
+
+#define MAX_QUERY_WORDS 8 // Further words of a help query are ignored.
+
+//! Displays a set of help screens, showing the given line of the current one.
+/*!
+ * Screens too long for the window scroll with the arrow keys. Returns the screen last shown.
+ */
+const HelpScreen *display_screens(const HelpScreen *base, const HelpScreen *current, int size,
+                                  int line = 0);
+
+//! Finds the help lines with a word starting with each word of the query, ignoring case.
+/*!
+ * At most size topics are stored, in the order they appear. Returns the number stored.
+ */
+std::size_t find_help(std::string_view query, HelpTopic *topics, std::size_t size);
 
 #endif
@@ -7,7 +7,16 @@
 #define KEYBOARD_HPP
 
 namespace KeyHandler {
+    //! Returned by get_key when the learned keyboard macro should be replayed.
+    const int REPLAY_MACRO = -2;
+
     int get_key();
-}
+
+    //! Returns the number of times to replay the macro when get_key returns REPLAY_MACRO.
+    int replay_count();
+
+    //! Makes get_key take its keystrokes from the script being replayed (see Replay).
+    void replay();
+} // namespace KeyHandler
 
 #endif
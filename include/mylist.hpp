@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <cstddef>
 #include <cstdlib>
+#include <utility>
 
 //! Doubly linked list template supporting a "current point."
 /*!
@@ -20,11 +21,13 @@
 template <typename T> class List {
   private:
     //! Structure that holds the pointers that form the list.
+    /*!
+     * Links are not polymorphic; nodes are always deleted as Nodes so that no space is needed
+     * in each node for a virtual table pointer.
+     */
     struct Link {
         Link *next;
         Link *previous;
-
-        virtual ~Link();
     };
 
     //! Derived structure to hold an object of the desired type.
@@ -32,6 +35,7 @@ template <typename T> class List {
         T data;
 
         explicit Node(const T &existing) : data(existing) {}
+        explicit Node(T &&existing) : data(std::move(existing)) {}
     };
 
     Link *head;      //!< Points at head sentinel (Only a Link).
@@ -52,6 +56,7 @@ template <typename T> class List {
     T *next();
     T *previous();
     T *insert(const T &new_data);
+    T *insert(T &&new_data);
     void erase();
     void clear();
 
@@ -111,11 +116,6 @@ template <typename T> inline T *List<T>::get()
 /*           Private Members           */
 /*=====================================*/
 
-template <typename T> List<T>::Link::~Link()
-{
-    return;
-}
-
 //! Prepares the list for use. Called by constructors.
 /*!
  * \throws std::bad_alloc if insufficient memory.
@@ -314,6 +314,24 @@ template <typename T> T *List<T>::insert(const T &new_data)
     return (&fresh->data);
 }
 
+//! Inserts a new data item before the current point, moving it into the list.
+/*
+ * \param new_data Data item to be inserted. This object is moved into the list.
+ * \return A pointer to the object in the list.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+template <typename T> T *List<T>::insert(T &&new_data)
+{
+    Node *const fresh = new Node(std::move(new_data));
+    item_count++;
+    fresh->next = current;
+    fresh->previous = current->previous;
+    current->previous->next = fresh;
+    current->previous = fresh;
+    index++;
+    return (&fresh->data);
+}
+
 //! Erases object at the current point and advances the current point.
 /*!
  * The current point is advanced to the next item on the list.
@@ -328,7 +346,7 @@ template <typename T> void List<T>::erase()
     old->previous->next = current;
     current->previous = old->previous;
     item_count--;
-    delete old;
+    delete static_cast<Node *>(old);
 }
 
 //! Removes all elements in the list.
@@ -344,7 +362,7 @@ template <typename T> void List<T>::clear()
     while (current->next != current) {
         temp = current;
         current = current->next;
-        delete temp;
+        delete static_cast<Node *>(temp);
     }
 
     // Make sure these members are correct.
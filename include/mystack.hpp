@@ -6,6 +6,8 @@
 #ifndef MYSTACK_HPP
 #define MYSTACK_HPP
 
+#include <utility>
+
 #include "mylist.hpp"
 
 template <typename T> class Stack : private List<T> {
@@ -16,6 +18,9 @@ template <typename T> class Stack : private List<T> {
      */
     void push(const T &);
 
+    //! Moves an object of type T onto the stack.
+    void push(T &&);
+
     /*!
      * Assigns the object on the top of the stack into the argument. If there is nothing on the
      * stack, the argument is unchanged. The object on the top of the stack is deleted.
@@ -39,11 +44,17 @@ template <typename T> void Stack<T>::push(const T &new_object)
     List<T>::previous();
 }
 
+template <typename T> void Stack<T>::push(T &&new_object)
+{
+    List<T>::insert(std::move(new_object));
+    List<T>::previous();
+}
+
 template <typename T> void Stack<T>::pop(T &old_object)
 {
     if (size() == 0)
         return;
-    old_object = *get();
+    old_object = std::move(*get());
     List<T>::erase();
 }
 
@@ -6,25 +6,116 @@
 #ifndef PARAMETER_STACK_HPP
 #define PARAMETER_STACK_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "EditBuffer.hpp"
-#include "EditList.hpp"
-#include "mystack.hpp"
 
+//! A parameter of a command, taken from the parameter stack or typed by the user.
+/*!
+ * Commands usually read a parameter with get(), which does not return until the user has typed
+ * it. Reading can also be done a step at a time: begin() opens the input box and each key the
+ * user types is then given to step(). A macro can thereby be suspended while it waits for the
+ * user (see PromptWord), with the event loop running in the meantime.
+ *
+ * The text the user enters is kept in the history of the prompt (see PromptHistory), shared by
+ * the parameters with the same prompt and saved between sessions.
+ */
 class Parameter {
-  private:
-    EditList input_data;       // Parameter data.
-    const char *prompt_string; // Points at prompt. Leading and trailing space added.
-
-    int edit(EditBuffer &);
-
   public:
+    //! How reading a parameter stands.
+    enum Status {
+        PENDING,  //!< The input box is open, waiting for keys.
+        ACCEPTED, //!< The parameter was read. See value().
+        CANCELLED //!< The user pressed Esc.
+    };
+
     //! Constructor sets the prompt string.
     explicit Parameter(const char *prompt_string);
+    ~Parameter();
 
     int get(bool pop = true); // Read a parameter. Return YES if no abort.
+    int get_integer(long &number); // Read a number. Integers on the stack are used directly.
     std::string value();      // Returns the most recent parameter.
+
+    Status begin(bool pop = true); // Start reading a parameter.
+    Status step(int key);          // Handle a key typed while PENDING.
+
+  private:
+    struct Prompt;
+
+    std::string latest;        // The most recent parameter.
+    const char *prompt_string; // Points at prompt. Leading and trailing space added.
+    std::unique_ptr<Prompt> prompt; // The input box, while it is open.
+
+    void load(std::uint64_t entry, const std::string &text);
+    void recall(bool older);
+    void show();
+    void edit(int key);
+};
+
+//! The stack through which macro words pass values to commands.
+/*!
+ * Each level holds either an integer or text. Integers are kept as machine numbers so that
+ * arithmetic doesn't convert them to and from text; they are converted only when a command
+ * asks for text. Levels are stored contiguously and are moved, never copied, by the stack
+ * manipulation operations. Short text fits in an EditBuffer's local storage so most pushes and
+ * pops don't allocate once the stack has grown to its working size.
+ */
+class ParameterStack {
+  public:
+    class Value {
+      public:
+        explicit Value(long number) : integer(true), number(number) {}
+        explicit Value(EditBuffer &&text) : integer(false), number(0), text(std::move(text)) {}
+
+        static Value from_text(std::string_view text);
+
+        //! Returns true if this value was created as an integer.
+        bool is_integer() const { return integer; }
+
+        bool get_integer(long &result) const;
+        void take_text(EditBuffer &result);
+
+      private:
+        bool integer;     //!< =true if number is the value; otherwise text is.
+        long number;
+        EditBuffer text;
+    };
+
+    //! Returns the number of levels on the stack.
+    std::size_t size() const { return values.size(); }
+
+    //! Pushes a copy of the text.
+    void push(const EditBuffer &text) { values.emplace_back(EditBuffer(text)); }
+
+    //! Moves the text onto the stack.
+    void push(EditBuffer &&text) { values.emplace_back(std::move(text)); }
+
+    //! Pushes a copy of the value.
+    void push(const Value &value) { values.push_back(value); }
+
+    //! Moves the value onto the stack.
+    void push(Value &&value) { values.push_back(std::move(value)); }
+
+    //! Pushes an integer.
+    void push_integer(long number) { values.emplace_back(number); }
+
+    void pop(EditBuffer &text);
+    bool get_integer(std::size_t depth, long &number) const;
+    void delete_top();
+    void duplicate();
+    void exchange();
+
+  private:
+    std::vector<Value> values; //!< The top of the stack is at the back.
 };
 
-extern Stack<EditBuffer> parameter_stack;
+extern ParameterStack parameter_stack;
 
 #endif
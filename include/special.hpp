@@ -6,8 +6,12 @@
 #ifndef SPECIAL_HPP
 #define SPECIAL_HPP
 
+#include <string_view>
+
 #include <screen/screen.hpp>
 
+#include "FieldIndex.hpp"
+#include "Highlighter.hpp"
 #include "YEditFile.hpp"
 
 #define FILE_CLASS(language, color, tab_stop)                                                  \
@@ -17,15 +21,27 @@
     };
 
 // Right now, essentially all the types are the same except for tab stop.
-FILE_CLASS(DOC, scr::WHITE, 5)
 FILE_CLASS(OTHER, scr::WHITE, 8)
 
+class DOC_YEditFile : public YEditFile {
+  public:
+    DOC_YEditFile(const char *file_name) : YEditFile(file_name, 5, scr::WHITE) {}
+
+  protected:
+    virtual bool checks_spelling() { return true; }
+};
+
 class ADA_YEditFile : public YEditFile {
   public:
     ADA_YEditFile(const char *file_name) : YEditFile(file_name, 3, scr::WHITE) {}
 
     virtual bool next_procedure();
     virtual bool previous_procedure();
+
+  protected:
+    virtual const Language *language() { return &ada_language; }
+    virtual bool has_procedures() { return true; }
+    virtual bool procedure_line(std::string_view line, ProcedureIndex &outline);
 };
 
 class ASM_YEditFile : public YEditFile {
@@ -34,23 +50,27 @@ class ASM_YEditFile : public YEditFile {
 
     virtual bool next_procedure();
     virtual bool previous_procedure();
+
+  protected:
+    virtual const Language *language() { return &asm_language; }
+    virtual bool has_procedures() { return true; }
+    virtual bool procedure_line(std::string_view line, ProcedureIndex &outline);
 };
 
 class C_YEditFile : public YEditFile {
-  private:
-    bool marks_valid;    //!< True if the data below is meaningful.
-    long function_head;  //!< Line number of most recent function head.
-    long function_brace; //!< Line number of most recent function brace.
-
   public:
-    C_YEditFile(const char *file_name) : YEditFile(file_name, 4, scr::WHITE), marks_valid(false)
-    {
-    }
+    C_YEditFile(const char *file_name) : YEditFile(file_name, 4, scr::WHITE) {}
 
     virtual bool next_procedure();
     virtual bool previous_procedure();
     virtual bool extra_indent();
     virtual bool insert_char(char);
+
+  protected:
+    virtual const Language *language() { return &c_language; }
+    virtual bool has_procedures() { return true; }
+    virtual bool procedure_line(std::string_view line, ProcedureIndex &outline);
+    virtual long procedure_head(long line);
 };
 
 class PCD_YEditFile : public YEditFile {
@@ -59,25 +79,65 @@ class PCD_YEditFile : public YEditFile {
 
     virtual bool next_procedure();
     virtual bool previous_procedure();
+
+  protected:
+    virtual const Language *language() { return &pcd_language; }
+    virtual bool has_procedures() { return true; }
+    virtual bool procedure_line(std::string_view line, ProcedureIndex &outline);
 };
 
-//! For now the SCALA_YEditFile is a copy of C_YEditFile. This won't be true forever, however.
-class SCALA_YEditFile : public YEditFile {
-  private:
-    bool marks_valid;    //!< True if the data below is meaningful.
-    long function_head;  //!< Line number of most recent function head.
-    long function_brace; //!< Line number of most recent function brace.
+//! A file named hex:path, showing the bytes of the file at path (see HexImage).
+/*!
+ * Characters typed replace the byte under the cursor, whether or not the file is in insert
+ * mode: hexadecimal digits in the columns of digits and any printable character in the columns
+ * of characters. The cursor then moves to the next digit or character. The rows themselves
+ * can't be modified.
+ */
+class HEX_YEditFile : public YEditFile {
+  public:
+    HEX_YEditFile(const char *file_name) : YEditFile(file_name, 8, scr::WHITE)
+    {
+        set_read_only(true);
+    }
+
+    virtual bool has_fixed_lines() { return true; }
+    virtual bool insert_char(char);
+};
 
+//! A table whose fields are separated by a delimiter, such as a CSV or TSV file.
+/*!
+ * The fields of the lines are found only as the lines are looked at (see FieldIndex), so a
+ * large table loads as quickly as any other file. The fields can be shown aligned in columns
+ * (see align_fields) and the lines sorted by a field (see sort_lines).
+ */
+class CSV_YEditFile : public YEditFile {
   public:
-    SCALA_YEditFile(const char *file_name)
-        : YEditFile(file_name, 2, scr::WHITE), marks_valid(false)
+    CSV_YEditFile(const char *file_name, char delimiter)
+        : YEditFile(file_name, 8, scr::WHITE), table(delimiter)
     {
     }
 
+    virtual FieldIndex *fields();
+
+  private:
+    FieldIndex table;
+};
+
+//! For now the SCALA_YEditFile is a copy of C_YEditFile. This won't be true forever, however.
+class SCALA_YEditFile : public YEditFile {
+  public:
+    SCALA_YEditFile(const char *file_name) : YEditFile(file_name, 2, scr::WHITE) {}
+
     virtual bool next_procedure();
     virtual bool previous_procedure();
     virtual bool extra_indent();
     virtual bool insert_char(char);
+
+  protected:
+    virtual const Language *language() { return &scala_language; }
+    virtual bool has_procedures() { return true; }
+    virtual bool procedure_line(std::string_view line, ProcedureIndex &outline);
+    virtual long procedure_head(long line);
 };
 
 #endif
@@ -6,7 +6,9 @@
 #ifndef SUPPORT_HPP
 #define SUPPORT_HPP
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 #include <screen/environ.hpp>
 
@@ -14,11 +16,11 @@
 
 char *adjust_date(const char *raw_date);
 
-//! Given offset into string, returns offset of next word to the right.
-unsigned word_right(const EditBuffer &, unsigned);
+//! Given column in line, returns column of next word to the right (tab: distance of tab stops).
+unsigned word_right(const EditBuffer &, unsigned column, unsigned tab);
 
-//! Given offset into string, returns offset of next word to the left.
-unsigned word_left(const EditBuffer &, unsigned);
+//! Given column in line, returns column of next word to the left (see word_right).
+unsigned word_left(const EditBuffer &, unsigned column, unsigned tab);
 
 //! Given list of file names, wildcard sequences, and switches, loads all indicated files.
 bool load_files(const char **argv);
@@ -30,6 +32,30 @@ void insert_AWK(std::string &working_buffer);
 int my_stricmp(const char *s1, const char *s2);
 int my_strnicmp(const char *s1, const char *s2, int n);
 
+//! Returns the key under which a file name is indexed.
+/*!
+ * The key is the full path of the file, with symbolic links resolved as far as the file (or
+ * failing that, its directory) exists, and with letters folded to lower case since Y compares
+ * file names without regard to case. Different names for the same file thus get the same key.
+ */
+std::string name_key(const char *name);
+
+//! Atomically replaces the named file with the temporary file. Returns false if that fails.
+bool replace_file(const char *temporary_name, const char *name);
+
+//! The value a 64 bit FNV-1a hash starts from.
+constexpr std::uint64_t fnv_basis = 14695981039346656037ULL;
+
+//! Returns the 64 bit FNV-1a hash of bytes, continuing from hash (see fnv_basis).
+inline std::uint64_t fnv1a(const std::string_view bytes, std::uint64_t hash = fnv_basis)
+{
+    for (const char ch : bytes) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 void info_message(const char *format, ...);
 bool confirm_message(const char *string, char non_default, bool ESC_default);
 void warning_message(const char *format, ...);
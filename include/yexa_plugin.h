@@ -0,0 +1,96 @@
+/*! \file    yexa_plugin.h
+ *  \brief   The C interface between the editor and its plugins.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * A plugin is a shared library (a DLL on Windows) loaded with the load_plugin command. It is
+ * written in C or in any language that can call and export C functions, and it needs nothing
+ * from the editor but this header.
+ *
+ * The plugin exports yexa_plugin_abi_version, which returns the YEXA_PLUGIN_ABI_VERSION it was
+ * compiled with, and yexa_plugin_start, which is given the editor's functions. Plugins built
+ * for a newer interface than the editor's are not loaded. New functions are only ever added at
+ * the end of yexa_api, so a plugin built for an older interface keeps working; one that wants
+ * a newer function checks abi_version (or size) first.
+ *
+ * Lines are numbered from zero. Text is UTF-8 and is not terminated by a null character.
+ * Everything works on the active file and runs on the editor's main thread.
+ */
+
+#ifndef YEXA_PLUGIN_H
+#define YEXA_PLUGIN_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define YEXA_PLUGIN_ABI_VERSION 1
+
+#if defined(_WIN32)
+#define YEXA_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define YEXA_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+/*! Text lent to a plugin. It remains valid until the file is next modified. */
+typedef struct yexa_view {
+    const char *text;
+    size_t length;
+} yexa_view;
+
+/*! Lines [first, first + old_count) of a file were replaced by new_count lines. */
+typedef struct yexa_edit {
+    const char *file_name; /*!< Valid during the call only. */
+    long first;
+    long old_count;
+    long new_count;
+} yexa_edit;
+
+/*! Carries out a command. Returns nonzero on success. */
+typedef int (*yexa_command_function)(void *context);
+
+/*! Is told of the modifications made since the last call, at most one per file. */
+typedef void (*yexa_edit_function)(void *context, const yexa_edit *edits, size_t count);
+
+/*! The editor's functions. Functions that return int return nonzero on success. */
+typedef struct yexa_api {
+    unsigned abi_version; /*!< The YEXA_PLUGIN_ABI_VERSION of the editor. */
+    size_t size;          /*!< The size of this structure in the editor. */
+
+    /*! Makes a command that macros and keys can use like the editor's own. */
+    int (*register_command)(const char *name, yexa_command_function function, void *context);
+
+    /*! Asks to be told of modifications to the files, in batches, while the editor is idle. */
+    int (*subscribe_edits)(yexa_edit_function function, void *context);
+
+    const char *(*file_name)(void);
+    long (*line_count)(void);
+
+    /*! Lends the text of a line, without copying it. Fails past the end of the file. */
+    int (*get_line)(long line, yexa_view *view);
+
+    /*! Replaces count lines starting at first with the given lines (count may be zero). */
+    int (*replace_lines)(long first, long count, const yexa_view *lines, size_t line_count);
+
+    /*! Gives the line and column of the cursor. Columns are numbered from zero. */
+    void (*cursor)(long *line, long *column);
+
+    /*! Runs one of the editor's commands. Its parameters are given in the order it asks. */
+    int (*command)(const char *name, const char *const *parameters, size_t parameter_count);
+
+    /*! Shows a message to the user. */
+    void (*message)(const char *text);
+} yexa_api;
+
+/*! Returns YEXA_PLUGIN_ABI_VERSION. */
+YEXA_PLUGIN_EXPORT unsigned yexa_plugin_abi_version(void);
+
+/*! Starts the plugin. The api remains valid while the editor runs. Nonzero means success. */
+YEXA_PLUGIN_EXPORT int yexa_plugin_start(const yexa_api *api);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
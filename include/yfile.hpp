@@ -6,10 +6,15 @@
 #ifndef YFILE_HPP
 #define YFILE_HPP
 
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "EditBuffer.hpp"
 #include "YEditFile.hpp"
-#include "mylist.hpp"
 
+class DescriptorList;
 class YEditFile;
 
 void read_yfile();
@@ -24,8 +29,16 @@ class FileDescriptor {
      */
     friend void read_yfile();
 
-    //! This function writes information from a descriptor into filelist.yfy.
-    friend void write_descriptor(std::FILE *, const FileDescriptor &);
+    //! This function appends the information from a descriptor as written in filelist.yfy.
+    friend void write_descriptor(std::string &, const FileDescriptor &);
+
+    //! The list indexes descriptors by name.
+    friend class DescriptorList;
+
+    //! These functions convert descriptors to and from the binary session snapshot.
+    friend void encode_descriptor(std::string &, const FileDescriptor &);
+    friend bool decode_descriptor(const unsigned char *&, const unsigned char *,
+                                  FileDescriptor &);
 
     //! Used when a file is loaded to set all the attributes from a file descriptor in this
     //! list.
@@ -65,13 +78,58 @@ class FileDescriptor {
     void sanity_check();
 };
 
+//! A sequence of file descriptors with a hashed index keyed by file name.
+/*!
+ * Names are indexed by their name_key, so different names for the same file find the same
+ * descriptor. Erasing a descriptor leaves an empty slot so that the positions of the others are
+ * unchanged; thus the descriptors can be erased while they are being visited.
+ */
+class DescriptorList {
+  public:
+    void insert(const FileDescriptor &new_descriptor);
+    FileDescriptor *find(const char *name);
+    void erase(const char *name);
+    void clear();
+
+    //! Returns the number of slots (including empty ones).
+    std::size_t slots() const { return entries.size(); }
+
+    //! Returns the descriptor in the given slot or nullptr if it has been erased.
+    FileDescriptor *slot(std::size_t position)
+    {
+        return present[position] ? &entries[position] : nullptr;
+    }
+
+  private:
+    std::vector<FileDescriptor> entries;                 //!< The descriptors in order.
+    std::vector<bool> present;                           //!< =false for erased slots.
+    std::unordered_map<std::string, std::size_t> index; //!< Name key to slot.
+};
+
 //! This list contains file descriptors as placed in filelist.yfy.
-extern List<FileDescriptor> descriptor_list;
+extern DescriptorList descriptor_list;
 
 /*!
  * This function writes the entire filelist.yfy file using the current descriptor list of
- * deleted file entries and the current list of files loaded into the editor.
+ * deleted file entries and the current list of files loaded into the editor. A binary snapshot
+ * of the same information is written to filelist.yfb so the next session can start without
+ * parsing the text.
  */
 void write_yfile();
 
+/*!
+ * This function arranges for the session to be checkpointed: filelist.yfy and filelist.yfb are
+ * written in the background every few seconds, so that a crash loses little of the session.
+ * The descriptors are captured on the main thread and the files are written on a worker (see
+ * TaskPool). Nothing is written if the descriptors have not changed since the files were last
+ * written. Each file is written under a temporary name and renamed, so it is always whole.
+ */
+void start_checkpoints();
+
+/*!
+ * This function asks for a checkpoint soon, since files have been added to the session or
+ * removed from it. It does nothing unless start_checkpoints has been called.
+ */
+void note_session_change();
+
 #endif
@@ -6,17 +6,19 @@
 #ifndef DISPLAYWINDOW_HPP
 #define DISPLAYWINDOW_HPP
 
+#include "ItemSource.hpp"
 #include "Window.hpp"
 #include <list>
 #include <string>
+#include <vector>
 
 namespace scr {
 
     /*!
-     * Objects from this class are able to display the text in a `list<string>` to the user. The
-     * user can scroll through the text easily. Derived classes can redefine the `display`
-     * method for other special purposes. The `show` has been implemented in a manner to
-     * simplify the checking that needs to be done in `display`.
+     * Objects from this class are able to display the items of an ItemSource, often the text in
+     * a `list<string>`, to the user. The user can scroll through the text easily. Derived
+     * classes can redefine the `display` method for other special purposes. The `show` has
+     * been implemented in a manner to simplify the checking that needs to be done in `display`.
      *
      * Additionally, most of the data members are protected. This allows derived classes to
      * manipulate them freely (including the `list<string>` itself). Notice that a pointer to a
@@ -27,18 +29,25 @@ namespace scr {
      * The `list<string>` which is being display is not touched by this class. The DisplayWindow
      * shows a range of line numbers. If text is inserted above the window, the contents of the
      * window will scroll down (when `show` or `display` are called).
+     *
+     * Only the lines in the window are fetched from the source when it is shown. Thus the
+     * source can hold a great many lines without slowing the display.
      */
     class DisplayWindow : public SimpleWindow {
 
       protected:
-        const char *title;            //!< Name of text.
-        long top_line;                //!< Line number at top of window.
-        int left_column;              //!< Column number at left of window.
-        std::list<std::string> *text; //!< Points to the text to display.
+        const char *title;                //!< Name of text.
+        long top_line;                    //!< Line number at top of window.
+        int left_column;                  //!< Column number at left of window.
+        const ItemSource *source;         //!< Supplies the text to display.
+        ListSource list_source;           //!< Used when the text is a `list<string>`.
+        std::vector<std::string> visible; //!< The lines fetched for the window.
 
       public:
         void set(const char *input_title, std::list<std::string> *input_text,
                  long start_line = 0L, int start_column = 0);
+        void set(const char *input_title, const ItemSource *input_source, long start_line = 0L,
+                 int start_column = 0);
 
         bool open(int row, int column, int width, int height, int color, int status_color,
                   BoxType border, int border_color = WINDOW_COLOR);
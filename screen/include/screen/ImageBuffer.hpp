@@ -18,6 +18,13 @@ namespace scr {
      * the precise way in which characters and colors are stored and lets its clients treat
      * screen "images" in an abstract manner. This class provides methods for memory management
      * and basic text handling in images.
+     *
+     * The storage for images comes from a pool of recently released blocks, so that popups
+     * opened and closed repeatedly do not go to the heap each time. Other classes that save
+     * regions of the screen (in the two byte per cell format of `read`) use the pool as well.
+     * An image that is resized keeps its storage if it is big enough and otherwise grows it by
+     * half again, so that a window resized repeatedly (while the terminal is dragged larger,
+     * for example) reallocates only a few times.
      */
     class ImageBuffer {
       public:
@@ -32,8 +39,16 @@ namespace scr {
         {
             copy(source.c_str(), row, column, extent, color);
         }
+        void fill(int row, int column, int width, int height, int color, char letter = ' ');
+        void copy_text(const char *source, int row, int column, std::size_t extent);
+        void copy_cells(const char *cells, int row, int column, std::size_t extent);
+        void set_color(int row, int column, int width, int height, int color);
+        void draw_box(int row, int column, int width, int height, BoxType the_type, int color);
+        void scroll(direction_t direction, int row, int column, int width, int height,
+                    int number_of_rows, int color);
         void read(int row, int column);
         void write(int row, int column);
+        void write(int row, int column, int image_row, int image_column, int extent);
         void resize(int new_width, int new_height, int color = WHITE | REV_BLACK,
                     char letter = ' ');
 
@@ -43,10 +58,16 @@ namespace scr {
         //! Returns the hight of the image.
         int get_height() { return height; }
 
+        static char *allocate(std::size_t size);
+        static void release(char *cells, std::size_t size);
+
       private:
         int width;
         int height;
+        std::size_t capacity; // Bytes of storage at buffer.
         char *buffer;
+
+        bool clip(int &row, int &column, int &region_width, int &region_height) const;
     };
 
 } // namespace scr
@@ -0,0 +1,86 @@
+/*! \file    ItemSource.hpp
+ *  \brief   Interface to the classes that supply the items a window shows.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#ifndef ITEMSOURCE_HPP
+#define ITEMSOURCE_HPP
+
+#include <functional>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace scr {
+
+    //! A sequence of lines of text that a window shows a part of at a time.
+    /*!
+     * Windows ask for the number of items and then fetch only the ones they show. Thus a
+     * source can hold a great many items, or produce each one only when it is asked for. The
+     * number of items may grow between calls (for example, while a search adds results).
+     */
+    class ItemSource {
+      public:
+        virtual ~ItemSource() = default;
+
+        //! Returns the number of items.
+        virtual long count() const = 0;
+
+        //! Appends the items [first, first + number) to items, stopping at the last item.
+        virtual void fetch(long first, long number, std::vector<std::string> &items) const = 0;
+    };
+
+    //! Supplies the items of a `list<string>`.
+    /*!
+     * The position of the last fetch is remembered, so paging through the list only walks
+     * between the places shown. Strings may be appended to the list while it is being shown,
+     * but if any are removed the source must be set to the list again.
+     */
+    class ListSource : public ItemSource {
+      private:
+        std::list<std::string> *text = nullptr;
+        mutable std::list<std::string>::iterator last;
+        mutable long last_index = -1; // Index of last (or -1 if there is no last fetch).
+
+      public:
+        void set(std::list<std::string> *input_text)
+        {
+            text = input_text;
+            last_index = -1;
+        }
+
+        long count() const override;
+        void fetch(long first, long number, std::vector<std::string> &items) const override;
+    };
+
+    //! Supplies items using functions provided by the caller.
+    /*!
+     * The fetch function is called only for the items being shown, so the caller can format
+     * them on demand rather than building every item in advance.
+     */
+    class FunctionSource : public ItemSource {
+      public:
+        using CountFunction = std::function<long()>;
+        using FetchFunction = std::function<void(long, long, std::vector<std::string> &)>;
+
+        FunctionSource(CountFunction count_function, FetchFunction fetch_function)
+            : count_items(std::move(count_function)), fetch_items(std::move(fetch_function))
+        {
+        }
+
+        long count() const override { return count_items(); }
+
+        void fetch(long first, long number, std::vector<std::string> &items) const override
+        {
+            fetch_items(first, number, items);
+        }
+
+      private:
+        CountFunction count_items;
+        FetchFunction fetch_items;
+    };
+
+} // namespace scr
+
+#endif
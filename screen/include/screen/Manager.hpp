@@ -8,6 +8,7 @@
 
 #include "Window.hpp"
 #include <list>
+#include <vector>
 
 namespace scr {
 
@@ -17,6 +18,10 @@ namespace scr {
      * allows windows of various types to be overlapped and moved around. A Manager object
      * handles "system" keystrokes and passes all other keystrokes to the process_keystroke( )
      * function of the foreground window for handling by that window.
+     *
+     * The screen is only rebuilt from every window when the windows have been rearranged.
+     * Otherwise only the windows that are dirty are shown again, and only the parts of them
+     * that are not covered by other windows.
      */
     class Manager {
       public:
@@ -40,6 +45,7 @@ namespace scr {
             int column_position; //<! Coords of window's printable area UL corner.
             int width;           //<! Width of the Window's printable area.
             int height;          //<! Height of the Window's printable area.
+            bool visible;        //<! True if some part of the window is not covered.
 
             // This is only necessary because OW doesn't do lazy instantiation.
             bool operator==(const WindowInformation &other);
@@ -49,6 +55,12 @@ namespace scr {
         //! List of all the windows we are managing.
         std::list<WindowInformation> the_windows;
 
+        //! The topmost window at each screen position, row by row (nullptr for the background).
+        std::vector<const Window *> owners;
+        int owners_rows;     //!< Number of screen rows when the owners were found.
+        int owners_columns;  //!< Number of screen columns when the owners were found.
+        bool layout_changed; //!< True if the windows were rearranged since the last update.
+
         //! True when keystrokes are to be interpreted as system control keys.
         bool system_mode;
 
@@ -56,6 +68,14 @@ namespace scr {
         SpecialKey *key_array; //!< Pointer to array of special key definitions.
         int key_count;         //!< Number of special keys in the Key_Array.
 
+        void fit_window(const Window *w, int &row, int &column, int &width, int &height);
+        void find_owners();
+        void composite(const WindowInformation &information, int top, int left, int bottom,
+                       int right);
+        void frame(const WindowInformation &information, int top, int left, int bottom,
+                   int right);
+        void rebuild();
+
       public:
         Manager();
         ~Manager();
@@ -74,11 +94,22 @@ namespace scr {
         bool register_window(Window *new_window, int row, int column, int width, int height);
         void deregister_window(const Window *old_window);
         void get_size(Window *w, int &width, int &height);
+        void get_position(Window *w, int &row, int &column);
+        void scroll_window(const Window *w, int row, int height, int count);
 
         // The following methods are for use by the application as a whole.
+        bool set_geometry(Window *w, int row, int column, int width, int height);
+        void raise_window(const Window *w);
         void update_display();
+        void repair(int row, int column, int width, int height);
         void input_loop();
         void swap_top();
+
+        //! Makes the next update_display() rebuild the whole screen.
+        /*!
+         * This is needed when something other than the manager has drawn on the screen.
+         */
+        void invalidate() { layout_changed = true; }
     };
 
 } // namespace scr
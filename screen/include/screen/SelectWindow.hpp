@@ -6,6 +6,9 @@
 #ifndef SELECTWINDOW_HPP
 #define SELECTWINDOW_HPP
 
+#include <functional>
+#include <utility>
+
 #include "screen/DisplayWindow.hpp"
 
 namespace scr {
@@ -15,16 +18,31 @@ namespace scr {
      * This class behaves like DisplayWindow except that it also highlights an entry in the list
      * of strings and allows the user to move that highlighted entry around to select a
      * particular item.
+     *
+     * The list may grow while the user is making a selection. If an idle function is set, it
+     * is called repeatedly while waiting for a keystroke. It may append to the list and returns
+     * true if the window should be redrawn.
      */
     class SelectWindow : public DisplayWindow {
       private:
         int highlight_color;
         bool show_bar;
+        long current; // Index of the highlighted entry.
+        std::function<bool()> idle;
 
       public:
         bool open(int row, int column, int width, int height, int color, int status_color,
                   BoxType border, int border_color = WINDOW_COLOR);
 
+        //! Sets the function called while waiting for a keystroke.
+        void set_idle(std::function<bool()> idle_function) { idle = std::move(idle_function); }
+
+        //! Returns the index of the highlighted entry.
+        long current_line() const { return current; }
+
+        //! Highlights an entry (for example, after the items have changed).
+        void set_current_line(long line) { current = line; }
+
         void show();
         int select(long forced = -1L);
     };
@@ -21,9 +21,21 @@ namespace scr {
      * not participate in a collection of windows under the control of a window manager.
      * SimpleWindows are good for applications with simple screen handling needs or for showing
      * material quickly as with, for example, message boxes.
+     *
+     * If the application registers a repair function (normally one that has a Manager rebuild
+     * part of the screen) a SimpleWindow opened when no other SimpleWindow is showing doesn't
+     * save its background. When it is hidden or closed the region it covered is repaired
+     * instead. Popups opened and closed over managed windows then cost no copies of the
+     * background.
      */
     class SimpleWindow {
+      public:
+        //! Rebuilds a region of the screen as it is without any SimpleWindows.
+        using RepairFunction = void (*)(int row, int column, int width, int height);
+
       private:
+        static RepairFunction repair; //!< Set by the application (nullptr if none).
+        static int showing;           //!< Number of SimpleWindows on the screen.
         int total_row;    //!< Top row of window (including border).
         int total_column; //!< Left column of window (including border).
         int total_width;  //!< Total width (including border).
@@ -37,8 +49,15 @@ namespace scr {
         BoxType window_border_type; //!< Border type.
         int window_border_color;    //!< Color attribute of border.
 
-        char *hidden;    //!< Window image when a window is hidden.
-        char *save_data; //!< Saved background material.
+        char *hidden;    //!< Window image when a window is hidden (nullptr until then).
+        char *save_data; //!< Saved background material (nullptr if it is repaired instead).
+
+        std::size_t image_size() const
+        {
+            return 2 * static_cast<std::size_t>(total_width) * total_height;
+        }
+        void save_background();
+        void restore_background();
 
         // Disable copying of SimpleWindow objects.
         SimpleWindow(const SimpleWindow &existing) = delete;
@@ -52,6 +71,9 @@ namespace scr {
         SimpleWindow();
         ~SimpleWindow();
 
+        //! Sets the repair function (nullptr to have every window save its background).
+        static void set_repair_function(RepairFunction function) { repair = function; }
+
         bool open(int row, int column, int width, int height, int color, BoxType border_type,
                   int border_color = WINDOW_COLOR);
 
@@ -85,15 +107,30 @@ namespace scr {
     class Window {
       private:
         bool is_registered;
+        bool bordered; //!< False if the image includes the window's border (if any).
+        bool dirty;    //!< True if the image has changed since the manager last showed it.
 
       protected:
         Manager *my_manager; //!< Pointer to the manager that is managing this window.
         ImageBuffer image;   //!< The image of what is currently in the window.
 
+        //! Tells the manager that the window's image must be shown again.
+        void mark_dirty() { dirty = true; }
+
       public:
-        Window(Manager *my_manager, int row, int column, int width, int height);
+        Window(Manager *my_manager, int row, int column, int width, int height,
+               bool bordered = true);
         virtual ~Window();
 
+        //! Returns true if the manager draws a border around the window's printable area.
+        bool has_border() const { return bordered; }
+
+        //! Returns true if the window's image has changed since the manager last showed it.
+        bool is_dirty() const { return dirty; }
+
+        //! Used by the manager once it has shown the window's current image.
+        void mark_clean() { dirty = false; }
+
         virtual ImageBuffer *get_image();
         virtual bool process_keystroke(int &key_code);
         virtual int cursor_row();
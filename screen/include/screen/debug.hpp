@@ -20,7 +20,11 @@
 // The debugging system is only available if DEBUG is defined.
 #ifdef DEBUG
 
+#include <string>
+#include <vector>
+
 #include "TextWindow.hpp"
+#include "Window.hpp"
 #include "screen/screen.hpp"
 
 #define DBG_TOP 1
@@ -61,6 +65,35 @@ namespace scr {
         DebugWindow(const char *header, int width = 74, int height = 5, int color = REV_WHITE);
         ~DebugWindow();
     };
+
+    //! A managed window that shows a few lines of figures while the program runs normally.
+    /*!
+     * Unlike a DebugWindow it never waits for the user. The program sets its lines whenever it
+     * likes; only lines that changed make the window dirty, so a monitor whose figures are
+     * steady costs nothing to show. Since the manager puts the cursor in the topmost window, a
+     * monitor kept in front of other windows can pass the cursor on to one of them.
+     */
+    class MonitorWindow : public Window {
+      public:
+        MonitorWindow(Manager *manager, int row, int column, int width, int height,
+                      int color = REV_WHITE);
+
+        void set_line(int line, const std::string &text);
+
+        //! Makes the cursor appear where it would in owner (nullptr to leave it in this one).
+        void follow_cursor(Window *owner) { cursor_owner = owner; }
+
+        int cursor_row() override;
+        int cursor_column() override;
+        bool resize(int new_width, int new_height) override;
+
+      private:
+        int color;
+        Window *cursor_owner;
+        std::vector<std::string> lines; //!< The text of each line, as last set.
+
+        void paint(int line);
+    };
 } // namespace scr
 
 #endif
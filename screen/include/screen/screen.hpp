@@ -11,6 +11,8 @@
 #define SCREEN_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 //! Namespace for scr, the portable screen handling library.
 namespace scr {
@@ -54,9 +56,37 @@ namespace scr {
         NO_BORDER      //!< Special value to represent no border.
     };
 
+    //! A character position in the screen image.
+    /*!
+     * A cell holds a Unicode code point in its low 24 bits and a color attribute in its high 8
+     * bits, so that rows of cells can be compared a word at a time. The functions that transfer
+     * characters and attributes as pairs of bytes use the code points 0 to 255 (which include
+     * the box drawing characters) and show larger code points as '?'.
+     */
+    typedef std::uint32_t Cell;
+
+    //! Returns the cell showing a code point with a color attribute.
+    constexpr Cell make_cell(const std::uint32_t code_point, const int attribute)
+    {
+        return (code_point & 0xFFFFFFU) | (static_cast<Cell>(attribute & 0xFF) << 24);
+    }
+
+    //! Returns the code point shown by a cell.
+    constexpr std::uint32_t cell_code_point(const Cell cell)
+    {
+        return cell & 0xFFFFFFU;
+    }
+
+    //! Returns the color attribute of a cell.
+    constexpr int cell_attribute(const Cell cell)
+    {
+        return static_cast<int>(cell >> 24);
+    }
+
     // Detailed documentation for the functions can be found in scr.cpp.
 
     // Start up and clean up.
+    void use_headless(int height, int width, int (*keys)());
     bool initialize();
     void terminate();
 
@@ -69,6 +99,13 @@ namespace scr {
     int number_of_rows();
     int number_of_columns();
 
+    // Changes in the size of the terminal.
+    unsigned long size_reports();
+    bool update_size();
+
+    // Output statistics.
+    void output_counts(unsigned long long &cells, unsigned long long &bytes);
+
     // Attribute manipulation.
     int convert_attribute(int attribute);
     int reverse_attribute(int attribute);
@@ -81,11 +118,29 @@ namespace scr {
     void print(int row, int column, std::size_t count, int attribute, const char *format, ...);
     void print_text(int row, int column, std::size_t count, const char *format, ...);
 
+    //! Part of a run of characters written with one attribute (see write_span).
+    struct AttributeRun {
+        std::size_t length; //!< The number of characters with the attribute.
+        int attribute;
+    };
+
+    // Runs of characters copied without formatting.
+    void write_span(int row, int column, const char *text, std::size_t length, int attribute);
+    void write_span(int row, int column, const char *text, std::size_t length,
+                    const AttributeRun *runs, std::size_t run_count);
+    void write_span_text(int row, int column, const char *text, std::size_t length);
+
     // Manipulation of regions.
     void clear(int row, int column, int width, int height, int attribute);
     void set_color(int row, int column, int width, int height, int attribute);
     void clear_screen();
 
+    // Runs of repeated cells.
+    void fill(int row, int column, int width, int height, int attribute, char letter = ' ');
+    void fill_row(int row, int column, int count, int attribute, char letter);
+    void fill_column(int row, int column, int count, int attribute, char letter);
+    void fill_color(int row, int column, int count, int attribute);
+
     //! Used to specify a scroll direction for scr::Scroll.
     enum direction_t { UP, DOWN };
 
@@ -107,6 +162,10 @@ namespace scr {
     int key();
     void refresh_on_key(bool flag);
     int key_wait();
+    bool key_available(int milliseconds);
+    void record_keys(void (*recorder)(int key));
+    unsigned long keys_read();
+    std::string_view pasted_text();
 
     //==============================
     //          Exceptions
@@ -252,6 +311,9 @@ namespace scr {
     const int K_CINS = (146 + XF);
     const int K_CDEL = (147 + XF);
 
+    // Pseudo keys.
+    const int K_PASTE = (160 + XF); // Text pasted into the terminal; see pasted_text.
+
     // Control characters.
     const int K_CTRLA = 1;
     const int K_CTRLB = 2;
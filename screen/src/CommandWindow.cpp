@@ -25,6 +25,7 @@ namespace scr {
     void CommandWindow::set_prompt(const char *new_prompt)
     {
         prompt = new_prompt;
+        mark_dirty();
     }
 
     bool CommandWindow::process_keystroke(int &key_code)
@@ -131,6 +132,7 @@ namespace scr {
             cursor_offset++;
             break;
         }
+        mark_dirty();
         return (true);
     }
 
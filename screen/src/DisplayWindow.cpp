@@ -5,6 +5,7 @@
 
 #include "screen/DisplayWindow.hpp"
 #include "screen/screen.hpp"
+#include <algorithm>
 #include <climits>
 #include <cstring>
 
@@ -23,11 +24,23 @@ namespace scr {
      */
     void DisplayWindow::set(const char *input_title, std::list<std::string> *input_text,
                             long start_line, int start_column)
+    {
+        list_source.set(input_text);
+        set(input_title, &list_source, start_line, start_column);
+    }
+
+    //! Associate an ItemSource with a DisplayWindow.
+    /*!
+     * As above except that the lines are fetched from the source as they are shown. The
+     * source is not copied and must exist for as long as the window is in use.
+     */
+    void DisplayWindow::set(const char *input_title, const ItemSource *input_source,
+                            long start_line, int start_column)
     {
         top_line = start_line;
         left_column = start_column;
         title = input_title;
-        text = input_text;
+        source = input_source;
     }
 
     //! Display the window for the first time.
@@ -79,14 +92,16 @@ namespace scr {
 
             right_column = left_column + static_cast<int>(strlen(title)) + active_plug->size;
 
-            print_text(SimpleWindow::row() - 1, left_column, active_plug->size,
-                       active_plug->left_plug);
+            write_span_text(SimpleWindow::row() - 1, left_column, active_plug->left_plug,
+                            std::min<std::size_t>(strlen(active_plug->left_plug),
+                                                  active_plug->size));
 
-            print_text(SimpleWindow::row() - 1, right_column, active_plug->size,
-                       active_plug->right_plug);
+            write_span_text(SimpleWindow::row() - 1, right_column, active_plug->right_plug,
+                            std::min<std::size_t>(strlen(active_plug->right_plug),
+                                                  active_plug->size));
 
-            print_text(SimpleWindow::row() - 1, left_column + active_plug->size, strlen(title),
-                       (char *)title);
+            write_span_text(SimpleWindow::row() - 1, left_column + active_plug->size, title,
+                            strlen(title));
 
             // Fill primary window with text.
             show();
@@ -95,7 +110,7 @@ namespace scr {
         return return_value;
     }
 
-    //! Fill the window with text from the previously provided list of strings.
+    //! Fill the window with text from the previously provided source.
     /*!
      * This method takes top_line as a request for the desired first line to display. It
      * verifies that this request will cause material from the `list<string>` to be seen. If
@@ -113,17 +128,13 @@ namespace scr {
      */
     void DisplayWindow::show()
     {
-        list<string>::iterator line_pointer; // Points at a line from the list.
-
-        char buffer[80 + 1];  // Holds text to be displayed in the window.
-        char *buffer_pointer; // Points into buffer.
-        int i;                // Loops over all rows in the window.
+        int i; // Loops over all rows in the window.
 
         // Force primary window on screen. If it already is, this has no effect.
         SimpleWindow::show();
 
         // Be sure that we are going to show some of the string list.
-        long max_line = text->size() - height();
+        long max_line = source->count() - height();
         if (max_line < 0)
             max_line = 0L;
         if (top_line > max_line)
@@ -131,33 +142,26 @@ namespace scr {
         if (top_line < 0)
             top_line = 0L;
 
-        // Move current point of list to line number top_line.
-        line_pointer = text->begin();
-        for (i = 0; i < top_line; ++i)
-            ++line_pointer;
+        // Fetch only the lines starting at top_line that fit in the window.
+        visible.clear();
+        source->fetch(top_line, height(), visible);
+        vector<string>::const_iterator line_pointer = visible.begin();
 
         // Loop until all lines of the window are filled or until there's no text left.
-        for (i = row(); i < row() + height() && line_pointer != text->end();
+        for (i = row(); i < row() + height() && line_pointer != visible.end();
              ++i, ++line_pointer) {
 
-            // Set text_pointer to the first character to be displayed in window.
-            const char *text_pointer = line_pointer->c_str();
-            while (text_pointer - line_pointer->c_str() < left_column &&
-                   *text_pointer != '\0') {
-                text_pointer++;
-            }
-
-            // Fill buffer with spaces and null terminate.
-            memset(buffer, ' ', 80);
-            buffer[80] = '\0';
-
-            // Fill buffer with material from the current line.
-            buffer_pointer = buffer;
-            while (*text_pointer && buffer_pointer - buffer < 80)
-                *buffer_pointer++ = *text_pointer++;
-
-            // Print the line into the window.
-            print(i, column(), width(), color(), buffer);
+            // The part of the line from left_column that fits in the window.
+            const std::size_t start = std::min<std::size_t>(
+                static_cast<std::size_t>(left_column), line_pointer->size());
+            const std::size_t length =
+                std::min<std::size_t>(line_pointer->size() - start, width());
+
+            // Write the line into the window, clearing the rest of the row.
+            write_span(i, column(), line_pointer->data() + start, length, color());
+            if (length < static_cast<std::size_t>(width()))
+                fill_row(i, column() + static_cast<int>(length),
+                         width() - static_cast<int>(length), color(), ' ');
         }
 
         // If the entire screen was not filled, clear the lower section.
@@ -5,7 +5,9 @@
 
 #include "screen/ImageBuffer.hpp"
 #include "screen/screen.hpp"
+#include <algorithm>
 #include <cstring>
+#include <vector>
 
 static void check_region(int row, int column, int width, int height)
 {
@@ -14,8 +16,88 @@ static void check_region(int row, int column, int width, int height)
         throw scr::BadRegion(row, column, width, height);
 }
 
+namespace {
+
+    // Blocks are pooled in size classes that are powers of two from the smallest up to the
+    // largest. Larger blocks are rare (full screen images) and are not pooled.
+    const std::size_t smallest_block = 256;
+    const int number_of_classes = 13; // Up to 1 MiB.
+
+    // Each class keeps at most this many free blocks.
+    const std::size_t maximum_free = 8;
+
+    //! Holds the free blocks of each size class.
+    struct BlockPool {
+        std::vector<char *> free_blocks[number_of_classes];
+    };
+
+    //! Returns the pool.
+    /*!
+     * The pool is never destroyed since images in static objects may be released after it
+     * would have been.
+     */
+    BlockPool &pool()
+    {
+        static BlockPool *const the_pool = new BlockPool;
+        return *the_pool;
+    }
+
+    //! Returns the size class of a block of size bytes (number_of_classes if too large).
+    int size_class(const std::size_t size)
+    {
+        int block_class = 0;
+        std::size_t block_size = smallest_block;
+        while (block_size < size && block_class < number_of_classes) {
+            block_size *= 2;
+            ++block_class;
+        }
+        return block_class;
+    }
+
+} // namespace
+
 namespace scr {
 
+    //! Allocates storage for size bytes of character cells.
+    /*!
+     * The storage must be returned with `release`, using the same size.
+     *
+     * \throws std::bad_alloc If there is insufficient memory.
+     */
+    char *ImageBuffer::allocate(const std::size_t size)
+    {
+        const int block_class = size_class(size);
+        if (block_class == number_of_classes)
+            return new char[size];
+
+        std::vector<char *> &blocks = pool().free_blocks[block_class];
+        if (!blocks.empty()) {
+            char *const block = blocks.back();
+            blocks.pop_back();
+            return block;
+        }
+        return new char[smallest_block << block_class];
+    }
+
+    //! Returns storage obtained from `allocate` to the pool (nullptr is ignored).
+    void ImageBuffer::release(char *const cells, const std::size_t size)
+    {
+        if (cells == nullptr)
+            return;
+        const int block_class = size_class(size);
+        if (block_class == number_of_classes ||
+            pool().free_blocks[block_class].size() >= maximum_free) {
+            delete[] cells;
+            return;
+        }
+        try {
+            pool().free_blocks[block_class].push_back(cells);
+        }
+        catch (...) {
+            delete[] cells;
+        }
+    }
+
     //! Constructs an Image_Buffer
     /*!
      * This constructor allocates memory to hold an image with the specified dimensions. The
@@ -40,7 +122,8 @@ namespace scr {
 
         this->width = width;
         this->height = height;
-        buffer = new char[2 * width * height];
+        capacity = 2 * width * height;
+        buffer = allocate(capacity);
         clear(color, letter);
     }
 
@@ -55,14 +138,15 @@ namespace scr {
     {
         width = other.width;
         height = other.height;
-        buffer = new char[2 * width * height];
-        std::memcpy(buffer, other.buffer, 2 * width * height);
+        capacity = 2 * width * height;
+        buffer = allocate(capacity);
+        std::memcpy(buffer, other.buffer, capacity);
     }
 
     //! Destroys an ImageBuffer
     ImageBuffer::~ImageBuffer()
     {
-        delete[] buffer;
+        release(buffer, capacity);
     }
 
     //! Assigns an ImageBuffer
@@ -75,13 +159,17 @@ namespace scr {
      */
     ImageBuffer &ImageBuffer::operator=(const ImageBuffer &other)
     {
-        char *temp_buffer = new char[2 * other.width * other.height];
+        if (this == &other)
+            return *this;
+        const std::size_t temp_capacity = 2 * other.width * other.height;
+        char *temp_buffer = allocate(temp_capacity);
 
+        release(buffer, capacity);
         width = other.width;
         height = other.height;
-        delete[] buffer;
+        capacity = temp_capacity;
         buffer = temp_buffer;
-        std::memcpy(buffer, other.buffer, 2 * width * height);
+        std::memcpy(buffer, other.buffer, capacity);
         return *this;
     }
 
@@ -146,6 +234,196 @@ namespace scr {
         }
     }
 
+    //! Clips a region to the image.
+    /*!
+     * The region is reduced to the part of it that lies inside the image. Positions before the
+     * first row or column are moved to it.
+     *
+     * \return false if no part of the region lies inside the image.
+     */
+    bool ImageBuffer::clip(int &row, int &column, int &region_width, int &region_height) const
+    {
+        if (row < 1) {
+            region_height -= 1 - row;
+            row = 1;
+        }
+        if (column < 1) {
+            region_width -= 1 - column;
+            column = 1;
+        }
+        if (region_width > width - column + 1)
+            region_width = width - column + 1;
+        if (region_height > height - row + 1)
+            region_height = height - row + 1;
+        return region_width > 0 && region_height > 0;
+    }
+
+    //! Fills a region of an ImageBuffer.
+    /*!
+     * This method sets every character cell in the region to the given character and color
+     * attribute. It has the same effect on the image as scr::clear has on the screen. The parts
+     * of the region outside the image are ignored.
+     *
+     * \param row The top row of the region (first row is 1).
+     * \param column The left column of the region (first column is 1).
+     * \param width The width of the region.
+     * \param height The height of the region.
+     * \param color The color attribute used for each character cell.
+     * \param letter The character used for each character cell.
+     */
+    void ImageBuffer::fill(int row, int column, int width, int height, int color, char letter)
+    {
+        if (!clip(row, column, width, height))
+            return;
+        for (int i = row; i < row + height; ++i) {
+            char *p = buffer + 2 * ((i - 1) * this->width + (column - 1));
+            for (int j = 0; j < width; ++j) {
+                *p++ = letter;
+                *p++ = static_cast<char>(color);
+            }
+        }
+    }
+
+    //! Copies text into a row of an ImageBuffer, keeping the color attributes there.
+    /*!
+     * This method has the same effect on the image as scr::print_text has on the screen. Unlike
+     * copy, the text is not wrapped to the next row; characters past the right edge of the
+     * image are dropped.
+     *
+     * \param source Pointer to the C style (null terminated) string to copy.
+     * \param row The row where the copy will be placed (first row is 1).
+     * \param column The starting column where the copy will be placed (first column is 1).
+     * \param extent The maximum number of characters to copy.
+     */
+    void ImageBuffer::copy_text(const char *source, int row, int column, std::size_t extent)
+    {
+        if (row < 1 || row > height || column > width)
+            return;
+        for (; column < 1 && *source && extent != 0; ++column, ++source, --extent) {
+        }
+        char *p = buffer + 2 * ((row - 1) * width + (column - 1));
+        for (; *source && extent != 0 && column <= width; ++column, ++source, --extent) {
+            *p = *source;
+            p += 2;
+        }
+    }
+
+    //! Copies characters and their color attributes into a row of an ImageBuffer.
+    /*!
+     * This method has the same effect on the image as scr::write of a single row has on the
+     * screen. The cells use the format of the image: each character followed by its color
+     * attribute. Cells past the right edge of the image are dropped.
+     *
+     * \param cells Pointer to the cells to copy.
+     * \param row The row where the copy will be placed (first row is 1).
+     * \param column The starting column where the copy will be placed (first column is 1).
+     * \param extent The number of cells to copy.
+     */
+    void ImageBuffer::copy_cells(const char *cells, int row, int column, std::size_t extent)
+    {
+        int count = static_cast<int>(extent);
+        int rows = 1;
+        const int first = column;
+        if (!clip(row, column, count, rows))
+            return;
+        std::memcpy(buffer + 2 * ((row - 1) * width + (column - 1)),
+                    cells + 2 * (column - first), 2 * count);
+    }
+
+    //! Changes the color attributes of a region of an ImageBuffer.
+    /*!
+     * This method has the same effect on the image as scr::set_color has on the screen. The
+     * characters in the region are not changed. The parts of the region outside the image are
+     * ignored.
+     *
+     * \param row The top row of the region (first row is 1).
+     * \param column The left column of the region (first column is 1).
+     * \param width The width of the region.
+     * \param height The height of the region.
+     * \param color The new color attribute of each character cell.
+     */
+    void ImageBuffer::set_color(int row, int column, int width, int height, int color)
+    {
+        if (!clip(row, column, width, height))
+            return;
+        for (int i = row; i < row + height; ++i) {
+            char *p = buffer + 2 * ((i - 1) * this->width + (column - 1)) + 1;
+            for (int j = 0; j < width; ++j, p += 2)
+                *p = static_cast<char>(color);
+        }
+    }
+
+    //! Draws a box into an ImageBuffer.
+    /*!
+     * This method has the same effect on the image as scr::draw_box has on the screen. The
+     * parts of the box outside the image are ignored.
+     *
+     * \param row The top row of the box (first row is 1).
+     * \param column The left column of the box (first column is 1).
+     * \param width The total width of the box.
+     * \param height The total height of the box.
+     * \param the_type The kind of lines used to draw the box.
+     * \param color The color attribute of the box.
+     */
+    void ImageBuffer::draw_box(int row, int column, int width, int height, BoxType the_type,
+                               int color)
+    {
+        if (width < 2 || height < 2)
+            return;
+        const BoxChars *const box_type = get_box_characters(the_type);
+        const char horizontal = static_cast<char>(box_type->horizontal);
+        const char vertical = static_cast<char>(box_type->vertical);
+
+        fill(row, column + 1, width - 2, 1, color, horizontal);
+        fill(row + height - 1, column + 1, width - 2, 1, color, horizontal);
+        fill(row + 1, column, 1, height - 2, color, vertical);
+        fill(row + 1, column + width - 1, 1, height - 2, color, vertical);
+        fill(row, column, 1, 1, color, static_cast<char>(box_type->upper_left));
+        fill(row, column + width - 1, 1, 1, color, static_cast<char>(box_type->upper_right));
+        fill(row + height - 1, column, 1, 1, color, static_cast<char>(box_type->lower_left));
+        fill(row + height - 1, column + width - 1, 1, 1, color,
+             static_cast<char>(box_type->lower_right));
+    }
+
+    //! Scrolls a region of an ImageBuffer.
+    /*!
+     * This method has the same effect on the image as scr::scroll has on the screen: `UP` means
+     * that the contents of the region move up. The rows exposed are cleared to the given color
+     * attribute. The parts of the region outside the image are ignored.
+     *
+     * \param direction The direction to scroll. Must be either `scr::UP` or `scr::DOWN`.
+     * \param row The top row of the region (first row is 1).
+     * \param column The left column of the region (first column is 1).
+     * \param width The width of the region.
+     * \param height The height of the region.
+     * \param number_of_rows The number of rows to scroll.
+     * \param color The color attribute used in the exposed rows.
+     */
+    void ImageBuffer::scroll(direction_t direction, int row, int column, int width, int height,
+                             int number_of_rows, int color)
+    {
+        if (number_of_rows <= 0 || !clip(row, column, width, height))
+            return;
+        if (number_of_rows >= height) {
+            fill(row, column, width, height, color);
+            return;
+        }
+
+        const int moved = height - number_of_rows;
+        for (int i = 0; i < moved; ++i) {
+            // Rows are moved in the order that never overwrites a row before it is copied.
+            const int target = (direction == UP) ? row + i : row + height - 1 - i;
+            const int source =
+                (direction == UP) ? target + number_of_rows : target - number_of_rows;
+            std::memcpy(buffer + 2 * ((target - 1) * this->width + (column - 1)),
+                        buffer + 2 * ((source - 1) * this->width + (column - 1)), 2 * width);
+        }
+        if (direction == UP)
+            fill(row + moved, column, width, number_of_rows, color);
+        else
+            fill(row, column, width, number_of_rows, color);
+    }
+
     //! Reads an ImageBuffer from the screen.
     /*!
      * This method reads the characters (and their color attributes) from the screen and places
@@ -184,6 +462,26 @@ namespace scr {
         scr::write(row, column, width, height, buffer);
     }
 
+    //! Writes part of one row of an ImageBuffer to the screen.
+    /*!
+     * This method allows the visible parts of an image that is partly covered to be written
+     * without disturbing what covers it. The part written must be inside the image.
+     *
+     * \param row The screen row that is written (first is 1).
+     * \param column The screen column where the part written starts (first is 1).
+     * \param image_row The row of the image that is written (first is 1).
+     * \param image_column The column of the image where the part written starts (first is 1).
+     * \param extent The number of character cells written.
+     * \throws Bad_Region if the region being written overlaps or is outside the screen
+     * boundary.
+     */
+    void ImageBuffer::write(int row, int column, int image_row, int image_column, int extent)
+    {
+        check_region(row, column, extent, 1);
+        scr::write(row, column, extent, 1,
+                   buffer + 2 * ((image_row - 1) * width + (image_column - 1)));
+    }
+
     //! Resizes an ImageBuffer
     /*!
      * This method resizes an existing image. If the number of rows or the number of columns are
@@ -191,8 +489,11 @@ namespace scr {
      * the number of colums is made larger, the new space is initialized with the specified
      * character and the specified color attribute. Note that images must contain at least one
      * row and one column. If the provided width and height values are less than one, a size of
-     * one is used instead. Note also that this method might throw a std::bad_alloc exception
-     * even if the image is being reduced in size.
+     * one is used instead.
+     *
+     * The rows are rearranged in place if the image's storage is big enough. Otherwise it is
+     * replaced by storage at least half again as big. If there is insufficient memory for that,
+     * the image is not changed.
      *
      * \param new_width The desired new width of the region.
      * \param new_height The desired new height of the region.
@@ -206,31 +507,45 @@ namespace scr {
             new_width = 1;
         if (new_height < 1)
             new_height = 1;
+        if (new_width == width && new_height == height)
+            return;
 
-        char *temp = new char[2 * new_width * new_height];
-
-        // Copy old data one row at a time.
-        for (int i = 1; i <= new_height; ++i) {
+        const std::size_t needed = 2 * new_width * new_height;
+        char *target = buffer;
+        std::size_t target_capacity = capacity;
+        if (needed > capacity) {
+            target_capacity = std::max(needed, capacity + capacity / 2);
+            target = allocate(target_capacity);
+        }
 
-            // Fill row i of the new region with given letter and color.
-            for (int j = 1; j <= new_width; ++j) {
-                int new_offset = (i - 1) * new_width + (j - 1);
-                temp[2 * new_offset] = letter;
-                temp[2 * new_offset + 1] = color;
-            }
+        // Move the rows that are kept. Rows that get narrower move toward the start and are
+        // moved first to last; rows that get wider move toward the end and are moved last to
+        // first. Either way no row is overwritten before it has been moved.
+        const int kept_rows = std::min(height, new_height);
+        const std::size_t kept_bytes = 2 * std::min(width, new_width);
+        if (new_width <= width) {
+            for (int i = 0; i < kept_rows; ++i)
+                std::memmove(target + 2 * i * new_width, buffer + 2 * i * width, kept_bytes);
+        }
+        else {
+            for (int i = kept_rows - 1; i >= 0; --i)
+                std::memmove(target + 2 * i * new_width, buffer + 2 * i * width, kept_bytes);
+        }
 
-            // If we are not off the end of the old region...
-            if (i <= height) {
-                int new_offset = (i - 1) * new_width;
-                int old_offset = (i - 1) * width;
-                int copy_width = (new_width < width) ? new_width : width;
-                std::memcpy(temp + (2 * new_offset), buffer + (2 * old_offset), copy_width);
+        // Fill the new space: the ends of the kept rows and then any new rows.
+        for (int i = 0; i < new_height; ++i) {
+            const int first_new = (i < kept_rows) ? std::min(width, new_width) : 0;
+            for (int j = first_new; j < new_width; ++j) {
+                target[2 * (i * new_width + j)] = letter;
+                target[2 * (i * new_width + j) + 1] = static_cast<char>(color);
             }
         }
 
-        // Update current object.
-        delete[] buffer;
-        buffer = temp;
+        if (target != buffer) {
+            release(buffer, capacity);
+            buffer = target;
+            capacity = target_capacity;
+        }
         width = new_width;
         height = new_height;
     }
@@ -3,6 +3,7 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cstring>
 
 #include "screen/InputWindow.hpp"
@@ -135,8 +136,9 @@ namespace scr {
                  ACTIVE_DESC.primary_attribute)) == true) {
 
             // Display the prompt and learn about the current cursor location.
-            print(SimpleWindow::row(), SimpleWindow::column() + 1, SimpleWindow::width() - 2,
-                  SimpleWindow::color(), prompt_text, SimpleWindow::color());
+            const std::size_t room = SimpleWindow::width() - 2;
+            write_span(SimpleWindow::row(), SimpleWindow::column() + 1, prompt_text,
+                       std::min(std::strlen(prompt_text), room), SimpleWindow::color());
             get_cursor_position(current_row, current_column);
 
             // Get the data from the user.
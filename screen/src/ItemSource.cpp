@@ -0,0 +1,50 @@
+/*! \file    ItemSource.cpp
+ *  \brief   Implementation of the classes that supply the items a window shows.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdlib>
+#include <iterator>
+
+#include "screen/ItemSource.hpp"
+
+using namespace std;
+
+namespace scr {
+
+    long ListSource::count() const
+    {
+        return (text == nullptr) ? 0L : static_cast<long>(text->size());
+    }
+
+    /*!
+     * A list can only be walked an item at a time, so the walk to first starts from whichever
+     * of the two ends or the place of the last fetch is closest.
+     */
+    void ListSource::fetch(long first, long number, vector<string> &items) const
+    {
+        const long size = count();
+        if (first < 0)
+            first = 0;
+        if (first >= size || number <= 0)
+            return;
+
+        list<string>::iterator current = text->begin();
+        long distance = first;
+        if (size - first < distance) {
+            current = text->end();
+            distance = first - size;
+        }
+        if (last_index >= 0 && last_index < size && labs(first - last_index) < labs(distance)) {
+            current = last;
+            distance = first - last_index;
+        }
+        advance(current, distance);
+        last = current;
+        last_index = first;
+
+        for (; number > 0 && current != text->end(); --number, ++current)
+            items.push_back(*current);
+    }
+
+} // namespace scr
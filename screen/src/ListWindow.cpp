@@ -75,6 +75,7 @@ namespace scr {
         managed_list.push_back(new_item);
         if (managed_list.size() > max_items)
             managed_list.pop_front();
+        mark_dirty();
     }
 
 } // namespace scr
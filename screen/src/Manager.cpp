@@ -3,6 +3,7 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <list>
 #include <stdexcept>
 
@@ -20,11 +21,14 @@ namespace scr {
      * underlying screen Initialize() function is executed causing the screen the clear.
      * Initially Managers are not in "system mode" and so all key strokes are sent to the top
      * window for processing. Use ALT+S to toggle system mode and thus cause the Manager to
-     * intercept certain window control keys.
+     * intercept certain window control keys. The first update of the display builds the entire
+     * screen.
      *
      *  \throws std::runtime_error if the screen initialization fails.
      */
-    Manager::Manager() : the_windows(), system_mode(false), key_array(0), key_count(0)
+    Manager::Manager()
+        : the_windows(), owners(), owners_rows(0), owners_columns(0), layout_changed(true),
+          system_mode(false), key_array(0), key_count(0)
     {
         if (!initialize()) {
             throw runtime_error("scr::Manager::Manager failed");
@@ -72,28 +76,7 @@ namespace scr {
     bool Manager::register_window(Window *new_window, int row, int column, int width,
                                   int height)
     {
-        int total_rows = number_of_rows();
-        int total_columns = number_of_columns();
-
-        // General sanity checks. Make empty windows illegal.
-        if (width < 1)
-            width = 1;
-        if (height < 1)
-            height = 1;
-
-        // Sanity checks. Keep the window on screen.
-        if (row < 2)
-            row = 2;
-        if (column < 2)
-            column = 2;
-        if (row > total_rows - 1)
-            row = total_rows - 1;
-        if (column > total_columns - 1)
-            column = total_columns - 1;
-        if (width > total_columns - column)
-            width = total_columns - column;
-        if (height > total_rows - row)
-            height = total_rows - row;
+        fit_window(new_window, row, column, width, height);
 
         // If the window doesn't like its initial position and size, we give up.
         if (!new_window->reposition(row, column))
@@ -102,13 +85,47 @@ namespace scr {
             return false;
 
         // Build a new WindowInformation object with info about the new window.
-        const WindowInformation new_information = {new_window, row, column, width, height};
+        const WindowInformation new_information = {new_window, row,    column,
+                                                   width,      height, false};
 
         // Put it at the end. The new window is in the foreground.
         the_windows.push_back(new_information);
+        layout_changed = true;
         return true;
     }
 
+    //! Adjusts the location and size of a window so that it is on the screen.
+    /*!
+     * Empty windows are made one character in size. Room is left around the printable area of
+     * windows that have a border drawn by the manager.
+     */
+    void Manager::fit_window(const Window *w, int &row, int &column, int &width, int &height)
+    {
+        const int margin = w->has_border() ? 1 : 0;
+        int total_rows = number_of_rows();
+        int total_columns = number_of_columns();
+
+        // General sanity checks. Make empty windows illegal.
+        if (width < 1)
+            width = 1;
+        if (height < 1)
+            height = 1;
+
+        // Sanity checks. Keep the window on screen.
+        if (row < 1 + margin)
+            row = 1 + margin;
+        if (column < 1 + margin)
+            column = 1 + margin;
+        if (row > total_rows - margin)
+            row = total_rows - margin;
+        if (column > total_columns - margin)
+            column = total_columns - margin;
+        if (width > total_columns - column + 1 - margin)
+            width = total_columns - column + 1 - margin;
+        if (height > total_rows - row + 1 - margin)
+            height = total_rows - row + 1 - margin;
+    }
+
     //! Deregister a window from the window manager.
     /*!
      * The Window destructor uses this function to deregister its window from the Manager.
@@ -122,6 +139,7 @@ namespace scr {
         while (stepper != the_windows.end()) {
             if (stepper->the_window == old_window) {
                 the_windows.erase(stepper);
+                layout_changed = true;
                 break;
             }
             ++stepper;
@@ -156,52 +174,329 @@ namespace scr {
         return;
     }
 
-    //! Refresh the entire display.
+    //! Returns the location of the window pointed at by 'w.'
     /*!
-     * This function builds the display with all windows shown in the correct order, with the
-     * correct positioning, and using the correct attributes. Every character on the display is
-     * recomputed.
+     * This method looks up the coordinates of the upper left corner of the given window's
+     * printable area in the manager's database. Like get_size() it performs a linear search.
+     *
+     * \param w The window for which the location is to be retrieved.
+     * \param row Location to receive the window's row coordinate.
+     * \param column Location to receive the window's column coordinate.
      */
-    void Manager::update_display()
+    void Manager::get_position(Window *w, int &row, int &column)
     {
-        // This sets the background. For now let's just use a plain background.
-        clear(1, 1, number_of_columns(), number_of_rows(), WHITE | REV_BLACK);
+        for (const WindowInformation &information : the_windows) {
+            if (information.the_window == w) {
+                row = information.row_position;
+                column = information.column_position;
+                return;
+            }
+        }
+    }
+
+    //! Scrolls rows of a window on the screen.
+    /*!
+     * A window that has scrolled rows of its image can ask for the same rows to be scrolled on
+     * the screen. The screen's refresh is then able to scroll the terminal instead of writing
+     * the rows again; only the rows exposed have to be written when the window is shown. The
+     * screen is not changed if the rows are partly covered or if the screen is about to be
+     * rebuilt anyway.
+     *
+     * \param w The window that scrolled.
+     * \param row The first of the rows in the window's printable area (first row is 1).
+     * \param height The number of rows that scrolled.
+     * \param count The number of rows the contents moved up (down if negative).
+     */
+    void Manager::scroll_window(const Window *w, const int row, const int height,
+                                const int count)
+    {
+        if (count == 0 || layout_changed || owners_rows != number_of_rows() ||
+            owners_columns != number_of_columns())
+            return;
+        for (const WindowInformation &information : the_windows) {
+            if (information.the_window != w)
+                continue;
+            if (!information.visible || row < 1 || row + height - 1 > information.height)
+                return;
 
-        // Step down the list of WindowInformation structures.
+            const int top = information.row_position + row - 1;
+            const int left = information.column_position;
+            const int right = left + information.width - 1;
+            if (top < 1 || top + height - 1 > owners_rows || left < 1 || right > owners_columns)
+                return;
+            for (int i = top; i < top + height; ++i) {
+                const Window *const *owner = &owners[(i - 1) * owners_columns];
+                for (int j = left; j <= right; ++j) {
+                    if (owner[j - 1] != w)
+                        return;
+                }
+            }
+            scr::scroll((count > 0) ? UP : DOWN, top, left, information.width, height,
+                        (count > 0) ? count : -count, WHITE | REV_BLACK);
+            return;
+        }
+    }
+
+    //! Moves and resizes a window.
+    /*!
+     * This method allows the application to arrange its windows, for example to tile them. The
+     * new location and size are adjusted as they are when the window is registered and the
+     * window is given the opportunity to decline them.
+     *
+     * \param w The window to be moved.
+     * \param row The new row coordinate of the window's printable area.
+     * \param column The new column coordinate of the window's printable area.
+     * \param width The new width of the window's printable area.
+     * \param height The new height of the window's printable area.
+     * \return true if the window accepted its new location and size; false otherwise. In that
+     * case the window is not changed.
+     */
+    bool Manager::set_geometry(Window *w, int row, int column, int width, int height)
+    {
+        for (WindowInformation &information : the_windows) {
+            if (information.the_window != w)
+                continue;
+            fit_window(w, row, column, width, height);
+            if (row == information.row_position && column == information.column_position &&
+                width == information.width && height == information.height)
+                return true;
+            if (!w->reposition(row, column) || !w->resize(width, height))
+                return false;
+            information.row_position = row;
+            information.column_position = column;
+            information.width = width;
+            information.height = height;
+            layout_changed = true;
+            return true;
+        }
+        return false;
+    }
+
+    //! Makes a window the foreground window.
+    /*!
+     * \param w The window to bring to the foreground. If the manager is not managing this
+     * window, there is no effect.
+     */
+    void Manager::raise_window(const Window *w)
+    {
         list<WindowInformation>::iterator stepper = the_windows.begin();
         while (stepper != the_windows.end()) {
+            if (stepper->the_window == w) {
+                the_windows.splice(the_windows.end(), the_windows, stepper);
+                layout_changed = true;
+                return;
+            }
+            ++stepper;
+        }
+    }
 
-            // Get a pointer to the current image.
-            ImageBuffer *ptr = stepper->the_window->get_image();
+    //! Finds the topmost window at each position of the screen.
+    /*!
+     * Each window covers its printable area and its border (if it has one). Windows later in
+     * the list are in front of those earlier in the list. Windows with no uncovered parts are
+     * marked as not visible.
+     */
+    void Manager::find_owners()
+    {
+        owners_rows = number_of_rows();
+        owners_columns = number_of_columns();
+        owners.assign(static_cast<std::size_t>(owners_rows) * owners_columns, nullptr);
+
+        // Computes the part of the screen covered by a window, including its border.
+        auto covered = [this](const WindowInformation &information, int &top, int &left,
+                              int &bottom, int &right) {
+            const int margin = information.the_window->has_border() ? 1 : 0;
+            top = std::max(1, information.row_position - margin);
+            left = std::max(1, information.column_position - margin);
+            bottom = std::min(owners_rows,
+                              information.row_position + information.height - 1 + margin);
+            right = std::min(owners_columns,
+                             information.column_position + information.width - 1 + margin);
+        };
+
+        int top, left, bottom, right;
+        for (const WindowInformation &information : the_windows) {
+            covered(information, top, left, bottom, right);
+            for (int row = top; row <= bottom; ++row) {
+                for (int column = left; column <= right; ++column)
+                    owners[(row - 1) * owners_columns + (column - 1)] = information.the_window;
+            }
+        }
 
-            // Write the image into the virtual screen. This assumes a border is present.
-            ptr->write(stepper->row_position, stepper->column_position);
+        for (WindowInformation &information : the_windows) {
+            covered(information, top, left, bottom, right);
+            information.visible = false;
+            for (int row = top; row <= bottom && !information.visible; ++row) {
+                for (int column = left; column <= right && !information.visible; ++column) {
+                    if (owners[(row - 1) * owners_columns + (column - 1)] ==
+                        information.the_window)
+                        information.visible = true;
+                }
+            }
+        }
+    }
 
-            // Draw the border around the window.
-            draw_box(stepper->row_position - 1, stepper->column_position - 1,
-                     stepper->width + 2, stepper->height + 2, SINGLE_LINE, WHITE);
+    //! Writes the uncovered parts of a window's printable area to the screen.
+    /*!
+     * Only the part inside the region from (top, left) to (bottom, right) is written. Windows
+     * that are entirely covered, or outside the region, are not asked for their images at all.
+     */
+    void Manager::composite(const WindowInformation &information, const int top,
+                            const int left, const int bottom, const int right)
+    {
+        if (!information.visible)
+            return;
+        const int first_row = std::max(top, information.row_position);
+        const int first_column = std::max(left, information.column_position);
+        int last_row = std::min(bottom, information.row_position + information.height - 1);
+        int last_column = std::min(right, information.column_position + information.width - 1);
+        if (first_row > last_row || first_column > last_column)
+            return;
 
-            ++stepper;
+        ImageBuffer *image = information.the_window->get_image();
+        last_row = std::min(last_row, information.row_position + image->get_height() - 1);
+        last_column =
+            std::min(last_column, information.column_position + image->get_width() - 1);
+
+        // Write each run of uncovered positions on each row.
+        for (int row = first_row; row <= last_row; ++row) {
+            const Window *const *owner = &owners[(row - 1) * owners_columns];
+            int column = first_column;
+            while (column <= last_column) {
+                if (owner[column - 1] != information.the_window) {
+                    ++column;
+                    continue;
+                }
+                const int start = column;
+                while (column <= last_column && owner[column - 1] == information.the_window)
+                    ++column;
+                image->write(row, start, row - information.row_position + 1,
+                             start - information.column_position + 1, column - start);
+            }
         }
+    }
 
-        // If the list wasn't empty...
-        if (the_windows.size() != 0) {
-            --stepper;
+    //! Writes the uncovered parts of a window's border that are inside a region.
+    /*!
+     * The region is as for `composite`. This is used when only part of the screen is rebuilt;
+     * otherwise the whole border is drawn and the windows in front are drawn over it.
+     */
+    void Manager::frame(const WindowInformation &information, const int top, const int left,
+                        const int bottom, const int right)
+    {
+        if (!information.visible || !information.the_window->has_border())
+            return;
+        const int box_top = information.row_position - 1;
+        const int box_left = information.column_position - 1;
+        const int box_bottom = information.row_position + information.height;
+        const int box_right = information.column_position + information.width;
+
+        const bool foreground = &information == &the_windows.back();
+        ImageBuffer box(information.width + 2, information.height + 2);
+        box.draw_box(1, 1, information.width + 2, information.height + 2,
+                     foreground ? DOUBLE_LINE : SINGLE_LINE,
+                     foreground ? (BRIGHT | WHITE) : WHITE);
+
+        const int last_row = std::min(bottom, box_bottom);
+        const int last_column = std::min(right, box_right);
+        for (int row = std::max(top, box_top); row <= last_row; ++row) {
+            const bool edge_row = row == box_top || row == box_bottom;
+            const Window *const *owner = &owners[(row - 1) * owners_columns];
+            for (int column = std::max(left, box_left); column <= last_column; ++column) {
+                const bool edge = edge_row || column == box_left || column == box_right;
+                if (edge && owner[column - 1] == information.the_window)
+                    box.write(row, column, row - box_top + 1, column - box_left + 1, 1);
+            }
+        }
+    }
 
-            // Draw the foreground window with a different border.
-            draw_box(stepper->row_position - 1, stepper->column_position - 1,
-                     stepper->width + 2, stepper->height + 2, DOUBLE_LINE, BRIGHT | WHITE);
+    //! Builds the whole screen from the windows, in order.
+    void Manager::rebuild()
+    {
+        find_owners();
+
+        // This sets the background. For now let's just use a plain background.
+        clear(1, 1, number_of_columns(), number_of_rows(), WHITE | REV_BLACK);
+
+        // Step down the list of WindowInformation structures. The borders of the windows
+        // behind are overwritten by the windows in front of them.
+        for (const WindowInformation &information : the_windows) {
+            composite(information, 1, 1, owners_rows, owners_columns);
+            if (information.visible && information.the_window->has_border()) {
+                const bool foreground = &information == &the_windows.back();
+                draw_box(information.row_position - 1, information.column_position - 1,
+                         information.width + 2, information.height + 2,
+                         foreground ? DOUBLE_LINE : SINGLE_LINE,
+                         foreground ? (BRIGHT | WHITE) : WHITE);
+            }
+            information.the_window->mark_clean();
+        }
+        layout_changed = false;
+    }
+
+    //! Brings the display up to date.
+    /*!
+     * This function builds the display with all windows shown in the correct order, with the
+     * correct positioning, and using the correct attributes. If the windows have not been
+     * rearranged since the last update (and the screen has not changed size) only the dirty
+     * windows are shown again. Only the parts of windows that are not covered by other windows
+     * are written, so a popup window in front of others does not cause them to be redrawn.
+     */
+    void Manager::update_display()
+    {
+        if (layout_changed || owners_rows != number_of_rows() ||
+            owners_columns != number_of_columns()) {
+            rebuild();
+        }
+        else {
+            for (const WindowInformation &information : the_windows) {
+                if (information.the_window->is_dirty()) {
+                    composite(information, 1, 1, owners_rows, owners_columns);
+                    information.the_window->mark_clean();
+                }
+            }
+        }
 
-            // Position the cursor on the screen correctly.
-            set_cursor_position(stepper->row_position + stepper->the_window->cursor_row() - 1,
-                                stepper->column_position +
-                                    stepper->the_window->cursor_column() - 1);
+        // Position the cursor on the screen correctly.
+        if (the_windows.size() != 0) {
+            const WindowInformation &top = the_windows.back();
+            set_cursor_position(top.row_position + top.the_window->cursor_row() - 1,
+                                top.column_position + top.the_window->cursor_column() - 1);
         }
 
         // Copy stuff to the physical screen.
         refresh();
     }
 
+    //! Rebuilds a region of the screen from the windows' images.
+    /*!
+     * This is used to restore the screen when something drawn over the windows (such as a
+     * popup) is removed. Only the windows in the region are asked for their images and only
+     * the region is written. If the windows have been rearranged, the whole screen is rebuilt.
+     * The physical screen is not refreshed.
+     */
+    void Manager::repair(const int row, const int column, const int width, const int height)
+    {
+        if (layout_changed || owners_rows != number_of_rows() ||
+            owners_columns != number_of_columns()) {
+            rebuild();
+            return;
+        }
+
+        const int top = std::max(1, row);
+        const int left = std::max(1, column);
+        const int bottom = std::min(owners_rows, row + height - 1);
+        const int right = std::min(owners_columns, column + width - 1);
+        if (top > bottom || left > right)
+            return;
+
+        clear(top, left, right - left + 1, bottom - top + 1, WHITE | REV_BLACK);
+        for (const WindowInformation &information : the_windows) {
+            composite(information, top, left, bottom, right);
+            frame(information, top, left, bottom, right);
+        }
+    }
+
     //! Read and process input key strokes infinitely.
     /*!
      * This function loops infinitely, updating the display and then accepting key stroke input.
@@ -359,6 +654,7 @@ namespace scr {
                     default:
                         break;
                     }
+                    layout_changed = true;
                 }
             }
         } // End of while( true ) loop.
@@ -379,6 +675,7 @@ namespace scr {
         const WindowInformation temp = the_windows.back();
         the_windows.pop_back();
         the_windows.push_front(temp);
+        layout_changed = true;
     }
 
     //! This is semantically meaningless. It only exists to satisfy OW's eager instantiation.
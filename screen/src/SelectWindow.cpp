@@ -17,6 +17,7 @@ namespace scr {
     {
         highlight_color = Status_Color;
         show_bar = false;
+        current = 0;
         return DisplayWindow::open(row, column, width, height, color, Status_Color, border,
                                    border_color);
     }
@@ -24,8 +25,6 @@ namespace scr {
     void SelectWindow::show()
     {
         char buffer[160];
-        // I will probably need a private member to hold the current position.
-        long current = 0;
 
         DisplayWindow::show();
         if (show_bar) {
@@ -43,8 +42,6 @@ namespace scr {
     {
         int return_value;
         bool stop = false;
-        list<string>::iterator p = text->begin();
-        long current_index = 0;
 
         // If caller wants to force the display to a certain line, try to honor.
         if (forced != -1L)
@@ -56,41 +53,57 @@ namespace scr {
         // Loop until user presses an invalid key.
         do {
             show();
+            if (idle) {
+                while (!key_available(50)) {
+                    if (idle())
+                        show();
+                    refresh();
+                }
+            }
             switch (return_value = key()) {
             case K_UP:
-                if (p != text->begin()) {
-                    --p;
-                    --current_index;
-                }
-                if (current_index < top_line)
-                    top_line--;
+                if (current > 0)
+                    --current;
+                if (current < top_line)
+                    top_line = current;
                 break;
 
             case K_DOWN:
-                if (p != text->end()) {
-                    ++p;
-                    ++current_index;
-                }
-                if (current_index >= top_line + height())
-                    top_line++;
+                if (current + 1 < source->count())
+                    ++current;
+                if (current >= top_line + height())
+                    top_line = current - height() + 1;
                 break;
 
             case K_PGUP:
-                // Not implemented.
+                current -= height();
+                if (current < 0)
+                    current = 0;
+                top_line -= height();
+                if (top_line > current)
+                    top_line = current;
                 break;
 
-            case K_PGDN:
-                // Not implemented.
+            case K_PGDN: {
+                const long last = source->count() - 1;
+                current += height();
+                if (current > last)
+                    current = (last < 0) ? 0 : last;
+                top_line += height();
+                if (current >= top_line + height())
+                    top_line = current - height() + 1;
                 break;
+            }
 
             case K_CPGUP:
-                p = text->begin();
-                current_index = 0;
+                current = 0;
+                top_line = 0;
                 break;
 
             case K_CPGDN:
-                p = text->end();
-                current_index = text->size();
+                current = (source->count() == 0) ? 0 : source->count() - 1;
+                if (current >= top_line + height())
+                    top_line = current - height() + 1;
                 break;
 
             default:
@@ -3,8 +3,7 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cstring>
-
+#include "screen/ImageBuffer.hpp"
 #include "screen/Shadow.hpp"
 #include "screen/screen.hpp"
 
@@ -15,7 +14,8 @@ namespace scr {
      * Before changing the attributes, this function saves the data in the region. Although only
      * attributes need to be saved, this function saves both text and attributes as a
      * convenience. When the shadow is erased, the text and attributes are written back. It is
-     * assumed that the shaded material is not changed while the shadow is on it.
+     * assumed that the shaded material is not changed while the shadow is on it. The shadow
+     * color is set directly in the screen image, a row at a time.
      *
      * \param row The row coordinate of the region's upper left corner.
      * \param column The column coordinate of the region's upper left corner.
@@ -24,8 +24,6 @@ namespace scr {
      */
     void Shadow::open(int row, int column, int width, int height)
     {
-        char *workspace;
-
         // Ignore call if shadow already open.
         if (background != nullptr)
             return;
@@ -37,7 +35,7 @@ namespace scr {
             width = number_of_columns() + 1 - column;
 
         // Get memory to hold the true image. Only attributes are really necessary.
-        background = new char[2 * width * height];
+        background = ImageBuffer::allocate(2 * width * height);
         if (background != nullptr) {
 
             // Copy true image into storage.
@@ -47,22 +45,8 @@ namespace scr {
             shadow_width = width;
             shadow_height = height;
 
-            // Get workspace.
-            workspace = new char[2 * width * height];
-            if (workspace != nullptr) {
-
-                // Get another copy of the image.
-                std::memcpy(workspace, background, 2 * width * height);
-
-                // Set all attributes to shadow color.
-                for (int i = 1; i < 2 * width * height; i += 2) {
-                    workspace[i] = BRIGHT | BLACK | REV_BLACK;
-                }
-
-                // Write shadow back onto screen and erase workspace.
-                write(row, column, width, height, workspace);
-                delete workspace;
-            }
+            // Set all attributes to shadow color.
+            set_color(row, column, width, height, BRIGHT | BLACK | REV_BLACK);
         }
     }
 
@@ -74,7 +58,7 @@ namespace scr {
 
             // Write the original attributes (and text) back onto the screen.
             write(top_row, left_column, shadow_width, shadow_height, background);
-            delete background;
+            ImageBuffer::release(background, 2 * shadow_width * shadow_height);
             background = nullptr;
         }
     }
@@ -3,6 +3,9 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
+#include <cstring>
+
 #include "screen/StatusLine.hpp"
 #include "screen/screen.hpp"
 
@@ -34,8 +37,10 @@ namespace scr {
         bool return_value =
             SimpleWindow::open(row, column, width, 1, attribute, NO_BORDER, attribute);
 
-        if (return_value == true)
-            print_text(row, column, width, make_line());
+        if (return_value == true) {
+            const char *const line = make_line();
+            write_span_text(row, column, line, std::min<std::size_t>(std::strlen(line), width));
+        }
 
         return return_value;
     }
@@ -50,7 +55,9 @@ namespace scr {
     {
         if (is_defined) {
             SimpleWindow::show();
-            print_text(row(), column(), width(), make_line());
+            const char *const line = make_line();
+            write_span_text(
+                row(), column(), line, std::min<std::size_t>(std::strlen(line), width()));
         }
     }
 
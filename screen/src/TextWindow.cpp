@@ -3,6 +3,7 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
@@ -73,10 +74,11 @@ namespace scr {
         vsnprintf(buffer, 128 + 1, format_string, arg_pointer);
 
         // Print material on the screen, making sure the rest of the line is cleared.
-        print_text(actual_row, actual_column, width(), "%s", buffer);
-        if (strlen(buffer) < static_cast<size_t>(width()))
-            scr::clear(actual_row, actual_column + strlen(buffer), width() - strlen(buffer), 1,
-                       color());
+        const size_t length = strlen(buffer);
+        write_span_text(actual_row, actual_column, buffer,
+                        std::min(length, static_cast<size_t>(width())));
+        if (length < static_cast<size_t>(width()))
+            scr::clear(actual_row, actual_column + length, width() - length, 1, color());
 
         // Next call to this function will print on the next row.
         current_row++;
@@ -114,7 +116,8 @@ namespace scr {
         vsnprintf(buffer, 128 + 1, format_string, arg_pointer);
 
         // Print material on the screen.
-        print_text(actual_row, actual_column, width() - print_column - 1, "%s", buffer);
+        const size_t room = width() - print_column - 1;
+        write_span_text(actual_row, actual_column, buffer, std::min(strlen(buffer), room));
 
         va_end(arg_pointer);
     }
@@ -38,6 +38,31 @@ namespace scr {
     /*           Class SimpleWindow           */
     /*========================================*/
 
+    SimpleWindow::RepairFunction SimpleWindow::repair = nullptr;
+    int SimpleWindow::showing = 0;
+
+    //! Saves the background before the window is drawn over it.
+    /*!
+     * A window that repairs its background can only continue to do so if no other window is
+     * showing. Otherwise it starts saving its background from now on.
+     */
+    void SimpleWindow::save_background()
+    {
+        if (save_data == nullptr && (repair == nullptr || showing != 0))
+            save_data = ImageBuffer::allocate(image_size());
+        if (save_data != nullptr)
+            read(total_row, total_column, total_width, total_height, save_data);
+    }
+
+    //! Restores the background when the window is taken off the screen.
+    void SimpleWindow::restore_background()
+    {
+        if (save_data != nullptr)
+            write(total_row, total_column, total_width, total_height, save_data);
+        else
+            repair(total_row, total_column, total_width, total_height);
+    }
+
     //! Default constructor
     /*!
      * The constructor sets the pointer to the window image and the pointer to the saved
@@ -50,16 +75,12 @@ namespace scr {
 
     //! Destructor
     /*!
-     * The destructor does nothing if the window has never been opened. It hides the window
+     * The destructor does nothing if the window has never been opened. It closes the window
      * first to ensure that the background material is properly restored.
      */
     SimpleWindow::~SimpleWindow()
     {
-        if (!is_defined)
-            return;
-        hide();
-        delete[] hidden;
-        delete[] save_data;
+        close();
     }
 
     //! Open a window.
@@ -85,13 +106,6 @@ namespace scr {
         if (is_defined)
             return false;
 
-        // Try to allocate memory for background and image.
-        std::size_t size = 2 * width * height;
-
-        // Allocate memory.
-        save_data = new char[size];
-        hidden = new char[size];
-
         // Set members to initial values.
         total_row = window_row = row;
         total_column = window_column = column;
@@ -102,7 +116,7 @@ namespace scr {
         window_border_color = (border_color == WINDOW_COLOR) ? window_color : border_color;
 
         // Draw the window on the screen.
-        read(total_row, total_column, total_width, total_height, save_data);
+        save_background();
         scr::clear(total_row, total_column, total_width, total_height, window_color);
         if (window_border_type != NO_BORDER) {
             window_row++;
@@ -114,6 +128,7 @@ namespace scr {
         }
         is_defined = true;
         is_hidden = false;
+        ++showing;
 
         return true;
     }
@@ -162,8 +177,11 @@ namespace scr {
             return;
 
         if (!is_hidden) {
+            if (hidden == nullptr)
+                hidden = ImageBuffer::allocate(image_size());
             read(total_row, total_column, total_width, total_height, hidden);
-            write(total_row, total_column, total_width, total_height, save_data);
+            --showing;
+            restore_background();
             is_hidden = true;
         }
     }
@@ -179,9 +197,10 @@ namespace scr {
             return;
 
         if (is_hidden) {
-            read(total_row, total_column, total_width, total_height, save_data);
+            save_background();
             write(total_row, total_column, total_width, total_height, hidden);
             is_hidden = false;
+            ++showing;
         }
     }
 
@@ -242,13 +261,19 @@ namespace scr {
 
     //! Closes a window.
     /*!
-     * This method cleans up a window and then re-initializes it.
+     * This method cleans up a window and then re-initializes it. The window's image is not
+     * saved.
      */
     void SimpleWindow::close()
     {
         if (!is_defined)
             return;
-        hide();
+        if (!is_hidden) {
+            --showing;
+            restore_background();
+        }
+        ImageBuffer::release(save_data, image_size());
+        ImageBuffer::release(hidden, image_size());
         save_data = nullptr;
         hidden = nullptr;
         is_hidden = false;
@@ -264,15 +289,20 @@ namespace scr {
      * This constructor initializes a window's internal records and registers the window with
      * the given manager. The window's image is initially blank. The window position and size is
      * defined in terms of the printable area. The window manager adds the border (if any).
+     * Windows that draw their own borders instead (for example, to show information in them)
+     * cover their entire region with their image. The window is dirty until the manager first
+     * shows it.
      *
      * \param my_manager Pointer to the window manager that controls this window.
      * \param row Initial row coordinate of window's upper left corner.
      * \param column Initial column coordinate of window's upper left corner.
      * \param width Initial window width.
      * \param height Initial window height.
+     * \param bordered False if the manager should not draw a border around the window.
      */
-    Window::Window(Manager *my_manager, int row, int column, int width, int height)
-        : my_manager(my_manager), image(width, height)
+    Window::Window(Manager *my_manager, int row, int column, int width, int height,
+                   bool bordered)
+        : bordered(bordered), dirty(true), my_manager(my_manager), image(width, height)
     {
         is_registered = false;
 
@@ -365,6 +395,7 @@ namespace scr {
     bool Window::resize(int new_width, int new_height)
     {
         image.resize(new_width, new_height);
+        mark_dirty();
         return true;
     }
 
@@ -166,12 +166,14 @@
  *   object to the next).
  */
 
+#include <algorithm>
 #include <cctype>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 
+#include "screen/Manager.hpp"
 #include "screen/debug.hpp"
 #include "screen/screen.hpp"
 #include "screen/scrtools.hpp"
@@ -832,8 +834,9 @@ namespace scr {
         open(top_row, left_column, full_width, full_height, color, DOUBLE_LINE);
 
         snprintf(header_buffer, GENERIC_BUF_SIZE + 1, " %s ", header);
-        print_text(row() - 1, column() + width() - 1 - static_cast<int>(strlen(header_buffer)),
-                   strlen(header_buffer), header_buffer);
+        write_span_text(row() - 1,
+                        column() + width() - 1 - static_cast<int>(strlen(header_buffer)),
+                        header_buffer, strlen(header_buffer));
     }
 
     //! Destroy a debug window.
@@ -843,6 +846,75 @@ namespace scr {
             key();
     }
 
+    //! Construct a monitor window.
+    /*!
+     * The window is registered with the manager in front of the windows already there. Its
+     * lines start out blank.
+     */
+    MonitorWindow::MonitorWindow(Manager *manager, int row, int column, int width, int height,
+                                 int color)
+        : Window(manager, row, column, width, height), color(color), cursor_owner(nullptr)
+    {
+        image.clear(color);
+    }
+
+    //! Set the text of a line (the first is 1). The text is cut off at the window's edge.
+    void MonitorWindow::set_line(const int line, const std::string &text)
+    {
+        if (line < 1)
+            return;
+        if (lines.size() < static_cast<std::size_t>(line))
+            lines.resize(line);
+        if (lines[line - 1] == text)
+            return;
+        lines[line - 1] = text;
+        paint(line);
+    }
+
+    //! Return the cursor row, which is that of the owner's cursor if there is one.
+    int MonitorWindow::cursor_row()
+    {
+        if (cursor_owner == nullptr)
+            return 1;
+        int owner_row, owner_column, own_row, own_column;
+        my_manager->get_position(cursor_owner, owner_row, owner_column);
+        my_manager->get_position(this, own_row, own_column);
+        return owner_row + cursor_owner->cursor_row() - own_row;
+    }
+
+    //! Return the cursor column, which is that of the owner's cursor if there is one.
+    int MonitorWindow::cursor_column()
+    {
+        if (cursor_owner == nullptr)
+            return 1;
+        int owner_row, owner_column, own_row, own_column;
+        my_manager->get_position(cursor_owner, owner_row, owner_column);
+        my_manager->get_position(this, own_row, own_column);
+        return owner_column + cursor_owner->cursor_column() - own_column;
+    }
+
+    //! Resize the window, keeping its lines.
+    bool MonitorWindow::resize(const int new_width, const int new_height)
+    {
+        image.resize(new_width, new_height, color);
+        for (std::size_t line = 1; line <= lines.size(); ++line)
+            paint(static_cast<int>(line));
+        mark_dirty();
+        return true;
+    }
+
+    //! Copies a line into the image, blanking the rest of its row.
+    void MonitorWindow::paint(const int line)
+    {
+        if (line > image.get_height())
+            return;
+        const std::string &text = lines[line - 1];
+        const std::size_t width = static_cast<std::size_t>(image.get_width());
+        image.fill(line, 1, image.get_width(), 1, color);
+        image.copy(text, line, 1, std::min(text.size(), width), color);
+        mark_dirty();
+    }
+
 } // namespace scr
 
 #endif
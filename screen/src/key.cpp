@@ -8,9 +8,17 @@
  */
 
 #include "screen/environ.hpp"
+#include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <map>
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 // Produce an error for alien operating systems.
 #if !(eOPSYS == eWINDOWS || eOPSYS == ePOSIX)
@@ -27,15 +35,21 @@
 #endif
 
 #if eOPSYS == ePOSIX
-// We need curses for getch().
+// We need curses for the terminal's description of its keys.
 #define NOMACROS
 #define NCURSES_NOMACROS
 #include <ncurses.h>
+#include <poll.h>
+#include <unistd.h>
 #endif
 
 #include "screen/screen.hpp"
 
 static bool key_refresh = false;
+static unsigned long key_count = 0; // Keystrokes returned by key().
+static std::string paste_buffer; // Text of the most recent paste.
+static int (*scripted_keys)() = nullptr;         // Supplies the keys of a headless screen.
+static void (*key_recorder)(int key) = nullptr; // Is told of each key returned by key().
 
 namespace scr {
 
@@ -86,6 +100,71 @@ namespace scr {
      * key codes.
      */
 
+    /*! \fn bool scr::key_available( int milliseconds )
+     *
+     * This function waits up to the given time for the user to press a key. The keystroke is
+     * not consumed; the next call to scr::key or scr::key_wait returns it. Programs that do
+     * work in the background use this function to stay responsive to the keyboard.
+     *
+     * \brief Check for a pending keystroke.
+     *
+     * \param milliseconds The longest time to wait. Zero checks without waiting.
+     *
+     * \return <b>true</b> if a keystroke is waiting; <b>false</b> otherwise.
+     */
+
+    /*! \fn std::string_view scr::pasted_text( )
+     *
+     * Terminals that support bracketed paste mode (which scr enables) mark text pasted into
+     * them. Instead of returning the pasted characters one at a time, scr::key and
+     * scr::key_wait return K_PASTE and the text is available here. Line breaks are left as the
+     * terminal sent them; usually they are carriage returns.
+     *
+     * \brief Get the text of the most recent paste.
+     *
+     * \return The text. It remains valid until the next call to scr::key or scr::key_wait.
+     */
+
+    std::string_view pasted_text()
+    {
+        return paste_buffer;
+    }
+
+    /*! \fn unsigned long scr::keys_read( )
+     *
+     * A program can tell from this count whether something else (a dialog box, for example)
+     * read keystrokes while it was not looking.
+     *
+     * \brief Get the number of keystrokes returned by scr::key.
+     */
+
+    unsigned long keys_read()
+    {
+        return key_count;
+    }
+
+    /*! \fn void scr::record_keys( void (*recorder)( int key ) )
+     *
+     * The recorder is called with each keycode returned by scr::key, whatever part of the
+     * program asked for it, so that the keystrokes of a session can be replayed later (see
+     * scr::use_headless). Pastes are recorded as K_PASTE without their text.
+     *
+     * \brief Have the keystrokes read reported as they are returned.
+     *
+     * \param recorder The function to call, or nullptr to stop recording.
+     */
+
+    void record_keys(void (*const recorder)(int key))
+    {
+        key_recorder = recorder;
+    }
+
+    //! Makes key_wait return the keys supplied by a headless screen (see scr::use_headless).
+    void script_keys(int (*const keys)())
+    {
+        scripted_keys = keys;
+    }
+
 #if defined(SCR_ASCIIKEYS) || eOPSYS == ePOSIX
 
 #if eOPSYS == ePOSIX
@@ -163,6 +242,225 @@ namespace scr {
                               key_associations + sizeof(key_associations) / sizeof(KeyPair));
     }
 
+    // Milliseconds to wait for the rest of a paste before giving up on its end marker.
+    static const int paste_timeout = 500;
+
+    // The shortest and longest times, in milliseconds, to wait for the rest of an escape
+    // sequence before taking the ESC that starts it as a keystroke of its own.
+    static const int min_escape_timeout = 10;
+    static const int max_escape_timeout = 250;
+
+    // Stands for the sequence that starts a paste in the trie of escape sequences.
+    static const int paste_start = -1;
+
+    //! A node in the trie of the sequences the terminal sends for special keys.
+    struct EscapeNode {
+        int key = 0; //!< The key of the sequence ending here (0 if none does).
+        std::vector<std::pair<unsigned char, std::size_t>> next; //!< The nodes that follow.
+    };
+
+    // The root is the first node. Built by build_escapes when the first key is decoded.
+    static std::vector<EscapeNode> escape_trie(1);
+    static bool escapes_built = false;
+
+    // Bytes read from the terminal that have not been decoded yet.
+    static std::string input;
+
+    // The average time, in microseconds, the rest of an escape sequence took to arrive when it
+    // arrived separately. Sequences usually arrive in one piece, but over slow connections
+    // they may not; the time to wait for them adapts (see escape_timeout).
+    static long sequence_gap = 5000;
+
+    // The node reached by the last sequence abandoned for lack of input, and when it was.
+    static std::size_t abandoned_node = 0;
+    static std::chrono::steady_clock::time_point abandoned_at;
+
+    //! Returns the node following the given one for a byte, or 0 if there is none.
+    static std::size_t escape_child(const std::size_t node, const char byte)
+    {
+        for (const std::pair<unsigned char, std::size_t> &link : escape_trie[node].next) {
+            if (link.first == static_cast<unsigned char>(byte))
+                return link.second;
+        }
+        return 0;
+    }
+
+    //! Adds a sequence to the trie. A key already given a sequence keeps it.
+    static void add_escape(const std::string_view sequence, const int key)
+    {
+        std::size_t node = 0;
+        for (const char byte : sequence) {
+            std::size_t child = escape_child(node, byte);
+            if (child == 0) {
+                child = escape_trie.size();
+                escape_trie[node].next.emplace_back(static_cast<unsigned char>(byte), child);
+                escape_trie.emplace_back();
+            }
+            node = child;
+        }
+        if (escape_trie[node].key == 0)
+            escape_trie[node].key = key;
+    }
+
+    //! Builds the trie from the terminal's description.
+    /*!
+     * Every key the terminal describes is included, as curses would decode it. The keys that
+     * scr doesn't know (including the extended keys curses numbers after KEY_MAX) are returned
+     * with their curses codes, as before. Asking curses for the sequences of every key takes
+     * a few milliseconds, so it is put off until there is input to decode; the first frame is
+     * shown meanwhile.
+     */
+    static void build_escapes()
+    {
+        static const int extended_keys = 1024;
+
+        escapes_built = true;
+        escape_trie.assign(1, EscapeNode());
+        for (int code = KEY_MIN; code <= KEY_MAX + extended_keys; ++code) {
+            const KeyMap::iterator known = curses_key_map.find(code);
+            const int key = (known != curses_key_map.end()) ? known->second : code;
+            for (int count = 0;; ++count) {
+                char *const sequence = keybound(code, count);
+                if (sequence == nullptr)
+                    break;
+                add_escape(sequence, key);
+                std::free(sequence);
+            }
+        }
+        add_escape("\033[200~", paste_start);
+    }
+
+    //! Arranges for the trie to be built (again). Called once curses has been started.
+    void initialize_escapes()
+    {
+        escape_trie.assign(1, EscapeNode());
+        escapes_built = false;
+    }
+
+    //! Returns how long to wait, in milliseconds, for the rest of an escape sequence.
+    static int escape_timeout()
+    {
+        const long timeout = sequence_gap * 4 / 1000;
+        if (timeout < min_escape_timeout)
+            return min_escape_timeout;
+        return timeout > max_escape_timeout ? max_escape_timeout : static_cast<int>(timeout);
+    }
+
+    //! Reads what the terminal has sent, waiting at most the given time (-1 for no limit).
+    /*!
+     * \return true if anything was read.
+     */
+    static bool read_input(const int milliseconds)
+    {
+        struct pollfd ready = {STDIN_FILENO, POLLIN, 0};
+        if (::poll(&ready, 1, milliseconds) <= 0)
+            return false;
+        char block[64 * 1024];
+        const ssize_t received = ::read(STDIN_FILENO, block, sizeof(block));
+        if (received <= 0)
+            return false;
+
+        // If this continues a sequence that was given up on, the wait was too short.
+        if (abandoned_node != 0 && escape_child(abandoned_node, block[0]) != 0) {
+            const auto late = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - abandoned_at);
+            sequence_gap = std::max(sequence_gap, static_cast<long>(late.count()));
+        }
+        abandoned_node = 0;
+        input.append(block, static_cast<std::size_t>(received));
+        return true;
+    }
+
+    //! Removes the next keystroke from the input, waiting for the terminal if necessary.
+    /*!
+     * The longest sequence in the trie that starts the input is taken as one key. If the input
+     * ends part way through a sequence, the rest is given a short time to arrive.
+     *
+     * \param is_key [out] true if a special key was decoded; otherwise a byte is returned.
+     */
+    static int decode_input(bool &is_key)
+    {
+        while (input.empty())
+            read_input(-1);
+        if (!escapes_built)
+            build_escapes();
+
+        std::size_t node = 0;
+        std::size_t length = 0;
+        std::size_t matched = 0;
+        int key = 0;
+        for (;;) {
+            if (length == input.size()) {
+                if (escape_trie[node].next.empty())
+                    break;
+                const auto started = std::chrono::steady_clock::now();
+                if (!read_input(escape_timeout())) {
+                    if (matched < length) {
+                        abandoned_node = node;
+                        abandoned_at = started;
+                    }
+                    break;
+                }
+                const auto gap = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - started);
+                sequence_gap = (sequence_gap * 7 + static_cast<long>(gap.count())) / 8;
+                continue;
+            }
+            node = escape_child(node, input[length]);
+            if (node == 0)
+                break;
+            ++length;
+            if (escape_trie[node].key != 0) {
+                key = escape_trie[node].key;
+                matched = length;
+            }
+        }
+
+        is_key = matched > 0;
+        if (!is_key)
+            key = static_cast<unsigned char>(input[0]);
+        input.erase(0, is_key ? matched : 1);
+        return key;
+    }
+
+    //! Reads the rest of a paste into paste_buffer after its start marker has been decoded.
+    /*!
+     * A paste arrives as ESC [ 2 0 0 ~, the text, and ESC [ 2 0 1 ~. Anything read after the
+     * end marker is left in the input to be decoded as usual.
+     */
+    static void read_paste()
+    {
+        static const std::string end_marker("\033[201~");
+
+        std::size_t end = input.find(end_marker);
+        while (end == std::string::npos) {
+            const std::size_t old_size = input.size();
+            if (!read_input(paste_timeout))
+                break;
+            const std::size_t overlap = end_marker.size() - 1;
+            end = input.find(end_marker, old_size < overlap ? 0 : old_size - overlap);
+        }
+        if (end == std::string::npos) {
+            paste_buffer.swap(input);
+            input.clear();
+            return;
+        }
+        paste_buffer.assign(input, 0, end);
+        input.erase(0, end + end_marker.size());
+    }
+
+    //! Returns the next character (or special key) after one that starts a two key code.
+    static int next_character()
+    {
+        bool is_key;
+        return decode_input(is_key);
+    }
+
+#else
+    static int next_character()
+    {
+        return getch();
+    }
 #endif
 
     // Remap the control keys to the special movement keys.
@@ -246,11 +544,17 @@ namespace scr {
     {
         if (key_refresh)
             refresh();
-        return key_wait();
+        ++key_count;
+        const int result = key_wait();
+        if (key_recorder != nullptr)
+            key_recorder(result);
+        return result;
     }
 
     int key_wait()
     {
+        if (scripted_keys != nullptr)
+            return scripted_keys();
         int ch;
 
 #if eOPSYS != ePOSIX
@@ -266,18 +570,20 @@ namespace scr {
         }
 #endif
 
-        ch = getch();
-
 #if eOPSYS == ePOSIX
-        // If this is a special character that curses is handing back, process it.
-        if (ch >= KEY_MIN) {
-            KeyMap::iterator p = curses_key_map.find(ch);
-            if (p != curses_key_map.end()) {
-                return (*p).second;
-            }
+        // Special keys are decoded here rather than by curses (see decode_input).
+        bool is_key;
+        ch = decode_input(is_key);
+        if (is_key) {
+            if (ch != paste_start)
+                return ch;
+            read_paste();
+            return K_PASTE;
         }
 
 #else
+        ch = next_character();
+
         // If the character is the escape character, deal with special keys. This is for
         // non-curses systems (like DOS) under the SCR_ASCIIKEYS option.
         //
@@ -322,7 +628,7 @@ namespace scr {
 
         // If it's CTRLF, figure out which function key code to return.
         if (ch == K_CTRLF) {
-            ch = getch();
+            ch = next_character();
             if (std::isdigit(ch))
                 return function_translation[ch - '0'];
             return '*';
@@ -330,7 +636,7 @@ namespace scr {
 
         // If it's CTRLS, figure out which shifted function key code to return.
         if (ch == K_CTRLS) {
-            ch = getch();
+            ch = next_character();
             if (std::isdigit(ch))
                 return shift_function_translation[ch - '0'];
             return '*';
@@ -338,7 +644,7 @@ namespace scr {
 
         // If it's CTRLC, figure out which control function key code to return.
         if (ch == K_CTRLC) {
-            ch = getch();
+            ch = next_character();
             if (std::isdigit(ch))
                 return control_function_translation[ch - '0'];
             return '*';
@@ -346,7 +652,7 @@ namespace scr {
 
         // If it's CTRLA, handle ALT+letter and ALT+function key codes.
         if (ch == K_CTRLA) {
-            ch = getch();
+            ch = next_character();
             if (std::isdigit(ch))
                 return alt_function_translation[ch - '0'];
             if (std::isalpha(ch))
@@ -373,7 +679,11 @@ namespace scr {
     {
         if (key_refresh)
             refresh();
-        return key_wait();
+        ++key_count;
+        const int result = key_wait();
+        if (key_recorder != nullptr)
+            key_recorder(result);
+        return result;
     }
 
     // See comments in key_wait below. This table is necessary because the values associated
@@ -388,6 +698,8 @@ namespace scr {
 
     int key_wait()
     {
+        if (scripted_keys != nullptr)
+            return scripted_keys();
         int ch;
 
 #if eOPSYS == eWINDOWS
@@ -414,4 +726,32 @@ namespace scr {
 
 #endif
 
+    bool key_available(int milliseconds)
+    {
+        if (scripted_keys != nullptr)
+            return true;
+
+#if eOPSYS == ePOSIX
+        if (!input.empty())
+            return true;
+
+
+        // Input already read but not yet decoded holds at least one keystroke. Otherwise wait
+        // for input to arrive without reading it.
+        struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+        return poll(&input, 1, milliseconds) > 0;
+
+#elif eOPSYS == eWINDOWS
+        // The console offers no way to wait for a keystroke with a timeout, so poll.
+        for (;;) {
+            if (_kbhit())
+                return true;
+            if (milliseconds <= 0)
+                return false;
+            Sleep(10);
+            milliseconds -= 10;
+        }
+#endif
+    }
+
 } // namespace scr
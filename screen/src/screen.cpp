@@ -10,18 +10,24 @@
 #error Scr only supports Windows and POSIX systems.
 #endif
 
+#include <algorithm>
 #include <cctype>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #if eOPSYS == eWINDOWS
 #include <windows.h>
 #endif
 
 #if eOPSYS == ePOSIX
-#include <map>
+#include <csignal>
+#include <utility>
+
+#include <sys/ioctl.h>
+#include <unistd.h>
 
 // Defining NCURSES_NOMACROS disables the function-like macros in curses.h.
 #define NCURSES_NOMACROS
@@ -33,6 +39,11 @@
 #undef max_colors
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SCREEN_SSE2
+#endif
+
 #include "screen/screen.hpp"
 
 namespace scr {
@@ -45,24 +56,18 @@ namespace scr {
     namespace {
         int total_rows = 25;    // Total number of rows on the IBM PC screen.
         int total_columns = 80; // Total number of columns on the IBM PC screen.
-        constexpr int maximum_print_size = 1024; // Largest string `print` can handle.
     } // namespace
 #endif
 
 #if eOPSYS == ePOSIX
     namespace {
-        int total_rows = 24;                     // Total number of rows on the screen.
-        int total_columns = 80;                  // Total number of columns on the screen.
-        constexpr int maximum_print_size = 1024; // Largest string `print` can handle.
+        int total_rows = 24;    // Total number of rows on the screen.
+        int total_columns = 80; // Total number of columns on the screen.
 
-        char *physical_image;
-        int physical_row = 1;    // Actual position of the cursor.
-        int physical_column = 1; //   etc...
+        chtype *row_buffer; // Curses characters of the run being written.
 
-        typedef std::pair<const unsigned char, chtype> CharacterPair;
-        typedef std::map<unsigned char, chtype, std::less<>> CharacterMap;
-        typedef std::pair<const int, int> ColorPair;
-        typedef std::map<int, int, std::less<>> ColorMap;
+        typedef std::pair<unsigned char, chtype> CharacterPair;
+        typedef std::pair<int, short> ColorPair;
 
         // Stores information about a curses "color pair."
         struct CursesColorInfo {
@@ -70,9 +75,35 @@ namespace scr {
             short background;
         };
 
-        CharacterMap box_character_map; // Maps scr box drawing characters to curses.
-        ColorMap colors_map;            // Maps Scr colors to Curses colors.
-        bool color_works;               // =true if the terminal supports color.
+        // Lookup tables indexed by the bytes of the screen image. A cell is displayed as the
+        // bitwise OR of the entries for its character and its attribute.
+        chtype character_table[256]; // Maps Scr characters (including box drawing) to curses.
+        chtype attribute_table[256]; // Maps Scr attributes to curses attributes and colors.
+        bool color_works;            // =true if the terminal supports color.
+
+        // A scroll of whole rows that the terminal is to do at the next refresh.
+        struct PendingScroll {
+            int top;    // First and last rows of the scrolled region (zero based).
+            int bottom;
+            int count;  // Number of rows the region moves up (down if negative).
+        };
+        std::vector<PendingScroll> pending_scrolls;
+
+        // Counts the changes in size the terminal reported (with SIGWINCH).
+        volatile std::sig_atomic_t size_report_count = 0;
+        struct sigaction previous_size_action; // Restored by `terminate`.
+
+        void note_size_report(int)
+        {
+            size_report_count = size_report_count + 1;
+        }
+
+        // Asks the terminal to mark pasted text (see key_wait). Others ignore the request.
+        void bracketed_paste(const bool enabled)
+        {
+            putp(enabled ? "\033[?2004h" : "\033[?2004l");
+            std::fflush(stdout);
+        }
     } // namespace
 #endif
 
@@ -97,16 +128,125 @@ namespace scr {
         int initialize_counter = 0;      // Counts the number of pending Initialize() calls.
         int max_columns = total_columns; // Usable size of the screen.
         int max_rows = total_rows;       //   etc...
-        char *screen_image;
-        int virtual_column = 1;                   // Virtual cursor coordinates.
-        int virtual_row = 1;                      //   etc...
-        char work_buffer[maximum_print_size + 1]; // Used by `print`
+        Cell *screen_image;
+        Cell *physical_image;       // What the display is currently showing.
+        int image_capacity = 0;     // Number of cells allocated for each image.
+        bool direct_output = false; // =true if VT sequences are written (see terminal.cpp).
+        bool headless = false;      // =true if nothing is shown (see `use_headless`).
+        unsigned long long cells_written = 0; // Cells sent to the display by refresh.
+        const Cell unknown_cell = ~Cell(0); // No cell of the screen image is equal to this.
+        int virtual_column = 1;       // Virtual cursor coordinates.
+        int virtual_row = 1;          //   etc...
+        std::vector<char> work_buffer; // Used by `print`. Grows to fit what is printed.
+
+        // Returns a pointer to the cell at the given position in the screen image.
+        Cell *cell_address(const int row, const int column)
+        {
+            return screen_image + (row - 1) * total_columns + (column - 1);
+        }
+
+        // Returns the cell for a character and attribute given as bytes.
+        inline Cell cell_from(const char letter, const int attribute)
+        {
+            return make_cell(static_cast<unsigned char>(letter), attribute);
+        }
+
+        // Formats text for `print`, returning at most count characters of it (not terminated).
+        // A plain string given with "%s" is used as it is.
+        const char *format_text(
+            std::size_t count, std::size_t &length, const char *format, std::va_list args)
+        {
+            if (format[0] == '%' && format[1] == 's' && format[2] == '\0') {
+                const char *const text = va_arg(args, const char *);
+                length = 0;
+                while (length < count && text[length] != '\0')
+                    ++length;
+                return text;
+            }
+
+            std::va_list retry;
+            va_copy(retry, args);
+            if (work_buffer.empty())
+                work_buffer.resize(256);
+            int needed = std::vsnprintf(work_buffer.data(), work_buffer.size(), format, args);
+            if (needed >= 0 && static_cast<std::size_t>(needed) >= work_buffer.size()) {
+                work_buffer.resize(static_cast<std::size_t>(needed) + 1);
+                needed = std::vsnprintf(work_buffer.data(), work_buffer.size(), format, retry);
+            }
+            va_end(retry);
+            length = std::min(static_cast<std::size_t>(std::max(needed, 0)), count);
+            return work_buffer.data();
+        }
+
+        // Returns the byte representing the character of a cell.
+        inline char cell_letter(const Cell cell)
+        {
+            const std::uint32_t code_point = cell_code_point(cell);
+            return (code_point < 256) ? static_cast<char>(code_point) : '?';
+        }
+
+        // Returns a cell with its attribute replaced.
+        inline Cell recolor(const Cell cell, const int attribute)
+        {
+            return make_cell(cell_code_point(cell), attribute);
+        }
+
+        // Returns the number of cells from the start of two rows of count cells that are equal.
+        std::size_t matching_prefix(const Cell *const left, const Cell *const right,
+                                    const std::size_t count)
+        {
+            std::size_t i = 0;
+#ifdef SCREEN_SSE2
+            for (; i + 4 <= count; i += 4) {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(left + i));
+                const __m128i b =
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(right + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, b)) != 0xFFFF)
+                    break;
+            }
+#endif
+            while (i < count && left[i] == right[i])
+                ++i;
+            return i;
+        }
     } // namespace
 
+    // Writes the screen image with escape sequences instead of curses or the console API.
+    namespace terminal {
+        bool start(int width);
+        bool start_detached(int width);
+        void resize(int width);
+        void forget();
+        void move_to(int row, int column);
+        void put(Cell cell);
+        void clear();
+        void reset();
+        void scroll(int top, int bottom, int count);
+        void flush();
+        unsigned long long bytes_written();
+        void stop();
+    } // namespace terminal
+
 #if eOPSYS == eWINDOWS
     namespace {
-        CHAR_INFO *console_image; // Win32 requires this as well.
-    }
+        CHAR_INFO *console_image;         // What the console shows, in the console's format.
+        WCHAR console_characters[256];    // Maps the bytes of Scr characters to Unicode.
+        SMALL_RECT pending = {0, 0, -1, -1}; // Part of console_image not yet written.
+
+        // The console is asked for its size since it has no way to report changes to it.
+        unsigned long size_report_count = 0;
+        int reported_rows = 0;
+        int reported_columns = 0;
+
+        void console_size(int &height, int &width)
+        {
+            CONSOLE_SCREEN_BUFFER_INFO scrninfo;
+            if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &scrninfo)) {
+                height = scrninfo.srWindow.Bottom - scrninfo.srWindow.Top + 1;
+                width = scrninfo.srWindow.Right - scrninfo.srWindow.Left + 1;
+            }
+        }
+    } // namespace
 #endif
 
     //=====================================
@@ -118,30 +258,47 @@ namespace scr {
     namespace {
         void initialize_character_map()
         {
-            // Here we insert associations that map Scr's double line and single line box
-            // drawing characters to Curses's corresponding special characters. At the moment,
-            // we do not distinguish between double and single line boxes; both will look the
-            // same.
+            // Here we list associations that map Scr's double line and single line box drawing
+            // characters to Curses's corresponding special characters. At the moment, we do
+            // not distinguish between double and single line boxes; both will look the same.
             //
-            box_character_map.insert(
-                {// Double line.
-                 CharacterPair(205, ACS_HLINE), CharacterPair(186, ACS_VLINE),
-                 CharacterPair(201, ACS_ULCORNER), CharacterPair(187, ACS_URCORNER),
-                 CharacterPair(200, ACS_LLCORNER), CharacterPair(188, ACS_LRCORNER),
-                 CharacterPair(181, ACS_RTEE), CharacterPair(198, ACS_LTEE),
-                 CharacterPair(208, ACS_BTEE), CharacterPair(210, ACS_TTEE),
-                 CharacterPair(206, ACS_PLUS),
-
-                 // Single line.
-                 CharacterPair(196, ACS_HLINE), CharacterPair(179, ACS_VLINE),
-                 CharacterPair(218, ACS_ULCORNER), CharacterPair(191, ACS_URCORNER),
-                 CharacterPair(192, ACS_LLCORNER), CharacterPair(217, ACS_LRCORNER),
-                 CharacterPair(180, ACS_RTEE), CharacterPair(195, ACS_LTEE),
-                 CharacterPair(193, ACS_BTEE), CharacterPair(194, ACS_TTEE),
-                 CharacterPair(197, ACS_PLUS),
-
-                 // Additional.
-                 CharacterPair(177, ACS_CKBOARD), CharacterPair(219, ACS_CKBOARD)});
+            static const CharacterPair character_associations[] = {
+                // Double line.
+                CharacterPair(205, ACS_HLINE), CharacterPair(186, ACS_VLINE),
+                CharacterPair(201, ACS_ULCORNER), CharacterPair(187, ACS_URCORNER),
+                CharacterPair(200, ACS_LLCORNER), CharacterPair(188, ACS_LRCORNER),
+                CharacterPair(181, ACS_RTEE), CharacterPair(198, ACS_LTEE),
+                CharacterPair(208, ACS_BTEE), CharacterPair(210, ACS_TTEE),
+                CharacterPair(206, ACS_PLUS),
+
+                // Single line.
+                CharacterPair(196, ACS_HLINE), CharacterPair(179, ACS_VLINE),
+                CharacterPair(218, ACS_ULCORNER), CharacterPair(191, ACS_URCORNER),
+                CharacterPair(192, ACS_LLCORNER), CharacterPair(217, ACS_LRCORNER),
+                CharacterPair(180, ACS_RTEE), CharacterPair(195, ACS_LTEE),
+                CharacterPair(193, ACS_BTEE), CharacterPair(194, ACS_TTEE),
+                CharacterPair(197, ACS_PLUS),
+
+                // Additional.
+                CharacterPair(177, ACS_CKBOARD), CharacterPair(219, ACS_CKBOARD)};
+
+            // Characters are written without interpretation by curses. Control characters
+            // would move the terminal cursor so they are shown as '?' instead.
+            for (int i = 0; i < 256; ++i) {
+                character_table[i] = (i < ' ' || i == 127) ? '?' : static_cast<chtype>(i);
+            }
+            for (const CharacterPair &association : character_associations) {
+                character_table[association.first] = association.second;
+            }
+        }
+
+        chtype color_pair_for(int just_color, const ColorPair *first, const ColorPair *last)
+        {
+            for (; first != last; ++first) {
+                if (first->first == just_color)
+                    return COLOR_PAIR(first->second);
+            }
+            return 0;
         }
 
         void initialize_colors()
@@ -230,6 +387,15 @@ namespace scr {
                 {COLOR_RED, COLOR_WHITE},      {COLOR_MAGENTA, COLOR_WHITE},
                 {COLOR_YELLOW, COLOR_WHITE},   {COLOR_BLACK, COLOR_WHITE}};
 
+            // Video attributes apply whether or not colors work.
+            for (int i = 0; i < 256; ++i) {
+                attribute_table[i] = 0;
+                if (i & BLINK)
+                    attribute_table[i] |= A_BLINK;
+                if (i & BRIGHT)
+                    attribute_table[i] |= A_BOLD;
+            }
+
             // Are colors supported?
             color_works = true;
             if (start_color() == ERR) {
@@ -250,21 +416,258 @@ namespace scr {
                           color_initializers[i].background);
             }
 
-            // Map the Scr colors to the corresponding Curses color index.
-            colors_map.insert(color_associations,
-                              color_associations +
-                                  sizeof(color_associations) / sizeof(ColorPair));
+            // Combine the Curses color index for each Scr color into the attribute table.
+            const ColorPair *const associations_end =
+                color_associations + sizeof(color_associations) / sizeof(ColorPair);
+            for (int i = 0; i < 256; ++i) {
+                attribute_table[i] |=
+                    color_pair_for(i & ~(BLINK | BRIGHT), color_associations, associations_end);
+            }
+        }
+
+        //! Returns the curses character that displays a cell of the screen image.
+        inline chtype curses_character(const Cell cell)
+        {
+            return character_table[static_cast<unsigned char>(cell_letter(cell))] |
+                   attribute_table[cell_attribute(cell)];
+        }
+
+        //! Writes columns [first, last) of a row (both zero based) from the screen image.
+        /*!
+         * The characters are handed to curses as a single string (or written directly to the
+         * terminal) and the physical image is brought up to date.
+         */
+        void write_run(int row, int first, int last)
+        {
+            const int row_base = row * total_columns;
+            if (direct_output) {
+                terminal::move_to(row, first);
+                for (int column = first; column < last; ++column) {
+                    terminal::put(screen_image[row_base + column]);
+                    physical_image[row_base + column] = screen_image[row_base + column];
+                }
+                return;
+            }
+            for (int column = first; column < last; ++column) {
+                const int array_index = row_base + column;
+                row_buffer[column - first] = curses_character(screen_image[array_index]);
+                physical_image[array_index] = screen_image[array_index];
+            }
+            row_buffer[last - first] = 0;
+            mvwaddchnstr(stdscr, row, first, row_buffer, last - first);
+        }
+
+        //! Scrolls the terminal as `scroll` scrolled the screen image since the last refresh.
+        /*!
+         * The physical image is scrolled to match. Its rows that were exposed are marked as
+         * unknown, since terminals differ about how they fill them, so refresh writes them
+         * whatever the screen image holds.
+         */
+        void apply_scrolls()
+        {
+            for (const PendingScroll &pending : pending_scrolls) {
+                if (pending.bottom >= total_rows)
+                    continue;
+                if (direct_output)
+                    terminal::scroll(pending.top, pending.bottom, pending.count);
+                else {
+                    scrollok(stdscr, TRUE);
+                    wsetscrreg(stdscr, pending.top, pending.bottom);
+                    wscrl(stdscr, pending.count);
+                    wsetscrreg(stdscr, 0, total_rows - 1);
+                    scrollok(stdscr, FALSE);
+                }
+
+                Cell *const region = physical_image + pending.top * total_columns;
+                const int region_size = (pending.bottom - pending.top + 1) * total_columns;
+                const int exposed = std::abs(pending.count) * total_columns;
+                if (pending.count > 0) {
+                    std::copy(region + exposed, region + region_size, region);
+                    std::fill_n(region + region_size - exposed, exposed, unknown_cell);
+                }
+                else {
+                    std::copy_backward(region, region + region_size - exposed,
+                                       region + region_size);
+                    std::fill_n(region, exposed, unknown_cell);
+                }
+            }
+            pending_scrolls.clear();
+        }
+
+        //! Moves the cursor to the virtual cursor position and sends all output.
+        void update_cursor()
+        {
+            if (direct_output) {
+                terminal::move_to(virtual_row - 1, virtual_column - 1);
+                terminal::flush();
+                return;
+            }
+            move(virtual_row - 1, virtual_column - 1);
+
+            // Tell curses to do the update on the "real" physical screen.
+            ::refresh();
         }
 
     } // namespace
 #endif
 
+#if eOPSYS == eWINDOWS
+    namespace {
+
+        //! Maps the bytes of Scr characters to Unicode as the console's code page does.
+        void initialize_console_characters()
+        {
+            const UINT code_page = GetConsoleOutputCP();
+            for (int i = 0; i < 256; ++i) {
+                const char byte = static_cast<char>(i);
+                if (MultiByteToWideChar(code_page, 0, &byte, 1, &console_characters[i], 1) != 1)
+                    console_characters[i] = L'?';
+            }
+        }
+
+        // Returns a cell in the console's format.
+        CHAR_INFO console_cell(const Cell cell)
+        {
+            const std::uint32_t code_point = cell_code_point(cell);
+            CHAR_INFO result;
+            if (code_point < 256)
+                result.Char.UnicodeChar = console_characters[code_point];
+            else if (code_point < 0x10000)
+                result.Char.UnicodeChar = static_cast<WCHAR>(code_point);
+            else
+                result.Char.UnicodeChar = L'?';
+            result.Attributes = static_cast<WORD>(cell_attribute(cell));
+            return result;
+        }
+
+        //! Writes the part of console_image that changed to the console in a single call.
+        void write_pending()
+        {
+            if (pending.Right < pending.Left)
+                return;
+
+            // This assumes total_columns and total_rows are both < 32k.
+            const COORD size = {static_cast<SHORT>(total_columns),
+                                static_cast<SHORT>(total_rows)};
+            const COORD corner = {pending.Left, pending.Top};
+            WriteConsoleOutputW(GetStdHandle(STD_OUTPUT_HANDLE), console_image, size, corner,
+                                &pending);
+            pending = {0, 0, -1, -1};
+        }
+
+        //! Writes columns [first, last) of a row (both zero based) from the screen image.
+        /*!
+         * The cells are written directly to the terminal or gathered in console_image. Runs on
+         * rows next to each other are written to the console as one rectangle when refresh is
+         * done. It also covers the cells between them, which console_image has unchanged.
+         */
+        void write_run(int row, int first, int last)
+        {
+            const int row_base = row * total_columns;
+            if (direct_output) {
+                terminal::move_to(row, first);
+                for (int column = first; column < last; ++column) {
+                    terminal::put(screen_image[row_base + column]);
+                    physical_image[row_base + column] = screen_image[row_base + column];
+                }
+                return;
+            }
+            for (int column = first; column < last; ++column) {
+                const int array_index = row_base + column;
+                console_image[array_index] = console_cell(screen_image[array_index]);
+                physical_image[array_index] = screen_image[array_index];
+            }
+
+            if (pending.Right >= pending.Left && row > pending.Bottom + 1)
+                write_pending();
+            if (pending.Right < pending.Left) {
+                pending.Top = static_cast<SHORT>(row);
+                pending.Left = static_cast<SHORT>(first);
+                pending.Right = static_cast<SHORT>(last - 1);
+            }
+            else {
+                pending.Left = std::min(pending.Left, static_cast<SHORT>(first));
+                pending.Right = std::max(pending.Right, static_cast<SHORT>(last - 1));
+            }
+            pending.Bottom = static_cast<SHORT>(row);
+        }
+
+        //! Moves the cursor to the virtual cursor position and sends all output.
+        void update_cursor()
+        {
+            if (direct_output) {
+                terminal::move_to(virtual_row - 1, virtual_column - 1);
+                terminal::flush();
+                return;
+            }
+            write_pending();
+
+            // This assumes virtual_column and virtual_row both < 32k.
+            COORD where;
+            where.X = static_cast<SHORT>(virtual_column - 1);
+            where.Y = static_cast<SHORT>(virtual_row - 1);
+            SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), where);
+        }
+
+    } // namespace
+#endif
+
+    namespace {
+
+        //! Writes the cells of the screen image that differ from the physical image.
+        void write_changes()
+        {
+            // Unchanged stretches shorter than this are rewritten rather than skipped. Bridging
+            // small gaps joins nearby runs and saves a cursor movement for each.
+            const int minimum_gap = 4;
+
+            for (int row = 0; row < total_rows; ++row) {
+                const Cell *const screen_row = screen_image + row * total_columns;
+                const Cell *const physical_row = physical_image + row * total_columns;
+
+                // Locate the runs of changed cells and write each one. Rows that are already
+                // correct, the common case, are passed over by the first comparison.
+                int column = 0;
+                while (column < total_columns) {
+
+                    // Find the start of the next changed run.
+                    column += static_cast<int>(matching_prefix(
+                        screen_row + column, physical_row + column, total_columns - column));
+                    if (column == total_columns)
+                        break;
+
+                    // Extend the run until a gap of at least minimum_gap unchanged cells.
+                    const int first = column;
+                    int last = column + 1;
+                    int gap = 0;
+                    for (column = last; column < total_columns && gap < minimum_gap; ++column) {
+                        if (screen_row[column] == physical_row[column]) {
+                            ++gap;
+                        }
+                        else {
+                            gap = 0;
+                            last = column + 1;
+                        }
+                    }
+                    write_run(row, first, last);
+                    cells_written += static_cast<unsigned>(last - first);
+                    column = last;
+                }
+            }
+        }
+
+    } // namespace
+
     //======================================
     //           Public Functions
     //======================================
 
     extern void initialize_key();
+#if eOPSYS == ePOSIX
+    extern void initialize_escapes();
+#endif
     extern void terminate_key();
+    extern void script_keys(int (*keys)());
 
     //+++++
     // System dependent functions
@@ -300,39 +703,76 @@ namespace scr {
 
         initialize_key();
 
+        // A headless screen takes the size it was given and its output goes nowhere. It
+        // shows the colors a color terminal would.
+        if (headless) {
+            max_rows = total_rows;
+            max_columns = total_columns;
+            direct_output = terminal::start_detached(total_columns);
+#if eOPSYS == ePOSIX
+            color_works = true;
+#endif
+        }
+        else {
 #if eOPSYS == eWINDOWS
-        CONSOLE_SCREEN_BUFFER_INFO scrninfo;
-
-        GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &scrninfo);
-        max_rows = total_rows = scrninfo.srWindow.Bottom - scrninfo.srWindow.Top + 1;
-        max_columns = total_columns = scrninfo.srWindow.Right - scrninfo.srWindow.Left + 1;
+            CONSOLE_SCREEN_BUFFER_INFO scrninfo;
+
+            GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &scrninfo);
+            max_rows = total_rows = scrninfo.srWindow.Bottom - scrninfo.srWindow.Top + 1;
+            max_columns = total_columns = scrninfo.srWindow.Right - scrninfo.srWindow.Left + 1;
+            reported_rows = total_rows;
+            reported_columns = total_columns;
+            initialize_console_characters();
+            direct_output = terminal::start(total_columns);
 #endif
 
 #if eOPSYS == ePOSIX
-        // Initialize the Curses package.
-        initscr();
-        raw();
-        noecho();
-        nonl();
-        intrflush(stdscr, FALSE);
-        keypad(stdscr, TRUE);
-        initialize_character_map();
-        initialize_colors();
-
-        // How much screen space do we have?
-        max_rows = total_rows = LINES;
-        max_columns = total_columns = COLS;
+            // Initialize the Curses package.
+            initscr();
+            raw();
+            noecho();
+            nonl();
+            intrflush(stdscr, FALSE);
+            keypad(stdscr, TRUE);
+            initialize_escapes();
+            bracketed_paste(true);
+            initialize_character_map();
+            initialize_colors();
+
+            // How much screen space do we have?
+            max_rows = total_rows = LINES;
+            max_columns = total_columns = COLS;
+
+            // Curses sets up the terminal when it first refreshes the screen. Since nothing is
+            // drawn in curses's own window after that, curses never writes to the terminal
+            // again.
+            direct_output = terminal::start(total_columns);
+            if (direct_output)
+                ::refresh();
+            else
+                idlok(stdscr, TRUE); // Let curses scroll the terminal (see `apply_scrolls`).
+
+            // Changes in size are only counted here; see `update_size`. Interrupted reads of
+            // the keyboard carry on.
+            struct sigaction size_action = {};
+            size_action.sa_handler = note_size_report;
+            sigemptyset(&size_action.sa_mask);
+            size_action.sa_flags = SA_RESTART;
+            sigaction(SIGWINCH, &size_action, &previous_size_action);
 #endif
+        }
 
         // Allocate screen images.
-        screen_image = new char[total_rows * 2 * total_columns];
+        image_capacity = total_rows * total_columns;
+        screen_image = new Cell[image_capacity];
+        physical_image = new Cell[image_capacity];
 
 #if eOPSYS == ePOSIX
-        physical_image = new char[total_rows * 2 * total_columns];
+        row_buffer = new chtype[total_columns + 1];
 #endif
 
 #if eOPSYS == eWINDOWS
-        console_image = new CHAR_INFO[total_rows * total_columns];
+        console_image = new CHAR_INFO[image_capacity];
 #endif
 
         // In any case, clear the screen and home the cursor.
@@ -363,39 +803,50 @@ namespace scr {
         if (initialize_counter != 0)
             return; // initialize( ) called more than once.
 
+        if (!headless) {
 #if eOPSYS == eWINDOWS
-        // Clear the screen and home the cursor.
-        for (int counter = 0; counter < total_rows * 2 * total_columns; counter += 2) {
-            screen_image[counter] = ' ';
-            screen_image[counter + 1] = WHITE | REV_BLACK;
-        }
-        virtual_row = 1;
-        virtual_column = 1;
-        redraw();
+            // Clear the screen and home the cursor.
+            std::fill_n(screen_image, total_rows * total_columns,
+                        make_cell(' ', WHITE | REV_BLACK));
+            virtual_row = 1;
+            virtual_column = 1;
+            redraw();
+            if (direct_output) {
+                terminal::reset();
+                terminal::flush();
+                terminal::stop();
+            }
 #endif
 
 #if eOPSYS == ePOSIX
-        // Clear the screen and home the cursor.
-        for (int counter = 0; counter < total_rows * 2 * total_columns; counter += 2) {
-            screen_image[counter] = ' ';
-            screen_image[counter + 1] = WHITE | REV_BLACK;
-        }
-        virtual_row = 1;
-        virtual_column = 1;
-        redraw();
-
-        // Clean up the curses routines.
-        endwin();
+            // Clear the screen and home the cursor.
+            std::fill_n(screen_image, total_rows * total_columns,
+                        make_cell(' ', WHITE | REV_BLACK));
+            virtual_row = 1;
+            virtual_column = 1;
+            redraw();
+            if (direct_output) {
+                terminal::reset();
+                terminal::flush();
+                terminal::stop();
+            }
 
-        box_character_map.erase(box_character_map.begin(), box_character_map.end());
+            // Clean up the curses routines.
+            sigaction(SIGWINCH, &previous_size_action, nullptr);
+            bracketed_paste(false);
+            endwin();
 #endif
+        }
+
         // Free dynamic data structures.
         delete[] screen_image;
         screen_image = nullptr;
-
-#if eOPSYS == ePOSIX
         delete[] physical_image;
         physical_image = nullptr;
+
+#if eOPSYS == ePOSIX
+        delete[] row_buffer;
+        row_buffer = nullptr;
 #endif
 
 #if eOPSYS == eWINDOWS
@@ -406,6 +857,154 @@ namespace scr {
         terminate_key();
     }
 
+    //! Makes `initialize` set up a screen that is not shown anywhere.
+    /*!
+     * Programs that are run without a terminal, such as benchmarks and tests, use a headless
+     * screen. Everything works as usual except that nothing is read from the terminal or
+     * written to it. The screen image is turned into escape sequences as it would be for a VT
+     * terminal (see terminal.cpp) and then discarded, so `output_counts` reports the bytes a
+     * terminal would have been sent. The screen keeps the given size.
+     *
+     * This function must be called before `initialize`.
+     *
+     * \param height The number of rows on the screen.
+     * \param width The number of columns on the screen.
+     * \param keys Called by `key` and `key_wait` for each keystroke. Keystrokes are always
+     * available (see `key_available`).
+     */
+    void use_headless(const int height, const int width, int (*const keys)())
+    {
+        headless = true;
+        total_rows = height;
+        total_columns = width;
+        script_keys(keys);
+    }
+
+    //! Reports how much refresh has sent to the display.
+    /*!
+     * \param cells Receives the number of cells written, however they were written.
+     * \param bytes Receives the number of bytes written as escape sequences and text when the
+     * screen writes to the terminal directly (see terminal.cpp). It is zero when curses or the
+     * console API does the writing, since they don't say.
+     */
+    void output_counts(unsigned long long &cells, unsigned long long &bytes)
+    {
+        cells = cells_written;
+        bytes = terminal::bytes_written();
+    }
+
+    //! Returns the number of changes in size the terminal has reported.
+    /*!
+     * A program can tell from this count that the terminal has been resized since it last
+     * looked, without changing the size of the screen. While a terminal's window is dragged
+     * larger or smaller many changes are reported in quick succession; the program can wait
+     * until the count stops changing and then call `update_size` once.
+     *
+     * On POSIX systems the count is kept by a handler for SIGWINCH, which also interrupts
+     * any wait for a keystroke with `poll`. The Windows console reports nothing, so there each
+     * call looks at its size.
+     */
+    unsigned long size_reports()
+    {
+#if eOPSYS == eWINDOWS
+        int height = reported_rows;
+        int width = reported_columns;
+        console_size(height, width);
+        if (height != reported_rows || width != reported_columns) {
+            reported_rows = height;
+            reported_columns = width;
+            ++size_report_count;
+        }
+#endif
+        return static_cast<unsigned long>(size_report_count);
+    }
+
+    //! Makes the screen the size of the terminal.
+    /*!
+     * If the size changed, the screen image is cleared and all of it is written at the next
+     * refresh, since terminals differ about what they show after they are resized. The
+     * storage of the screen image is kept if it is big enough and otherwise grows by half
+     * again, so that a terminal that is resized repeatedly causes few allocations. The program
+     * should rebuild the screen image before the next refresh.
+     *
+     * \return true if the size of the screen changed; false otherwise.
+     * \throws std::bad_alloc If there is insufficient memory for the larger screen image. The
+     * size of the screen is not changed in that case.
+     */
+    bool update_size()
+    {
+        if (headless)
+            return false;
+        int height = total_rows;
+        int width = total_columns;
+#if eOPSYS == ePOSIX
+        struct winsize size;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 &&
+            size.ws_col > 0) {
+            height = size.ws_row;
+            width = size.ws_col;
+        }
+#elif eOPSYS == eWINDOWS
+        console_size(height, width);
+#endif
+        if (height == total_rows && width == total_columns)
+            return false;
+
+        const int needed = height * width;
+        if (needed > image_capacity) {
+            const int capacity = std::max(needed, image_capacity + image_capacity / 2);
+            Cell *const new_screen = new Cell[capacity];
+            Cell *new_physical = nullptr;
+            try {
+                new_physical = new Cell[capacity];
+#if eOPSYS == eWINDOWS
+                CHAR_INFO *const new_console = new CHAR_INFO[capacity];
+                delete[] console_image;
+                console_image = new_console;
+#endif
+            }
+            catch (...) {
+                delete[] new_screen;
+                delete[] new_physical;
+                throw;
+            }
+            delete[] screen_image;
+            delete[] physical_image;
+            screen_image = new_screen;
+            physical_image = new_physical;
+            image_capacity = capacity;
+        }
+#if eOPSYS == ePOSIX
+        if (width > total_columns) {
+            chtype *const new_row_buffer = new chtype[width + 1];
+            delete[] row_buffer;
+            row_buffer = new_row_buffer;
+        }
+#endif
+
+        max_rows = total_rows = height;
+        max_columns = total_columns = width;
+#if eOPSYS == ePOSIX
+        // Curses reads the keyboard (and draws the screen if `direct_output` is false) so it
+        // has to know the size as well. Unlike resizeterm, resize_term doesn't queue a
+        // KEY_RESIZE keystroke.
+        pending_scrolls.clear();
+        resize_term(height, width);
+        if (!direct_output)
+            clearok(curscr, TRUE);
+#elif eOPSYS == eWINDOWS
+        pending = {0, 0, -1, -1};
+#endif
+        if (direct_output)
+            terminal::resize(width);
+
+        std::fill_n(screen_image, needed, make_cell(' ', WHITE | REV_BLACK));
+        std::fill_n(physical_image, needed, unknown_cell);
+        virtual_row = std::min(virtual_row, total_rows);
+        virtual_column = std::min(virtual_column, total_columns);
+        return true;
+    }
+
     //! Return the box drawing characters associated with a certain box type.
     /*!
      * Use this function to inspect the specific box drawing characters associated with a
@@ -568,22 +1167,16 @@ namespace scr {
      */
     void read(int row, int column, int width, int height, char *buffer)
     {
-        unsigned number_of_rows; // Loop index.
-        unsigned row_length;     // Number of bytes in row of a region.
-        char *screen_pointer;    // Pointer into the screen image.
-
         adjust_dimensions(row, column, width, height);
 
-        row_length = 2 * width;
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-
         // Loop over all rows in the region.
-        for (number_of_rows = height; number_of_rows > 0; number_of_rows--) {
-
-            // Copy data from screen image to buffer and adjust offsets.
-            std::memcpy(buffer, screen_pointer, row_length);
-            screen_pointer += 2 * total_columns;
-            buffer += row_length;
+        const Cell *screen_pointer = cell_address(row, column);
+        for (; height > 0; height--) {
+            for (int i = 0; i < width; i++) {
+                *buffer++ = cell_letter(screen_pointer[i]);
+                *buffer++ = static_cast<char>(cell_attribute(screen_pointer[i]));
+            }
+            screen_pointer += total_columns;
         }
     }
 
@@ -603,18 +1196,13 @@ namespace scr {
      */
     void read_text(int row, int column, int width, int height, char *buffer)
     {
-        char *screen_pointer;
-        char *source;
-        int i;
-
         adjust_dimensions(row, column, width, height);
 
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
+        const Cell *screen_pointer = cell_address(row, column);
         for (; height > 0; height--) {
-            source = screen_pointer;
-            for (i = 0; i < width; i++, source++)
-                *buffer++ = *source++;
-            screen_pointer += 2 * total_columns;
+            for (int i = 0; i < width; i++)
+                *buffer++ = cell_letter(screen_pointer[i]);
+            screen_pointer += total_columns;
         }
     }
 
@@ -636,21 +1224,17 @@ namespace scr {
      */
     void write(int row, int column, int width, int height, const char *buffer)
     {
-        unsigned number_of_rows; // Loop index.
-        unsigned row_length;     // Number of bytes in row of a region.
-        char *screen_pointer;    // Pointer into the screen image.
+        const int row_length = 2 * width; // Number of bytes in a row of the buffer.
 
         adjust_dimensions(row, column, width, height);
 
-        row_length = 2 * width;
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-
         // Loop over all rows in the region.
-        for (number_of_rows = height; number_of_rows > 0; number_of_rows--) {
-
-            // Copy data from buffer to screen image and adjust offsets.
-            std::memcpy(screen_pointer, buffer, row_length);
-            screen_pointer += 2 * total_columns;
+        Cell *screen_pointer = cell_address(row, column);
+        for (; height > 0; height--) {
+            for (int i = 0; i < width; i++)
+                screen_pointer[i] =
+                    cell_from(buffer[2 * i], static_cast<unsigned char>(buffer[2 * i + 1]));
+            screen_pointer += total_columns;
             buffer += row_length;
         }
     }
@@ -672,24 +1256,107 @@ namespace scr {
      */
     void write_text(int row, int column, int width, int height, const char *buffer)
     {
-        char *screen_pointer;
-        char *destination;
-        int i;
-
         adjust_dimensions(row, column, width, height);
 
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
+        Cell *screen_pointer = cell_address(row, column);
         for (; height > 0; height--) {
-            destination = screen_pointer;
-            for (i = 0; i < width; i++, destination++)
-                *destination++ = *buffer++;
-            screen_pointer += 2 * total_columns;
+            for (int i = 0; i < width; i++) {
+                screen_pointer[i] = cell_from(*buffer++, cell_attribute(screen_pointer[i]));
+            }
+            screen_pointer += total_columns;
+        }
+    }
+
+    //! Writes a run of characters with one attribute.
+    /*!
+     * The characters are copied straight into the screen image without formatting. Null
+     * characters have no special meaning. The run is cut off at the right edge of the screen.
+     *
+     * \param row The row number where the run will be written.
+     * \param column The column number where the run starts.
+     * \param text Pointer to the characters to write.
+     * \param length The number of characters to write. An empty run is ignored.
+     * \param attribute The color attribute to use for the run.
+     */
+    void write_span(int row, int column, const char *text, std::size_t length, int attribute)
+    {
+        if (length == 0)
+            return;
+        int width = static_cast<int>(std::min<std::size_t>(length, total_columns));
+        int dummy_height = 1;
+        adjust_dimensions(row, column, width, dummy_height);
+        attribute = convert_attribute(attribute);
+
+        Cell *const screen_pointer = cell_address(row, column);
+        for (int i = 0; i < width; ++i)
+            screen_pointer[i] = cell_from(text[i], attribute);
+    }
+
+    //! Writes a run of characters with attributes that change along it.
+    /*!
+     * This function is similar to the other `write_span` except that the attributes are given
+     * as a sequence of runs. Characters past the end of the last run keep the last run's
+     * attribute.
+     *
+     * \param row The row number where the run will be written.
+     * \param column The column number where the run starts.
+     * \param text Pointer to the characters to write.
+     * \param length The number of characters to write. An empty run is ignored.
+     * \param runs Pointer to the attribute runs, in order from the start of the text.
+     * \param run_count The number of attribute runs. There must be at least one.
+     */
+    void write_span(int row, int column, const char *text, std::size_t length,
+                    const AttributeRun *runs, std::size_t run_count)
+    {
+        if (length == 0 || run_count == 0)
+            return;
+        int width = static_cast<int>(std::min<std::size_t>(length, total_columns));
+        int dummy_height = 1;
+        adjust_dimensions(row, column, width, dummy_height);
+
+        Cell *const screen_pointer = cell_address(row, column);
+        const AttributeRun *const last = runs + (run_count - 1);
+        std::size_t remaining = runs->length;
+        int attribute = convert_attribute(runs->attribute);
+        for (int i = 0; i < width; ++i) {
+            while (remaining == 0 && runs != last) {
+                ++runs;
+                remaining = runs->length;
+                attribute = convert_attribute(runs->attribute);
+            }
+            screen_pointer[i] = cell_from(text[i], attribute);
+            if (remaining != 0)
+                --remaining;
         }
     }
 
+    //! Writes a run of characters.
+    /*!
+     * This function is similar to `write_span` except that it uses the color attributes
+     * currently on the screen instead of writing new attributes.
+     *
+     * \param row The row number where the run will be written.
+     * \param column The column number where the run starts.
+     * \param text Pointer to the characters to write.
+     * \param length The number of characters to write. An empty run is ignored.
+     */
+    void write_span_text(int row, int column, const char *text, std::size_t length)
+    {
+        if (length == 0)
+            return;
+        int width = static_cast<int>(std::min<std::size_t>(length, total_columns));
+        int dummy_height = 1;
+        adjust_dimensions(row, column, width, dummy_height);
+
+        Cell *const screen_pointer = cell_address(row, column);
+        for (int i = 0; i < width; ++i)
+            screen_pointer[i] = cell_from(text[i], cell_attribute(screen_pointer[i]));
+    }
+
     //! Print formatted text and attributes.
     /*!
-     * This function rewrites both the characters and the attributes on the screen.
+     * This function rewrites both the characters and the attributes on the screen. Text that
+     * needs no formatting is better written with `write_span`.
      *
      * \param row The row number where the text will be printed.
      * \param column The column number of the text's starting position.
@@ -700,23 +1367,13 @@ namespace scr {
      */
     void print(int row, int column, std::size_t count, int attribute, const char *format, ...)
     {
-        char *screen_pointer;
-        char *string = work_buffer;
-        int dummy_height = 1;
-        int width = static_cast<int>(count);
         std::va_list args;
-
-        adjust_dimensions(row, column, width, dummy_height);
-        attribute = convert_attribute(attribute);
+        std::size_t length;
 
         va_start(args, format);
-        std::vsnprintf(work_buffer, maximum_print_size + 1, format, args);
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-        while (*string && width--) {
-            *screen_pointer++ = *string++;
-            *screen_pointer++ = static_cast<char>(attribute);
-        }
+        const char *const text = format_text(count, length, format, args);
         va_end(args);
+        write_span(row, column, text, length, attribute);
     }
 
     //! Print formatted text.
@@ -732,22 +1389,13 @@ namespace scr {
      */
     void print_text(int row, int column, std::size_t count, const char *format, ...)
     {
-        char *screen_pointer;
-        char *string = work_buffer;
-        int dummy_height = 1;
-        int width = static_cast<int>(count);
         std::va_list args;
-
-        adjust_dimensions(row, column, width, dummy_height);
+        std::size_t length;
 
         va_start(args, format);
-        std::vsnprintf(work_buffer, maximum_print_size + 1, format, args);
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-        while (*string && width--) {
-            *screen_pointer++ = *string++;
-            screen_pointer++;
-        }
+        const char *const text = format_text(count, length, format, args);
         va_end(args);
+        write_span_text(row, column, text, length);
     }
 
     //! Erases a region of the screen.
@@ -762,22 +1410,7 @@ namespace scr {
      */
     void clear(int row, int column, int width, int height, int attribute)
     {
-        char *screen_pointer;
-        char *destination;
-        int i;
-
-        adjust_dimensions(row, column, width, height);
-        attribute = convert_attribute(attribute);
-
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-        for (; height > 0; height--) {
-            destination = screen_pointer;
-            for (i = 0; i < width; i++) {
-                *destination++ = ' ';
-                *destination++ = static_cast<char>(attribute);
-            }
-            screen_pointer += 2 * total_columns;
-        }
+        fill(row, column, width, height, attribute);
     }
 
     //! Changes the color of a region of the screen.
@@ -794,24 +1427,93 @@ namespace scr {
      */
     void set_color(int row, int column, int width, int height, int attribute)
     {
-        char *screen_pointer;
-        char *destination;
-        int i;
+        if (width <= 0 || height <= 0)
+            return;
+        adjust_dimensions(row, column, width, height);
+        for (int i = 0; i < height; ++i)
+            fill_color(row + i, column, width, attribute);
+    }
 
+    //! Fills a region of the screen with one character.
+    /*!
+     * Every cell of the region is the same word, so each row is filled as a single run. Empty
+     * regions are ignored.
+     *
+     * \param row The row number of the region's upper left corner.
+     * \param column The column number of the region's upper left corner.
+     * \param width The width of the region in columns.
+     * \param height The height of the region in rows.
+     * \param attribute The color attribute to use in the region.
+     * \param letter The character written to every position of the region.
+     */
+    void fill(int row, int column, int width, int height, int attribute, char letter)
+    {
+        if (width <= 0 || height <= 0)
+            return;
         adjust_dimensions(row, column, width, height);
         attribute = convert_attribute(attribute);
 
-        screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-        for (; height > 0; height--) {
-            destination = screen_pointer;
-            for (i = 0; i < width; i++) {
-                destination++;
-                *destination++ = static_cast<char>(attribute);
-            }
-            screen_pointer += 2 * total_columns;
+        const Cell cell = cell_from(letter, attribute);
+        for (int i = 0; i < height; ++i)
+            std::fill_n(cell_address(row + i, column), width, cell);
+    }
+
+    //! Writes a horizontal run of one character.
+    /*!
+     * \param row The row number of the run.
+     * \param column The column number where the run starts.
+     * \param count The number of cells in the run. An empty run is ignored.
+     * \param attribute The color attribute to use for the run.
+     * \param letter The character written to every cell of the run.
+     */
+    void fill_row(int row, int column, int count, int attribute, char letter)
+    {
+        fill(row, column, count, 1, attribute, letter);
+    }
+
+    //! Writes a vertical run of one character.
+    /*!
+     * \param row The row number where the run starts.
+     * \param column The column number of the run.
+     * \param count The number of cells in the run. An empty run is ignored.
+     * \param attribute The color attribute to use for the run.
+     * \param letter The character written to every cell of the run.
+     */
+    void fill_column(int row, int column, int count, int attribute, char letter)
+    {
+        if (count <= 0)
+            return;
+        int width = 1;
+        adjust_dimensions(row, column, width, count);
+        attribute = convert_attribute(attribute);
+
+        const Cell cell = cell_from(letter, attribute);
+        for (Cell *destination = cell_address(row, column); count > 0; --count) {
+            *destination = cell;
+            destination += total_columns;
         }
     }
 
+    //! Changes the color of a horizontal run of cells without changing their text.
+    /*!
+     * \param row The row number of the run.
+     * \param column The column number where the run starts.
+     * \param count The number of cells in the run. An empty run is ignored.
+     * \param attribute The color attribute to use for the run.
+     */
+    void fill_color(int row, int column, int count, int attribute)
+    {
+        if (count <= 0)
+            return;
+        int height = 1;
+        adjust_dimensions(row, column, count, height);
+        attribute = convert_attribute(attribute);
+
+        Cell *const destination = cell_address(row, column);
+        for (int i = 0; i < count; ++i)
+            destination[i] = recolor(destination[i], attribute);
+    }
+
     //! Scroll a region.
     /*!
      * This function scrolls a region. Note that `UP` means that the text and attributes of the
@@ -830,8 +1532,8 @@ namespace scr {
     void scroll(direction_t direction, int row, int column, int width, int height,
                 int number_of_rows, int attribute)
     {
-        char *screen_pointer;
-        char *source_pointer;
+        Cell *screen_pointer;
+        Cell *source_pointer;
         int row_counter;
 
         if (number_of_rows <= 0)
@@ -845,26 +1547,34 @@ namespace scr {
             return;
         }
 
+#if eOPSYS == ePOSIX
+        // Whole rows can be scrolled by the terminal itself. Then refresh only has to write the
+        // rows that were exposed.
+        if (column == 1 && width == total_columns) {
+            const int count = (direction == UP) ? number_of_rows : -number_of_rows;
+            pending_scrolls.push_back({row - 1, row + height - 2, count});
+        }
+#endif
+
         if (direction == UP) {
-            screen_pointer = screen_image + ((row - 1) * 2 * total_columns) + (column - 1) * 2;
-            source_pointer = screen_pointer + (number_of_rows * 2 * total_columns);
+            screen_pointer = cell_address(row, column);
+            source_pointer = screen_pointer + number_of_rows * total_columns;
             for (row_counter = 0; row_counter < height - number_of_rows; row_counter++) {
-                std::memcpy(screen_pointer, source_pointer, 2 * width);
-                screen_pointer += 2 * total_columns;
-                source_pointer += 2 * total_columns;
+                std::copy_n(source_pointer, width, screen_pointer);
+                screen_pointer += total_columns;
+                source_pointer += total_columns;
             }
             clear(row + (height - number_of_rows), column, width, number_of_rows, attribute);
         }
 
         // Otherwise we're trying to scroll down.
         else {
-            screen_pointer =
-                screen_image + ((row - 1 + height - 1) * 2 * total_columns) + (column - 1) * 2;
-            source_pointer = screen_pointer - (number_of_rows * 2 * total_columns);
+            screen_pointer = cell_address(row + height - 1, column);
+            source_pointer = screen_pointer - number_of_rows * total_columns;
             for (row_counter = 0; row_counter < height - number_of_rows; row_counter++) {
-                std::memcpy(screen_pointer, source_pointer, 2 * width);
-                screen_pointer -= 2 * total_columns;
-                source_pointer -= 2 * total_columns;
+                std::copy_n(source_pointer, width, screen_pointer);
+                screen_pointer -= total_columns;
+                source_pointer -= total_columns;
             }
             clear(row, column, width, number_of_rows, attribute);
         }
@@ -959,45 +1669,29 @@ namespace scr {
 
     void clear_screen()
     {
-        // This will update both the screen image and the physical screen.
-        clear(1, 1, total_columns, total_rows, WHITE | REV_BLACK);
-        set_cursor_position(1, 1);
+        // Nothing is known about what the console shows, so refresh writes all of it.
+        const Cell blank = make_cell(' ', WHITE | REV_BLACK);
+        std::fill_n(screen_image, total_rows * total_columns, blank);
+        std::fill_n(physical_image, total_rows * total_columns, unknown_cell);
+
+        virtual_row = 1;
+        virtual_column = 1;
         refresh();
     }
 
     void redraw()
     {
-        // This assumes total_columns and total_rows are both < 32k.
-        COORD where = {0, 0};
-        COORD size = {static_cast<SHORT>(total_columns), static_cast<SHORT>(total_rows)};
-
-        SMALL_RECT rwhere = {0, 0, static_cast<SHORT>(total_columns - 1),
-                             static_cast<SHORT>(total_rows - 1)};
-        HANDLE hStdOut = GetStdHandle(STD_OUTPUT_HANDLE);
-
-        // Copy the screen image to the console image.
-        for (int cc = 0; cc < total_rows * total_columns; cc++) {
-            console_image[cc].Char.UnicodeChar = 0;
-            console_image[cc].Char.AsciiChar = screen_image[cc * 2];
-            console_image[cc].Attributes = screen_image[cc * 2 + 1];
+        // Write every row in its entirety. They are sent to the console as one rectangle.
+        for (int row = 0; row < total_rows; ++row) {
+            write_run(row, 0, total_columns);
         }
-
-        WriteConsoleOutput(hStdOut,                    // Which console
-                           (CHAR_INFO *)console_image, // Buffer address
-                           size,                       // Screen size of buffer image
-                           where,                      // Starting point (upper left)
-                           &rwhere                     // Where actually written
-        );
-
-        // This assumes virtual_column and virtual_row both < 32k.
-        where.X = static_cast<SHORT>(virtual_column - 1);
-        where.Y = static_cast<SHORT>(virtual_row - 1);
-        SetConsoleCursorPosition(hStdOut, where);
+        update_cursor();
     }
 
     void refresh()
     {
-        redraw();
+        write_changes();
+        update_cursor();
     }
 
     void off()
@@ -1016,163 +1710,71 @@ namespace scr {
 
     void clear_screen()
     {
-        int counter;
-
         // Clear the physical screen.
-        werase(stdscr);
+        if (direct_output)
+            terminal::clear();
+        else
+            werase(stdscr);
 
         // Make the arrays correct.
-        for (counter = 0; counter < total_rows * 2 * total_columns; counter += 2) {
-            screen_image[counter] = ' ';
-            screen_image[counter + 1] = WHITE | REV_BLACK;
-            physical_image[counter] = ' ';
-            physical_image[counter + 1] = WHITE | REV_BLACK;
-        }
+        pending_scrolls.clear();
+        const Cell blank = make_cell(' ', WHITE | REV_BLACK);
+        std::fill_n(screen_image, total_rows * total_columns, blank);
+        std::fill_n(physical_image, total_rows * total_columns, blank);
 
-        // Position the cursor. Record the location of the real cursor.
-        move(0, 0);
+        // Position the cursor.
         virtual_row = 1;
         virtual_column = 1;
-        physical_row = 1;
-        physical_column = 1;
-
-        // Tell curses to do the update on the "real" physical screen.
-        ::refresh();
+        update_cursor();
     }
 
     void redraw()
     {
-        int row_count;
-        int column_count;
-        char *current_character; // Points at next character in the screen
-                                 // image that we want to print.
-
-        // Scan over the entire screen, one row at a time.
-        for (row_count = 1; row_count <= total_rows; row_count++) {
-
-            // Put the cursor at the start of the row.
-            move(row_count - 1, 0);
-
-            // Point into the screen image.
-            current_character = screen_image + (row_count - 1) * 2 * total_columns;
-
-            // Scan down the row...
-            for (column_count = 1; column_count <= total_columns; column_count++) {
-
-                // Print the character.
-                chtype new_character;
-                CharacterMap::iterator p = box_character_map.find(*current_character);
-                if (p == box_character_map.end())
-                    new_character = (unsigned char)*current_character;
-                else
-                    new_character = box_character_map[*current_character];
-
-                if (*(current_character + 1) & BLINK)
-                    new_character |= A_BLINK;
-                if (*(current_character + 1) & BRIGHT)
-                    new_character |= A_BOLD;
-
-                // Add color information if we are supposed to.
-                if (color_works) {
-                    int just_color = *(current_character + 1) & ~(BLINK | BRIGHT);
-                    ColorMap::iterator p = colors_map.find(just_color);
-                    if (p != colors_map.end()) {
-                        new_character |= COLOR_PAIR(colors_map[just_color]);
-                    }
-                }
-
-                // Finally! Print the character.
-                addch(new_character);
-                current_character += 2;
-            }
+        // Write every row in its entirety. That also shows the scrolls still pending.
+        pending_scrolls.clear();
+        for (int row = 0; row < total_rows; ++row) {
+            write_run(row, 0, total_columns);
         }
 
         // Ok. We're done with the screen. Now we've got to position the cursor and reset the
         // screen.
         //
-        move(virtual_row - 1, virtual_column - 1);
-
-        // Tell curses to do the update on the "real" physical screen.
-        ::refresh();
+        update_cursor();
     }
 
     void refresh()
     {
-        int row_count;
-        int column_count;
-
-        // Loop over the entire screen.
-        for (row_count = 1; row_count <= total_rows; row_count++) {
-            for (column_count = 1; column_count <= total_columns; column_count++) {
-
-                // Compute offset into the image arrays of the current character.
-                int array_index = (row_count - 1) * 2 * total_columns + 2 * (column_count - 1);
-
-                // If this character is already what we want, skip it.
-                if (screen_image[array_index] == physical_image[array_index] &&
-                    screen_image[array_index + 1] == physical_image[array_index + 1])
-                    continue;
-
-                // Otherwise, position the cursor if it's in the wrong place.
-                if (row_count != physical_row || column_count != physical_column) {
-                    move(row_count - 1, column_count - 1);
-                    physical_row = row_count;
-                    physical_column = column_count;
-                }
-
-                // Print the character! (And adjust our record of the cursor position.
-                chtype new_character;
-                CharacterMap::iterator p = box_character_map.find(screen_image[array_index]);
-                if (p == box_character_map.end())
-                    new_character = (unsigned char)screen_image[array_index];
-                else
-                    new_character = box_character_map[screen_image[array_index]];
-
-                // Add the attributes if necessary.
-                if (screen_image[array_index + 1] & BLINK)
-                    new_character |= A_BLINK;
-                if (screen_image[array_index + 1] & BRIGHT)
-                    new_character |= A_BOLD;
-
-                // Add color information if we are supposed to.
-                if (color_works) {
-                    int just_color = screen_image[array_index + 1] & ~(BLINK | BRIGHT);
-                    ColorMap::iterator p = colors_map.find(just_color);
-                    if (p != colors_map.end()) {
-                        new_character |= COLOR_PAIR(colors_map[just_color]);
-                    }
-                }
-
-                // Finally! Print the character.
-                addch(new_character);
-                physical_column++;
-
-                // Update the physical image.
-                physical_image[array_index] = screen_image[array_index];
-                physical_image[array_index + 1] = screen_image[array_index + 1];
-            }
-        }
+        apply_scrolls();
+        write_changes();
 
         // Position the cursor to its final resting place.
-        move(virtual_row - 1, virtual_column - 1);
-        physical_row = virtual_row;
-        physical_column = virtual_column;
-
-        // Tell curses to do the update on the "real" physical screen.
-        ::refresh();
+        update_cursor();
     }
 
     void off()
     {
+        if (headless)
+            return;
+        if (direct_output) {
+            terminal::reset();
+            terminal::flush();
+        }
+        bracketed_paste(false);
         reset_shell_mode();
         putp(exit_ca_mode);
     }
 
     void on()
     {
+        if (headless)
+            return;
         putp(enter_ca_mode);
+        bracketed_paste(true);
         reset_prog_mode();
-        ::refresh();
+        if (direct_output)
+            terminal::forget();
+        else
+            ::refresh();
     }
 
 #endif
@@ -29,11 +29,11 @@ namespace scr {
         std::size_t text_length = std::strlen(text);
 
         if (static_cast<std::size_t>(width) < text_length) {
-            print(row, column, width, attribute, "%s", text);
+            write_span(row, column, text, width, attribute);
         }
         else {
             offset = (width - text_length) / 2;
-            print(row, column + offset, text_length, attribute, "%s", text);
+            write_span(row, column + offset, text, text_length, attribute);
         }
     }
 
@@ -41,7 +41,8 @@ namespace scr {
     /*!
      *
      * The box is drawn using the specified region coordinates. The interior of the box has a
-     * width and height that are two less than the given values.
+     * width and height that are two less than the given values. Each side is written as a
+     * single run of cells.
      *
      * \param row Row coordinate of the region's upper left corner.
      * \param column Column coordinate of the region's upper left corner.
@@ -53,21 +54,21 @@ namespace scr {
     void draw_box(int row, int column, int width, int height, enum BoxType the_type,
                   int attribute)
     {
-        int i;
         struct BoxChars *box_type = get_box_characters(the_type);
-
-        for (i = column + 1; i < column + width - 1; i++) {
-            print(row, i, 1, attribute, "%c", box_type->horizontal);
-            print(row + height - 1, i, 1, attribute, "%c", box_type->horizontal);
-        }
-        for (i = row + 1; i < row + height - 1; i++) {
-            print(i, column, 1, attribute, "%c", box_type->vertical);
-            print(i, column + width - 1, 1, attribute, "%c", box_type->vertical);
-        }
-        print(row, column, 1, attribute, "%c", box_type->upper_left);
-        print(row, column + width - 1, 1, attribute, "%c", box_type->upper_right);
-        print(row + height - 1, column, 1, attribute, "%c", box_type->lower_left);
-        print(row + height - 1, column + width - 1, 1, attribute, "%c", box_type->lower_right);
+        const char horizontal = static_cast<char>(box_type->horizontal);
+        const char vertical = static_cast<char>(box_type->vertical);
+
+        fill_row(row, column + 1, width - 2, attribute, horizontal);
+        fill_row(row + height - 1, column + 1, width - 2, attribute, horizontal);
+        fill_column(row + 1, column, height - 2, attribute, vertical);
+        fill_column(row + 1, column + width - 1, height - 2, attribute, vertical);
+        fill_row(row, column, 1, attribute, static_cast<char>(box_type->upper_left));
+        fill_row(row, column + width - 1, 1, attribute,
+                 static_cast<char>(box_type->upper_right));
+        fill_row(row + height - 1, column, 1, attribute,
+                 static_cast<char>(box_type->lower_left));
+        fill_row(row + height - 1, column + width - 1, 1, attribute,
+                 static_cast<char>(box_type->lower_right));
     }
 
     //! Get a string of text.
@@ -96,7 +97,7 @@ namespace scr {
 
         do {
             // Print as much from the buffer as there is right now and position cursor.
-            print(row, column, std::strlen(buffer), attribute, "%s", buffer);
+            write_span(row, column, buffer, std::strlen(buffer), attribute);
             set_cursor_position(row, column + buffer_offset);
 
             // Clear the rest (to show size of buffer in attribute).
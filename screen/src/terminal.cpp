@@ -0,0 +1,450 @@
+/*! \file    terminal.cpp
+ *  \brief   Direct output to VT/ANSI terminals.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * On POSIX systems the screen image is normally shown with curses. Curses keeps its own copy of
+ * the screen and optimizes its output a second time, although `refresh` already knows exactly
+ * which runs of cells have changed. When the environment variable SCR_TERMINAL is "vt" those
+ * runs are instead written as escape sequences understood by VT100 compatible terminals (which
+ * is nearly all of them). Curses is still used for the keyboard and for switching modes. On
+ * Windows the same variable selects escape sequences instead of the console API, provided the
+ * console can be put in its virtual terminal mode.
+ *
+ * All output for a frame is collected in one buffer and written with a single write(). The
+ * cursor position and the current colors are tracked so that only the sequences needed to
+ * change them are written. Cursor motions are chosen by their length. If COLORTERM announces a
+ * "truecolor" (or "24bit") terminal, colors are written as exact RGB values of the usual PC
+ * palette; otherwise the standard 16 colors are used. Rows that `scr::scroll` moved across the
+ * whole screen are scrolled by the terminal itself.
+ */
+
+#include "screen/environ.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if eOPSYS == eWINDOWS
+#include <windows.h>
+
+// Older SDKs don't define these console modes.
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#ifndef DISABLE_NEWLINE_AUTO_RETURN
+#define DISABLE_NEWLINE_AUTO_RETURN 0x0008
+#endif
+#endif
+
+#if eOPSYS == ePOSIX
+#include <unistd.h>
+#endif
+
+#include "screen/screen.hpp"
+
+namespace scr {
+    namespace terminal {
+
+        namespace {
+
+            std::string output;          // Sequences waiting to be written.
+            unsigned long long sent = 0; // Bytes written to the terminal.
+            bool truecolor = false;      // =true if colors are written as RGB values.
+            bool utf8 = false;           // =true if the terminal takes UTF-8 text.
+            bool detached = false;       // =true if the output is only counted.
+
+            // What the terminal is doing now. Negative values are unknown.
+            int cursor_row = -1;
+            int cursor_column = -1;
+            int current_attribute = -1;
+            bool graphics = false; // =true if the DEC line drawing set is selected.
+
+            int total_columns = 80;
+
+#if eOPSYS == eWINDOWS
+            HANDLE console = INVALID_HANDLE_VALUE; // The console written to.
+            DWORD original_mode = 0;               // The console's settings before start().
+            UINT original_code_page = 0;
+#endif
+
+            // DEC line drawing characters for Scr's box drawing characters (zero if none).
+            char line_drawing[256];
+
+            // The ANSI color number for each Scr color.
+            const int ansi_color[8] = {0, 4, 2, 6, 1, 5, 3, 7};
+
+            // RGB values of the PC palette, dim colors followed by bright ones, in Scr order.
+            const unsigned char palette[16][3] = {
+                {0, 0, 0},       {0, 0, 170},     {0, 170, 0},     {0, 170, 170},
+                {170, 0, 0},     {170, 0, 170},   {170, 85, 0},    {170, 170, 170},
+                {85, 85, 85},    {85, 85, 255},   {85, 255, 85},   {85, 255, 255},
+                {255, 85, 85},   {255, 85, 255},  {255, 255, 85},  {255, 255, 255}};
+
+            void initialize_line_drawing()
+            {
+                static const struct {
+                    unsigned char scr;
+                    char dec;
+                } associations[] = {
+                    // Double lines look the same as single lines.
+                    {205, 'q'}, {186, 'x'}, {201, 'l'}, {187, 'k'}, {200, 'm'}, {188, 'j'},
+                    {181, 'u'}, {198, 't'}, {208, 'v'}, {210, 'w'}, {206, 'n'},
+                    {196, 'q'}, {179, 'x'}, {218, 'l'}, {191, 'k'}, {192, 'm'}, {217, 'j'},
+                    {180, 'u'}, {195, 't'}, {193, 'v'}, {194, 'w'}, {197, 'n'},
+                    {177, 'a'}, {219, 'a'}};
+
+                std::memset(line_drawing, 0, sizeof(line_drawing));
+                for (const auto &association : associations)
+                    line_drawing[association.scr] = association.dec;
+            }
+
+            bool contains(const char *text, const char *part)
+            {
+                return text != nullptr && std::strstr(text, part) != nullptr;
+            }
+
+            void append_number(std::string &sequence, int number)
+            {
+                char digits[12];
+                int count = 0;
+                do {
+                    digits[count++] = static_cast<char>('0' + number % 10);
+                    number /= 10;
+                } while (number != 0);
+                while (count > 0)
+                    sequence += digits[--count];
+            }
+
+            // Returns a control sequence: CSI, the parameter (if not one), and the final byte.
+            std::string control(const int parameter, const char final)
+            {
+                std::string sequence("\033[");
+                if (parameter != 1)
+                    append_number(sequence, parameter);
+                sequence += final;
+                return sequence;
+            }
+
+            void append_rgb(const int layer, const unsigned char *rgb)
+            {
+                output += ';';
+                append_number(output, layer);
+                output += ";2";
+                for (int i = 0; i < 3; ++i) {
+                    output += ';';
+                    append_number(output, rgb[i]);
+                }
+            }
+
+            // Selects the colors and effects of a Scr attribute.
+            void set_attribute(const int attribute)
+            {
+                if (attribute == current_attribute)
+                    return;
+                current_attribute = attribute;
+
+                const int foreground = attribute & 0x07;
+                const int background = (attribute & 0x70) >> 4;
+                output += "\033[0";
+                if (attribute & BLINK)
+                    output += ";5";
+                if (truecolor) {
+                    append_rgb(38, palette[foreground + ((attribute & BRIGHT) ? 8 : 0)]);
+                    append_rgb(48, palette[background]);
+                }
+                else {
+                    // The defaults are used for white on black, as curses does.
+                    if (attribute & BRIGHT)
+                        output += ";1";
+                    if (foreground != WHITE) {
+                        output += ";3";
+                        append_number(output, ansi_color[foreground]);
+                    }
+                    if (background != BLACK) {
+                        output += ";4";
+                        append_number(output, ansi_color[background]);
+                    }
+                }
+                output += 'm';
+            }
+
+            void set_graphics(const bool wanted)
+            {
+                if (wanted != graphics) {
+                    output += wanted ? "\033(0" : "\033(B";
+                    graphics = wanted;
+                }
+            }
+
+            void append_utf8(const std::uint32_t code_point)
+            {
+                if (code_point < 0x80)
+                    output += static_cast<char>(code_point);
+                else if (code_point < 0x800) {
+                    output += static_cast<char>(0xC0 | (code_point >> 6));
+                    output += static_cast<char>(0x80 | (code_point & 0x3F));
+                }
+                else if (code_point < 0x10000) {
+                    output += static_cast<char>(0xE0 | (code_point >> 12));
+                    output += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                    output += static_cast<char>(0x80 | (code_point & 0x3F));
+                }
+                else {
+                    output += static_cast<char>(0xF0 | (code_point >> 18));
+                    output += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+                    output += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+                    output += static_cast<char>(0x80 | (code_point & 0x3F));
+                }
+            }
+
+        } // namespace
+
+        //! Forgets the state of the terminal, for example after a shell escape.
+        void forget()
+        {
+            cursor_row = -1;
+            cursor_column = -1;
+            current_attribute = -1;
+            graphics = false;
+            output += "\033(B";
+        }
+
+        //! Decides if terminal output is to be used.
+        /*!
+         * \param width The number of columns on the screen.
+         * \return true if SCR_TERMINAL asks for terminal output and the standard output is a
+         * terminal that can take it. Otherwise curses must be used.
+         */
+        bool start(const int width)
+        {
+            const char *const wanted = std::getenv("SCR_TERMINAL");
+            if (wanted == nullptr || std::strcmp(wanted, "vt") != 0)
+                return false;
+            const char *const color = std::getenv("COLORTERM");
+            truecolor = contains(color, "truecolor") || contains(color, "24bit");
+
+#if eOPSYS == ePOSIX
+            const char *const type = std::getenv("TERM");
+            if (!isatty(STDOUT_FILENO) || type == nullptr || std::strcmp(type, "dumb") == 0)
+                return false;
+
+            const char *locale = std::getenv("LC_ALL");
+            if (locale == nullptr || *locale == '\0')
+                locale = std::getenv("LC_CTYPE");
+            if (locale == nullptr || *locale == '\0')
+                locale = std::getenv("LANG");
+            utf8 = contains(locale, "UTF-8") || contains(locale, "utf8");
+#endif
+
+#if eOPSYS == eWINDOWS
+            // Consoles before Windows 10 don't have the mode and refuse it.
+            console = GetStdHandle(STD_OUTPUT_HANDLE);
+            if (!GetConsoleMode(console, &original_mode))
+                return false;
+            const DWORD mode = ENABLE_VIRTUAL_TERMINAL_PROCESSING | DISABLE_NEWLINE_AUTO_RETURN;
+            if (!SetConsoleMode(console, original_mode | mode))
+                return false;
+            original_code_page = GetConsoleOutputCP();
+            utf8 = SetConsoleOutputCP(CP_UTF8) != 0;
+#endif
+
+            initialize_line_drawing();
+            total_columns = width;
+            output.reserve(16 * 1024);
+            forget();
+            return true;
+        }
+
+        //! Prepares output for a headless screen. The bytes are counted instead of written.
+        /*!
+         * The output is what a UTF-8 terminal with the standard 16 colors would be sent.
+         *
+         * \param width The number of columns on the screen.
+         * \return true, always.
+         */
+        bool start_detached(const int width)
+        {
+            detached = true;
+            truecolor = false;
+            utf8 = true;
+            initialize_line_drawing();
+            total_columns = width;
+            output.reserve(16 * 1024);
+            forget();
+            return true;
+        }
+
+        //! Notes a new number of columns. Where the cursor is afterward isn't known.
+        void resize(const int width)
+        {
+            total_columns = width;
+            forget();
+        }
+
+        //! Moves the cursor using the shortest sequence that gets it there.
+        /*!
+         * \param row The zero based row the cursor moves to.
+         * \param column The zero based column the cursor moves to.
+         */
+        void move_to(const int row, const int column)
+        {
+            if (row == cursor_row && column == cursor_column)
+                return;
+
+            // A full cursor position always works. The others need the current position.
+            std::string best("\033[");
+            append_number(best, row + 1);
+            if (column != 0) {
+                best += ';';
+                append_number(best, column + 1);
+            }
+            best += 'H';
+
+            auto consider = [&best](const std::string &candidate) {
+                if (candidate.size() < best.size())
+                    best = candidate;
+            };
+            if (row == cursor_row && cursor_column >= 0) {
+                if (column == 0)
+                    consider("\r");
+                consider(control(column + 1, 'G'));
+                if (column > cursor_column)
+                    consider(control(column - cursor_column, 'C'));
+                else
+                    consider(control(cursor_column - column, 'D'));
+            }
+            else if (column == cursor_column && cursor_row >= 0) {
+                if (row > cursor_row)
+                    consider(control(row - cursor_row, 'B'));
+                else
+                    consider(control(cursor_row - row, 'A'));
+            }
+
+            output += best;
+            cursor_row = row;
+            cursor_column = column;
+        }
+
+        //! Writes a cell at the cursor position and advances the cursor.
+        void put(const Cell cell)
+        {
+            set_attribute(cell_attribute(cell));
+
+            const std::uint32_t code_point = cell_code_point(cell);
+            const char line = (code_point < 256) ? line_drawing[code_point] : '\0';
+            set_graphics(line != '\0');
+            if (line != '\0')
+                output += line;
+            else if (code_point < ' ' || code_point == 127)
+                output += '?';
+            else if (code_point < 128 || utf8)
+                append_utf8(code_point);
+            else
+                output += '?';
+
+            // Terminals differ about where the cursor is after the last column is written.
+            if (++cursor_column >= total_columns)
+                cursor_column = -1;
+        }
+
+        //! Erases the whole display to white on black and homes the cursor.
+        void clear()
+        {
+            set_attribute(WHITE | REV_BLACK);
+            output += "\033[H\033[2J";
+            cursor_row = 0;
+            cursor_column = 0;
+        }
+
+        //! Scrolls rows of the display.
+        /*!
+         * The region is made the scrolling region (DECSTBM) and the cursor is indexed past its
+         * bottom or reverse indexed past its top, which every VT100 compatible terminal does.
+         * What the exposed rows contain afterwards is up to the terminal.
+         *
+         * \param top The first row of the region (zero based).
+         * \param bottom The last row of the region (zero based).
+         * \param count The number of rows the region moves up (down if negative).
+         */
+        void scroll(const int top, const int bottom, int count)
+        {
+            output += "\033[";
+            append_number(output, top + 1);
+            output += ';';
+            append_number(output, bottom + 1);
+            output += 'r';
+
+            // Setting the region homes the cursor.
+            cursor_row = 0;
+            cursor_column = 0;
+            move_to((count > 0) ? bottom : top, 0);
+            for (; count > 0; --count)
+                output += "\033D";
+            for (; count < 0; ++count)
+                output += "\033M";
+
+            output += "\033[r";
+            cursor_row = 0;
+            cursor_column = 0;
+        }
+
+        //! Restores the terminal's own colors and character set.
+        void reset()
+        {
+            set_graphics(false);
+            output += "\033[0m";
+            current_attribute = -1;
+        }
+
+        //! Sends the collected output to the terminal with one write.
+        void flush()
+        {
+            if (detached) {
+                sent += output.size();
+                output.clear();
+                return;
+            }
+            std::size_t written = 0;
+            while (written < output.size()) {
+#if eOPSYS == ePOSIX
+                const ssize_t count =
+                    ::write(STDOUT_FILENO, output.data() + written, output.size() - written);
+                if (count < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    break;
+                }
+#endif
+#if eOPSYS == eWINDOWS
+                DWORD count = 0;
+                if (!WriteFile(console, output.data() + written,
+                               static_cast<DWORD>(output.size() - written), &count, nullptr) ||
+                    count == 0)
+                    break;
+#endif
+                written += static_cast<std::size_t>(count);
+            }
+            sent += written;
+            output.clear();
+        }
+
+        //! Returns the number of bytes written to the terminal.
+        unsigned long long bytes_written()
+        {
+            return sent;
+        }
+
+        //! Puts the terminal back the way start() found it, once the last output is flushed.
+        void stop()
+        {
+#if eOPSYS == eWINDOWS
+            SetConsoleMode(console, original_mode);
+            if (utf8)
+                SetConsoleOutputCP(original_code_page);
+#endif
+        }
+
+    } // namespace terminal
+} // namespace scr
@@ -0,0 +1,230 @@
+/*! \file    Allocations.cpp
+ *  \brief   Implementation of the Allocations abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "Allocations.hpp"
+#include "Trace.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! What is known about the allocations charged to one subsystem.
+    struct Usage {
+        std::atomic<unsigned long long> live{0};        //!< Bytes not yet released.
+        std::atomic<unsigned long long> peak{0};        //!< The most bytes ever live at once.
+        std::atomic<unsigned long long> allocations{0}; //!< Allocations ever made.
+        std::atomic<unsigned long long> allocated{0};   //!< Bytes ever allocated.
+    };
+
+    //! Precedes each block on the heap. It is as aligned as the block that follows it.
+    struct alignas(std::max_align_t) Header {
+        std::size_t size;
+        Allocations::Tag tag;
+    };
+
+    const char *const tag_names[Allocations::TAG_COUNT] = {"other", "document", "clipboard",
+                                                           "macro", "screen"};
+
+    std::atomic<unsigned long long> allocations{0};
+    Usage usages[Allocations::TAG_COUNT];
+    thread_local Allocations::Tag current_tag = Allocations::OTHER;
+
+    // When the rates of the last report were taken from.
+    std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+    //! Allocates size bytes (at least one), calling the new handler until it works.
+    /*!
+     * \throws std::bad_alloc if there is no memory and no new handler to make some.
+     */
+    void *allocate(std::size_t size)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        if (size == 0)
+            size = 1;
+        void *block;
+        while ((block = std::malloc(sizeof(Header) + size)) == nullptr) {
+            const std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+                throw std::bad_alloc();
+            handler();
+        }
+
+        Header *const header = static_cast<Header *>(block);
+        header->size = size;
+        header->tag = current_tag;
+        Usage &usage = usages[current_tag];
+        usage.allocations.fetch_add(1, std::memory_order_relaxed);
+        usage.allocated.fetch_add(size, std::memory_order_relaxed);
+        const unsigned long long live =
+            usage.live.fetch_add(size, std::memory_order_relaxed) + size;
+        unsigned long long peak = usage.peak.load(std::memory_order_relaxed);
+        while (live > peak && !usage.peak.compare_exchange_weak(peak, live,
+                                                                std::memory_order_relaxed))
+            ;
+        return header + 1;
+    }
+
+    //! Allocates size bytes, returning nullptr if that can't be done.
+    void *try_allocate(const std::size_t size) noexcept
+    {
+        try {
+            return allocate(size);
+        }
+        catch (std::bad_alloc &) {
+            return nullptr;
+        }
+    }
+
+    //! Releases a block returned by allocate (or does nothing with nullptr).
+    void release(void *const block) noexcept
+    {
+        if (block == nullptr)
+            return;
+        Header *const header = static_cast<Header *>(block) - 1;
+        usages[header->tag].live.fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(header);
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Allocations {
+
+    unsigned long long count()
+    {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long live_bytes(const Tag tag)
+    {
+        return usages[tag].live.load(std::memory_order_relaxed);
+    }
+
+    Scope::Scope(const Tag tag) : previous(current_tag)
+    {
+        current_tag = tag;
+    }
+
+    Scope::~Scope()
+    {
+        current_tag = previous;
+    }
+
+    void trace()
+    {
+        if (!Trace::active())
+            return;
+        for (int tag = 0; tag < TAG_COUNT; ++tag)
+            Trace::counter(tag_names[tag], "memory", static_cast<long>(live_bytes(Tag(tag))));
+    }
+
+    std::vector<std::string> report()
+    {
+        using Clock = std::chrono::steady_clock;
+        static unsigned long long last_allocations[TAG_COUNT] = {};
+        static unsigned long long last_allocated[TAG_COUNT] = {};
+
+        const Clock::time_point now = Clock::now();
+        const double seconds = std::max(
+            std::chrono::duration_cast<std::chrono::duration<double>>(now - last_report)
+                .count(),
+            1e-3);
+        last_report = now;
+
+        std::vector<std::string> lines;
+        char line[81];
+        lines.push_back("Subsystem     Live KB     Peak KB   Allocations   Allocs/s      KB/s");
+        unsigned long long total_live = 0;
+        for (int tag = 0; tag < TAG_COUNT; ++tag) {
+            const Usage &usage = usages[tag];
+            const unsigned long long live = usage.live.load(std::memory_order_relaxed);
+            const unsigned long long made = usage.allocations.load(std::memory_order_relaxed);
+            const unsigned long long bytes = usage.allocated.load(std::memory_order_relaxed);
+            std::snprintf(line, sizeof(line), "%-10s %10.1f %11.1f %13llu %10.0f %9.1f",
+                          tag_names[tag], live / 1024.0,
+                          usage.peak.load(std::memory_order_relaxed) / 1024.0, made,
+                          (made - last_allocations[tag]) / seconds,
+                          (bytes - last_allocated[tag]) / 1024.0 / seconds);
+            lines.push_back(line);
+            total_live += live;
+            last_allocations[tag] = made;
+            last_allocated[tag] = bytes;
+        }
+        std::snprintf(line, sizeof(line), "%-10s %10.1f", "total", total_live / 1024.0);
+        lines.push_back(line);
+        lines.push_back("");
+        std::snprintf(line, sizeof(line), "Rates are over the last %.1f seconds.", seconds);
+        lines.push_back(line);
+        return lines;
+    }
+
+} // namespace Allocations
+
+// The replacements of the global allocation functions.
+
+void *operator new(const std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new[](const std::size_t size)
+{
+    return allocate(size);
+}
+
+void *operator new(const std::size_t size, const std::nothrow_t &) noexcept
+{
+    return try_allocate(size);
+}
+
+void *operator new[](const std::size_t size, const std::nothrow_t &) noexcept
+{
+    return try_allocate(size);
+}
+
+void operator delete(void *const block) noexcept
+{
+    release(block);
+}
+
+void operator delete[](void *const block) noexcept
+{
+    release(block);
+}
+
+void operator delete(void *const block, std::size_t) noexcept
+{
+    release(block);
+}
+
+void operator delete[](void *const block, std::size_t) noexcept
+{
+    release(block);
+}
+
+void operator delete(void *const block, const std::nothrow_t &) noexcept
+{
+    release(block);
+}
+
+void operator delete[](void *const block, const std::nothrow_t &) noexcept
+{
+    release(block);
+}
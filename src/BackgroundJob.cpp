@@ -0,0 +1,254 @@
+/*! \file    BackgroundJob.cpp
+ *  \brief   Implementation of class BackgroundJob
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstddef>
+#include <utility>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <windows.h>
+#endif
+
+#include "BackgroundJob.hpp"
+
+namespace {
+    // The number of bytes read from the pipe at a time.
+    constexpr std::size_t read_size = 16 * 1024;
+} // namespace
+
+//! Prepares to run the given command. Nothing is started until start is called.
+BackgroundJob::BackgroundJob(std::string command)
+    : command_text(std::move(command)), active(false), exit_status(-1)
+{
+#if eOPSYS == ePOSIX
+    output_fd = -1;
+    process = -1;
+#elif eOPSYS == eWINDOWS
+    output_handle = nullptr;
+    process_handle = nullptr;
+#endif
+}
+
+//! Stops the command if it is still running.
+BackgroundJob::~BackgroundJob()
+{
+    stop();
+}
+
+//! Starts the command.
+/*!
+ * \return false if the command could not be started.
+ */
+bool BackgroundJob::start()
+{
+#if eOPSYS == ePOSIX
+    int ends[2];
+    if (pipe(ends) == -1)
+        return false;
+    fcntl(ends[0], F_SETFD, FD_CLOEXEC);
+    fcntl(ends[1], F_SETFD, FD_CLOEXEC);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, ends[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, ends[1], 2);
+
+    // The shell leads a new process group so that stop can reach everything it starts.
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    char shell[] = "/bin/sh";
+    char option[] = "-c";
+    char *const arguments[] = {shell, option, &command_text[0], nullptr};
+    pid_t child;
+    const int spawn_error =
+        posix_spawn(&child, shell, &actions, &attributes, arguments, environ);
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+    close(ends[1]);
+    if (spawn_error != 0) {
+        close(ends[0]);
+        return false;
+    }
+
+    fcntl(ends[0], F_SETFL, fcntl(ends[0], F_GETFL) | O_NONBLOCK);
+    output_fd = ends[0];
+    process = child;
+#elif eOPSYS == eWINDOWS
+    SECURITY_ATTRIBUTES attributes = {sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HANDLE output_read, output_write;
+    if (!CreatePipe(&output_read, &output_write, &attributes, 0))
+        return false;
+    SetHandleInformation(output_read, HANDLE_FLAG_INHERIT, 0);
+    HANDLE input = CreateFileA("NUL", GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               &attributes, OPEN_EXISTING, 0, nullptr);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = input;
+    startup.hStdOutput = output_write;
+    startup.hStdError = output_write;
+    PROCESS_INFORMATION information;
+    std::string command_line("cmd.exe /c ");
+    command_line.append(command_text);
+    const BOOL started =
+        CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+                       nullptr, nullptr, &startup, &information);
+    if (input != INVALID_HANDLE_VALUE)
+        CloseHandle(input);
+    CloseHandle(output_write);
+    if (!started) {
+        CloseHandle(output_read);
+        return false;
+    }
+    CloseHandle(information.hThread);
+    output_handle = output_read;
+    process_handle = information.hProcess;
+#endif
+
+    active = true;
+    return true;
+}
+
+//! Takes the complete lines the command has written since the last call, without waiting.
+/*!
+ * A final line without a newline is supplied (with one added) once the command finishes.
+ *
+ * \param text [out] The lines, each ending with '\n', are appended here.
+ * \return true if any text was appended.
+ */
+bool BackgroundJob::collect(std::string &text)
+{
+    if (!active)
+        return false;
+
+    const std::size_t old_size = text.size();
+    char buffer[read_size];
+#if eOPSYS == ePOSIX
+    while (output_fd != -1) {
+        const ssize_t count = read(output_fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            partial.append(buffer, static_cast<std::size_t>(count));
+        }
+        else if (count == -1 && errno == EINTR) {
+            continue;
+        }
+        else {
+            if (count == -1 && errno == EAGAIN)
+                break;
+            close(output_fd);
+            output_fd = -1;
+        }
+    }
+    const bool at_end = output_fd == -1;
+#elif eOPSYS == eWINDOWS
+    DWORD available;
+    DWORD count;
+    while (output_handle != nullptr) {
+        if (!PeekNamedPipe(output_handle, nullptr, 0, nullptr, &available, nullptr)) {
+            CloseHandle(output_handle);
+            output_handle = nullptr;
+        }
+        else if (available == 0) {
+            break;
+        }
+        else if (ReadFile(output_handle, buffer,
+                          available < sizeof(buffer) ? available : sizeof(buffer), &count,
+                          nullptr)) {
+            partial.append(buffer, count);
+        }
+    }
+    const bool at_end = output_handle == nullptr;
+#endif
+
+    // Hand over the complete lines and keep the rest for later.
+    const std::size_t last_newline = partial.rfind('\n');
+    if (last_newline != std::string::npos) {
+        text.append(partial, 0, last_newline + 1);
+        partial.erase(0, last_newline + 1);
+    }
+    if (at_end && finished()) {
+        if (!partial.empty()) {
+            text.append(partial);
+            text.push_back('\n');
+            partial.clear();
+        }
+        active = false;
+    }
+    return text.size() != old_size;
+}
+
+//! Stops the command (and any programs it started) if it is still running.
+void BackgroundJob::stop()
+{
+#if eOPSYS == ePOSIX
+    if (output_fd != -1) {
+        close(output_fd);
+        output_fd = -1;
+    }
+    if (process != -1) {
+        kill(-process, SIGKILL);
+        int child_status;
+        while (waitpid(process, &child_status, 0) == -1 && errno == EINTR) {
+        }
+        process = -1;
+    }
+#elif eOPSYS == eWINDOWS
+    if (output_handle != nullptr) {
+        CloseHandle(output_handle);
+        output_handle = nullptr;
+    }
+    if (process_handle != nullptr) {
+        TerminateProcess(process_handle, 1);
+        CloseHandle(process_handle);
+        process_handle = nullptr;
+    }
+#endif
+    active = false;
+}
+
+//! Returns true (and records the exit status) if the command's process has ended.
+bool BackgroundJob::finished()
+{
+#if eOPSYS == ePOSIX
+    if (process == -1)
+        return true;
+    int child_status;
+    const pid_t result = waitpid(process, &child_status, WNOHANG);
+    if (result == 0)
+        return false;
+    if (result == process && WIFEXITED(child_status))
+        exit_status = WEXITSTATUS(child_status);
+    process = -1;
+    return true;
+#elif eOPSYS == eWINDOWS
+    if (process_handle == nullptr)
+        return true;
+    DWORD child_status;
+    if (WaitForSingleObject(process_handle, 0) == WAIT_TIMEOUT)
+        return false;
+    if (GetExitCodeProcess(process_handle, &child_status))
+        exit_status = static_cast<int>(child_status);
+    CloseHandle(process_handle);
+    process_handle = nullptr;
+    return true;
+#endif
+}
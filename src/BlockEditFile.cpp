@@ -9,15 +9,54 @@
  * deallocation and reallocation of the EditList nodes.
  *
  * The current version of insert_block() leaves its parameter alone. If the function was able to
- * remove lines from the parameter the copying of the EditBuffers would not be necessary.
+ * remove lines from the parameter the copying of the EditBuffers would not be necessary. Since
+ * the copies share the text of the lines, copying them is fairly cheap anyway.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "BlockEditFile.hpp"
 #include "EditBuffer.hpp"
+#include "TaskPool.hpp"
 #include "support.hpp"
 
+namespace {
+    constexpr long transform_batch = 16384; // Lines transformed before any are replaced.
+    constexpr long minimum_share = 2048;    // The fewest lines worth a thread of their own.
+
+    //! The lines of a batch and what the transforms made of them.
+    struct TransformBatch {
+        std::vector<std::unique_ptr<EditBuffer>> lines;
+        std::vector<std::string> results;
+        std::vector<char> changed;
+    };
+
+    //! Transforms the lines of a batch, taking a share at a time, until none are left.
+    void transform_all(TransformBatch &batch, const std::vector<LineTransform::Kind> &pipeline,
+                       const unsigned tab, std::atomic<std::size_t> &next)
+    {
+        const std::size_t count = batch.lines.size();
+        for (;;) {
+            const std::size_t first = next.fetch_add(minimum_share);
+            if (first >= count)
+                return;
+            const std::size_t last = std::min(first + minimum_share, count);
+            for (std::size_t i = first; i < last; ++i) {
+                batch.changed[i] = LineTransform::apply(pipeline, batch.lines[i]->view(), tab,
+                                                        batch.results[i]);
+            }
+        }
+    }
+} // namespace
+
 /*=====================================================================*/
 /*           Public Member Functions of Class Block_EditFile           */
 /*=====================================================================*/
@@ -26,7 +65,9 @@ void BlockEditFile::get_blockinfo(BlockInfo &result)
 {
     result.is_on = block;
     if (block) {
-        result.anchor = anchor;
+        result.columns = columns;
+        result.anchor = anchor_line();
+        result.anchor_column = anchor_column;
         result.limit = current_point;
     }
 }
@@ -35,7 +76,9 @@ void BlockEditFile::set_blockinfo(const BlockInfo &desired)
 {
     if (desired.is_on) {
         block = true;
-        anchor = desired.anchor;
+        columns = desired.columns;
+        set_anchor(desired.anchor);
+        anchor_column = desired.anchor_column;
         current_point = desired.limit;
     }
 }
@@ -48,8 +91,23 @@ void BlockEditFile::set_blockinfo(const BlockInfo &desired)
 void BlockEditFile::toggle_block()
 {
     block = !block;
+    columns = false;
     if (block)
-        anchor = current_point.cursor_line();
+        set_anchor(current_point.cursor_line());
+}
+
+//! Change the block mode status, making a new block rectangular.
+/*!
+ * This function is like toggle_block() except that the block also spans the columns from the
+ * current column to the cursor column.
+ */
+void BlockEditFile::toggle_column_block()
+{
+    toggle_block();
+    if (block) {
+        columns = true;
+        anchor_column = current_point.cursor_column();
+    }
 }
 
 //! Copy the current block to a temporary storage area.
@@ -108,25 +166,22 @@ bool BlockEditFile::get_block(EditList &result)
  */
 void BlockEditFile::delete_block()
 {
-    long top, current, bottom; // Block limits and current line number.
+    long top, bottom; // Block limits.
 
     // Get the current block extent.
     block_limits(top, bottom);
 
     // Deleting a real lines will mark the object as changed.
-    if (top < file_data.size())
+    if (top < file_data.size()) {
         is_changed = true;
+        mark_damaged_from(top);
+        record_lines(top, bottom - top + 1);
+    }
 
-    // Position the data to the top line.
+    // Position the data to the top line and take out the block's lines (as many as exist).
     file_data.jump_to(top);
-
-    // For each line in the block trash that line. Stop if we go off the end.
-    for (current = top; current <= bottom; current++) {
-        if (file_data.get() == nullptr)
-            break;
-        delete file_data.get();
-        file_data.erase();
-    }
+    EditList removed;
+    file_data.splice_out(bottom - top + 1, removed);
 
     // Make sure the current point is at the line number of the block's top.
     current_point.jump_to_line(top);
@@ -153,8 +208,10 @@ bool BlockEditFile::insert_block(EditList &new_stuff)
     EditBuffer *line;   // Points at a line in the block.
 
     // Insertions always change this object if there's something coming in.
-    if (new_stuff.size() > 0L)
+    if (new_stuff.size() > 0L) {
         is_changed = true;
+        mark_damaged_from(current_point.cursor_line());
+    }
 
     // Rewind the incoming list so that we get it all.
     new_stuff.jump_to(0);
@@ -162,16 +219,17 @@ bool BlockEditFile::insert_block(EditList &new_stuff)
     // Adjust the internal list. Make sure the current line exists.
     if (!extend_to_line(current_point.cursor_line()))
         return false;
+    record_lines(current_point.cursor_line(), 0L);
     file_data.jump_to(current_point.cursor_line());
 
-    // While there are still lines in the parameter.
+    // Copy the lines of the parameter (their text is shared, not copied) and splice them in.
+    EditList copies;
     while (!abort && (line = new_stuff.next()) != nullptr) {
-
-        // Build a new copy of the line and stuff it into this object.
         EditBuffer *new_copy = new EditBuffer(*line);
-        if (file_data.insert(new_copy) == nullptr)
+        if (copies.insert(new_copy) == nullptr)
             abort = true;
     }
+    file_data.splice_in(copies);
 
     if (abort) {
         memory_message("Can't insert entire block into file");
@@ -183,3 +241,233 @@ bool BlockEditFile::insert_block(EditList &new_stuff)
 
     return !abort;
 }
+
+//! Copy the columns of the current block to a temporary storage area.
+/*!
+ * Each line of the block contributes the text in the block's columns, padded with spaces to
+ * the full width of the block. Lines off the end of the file contribute only spaces. This
+ * function does not turn block mode off; the caller must do so. Without a rectangular block
+ * the cursor column of the current line is copied.
+ *
+ * \param result [in-out] The edit list that will receive the pieces of the lines. The pieces
+ * are inserted at the list's current point.
+ */
+void BlockEditFile::get_columns(EditList &result)
+{
+    long top, bottom;
+    unsigned left, right;
+    block_limits(top, bottom);
+    column_limits(left, right);
+
+    const EditBuffer blank;
+    file_data.jump_to(top);
+    for (long line_number = top; line_number <= bottom; ++line_number) {
+        const EditBuffer *line = file_data.next();
+        if (line == nullptr)
+            line = &blank;
+        const std::size_t start = line->offset_of(left, tab_stop);
+        const std::size_t stop = line->offset_of(right, tab_stop);
+        result.insert(new EditBuffer(line->subbuffer(start, stop)));
+    }
+}
+
+//! Delete the columns of the current block.
+/*!
+ * The text to the right of the block on each line moves left. Lines that end before the
+ * block's columns are not changed.
+ */
+void BlockEditFile::delete_columns()
+{
+    long top, bottom;
+    unsigned left, right;
+    block_limits(top, bottom);
+    column_limits(left, right);
+
+    mark_damaged(top, bottom);
+    file_data.jump_to(top);
+    for (long line_number = top; line_number <= bottom; ++line_number) {
+        EditBuffer *const line = file_data.next();
+        if (line == nullptr)
+            break;
+        const std::size_t start = line->offset_of(left, tab_stop);
+        const std::size_t end = line->offset_of(right, tab_stop);
+        const std::string_view text = line->view();
+        if (text.size() <= start)
+            continue;
+
+        is_changed = true;
+        record_text(line_number, start, text.size(), text.substr(start, end - start), "");
+        line->splice(start, end - start, "");
+    }
+    current_point.jump_to_column(left);
+}
+
+//! Insert the lines of the parameter as columns at the current point.
+/*!
+ * Each line of the parameter is inserted at the cursor column of successive lines, starting
+ * with the current line. The file is extended as necessary. Where a line has text after the
+ * cursor column the whole piece is inserted so that the text moves right by the width of the
+ * block. Elsewhere the trailing spaces of the piece are left implicit. The current point is not
+ * moved.
+ *
+ * \param new_stuff The pieces to insert.
+ */
+void BlockEditFile::insert_columns(EditList &new_stuff)
+{
+    const long count = new_stuff.size();
+    if (count == 0)
+        return;
+
+    const long top = current_point.cursor_line();
+    const unsigned column = current_point.cursor_column();
+    extend_to_line(top + count - 1);
+    mark_damaged(top, top + count - 1);
+
+    new_stuff.jump_to(0);
+    file_data.jump_to(top);
+    for (long line_number = top; line_number < top + count; ++line_number) {
+        const EditBuffer *const source = new_stuff.next();
+        EditBuffer *const line = file_data.next();
+        const std::size_t offset = line->offset_of(column, tab_stop);
+        const std::string_view text = line->view();
+
+        std::string_view inserted = source->view();
+        if (text.size() <= offset)
+            inserted = inserted.substr(0, inserted.find_last_not_of(' ') + 1);
+        if (inserted.empty())
+            continue;
+
+        is_changed = true;
+        record_text(line_number, offset, text.size(), "", inserted);
+        line->splice(offset, 0, inserted);
+    }
+}
+
+//! Sorts, reverses, or removes duplicates from the lines of the block or of the whole file.
+/*!
+ * The lines are arranged as copies, which share their text (see EditBuffer), and these
+ * replace the old lines with a single splice. Undo restores the old lines.
+ *
+ * \return false if there is insufficient memory. The file is then unchanged.
+ */
+bool BlockEditFile::arrange_lines(const LineSort::Options &options)
+{
+    long top = 0;
+    long bottom = file_data.size() - 1;
+    if (block)
+        block_limits(top, bottom);
+    bottom = std::min(bottom, file_data.size() - 1);
+    if (top > bottom)
+        return true;
+    const long count = bottom - top + 1;
+
+    EditList new_lines;
+    try {
+        std::vector<std::unique_ptr<EditBuffer>> lines;
+        lines.reserve(static_cast<std::size_t>(count));
+        file_data.jump_to(top);
+        for (long i = 0; i < count; ++i) {
+            lines.emplace_back(new EditBuffer(*file_data.next()));
+        }
+        LineSort::arrange(lines, options);
+        for (std::unique_ptr<EditBuffer> &line : lines) {
+            new_lines.insert(line.get());
+            line.release();
+        }
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't arrange the lines");
+        return false;
+    }
+
+    is_changed = true;
+    if (new_lines.size() == count)
+        mark_damaged(top, bottom);
+    else
+        mark_damaged_from(top);
+    record_lines(top, count);
+
+    EditList old_lines;
+    file_data.jump_to(top);
+    file_data.splice_out(count, old_lines);
+    file_data.splice_in(new_lines);
+    return true;
+}
+
+//! Applies transforms to the lines of the block or of the whole file.
+/*!
+ * The lines are transformed a batch at a time, by several threads if the batch is large. Only
+ * the lines that change are replaced, a run of consecutive lines at a time, so the undo log
+ * holds just those lines.
+ *
+ * \param changed [out] The number of lines changed.
+ * \return false if there is insufficient memory. The lines already replaced stay replaced.
+ */
+bool BlockEditFile::transform_lines(const std::vector<LineTransform::Kind> &pipeline,
+                                    const unsigned tab, long &changed)
+{
+    changed = 0;
+    long top = 0;
+    long bottom = file_data.size() - 1;
+    if (block)
+        block_limits(top, bottom);
+    bottom = std::min(bottom, file_data.size() - 1);
+
+    try {
+        for (long start = top; start <= bottom; start += transform_batch) {
+            const long count = std::min(transform_batch, bottom - start + 1);
+
+            // The lines are copied (sharing their text) so they stay put while the threads
+            // work, even if file_data compresses the chunks holding them.
+            TransformBatch batch;
+            batch.lines.reserve(static_cast<std::size_t>(count));
+            file_data.jump_to(start);
+            for (long i = 0; i < count; ++i) {
+                batch.lines.emplace_back(new EditBuffer(*file_data.next()));
+            }
+            batch.results.resize(batch.lines.size());
+            batch.changed.resize(batch.lines.size());
+
+            std::atomic<std::size_t> next(0);
+            TaskPool::Group workers;
+            const std::size_t hardware = TaskPool::size();
+            const std::size_t shares = static_cast<std::size_t>(count / minimum_share);
+            const std::size_t threads = std::min(hardware, shares);
+            for (std::size_t i = 1; i < threads; ++i) {
+                workers.run([&]() { transform_all(batch, pipeline, tab, next); });
+            }
+            transform_all(batch, pipeline, tab, next);
+            workers.wait();
+
+            // Replace each run of changed lines with one splice.
+            for (long i = 0; i < count;) {
+                if (!batch.changed[i]) {
+                    ++i;
+                    continue;
+                }
+                long end = i;
+                EditList new_lines;
+                for (; end < count && batch.changed[end]; ++end) {
+                    const std::string &text = batch.results[end];
+                    new_lines.insert(new EditBuffer(text.data(), text.size()));
+                }
+                const long first = start + i;
+                is_changed = true;
+                mark_damaged(first, start + end - 1);
+                record_lines(first, end - i);
+
+                EditList old_lines;
+                file_data.jump_to(first);
+                file_data.splice_out(end - i, old_lines);
+                file_data.splice_in(new_lines);
+                changed += end - i;
+                i = end;
+            }
+        }
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't transform all the lines");
+        return false;
+    }
+    return true;
+}
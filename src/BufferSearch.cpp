@@ -0,0 +1,96 @@
+/*! \file    BufferSearch.cpp
+ *  \brief   Implementation of class BufferSearch.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "BufferSearch.hpp"
+#include "Trace.hpp"
+
+namespace {
+    // Hits are handed over to the queue in batches to keep lock traffic down.
+    constexpr std::size_t batch_size = 64;
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Searches snapshots until none are left. Runs as a task.
+void BufferSearch::work(SearchPattern pattern)
+{
+    std::vector<Hit> batch;
+    std::size_t index;
+
+    while (!cancelled && (index = next_file++) < snapshots.size()) {
+        Trace::Span span("search buffer");
+        const TextSnapshot &snapshot = snapshots[index];
+        const long line_count = snapshot.lines->size();
+
+        for (long line_number = 0; line_number < line_count && !cancelled; ++line_number) {
+            const std::size_t found = pattern.find(line(index, line_number));
+            if (found == SearchPattern::npos)
+                continue;
+            batch.push_back(Hit{index, line_number, static_cast<unsigned>(found)});
+            if (batch.size() >= batch_size) {
+                std::lock_guard<std::mutex> guard(queue_lock);
+                queue.insert(queue.end(), batch.begin(), batch.end());
+                batch.clear();
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> guard(queue_lock);
+    queue.insert(queue.end(), batch.begin(), batch.end());
+    --running;
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Starts searching the given snapshots for the pattern.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+BufferSearch::BufferSearch(const SearchPattern &pattern, std::vector<TextSnapshot> &&files)
+    : snapshots(std::move(files)), workers(TaskPool::INTERACTIVE), next_file(0),
+      cancelled(false), running(0)
+{
+    const std::size_t count =
+        std::max<std::size_t>(1, std::min<std::size_t>(TaskPool::size(), snapshots.size()));
+
+    running = static_cast<unsigned>(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        workers.run([this, pattern]() { work(pattern); });
+    }
+}
+
+//! Stops the search and waits for the tasks to finish.
+BufferSearch::~BufferSearch()
+{
+    cancelled = true;
+    workers.wait();
+}
+
+//! Returns the text of a line, without its newline character.
+std::string_view BufferSearch::line(const std::size_t index, const long line_number) const
+{
+    return snapshots[index].lines->line(line_number);
+}
+
+//! Moves the hits found since the last call onto the end of the given vector.
+/*!
+ * Hits from one file are in order, but the hits of different files may be interleaved.
+ *
+ * \return false if the search is over. The hits moved by that call are the last ones.
+ */
+bool BufferSearch::collect(std::vector<Hit> &hits)
+{
+    std::lock_guard<std::mutex> guard(queue_lock);
+    hits.insert(hits.end(), queue.begin(), queue.end());
+    queue.clear();
+    return running != 0;
+}
@@ -3,12 +3,233 @@
  *  \author  Peter C. Chapin <spicacalitkelseymountain.org>
  */
 
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "CharacterEditFile.hpp"
 #include "EditBuffer.hpp"
+#include "Utf8.hpp"
 #include "support.hpp"
 
+//! Closes the gap in the previously edited line if the cursor has moved to a different line.
+/*!
+ * Long lines are edited with a gap at the cursor (see EditBuffer). Once the cursor leaves such
+ * a line the gap serves no purpose so the line is made contiguous again. Only the line number
+ * is remembered; if lines have been inserted or deleted in the meantime a different line might
+ * be compacted, which is harmless.
+ */
+void CharacterEditFile::settle_edited_line()
+{
+    const long line = current_point.cursor_line();
+    if (edited_line != line && edited_line >= 0) {
+        file_data.jump_to(edited_line);
+        if (file_data.get() != nullptr)
+            file_data.get()->compact();
+    }
+    edited_line = line;
+}
+
+//! Does a character manipulation at the current point and at every caret.
+/*!
+ * The cursors are visited in order. All the cursors on a line are handled together, so each
+ * line is rewritten (and recorded for undo) once. Carets move past the text they insert or
+ * delete. The current point is left where the single cursor version of the manipulation would
+ * leave it, adjusted for the text inserted or deleted before it by other cursors on its line.
+ * The commands move it further as usual. Backspacing at column zero does nothing at a caret.
+ *
+ * The cursors are located in the original text of their line and followed through the edits
+ * as byte offsets. Their columns are found again in the new text, since the edits before them
+ * may have changed the width of tabs.
+ *
+ * \param edit The manipulation to do.
+ * \param letter The character inserted or replaced, if any.
+ * \return false if the manipulation fails (out of memory?); true otherwise.
+ */
+bool CharacterEditFile::edit_carets(const CaretEdit edit, const char letter)
+{
+    settle_edited_line();
+
+    // The current point takes part as one more cursor. It might be on a caret.
+    const Caret primary{current_point.cursor_line(), current_point.cursor_column()};
+    std::vector<Caret> cursors;
+    cursors.reserve(carets.size() + 1);
+    cursors.insert(cursors.end(), carets.begin(), carets.end());
+    cursors.insert(std::upper_bound(cursors.begin(), cursors.end(), primary), primary);
+    cursors.erase(std::unique(cursors.begin(), cursors.end()), cursors.end());
+
+    // Only the current point can be past the end of the file.
+    extend_to_line(cursors.back().line);
+    is_changed = true;
+    mark_damaged(cursors.front().line, cursors.back().line);
+
+    std::vector<Caret> moved;
+    moved.reserve(cursors.size());
+    unsigned primary_column = primary.column;
+    std::string text;
+    std::vector<std::size_t> offsets; // Where the cursors on a line are left.
+
+    // A continuation byte joins the character before it (see insert_char).
+    const bool continuation = Utf8::is_continuation(letter);
+
+    for (std::size_t i = 0; i < cursors.size();) {
+        const long line_number = cursors[i].line;
+        file_data.jump_to(line_number);
+        EditBuffer *const line = file_data.get();
+        const std::string_view old_text = line->view();
+        text.assign(old_text.data(), old_text.size());
+
+        // Later cursors on the line shift by the bytes inserted or deleted before them. Bytes
+        // added to pad the line don't count since they stand for the spaces already there.
+        const std::size_t first = i;
+        offsets.clear();
+        std::ptrdiff_t shift = 0;
+        for (; i < cursors.size() && cursors[i].line == line_number; ++i) {
+            const unsigned column = cursors[i].column;
+            const bool is_primary = (cursors[i] == primary);
+            std::size_t offset = line->offset_of(column, tab_stop) + shift;
+            std::size_t count;
+            switch (edit) {
+            case CARET_INSERT:
+                if (offset > text.size())
+                    text.resize(offset, ' ');
+                text.insert(offset, 1, letter);
+                ++shift;
+                if (!is_primary || continuation)
+                    ++offset;
+                break;
+            case CARET_REPLACE:
+                if (offset >= text.size())
+                    text.resize(offset + 1, ' ');
+                count = Utf8::next(text, offset) - offset;
+                text.replace(offset, count, 1, letter);
+                shift += 1 - static_cast<std::ptrdiff_t>(count);
+                if (!is_primary)
+                    ++offset;
+                break;
+            case CARET_BACKSPACE:
+                if (column == 0)
+                    break;
+                offset = line->offset_of(column - 1, tab_stop) + shift;
+                if (offset < text.size()) {
+                    count = Utf8::next(text, offset) - offset;
+                    text.erase(offset, count);
+                    shift -= static_cast<std::ptrdiff_t>(count);
+                }
+                break;
+            case CARET_DELETE:
+                if (offset < text.size()) {
+                    count = Utf8::next(text, offset) - offset;
+                    text.erase(offset, count);
+                    shift -= static_cast<std::ptrdiff_t>(count);
+                }
+                break;
+            }
+            offsets.push_back(offset);
+        }
+
+        // Record only the part of the line that changed.
+        std::size_t prefix = 0;
+        const std::size_t shorter = std::min(old_text.size(), text.size());
+        while (prefix < shorter && old_text[prefix] == text[prefix])
+            ++prefix;
+        std::size_t suffix = 0;
+        while (suffix < shorter - prefix &&
+               old_text[old_text.size() - suffix - 1] == text[text.size() - suffix - 1])
+            ++suffix;
+        if (prefix != old_text.size() || prefix != text.size()) {
+            record_text(line_number, prefix, old_text.size(),
+                        old_text.substr(prefix, old_text.size() - prefix - suffix),
+                        std::string_view(text).substr(prefix, text.size() - prefix - suffix));
+            *line = EditBuffer(text.data(), text.size());
+        }
+
+        for (std::size_t j = first; j < i; ++j) {
+            const unsigned column =
+                static_cast<unsigned>(line->column_of(offsets[j - first], tab_stop));
+            if (cursors[j] == primary)
+                primary_column = column;
+            else
+                moved.push_back(Caret{line_number, column});
+        }
+    }
+
+    carets.swap(moved);
+    current_point.jump_to_column(primary_column);
+    return true;
+}
+
+//! Adds a caret at the current point, or removes the caret that is there.
+/*!
+ * If the current point is past the end of the file the file is first extended to include it.
+ *
+ * \return true if a caret was added; false if one was removed.
+ */
+bool CharacterEditFile::toggle_caret()
+{
+    const Caret here{current_point.cursor_line(), current_point.cursor_column()};
+    auto position = std::lower_bound(carets.begin(), carets.end(), here);
+    if (position != carets.end() && *position == here) {
+        carets.erase(position);
+        mark_damaged(here.line, here.line);
+        return false;
+    }
+
+    // Extending the file forgets no carets since they are all on existing lines.
+    extend_to_line(here.line);
+    position = std::lower_bound(carets.begin(), carets.end(), here);
+    carets.insert(position, here);
+    mark_damaged(here.line, here.line);
+    return true;
+}
+
+//! Removes all the carets.
+void CharacterEditFile::clear_carets()
+{
+    if (carets.empty())
+        return;
+    mark_damaged(carets.front().line, carets.back().line);
+    carets.clear();
+}
+
+//! Replaces the block with a caret on each of its lines at the cursor column.
+/*!
+ * The block is turned off. Together with the current point the carets form a column of
+ * cursors.
+ *
+ * \return false if block mode is not on.
+ */
+bool CharacterEditFile::column_carets()
+{
+    if (!get_block_state())
+        return false;
+
+    long top, bottom;
+    block_limits(top, bottom);
+    extend_to_line(bottom);
+    set_block_state(false);
+    mark_damaged(top, bottom);
+
+    const unsigned column = current_point.cursor_column();
+    std::vector<Caret> column_of;
+    for (long line = top; line <= bottom; ++line) {
+        if (line != current_point.cursor_line())
+            column_of.push_back(Caret{line, column});
+    }
+    std::vector<Caret> merged;
+    merged.reserve(carets.size() + column_of.size());
+    std::merge(carets.begin(), carets.end(), column_of.begin(), column_of.end(),
+               std::back_inserter(merged));
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    carets.swap(merged);
+    return true;
+}
+
 //! Toggles the insert/replace mode.
 void CharacterEditFile::toggle_insert()
 {
@@ -46,9 +267,14 @@ bool CharacterEditFile::new_line()
         return true;
 
     is_changed = true;
+    mark_damaged_from(current_point.cursor_line());
+    record_lines(current_point.cursor_line(), 1L);
+    file_data.jump_to(current_point.cursor_line());
 
     // See if cursor is off the end of the line.
-    if (file_data.get()->length() < current_point.cursor_column()) {
+    const std::size_t offset =
+        file_data.get()->offset_of(current_point.cursor_column(), tab_stop);
+    if (file_data.get()->length() < offset) {
 
         // If so, just insert a blank line after the current line.
         EditBuffer *blank = new EditBuffer("");
@@ -61,8 +287,8 @@ bool CharacterEditFile::new_line()
     else {
         // Otherwise, transfer text to next line.
         EditBuffer *current_buffer = file_data.get();
-        EditBuffer *new_stuff = new EditBuffer(
-            current_buffer->subbuffer(current_point.cursor_column(), current_buffer->length()));
+        EditBuffer *new_stuff =
+            new EditBuffer(current_buffer->subbuffer(offset, current_buffer->length()));
         file_data.next();
         if (new_stuff == nullptr)
             return_value = false;
@@ -73,7 +299,7 @@ bool CharacterEditFile::new_line()
 
             // Now, delete the text on the old line only if the above worked.
             if (return_value != false) {
-                file_data.get()->trim(current_point.cursor_column());
+                file_data.get()->trim(offset);
             }
         }
     }
@@ -87,8 +313,13 @@ bool CharacterEditFile::new_line()
 //! Insert a single character.
 /*!
  * This function inserts a character into the object at the current point. If block mode is on,
- * this function will do the insertion on every line in the block. The current point is not
- * moved. The function returns false if it runs out of memory.
+ * this function will do the insertion on every line in the block. Otherwise it is also done at
+ * every caret. The current point is not moved. The function returns false if it runs out of
+ * memory.
+ *
+ * A multi-byte character is inserted one byte at a time. Its continuation bytes are inserted
+ * into the character before the current point, which is where its first byte went, so that the
+ * caller should only move the current point after inserting the first byte.
  *
  * \bug is_changed is adjusted before the object knows that it won't have memory problems.
  *
@@ -97,6 +328,10 @@ bool CharacterEditFile::new_line()
  */
 bool CharacterEditFile::insert_char(char letter)
 {
+    if (!carets.empty() && !get_block_state())
+        return edit_carets(CARET_INSERT, letter);
+    settle_edited_line();
+
     bool return_value = true;
 
     // Make changes.
@@ -105,13 +340,17 @@ bool CharacterEditFile::insert_char(char letter)
     // Set list to top of block (block may be one line).
     long top, Bottom;
     block_limits(top, Bottom);
+    mark_damaged(top, Bottom);
 
     if (!top_of_block())
         return false;
 
     // Loop over all lines in the block, inserting as we go.
     while (top++ <= Bottom && return_value == true) {
-        file_data.get()->insert(letter, current_point.cursor_column());
+        EditBuffer *const line = file_data.get();
+        const std::size_t offset = line->offset_of(current_point.cursor_column(), tab_stop);
+        record_text(top - 1, offset, line->length(), "", std::string_view(&letter, 1));
+        line->insert(letter, offset);
         file_data.next();
     }
 
@@ -121,6 +360,85 @@ bool CharacterEditFile::insert_char(char letter)
     return return_value;
 }
 
+//! Inserts text from outside the editor, such as a terminal paste, at the current point.
+/*!
+ * The text may hold many lines; CR, LF, and CR/LF all end a line. Tabs are expanded and null
+ * characters, which reading a file would drop, are dropped here too. The text is inserted in
+ * one operation (and undone as one) regardless of block mode, carets, or the insert mode. The
+ * current point is moved to the end of the inserted text.
+ *
+ * \param text The text to insert.
+ * \return false if the insertion fails (out of memory?); true otherwise.
+ */
+bool CharacterEditFile::paste_text(const std::string_view text)
+{
+    settle_edited_line();
+    const long line_number = current_point.cursor_line();
+    const std::size_t column = current_point.cursor_column();
+
+    try {
+        // Break the text into lines. Tabs on the first line are relative to the cursor.
+        std::vector<std::string> pieces(1);
+        std::size_t piece_column = column;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            const char ch = text[i];
+            if (ch == '\r' || ch == '\n') {
+                if (ch == '\r' && i + 1 < text.size() && text[i + 1] == '\n')
+                    ++i;
+                pieces.emplace_back();
+                piece_column = 0;
+            }
+            else if (ch != '\0') {
+                if (!Utf8::is_continuation(ch) || pieces.back().empty())
+                    piece_column = Utf8::advance(piece_column, ch, tab_stop);
+                pieces.back().push_back(ch);
+            }
+        }
+        if (pieces.size() == 1 && pieces.front().empty())
+            return true;
+
+        if (!extend_to_line(line_number))
+            return false;
+        is_changed = true;
+        file_data.jump_to(line_number);
+        EditBuffer *line = file_data.get();
+        const std::size_t offset = line->offset_of(column, tab_stop);
+
+        // Text without line breaks is a single splice of the current line.
+        if (pieces.size() == 1) {
+            mark_damaged(line_number, line_number);
+            record_text(line_number, offset, line->length(), "", pieces.front());
+            line->splice(offset, 0, pieces.front());
+            current_point.jump_to_column(static_cast<unsigned>(piece_column));
+            return true;
+        }
+
+        // Otherwise the current line is split around the new lines.
+        mark_damaged_from(line_number);
+        record_lines(line_number, 1L);
+        file_data.jump_to(line_number);
+        line = file_data.get();
+        if (offset < line->length()) {
+            const std::string_view tail = line->view().substr(offset);
+            pieces.back().append(tail.data(), tail.size());
+            line->trim(offset);
+        }
+        if (!pieces.front().empty())
+            line->splice(offset, 0, pieces.front());
+        file_data.next();
+        for (std::size_t i = 1; i < pieces.size(); ++i) {
+            file_data.insert(new EditBuffer(pieces[i].data(), pieces[i].size()));
+        }
+        current_point.jump_to_line(line_number + static_cast<long>(pieces.size()) - 1);
+        current_point.jump_to_column(static_cast<unsigned>(piece_column));
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't insert the pasted text into the file");
+        return false;
+    }
+    return true;
+}
+
 //! Replace a single character.
 /*!
  * This function replaces the current character in the object. If block mode is on, this
@@ -133,6 +451,10 @@ bool CharacterEditFile::insert_char(char letter)
  */
 bool CharacterEditFile::replace_char(char letter)
 {
+    if (!carets.empty() && !get_block_state())
+        return edit_carets(CARET_REPLACE, letter);
+    settle_edited_line();
+
     bool return_value = true;
     char new_letter;
 
@@ -142,6 +464,7 @@ bool CharacterEditFile::replace_char(char letter)
     // Set list to top of block (block may be one line).
     long top, bottom;
     block_limits(top, bottom);
+    mark_damaged(top, bottom);
 
     if (!top_of_block())
         return false;
@@ -149,7 +472,16 @@ bool CharacterEditFile::replace_char(char letter)
     // Loop over all lines in the block, inserting as we go.
     while (top++ <= bottom && return_value == true) {
         new_letter = letter;
-        file_data.get()->replace(new_letter, current_point.cursor_column());
+        EditBuffer *const line = file_data.get();
+        const std::size_t offset = line->offset_of(current_point.cursor_column(), tab_stop);
+        const std::string_view old_text = line->view();
+        const std::string_view old_letter =
+            offset < old_text.size()
+                ? old_text.substr(offset, Utf8::next(old_text, offset) - offset)
+                : std::string_view();
+        record_text(top - 1, offset, old_text.size(), old_letter,
+                    std::string_view(&new_letter, 1));
+        line->splice(offset, old_letter.size(), std::string_view(&new_letter, 1));
         file_data.next();
     }
 
@@ -163,12 +495,17 @@ bool CharacterEditFile::replace_char(char letter)
 /*!
  * This function deletes the character to the left of the current point. If block mode is on, a
  * character is deleted on every line. If the current point is at the beginning of a line, that
- * line is joined with the previous line (if there is one).
+ * line is joined with the previous line (if there is one). Otherwise the current point moves to
+ * where the deleted character started, which is more than one column to the left for a tab.
  *
  * \return false if the deletion fails (out of memory?); true otherwise.
  */
 bool CharacterEditFile::backspace()
 {
+    if (!carets.empty() && !get_block_state() && current_point.cursor_column() != 0)
+        return edit_carets(CARET_BACKSPACE, '\0');
+    settle_edited_line();
+
     // If we're at the start of a line and in block mode, do nothing.
     if (current_point.cursor_column() == 0 && get_block_state())
         return true;
@@ -181,11 +518,13 @@ bool CharacterEditFile::backspace()
         if (current_point.cursor_line() > 0) {
 
             // Synchronize list.
+            record_lines(current_point.cursor_line() - 1, 2L);
             file_data.jump_to(current_point.cursor_line());
 
             // Do the dirty deed.
             EditBuffer *current = file_data.get();
             if (current != nullptr) {
+                mark_damaged_from(current_point.cursor_line() - 1);
                 file_data.previous();
                 file_data.get()->append(*current);
                 file_data.next();
@@ -204,15 +543,29 @@ bool CharacterEditFile::backspace()
 
         if (top > file_data.size())
             return true;
+        mark_damaged(top, bottom);
 
         // Synchronize list.
         file_data.jump_to(top);
 
         // Loop over all lines in the block, backspacing as we go.
+        const unsigned column = current_point.cursor_column() - 1;
+        unsigned target = column;
         while (top++ <= bottom && file_data.get() != nullptr) {
-            file_data.get()->erase(current_point.cursor_column() - 1);
+            EditBuffer *const line = file_data.get();
+            const std::size_t offset = line->offset_of(column, tab_stop);
+            const std::string_view old_text = line->view();
+            if (offset < old_text.size()) {
+                if (top - 1 == current_point.cursor_line())
+                    target = static_cast<unsigned>(line->column_of(offset, tab_stop));
+                const std::size_t count = Utf8::next(old_text, offset) - offset;
+                record_text(top - 1, offset, old_text.size(), old_text.substr(offset, count),
+                            "");
+                line->splice(offset, count, "");
+            }
             file_data.next();
         }
+        current_point.jump_to_column(target);
     }
 
     return true;
@@ -228,21 +581,31 @@ bool CharacterEditFile::backspace()
  */
 bool CharacterEditFile::delete_char()
 {
-    bool return_value = true;
+    settle_edited_line();
 
-    is_changed = true;
+    bool return_value = true;
 
     // Get the goods about the current line.
     file_data.jump_to(current_point.cursor_line());
     EditBuffer *Current = file_data.get();
 
+    // Joining lines forgets the carets, so it is done only at the current point.
+    if (!carets.empty() && !get_block_state() &&
+        (Current == nullptr || current_point.cursor_column() < Current->columns(tab_stop)))
+        return edit_carets(CARET_DELETE, '\0');
+    is_changed = true;
+
     // If off the end of the line, try to join lines (only if not in block mode).
-    if (Current != nullptr && current_point.cursor_column() >= Current->length() &&
+    if (Current != nullptr && current_point.cursor_column() >= Current->columns(tab_stop) &&
         !get_block_state()) {
 
         // Extend the current line and append the next line.
+        mark_damaged_from(current_point.cursor_line());
+        record_lines(current_point.cursor_line(), 2L);
+        file_data.jump_to(current_point.cursor_line());
         char Space_Character = ' ';
-        Current->replace(Space_Character, current_point.cursor_column());
+        const std::size_t offset = Current->offset_of(current_point.cursor_column(), tab_stop);
+        Current->replace(Space_Character, offset);
         file_data.next();
         if (file_data.get() != nullptr && return_value != false) {
             Current->append(*file_data.get());
@@ -251,7 +614,7 @@ bool CharacterEditFile::delete_char()
         }
 
         // Delete extra character introduced in the replace action.
-        Current->erase(current_point.cursor_column());
+        Current->erase(offset);
     }
 
     // Otherwise try to do the delete for the whole block (or line).
@@ -263,14 +626,24 @@ bool CharacterEditFile::delete_char()
 
         if (top > file_data.size())
             return true;
+        mark_damaged(top, bottom);
 
         // Synchronize list.
         file_data.jump_to(top);
 
         // Loop over all lines in the block, deleting as we go.
         while (return_value == true && top++ <= bottom && file_data.get() != nullptr) {
-            return_value = static_cast<bool>(
-                file_data.get()->erase(current_point.cursor_column()) != '\0');
+            EditBuffer *const line = file_data.get();
+            const std::size_t offset = line->offset_of(current_point.cursor_column(), tab_stop);
+            const std::string_view old_text = line->view();
+            if (offset < old_text.size()) {
+                const std::size_t count = Utf8::next(old_text, offset) - offset;
+                record_text(top - 1, offset, old_text.size(), old_text.substr(offset, count),
+                            "");
+                line->splice(offset, count, "");
+            }
+            else
+                return_value = false;
             file_data.next();
         }
     }
@@ -0,0 +1,223 @@
+/*! \file    Completion.cpp
+ *  \brief   Implementation of the Completion abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Completion.hpp"
+#include "DiskEditFile.hpp"
+#include "EditBuffer.hpp"
+#include "FileList.hpp"
+#include "YEditFile.hpp"
+
+#define MIN_WORD_LENGTH 3          // Shorter words are not worth completing.
+#define MAX_WORD_LENGTH 64         // Longer words are not indexed.
+#define INDEX_STEP 2048            // Lines indexed by each call of update.
+#define MAX_INDEXED_LINES 500000   // Larger files are not indexed.
+#define PROXIMITY_LINES 100        // Words within this many lines of the cursor rank higher.
+#define PROXIMITY_WEIGHT 4         // The points for each line closer than PROXIMITY_LINES.
+#define MAX_CANDIDATES 50          // The most words returned by candidates.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! The number of times each word appears in the open files.
+    typedef std::map<std::string, long, std::less<>> WordCounts;
+
+    //! The words on each line of a file, and the lines not yet indexed.
+    /*!
+     * The lines [first, lines.size() - tail) have not been indexed since they were modified.
+     * They now correspond to the lines [first, line_count() - tail) of the file.
+     */
+    struct Index {
+        std::vector<std::vector<WordCounts::iterator>> lines;
+        long first = 0; //!< -1 if every line is indexed.
+        long tail = 0;
+    };
+
+    WordCounts words;
+    std::unordered_map<const YEditFile *, Index> indices;
+
+    //! Appends the words on a line to list, counting them.
+    void add_words(std::string_view text, std::vector<WordCounts::iterator> &list)
+    {
+        std::size_t offset = 0;
+        while (offset < text.size()) {
+            if (!Completion::is_word_character(text[offset])) {
+                ++offset;
+                continue;
+            }
+            const std::size_t start = offset;
+            while (offset < text.size() && Completion::is_word_character(text[offset]))
+                ++offset;
+            const std::size_t length = offset - start;
+            if (length < MIN_WORD_LENGTH || length > MAX_WORD_LENGTH ||
+                std::isdigit(static_cast<unsigned char>(text[start])))
+                continue;
+
+            const std::string_view word = text.substr(start, length);
+            WordCounts::iterator entry = words.find(word);
+            if (entry == words.end())
+                entry = words.emplace(std::string(word), 0L).first;
+            ++entry->second;
+            list.push_back(entry);
+        }
+    }
+
+    //! Uncounts the words on a line, forgetting those that no longer appear anywhere.
+    void remove_words(const std::vector<WordCounts::iterator> &list)
+    {
+        for (const WordCounts::iterator entry : list) {
+            if (--entry->second == 0)
+                words.erase(entry);
+        }
+    }
+
+    //! Indexes up to budget lines of a file. Returns the number of lines examined.
+    long index_file(YEditFile &file, Index &index, long budget)
+    {
+        const EditDelta change = file.take_word_edits();
+        if (!change.empty()) {
+            const long tail = file.line_count() - change.first - change.new_count;
+            index.tail = (index.first < 0L) ? tail : std::min(index.tail, tail);
+            index.first =
+                (index.first < 0L) ? change.first : std::min(index.first, change.first);
+        }
+        if (index.first < 0L)
+            return 0L;
+
+        // The old lines are replaced by new ones a few at a time, so the pending range stays
+        // valid if the file is modified before the work is done.
+        const long old_size = static_cast<long>(index.lines.size());
+        const long size = file.line_count();
+        index.first = std::min(index.first, old_size);
+        const long old_count = std::max(old_size - index.tail - index.first, 0L);
+        const long new_count = std::max(size - index.tail - index.first, 0L);
+        const long added = std::min(new_count, budget);
+        const long removed = (added == new_count) ? old_count : std::min(old_count, added);
+
+        auto position = index.lines.begin() + index.first;
+        std::for_each(position, position + removed, remove_words);
+        position = index.lines.erase(position, position + removed);
+        position = index.lines.insert(position, static_cast<std::size_t>(added), {});
+        for (long i = 0; i < added; ++i, ++position) {
+            const EditBuffer *const text = file.line_at(index.first + i);
+            if (text != nullptr)
+                add_words(text->view(), *position);
+        }
+
+        index.first += added;
+        if (added == new_count)
+            index.first = -1L;
+        return std::max(added, 1L);
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Completion {
+
+    bool update()
+    {
+        // Files still being read in the background are left alone since examining them would
+        // wait for the read.
+        if (DiskEditFile::background_loads() != 0)
+            return false;
+
+        long budget = INDEX_STEP;
+        for (unsigned i = 0; i < FileList::count() && budget > 0; ++i) {
+            YEditFile &file = *FileList::file(i);
+            auto found = indices.find(&file);
+            if (found == indices.end()) {
+                if (file.line_count() > MAX_INDEXED_LINES)
+                    continue;
+                found = indices.emplace(&file, Index()).first;
+            }
+            budget -= index_file(file, found->second, budget);
+        }
+        return budget <= 0;
+    }
+
+    std::vector<std::string> candidates(YEditFile &file, const long line,
+                                        const std::string_view prefix)
+    {
+        // The lines just typed should count, so the file is brought up to date first.
+        const auto found = indices.find(&file);
+        if (found != indices.end() && DiskEditFile::background_loads() == 0)
+            index_file(file, found->second, INDEX_STEP);
+
+        // Note how near the cursor each word in its neighborhood appears.
+        std::unordered_map<const std::string *, long> nearness;
+        if (found != indices.end()) {
+            const long size = static_cast<long>(found->second.lines.size());
+            const long top = std::max(line - PROXIMITY_LINES, 0L);
+            const long bottom = std::min(line + PROXIMITY_LINES, size - 1);
+            for (long i = top; i <= bottom; ++i) {
+                const long points = PROXIMITY_LINES - (i < line ? line - i : i - line);
+                for (const WordCounts::iterator entry : found->second.lines[i]) {
+                    long &best = nearness[&entry->first];
+                    best = std::max(best, points);
+                }
+            }
+        }
+
+        struct Candidate {
+            long points;
+            const std::string *word;
+        };
+        std::vector<Candidate> matches;
+        for (auto entry = words.lower_bound(prefix);
+             entry != words.end() && entry->first.compare(0, prefix.size(), prefix) == 0;
+             ++entry) {
+            if (entry->first.size() == prefix.size())
+                continue;
+            const auto near = nearness.find(&entry->first);
+            const long bonus = (near == nearness.end()) ? 0L : near->second * PROXIMITY_WEIGHT;
+            matches.push_back(Candidate{entry->second + bonus, &entry->first});
+        }
+
+        // Equal scores are left in alphabetical order.
+        const std::size_t count = std::min<std::size_t>(matches.size(), MAX_CANDIDATES);
+        std::partial_sort(matches.begin(), matches.begin() + count, matches.end(),
+                          [](const Candidate &left, const Candidate &right) {
+                              return left.points > right.points ||
+                                     (left.points == right.points && *left.word < *right.word);
+                          });
+        std::vector<std::string> result;
+        for (std::size_t i = 0; i < count; ++i)
+            result.push_back(*matches[i].word);
+        return result;
+    }
+
+    bool is_word_character(const char ch)
+    {
+        const unsigned char byte = static_cast<unsigned char>(ch);
+        return std::isalnum(byte) || ch == '_' || byte >= 0x80;
+    }
+
+    void forget(YEditFile &file)
+    {
+        const auto found = indices.find(&file);
+        if (found == indices.end())
+            return;
+        for (const std::vector<WordCounts::iterator> &list : found->second.lines)
+            remove_words(list);
+        indices.erase(found);
+    }
+
+} // namespace Completion
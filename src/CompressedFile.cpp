@@ -0,0 +1,496 @@
+/*! \file    CompressedFile.cpp
+ *  \brief   Implementation of the CompressedFile abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <atomic>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(YEXA_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(YEXA_ZSTD)
+#include <zstd.h>
+#endif
+
+#include "CompressedFile.hpp"
+
+using CompressedFile::Format;
+
+namespace {
+
+    // Compressed input is read this many bytes at a time.
+    constexpr std::size_t input_block_size = 256 * 1024;
+
+    // Decompressed text is handed over in blocks of this size.
+    constexpr std::size_t text_block_size = 1024 * 1024;
+
+    // The decompressing thread stops when it is this many blocks ahead of the reader.
+    constexpr std::size_t queue_limit = 8;
+
+    // Compressed output is written this many bytes at a time.
+    constexpr std::size_t output_block_size = 64 * 1024;
+
+    // Compression levels favor speed, as saving a file should not keep the user waiting.
+    constexpr int gzip_level = 6;
+    constexpr int zstd_level = 3;
+
+    //! Returns true if name ends with the given extension (ignoring case).
+    bool has_extension(const std::string_view name, const std::string_view extension)
+    {
+        if (name.size() <= extension.size())
+            return false;
+        const std::string_view end = name.substr(name.size() - extension.size());
+        for (std::size_t i = 0; i < extension.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(end[i])) != extension[i])
+                return false;
+        }
+        return true;
+    }
+
+    //! Decompresses one format as a stream.
+    class Decoder {
+      public:
+        explicit Decoder(Format format);
+        ~Decoder();
+
+        Decoder(const Decoder &) = delete;
+        Decoder &operator=(const Decoder &) = delete;
+
+        //! Returns false if the library could not be initialized.
+        bool ready() const { return is_ready; }
+
+        bool step(std::string_view &input, char *output, std::size_t size,
+                  std::size_t &produced, bool &ended);
+
+      private:
+        Format format;
+        bool is_ready = false;
+#if defined(YEXA_ZLIB)
+        z_stream inflater;
+#endif
+#if defined(YEXA_ZSTD)
+        ZSTD_DCtx *context = nullptr;
+#endif
+    };
+
+    Decoder::Decoder(const Format format) : format(format)
+    {
+#if defined(YEXA_ZLIB)
+        if (format == CompressedFile::GZIP) {
+            std::memset(&inflater, 0, sizeof(inflater));
+            // Adding 32 to the window size accepts both gzip and zlib headers.
+            is_ready = (inflateInit2(&inflater, 15 + 32) == Z_OK);
+        }
+#endif
+#if defined(YEXA_ZSTD)
+        if (format == CompressedFile::ZSTD)
+            is_ready = ((context = ZSTD_createDCtx()) != nullptr);
+#endif
+    }
+
+    Decoder::~Decoder()
+    {
+        if (!is_ready)
+            return;
+#if defined(YEXA_ZLIB)
+        if (format == CompressedFile::GZIP)
+            inflateEnd(&inflater);
+#endif
+#if defined(YEXA_ZSTD)
+        if (format == CompressedFile::ZSTD)
+            ZSTD_freeDCtx(context);
+#endif
+    }
+
+    //! Decompresses as much of the input as fits in the output.
+    /*!
+     * \param input The compressed bytes not yet used. Those used are removed.
+     * \param produced [out] The number of bytes stored in output.
+     * \param ended [out] =true if a complete gzip member or zstd frame has just been decoded.
+     * \return false if the input is damaged.
+     */
+    bool Decoder::step(std::string_view &input, char *const output, const std::size_t size,
+                       std::size_t &produced, bool &ended)
+    {
+        produced = 0;
+        ended = false;
+#if defined(YEXA_ZLIB)
+        if (format == CompressedFile::GZIP) {
+            inflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+            inflater.avail_in = static_cast<uInt>(input.size());
+            inflater.next_out = reinterpret_cast<Bytef *>(output);
+            inflater.avail_out = static_cast<uInt>(size);
+            const int result = inflate(&inflater, Z_NO_FLUSH);
+            produced = size - inflater.avail_out;
+            input.remove_prefix(input.size() - inflater.avail_in);
+            if (result == Z_STREAM_END) {
+                // Another member may follow (as when logs are compressed piecemeal).
+                ended = true;
+                return inflateReset(&inflater) == Z_OK;
+            }
+            return result == Z_OK || result == Z_BUF_ERROR;
+        }
+#endif
+#if defined(YEXA_ZSTD)
+        if (format == CompressedFile::ZSTD) {
+            ZSTD_inBuffer in = {input.data(), input.size(), 0};
+            ZSTD_outBuffer out = {output, size, 0};
+            const std::size_t result = ZSTD_decompressStream(context, &out, &in);
+            if (ZSTD_isError(result))
+                return false;
+            produced = out.pos;
+            input.remove_prefix(in.pos);
+            ended = (result == 0);
+            return true;
+        }
+#endif
+        (void)input;
+        (void)output;
+        (void)size;
+        return false;
+    }
+
+    //! Reads and decompresses the named file, handing each block of text to deliver.
+    /*!
+     * Deliver may take the contents of the block it is given. It returns false to stop early.
+     *
+     * \return false if the file could not be read or is damaged.
+     */
+    template<typename Deliverer>
+    bool decompress(const char *const name, const Format format, Deliverer deliver)
+    {
+        Decoder decoder(format);
+        if (!decoder.ready())
+            return false;
+        std::FILE *const disk = std::fopen(name, "rb");
+        if (disk == nullptr)
+            return false;
+
+        std::vector<char> input(input_block_size);
+        std::string_view pending;
+        std::string block(text_block_size, '\0');
+        std::size_t used = 0;
+        bool at_end = false;       // =true once all of the file has been read.
+        bool more_output = false;  // =true if the decoder may have output it could not store.
+        bool complete = true;      // =true if the input so far ends with a complete member.
+        bool result = true;
+
+        while (true) {
+            if (pending.empty() && !at_end) {
+                const std::size_t count = std::fread(input.data(), 1, input.size(), disk);
+                if (count == 0)
+                    at_end = true;
+                pending = std::string_view(input.data(), count);
+            }
+            const bool had_input = !pending.empty();
+            if (!had_input && !more_output)
+                break;
+
+            std::size_t produced;
+            bool ended;
+            const std::size_t before = pending.size();
+            if (!decoder.step(pending, &block[used], block.size() - used, produced, ended)) {
+                result = false;
+                break;
+            }
+            if (ended)
+                complete = true;
+            else if (produced > 0 || pending.size() != before)
+                complete = false;
+
+            used += produced;
+            more_output = (used == block.size());
+            if (used == block.size()) {
+                if (!deliver(block))
+                    break;
+                block.assign(text_block_size, '\0');
+                used = 0;
+            }
+            if (!had_input && produced == 0)
+                break;
+        }
+
+        if (result && used > 0) {
+            block.resize(used);
+            deliver(block);
+        }
+        if (std::ferror(disk))
+            result = false;
+        std::fclose(disk);
+        return result && complete;
+    }
+
+    //! Blocks of text passed from the decompressing thread to the reading thread.
+    struct Pipe {
+        std::mutex lock;
+        std::condition_variable changed; //!< Signaled when any member below changes.
+        std::deque<std::string> blocks;  //!< Blocks decompressed but not yet consumed.
+        bool done = false;               //!< =true when no more blocks will be added.
+        bool cancelled = false;          //!< =true when no more blocks are wanted.
+        bool result = true;              //!< The result of decompress.
+    };
+
+} // namespace
+
+namespace CompressedFile {
+
+    Format detect(const char *const name)
+    {
+        unsigned char magic[4] = {0, 0, 0, 0};
+        std::FILE *const disk = std::fopen(name, "rb");
+        if (disk == nullptr)
+            return PLAIN;
+        const std::size_t count = std::fread(magic, 1, sizeof(magic), disk);
+        std::fclose(disk);
+
+        if (count >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+            return GZIP;
+        if (count == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F &&
+            magic[3] == 0xFD)
+            return ZSTD;
+        return PLAIN;
+    }
+
+    Format format_for(const char *const name)
+    {
+        if (has_extension(name, ".gz"))
+            return GZIP;
+        if (has_extension(name, ".zst"))
+            return ZSTD;
+        return PLAIN;
+    }
+
+    const char *format_name(const Format format)
+    {
+        switch (format) {
+        case GZIP:
+            return "gzip";
+        case ZSTD:
+            return "zstd";
+        case PLAIN:
+            break;
+        }
+        return "plain";
+    }
+
+    bool available(const Format format)
+    {
+        switch (format) {
+        case PLAIN:
+            return true;
+        case GZIP:
+#if defined(YEXA_ZLIB)
+            return true;
+#else
+            return false;
+#endif
+        case ZSTD:
+#if defined(YEXA_ZSTD)
+            return true;
+#else
+            return false;
+#endif
+        }
+        return false;
+    }
+
+    bool read(const char *const name, const Format format,
+              const std::function<bool(std::string_view)> &consume)
+    {
+        Pipe pipe;
+        auto produce = [&pipe, name, format]() {
+            const bool result = decompress(name, format, [&pipe](std::string &block) {
+                std::unique_lock<std::mutex> guard(pipe.lock);
+                pipe.changed.wait(guard, [&pipe] {
+                    return pipe.cancelled || pipe.blocks.size() < queue_limit;
+                });
+                if (pipe.cancelled)
+                    return false;
+                pipe.blocks.push_back(std::move(block));
+                pipe.changed.notify_all();
+                return true;
+            });
+            std::lock_guard<std::mutex> guard(pipe.lock);
+            pipe.result = result;
+            pipe.done = true;
+            pipe.changed.notify_all();
+        };
+
+        std::thread producer;
+        try {
+            producer = std::thread(produce);
+        }
+        catch (std::system_error &) {
+            std::string text;
+            const bool result = read_all(name, format, text);
+            consume(text);
+            return result;
+        }
+
+        // Each block is consumed without holding the lock so decompression continues.
+        bool stopped = false;
+        std::unique_lock<std::mutex> guard(pipe.lock);
+        while (true) {
+            pipe.changed.wait(guard, [&pipe] { return pipe.done || !pipe.blocks.empty(); });
+            if (pipe.blocks.empty())
+                break;
+            const std::string block = std::move(pipe.blocks.front());
+            pipe.blocks.pop_front();
+            pipe.changed.notify_all();
+            guard.unlock();
+            stopped = !consume(block);
+            guard.lock();
+            if (stopped) {
+                pipe.cancelled = true;
+                pipe.changed.notify_all();
+                break;
+            }
+        }
+        guard.unlock();
+        producer.join();
+        return stopped || pipe.result;
+    }
+
+    bool read_all(const char *const name, const Format format, std::string &text)
+    {
+        text.clear();
+        return decompress(name, format, [&text](std::string &block) {
+            text.append(block);
+            return true;
+        });
+    }
+
+    //! The state of a compression library.
+    struct Encoder::Stream {
+        explicit Stream(Format format) : format(format) {}
+        ~Stream();
+
+        Format format;
+        bool ready = false;         //!< =true if the library was initialized.
+        std::vector<char> output;   //!< Holds compressed output before it is written.
+#if defined(YEXA_ZLIB)
+        z_stream deflater;
+#endif
+#if defined(YEXA_ZSTD)
+        ZSTD_CCtx *context = nullptr;
+#endif
+
+        bool pump(const char *data, std::size_t size, bool last, std::FILE *disk);
+    };
+
+    Encoder::Stream::~Stream()
+    {
+        if (!ready)
+            return;
+#if defined(YEXA_ZLIB)
+        if (format == GZIP)
+            deflateEnd(&deflater);
+#endif
+#if defined(YEXA_ZSTD)
+        if (format == ZSTD)
+            ZSTD_freeCCtx(context);
+#endif
+    }
+
+    //! Compresses data and writes what the library produces. Last ends the compressed stream.
+    bool Encoder::Stream::pump(const char *const data, const std::size_t size, const bool last,
+                               std::FILE *const disk)
+    {
+#if defined(YEXA_ZLIB)
+        if (format == GZIP) {
+            deflater.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+            deflater.avail_in = static_cast<uInt>(size);
+            int result;
+            do {
+                deflater.next_out = reinterpret_cast<Bytef *>(output.data());
+                deflater.avail_out = static_cast<uInt>(output.size());
+                result = deflate(&deflater, last ? Z_FINISH : Z_NO_FLUSH);
+                if (result == Z_STREAM_ERROR)
+                    return false;
+                const std::size_t count = output.size() - deflater.avail_out;
+                if (std::fwrite(output.data(), 1, count, disk) != count)
+                    return false;
+            } while (deflater.avail_out == 0 || (last && result != Z_STREAM_END));
+            return true;
+        }
+#endif
+#if defined(YEXA_ZSTD)
+        if (format == ZSTD) {
+            ZSTD_inBuffer in = {data, size, 0};
+            std::size_t remaining;
+            do {
+                ZSTD_outBuffer out = {output.data(), output.size(), 0};
+                const ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+                remaining = ZSTD_compressStream2(context, &out, &in, mode);
+                if (ZSTD_isError(remaining))
+                    return false;
+                if (std::fwrite(output.data(), 1, out.pos, disk) != out.pos)
+                    return false;
+            } while (last ? remaining != 0 : in.pos < in.size);
+            return true;
+        }
+#endif
+        (void)data;
+        (void)size;
+        (void)last;
+        (void)disk;
+        return false;
+    }
+
+    //! Prepares to write text compressed in the given format to disk.
+    /*!
+     * If the format is not available every write fails.
+     */
+    Encoder::Encoder(std::FILE *const disk, const Format format)
+        : stream(new Stream(format)), disk(disk), failed(false)
+    {
+        stream->output.resize(output_block_size);
+#if defined(YEXA_ZLIB)
+        if (format == GZIP) {
+            std::memset(&stream->deflater, 0, sizeof(stream->deflater));
+            // Adding 16 to the window size asks for a gzip header rather than a zlib one.
+            stream->ready = (deflateInit2(&stream->deflater, gzip_level, Z_DEFLATED, 15 + 16, 8,
+                                          Z_DEFAULT_STRATEGY) == Z_OK);
+        }
+#endif
+#if defined(YEXA_ZSTD)
+        if (format == ZSTD) {
+            stream->context = ZSTD_createCCtx();
+            stream->ready = (stream->context != nullptr &&
+                             !ZSTD_isError(ZSTD_CCtx_setParameter(
+                                 stream->context, ZSTD_c_compressionLevel, zstd_level)));
+            if (!stream->ready && stream->context != nullptr)
+                ZSTD_freeCCtx(stream->context);
+        }
+#endif
+        failed = !stream->ready;
+    }
+
+    Encoder::~Encoder() = default;
+
+    //! Compresses text and writes it. Returns false if this or an earlier write failed.
+    bool Encoder::write(const char *const data, const std::size_t size)
+    {
+        if (!failed && size > 0 && !stream->pump(data, size, false, disk))
+            failed = true;
+        return !failed;
+    }
+
+    //! Writes the end of the compressed stream. Returns false if any write failed.
+    bool Encoder::finish()
+    {
+        if (!failed && !stream->pump(nullptr, 0, true, disk))
+            failed = true;
+        return !failed;
+    }
+
+} // namespace CompressedFile
@@ -0,0 +1,159 @@
+/*! \file    Compression.cpp
+ *  \brief   Implementation of the Compression functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "Compression.hpp"
+
+namespace {
+
+    // The shortest match worth encoding as a copy.
+    constexpr std::size_t minimum_match = 4;
+
+    // Copies reach at most this far back.
+    constexpr std::size_t maximum_offset = 65535;
+
+    // The hash table of recent positions has 2^hash_bits entries.
+    constexpr unsigned hash_bits = 12;
+
+    //! Returns the four bytes at the given address as an integer.
+    inline std::uint32_t load4(const char *const bytes)
+    {
+        std::uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+
+    //! Returns the hash table entry for a sequence of four bytes.
+    inline std::size_t hash4(const std::uint32_t sequence)
+    {
+        return (sequence * 2654435761U) >> (32 - hash_bits);
+    }
+
+    //! Appends the remainder of a length that did not fit in its token nibble.
+    void put_length(std::size_t length, std::string &packed)
+    {
+        while (length >= 255) {
+            packed.push_back(static_cast<char>(255));
+            length -= 255;
+        }
+        packed.push_back(static_cast<char>(length));
+    }
+
+    //! Reads the remainder of a length, adding it to length. Returns false if packed ends.
+    bool get_length(const std::string_view packed, std::size_t &position, std::size_t &length)
+    {
+        unsigned char byte;
+        do {
+            if (position >= packed.size())
+                return false;
+            byte = static_cast<unsigned char>(packed[position++]);
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    //! Appends a sequence: literals followed by a copy of match_length bytes from offset back.
+    /*!
+     * The last sequence of a block has no copy; it is written with a match_length of zero.
+     */
+    void put_sequence(const char *const literals, const std::size_t literal_length,
+                      const std::size_t offset, const std::size_t match_length,
+                      std::string &packed)
+    {
+        const std::size_t extra = match_length == 0 ? 0 : match_length - minimum_match;
+        packed.push_back(static_cast<char>((std::min<std::size_t>(literal_length, 15) << 4) |
+                                           std::min<std::size_t>(extra, 15)));
+        if (literal_length >= 15)
+            put_length(literal_length - 15, packed);
+        packed.append(literals, literal_length);
+        if (match_length == 0)
+            return;
+        packed.push_back(static_cast<char>(offset & 0xFF));
+        packed.push_back(static_cast<char>(offset >> 8));
+        if (extra >= 15)
+            put_length(extra - 15, packed);
+    }
+
+} // namespace
+
+namespace Compression {
+
+    void compress(const std::string_view text, std::string &packed)
+    {
+        // Positions are stored one based so that zero means the entry is unused.
+        std::uint32_t recent[std::size_t(1) << hash_bits] = {};
+        const char *const data = text.data();
+        const std::size_t size = text.size();
+        std::size_t anchor = 0;
+        std::size_t position = 0;
+
+        while (position + minimum_match <= size) {
+            const std::uint32_t sequence = load4(data + position);
+            std::uint32_t &entry = recent[hash4(sequence)];
+            const std::size_t candidate = entry;
+            entry = static_cast<std::uint32_t>(position + 1);
+
+            if (candidate == 0 || position + 1 - candidate > maximum_offset ||
+                load4(data + candidate - 1) != sequence) {
+                ++position;
+                continue;
+            }
+
+            const std::size_t source = candidate - 1;
+            std::size_t length = minimum_match;
+            while (position + length < size && data[source + length] == data[position + length])
+                ++length;
+            put_sequence(data + anchor, position - anchor, position - source, length, packed);
+            position += length;
+            anchor = position;
+        }
+        put_sequence(data + anchor, size - anchor, 0, 0, packed);
+    }
+
+    bool expand(const std::string_view packed, char *const text, const std::size_t size)
+    {
+        std::size_t position = 0;
+        std::size_t output = 0;
+        while (true) {
+            if (position >= packed.size())
+                return false;
+            const unsigned token = static_cast<unsigned char>(packed[position++]);
+
+            std::size_t literal_length = token >> 4;
+            if (literal_length == 15 && !get_length(packed, position, literal_length))
+                return false;
+            if (literal_length > packed.size() - position || literal_length > size - output)
+                return false;
+            std::memcpy(text + output, packed.data() + position, literal_length);
+            position += literal_length;
+            output += literal_length;
+            if (output == size)
+                return position == packed.size();
+
+            if (packed.size() - position < 2)
+                return false;
+            const std::size_t offset = static_cast<unsigned char>(packed[position]) |
+                                       static_cast<std::size_t>(
+                                           static_cast<unsigned char>(packed[position + 1]))
+                                           << 8;
+            position += 2;
+            std::size_t match_length = token & 15;
+            if (match_length == 15 && !get_length(packed, position, match_length))
+                return false;
+            match_length += minimum_match;
+            if (offset == 0 || offset > output || match_length > size - output)
+                return false;
+
+            // The copy may overlap its own output (a repeated pattern) so go byte by byte.
+            const char *source = text + output - offset;
+            for (std::size_t i = 0; i < match_length; ++i)
+                text[output + i] = source[i];
+            output += match_length;
+        }
+    }
+
+} // namespace Compression
@@ -7,6 +7,37 @@
 
 #include "CursorEditFile.hpp"
 #include "EditBuffer.hpp"
+#include "Utf8.hpp"
+
+void CursorEditFile::character_left()
+{
+    const unsigned column = current_point.cursor_column();
+    if (column == 0)
+        return;
+
+    file_data.jump_to(current_point.cursor_line());
+    const EditBuffer *const current_line = file_data.get();
+    unsigned target = column - 1;
+    if (current_line != nullptr)
+        target = static_cast<unsigned>(
+            current_line->column_of(current_line->offset_of(target, tab_stop), tab_stop));
+    current_point.cursor_left(column - target);
+}
+
+void CursorEditFile::character_right()
+{
+    const unsigned column = current_point.cursor_column();
+
+    file_data.jump_to(current_point.cursor_line());
+    const EditBuffer *const current_line = file_data.get();
+    unsigned target = column + 1;
+    if (current_line != nullptr) {
+        const std::string_view text = current_line->view();
+        const std::size_t offset = Utf8::next(text, current_line->offset_of(column, tab_stop));
+        target = static_cast<unsigned>(current_line->column_of(offset, tab_stop));
+    }
+    current_point.cursor_right(target - column);
+}
 
 void CursorEditFile::home()
 {
@@ -21,7 +52,7 @@ void CursorEditFile::end()
     if (current_line == nullptr)
         current_point.jump_to_column(0);
     else
-        current_point.jump_to_column(current_line->length());
+        current_point.jump_to_column(static_cast<unsigned>(current_line->columns(tab_stop)));
 }
 
 void CursorEditFile::top_of_file()
@@ -0,0 +1,91 @@
+/*! \file    Diagnostics.cpp
+ *  \brief   Implementation of class Diagnostics
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "Diagnostics.hpp"
+
+// The most lines marked for one diagnostic. A range beyond them is shown on these lines only.
+#define MAX_MARKED_LINES 100
+
+namespace {
+
+    bool mark_order(const Diagnostics::Mark &left, const Diagnostics::Mark &right)
+    {
+        return left.line < right.line || (left.line == right.line && left.start < right.start);
+    }
+
+} // namespace
+
+//! Forgets every diagnostic.
+void Diagnostics::clear()
+{
+    marks.clear();
+    messages.clear();
+}
+
+//! Adds a diagnostic covering text from one position to another. Call finish when done.
+/*!
+ * \param first_line The line where the diagnostic starts.
+ * \param first_offset The offset on that line of the first byte covered.
+ * \param last_line The line where the diagnostic ends.
+ * \param last_offset The offset on that line after the last byte covered.
+ */
+void Diagnostics::add(const long first_line, const std::size_t first_offset, long last_line,
+                      const std::size_t last_offset, const Severity severity,
+                      std::string message)
+{
+    if (first_line < 0 || last_line < first_line)
+        return;
+    last_line = std::min(last_line, first_line + MAX_MARKED_LINES - 1);
+    const std::size_t index = messages.size();
+    messages.push_back(std::move(message));
+    for (long line = first_line; line <= last_line; ++line) {
+        const std::size_t start = (line == first_line) ? first_offset : 0;
+        const std::size_t end = (line == last_line) ? last_offset
+                                                      : static_cast<std::size_t>(-1);
+        marks.push_back(Mark{line, start, end, severity, line == first_line, index});
+    }
+}
+
+//! Puts the marks added into order.
+void Diagnostics::finish()
+{
+    std::stable_sort(marks.begin(), marks.end(), mark_order);
+}
+
+//! Notes that old_count lines starting at first were replaced by new_count lines.
+void Diagnostics::move_lines(const long first, const long old_count, const long new_count)
+{
+    auto kept = std::remove_if(marks.begin(), marks.end(), [&](const Mark &mark) {
+        return mark.line >= first && mark.line < first + old_count;
+    });
+    marks.erase(kept, marks.end());
+    for (Mark &mark : marks) {
+        if (mark.line >= first + old_count)
+            mark.line += new_count - old_count;
+    }
+}
+
+std::pair<Diagnostics::Iterator, Diagnostics::Iterator> Diagnostics::on_line(
+    const long line) const
+{
+    return std::equal_range(marks.begin(), marks.end(), Mark{line, 0, 0, ERROR, false, 0},
+                            [](const Mark &left, const Mark &right) {
+                                return left.line < right.line;
+                            });
+}
+
+const Diagnostics::Mark *Diagnostics::following(const long line, const std::size_t offset) const
+{
+    const Mark position{line, offset, 0, ERROR, false, 0};
+    auto it = std::upper_bound(marks.begin(), marks.end(), position, mark_order);
+    for (; it != marks.end(); ++it) {
+        if (it->first)
+            return &*it;
+    }
+    return nullptr;
+}
@@ -0,0 +1,182 @@
+/*! \file    DiffView.cpp
+ *  \brief   Implementation of the DiffView abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "DiffView.hpp"
+#include "DiskEditFile.hpp"
+#include "DocumentSnapshot.hpp"
+#include "EventLoop.hpp"
+#include "FilePosition.hpp"
+#include "LineDiff.hpp"
+#include "TaskPool.hpp"
+#include "YEditFile.hpp"
+#include "support.hpp"
+
+namespace {
+
+    // Files with more lines than this between them are compared on a worker thread.
+    constexpr long background_threshold = 20000;
+
+    //! A comparison of snapshots of the files, which can be run on any thread.
+    struct Job {
+        std::shared_ptr<const DocumentSnapshot> left;
+        std::shared_ptr<const DocumentSnapshot> right;
+        std::vector<LineDiff::Hunk> hunks; //!< The differences found.
+        bool failed = false;               //!< =true if there was insufficient memory.
+        TaskPool::CancelToken cancelled;   //!< Cancelled if the result is no longer wanted.
+
+        void run();
+    };
+
+    //! The files being compared.
+    struct Comparison {
+        YEditFile *left = nullptr; //!< The old version (nullptr if nothing is compared).
+        YEditFile *right = nullptr;
+        std::vector<LineDiff::Hunk> hunks; //!< The differences last found.
+        unsigned long left_version = 0;    //!< The versions last compared (see EditFile).
+        unsigned long right_version = 0;
+        std::shared_ptr<Job> running;      //!< The comparison on a worker thread, if any.
+    };
+
+    Comparison current;
+
+    //! Appends the hashes of the lines of a snapshot to hashes.
+    void hash_lines(const DocumentSnapshot &lines, std::vector<std::size_t> &hashes)
+    {
+        hashes.reserve(static_cast<std::size_t>(lines.size()));
+        for (long i = 0; i < lines.size(); ++i)
+            hashes.push_back(LineDiff::hash(lines.line(i)));
+    }
+
+    void Job::run()
+    {
+        try {
+            std::vector<std::size_t> old_hashes;
+            std::vector<std::size_t> new_hashes;
+            hash_lines(*left, old_hashes);
+            hash_lines(*right, new_hashes);
+            if (!cancelled.cancelled())
+                hunks = LineDiff::compare(old_hashes, new_hashes);
+        }
+        catch (std::bad_alloc &) {
+            failed = true;
+        }
+    }
+
+    //! Marks the differences a job found in the files compared.
+    void finish(Job &job)
+    {
+        if (job.failed) {
+            memory_message("Can't compare the files");
+            return;
+        }
+        current.hunks = std::move(job.hunks);
+        current.left->set_differences(current.hunks, true);
+        current.right->set_differences(current.hunks, false);
+    }
+
+    //! Compares the files as they now are, on a worker thread if they are large.
+    bool compare()
+    {
+        if (current.running)
+            current.running->cancelled.cancel();
+        current.running.reset();
+        current.left_version = current.left->version();
+        current.right_version = current.right->version();
+
+        const std::shared_ptr<Job> job = std::make_shared<Job>();
+        try {
+            job->left = current.left->snapshot();
+            job->right = current.right->snapshot();
+        }
+        catch (std::bad_alloc &) {
+            memory_message("Can't compare the files");
+            return false;
+        }
+        if (job->left->size() + job->right->size() <= background_threshold) {
+            job->run();
+            finish(*job);
+            return !job->failed;
+        }
+
+        current.running = job;
+        const std::weak_ptr<Job> posted(job);
+        TaskPool::submit(
+            [job]() { job->run(); },
+            [posted]() {
+                const std::shared_ptr<Job> finished = posted.lock();
+                if (finished == nullptr || finished != current.running)
+                    return;
+                current.running.reset();
+                finish(*finished);
+            },
+            job->cancelled);
+        return true;
+    }
+
+    //! Compares the files again if either has been modified. An idle task.
+    bool compare_modified()
+    {
+        // Files still being read in the background are left alone since snapshots of them
+        // would wait for the read.
+        if (current.left == nullptr || current.running || DiskEditFile::background_loads() != 0)
+            return false;
+        if (current.left->version() != current.left_version ||
+            current.right->version() != current.right_version)
+            compare();
+        return false;
+    }
+
+} // namespace
+
+namespace DiffView {
+
+    bool start(YEditFile &left, YEditFile &right)
+    {
+        static const bool watching = (EventLoop::add_idle(compare_modified), true);
+        (void)watching;
+
+        forget(current.left);
+        current.left = &left;
+        current.right = &right;
+        return compare();
+    }
+
+    void forget(const YEditFile *const file)
+    {
+        if (file == nullptr || (file != current.left && file != current.right))
+            return;
+        if (current.running)
+            current.running->cancelled.cancel();
+        if (current.left != file)
+            current.left->set_differences({}, true);
+        if (current.right != file)
+            current.right->set_differences({}, false);
+        current = Comparison();
+    }
+
+    bool follow(const YEditFile &leader, const FilePosition &from, const YEditFile &follower,
+                FilePosition &to)
+    {
+        bool forward;
+        if (&leader == current.left && &follower == current.right)
+            forward = true;
+        else if (&leader == current.right && &follower == current.left)
+            forward = false;
+        else
+            return false;
+
+        to.jump_to_line(LineDiff::follow(current.hunks, from.cursor_line(), forward));
+        to.adjust_window_line(static_cast<int>(from.cursor_line() - from.window_line()));
+        to.jump_to_column(from.cursor_column());
+        to.adjust_window_column(from.cursor_column() - from.window_column());
+        return true;
+    }
+
+} // namespace DiffView
@@ -3,61 +3,1258 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <screen/environ.hpp>
 
-#if eOPSYS != ePOSIX
+#if eOPSYS == ePOSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
 #include <dos.h>
 #endif
 
 #include <screen/MessageWindow.hpp>
 #include <screen/screen.hpp>
 
+#include "Allocations.hpp"
+#include "CompressedFile.hpp"
 #include "DiskEditFile.hpp"
 #include "EditBuffer.hpp"
+#include "EventLoop.hpp"
 #include "FileNameMatcher.hpp"
+#include "HexImage.hpp"
+#include "LineDiff.hpp"
+#include "LineInterner.hpp"
+#include "MappedFile.hpp"
+#include "Profiler.hpp"
+#include "RemoteFile.hpp"
+#include "TaskPool.hpp"
+#include "Timer.hpp"
+#include "Trace.hpp"
 #include "support.hpp"
 
 /*=======================================*/
 /*           Support Functions           */
 /*=======================================*/
 
-static bool write_line(EditBuffer *line, std::FILE *disk)
-{
-    int result = 0;  // Result of a disk write operation.
-    int space_count; // Number of spaces found so far.
+namespace {
+
+    // Output is accumulated in blocks of this size before being handed to the OS.
+    constexpr std::size_t output_block_size = 64 * 1024;
+
+    // Throughput is only reported for saves at least this large (timing smaller ones is noise).
+    constexpr long report_threshold = 4L * 1024L * 1024L;
+
+    // Files at least this large are converted into lines only as the lines are needed.
+    constexpr std::size_t lazy_threshold = 32 * 1024 * 1024;
+
+    // Remote files at least this large are read from the host only as their lines are needed.
+    constexpr std::uint64_t remote_lazy_threshold = 4 * 1024 * 1024;
+
+    // The lines of such files are kept compressed except in this many chunks of the EditList
+    // (most recently visited first). That is enough for any window and typical edits.
+    constexpr std::size_t warm_chunk_limit = 128;
 
-    space_count = 0;
+    // Files with at least this many lines are compared with their disk versions in the
+    // background when that is possible.
+    constexpr long background_reload_threshold = 64 * 1024;
 
-    // For each character on that line...
-    for (std::size_t offset = 0; result != EOF && offset < line->length(); offset++) {
+    //! Returns true if a character survives the conversion done by make_line.
+    inline bool is_kept(const char ch) { return ch != '\0'; }
 
-        // Don't print spaces yet.. may be nothing else on line.
-        if ((*line)[offset] == ' ')
-            space_count++;
+    // A file whose first line ends with a lone carriage return is only taken to have such line
+    // endings if no line feed follows within this many bytes.
+    constexpr std::size_t cr_lookahead = 4096;
+
+    //! Returns true if a character can end a line.
+    inline bool is_line_break(const char ch) { return ch == '\n' || ch == '\r'; }
+
+    //! Returns true if the first line break of an image ending at end shows lines end in CR.
+    bool is_cr_file(const char *const first_break, const char *const end)
+    {
+        if (first_break == end || *first_break != '\r')
+            return false;
+        const std::size_t rest = static_cast<std::size_t>(end - first_break - 1);
+        return std::memchr(first_break + 1, '\n', std::min(rest, cr_lookahead)) == nullptr;
+    }
+
+    //! Locates the end of the line starting at text in a file image ending at end.
+    /*!
+     * Lines end with a line feed, a carriage return and line feed, or (in files where the first
+     * line ends that way, see is_cr_file) a carriage return. Elsewhere a lone carriage return
+     * is an ordinary character. The files are not read in text mode so all three endings are
+     * seen here. Once the first ending is known the lines are found with memchr.
+     *
+     * \param stop Set to the end of the line's text, excluding the line terminator.
+     * \param endings Counts the line endings found. It also decides how lines end, so it must
+     * be passed to each call for the same file.
+     * \return A pointer to the start of the next line (end if there are no more lines).
+     */
+    const char *find_line(const char *const text, const char *const end, const char *&stop,
+                          bool &has_newline, DiskEditFile::EndingCounts &endings)
+    {
+        const char *line_end;
+        if (endings.cr != 0)
+            line_end = static_cast<const char *>(std::memchr(text, '\r', end - text));
+        else if (endings.lf != 0 || endings.crlf != 0)
+            line_end = static_cast<const char *>(std::memchr(text, '\n', end - text));
         else {
+            line_end = std::find_if(text, end, is_line_break);
+            if (line_end == end)
+                line_end = nullptr;
+            else if (*line_end == '\r' && !is_cr_file(line_end, end)) {
+                const std::size_t rest = static_cast<std::size_t>(end - line_end);
+                line_end = static_cast<const char *>(std::memchr(line_end, '\n', rest));
+            }
+        }
+        has_newline = (line_end != nullptr);
+        if (!has_newline) {
+            stop = end;
+            return end;
+        }
+
+        stop = line_end;
+        if (*line_end == '\r') {
+            if (line_end + 1 < end && *(line_end + 1) == '\n') {
+                ++endings.crlf;
+                return line_end + 2;
+            }
+            ++endings.cr;
+            return line_end + 1;
+        }
+        if (stop > text && *(stop - 1) == '\r') {
+            --stop;
+            ++endings.crlf;
+        }
+        else
+            ++endings.lf;
+        return line_end + 1;
+    }
+
+    //! Returns the text in [text, stop) of a file image as it becomes a line of the file.
+    /*!
+     * Lines needing no character filtering (the usual case) are returned directly from the
+     * image. Otherwise the line is built in workspace. Tabs are kept; they are only expanded to
+     * the tab stops when the line is displayed.
+     */
+    std::string_view line_text(const char *const text, const char *const stop,
+                               std::string &workspace)
+    {
+        // Look for characters that need special handling.
+        const char *p = std::find_if_not(text, stop, is_kept);
+        if (p == stop)
+            return std::string_view(text, static_cast<std::size_t>(stop - text));
+
+        // Ignore null characters.
+        workspace.assign(text, p);
+        std::copy_if(p, stop, std::back_inserter(workspace), is_kept);
+        return workspace;
+    }
+
+    //! Makes an EditBuffer holding a line's text, through the interner if there is one.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    EditBuffer *new_line(const std::string_view line, LineInterner *const interner)
+    {
+        if (interner != nullptr)
+            return interner->make(line);
+        return new EditBuffer(line.data(), line.size());
+    }
+
+    //! Makes an EditBuffer holding the text in [text, stop) of a file image (see line_text).
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    EditBuffer *make_line(const char *const text, const char *const stop,
+                          std::string &workspace, LineInterner *const interner)
+    {
+        return new_line(line_text(text, stop, workspace), interner);
+    }
+
+    //! Calls visit with the text of each line in a file image, in order.
+    /*!
+     * The text is as given by line_text and is only valid during the call. Visit returns false
+     * to stop early. The line endings are counted in endings (see find_line).
+     */
+    template<typename Visitor>
+    void for_each_text(const char *text, const std::size_t length,
+                       DiskEditFile::EndingCounts &endings, Visitor visit)
+    {
+        const char *const end = text + length;
+        std::string workspace; // Used only for lines that need to be processed.
+
+        while (text < end) {
+            const char *stop;
+            bool has_newline;
+            const char *const line = text;
+            text = find_line(line, end, stop, has_newline, endings);
+            const std::string_view converted = line_text(line, stop, workspace);
+
+            // A final partial line is only a line if it has text.
+            if ((has_newline || !converted.empty()) && !visit(converted))
+                return;
+        }
+    }
+
+    //! Calls install for each line in a file image, in order.
+    /*!
+     * The lines are converted as by make_line. Install is given a std::unique_ptr<EditBuffer>
+     * which it can release to take ownership. It returns false to stop early.
+     *
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    template<typename Installer>
+    void for_each_line(const char *text, const std::size_t length,
+                       DiskEditFile::EndingCounts &endings, LineInterner *const interner,
+                       Installer install)
+    {
+        for_each_text(text, length, endings, [&install, interner](const std::string_view line) {
+            std::unique_ptr<EditBuffer> new_copy(new_line(line, interner));
+            return install(new_copy);
+        });
+    }
+
+    // Files inserted into others that are at least this large are read by several workers.
+    constexpr std::size_t parallel_insert_threshold = 4 * 1024 * 1024;
+
+    // The least text read by each of those workers.
+    constexpr std::size_t insert_part_size = 1024 * 1024;
+
+    //! Reads a file image into a list of its own, as read_memory reads it into file_data.
+    /*!
+     * Large images are divided among the workers (see TaskPool) once the first line shows how
+     * the others end. Each part becomes a list of its own and the parts are joined in order,
+     * which costs little since whole chunks are moved (see EditList::splice_in). The lines
+     * are made by the interner, if one is given, and then by this thread alone.
+     *
+     * \param endings Counts the line endings found. They must be zero initially.
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    void read_fragment(const char *const text, const std::size_t length,
+                       DiskEditFile::EndingCounts &endings, LineInterner *const interner,
+                       EditList &fragment)
+    {
+        const auto install = [&fragment](std::unique_ptr<EditBuffer> &line) {
+            fragment.insert(line.get());
+            line.release();
+            return true;
+        };
+        const std::size_t parts =
+            std::min<std::size_t>(TaskPool::size(), length / insert_part_size);
+        if (interner != nullptr || length < parallel_insert_threshold || parts < 2) {
+            for_each_line(text, length, endings, interner, install);
+            return;
+        }
+
+        // The first line decides how the others end (see find_line).
+        const char *const end = text + length;
+        const char *stop;
+        bool has_newline;
+        const char *const rest = find_line(text, end, stop, has_newline, endings);
+        std::string workspace;
+        const std::string_view first = line_text(text, stop, workspace);
+        if (has_newline || !first.empty())
+            fragment.insert(new_line(first, nullptr));
+        const char separator = (endings.cr != 0) ? '\r' : '\n';
+
+        // Each part ends just after a line ending, never between a carriage return and a line
+        // feed.
+        std::vector<const char *> bounds{rest};
+        const std::size_t part_size = static_cast<std::size_t>(end - rest) / parts;
+        while (bounds.size() < parts &&
+               static_cast<std::size_t>(end - bounds.back()) > part_size) {
+            const char *p = bounds.back() + part_size;
+            p = static_cast<const char *>(std::memchr(p, separator, end - p));
+            if (p == nullptr || ++p == end || (*(p - 1) == '\r' && *p == '\n' && ++p == end))
+                break;
+            bounds.push_back(p);
+        }
+        bounds.push_back(end);
+
+        const DiskEditFile::EndingCounts seed = endings;
+        std::vector<EditList> lists(bounds.size() - 1);
+        std::vector<DiskEditFile::EndingCounts> counts(lists.size(), seed);
+        std::atomic<bool> failed{false};
+        {
+            TaskPool::Group readers;
+            for (std::size_t i = 0; i < lists.size(); ++i) {
+                readers.run([&, i]() {
+                    Allocations::Scope tag(Allocations::DOCUMENT);
+                    try {
+                        const std::size_t size =
+                            static_cast<std::size_t>(bounds[i + 1] - bounds[i]);
+                        for_each_line(bounds[i], size, counts[i], nullptr,
+                                      [&lists, i](std::unique_ptr<EditBuffer> &line) {
+                                          lists[i].insert(line.get());
+                                          line.release();
+                                          return true;
+                                      });
+                    }
+                    catch (std::bad_alloc &) {
+                        failed = true;
+                    }
+                });
+            }
+            readers.wait();
+        }
+        if (failed)
+            throw std::bad_alloc();
+        for (std::size_t i = 0; i < lists.size(); ++i) {
+            fragment.splice_in(lists[i]);
+            endings.lf += counts[i].lf - seed.lf;
+            endings.crlf += counts[i].crlf - seed.crlf;
+            endings.cr += counts[i].cr - seed.cr;
+        }
+    }
+
+    //! Supplies the lines of a mapped file to an EditList as they are needed.
+    /*!
+     * The lines are counted by a background task so the size of the file is known without
+     * converting it. The mapping is held until every line has been supplied. Note that the
+     * file must not be truncated by another program while it is mapped. The endings of the
+     * lines are added to the owner's counts as the lines are supplied. The lines are made by
+     * the interner, if there is one, which is kept until every line has been supplied.
+     */
+    class MappedLines : public PendingLines {
+      public:
+        MappedLines(std::unique_ptr<MappedFile> source, DiskEditFile::EndingCounts &endings,
+                    std::unique_ptr<LineInterner> interner);
+        ~MappedLines() override;
+
+        EditBuffer *next_line() override;
+        long remaining() override;
+        bool is_mapped() const override { return true; }
+
+      private:
+        std::unique_ptr<MappedFile> image; //!< The file being supplied.
+        const char *text;                  //!< Start of the next line to supply.
+        const char *end;                   //!< End of the file image.
+        long supplied;                     //!< Number of lines supplied so far.
+        long total;                        //!< Number of lines in the file (once counted).
+        std::atomic<bool> cancelled;       //!< =true if the count is no longer wanted.
+        TaskPool::Group counter{TaskPool::BACKGROUND}; //!< Counts the lines in the file.
+        std::string workspace;             //!< Used for lines that need to be processed.
+        std::unique_ptr<LineInterner> interner; //!< Makes the lines (nullptr if none).
+        DiskEditFile::EndingCounts &endings; //!< Counts the endings of the lines supplied.
+
+        void count_lines();
+    };
+
+    MappedLines::MappedLines(std::unique_ptr<MappedFile> source,
+                             DiskEditFile::EndingCounts &endings,
+                             std::unique_ptr<LineInterner> interner)
+        : image(std::move(source)), text(image->data()), end(image->data() + image->size()),
+          supplied(0), total(0), cancelled(false), interner(std::move(interner)),
+          endings(endings)
+    {
+        counter.run([this]() { count_lines(); });
+    }
+
+    MappedLines::~MappedLines()
+    {
+        cancelled = true;
+        counter.wait();
+    }
+
+    //! Counts the lines in the image exactly as read_memory would install them.
+    void MappedLines::count_lines()
+    {
+        Trace::Span span("count lines");
+
+        // Lines end with whatever ends the first line, taking a carriage return and line feed
+        // together (see find_line).
+        const char *p = image->data();
+        const bool cr_mode = is_cr_file(std::find_if(p, end, is_line_break), end);
+        const char separator = cr_mode ? '\r' : '\n';
+
+        // Scan in slices so that cancellation is noticed promptly.
+        constexpr std::size_t slice_size = 1024 * 1024;
+        const char *last_line = p;
+        long count = 0;
+        while (p < end && !cancelled) {
+            const char *const slice_end =
+                p + std::min(slice_size, static_cast<std::size_t>(end - p));
+            while ((p = static_cast<const char *>(std::memchr(p, separator, slice_end - p))) !=
+                   nullptr) {
+                ++count;
+                last_line = ++p;
+            }
+            p = slice_end;
+        }
+        if (cr_mode && last_line < end && *last_line == '\n')
+            ++last_line;
+
+        // A final partial line is installed only if it has text.
+        if (std::any_of(last_line, end, is_kept))
+            ++count;
+        total = count;
+    }
+
+    EditBuffer *MappedLines::next_line()
+    {
+        Allocations::Scope tag(Allocations::DOCUMENT);
+        while (text < end) {
+            const char *stop;
+            bool has_newline;
+            const char *const line = text;
+            text = find_line(line, end, stop, has_newline, endings);
+            std::unique_ptr<EditBuffer> new_copy(
+                make_line(line, stop, workspace, interner.get()));
+            if (has_newline || new_copy->length() > 0) {
+                ++supplied;
+                return new_copy.release();
+            }
+        }
+        interner.reset();
+        return nullptr;
+    }
+
+    //! Returns the number of lines not yet supplied, waiting for them to be counted if needed.
+    long MappedLines::remaining()
+    {
+        counter.wait();
+        return total - supplied;
+    }
+
+    //! Supplies the lines of a remote file to an EditList as they are needed.
+    /*!
+     * The lines are counted on the host so the size of the file is known without reading it.
+     * Blocks are requested a few ahead of the lines being supplied so that reading through the
+     * file does not wait for a round trip to the host for every block. The endings of the
+     * lines are added to the owner's counts as the lines are supplied. The connection is kept
+     * for reuse (see RemoteFile::keep) once the lines are no longer needed.
+     */
+    class RemoteLines : public PendingLines {
+      public:
+        RemoteLines(std::unique_ptr<RemoteFile> source, std::string first_block, long total,
+                    DiskEditFile::EndingCounts &endings,
+                    std::unique_ptr<LineInterner> interner);
+        ~RemoteLines() override;
+
+        EditBuffer *next_line() override;
+        long remaining() override { return total - supplied; }
+
+      private:
+        std::unique_ptr<RemoteFile> source; //!< The file being supplied.
+        std::string text;         //!< The blocks received but not yet entirely supplied.
+        std::size_t start;        //!< The offset in text of the next line to supply.
+        std::uint64_t next_block; //!< The next block to request.
+        bool complete;            //!< =true once every block has been received (or lost).
+        long supplied;            //!< Number of lines supplied so far.
+        long total;               //!< Number of lines in the file.
+        std::string workspace;    //!< Used for lines that need to be processed.
+        std::unique_ptr<LineInterner> interner; //!< Makes the lines (nullptr if none).
+        DiskEditFile::EndingCounts &endings; //!< Counts the endings of the lines supplied.
+
+        void receive();
+    };
+
+    // The number of blocks of a remote file requested ahead of the one being received.
+    constexpr std::size_t remote_read_ahead = 16;
+
+    RemoteLines::RemoteLines(std::unique_ptr<RemoteFile> source, std::string first_block,
+                             const long total, DiskEditFile::EndingCounts &endings,
+                             std::unique_ptr<LineInterner> interner)
+        : source(std::move(source)), text(std::move(first_block)), start(0), next_block(1),
+          complete(false), supplied(0), total(total), interner(std::move(interner)),
+          endings(endings)
+    {
+        complete = this->source->blocks() <= 1;
+    }
+
+    RemoteLines::~RemoteLines()
+    {
+        std::string unused;
+        while (source->outstanding() != 0 && source->receive(unused))
+            unused.clear();
+        RemoteFile::keep(std::move(source));
+    }
+
+    //! Adds the next block to the text, keeping the requests for those after it outstanding.
+    void RemoteLines::receive()
+    {
+        if (start > text.size() / 2) {
+            text.erase(0, start);
+            start = 0;
+        }
+        while (next_block < source->blocks() && source->outstanding() < remote_read_ahead)
+            source->request(next_block++);
+        if (!source->receive(text)) {
+            complete = true;
+            warning_message("Problems reading a remote file. It may be incomplete");
+            return;
+        }
+        complete = (next_block == source->blocks() && source->outstanding() == 0);
+    }
+
+    EditBuffer *RemoteLines::next_line()
+    {
+        Allocations::Scope tag(Allocations::DOCUMENT);
+        while (start < text.size() || !complete) {
+            const char *const line = text.data() + start;
+            const char *const end = text.data() + text.size();
+
+            // How the first line ends may depend on the text after it (see is_cr_file).
+            const bool undecided = endings.lf == 0 && endings.crlf == 0 && endings.cr == 0;
+            const char *const first_break = std::find_if(line, end, is_line_break);
+            if (!complete && (first_break == end ||
+                              (undecided && static_cast<std::size_t>(end - first_break) <=
+                                                cr_lookahead))) {
+                receive();
+                continue;
+            }
+
+            const char *stop;
+            bool has_newline;
+            const char *const next = find_line(line, end, stop, has_newline, endings);
+            if (!has_newline && !complete) {
+                receive();
+                continue;
+            }
+            std::unique_ptr<EditBuffer> new_copy(
+                make_line(line, stop, workspace, interner.get()));
+            start = static_cast<std::size_t>(next - text.data());
+            if (has_newline || new_copy->length() > 0) {
+                ++supplied;
+                return new_copy.release();
+            }
+        }
+        interner.reset();
+        return nullptr;
+    }
+
+    //! Appends up to size bytes of the named file, starting at offset, to text.
+    /*!
+     * The file is opened only for the read.
+     *
+     * \return false if the file can't be read or has fewer bytes than asked for.
+     */
+    bool read_range(const char *const name, const std::uint64_t offset, const std::size_t size,
+                    std::string &text)
+    {
+        const std::size_t old_size = text.size();
+        text.resize(old_size + size);
+        std::size_t done = 0;
+#if eOPSYS == ePOSIX
+        const int fd = open(name, O_RDONLY | O_CLOEXEC);
+        if (fd != -1) {
+            while (done < size) {
+                const ssize_t count = pread(fd, &text[old_size + done], size - done,
+                                            static_cast<off_t>(offset + done));
+                if (count < 0 && errno == EINTR)
+                    continue;
+                if (count <= 0)
+                    break;
+                done += static_cast<std::size_t>(count);
+            }
+            close(fd);
+        }
+#else
+        std::FILE *const disk = std::fopen(name, "rb");
+        if (disk != nullptr) {
+            if (std::fseek(disk, static_cast<long>(offset), SEEK_SET) == 0)
+                done = std::fread(&text[old_size], 1, size, disk);
+            std::fclose(disk);
+        }
+#endif
+        text.resize(old_size + done);
+        return done == size;
+    }
+
+    //! Supplies the lines of an evicted file to an EditList as they are needed.
+    /*!
+     * The file is read again a block at a time as the lines are visited. It is only opened
+     * for each read, so nothing is held open or mapped while the lines wait, and a file
+     * truncated by another program does no harm. Before and after each read the size and
+     * modification time of the file are compared with those it had when the lines were
+     * discarded. If they differ the rest of the lines can't be had; empty lines are supplied
+     * in their place and lost is set so that the owner reloads the file (see
+     * DiskEditFile::evict). The endings of the lines are added to the owner's counts as the
+     * lines are supplied.
+     */
+    class StoredLines : public PendingLines {
+      public:
+        StoredLines(std::string name, std::uint64_t size, unsigned long long stamp,
+                    DiskEditFile::EndingCounts &endings, std::unique_ptr<LineInterner> interner,
+                    bool &lost);
+
+        bool count();
+        EditBuffer *next_line() override;
+        long remaining() override { return total - supplied; }
+        bool is_mapped() const override { return true; }
+
+      private:
+        std::string name;         //!< The file the lines are read from.
+        std::uint64_t size;       //!< Its size when the lines were discarded.
+        unsigned long long stamp; //!< Its modification time then.
+        std::string text;         //!< The blocks read but not yet entirely supplied.
+        std::size_t start;        //!< The offset in text of the next line to supply.
+        std::uint64_t offset;     //!< The offset in the file of the next block to read.
+        bool failed;              //!< =true if the file changed or could not be read.
+        long supplied;            //!< Number of lines supplied so far.
+        long total;               //!< Number of lines in the file (once counted).
+        std::string workspace;    //!< Used for lines that need to be processed.
+        std::unique_ptr<LineInterner> interner; //!< Makes the lines (nullptr if none).
+        DiskEditFile::EndingCounts &endings; //!< Counts the endings of the lines supplied.
+        bool &lost; //!< Set if lines had to be supplied empty.
+
+        bool unchanged();
+        bool receive();
+        bool find_next(const char *&line, const char *&stop, bool &has_newline,
+                       DiskEditFile::EndingCounts &counts);
+    };
+
+    // The size of the blocks in which evicted files are read back.
+    constexpr std::size_t stored_block_size = 1024 * 1024;
+
+    StoredLines::StoredLines(std::string name, const std::uint64_t size,
+                             const unsigned long long stamp,
+                             DiskEditFile::EndingCounts &endings,
+                             std::unique_ptr<LineInterner> interner, bool &lost)
+        : name(std::move(name)), size(size), stamp(stamp), start(0), offset(0), failed(false),
+          supplied(0), total(0), interner(std::move(interner)), endings(endings), lost(lost)
+    {
+    }
+
+    //! Returns true if the file still has the size and modification time it had.
+    bool StoredLines::unchanged()
+    {
+        FileNameMatcher stamper;
+        stamper.set_name(name.c_str());
+        return stamper.next() != nullptr && stamper.size() == size &&
+               static_cast<unsigned long long>(stamper.modify_time()) == stamp;
+    }
+
+    //! Adds the next block of the file to the text.
+    /*!
+     * \return false if the file has changed or can't be read.
+     */
+    bool StoredLines::receive()
+    {
+        if (start > text.size() / 2) {
+            text.erase(0, start);
+            start = 0;
+        }
+        const std::size_t wanted =
+            static_cast<std::size_t>(std::min<std::uint64_t>(stored_block_size, size - offset));
+        if (failed || !unchanged() || !read_range(name.c_str(), offset, wanted, text) ||
+            !unchanged()) {
+            failed = true;
+            return false;
+        }
+        offset += wanted;
+        return true;
+    }
+
+    //! Finds the next line of the file, reading more of the file if necessary.
+    /*!
+     * \param counts Counts the line endings found (see find_line).
+     * \return false if there are no more lines or the rest of the file can't be read.
+     */
+    bool StoredLines::find_next(const char *&line, const char *&stop, bool &has_newline,
+                                DiskEditFile::EndingCounts &counts)
+    {
+        while (start < text.size() || (offset < size && !failed)) {
+            const bool complete = offset == size || failed;
+            line = text.data() + start;
+            const char *const end = text.data() + text.size();
+
+            // How the first line ends may depend on the text after it (see is_cr_file).
+            const bool undecided = counts.lf == 0 && counts.crlf == 0 && counts.cr == 0;
+            const char *const first_break = std::find_if(line, end, is_line_break);
+            if (!complete && (first_break == end ||
+                              (undecided && static_cast<std::size_t>(end - first_break) <=
+                                                cr_lookahead))) {
+                if (!receive())
+                    return false;
+                continue;
+            }
+
+            const char *const next = find_line(line, end, stop, has_newline, counts);
+            if (!has_newline && !complete) {
+                if (!receive())
+                    return false;
+                continue;
+            }
+            start = static_cast<std::size_t>(next - text.data());
+            return true;
+        }
+        return false;
+    }
+
+    //! Counts the lines in the file exactly as read_memory would install them.
+    /*!
+     * The whole file is read to do this, and read again as the lines are supplied.
+     *
+     * \return false if the file has changed or can't be read.
+     */
+    bool StoredLines::count()
+    {
+        DiskEditFile::EndingCounts counts;
+        const char *line;
+        const char *stop;
+        bool has_newline;
+        long lines = 0;
+        while (find_next(line, stop, has_newline, counts))
+            if (has_newline || std::any_of(line, stop, is_kept))
+                ++lines;
+        if (failed)
+            return false;
+        total = lines;
+        text.clear();
+        start = 0;
+        offset = 0;
+        return true;
+    }
+
+    EditBuffer *StoredLines::next_line()
+    {
+        Allocations::Scope tag(Allocations::DOCUMENT);
+        while (supplied < total) {
+            const char *line;
+            const char *stop;
+            bool has_newline;
+            if (!find_next(line, stop, has_newline, endings)) {
+                if (!lost)
+                    warning_message("A file changed on disk before its lines were read back");
+                lost = true;
+                ++supplied;
+                return new EditBuffer;
+            }
+            std::unique_ptr<EditBuffer> new_copy(
+                make_line(line, stop, workspace, interner.get()));
+            if (has_newline || new_copy->length() > 0) {
+                ++supplied;
+                return new_copy.release();
+            }
+        }
+        interner.reset();
+        return nullptr;
+    }
+
+    //! Returns the characters that end a line with the given ending.
+    std::string_view line_terminator(const DiskEditFile::LineEnding ending)
+    {
+        switch (ending) {
+        case DiskEditFile::CRLF:
+            return "\r\n";
+        case DiskEditFile::CR:
+            return "\r";
+        default:
+            return "\n";
+        }
+    }
+
+    //! Collects lines into large blocks and writes each block with a single std::fwrite.
+    /*!
+     * If the file is compressed each block is compressed instead and the library writes the
+     * result. Files are opened in binary mode and the line terminators are written here.
+     */
+    class BlockWriter {
+      public:
+        BlockWriter(std::FILE *disk, CompressedFile::Format format,
+                    DiskEditFile::LineEnding ending)
+            : disk(disk), block(new char[output_block_size]), used(0), failed(false),
+              terminator(line_terminator(ending))
+        {
+            if (format != CompressedFile::PLAIN)
+                encoder.reset(new CompressedFile::Encoder(disk, format));
+        }
+
+        ~BlockWriter() { delete[] block; }
+
+        BlockWriter(const BlockWriter &) = delete;
+        BlockWriter &operator=(const BlockWriter &) = delete;
+
+        bool write_line(const EditBuffer &line);
+        bool flush();
+        bool finish();
+
+      private:
+        std::FILE *disk;  //!< The file receiving the output.
+        char *block;      //!< Pending output.
+        std::size_t used; //!< Number of bytes in block.
+        bool failed;      //!< =true if a write error has been encountered.
+        std::unique_ptr<CompressedFile::Encoder> encoder; //!< Compresses the output, if any.
+        std::string_view terminator; //!< Written after each line.
+    };
+
+    //! Appends a line, without its trailing spaces, and its terminator to the output.
+    bool BlockWriter::write_line(const EditBuffer &line)
+    {
+        // Find the end of the text with a single backward scan over the trailing spaces.
+        std::size_t length = line.length();
+        while (length > 0 && line[length - 1] == ' ')
+            --length;
+
+        // Copy the line into the block, flushing as often as necessary for very long lines.
+        std::size_t offset = 0;
+        while (!failed && offset < length) {
+            if (used == output_block_size)
+                flush();
+            const std::size_t copied =
+                line.copy(block + used, std::min(length - offset, output_block_size - used),
+                          offset);
+            used += copied;
+            offset += copied;
+        }
+
+        if (used + terminator.size() > output_block_size)
+            flush();
+        std::memcpy(block + used, terminator.data(), terminator.size());
+        used += terminator.size();
+        return !failed;
+    }
+
+    //! Writes the pending output.
+    bool BlockWriter::flush()
+    {
+        if (!failed && used > 0) {
+            const bool written = encoder ? encoder->write(block, used)
+                                         : std::fwrite(block, 1, used, disk) == used;
+            if (!written)
+                failed = true;
+        }
+        used = 0;
+        return !failed;
+    }
+
+    //! Writes the pending output and ends the compressed stream, if any.
+    bool BlockWriter::finish()
+    {
+        if (flush() && encoder && !encoder->finish())
+            failed = true;
+        return !failed;
+    }
+
+    //! Returns true if a file can be saved by replacing it with a new file.
+    /*!
+     * Writing to a temporary file and renaming it over the original ensures that the original
+     * is never left half written. However, doing so would break symbolic and hard links so in
+     * those cases we write the file in place.
+     */
+    bool can_replace(const char *name)
+    {
+#if eOPSYS == ePOSIX
+        struct stat file_information;
+        if (lstat(name, &file_information) == -1)
+            return errno == ENOENT;
+        return S_ISREG(file_information.st_mode) && file_information.st_nlink == 1;
+#else
+        (void)name;
+        return true;
+#endif
+    }
+
+    //! Gives a replacement file the same permissions as the file it is replacing.
+    void copy_permissions(const char *original, std::FILE *replacement)
+    {
+#if eOPSYS == ePOSIX
+        struct stat file_information;
+        if (stat(original, &file_information) == 0) {
+            fchmod(fileno(replacement), file_information.st_mode & 07777);
+        }
+#else
+        (void)original;
+        (void)replacement;
+#endif
+    }
+
+    // =true if files loaded into empty objects are read by background threads.
+    bool background_loading = false;
 
-            // Print any pending spaces.
-            for (int i = 0; result != EOF && i < space_count; i++) {
-                result = std::putc(' ', disk);
+    // =true if repeated lines of the files loaded share their text (see LineInterner).
+    bool interning = false;
+
+    // =true if the undo history of each file saved is kept with it (see open_history).
+    bool keeping_history = false;
+
+    // The number of files being read in the background.
+    std::atomic<int> loads_outstanding{0};
+
+    // Upper limit on the number of files written at once by save_all.
+    constexpr unsigned maximum_savers = 8;
+
+    // The names of files save_all could not save are listed until the list is about this long.
+    constexpr std::size_t failure_list_limit = 60;
+
+    //! A file being read into lines by a task (see TaskPool).
+    struct LoadJob {
+        explicit LoadJob(const char *file_name) : name(file_name) {}
+        ~LoadJob();
+
+        std::string name;                //!< The file to read.
+        std::vector<EditBuffer *> lines; //!< The lines read so far.
+        std::size_t consumed = 0;        //!< Number of lines handed to the EditList.
+        DiskEditFile::EndingCounts endings; //!< The endings of the lines read.
+        bool interning = false;          //!< =true if repeated lines share their text.
+        LineInterner::Savings interned;  //!< What sharing saved.
+        bool failed = false;             //!< =true if the file could not be read entirely.
+        std::atomic<bool> cancelled{false}; //!< =true if the lines are no longer wanted.
+        TaskPool::Group reading{TaskPool::BACKGROUND}; //!< The task running the job.
+
+        void run();
+    };
+
+    LoadJob::~LoadJob()
+    {
+        for (std::size_t i = consumed; i < lines.size(); ++i) {
+            delete lines[i];
+        }
+    }
+
+    //! Reads the named file into memory, mapping the file if possible.
+    /*!
+     * \param image Holds the mapping, if the file could be mapped.
+     * \param contents Holds the text, if the file could not be mapped.
+     * \param text [out] The file's text, which is in image or contents.
+     * \return false if the file could not be read (entirely). Text holds whatever was read.
+     *
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    bool read_image(const char *name, MappedFile &image, std::string &contents,
+                    std::string_view &text)
+    {
+        const CompressedFile::Format format = CompressedFile::detect(name);
+        if (format != CompressedFile::PLAIN) {
+            const bool result = CompressedFile::read_all(name, format, contents);
+            text = contents;
+            return result;
+        }
+
+        if (image.open(name)) {
+            text = std::string_view(image.data(), image.size());
+            return true;
+        }
+
+        text = std::string_view();
+        std::FILE *disk = std::fopen(name, "rb");
+        if (disk == nullptr)
+            return false;
+        char block[output_block_size];
+        std::size_t count;
+        while ((count = std::fread(block, 1, sizeof(block), disk)) > 0)
+            contents.append(block, count);
+        const bool result = (std::ferror(disk) == 0);
+        std::fclose(disk);
+        text = contents;
+        return result;
+    }
+
+    //! Reads the file into lines exactly as DiskEditFile::load would.
+    void LoadJob::run()
+    {
+        Allocations::Scope tag(Allocations::DOCUMENT);
+        try {
+            MappedFile image;
+            std::string contents;
+            std::string_view text;
+            failed = !read_image(name.c_str(), image, contents, text);
+
+            std::unique_ptr<LineInterner> interner;
+            if (interning)
+                interner.reset(new LineInterner(interned));
+            for_each_line(text.data(), text.size(), endings, interner.get(),
+                          [this](std::unique_ptr<EditBuffer> &line) {
+                              lines.push_back(line.get());
+                              line.release();
+                              return !cancelled;
+                          });
+        }
+        catch (std::bad_alloc &) {
+            failed = true;
+        }
+    }
+
+    //! Supplies the lines of a file read in the background, waiting for them if necessary.
+    /*!
+     * The endings of the lines, and what sharing repeated lines saved, are added to the owner's
+     * counts once the file has been read.
+     */
+    class AsyncLines : public PendingLines {
+      public:
+        AsyncLines(const char *name, DiskEditFile::EndingCounts &endings,
+                   LineInterner::Savings &interned);
+        ~AsyncLines() override { job->cancelled = true; }
+
+        EditBuffer *next_line() override;
+        long remaining() override;
+
+      private:
+        std::shared_ptr<LoadJob> job; //!< The read in progress (shared with the pool).
+        bool finished;                //!< =true once the job is known to be done.
+        DiskEditFile::EndingCounts &endings; //!< Counts the endings of the lines read.
+        LineInterner::Savings &interned;     //!< Counts what sharing repeated lines saved.
+
+        void finish();
+    };
+
+    AsyncLines::AsyncLines(const char *name, DiskEditFile::EndingCounts &endings,
+                           LineInterner::Savings &interned)
+        : job(std::make_shared<LoadJob>(name)), finished(false), endings(endings),
+          interned(interned)
+    {
+        job->interning = interning;
+        ++loads_outstanding;
+        const std::shared_ptr<LoadJob> shared(job);
+        job->reading.run([shared]() {
+            Trace::Span span("read file");
+            shared->run();
+            --loads_outstanding;
+        });
+    }
+
+    //! Waits for the job, running it here if no worker has started it, and reports any problem.
+    void AsyncLines::finish()
+    {
+        if (finished)
+            return;
+        if (job->reading.busy()) {
+            std::string buffer("Reading ");
+            buffer.append(job->name);
+            buffer.append("...");
+            scr::MessageWindow teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
+            scr::refresh();
+            job->reading.wait();
+        }
+        finished = true;
+        endings.lf += job->endings.lf;
+        endings.crlf += job->endings.crlf;
+        endings.cr += job->endings.cr;
+        interned.lines += job->interned.lines;
+        interned.bytes += job->interned.bytes;
+        if (job->failed)
+            warning_message("Problems reading %s. File may be incomplete", job->name.c_str());
+    }
+
+    EditBuffer *AsyncLines::next_line()
+    {
+        finish();
+        return job->consumed < job->lines.size() ? job->lines[job->consumed++] : nullptr;
+    }
+
+    long AsyncLines::remaining()
+    {
+        finish();
+        return static_cast<long>(job->lines.size() - job->consumed);
+    }
+
+    //! Returns the name of the hidden file beside the named file that keeps its undo history.
+    std::string history_name(const char *name)
+    {
+#if eOPSYS == ePOSIX
+        const char *const separators = "/";
+#else
+        const char *const separators = "/\\:";
+#endif
+        std::string result(name);
+        const std::size_t slash = result.find_last_of(separators);
+        result.insert((slash == std::string::npos) ? 0 : slash + 1, ".");
+        result.append(".yxu");
+        return result;
+    }
+
+} // namespace
+
+/*==================================*/
+/*           Reload Jobs            */
+/*==================================*/
+
+//! A comparison of a file's data with a newer version of the file on disk.
+/*!
+ * Only the hashes of the old lines are needed, so once they have been taken the rest of the
+ * work can be done by another thread: the new version is read and hashed, the hunks that turn
+ * the old lines into the new ones are found, and the new lines those hunks insert are made.
+ */
+struct DiskEditFile::ReloadJob {
+    ReloadJob() = default;
+    explicit ReloadJob(const char *file_name) : name(file_name) {}
+
+    std::string name;                    //!< The file to read.
+    std::vector<std::size_t> old_hashes; //!< Hashes of the lines when the job was started.
+    std::vector<LineDiff::Hunk> hunks;   //!< The changes that give the new version.
+    std::vector<std::unique_ptr<EditBuffer>> lines; //!< The lines the hunks insert, in order.
+    FollowState extent;                  //!< How much of the file was read.
+    EndingCounts endings;                //!< The endings of the new version's lines.
+    bool failed = false;                 //!< =true if the file could not be read entirely.
+    TaskPool::CancelToken cancelled;     //!< Cancelled if the results are no longer wanted.
+
+    // The following are only used by the main thread.
+    DiskEditFile *owner = nullptr;        //!< The file being reloaded (nullptr if none).
+    decltype(DiskEditFile::file_time) saved_time{}; //!< The file's stamp before the job.
+    std::function<void()> finished;       //!< Called once the hunks have been applied.
+
+    void run();
+};
+
+//! Reads the file and finds how it differs from the old lines.
+void DiskEditFile::ReloadJob::run()
+{
+    Allocations::Scope tag(Allocations::DOCUMENT);
+    try {
+        MappedFile image;
+        std::string contents;
+        std::string_view text;
+        if (!read_image(name.c_str(), image, contents, text)) {
+            failed = true;
+            return;
+        }
+        measure(text, extent);
+
+        std::vector<std::size_t> new_hashes;
+        for_each_text(text.data(), text.size(), endings, [&](const std::string_view line) {
+            new_hashes.push_back(LineDiff::hash(line));
+            return !cancelled.cancelled();
+        });
+        if (cancelled.cancelled())
+            return;
+        hunks = LineDiff::compare(old_hashes, new_hashes);
+
+        // Only the lines inside the hunks are made into EditBuffers.
+        auto hunk = hunks.begin();
+        long index = 0;
+        EndingCounts recounted;
+        for_each_text(text.data(), text.size(), recounted, [&](const std::string_view line) {
+            while (hunk != hunks.end() && index >= hunk->new_first + hunk->new_count)
+                ++hunk;
+            if (hunk == hunks.end())
+                return false;
+            if (index++ >= hunk->new_first) {
+                std::unique_ptr<EditBuffer> new_copy(new EditBuffer(line.data(), line.size()));
+                lines.push_back(std::move(new_copy));
             }
+            return !cancelled.cancelled();
+        });
+    }
+    catch (std::bad_alloc &) {
+        failed = true;
+    }
+}
 
-            space_count = 0;
+//! Replaces hashes with the hashes of the lines in file_data.
+void DiskEditFile::hash_lines(std::vector<std::size_t> &hashes)
+{
+    hashes.clear();
+    hashes.reserve(static_cast<std::size_t>(file_data.size()));
+    file_data.jump_to(0);
+    const EditBuffer *line;
+    while ((line = file_data.read_next()) != nullptr)
+        hashes.push_back(LineDiff::hash(line->view()));
+}
 
-            // Print the character.
-            if (result != EOF) {
-                result = std::putc((*line)[offset], disk);
+//! Applies the hunks found by a job to file_data. Returns false if out of memory.
+/*!
+ * Each hunk is recorded for undo separately. The current point stays on the same text (and at
+ * the same place in the window) unless that text was itself replaced. The file's line endings
+ * become those of the new version. If lines of an evicted file were lost, the undo log is
+ * forgotten since it could only bring back the empty lines supplied in their place.
+ */
+bool DiskEditFile::apply_reload(ReloadJob &job)
+{
+    const long old_line = current_point.cursor_line();
+    const long new_line = LineDiff::follow(job.hunks, old_line);
+
+    // Work from the end so the positions of the hunks still to be applied don't move.
+    std::size_t next = job.lines.size();
+    try {
+        for (auto hunk = job.hunks.rbegin(); hunk != job.hunks.rend(); ++hunk) {
+            next -= static_cast<std::size_t>(hunk->new_count);
+            record_lines(hunk->old_first, hunk->old_count);
+            if (hunk->old_count == hunk->new_count)
+                mark_damaged(hunk->old_first, hunk->old_first + hunk->old_count - 1);
+            else
+                mark_damaged_from(hunk->old_first);
+
+            file_data.jump_to(hunk->old_first);
+            for (long i = 0; i < hunk->old_count; ++i) {
+                delete file_data.get();
+                file_data.erase();
+            }
+            for (long i = 0; i < hunk->new_count; ++i) {
+                file_data.insert(job.lines[next + i].get());
+                job.lines[next + i].release();
             }
         }
     }
+    catch (std::bad_alloc &) {
+        memory_message("Can't reload entire file");
+        return false;
+    }
+    endings = job.endings;
+    if (lines_lost) {
+        undo_log.clear();
+        lines_lost = false;
+    }
+
+    if (new_line != old_line) {
+        const long window_offset = old_line - current_point.window_line();
+        current_point.jump_to_line(new_line);
+        current_point.adjust_window_line(static_cast<int>(window_offset));
+    }
+    return true;
+}
+
+//! Records how much of a file image becomes complete and partial lines.
+void DiskEditFile::measure(const std::string_view text, FollowState &state)
+{
+    const std::size_t last_newline = text.rfind('\n');
+    state.size = text.size();
+    state.complete = (last_newline == std::string_view::npos) ? 0 : last_newline + 1;
+
+    // A final partial line is only a line if it has text (see for_each_text).
+    state.partial = std::any_of(text.begin() + state.complete, text.end(), is_kept);
+}
+
+//! Drops lines from the top of the file until no more than follow_limit remain.
+/*!
+ * The lines are not recorded for undo, so the undo history is forgotten.
+ */
+void DiskEditFile::drop_leading_lines()
+{
+    if (follow_limit <= 0 || file_data.size() <= follow_limit)
+        return;
+    const long excess = file_data.size() - follow_limit;
+    mark_modified(0, follow_limit);
+    try {
+        EditList dropped;
+        file_data.jump_to(0);
+        file_data.splice_out(excess, dropped);
+    }
+    catch (std::bad_alloc &) {
+        return;
+    }
+    undo_log.clear();
+    mark_damaged_from(0);
 
-    // Store a '\n' at the end of each line.
-    if (result != EOF)
-        result = std::putc('\n', disk);
+    const long window_offset = current_point.cursor_line() - current_point.window_line();
+    current_point.jump_to_line(std::max(current_point.cursor_line() - excess, 0L));
+    current_point.adjust_window_line(static_cast<int>(window_offset));
+}
 
-    return (result == EOF) ? false : true;
+//! Abandons the background reload in progress, if any.
+void DiskEditFile::cancel_reload()
+{
+    if (reload_job == nullptr)
+        return;
+    reload_job->cancelled.cancel();
+    reload_job->owner = nullptr;
+    file_time = reload_job->saved_time;
+    reload_job.reset();
 }
 
 /*=======================================*/
@@ -70,10 +1267,11 @@ static bool write_line(EditBuffer *line, std::FILE *disk)
  * Whatever data is already in the object is not destroyed or anyway touched.
  *
  * Notice that the name of the file is not considered. The function can handle arbitraryly long
- * lines by using a dynamic memory technique. In addition, tabs are expanded assuming 8 column
- * tab stops.
+ * lines by using a dynamic memory technique. Tabs are kept as they are. Lines end as they do
+ * for read_memory and their endings are counted the same way. The lines are made by the
+ * interner, if one is given.
  */
-bool DiskEditFile::read_disk(std::FILE *disk)
+bool DiskEditFile::read_disk(std::FILE *disk, LineInterner *const interner)
 {
     int ch;                     // A character from the file.
     char *workspace;            // Pointer to the current line from file being read.
@@ -92,15 +1290,37 @@ bool DiskEditFile::read_disk(std::FILE *disk)
     bool abort = false;
     while (!abort && (ch = std::getc(disk)) != EOF) {
 
-        // Ignore non-ASCII characters (not that control characters are still processed).
-        if (ch == 0 || (ch & 0x80))
+        // Ignore null characters (note that control characters are still processed).
+        if (ch == 0)
             continue;
 
+        // See find_line for the ways a line can end.
+        bool line_ended = false;
         if (ch == '\n') {
+            ++endings.lf;
+            line_ended = true;
+        }
+        else if (ch == '\r') {
+            const int following = std::getc(disk);
+            if (following == '\n') {
+                ++endings.crlf;
+                line_ended = true;
+            }
+            else {
+                if (following != EOF)
+                    std::ungetc(following, disk);
+                if (endings.cr != 0 || (endings.lf == 0 && endings.crlf == 0)) {
+                    ++endings.cr;
+                    line_ended = true;
+                }
+            }
+        }
+
+        if (line_ended) {
 
             // Terminate the workspace (there will always be room) and install the line.
             workspace[count] = '\0';
-            EditBuffer *new_copy = new EditBuffer(workspace);
+            EditBuffer *new_copy = new_line(std::string_view(workspace, count), interner);
             if (file_data.insert(new_copy) == nullptr)
                 abort = true;
 
@@ -116,14 +1336,8 @@ bool DiskEditFile::read_disk(std::FILE *disk)
         }
         else {
 
-            // Install the character (there will always be room even if tabs are expanded).
-            if (ch != '\t')
-                workspace[count++] = static_cast<char>(ch);
-            else {
-                int skip_distance = 8 - (count % 8);
-                for (int i = 0; i < skip_distance; i++)
-                    workspace[count++] = ' ';
-            }
+            // Install the character (there will always be room).
+            workspace[count++] = static_cast<char>(ch);
 
             // If workspace getting close to full, get a bigger space.
             if (chunk_size * chunk_count - count < 10) {
@@ -139,7 +1353,7 @@ bool DiskEditFile::read_disk(std::FILE *disk)
     // Install the last partial line, if there is one.
     workspace[count] = '\0';
     if (!std::ferror(disk) && std::strlen(workspace) > 0) {
-        EditBuffer *new_copy = new EditBuffer(workspace);
+        EditBuffer *new_copy = new_line(std::string_view(workspace, count), interner);
         if (file_data.insert(new_copy) == nullptr)
             abort = true;
     }
@@ -157,34 +1371,64 @@ bool DiskEditFile::read_disk(std::FILE *disk)
     return true;
 }
 
-//! Save file_data to a file. Returns false if disk write fails, but no message is printed.
+//! Reads a file image held in memory into file_data. Returns false if out of memory.
 /*!
- * Writes the data in the YEditFile to the previously opened file. The entire file is written.
- * It returns false if there is an error with the write or true otherwise.
+ * This function behaves like read_disk except that the text of the file is already available,
+ * typically because the file has been mapped into memory. Line boundaries are located with
+ * memchr and lines needing no character filtering (the usual case) are copied into their
+ * EditBuffers directly from the image with no intermediate workspace. Whatever data is already
+ * in the object is not destroyed or anyway touched.
+ *
+ * \param text Pointer to the first byte of the file image. May be nullptr if length is zero.
+ * \param length The number of bytes in the file image.
+ * \param interner Makes the lines, if given.
  */
-bool DiskEditFile::write_disk(std::FILE *disk)
+bool DiskEditFile::read_memory(const char *text, const std::size_t length,
+                               LineInterner *const interner)
 {
-    EditBuffer *line; // Refers to the currently active line.
-    int result = 0;   // =EOF if error encountered during write.
+    try {
+        for_each_line(text, length, endings, interner,
+                      [this](std::unique_ptr<EditBuffer> &line) {
+                          file_data.insert(line.get());
+                          line.release();
+                          return true;
+                      });
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't read entire file");
+        return false;
+    }
+    return true;
+}
 
-    // Jump out if the file is empty.
-    if (file_data.size() == 0L)
-        return true;
+//! Save file_data to a file. Returns false if disk write fails, but no message is printed.
+/*!
+ * Writes the data in the YEditFile to the previously opened file. The entire file is written,
+ * compressed in the given format. It returns false if there is an error with the write or true
+ * otherwise.
+ */
+bool DiskEditFile::write_disk(std::FILE *disk, const CompressedFile::Format format)
+{
+    const EditBuffer *line; // Refers to the currently active line.
+    BlockWriter writer(disk, format, line_ending());
+    bool result = true;
 
-    // For each line in the EditFile object...
+    // For each line in the EditFile object, except blank lines added past the end...
+    long remaining = saved_size();
     file_data.jump_to(0);
-    while (result != EOF && (line = file_data.next()) != nullptr) {
-        result = write_line(line, disk);
+    while (result && remaining-- > 0 && (line = file_data.read_next()) != nullptr) {
+        result = writer.write_line(*line);
     }
 
-    return static_cast<bool>(result != EOF);
+    return writer.finish() && result;
 }
 
 //! Save current block to a file. Returns false if disk write fails, but no message is printed.
-bool DiskEditFile::write_disk_block(std::FILE *disk)
+bool DiskEditFile::write_disk_block(std::FILE *disk, const CompressedFile::Format format)
 {
     EditBuffer *line;
-    int result = 0;
+    BlockWriter writer(disk, format, line_ending());
+    bool result = true;
 
     // Learn about block extent.
     long top;
@@ -197,17 +1441,24 @@ bool DiskEditFile::write_disk_block(std::FILE *disk)
 
     // For each line in the block...
     file_data.jump_to(top);
-    while (result != EOF && top++ <= bottom && (line = file_data.next()) != nullptr) {
-        result = write_line(line, disk);
+    while (result && top++ <= bottom && (line = file_data.next()) != nullptr) {
+        result = writer.write_line(*line);
     }
 
-    return static_cast<bool>(result != EOF);
+    return writer.finish() && result;
 }
 
 /*====================================*/
 /*           Public Members           */
 /*====================================*/
 
+DiskEditFile::~DiskEditFile()
+{
+    cancel_reload();
+    if (recovery_slot != 0)
+        Recovery::close(recovery_slot);
+}
+
 /*!
  * Sets the date and time stamp for a file to match that given by the file with the specified
  * name. If the file with the specified name does not exist, the date and time stamp of the
@@ -223,6 +1474,56 @@ void DiskEditFile::set_timestamp(const char *name)
     }
 }
 
+//! Returns the line ending used when the file is saved.
+/*!
+ * This is the most common ending among the lines read into the object, so a file keeps its
+ * line endings when it is saved even if a few lines ended differently. New files, and files
+ * where the endings are tied, use the system's usual ending.
+ */
+DiskEditFile::LineEnding DiskEditFile::line_ending() const
+{
+#if eOPSYS == ePOSIX
+    LineEnding result = LF;
+    long most = endings.lf;
+#else
+    LineEnding result = CRLF;
+    long most = endings.crlf;
+#endif
+    if (endings.lf > most) {
+        result = LF;
+        most = endings.lf;
+    }
+    if (endings.crlf > most) {
+        result = CRLF;
+        most = endings.crlf;
+    }
+    if (endings.cr > most)
+        result = CR;
+    return result;
+}
+
+//! Makes the file use the given line ending when it is next saved.
+/*!
+ * Every line of the saved file then ends the same way. The file is marked as changed since its
+ * contents on disk will differ.
+ */
+void DiskEditFile::set_line_ending(const LineEnding ending)
+{
+    endings = EndingCounts();
+    switch (ending) {
+    case LF:
+        endings.lf = 1;
+        break;
+    case CRLF:
+        endings.crlf = 1;
+        break;
+    case CR:
+        endings.cr = 1;
+        break;
+    }
+    is_changed = true;
+}
+
 /*!
  * Allows the client programs to change the status of is_changed. Normally is_changed is not
  * avaible to clients. It makes sense to let clients who need file I/O abilities to control the
@@ -257,9 +1558,29 @@ void DiskEditFile::mark_as_unchanged()
  * Tries to load the named file into the object. Since it uses read_file() from above, this load
  * will insert the named file into whatever is currently in the object. By making sure the
  * object is initially empty, this function can do complete loads as well as insertions.
+ *
+ * Regular files are mapped into memory and scanned in a single pass by read_memory. The
+ * mapping is released once the lines have been copied out so the file on disk remains free to
+ * change (or be reloaded) later. Files that can't be mapped are read with read_disk.
+ *
+ * A huge file loaded into an empty object is not copied out at once. Instead its mapping is
+ * handed to file_data as pending lines so the first screen can be shown immediately. The
+ * remaining lines are converted as the user moves through the file. Similarly, while
+ * background loading is enabled other files loaded into empty objects are read by worker
+ * threads. The first use of such a file's data waits for its read to finish.
+ *
+ * Files compressed with gzip or zstd are recognized by their contents and decompressed as they
+ * are read (see load_compressed). Files named ssh://host/path are read from another host
+ * (see load_remote). Files named hex:path are viewed as bytes (see load_hex).
+ *
+ * While interning is enabled, repeated lines of the file share their text (see LineInterner).
+ * What that saved is added to interned_lines.
  */
 bool DiskEditFile::load(const char *the_name)
 {
+    Profiler::Scope zone(Profiler::LOAD);
+    Allocations::Scope tag(Allocations::DOCUMENT);
+
     // Assume all will work.
     bool result;
 
@@ -268,15 +1589,53 @@ bool DiskEditFile::load(const char *the_name)
     //
     if (!extend_to_line(current_point.cursor_line() - 1))
         return false;
+    record_lines(current_point.cursor_line(), 0L);
     file_data.jump_to(current_point.cursor_line());
 
-    // Try to open the file.
-    std::FILE *disk;
-    if ((disk = std::fopen(the_name, "r")) == nullptr) {
+    // Compressed files are decompressed as they are read. An empty object takes on the format.
+    const CompressedFile::Format format = CompressedFile::detect(the_name);
+    if (file_data.size() == 0) {
+        disk_format = format;
+        endings = EndingCounts();
+        interned = LineInterner::Savings();
+    }
+    std::unique_ptr<LineInterner> interner;
+    if (interning)
+        interner.reset(new LineInterner(interned));
+    if (RemoteFile::is_remote(the_name))
+        return load_remote(the_name, std::move(interner));
+    if (HexImage::is_hex(the_name))
+        return load_hex(the_name);
+    if (format != CompressedFile::PLAIN)
+        return load_compressed(the_name, format, interner.get());
+
+    // Map the file if possible. Otherwise, fall back to reading it as a stream.
+    std::unique_ptr<MappedFile> image(new MappedFile);
+    std::FILE *disk = nullptr;
+    if (!image->open(the_name) && (disk = std::fopen(the_name, "rb")) == nullptr) {
         error_message("Can't open %s for reading", the_name);
         return false;
     }
 
+    // Huge files and files read in the background become lines later.
+    if (disk == nullptr && file_data.size() == 0) {
+        if (image->size() >= lazy_threshold) {
+            mark_damaged_from(current_point.cursor_line());
+            file_data.set_pending(
+                std::unique_ptr<PendingLines>(
+                    new MappedLines(std::move(image), endings, std::move(interner))));
+            file_data.set_warm_limit(warm_chunk_limit);
+            return true;
+        }
+        if (background_loading) {
+            image->close();
+            mark_damaged_from(current_point.cursor_line());
+            file_data.set_pending(
+                std::unique_ptr<PendingLines>(new AsyncLines(the_name, endings, interned)));
+            return true;
+        }
+    }
+
     // Inform the user that we're reading a file.
     std::string buffer("Reading ");
     buffer.append(the_name);
@@ -285,8 +1644,15 @@ bool DiskEditFile::load(const char *the_name)
     scr::refresh();
 
     // Do the dirty work and record result for after Teaser window is gone.
-    result = read_disk(disk);
-    std::fclose(disk);
+    mark_damaged_from(current_point.cursor_line());
+    if (disk == nullptr) {
+        result = read_memory(image->data(), image->size(), interner.get());
+        image->close();
+    }
+    else {
+        result = read_disk(disk, interner.get());
+        std::fclose(disk);
+    }
 
     Teaser.close();
 
@@ -297,19 +1663,824 @@ bool DiskEditFile::load(const char *the_name)
     return result;
 }
 
+//! Inserts the named file above the current point.
 /*!
- * Saves the data to the named file. Depending on save_mode either the whole file is saved or
- * just the active block is saved. This function is complicated by the need to check the result
- * of std::fclose(). For writes, std::fclose() dumps the last part of the file. To truely know
- * if the file was all written correctly, we must check the result of std::fclose(). The return
- * value from write_file() is not enough.
+ * The file's lines are read into a list of their own (on several workers if the file is
+ * large) and then spliced into the data at once. Thus the insertion is a single modification,
+ * recorded once for undo, however many lines it has, and nothing is modified if the file
+ * can't be read. The lines end as they do in the file inserted, whatever the lines already
+ * in the object end with. Files that can't be mapped are loaded into place (see load).
  *
- * Although this is kind of a pain, it leaves write_file() generic. For example, write_file()
- * could be used several times to write different chunks of data to the same file (although Y
- * currently does not do this).
+ * \return false if the file could not be read or if out of memory.
  */
-bool DiskEditFile::save(const char *the_name, Mode save_mode)
+bool DiskEditFile::insert_file(const char *const the_name)
 {
+    Profiler::Scope zone(Profiler::LOAD);
+    Allocations::Scope tag(Allocations::DOCUMENT);
+
+    MappedFile image;
+    if (RemoteFile::is_remote(the_name) || HexImage::is_hex(the_name) ||
+        CompressedFile::detect(the_name) != CompressedFile::PLAIN || !image.open(the_name))
+        return load(the_name);
+
+    std::string buffer("Reading ");
+    buffer.append(the_name);
+    buffer.append("...");
+    scr::MessageWindow teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
+    scr::refresh();
+
+    EditList fragment;
+    EndingCounts counts;
+    try {
+        std::unique_ptr<LineInterner> interner;
+        if (interning)
+            interner.reset(new LineInterner(interned));
+        read_fragment(image.data(), image.size(), counts, interner.get(), fragment);
+        image.close();
+
+        if (!extend_to_line(current_point.cursor_line() - 1))
+            return false;
+        record_lines(current_point.cursor_line(), 0L);
+        mark_damaged_from(current_point.cursor_line());
+        file_data.jump_to(current_point.cursor_line());
+        file_data.splice_in(fragment);
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't insert the file");
+        return false;
+    }
+    endings.lf += counts.lf;
+    endings.crlf += counts.crlf;
+    endings.cr += counts.cr;
+    return true;
+}
+
+//! Loads a compressed file, breaking the text into lines while it is being decompressed.
+/*!
+ * Decompression is done by another thread (see CompressedFile::read) so the cost of loading
+ * is little more than the larger of the two jobs.
+ */
+bool DiskEditFile::load_compressed(const char *the_name, const CompressedFile::Format format,
+                                   LineInterner *const interner)
+{
+    if (!CompressedFile::available(format)) {
+        error_message("Can't read %s (%s files are not supported)", the_name,
+                      CompressedFile::format_name(format));
+        return false;
+    }
+
+    std::string buffer("Reading ");
+    buffer.append(the_name);
+    buffer.append("...");
+    scr::MessageWindow teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
+    scr::refresh();
+    mark_damaged_from(current_point.cursor_line());
+
+    // Only complete lines are read from each block. The rest is kept for the next block.
+    std::string partial;
+    bool enough_memory = true;
+    bool result = CompressedFile::read(the_name, format, [&](std::string_view block) {
+        try {
+            // Finish the line left over from the previous block.
+            if (!partial.empty()) {
+                const std::size_t first = block.find('\n');
+                if (first == std::string_view::npos) {
+                    partial.append(block);
+                    return true;
+                }
+                partial.append(block.substr(0, first + 1));
+                enough_memory = read_memory(partial.data(), partial.size(), interner);
+                partial.clear();
+                block.remove_prefix(first + 1);
+            }
+            const std::size_t last = block.rfind('\n');
+            const std::size_t complete = (last == std::string_view::npos) ? 0 : last + 1;
+            if (enough_memory)
+                enough_memory = read_memory(block.data(), complete, interner);
+            partial.assign(block.substr(complete));
+        }
+        catch (std::bad_alloc &) {
+            memory_message("Can't read entire file");
+            enough_memory = false;
+        }
+        return enough_memory;
+    });
+    if (enough_memory)
+        enough_memory = read_memory(partial.data(), partial.size(), interner);
+
+    teaser.close();
+    if (!result)
+        warning_message("Problems reading %s. File may be incomplete", the_name);
+    return result && enough_memory;
+}
+
+//! Loads a file from another host (see RemoteFile).
+/*!
+ * A large file loaded into an empty object becomes lines only as they are needed and only the
+ * blocks holding those lines are read (see RemoteLines). Otherwise the whole file is read.
+ */
+bool DiskEditFile::load_remote(const char *the_name, std::unique_ptr<LineInterner> interner)
+{
+    std::unique_ptr<RemoteFile> remote = RemoteFile::connect(the_name);
+    if (!remote) {
+        error_message("Can't reach the host of %s", the_name);
+        return false;
+    }
+    if (!remote->exists()) {
+        error_message("Can't open %s for reading", the_name);
+        RemoteFile::keep(std::move(remote));
+        return false;
+    }
+
+    std::string buffer("Reading ");
+    buffer.append(the_name);
+    buffer.append("...");
+    scr::MessageWindow teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
+    scr::refresh();
+    mark_damaged_from(current_point.cursor_line());
+
+    bool result;
+    try {
+        if (file_data.size() == 0 && remote->size() >= remote_lazy_threshold) {
+            // The last block tells whether the file ends with a partial line.
+            std::string first;
+            std::string last;
+            long count = 0;
+            result = remote->request(0) && remote->request(remote->blocks() - 1) &&
+                     remote->receive(first) && remote->receive(last) && !last.empty();
+            if (result) {
+                const char *const begin = first.data();
+                const char *const end = begin + first.size();
+                const bool cr_mode = is_cr_file(std::find_if(begin, end, is_line_break), end);
+                result = remote->count_lines(cr_mode, count);
+                if (!is_line_break(last.back()))
+                    ++count;
+            }
+            if (result) {
+                file_data.set_pending(std::unique_ptr<PendingLines>(new RemoteLines(
+                    std::move(remote), std::move(first), count, endings, std::move(interner))));
+                file_data.set_warm_limit(warm_chunk_limit);
+            }
+        }
+        else {
+            std::string text;
+            result = remote->read_all(text) &&
+                     read_memory(text.data(), text.size(), interner.get());
+        }
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't read entire file");
+        result = false;
+    }
+    if (remote)
+        RemoteFile::keep(std::move(remote));
+
+    teaser.close();
+    if (!result)
+        warning_message("Problems reading %s. File may be incomplete", the_name);
+    return result;
+}
+
+//! Views the bytes of a file named hex:path (see HexImage).
+/*!
+ * The file is only mapped. The data stays empty since the rows are made from the mapping as
+ * they are shown (see YEditFile::display), so the size of the file doesn't matter. A file
+ * can't be viewed this way inside another one.
+ */
+bool DiskEditFile::load_hex(const char *const the_name)
+{
+    if (file_data.size() != 0 || hex != nullptr) {
+        error_message("Can't insert %s into a file", the_name);
+        return false;
+    }
+    std::unique_ptr<HexImage> image(new HexImage);
+    if (!image->open(HexImage::path_of(the_name))) {
+        error_message("Can't open %s for reading", HexImage::path_of(the_name));
+        return false;
+    }
+    mark_damaged_from(0L);
+    hex = std::move(image);
+    return true;
+}
+
+//! Maps the file viewed as bytes again, forgetting the bytes changed since it was written.
+bool DiskEditFile::reload_hex(const char *const the_name)
+{
+    if (!hex->open(HexImage::path_of(the_name))) {
+        error_message("Can't reload %s", the_name);
+        return false;
+    }
+    mark_damaged_from(0L);
+    set_timestamp(the_name);
+    is_changed = false;
+    return true;
+}
+
+//! Makes the data match the named file by replacing only the lines that differ.
+/*!
+ * Unlike erasing the data and loading the file again this leaves the unchanged lines, and thus
+ * the current point's place in the text, alone. The replacements are recorded for undo. The
+ * data is marked as unchanged and given the file's time stamp, which is taken before the file
+ * is read so that a change made during the read is noticed later.
+ *
+ * \return false if the file could not be read or there was insufficient memory.
+ */
+bool DiskEditFile::reload(const char *the_name)
+{
+    if (hex != nullptr)
+        return reload_hex(the_name);
+    cancel_reload();
+    ReloadJob job(the_name);
+    job.saved_time = file_time;
+    set_timestamp(the_name);
+    hash_lines(job.old_hashes);
+
+    std::string buffer("Reading ");
+    buffer.append(the_name);
+    buffer.append("...");
+    scr::MessageWindow Teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
+    scr::refresh();
+    job.run();
+    Teaser.close();
+
+    if (job.failed) {
+        file_time = job.saved_time;
+        error_message("Can't reload %s", the_name);
+        return false;
+    }
+    if (!apply_reload(job))
+        return false;
+    is_changed = false;
+    if (following) {
+        followed = job.extent;
+        drop_leading_lines();
+    }
+    return true;
+}
+
+//! Discards the lines of an unchanged file, leaving them to be read again when needed.
+/*!
+ * The lines are read back from the file as they are visited (see StoredLines). This is only
+ * done if the file on disk is the one the lines were read from or last saved to, so that the
+ * lines read are the same ones. Everything kept by line number, such as the current point,
+ * the undo log and the indexes of the file, thus remains valid. The file is not kept open or
+ * mapped meanwhile; instead its size and modification time are checked before each read. If
+ * it has changed, the lines not yet read are lost and the file must be reloaded, which the
+ * FileWatcher does for unchanged files. Reloading then forgets the undo log, and the file
+ * can't be saved until it is reloaded. A file evicted before can be evicted again, discarding
+ * the lines visited since. Files that are changed, followed, compressed, or being reloaded are
+ * left alone, as are files that can't be read. Nothing is evicted while files are being read
+ * in the background.
+ *
+ * \return true if the lines were discarded.
+ */
+bool DiskEditFile::evict(const char *the_name)
+{
+    if (is_changed || following || reload_job != nullptr ||
+        disk_format != CompressedFile::PLAIN || background_loads() != 0 ||
+        file_data.all_mapped() || lines_lost)
+        return false;
+
+    FileNameMatcher stamper;
+    stamper.set_name(the_name);
+    if (stamper.next() == nullptr || stamper.modify_time() != time())
+        return false;
+
+    // The lines are only counted here. Their endings are counted again as they are supplied.
+    std::unique_ptr<LineInterner> interner;
+    if (interning)
+        interner.reset(new LineInterner(interned));
+    std::unique_ptr<StoredLines> lines(
+        new StoredLines(the_name, stamper.size(),
+                        static_cast<unsigned long long>(stamper.modify_time()), endings,
+                        std::move(interner), lines_lost));
+    if (!lines->count() || lines->remaining() != file_data.size())
+        return false;
+    endings = EndingCounts();
+    interned = LineInterner::Savings();
+    file_data.clear();
+    file_data.set_pending(std::move(lines));
+    return true;
+}
+
+//! Reloads as reload does but, for large files, reads and compares on a worker thread.
+/*!
+ * A background reload is applied on the main thread, after which finished is called. The
+ * reload is abandoned if the data is modified before then, if another reload is started, or if
+ * the object is destroyed. Small files are reloaded before this function returns.
+ */
+void DiskEditFile::reload_in_background(const char *the_name, std::function<void()> finished)
+{
+    if (file_data.size() < background_reload_threshold) {
+        if (reload(the_name))
+            finished();
+        return;
+    }
+
+    cancel_reload();
+    reload_job = std::make_shared<ReloadJob>(the_name);
+    reload_job->owner = this;
+    reload_job->saved_time = file_time;
+    reload_job->finished = std::move(finished);
+    set_timestamp(the_name);
+    hash_lines(reload_job->old_hashes);
+
+    const std::weak_ptr<ReloadJob> posted(reload_job);
+    TaskPool::submit(
+        [job = reload_job]() { job->run(); },
+        [posted]() {
+            const std::shared_ptr<ReloadJob> job = posted.lock();
+            if (job == nullptr || job->owner == nullptr)
+                return;
+
+            // The hunks are only valid for the lines they were found from.
+            DiskEditFile &file = *job->owner;
+            file.reload_job.reset();
+            std::vector<std::size_t> hashes;
+            file.hash_lines(hashes);
+            if (job->failed || file.is_changed || hashes != job->old_hashes) {
+                file.file_time = job->saved_time;
+                return;
+            }
+
+            UndoLog::next_command();
+            const bool applied = file.apply_reload(*job);
+            UndoLog::next_command();
+            if (applied) {
+                if (file.following) {
+                    file.followed = job->extent;
+                    file.drop_leading_lines();
+                }
+                job->finished();
+            }
+        },
+        reload_job->cancelled);
+}
+
+//! Starts following the named file, as for a log that other programs append to.
+/*!
+ * The data is first reloaded so it matches the file. After that read_appended adds the text
+ * appended to the file.
+ *
+ * \param line_limit The most lines kept. Older lines are dropped from the top as new ones are
+ * read. Zero for no limit.
+ * \return false if the file could not be read.
+ */
+bool DiskEditFile::start_following(const char *the_name, const long line_limit)
+{
+    following = true;
+    follow_limit = line_limit;
+    if (!reload(the_name)) {
+        following = false;
+        return false;
+    }
+    return true;
+}
+
+//! Appends the lines added to the named file since it was last read while following it.
+/*!
+ * Only the bytes past the part already read are converted. A last line that was read before
+ * its newline was written is replaced once more of it arrives. The appended lines are not
+ * recorded for undo, so replacing such a line forgets the undo history (as does dropping lines
+ * to stay within the line limit). If the current point was on the last line it moves to the
+ * new last line. A file that has become shorter, perhaps because the log was rotated, is
+ * reloaded instead.
+ *
+ * \return true if the data changed.
+ */
+bool DiskEditFile::read_appended(const char *the_name)
+{
+    if (!following)
+        return false;
+
+    MappedFile image;
+    std::string contents;
+    std::string_view text;
+    try {
+        if (!read_image(the_name, image, contents, text))
+            return false;
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't read the end of the file");
+        return false;
+    }
+    if (text.size() < followed.size)
+        return reload(the_name);
+    if (text.size() == followed.size)
+        return false;
+
+    const long old_size = file_data.size();
+    const bool at_end = current_point.cursor_line() >= old_size - 1;
+    long first = old_size;
+    if (followed.partial && old_size > 0) {
+        first = old_size - 1;
+        file_data.jump_to(first);
+        delete file_data.get();
+        file_data.erase();
+        undo_log.clear();
+    }
+
+    const std::string_view added = text.substr(followed.complete);
+    mark_damaged_from(first);
+    mark_modified(first, 0);
+    file_data.jump_to(first);
+    const bool result = read_memory(added.data(), added.size());
+
+    FollowState extent;
+    measure(added, extent);
+    followed.size = text.size();
+    followed.complete += extent.complete;
+    followed.partial = extent.partial;
+    set_timestamp(the_name);
+
+    drop_leading_lines();
+    if (at_end && file_data.size() > 0)
+        current_point.jump_to_line(file_data.size() - 1);
+    return result;
+}
+
+//! Inserts lines held in memory above the current point, as load does for a file.
+/*!
+ * The text is broken into lines exactly as if it had been loaded from a file. The insertion is
+ * recorded for undo.
+ *
+ * \param text Pointer to the first byte of the text. May be nullptr if length is zero.
+ * \param length The number of bytes of text.
+ * \return false if out of memory. The text may have been partly inserted.
+ */
+bool DiskEditFile::insert_text(const char *const text, const std::size_t length)
+{
+    if (!extend_to_line(current_point.cursor_line() - 1))
+        return false;
+    record_lines(current_point.cursor_line(), 0L);
+    file_data.jump_to(current_point.cursor_line());
+    mark_damaged_from(current_point.cursor_line());
+    is_changed = true;
+    return read_memory(text, length);
+}
+
+//! Appends lines held in memory to the end of the file without recording them for undo.
+/*!
+ * This is used for text arriving from outside the editor, such as the output of a background
+ * job. The current point and the changed flag are left alone.
+ *
+ * \param text Pointer to the first byte of the text. May be nullptr if length is zero.
+ * \param length The number of bytes of text.
+ * \return false if out of memory. The text may have been partly appended.
+ */
+bool DiskEditFile::append_text(const char *const text, const std::size_t length)
+{
+    const long end = file_data.size();
+    mark_damaged_from(end);
+    mark_modified(end, 0);
+    file_data.jump_to(end);
+    return read_memory(text, length);
+}
+
+//! Brings the recovery data kept for the file up to date with its unsaved changes.
+/*!
+ * The first unsaved change takes a snapshot of every line (see Recovery). After that only the
+ * lines modified since the previous call are journaled. The data is discarded once the file
+ * has no unsaved changes. This is meant to be called whenever the editor is idle.
+ *
+ * \param the_name The name of the file, which is recorded with the data.
+ */
+void DiskEditFile::checkpoint(const char *the_name)
+{
+    const EditDelta change = take_modifications(RECOVERY);
+    // The bytes changed in a file viewed as bytes are not journaled.
+    if (!is_changed || hex != nullptr) {
+        if (recovery_slot != 0)
+            Recovery::close(recovery_slot);
+        recovery_slot = 0;
+        return;
+    }
+
+    if (recovery_slot == 0 || recovery_name != the_name) {
+        if (recovery_slot != 0)
+            Recovery::close(recovery_slot);
+        recovery_name = the_name;
+        recovery_slot = Recovery::open(recovery_name, file_data);
+    }
+    else if (!change.empty()) {
+        Recovery::append(
+            recovery_slot, change.first, change.old_count, file_data, change.new_count);
+    }
+}
+
+//! Checkpoints the file and replaces its snapshot if the journal has grown large.
+/*!
+ * This is meant to be called periodically so that recovering a file doesn't mean replaying a
+ * long journal.
+ */
+void DiskEditFile::autosave(const char *the_name)
+{
+    checkpoint(the_name);
+    if (recovery_slot != 0 && Recovery::needs_snapshot(recovery_slot))
+        Recovery::snapshot(recovery_slot, file_data);
+}
+
+//! Makes the data match the given lines by replacing only the lines that differ.
+/*!
+ * This is used to restore unsaved changes found by Recovery::recover. As with reload the
+ * replacements are recorded for undo, so the restored changes can be undone. The data is
+ * marked as changed if any lines differ.
+ *
+ * \return false if there was insufficient memory.
+ */
+bool DiskEditFile::restore(EditList &lines)
+{
+    cancel_reload();
+    ReloadJob job;
+    hash_lines(job.old_hashes);
+    try {
+        std::vector<std::size_t> new_hashes;
+        new_hashes.reserve(static_cast<std::size_t>(lines.size()));
+        lines.jump_to(0);
+        const EditBuffer *line;
+        while ((line = lines.next()) != nullptr)
+            new_hashes.push_back(LineDiff::hash(line->view()));
+        job.hunks = LineDiff::compare(job.old_hashes, new_hashes);
+
+        for (const LineDiff::Hunk &hunk : job.hunks) {
+            lines.jump_to(hunk.new_first);
+            for (long i = 0; i < hunk.new_count; ++i)
+                job.lines.emplace_back(new EditBuffer(*lines.next()));
+        }
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't restore the unsaved changes");
+        return false;
+    }
+    if (!apply_reload(job))
+        return false;
+    if (!job.hunks.empty())
+        is_changed = true;
+    return true;
+}
+
+//! Enables or disables reading files in the background (see load).
+void DiskEditFile::set_background_loading(const bool enabled)
+{
+    background_loading = enabled;
+}
+
+//! Enables or disables sharing the text of repeated lines in the files loaded (see load).
+void DiskEditFile::set_interning(const bool enabled)
+{
+    interning = enabled;
+}
+
+//! Returns true if repeated lines in the files loaded share their text.
+bool DiskEditFile::is_interning()
+{
+    return interning;
+}
+
+//! Enables or disables keeping the undo history of the files saved (see open_history).
+void DiskEditFile::set_keeping_history(const bool enabled)
+{
+    keeping_history = enabled;
+}
+
+//! Returns true if the undo history of the files saved is kept with them.
+bool DiskEditFile::is_keeping_history()
+{
+    return keeping_history;
+}
+
+//! Takes up the undo history kept when the named file was last saved, if any.
+/*!
+ * The history is kept beside the file, in a hidden file with the extension .yxu, while
+ * keeping histories is enabled. It is mapped into memory and nothing more is done with it
+ * until the file's modifications in this session have all been undone. It is checked against
+ * the file's lines then (see UndoLog). This must be called just after the file is loaded.
+ */
+void DiskEditFile::open_history(const char *the_name)
+{
+    if (!keeping_history)
+        return;
+    try {
+        std::unique_ptr<MappedFile> image(new MappedFile);
+        if (image->open(history_name(the_name).c_str()))
+            undo_log.open_history(std::move(image));
+    }
+    catch (std::bad_alloc &) {
+        // The history is not essential.
+    }
+}
+
+//! Keeps the undo history with the named file, which now holds the data (see open_history).
+/*!
+ * Like write_file this does nothing with the screen. A history that can't be written is lost
+ * without comment. A history that no longer applies is removed.
+ */
+void DiskEditFile::write_history(const char *the_name)
+{
+    const std::string name = history_name(the_name);
+    const std::string temporary_name = name + ".yxt";
+    bool written = false;
+    try {
+        std::string image;
+        if (undo_log.write_history(file_data, image)) {
+            std::FILE *const disk = std::fopen(temporary_name.c_str(), "wb");
+            if (disk != nullptr) {
+                written = std::fwrite(image.data(), 1, image.size(), disk) == image.size();
+                written = std::fclose(disk) == 0 && written;
+                written = written && replace_file(temporary_name.c_str(), name.c_str());
+                if (!written)
+                    std::remove(temporary_name.c_str());
+            }
+        }
+    }
+    catch (std::bad_alloc &) {
+    }
+    if (!written)
+        std::remove(name.c_str());
+}
+
+//! Returns the number of background reads that have not yet finished.
+int DiskEditFile::background_loads()
+{
+    return loads_outstanding;
+}
+
+//! Writes the data to the named file without telling the user anything.
+/*!
+ * This function is complicated by the need to check the result of std::fclose(). For writes,
+ * std::fclose() dumps the last part of the file. To truely know if the file was all written
+ * correctly, we must check the result of std::fclose(). The return value from write_disk() is
+ * not enough.
+ *
+ * Although this is kind of a pain, it leaves write_disk() generic. For example, write_disk()
+ * could be used several times to write different chunks of data to the same file (although Y
+ * currently does not do this).
+ *
+ * When possible the data is written to a temporary file which is then renamed over the named
+ * file. Thus a failed save leaves the original file intact. Files that are symbolic links or
+ * that have multiple hard links are written in place so the links are preserved.
+ *
+ * The file is compressed as given by save_format. Its lines end as given by line_ending.
+ * While keeping histories is enabled, the undo history of a file saved entirely is kept with
+ * it (see write_history).
+ *
+ * Nothing here touches the screen or any other file, so different files can be written by
+ * different threads at once. Lines still pending in a mapped image must already have been
+ * copied out (by set_end).
+ *
+ * \param byte_count [out] The number of bytes written.
+ */
+DiskEditFile::WriteStatus DiskEditFile::write_file(const char *the_name, Mode save_mode,
+                                                   long &byte_count)
+{
+    byte_count = 0;
+    if (RemoteFile::is_remote(the_name))
+        return write_remote(the_name, save_mode, byte_count);
+    if (hex != nullptr)
+        return write_hex(the_name, save_mode, byte_count);
+    const CompressedFile::Format format = save_format(the_name, save_mode);
+    if (!CompressedFile::available(format))
+        return UNSUPPORTED;
+
+    // Write to a temporary file in the same directory if possible. Otherwise write in place.
+    std::string temporary_name;
+    std::FILE *disk = nullptr;
+    if (can_replace(the_name)) {
+        temporary_name = the_name;
+        temporary_name.append(".yxt");
+        if ((disk = std::fopen(temporary_name.c_str(), "wb")) != nullptr)
+            copy_permissions(the_name, disk);
+        else
+            temporary_name.clear();
+    }
+    if (disk == nullptr && (disk = std::fopen(the_name, "wb")) == nullptr)
+        return NOT_OPENED;
+
+    // Do the bulk of the work.
+    bool result1;
+    if (save_mode == ALL)
+        result1 = write_disk(disk, format);
+    else
+        result1 = write_disk_block(disk, format);
+    byte_count = std::ftell(disk);
+
+    bool result2 = static_cast<bool>(std::fclose(disk) == 0);
+
+    // result == true only if both write_disk() and std::fclose() worked.
+    bool result = static_cast<bool>(result1 == true && result2 == true);
+    if (temporary_name.empty() && !result)
+        return DAMAGED;
+
+    // Put the new file in place of the original. The original is untouched if anything failed.
+    if (!temporary_name.empty()) {
+        if (result)
+            result = replace_file(temporary_name.c_str(), the_name);
+        if (!result) {
+            std::remove(temporary_name.c_str());
+            return NOT_WRITTEN;
+        }
+    }
+    if (save_mode == ALL && keeping_history)
+        write_history(the_name);
+    return WRITTEN;
+}
+
+//! Writes the data to a file on another host (see RemoteFile).
+/*!
+ * The text is laid out in a temporary file, exactly as write_file would write it, and then only
+ * the parts that differ from the file on the host are sent. Remote files are not compressed.
+ */
+DiskEditFile::WriteStatus DiskEditFile::write_remote(const char *the_name, Mode save_mode,
+                                                     long &byte_count)
+{
+    std::FILE *scratch = std::tmpfile();
+    if (scratch == nullptr)
+        return NOT_OPENED;
+    bool result;
+    if (save_mode == ALL)
+        result = write_disk(scratch, CompressedFile::PLAIN);
+    else
+        result = write_disk_block(scratch, CompressedFile::PLAIN);
+
+    std::string image;
+    const long size = std::ftell(scratch);
+    if (result && size > 0) {
+        try {
+            image.resize(static_cast<std::size_t>(size));
+            std::rewind(scratch);
+            result = std::fread(&image[0], 1, image.size(), scratch) == image.size();
+        }
+        catch (std::bad_alloc &) {
+            result = false;
+        }
+    }
+    std::fclose(scratch);
+    if (!result)
+        return NOT_WRITTEN;
+
+    std::unique_ptr<RemoteFile> remote = RemoteFile::connect(the_name);
+    if (!remote)
+        return NOT_OPENED;
+    result = remote->write(image);
+    RemoteFile::keep(std::move(remote));
+    if (!result)
+        return NOT_WRITTEN;
+    byte_count = static_cast<long>(image.size());
+    return WRITTEN;
+}
+
+//! Writes the bytes changed in a file viewed as bytes, in place (see HexImage::write).
+/*!
+ * The bytes can only be written to the file they came from, and only all together.
+ */
+DiskEditFile::WriteStatus DiskEditFile::write_hex(const char *the_name, Mode save_mode,
+                                                  long &byte_count)
+{
+    if (save_mode != ALL || !HexImage::is_hex(the_name))
+        return NOT_OPENED;
+    const std::size_t changed = hex->patched();
+    switch (hex->write(HexImage::path_of(the_name))) {
+    case HexImage::WRITTEN:
+        break;
+    case HexImage::NOT_OPENED:
+        return NOT_OPENED;
+    case HexImage::DAMAGED:
+        return DAMAGED;
+    }
+    byte_count = static_cast<long>(changed);
+    return WRITTEN;
+}
+
+//! Returns the format in which the data is compressed when it is saved to the named file.
+/*!
+ * A name ending with a compressed file extension is always compressed accordingly. Otherwise
+ * the whole file is saved in the format it was loaded from, so an archive that lacks the usual
+ * extension stays compressed. A block saved to another file is not compressed.
+ */
+CompressedFile::Format DiskEditFile::save_format(const char *the_name, Mode save_mode)
+{
+    const CompressedFile::Format format = CompressedFile::format_for(the_name);
+    if (format == CompressedFile::PLAIN && save_mode == ALL)
+        return disk_format;
+    return format;
+}
+
+/*!
+ * Saves the data to the named file. Depending on save_mode either the whole file is saved or
+ * just the active block is saved (see write_file). The write throughput is reported for large
+ * files.
+ */
+bool DiskEditFile::save(const char *the_name, Mode save_mode)
+{
+    Profiler::Scope zone(Profiler::SAVE);
+
+    // Lines still pending in a mapped image must be copied out before the file is rewritten.
+    file_data.set_end();
+    if (lines_lost) {
+        error_message("%s changed on disk while it was evicted. Reload it first", the_name);
+        return false;
+    }
+
 // We don't attempt to deal with read-only files intelligently on POSIX.
 #if eOPSYS != ePOSIX
     bool read_only = false;
@@ -344,27 +2515,6 @@ bool DiskEditFile::save(const char *the_name, Mode save_mode)
     }
 #endif
 
-    // Try to open the file.
-    std::FILE *disk;
-    if ((disk = std::fopen(the_name, "w")) == nullptr) {
-        error_message("Can't open %s for output", the_name);
-
-#if eOPSYS != ePOSIX
-        // If the file exists and we converted its attributes, let's set them back here. This
-        // may be the case in a networked environment where the user has rights to modify a
-        // file's attributes, but not write to the file.
-        //
-        if (read_only) {
-#if eOPSYS == eWIN32
-            SetFileAttributes(the_name, file_attributes);
-#else
-            _dos_setfileattr(the_name, file_attributes);
-#endif
-        }
-#endif
-        return false;
-    }
-
     // Tell user we're working on this file.
     std::string buffer("Writing ");
     buffer.append(the_name);
@@ -372,30 +2522,47 @@ bool DiskEditFile::save(const char *the_name, Mode save_mode)
     scr::MessageWindow teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
     scr::refresh();
 
-    // Do the bulk of the work.
-    bool result1;
-    if (save_mode == ALL)
-        result1 = write_disk(disk);
-    else
-        result1 = write_disk_block(disk);
-
-    bool result2 = static_cast<bool>(std::fclose(disk) == 0);
+    spica::Timer stopwatch;
+    stopwatch.start();
+    long byte_count;
+    const WriteStatus status = write_file(the_name, save_mode, byte_count);
+    stopwatch.stop();
 
     // Close teaser window after std::fclose() since std::fclose() does writes too.
     teaser.close();
 
-    // result == true only if both Write_Disk() and std::fclose() worked.
-    bool result = static_cast<bool>(result1 == true && result2 == true);
-
     // Tell user if there are problems.
-    if (result == false) {
+    switch (status) {
+    case WRITTEN:
+        if (byte_count >= report_threshold) {
+            const double megabytes = byte_count / (1024.0 * 1024.0);
+            const double seconds = std::max(stopwatch.time(), 1L) / 1000.0;
+            info_message("Wrote %.1f MB in %.2f s (%.1f MB/s)", megabytes, seconds,
+                         megabytes / seconds);
+        }
+        break;
+    case NOT_OPENED:
+        error_message("Can't open %s for output", the_name);
+        break;
+    case NOT_WRITTEN:
+        warning_message("Problems writing %s. The file was not changed", the_name);
+        break;
+    case DAMAGED:
         warning_message("Problems writing %s. File may have been incompletely saved", the_name);
+        break;
+    case UNSUPPORTED:
+        error_message("Can't write %s (%s files are not supported)", the_name,
+                      CompressedFile::format_name(save_format(the_name, save_mode)));
+        break;
     }
 
 #if eOPSYS != ePOSIX
     // If we converted this file's attributes, set them back. We can assume this will work... we
     // must have successfully changed the file's attributes above in order to be here! Note that
-    // by doing this conditionally, we reduce the number of OS system calls.
+    // by doing this conditionally, we reduce the number of OS system calls. This also restores
+    // the attributes of a file that could not be opened. That may happen in a networked
+    // environment where the user has rights to modify a file's attributes, but not write to
+    // the file.
     //
     if (read_only) {
 #if eOPSYS == eWIN32
@@ -405,5 +2572,161 @@ bool DiskEditFile::save(const char *the_name, Mode save_mode)
 #endif
     }
 #endif
-    return result;
+    return status == WRITTEN;
+}
+
+/*!
+ * Saves several files entirely, writing them on different threads at once. This takes little
+ * longer than saving the largest of them when the time goes to waiting on the disk (or a
+ * network file system). The files saved have their time stamps updated and are marked as
+ * unchanged. The problems are reported together when all the writes have finished.
+ *
+ * Files with the read-only attribute (except on POSIX) are saved one at a time by save since
+ * the user must be asked about them first.
+ *
+ * \return true if every file was saved.
+ */
+bool DiskEditFile::save_all(const std::vector<SaveRequest> &requests)
+{
+    std::vector<SaveRequest> pending;
+    bool return_value = true;
+    for (const SaveRequest &request : requests) {
+#if eOPSYS != ePOSIX
+#if eOPSYS == eWIN32
+        const unsigned file_attributes = GetFileAttributes(request.name);
+        if (file_attributes != INVALID_FILE_ATTRIBUTES &&
+            (file_attributes & FILE_ATTRIBUTE_READONLY)) {
+#else
+        unsigned file_attributes = 0;
+        if (_dos_getfileattr(request.name, &file_attributes) == 0 &&
+            (file_attributes & _A_RDONLY)) {
+#endif
+            if (request.file->save(request.name)) {
+                request.file->set_timestamp(request.name);
+                request.file->mark_as_unchanged();
+            }
+            else
+                return_value = false;
+            continue;
+        }
+#endif
+        // The workers can't wait for lines still being read.
+        request.file->file_data.set_end();
+        pending.push_back(request);
+    }
+    if (pending.empty())
+        return return_value;
+
+    Profiler::Scope zone(Profiler::SAVE);
+    std::string buffer("Writing ");
+    if (pending.size() == 1)
+        buffer.append(pending.front().name);
+    else
+        buffer.append(std::to_string(pending.size())).append(" files");
+    buffer.append("...");
+    scr::MessageWindow teaser(buffer.c_str(), scr::MESSAGE_WINDOW_MESSAGE);
+    scr::refresh();
+
+    // Each task, and this thread, writes the next file nobody has taken until none remain.
+    std::vector<WriteStatus> statuses(pending.size(), NOT_WRITTEN);
+    std::vector<long> byte_counts(pending.size(), 0);
+    std::atomic<std::size_t> next_file{0};
+    auto work = [&]() {
+        std::size_t index;
+        while ((index = next_file++) < pending.size()) {
+            Trace::Span span("write file");
+            try {
+                statuses[index] = pending[index].file->write_file(pending[index].name, ALL,
+                                                                  byte_counts[index]);
+            }
+            catch (std::bad_alloc &) {
+                statuses[index] = NOT_WRITTEN;
+            }
+        }
+    };
+
+    spica::Timer stopwatch;
+    stopwatch.start();
+    const std::size_t helpers =
+        std::min<std::size_t>(std::min(TaskPool::size(), maximum_savers), pending.size()) - 1;
+    TaskPool::Group workers;
+    for (std::size_t i = 0; i < helpers; ++i)
+        workers.run(work);
+    work();
+    workers.wait();
+    stopwatch.stop();
+    teaser.close();
+
+    // Update the files that were saved and make one list of those that weren't.
+    std::string failures;
+    std::size_t unlisted = 0;
+    bool damaged = false;
+    long total_bytes = 0;
+    for (std::size_t i = 0; i < pending.size(); ++i) {
+        if (statuses[i] == WRITTEN) {
+            pending[i].file->set_timestamp(pending[i].name);
+            pending[i].file->mark_as_unchanged();
+            total_bytes += byte_counts[i];
+            continue;
+        }
+        return_value = false;
+        if (statuses[i] == DAMAGED)
+            damaged = true;
+        if (failures.size() + std::strlen(pending[i].name) > failure_list_limit)
+            ++unlisted;
+        else {
+            if (!failures.empty())
+                failures.append(", ");
+            failures.append(pending[i].name);
+        }
+    }
+
+    if (!failures.empty() || unlisted != 0) {
+        if (unlisted != 0) {
+            const bool listed = !failures.empty();
+            if (listed)
+                failures.append(" and ");
+            failures.append(std::to_string(unlisted)).append(listed ? " other" : "");
+            failures.append(unlisted == 1 ? " file" : " files");
+        }
+        error_message("Problems writing %s%s", failures.c_str(),
+                      damaged ? ". Some may be incompletely saved" : "");
+    }
+    else if (total_bytes >= report_threshold) {
+        const double megabytes = total_bytes / (1024.0 * 1024.0);
+        const double seconds = std::max(stopwatch.time(), 1L) / 1000.0;
+        info_message("Wrote %.1f MB in %.2f s (%.1f MB/s)", megabytes, seconds,
+                     megabytes / seconds);
+    }
+    return return_value;
+}
+
+//! Copies the text of the file (or of its block) as it would be saved.
+/*!
+ * Each line is followed by a '\n' and has its trailing spaces removed, matching the output of
+ * save. Nothing is copied if text_mode is BLOCK_ONLY and the block is beyond the end of the
+ * file.
+ *
+ * \param text [out] Receives the text, replacing its previous contents.
+ * \param text_mode Whether to copy the whole file or just the lines of the block.
+ */
+void DiskEditFile::get_text(std::string &text, const Mode text_mode)
+{
+    long top = 0;
+    long bottom = LONG_MAX;
+    if (text_mode == BLOCK_ONLY)
+        block_limits(top, bottom);
+
+    text.clear();
+    if (top >= file_data.size())
+        return;
+
+    EditBuffer *line;
+    file_data.jump_to(top);
+    while (top++ <= bottom && (line = file_data.next()) != nullptr) {
+        std::string_view view = line->view();
+        const std::size_t length = view.find_last_not_of(' ');
+        text.append(view.substr(0, length == std::string_view::npos ? 0 : length + 1));
+        text.push_back('\n');
+    }
 }
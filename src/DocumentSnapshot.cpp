@@ -0,0 +1,136 @@
+/*! \file    DocumentSnapshot.cpp
+ *  \brief   Implementation of class DocumentSnapshot
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <utility>
+
+#include "DocumentSnapshot.hpp"
+#include "EditList.hpp"
+
+namespace {
+    // Lines are copied into blocks of this many. Smaller runs are merged with their neighbors.
+    constexpr std::size_t block_size = 512;
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Adds a block after the last.
+void DocumentSnapshot::append(std::shared_ptr<const Block> block)
+{
+    block_start.push_back(line_count);
+    line_count += static_cast<long>(block->size());
+    blocks.push_back(std::move(block));
+}
+
+//! Makes the lines copied so far a block once there are enough of them, or if finished.
+/*!
+ * \param pending [in, out] The lines copied. It is left empty if they were used.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void DocumentSnapshot::append_lines(Block &pending, const bool finished)
+{
+    if (pending.empty() || (pending.size() < block_size && !finished))
+        return;
+    append(std::make_shared<const Block>(std::move(pending)));
+    pending.clear();
+    pending.reserve(block_size);
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+/*!
+ * The list's current point is moved.
+ */
+DocumentSnapshot::DocumentSnapshot(EditList &data)
+{
+    blocks.reserve(static_cast<std::size_t>(data.size()) / block_size + 1);
+    block_start.reserve(blocks.capacity());
+    Block pending;
+    pending.reserve(block_size);
+    data.jump_to(0);
+    for (const EditBuffer *line = data.read_next(); line != nullptr; line = data.read_next()) {
+        pending.push_back(*line);
+        append_lines(pending, false);
+    }
+    append_lines(pending, true);
+}
+
+/*!
+ * Only the blocks holding the lines modified are copied. So that editing in one place many
+ * times does not leave a trail of tiny blocks, a short run of copied lines takes in the lines
+ * of the block after it as well. The list's current point is moved.
+ *
+ * \param earlier A snapshot of the list before the lines were modified.
+ * \param data The list.
+ * \param change The lines modified since the earlier snapshot was taken (see
+ * EditFile::take_modifications).
+ */
+DocumentSnapshot::DocumentSnapshot(const DocumentSnapshot &earlier, EditList &data,
+                                   const EditDelta &change)
+{
+    const long new_count = data.size();
+    const long first = std::clamp(change.first, 0L, std::min(earlier.line_count, new_count));
+    const long tail = std::clamp(new_count - change.first - change.new_count, 0L,
+                                 std::min(earlier.line_count, new_count) - first);
+    blocks.reserve(earlier.blocks.size() + 2);
+    block_start.reserve(blocks.capacity());
+
+    // The blocks wholly before the first line modified are shared.
+    std::size_t index = 0;
+    for (; index < earlier.blocks.size(); ++index) {
+        const long length = static_cast<long>(earlier.blocks[index]->size());
+        if (earlier.block_start[index] + length > first)
+            break;
+        append(earlier.blocks[index]);
+    }
+
+    // The rest of the lines up to the unmodified tail are copied.
+    Block pending;
+    pending.reserve(block_size);
+    if (index < earlier.blocks.size()) {
+        const Block &partial = *earlier.blocks[index];
+        pending.assign(partial.begin(), partial.begin() + (first - earlier.block_start[index]));
+    }
+    data.jump_to(first);
+    for (long count = new_count - tail - first; count > 0; --count) {
+        pending.push_back(*data.read_next());
+        append_lines(pending, false);
+    }
+
+    // The tail may begin part way through a block of the earlier snapshot.
+    const long kept = earlier.line_count - tail;
+    index = static_cast<std::size_t>(
+        std::upper_bound(earlier.block_start.begin(), earlier.block_start.end(), kept) -
+        earlier.block_start.begin());
+    if (index > 0 && earlier.block_start[index - 1] < kept) {
+        const Block &partial = *earlier.blocks[index - 1];
+        pending.insert(pending.end(), partial.begin() + (kept - earlier.block_start[index - 1]),
+                       partial.end());
+    }
+    else if (index > 0) {
+        --index;
+    }
+    while (!pending.empty() && pending.size() < block_size / 2 &&
+           index < earlier.blocks.size()) {
+        const Block &next = *earlier.blocks[index++];
+        pending.insert(pending.end(), next.begin(), next.end());
+    }
+    append_lines(pending, true);
+
+    for (; index < earlier.blocks.size(); ++index)
+        append(earlier.blocks[index]);
+}
+
+std::string_view DocumentSnapshot::line(const long line_number) const
+{
+    const std::size_t index = static_cast<std::size_t>(
+        std::upper_bound(block_start.begin(), block_start.end(), line_number) -
+        block_start.begin() - 1);
+    return (*blocks[index])[static_cast<std::size_t>(line_number - block_start[index])].view();
+}
@@ -0,0 +1,121 @@
+/*! \file    DocumentStats.cpp
+ *  \brief   Implementation of class DocumentStats.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <string_view>
+
+#include "DocumentStats.hpp"
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+
+#define BLOCK_LINES 512 // The most lines counted together.
+
+/*!
+ * The blocks holding the lines replaced are merged into one stale block holding the lines
+ * that replaced them. The counts of the other blocks are unchanged.
+ */
+void DocumentStats::invalidate(const EditDelta &change)
+{
+    if (!counted || change.empty())
+        return;
+
+    // Find the blocks holding the lines replaced, or the one holding the first if none were.
+    std::size_t first = 0;
+    long start = 0;
+    for (; first < blocks.size() && start + blocks[first].totals.lines <= change.first; ++first)
+        start += blocks[first].totals.lines;
+    std::size_t last = first;
+    long end = start;
+    for (; last < blocks.size() && (last == first || end < change.first + change.old_count);
+         ++last)
+        end += blocks[last].totals.lines;
+
+    Block replaced{Totals(), true};
+    replaced.totals.lines = end - start + change.moved();
+    for (std::size_t i = first; i < last; ++i) {
+        if (blocks[i].stale)
+            continue;
+        sum.lines -= blocks[i].totals.lines;
+        sum.characters -= blocks[i].totals.characters;
+        sum.words -= blocks[i].totals.words;
+        if (blocks[i].totals.longest == sum.longest)
+            longest_lost = true;
+    }
+    blocks.erase(blocks.begin() + static_cast<long>(first),
+                 blocks.begin() + static_cast<long>(last));
+    if (replaced.totals.lines > 0)
+        blocks.insert(blocks.begin() + static_cast<long>(first), replaced);
+}
+
+//! Replaces the stale block at block_index, which starts at line first, with counted blocks.
+void DocumentStats::count_block(EditList &data, long first, const std::size_t block_index)
+{
+    std::vector<Block> counted_blocks;
+    long remaining = blocks[block_index].totals.lines;
+    data.jump_to(first);
+    const EditBuffer *line;
+    while (remaining > 0 && (line = data.read_next()) != nullptr) {
+        if (counted_blocks.empty() || counted_blocks.back().totals.lines == BLOCK_LINES)
+            counted_blocks.push_back(Block{Totals(), false});
+        Totals &totals = counted_blocks.back().totals;
+        const std::string_view text = line->view();
+        bool in_word = false;
+        for (const char ch : text) {
+            const bool space = (ch == ' ' || ch == '\t');
+            if (!space && !in_word)
+                ++totals.words;
+            in_word = !space;
+        }
+        ++totals.lines;
+        totals.characters += text.size();
+        totals.longest = std::max(totals.longest, text.size());
+        --remaining;
+    }
+
+    for (const Block &block : counted_blocks) {
+        sum.lines += block.totals.lines;
+        sum.characters += block.totals.characters;
+        sum.words += block.totals.words;
+        sum.longest = std::max(sum.longest, block.totals.longest);
+    }
+    blocks.erase(blocks.begin() + static_cast<long>(block_index));
+    blocks.insert(blocks.begin() + static_cast<long>(block_index), counted_blocks.begin(),
+                  counted_blocks.end());
+}
+
+/*!
+ * The first time this is called every line is counted. After that only the stale blocks are.
+ */
+const DocumentStats::Totals &DocumentStats::update(EditList &data)
+{
+    if (!counted) {
+        blocks.assign(1, Block{Totals(), true});
+        blocks.front().totals.lines = data.size();
+        sum = Totals();
+        counted = true;
+        longest_lost = false;
+    }
+
+    long first = 0;
+    for (std::size_t i = 0; i < blocks.size();) {
+        std::size_t end = i + 1;
+        if (blocks[i].stale) {
+            // The block is replaced by those counted, if any (the list may have been shorter).
+            const std::size_t before = blocks.size();
+            count_block(data, first, i);
+            end = i + (blocks.size() + 1 - before);
+        }
+        for (; i < end; ++i)
+            first += blocks[i].totals.lines;
+    }
+
+    if (longest_lost) {
+        sum.longest = 0;
+        for (const Block &block : blocks)
+            sum.longest = std::max(sum.longest, block.totals.longest);
+        longest_lost = false;
+    }
+    return sum;
+}
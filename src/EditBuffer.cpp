@@ -4,8 +4,13 @@
  */
 
 #include "EditBuffer.hpp"
+#include "FixedPool.hpp"
+#include "Utf8.hpp"
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <new>
+#include <vector>
 
 using namespace std;
 
@@ -28,114 +33,603 @@ static size_t round_up(const size_t required)
     return (result);
 }
 
+//! Returns the pool from which EditBuffer objects are allocated.
+/*!
+ * The pool is intentionally never destroyed. EditBuffers owned by objects with static storage
+ * duration (the clipboard, for example) are deleted during program termination and the pool
+ * must still be usable at that time.
+ */
+static FixedPool &buffer_pool()
+{
+    static FixedPool *const pool = new FixedPool(sizeof(EditBuffer), 4096);
+    return *pool;
+}
+
+//! Precedes each workspace on the heap. Counts the EditBuffers sharing the workspace.
+struct WorkspaceHeader {
+    std::atomic<size_t> references;
+    size_t capacity;
+};
+
+// The number of bytes in the workspaces on the heap, including their headers.
+static std::atomic<size_t> workspace_bytes{0};
+
+//! Returns the header of a workspace on the heap.
+static WorkspaceHeader *header_of(char *const workspace)
+{
+    return reinterpret_cast<WorkspaceHeader *>(workspace - sizeof(WorkspaceHeader));
+}
+
+//! The columns of a text that is not plain (see is_plain).
+struct EditBuffer::ColumnIndex {
+    //! The number of columns between the entries of checkpoints.
+    static constexpr std::size_t stride = 64;
+
+    //! Locates the character occupying a column.
+    struct Checkpoint {
+        std::size_t offset; //!< The offset of the character.
+        std::size_t column; //!< The first column occupied by the character.
+    };
+
+    unsigned tab;                        //!< The tab distance used to find the columns.
+    std::size_t columns;                 //!< The number of columns in the text.
+    std::vector<Checkpoint> checkpoints; //!< The characters occupying every stride-th column.
+};
+
+EditBuffer::ColumnIndex EditBuffer::plain_index;
+
+//----------------------------------------
+//           Private Members
+//----------------------------------------
+
+//! Allocates a workspace on the heap that is used by one EditBuffer.
+/*!
+ * \param capacity The number of bytes in the workspace.
+ * \throws std::bad_alloc if insufficient memory available.
+ */
+char *EditBuffer::allocate(const size_t capacity)
+{
+    char *const block = new char[sizeof(WorkspaceHeader) + capacity];
+    new (block) WorkspaceHeader{{1}, capacity};
+    workspace_bytes.fetch_add(sizeof(WorkspaceHeader) + capacity, std::memory_order_relaxed);
+    return block + sizeof(WorkspaceHeader);
+}
+
+//! Releases the workspace if it is on the heap and no other EditBuffer is using it.
+/*!
+ * The workspace pointer is left dangling; the caller must install a new workspace.
+ */
+void EditBuffer::release()
+{
+    if (is_local())
+        return;
+    WorkspaceHeader *const header = header_of(workspace);
+    if (header->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        workspace_bytes.fetch_sub(sizeof(WorkspaceHeader) + header->capacity,
+                                  std::memory_order_relaxed);
+        header->~WorkspaceHeader();
+        delete[] reinterpret_cast<char *>(header);
+    }
+}
+
+//! Returns true if the workspace is shared with another EditBuffer.
+bool EditBuffer::is_shared() const
+{
+    return !is_local() && header_of(workspace)->references.load(std::memory_order_acquire) > 1;
+}
+
+//! Makes this EditBuffer the only user of its workspace, copying the text if necessary.
+/*!
+ * Every method that changes the text in place calls this first.
+ *
+ * \throws std::bad_alloc if there is insufficient memory. In that case there is no effect.
+ */
+void EditBuffer::unshare()
+{
+    if (!is_shared())
+        return;
+    if (size < local_capacity) {
+        memcpy(local, workspace, size + 1);
+        release();
+        workspace = local;
+        capacity = local_capacity;
+        return;
+    }
+    const size_t new_capacity = round_up(size);
+    char *const new_workspace = allocate(new_capacity);
+    memcpy(new_workspace, workspace, size + 1);
+    release();
+    workspace = new_workspace;
+    capacity = new_capacity;
+}
+
+//! Makes this EditBuffer, which has no workspace of its own, use the text of another.
+/*!
+ * Short texts are copied. A workspace on the heap is shared instead. The other EditBuffer's
+ * gap, if any, is closed first since a shared workspace never has a gap.
+ */
+void EditBuffer::share(const EditBuffer &existing)
+{
+    existing.compact();
+    if (existing.is_local()) {
+        workspace = local;
+        capacity = local_capacity;
+        memcpy(local, existing.local, existing.size + 1);
+    }
+    else {
+        header_of(existing.workspace)->references.fetch_add(1, std::memory_order_relaxed);
+        workspace = existing.workspace;
+        capacity = existing.capacity;
+    }
+    size = existing.size;
+    gap_start = 0;
+    gap_length = 0;
+
+    // Only the fact that a text is plain is free to share.
+    index = (existing.index == &plain_index) ? &plain_index : nullptr;
+}
+
+//! Installs a copy of the given text into an EditBuffer under construction.
+/*!
+ * \param text Pointer to the first character to copy (need not be null terminated).
+ * \param count The number of characters to copy.
+ * \throws std::bad_alloc if insufficient memory available.
+ */
+void EditBuffer::initialize(const char *const text, const size_t count)
+{
+    if (count < local_capacity) {
+        workspace = local;
+        capacity = local_capacity;
+    }
+    else {
+        capacity = round_up(count);
+        workspace = allocate(capacity);
+    }
+    if (count != 0)
+        memcpy(workspace, text, count);
+    workspace[count] = '\0';
+    size = count;
+    gap_start = 0;
+    gap_length = 0;
+}
+
+//! Moves the gap so that it starts at the given offset.
+/*!
+ * Only the text between the old and new positions of the gap is moved.
+ */
+void EditBuffer::move_gap(const size_t offset) const
+{
+    if (gap_length != 0) {
+        if (offset < gap_start) {
+            memmove(workspace + offset + gap_length, workspace + offset, gap_start - offset);
+        }
+        else if (offset > gap_start) {
+            memmove(workspace + gap_start, workspace + gap_start + gap_length,
+                    offset - gap_start);
+        }
+    }
+    gap_start = offset;
+}
+
+//! Returns the index of the columns in the text, building it if necessary.
+/*!
+ * \param tab The distance between tab stops.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+const EditBuffer::ColumnIndex &EditBuffer::column_index(const unsigned tab) const
+{
+    if (index != nullptr && (index == &plain_index || index->tab == tab))
+        return *index;
+    forget_columns();
+    if (is_plain())
+        return *index;
+
+    const string_view text = view();
+    ColumnIndex *const new_index = new ColumnIndex;
+    try {
+        vector<ColumnIndex::Checkpoint> &checkpoints = new_index->checkpoints;
+        size_t column = 0;
+        for (size_t offset = 0; offset < text.size(); offset = Utf8::next(text, offset)) {
+            const size_t end = Utf8::advance(column, text[offset], tab);
+            while (checkpoints.size() * ColumnIndex::stride < end)
+                checkpoints.push_back(ColumnIndex::Checkpoint{offset, column});
+            column = end;
+        }
+        new_index->tab = tab;
+        new_index->columns = column;
+    }
+    catch (...) {
+        delete new_index;
+        throw;
+    }
+    index = new_index;
+    return *index;
+}
+
+//! Discards the index of the columns. Every method that changes the text calls this first.
+void EditBuffer::forget_columns() const
+{
+    if (index != &plain_index)
+        delete index;
+    index = nullptr;
+}
+
+//! Discards the index of the columns unless the text is plain and stays so with letter added.
+/*!
+ * Typing on a plain line then never rescans it, however long it is.
+ */
+void EditBuffer::forget_columns(const char letter) const
+{
+    if (index != &plain_index || (letter & 0x80) != 0 || letter == '\t')
+        forget_columns();
+}
+
+//! Reallocates the workspace with a larger gap at gap_start.
+/*!
+ * The new gap is proportional to the size of the text so the cost of growing the gap is
+ * amortized over many edits.
+ *
+ * \throws std::bad_alloc if there is insufficient memory. In that case there is no effect.
+ */
+void EditBuffer::grow_gap()
+{
+    const size_t tail = size - gap_start;
+    const size_t new_capacity = round_up(size + max(size / 8, static_cast<size_t>(64)));
+    char *const new_workspace = allocate(new_capacity);
+    const size_t new_gap_length = new_capacity - 1 - size;
+
+    memcpy(new_workspace, workspace, gap_start);
+    memcpy(new_workspace + gap_start + new_gap_length, workspace + gap_start + gap_length,
+           tail + 1);
+    release();
+    workspace = new_workspace;
+    capacity = new_capacity;
+    gap_length = new_gap_length;
+}
+
 //-------------------------------------------------
 //           Constructors and destructor
 //-------------------------------------------------
 
 //! Default constructor
 /*!
- * Creates an initially empty EditBuffer object.
- *
- * \throws std::bad_alloc if insufficient memory available.
+ * Creates an initially empty EditBuffer object. No memory is allocated.
  */
 EditBuffer::EditBuffer()
-    : workspace(new char[initial_capacity]), capacity(initial_capacity), size(0)
+    : workspace(local), capacity(local_capacity), size(0), gap_start(0), gap_length(0),
+      index(&plain_index)
 {
     workspace[0] = '\0';
-    return;
 }
 
 //! Builds an EditBuffer from a c-style string
 /*!
- * Copies the given string into the EditBuffer. If the input parameter is nullptr, this constructor
- * behaves identically to the default constructor.
+ * Copies the given string into the EditBuffer. If the input parameter is nullptr, this
+ * constructor behaves identically to the default constructor.
  *
  * \param str Pointer to a null terminated array of characters.
  * \throws std::bad_alloc if insufficient memory available.
  */
-EditBuffer::EditBuffer(const char *const str) : workspace(nullptr), capacity(0), size(0)
+EditBuffer::EditBuffer(const char *const str)
+    : workspace(local), capacity(0), size(0), gap_start(0), gap_length(0), index(nullptr)
 {
-    if (str == nullptr) {
-        capacity = initial_capacity;
-        workspace = new char[capacity];
-        size = 0;
-        workspace[0] = '\0';
-    }
-    else {
-        const size_t incoming_length = strlen(str);
-        capacity = round_up(incoming_length);
-        workspace = new char[capacity];
-        memcpy(workspace, str, incoming_length + 1);
-        size = incoming_length;
-    }
+    if (str == nullptr)
+        initialize(nullptr, 0);
+    else
+        initialize(str, strlen(str));
+}
+
+//! Builds an EditBuffer from a span of characters.
+/*!
+ * Copies exactly \p count characters into the EditBuffer. The characters need not be null
+ * terminated. This allows text to be copied directly out of a larger block (for example, a
+ * file image in memory) without an intermediate copy.
+ *
+ * \param str Pointer to the first character to copy.
+ * \param count The number of characters to copy.
+ * \throws std::bad_alloc if insufficient memory available.
+ */
+EditBuffer::EditBuffer(const char *const str, const size_t count)
+    : workspace(local), capacity(0), size(0), gap_start(0), gap_length(0), index(nullptr)
+{
+    initialize(str, count);
 }
 
 //! Copy constructor
 /*!
- * The target object is given a capacity related to the length of the string and not necessarily
- * the same capacity as the source object.
+ * A long text is not copied. Instead the two objects share it until one of them is modified.
+ * Copying is thus a constant time operation that allocates no memory.
  *
  * \param existing The EditBuffer to copy.
- * \throws std::bad_alloc if there is insufficient memory.
  */
-EditBuffer::EditBuffer(const EditBuffer &existing) : workspace(nullptr), capacity(0), size(0)
+EditBuffer::EditBuffer(const EditBuffer &existing)
+    : workspace(local), capacity(0), size(0), gap_start(0), gap_length(0), index(nullptr)
 {
-    capacity = round_up(existing.size);
-    workspace = new char[capacity];
-    memcpy(workspace, existing.workspace, existing.size + 1);
-    size = existing.size;
-    return;
+    share(existing);
 }
 
 //! Copy assignment operator
 /*!
- * This method is similar to a destruction followed by a copy construction except that it is
- * exception safe. The capacity of the target object is adjusted to reflect the length of the
- * incoming string. The target object is left unchanged if an exception occurs.
+ * As with the copy constructor, a long text is shared rather than copied.
  *
  * \param existing The source EditBuffer.
- * \throws std::bad_alloc if there is insufficient memory.
  */
 EditBuffer &EditBuffer::operator=(const EditBuffer &existing)
 {
     if (this != &existing) {
-        const size_t new_capacity = round_up(existing.size);
-        char *const new_workspace = new char[new_capacity];
-        delete[] workspace;
-        capacity = new_capacity;
-        workspace = new_workspace;
-        memcpy(workspace, existing.workspace, existing.size + 1);
-        size = existing.size;
+        forget_columns();
+        release();
+        share(existing);
     }
     return (*this);
 }
 
-#ifdef NEVER
 //! Move constructor
-EditBuffer::EditBuffer(EditBuffer &&existing)
-    : workspace(existing.workspace), capacity(existing.capacity), size(existing.size)
+/*!
+ * A heap allocated workspace is taken over from the source object. Short texts are copied. The
+ * source object is left empty.
+ */
+EditBuffer::EditBuffer(EditBuffer &&existing) noexcept
+    : workspace(existing.workspace), capacity(existing.capacity), size(existing.size),
+      gap_start(existing.gap_start), gap_length(existing.gap_length), index(existing.index)
 {
-    existing.workspace = nullptr;
-    existing.capacity = 0;
+    if (existing.is_local()) {
+        workspace = local;
+        memcpy(local, existing.local, existing.size + 1);
+    }
+    existing.workspace = existing.local;
+    existing.capacity = local_capacity;
     existing.size = 0;
+    existing.gap_start = 0;
+    existing.gap_length = 0;
+    existing.index = &plain_index;
+    existing.local[0] = '\0';
 }
 
 //! Move assignment operator
-EditBuffer &EditBuffer::operator=(EditBuffer &&existing)
+/*!
+ * A heap allocated workspace is taken over from the source object. Short texts are copied. The
+ * source object is left empty.
+ */
+EditBuffer &EditBuffer::operator=(EditBuffer &&existing) noexcept
 {
     if (this != &existing) {
-        delete[] workspace;
-        workspace = existing.workspace;
+        forget_columns();
+        release();
+        if (existing.is_local()) {
+            workspace = local;
+            memcpy(local, existing.local, existing.size + 1);
+        }
+        else {
+            workspace = existing.workspace;
+        }
         capacity = existing.capacity;
         size = existing.size;
+        gap_start = existing.gap_start;
+        gap_length = existing.gap_length;
+        index = existing.index;
 
-        existing.workspace = nullptr;
-        existing.capacity = 0;
+        existing.workspace = existing.local;
+        existing.capacity = local_capacity;
         existing.size = 0;
+        existing.gap_start = 0;
+        existing.gap_length = 0;
+        existing.index = &plain_index;
+        existing.local[0] = '\0';
     }
     return (*this);
 }
-#endif
+
+//! Allocates storage for an EditBuffer object.
+/*!
+ * A file with many lines requires many EditBuffer objects. Taking them from a pool avoids the
+ * overhead of the general purpose allocator and keeps the lines of a file close together in
+ * memory. The text of long lines is still allocated separately.
+ *
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void *EditBuffer::operator new(const std::size_t size)
+{
+    if (size != sizeof(EditBuffer))
+        return ::operator new(size);
+    return buffer_pool().allocate();
+}
+
+//! Releases storage for an EditBuffer object.
+void EditBuffer::operator delete(void *const block, const std::size_t size) noexcept
+{
+    if (size != sizeof(EditBuffer)) {
+        ::operator delete(block);
+        return;
+    }
+    buffer_pool().deallocate(block);
+}
+
+//! Returns the number of bytes used by the EditBuffers from the pool and by all workspaces.
+/*!
+ * This is approximately the memory holding the lines of the files in memory. It doesn't
+ * include what the pool holds for reuse or what the general purpose allocator adds.
+ */
+std::size_t EditBuffer::memory_in_use()
+{
+    return buffer_pool().allocated() * sizeof(EditBuffer) +
+           workspace_bytes.load(std::memory_order_relaxed);
+}
+
+//-----------------------------------
+//           Access
+//-----------------------------------
+
+//! Copies text out of the EditBuffer.
+/*!
+ * This method is similar to std::string::copy. No null character is appended to the copied
+ * text. Characters beyond the end of the data are not copied (the implicit trailing spaces
+ * are not materialized).
+ *
+ * \param destination Pointer to an array that receives the text.
+ * \param count The maximum number of characters to copy.
+ * \param offset The offset of the first character to copy.
+ * \return The number of characters actually copied.
+ */
+size_t EditBuffer::copy(char *const destination, const size_t count, const size_t offset) const
+{
+    if (offset >= size)
+        return 0;
+    const size_t letters = min(count, size - offset);
+
+    // Copy the part before the gap and then the part after it.
+    size_t before = 0;
+    if (offset < gap_start) {
+        before = min(letters, gap_start - offset);
+        memcpy(destination, workspace + offset, before);
+    }
+    if (before < letters) {
+        memcpy(destination + before, workspace + offset + before + gap_length,
+               letters - before);
+    }
+    return letters;
+}
+
+//! Returns a view of count characters starting at offset (fewer at the end of the text).
+/*!
+ * Unlike view() this does not close the gap. If the gap is among the characters it is moved
+ * just past them instead, which moves no more than count bytes. The part of a long line shown
+ * in a window can thus be examined after every keystroke without moving the rest of the line.
+ * The view is only valid until the EditBuffer is next modified or destroyed.
+ */
+std::string_view EditBuffer::view(const size_t offset, size_t count) const
+{
+    if (offset >= size)
+        return string_view();
+    count = min(count, size - offset);
+    if (gap_length != 0 && gap_start > offset && gap_start < offset + count)
+        move_gap(offset + count);
+    return string_view(workspace + (offset < gap_start ? offset : offset + gap_length), count);
+}
+
+//! Closes the gap, if any, making the text contiguous.
+/*!
+ * This method does not change the text and can be applied to constant objects. It is
+ * appropriate to call this when editing of a long line is finished (for example, when the
+ * cursor leaves the line).
+ */
+void EditBuffer::compact() const
+{
+    if (gap_length == 0)
+        return;
+    memmove(workspace + gap_start, workspace + gap_start + gap_length, size - gap_start + 1);
+    gap_start = 0;
+    gap_length = 0;
+}
+
+//! Returns the bytes of the workspace on the heap, if any, including its header.
+/*!
+ * The workspace may be shared with other EditBuffers. Short texts use no heap memory.
+ */
+size_t EditBuffer::storage() const
+{
+    return is_local() ? 0 : sizeof(WorkspaceHeader) + header_of(workspace)->capacity;
+}
+
+//! Returns true if the text is plain: ASCII without tabs.
+/*!
+ * Then every character is one byte occupying one column and columns are the same as offsets.
+ * The answer is remembered until the text is modified. Most lines are plain.
+ */
+bool EditBuffer::is_plain() const
+{
+    if (index != nullptr)
+        return index == &plain_index;
+
+    // The text on each side of the gap is examined separately so the gap stays open.
+    const char *const after = workspace + gap_start + gap_length;
+    const size_t tail = size - gap_start;
+    if (!Utf8::is_ascii(workspace, gap_start) || !Utf8::is_ascii(after, tail) ||
+        memchr(workspace, '\t', gap_start) != nullptr || memchr(after, '\t', tail) != nullptr)
+        return false;
+    index = &plain_index;
+    return true;
+}
+
+//! Returns the number of columns occupied by the text.
+/*!
+ * \param tab The distance between tab stops.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+size_t EditBuffer::columns(const unsigned tab) const
+{
+    const ColumnIndex &columns_of = column_index(tab);
+    return (&columns_of == &plain_index) ? size : columns_of.columns;
+}
+
+//! Returns the offset of the character occupying a column.
+/*!
+ * A column inside a tab gives the offset of the tab. Columns past the end of the text
+ * correspond to offsets past its end as if the text was followed by spaces. The result is thus
+ * always suitable for methods taking an offset.
+ *
+ * \param column The column of interest.
+ * \param tab The distance between tab stops.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+size_t EditBuffer::offset_of(const size_t column, const unsigned tab) const
+{
+    const ColumnIndex &columns_of = column_index(tab);
+    if (&columns_of == &plain_index)
+        return column;
+    if (column >= columns_of.columns)
+        return size + (column - columns_of.columns);
+
+    // Start from the character occupying the last checkpointed column at or before column.
+    const string_view text = view();
+    const ColumnIndex::Checkpoint &checkpoint =
+        columns_of.checkpoints[column / ColumnIndex::stride];
+    size_t offset = checkpoint.offset;
+    size_t start = checkpoint.column;
+    for (;;) {
+        const size_t end = Utf8::advance(start, text[offset], tab);
+        if (column < end)
+            return offset;
+        offset = Utf8::next(text, offset);
+        start = end;
+    }
+}
+
+//! Returns the first column of the character containing the byte at an offset.
+/*!
+ * This is the inverse of offset_of. An offset inside a multi-byte character gives the
+ * character's column.
+ *
+ * \param offset The offset of interest.
+ * \param tab The distance between tab stops.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+size_t EditBuffer::column_of(const size_t offset, const unsigned tab) const
+{
+    const ColumnIndex &columns_of = column_index(tab);
+    if (&columns_of == &plain_index)
+        return offset;
+    if (offset >= size)
+        return columns_of.columns + (offset - size);
+
+    // Find the last checkpoint at or before the offset and step over the characters after it.
+    const vector<ColumnIndex::Checkpoint> &checkpoints = columns_of.checkpoints;
+    auto before = [](const size_t wanted, const ColumnIndex::Checkpoint &checkpoint) {
+        return wanted < checkpoint.offset;
+    };
+    auto after = upper_bound(checkpoints.begin(), checkpoints.end(), offset, before);
+    const ColumnIndex::Checkpoint &checkpoint = *(after - 1);
+    const string_view text = view();
+    size_t position = checkpoint.offset;
+    size_t start = checkpoint.column;
+    for (;;) {
+        const size_t following = Utf8::next(text, position);
+        if (following > offset)
+            return start;
+        start = Utf8::advance(start, text[position], tab);
+        position = following;
+    }
+}
 
 //-----------------------------------
 //           Manipulation
@@ -153,6 +647,26 @@ EditBuffer &EditBuffer::operator=(EditBuffer &&existing)
  */
 void EditBuffer::insert(const char letter, const std::size_t offset)
 {
+    forget_columns(letter);
+    unshare();
+
+    // Long texts are edited at the gap.
+    if (offset <= size && (gap_length != 0 || size >= gap_threshold)) {
+        if (gap_length == 0) {
+            gap_start = offset;
+            grow_gap();
+        }
+        else {
+            move_gap(offset);
+        }
+        workspace[gap_start++] = letter;
+        --gap_length;
+        ++size;
+        if (gap_length == 0)
+            gap_start = 0;
+        return;
+    }
+
     // Are we inserting into the existing data?
     if (offset <= size) {
 
@@ -165,11 +679,11 @@ void EditBuffer::insert(const char letter, const std::size_t offset)
         // We need to create a new buffer.
         else {
             const size_t new_capacity = round_up(size + 1);
-            char *const new_workspace = new char[new_capacity];
+            char *const new_workspace = allocate(new_capacity);
             memcpy(new_workspace, workspace, offset);
             new_workspace[offset] = letter;
             memcpy(&new_workspace[offset + 1], &workspace[offset], (size + 1) - offset);
-            delete[] workspace;
+            release();
             capacity = new_capacity;
             workspace = new_workspace;
             ++size;
@@ -178,6 +692,7 @@ void EditBuffer::insert(const char letter, const std::size_t offset)
 
     // We are inserting off the end of the buffer.
     else {
+        compact();
 
         // Is there sufficient capacity? (We need extra space for the null character).
         if (offset + 2 < capacity) {
@@ -190,12 +705,12 @@ void EditBuffer::insert(const char letter, const std::size_t offset)
         // We need to create a new buffer.
         else {
             const size_t new_capacity = round_up(offset + 1);
-            char *const new_workspace = new char[new_capacity];
+            char *const new_workspace = allocate(new_capacity);
             memcpy(new_workspace, workspace, size);
             memset(&new_workspace[size], ' ', offset - size);
             new_workspace[offset] = letter;
             new_workspace[offset + 1] = '\0';
-            delete[] workspace;
+            release();
             capacity = new_capacity;
             workspace = new_workspace;
             size = offset + 1;
@@ -218,7 +733,9 @@ void EditBuffer::replace(const char letter, const std::size_t offset)
     if (offset >= size)
         insert(letter, offset);
     else {
-        workspace[offset] = letter;
+        forget_columns(letter);
+        unshare();
+        workspace[offset < gap_start ? offset : offset + gap_length] = letter;
     }
 }
 
@@ -234,9 +751,20 @@ void EditBuffer::replace(const char letter, const std::size_t offset)
  */
 char EditBuffer::erase(const size_t offset)
 {
-    char return_value;
     if (offset >= size)
-        return_value = '\0';
+        return '\0';
+    forget_columns(' '); // Removing a character leaves plain text plain.
+    unshare();
+
+    char return_value;
+
+    // Long texts are edited at the gap (the gap absorbs the erased character).
+    if (gap_length != 0 || size >= gap_threshold) {
+        move_gap(offset);
+        return_value = workspace[gap_start + gap_length];
+        ++gap_length;
+        --size;
+    }
     else {
         return_value = workspace[offset];
         memmove(&workspace[offset], &workspace[offset + 1], size - offset);
@@ -249,18 +777,18 @@ char EditBuffer::erase(const size_t offset)
 //! Erases the entire buffer.
 /*!
  * Removes the data in the buffer and reinitializes the buffer. This method will thus reduce the
- * capacity of a large buffer. If an exception is thrown during the execution of this method,
- * there is no effect on the original buffer.
- *
- * \throws std::bad_alloc if there is insufficient memory to reinitialize.
+ * capacity of a large buffer. No memory is allocated.
  */
 void EditBuffer::erase()
 {
-    char *const new_workspace = new char[initial_capacity];
-    delete[] workspace;
-    workspace = new_workspace;
-    capacity = initial_capacity;
+    forget_columns();
+    index = &plain_index;
+    release();
+    workspace = local;
+    capacity = local_capacity;
     size = 0;
+    gap_start = 0;
+    gap_length = 0;
     workspace[0] = '\0';
 }
 
@@ -274,11 +802,14 @@ void EditBuffer::erase()
  */
 void EditBuffer::append(const char letter)
 {
+    forget_columns();
+    compact();
+    unshare();
     if (size + 1 >= capacity) {
         const size_t new_capacity = round_up(size + 1);
-        char *const new_workspace = new char[new_capacity];
+        char *const new_workspace = allocate(new_capacity);
         memcpy(new_workspace, workspace, size);
-        delete[] workspace;
+        release();
         capacity = new_capacity;
         workspace = new_workspace;
     }
@@ -300,12 +831,15 @@ void EditBuffer::append(const char *const additional)
     if (additional == nullptr)
         return;
     const size_t additional_size = strlen(additional);
+    forget_columns();
+    compact();
+    unshare();
 
     if (size + additional_size >= capacity) {
         const size_t new_capacity = round_up(size + additional_size);
-        char *const new_workspace = new char[new_capacity];
+        char *const new_workspace = allocate(new_capacity);
         memcpy(new_workspace, workspace, size);
-        delete[] workspace;
+        release();
         capacity = new_capacity;
         workspace = new_workspace;
     }
@@ -323,16 +857,70 @@ void EditBuffer::append(const char *const additional)
  */
 void EditBuffer::append(const EditBuffer &other)
 {
+    forget_columns();
+    compact();
+    unshare();
     if (size + other.size >= capacity) {
         const size_t new_capacity = round_up(size + other.size);
-        char *const new_workspace = new char[new_capacity];
+        char *const new_workspace = allocate(new_capacity);
         memcpy(new_workspace, workspace, size);
-        delete[] workspace;
+        release();
         capacity = new_capacity;
         workspace = new_workspace;
     }
-    memcpy(&workspace[size], other.workspace, other.size + 1);
-    size += other.size;
+    const size_t other_size = other.size;
+    other.copy(&workspace[size], other_size);
+    size += other_size;
+    workspace[size] = '\0';
+}
+
+//! Replaces a span of text with other text.
+/*!
+ * The text at [offset, offset + count) is replaced. The parts of the span beyond the end of
+ * the data are ignored, so text inserted past the end extends the buffer with spaces as
+ * `insert` does. This allocates at most once however long the text is. If an exception is
+ * thrown during the execution of this method, there is no effect on the original object.
+ *
+ * \param offset The position of the span.
+ * \param count The number of characters to remove.
+ * \param text The characters to put in their place. They must not be part of this EditBuffer.
+ * \throws std::bad_alloc if there is insufficient memory.
+ */
+void EditBuffer::splice(const size_t offset, size_t count, const std::string_view text)
+{
+    forget_columns();
+    compact();
+    const size_t head = min(offset, size);
+    const size_t padding = offset - head;
+    count = (offset < size) ? min(count, size - offset) : 0;
+    const size_t tail = size - head - count;
+    const size_t new_size = head + padding + text.size() + tail;
+
+    // A new workspace is filled directly so that the text is moved only once.
+    if (is_shared() || new_size >= capacity) {
+        char *new_workspace = local;
+        size_t new_capacity = local_capacity;
+        if (new_size >= local_capacity) {
+            new_capacity = round_up(new_size);
+            new_workspace = allocate(new_capacity);
+        }
+        memcpy(new_workspace, workspace, head);
+        memset(new_workspace + head, ' ', padding);
+        if (!text.empty())
+            memcpy(new_workspace + head + padding, text.data(), text.size());
+        memcpy(new_workspace + new_size - tail, workspace + head + count, tail);
+        new_workspace[new_size] = '\0';
+        release();
+        workspace = new_workspace;
+        capacity = new_capacity;
+    }
+    else {
+        memmove(workspace + new_size - tail, workspace + head + count, tail + 1);
+        memset(workspace + head, ' ', padding);
+        if (!text.empty())
+            memcpy(workspace + head + padding, text.data(), text.size());
+    }
+    size = new_size;
 }
 
 //! Returns a substring of this EditBuffer.
@@ -354,23 +942,22 @@ EditBuffer EditBuffer::subbuffer(const size_t start_offset, const size_t end_off
     // Only do work if there is work to do.
     if (end_offset > start_offset) {
 
-        // Copy the designated text to a new workspace. Deal with adding trailing spaces.
+        // Make room in the result for the designated text.
         const size_t result_size = end_offset - start_offset;
-        const size_t result_capacity = round_up(result_size);
-        char *const result_workspace = new char[result_capacity];
+        if (result_size >= local_capacity) {
+            result.capacity = round_up(result_size);
+            result.workspace = allocate(result.capacity);
+        }
 
+        // Copy the designated text. Deal with adding trailing spaces.
         const size_t letters =
             (start_offset < size) ? min(size - start_offset, result_size) : 0;
         const size_t spaces = result_size - letters;
-        memcpy(result_workspace, workspace + start_offset, letters);
-        memset(result_workspace + letters, ' ', spaces);
-        result_workspace[result_size] = '\0';
-
-        // Replace the guts of the result object.
-        delete[] result.workspace;
-        result.workspace = result_workspace;
-        result.capacity = result_capacity;
+        copy(result.workspace, letters, start_offset);
+        memset(result.workspace + letters, ' ', spaces);
+        result.workspace[result_size] = '\0';
         result.size = result_size;
+        result.index = nullptr;
     }
     return result;
 }
@@ -391,12 +978,24 @@ void EditBuffer::trim(const std::size_t offset)
     if (offset >= size)
         return;
 
-    const size_t new_capacity = round_up(offset);
-    char *const new_workspace = new char[new_capacity];
-    memcpy(new_workspace, workspace, offset);
-    delete[] workspace;
-    capacity = new_capacity;
-    workspace = new_workspace;
+    forget_columns();
+    compact();
+    if (!is_local()) {
+        if (offset < local_capacity) {
+            memcpy(local, workspace, offset);
+            release();
+            workspace = local;
+            capacity = local_capacity;
+        }
+        else {
+            const size_t new_capacity = round_up(offset);
+            char *const new_workspace = allocate(new_capacity);
+            memcpy(new_workspace, workspace, offset);
+            release();
+            capacity = new_capacity;
+            workspace = new_workspace;
+        }
+    }
     workspace[offset] = '\0';
     size = offset;
 }
@@ -409,11 +1008,5 @@ void EditBuffer::trim(const std::size_t offset)
  */
 bool operator==(const EditBuffer &left, const EditBuffer &right)
 {
-    if (left.length() != right.length())
-        return false;
-    for (size_t offset = 0; offset < left.length(); ++offset) {
-        if (left[offset] != right[offset])
-            return false;
-    }
-    return true;
+    return left.view() == right.view();
 }
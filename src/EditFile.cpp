@@ -3,9 +3,17 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <climits>
 #include <cstddef>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include "DocumentSnapshot.hpp"
+#include "EditBatch.hpp"
 #include "EditBuffer.hpp"
 #include "EditFile.hpp"
 #include "support.hpp"
@@ -18,8 +26,18 @@
 EditFile::EditFile()
 {
     block = false;
-    anchor = 0L;
+    anchor = MarkSet::none;
+    columns = false;
+    anchor_column = 0U;
     is_changed = false;
+    damage_top = -1L;
+    damage_bottom = -1L;
+    for (Modifications &observed : modified)
+        observed = Modifications{-1L, 0L, 0L};
+    edit_version = 0UL;
+    tab_stop = 8U;
+    virtual_tail = 0L;
+    virtual_first = -1L;
     constructed_ok = true;
 }
 
@@ -34,15 +52,21 @@ void EditFile::erase()
 {
     if (file_data.size() > 0L)
         is_changed = true;
+    mark_damaged_from(0L);
+    mark_modified(0L, 0L);
     file_data.clear();
+    undo_log.clear();
+    virtual_tail = 0L;
+    virtual_first = -1L;
 }
 
 //! Extends, if necessary, the file's data to include a particular line.
 /*!
  * This function ensures that the EditFile contains at least line line_number. If the desired
  * line is off the end of the current data, blank lines are added to the data until there are
- * enough lines. If the extension does not succeed the object may be left with some additional
- * lines added to it anyway.
+ * enough lines. The lines are added without EditBuffers (see EditList::append_blank), so a
+ * line far past the end costs little more than one at the end. Those that are still blank at
+ * the end of the file are not saved (see saved_size).
  *
  * \param line_number The line that is to become part of the file's data. Zero based numbering.
  * \return True if the extension is successful (or if no extension was necessary).
@@ -51,31 +75,176 @@ void EditFile::erase()
  * \todo If line_number is negative, bad things will happen.
  * \todo Currently this method always returns true because the extension will never fail if
  * there is sufficient memory. Perhaps the return type should be changed to void.
- *
- * \bug There is a memory leak if a blank like is allocated successfully but insertion into the
- * file data fails.
  */
 bool EditFile::extend_to_line(long line_number)
 {
-    bool return_value = true;
-
     // If the file is already big enough, just return.
     if (file_data.size() > line_number)
         return true;
 
     // Position the list to the end.
-    file_data.set_end();
+    record_lines(file_data.size(), 0L);
+    mark_damaged_from(file_data.size());
+    const long first_virtual = file_data.size() - trailing_virtual();
+    file_data.append_blank(line_number - file_data.size() + 1);
+    virtual_first = first_virtual;
+    return true;
+}
+
+//! Keeps track of the lines added by extend_to_line as a modification is made.
+/*!
+ * While modifications are made at or after the first of those lines it stays where it is.
+ * Once one is made before it, only the lines in the unmodified tail are still counted.
+ */
+void EditFile::note_virtual(const long first, const long tail)
+{
+    const long start =
+        (virtual_first >= 0) ? virtual_first : file_data.size() - virtual_tail;
+    if (first >= start) {
+        virtual_first = start;
+        return;
+    }
+    virtual_tail = std::min(trailing_virtual(), std::max(tail, 0L));
+}
+
+//! Returns the number of lines at the end that were added by extend_to_line.
+long EditFile::trailing_virtual()
+{
+    if (virtual_first >= 0) {
+        virtual_tail = std::max(file_data.size() - virtual_first, 0L);
+        virtual_first = -1L;
+    }
+    return virtual_tail;
+}
+
+//! Returns the number of lines to save.
+/*!
+ * Like the spaces past the end of a line, the blank lines added past the end of the file are
+ * not kept. Those that are blank at the end of the file are left out. The lines are read
+ * without expanding the blank lines held without EditBuffers. The list's current point is
+ * moved.
+ */
+long EditFile::saved_size()
+{
+    const long size = file_data.size();
+    const long first_virtual = size - trailing_virtual();
+    long result = first_virtual;
+    file_data.jump_to(first_virtual);
+    const EditBuffer *line;
+    for (long i = first_virtual; (line = file_data.read_next()) != nullptr; ++i) {
+        if (line->length() != 0)
+            result = i + 1;
+    }
+    return result;
+}
+
+//! Records that the given range of lines must be repainted.
+/*!
+ * The range is merged with any damage already recorded. Lines need not exist; the display
+ * clips the range to what is visible.
+ *
+ * \param first_line The first damaged line (zero based).
+ * \param last_line The last damaged line. Use LONG_MAX if all following lines have moved. In
+ * that case any carets on those lines are forgotten.
+ */
+void EditFile::mark_damaged(long first_line, long last_line)
+{
+    if (first_line < 0L)
+        first_line = 0L;
+    if (last_line == LONG_MAX && !carets.empty() && carets.back().line >= first_line)
+        carets.clear();
 
-    // Compute number of new lines required.
-    long line_count = line_number - file_data.size() + 1;
+    if (damage_top < 0L) {
+        damage_top = first_line;
+        damage_bottom = last_line;
+        return;
+    }
+    if (first_line < damage_top)
+        damage_top = first_line;
+    if (last_line > damage_bottom)
+        damage_bottom = last_line;
+}
+
+//! Returns the lines modified since the observer's last call and forgets them.
+/*!
+ * Each observer (see Observer) has its own record so none of them misses modifications taken
+ * by another. The delta is relative to the lines as they were at the observer's last call.
+ */
+EditDelta EditFile::take_modifications(const Observer observer)
+{
+    Modifications &observed = modified[observer];
+    EditDelta delta{-1L, 0L, 0L, edit_version};
+    if (observed.top < 0L)
+        return delta;
+
+    // The size of a huge file isn't known until its lines have been counted, so this may wait.
+    const long size = file_data.size();
+    delta.first = std::min(observed.top, std::min(observed.size, size));
+    const long tail = std::min(observed.tail, std::min(observed.size, size) - delta.first);
+    delta.old_count = observed.size - tail - delta.first;
+    delta.new_count = size - tail - delta.first;
+    observed.top = -1L;
+    observed.size = size;
+    return delta;
+}
+
+//! Moves the marks as the lines were moved by the last modification noted.
+/*!
+ * This is done as each modification is noted, before it is made (see mark_modified), so the
+ * marks are moved by each modification separately rather than by one range covering several.
+ * Modifications noted after they are made (see UndoEditFile::undo) must call this first.
+ */
+void EditFile::move_marks()
+{
+    marks.move(take_modifications(MARKS));
+}
 
-    // Insert the new lines.
-    while (return_value == true && line_count--) {
-        EditBuffer *blank = new EditBuffer("");
-        file_data.insert(blank);
+//! Puts the anchor of the block at the given line.
+void EditFile::set_anchor(const long line)
+{
+    if (marks.contains(anchor)) {
+        move_marks();
+        marks.place(anchor, line, 0U);
     }
+    else
+        anchor = add_mark(line, 0U);
+}
+
+//! Returns the line of the anchor of the block.
+long EditFile::anchor_line()
+{
+    Caret position;
+    return mark_position(anchor, position) ? position.line : 0L;
+}
+
+//! Adds a mark at the given line and column, which then move with the lines of the file.
+MarkSet::Mark EditFile::add_mark(const long line, const unsigned column)
+{
+    // Nothing was moved by the modifications noted while there were no marks.
+    if (marks.empty())
+        take_modifications(MARKS);
+    else
+        move_marks();
+    return marks.add(line, column);
+}
 
-    return return_value;
+//! Removes a mark. Nothing is done if there is no such mark.
+void EditFile::remove_mark(const MarkSet::Mark mark)
+{
+    marks.remove(mark);
+}
+
+//! Finds where a mark is now.
+/*!
+ * \return false if there is no such mark. The position is not changed.
+ */
+bool EditFile::mark_position(const MarkSet::Mark mark, Caret &position)
+{
+    if (!marks.contains(mark))
+        return false;
+    move_marks();
+    position = Caret{marks.line(mark), marks.column(mark)};
+    return true;
 }
 
 //! Return True if the EditFile was constructed successfully.
@@ -87,6 +256,261 @@ bool EditFile::built_ok()
     return constructed_ok;
 }
 
+//! Returns a snapshot of the file's lines that other threads can read as it is modified.
+/*!
+ * If the latest snapshot is still held by someone, the new one shares its unmodified lines,
+ * and if nothing has been modified since then it is the same snapshot. The current point of
+ * file_data is moved but the file's current point is not.
+ *
+ * \throws std::bad_alloc if insufficient memory.
+ */
+std::shared_ptr<const DocumentSnapshot> EditFile::snapshot()
+{
+    const EditDelta change = take_modifications(SNAPSHOTS);
+    std::shared_ptr<const DocumentSnapshot> result = latest_snapshot.lock();
+    try {
+        if (!result)
+            result = std::make_shared<const DocumentSnapshot>(file_data);
+        else if (!change.empty())
+            result = std::make_shared<const DocumentSnapshot>(*result, file_data, change);
+    }
+    catch (...) {
+        // The modifications taken must not be forgotten by the next snapshot.
+        latest_snapshot.reset();
+        throw;
+    }
+    latest_snapshot = result;
+    return result;
+}
+
+//! Makes a batch of edits in a single pass over the file.
+/*!
+ * The edits are sorted by position (unless they were added in order) and gathered into runs.
+ * The edits that stay within one line are made to each line together, so the line is rebuilt
+ * and recorded for undo once, however many edits it has, and only the part of it that changed
+ * is recorded. Edits that break or join lines are made together with all the others on the
+ * lines they touch; those lines are rebuilt and recorded for undo as one replacement of lines.
+ * The file is visited once for the lot and the damage is noted once. The current point is not
+ * moved. Carets are forgotten if the number of lines changes.
+ *
+ * \return false if the edits overlap, in which case nothing is changed, or if memory runs out
+ * (an error message has been displayed).
+ */
+bool EditFile::apply_edits(const EditBatch &batch)
+{
+    struct Span {
+        long first_line;
+        std::size_t first_offset;
+        long last_line;
+        std::size_t last_offset;
+        const std::string *text;
+    };
+
+    // A line and the edits within it, or the lines rebuilt by edits that break or join lines.
+    struct Run {
+        long first;        //!< The first line rebuilt.
+        long last;         //!< The last line rebuilt (first - 1 if none: text at the end).
+        std::size_t begin; //!< The spans of the run.
+        std::size_t end;
+        bool within_line;  //!< =true if the run's edits neither break nor join lines.
+    };
+
+    if (batch.empty())
+        return true;
+
+    // Positions past the end of a line (or of the file) are all the end of that line (or file).
+    const long size = file_data.size();
+    long measured = -1L;
+    std::size_t measured_length = 0;
+    const auto line_length = [&](const long line) {
+        if (line != measured) {
+            file_data.jump_to(line);
+            measured = line;
+            measured_length = file_data.get()->view().size();
+        }
+        return measured_length;
+    };
+    std::vector<Span> spans;
+    spans.reserve(batch.edits.size());
+    for (const EditBatch::Edit &edit : batch.edits) {
+        Span span{edit.first_line, edit.first_offset, edit.last_line, edit.last_offset,
+                  &edit.text};
+        if (span.first_line < 0L || span.last_line < span.first_line ||
+            (span.last_line == span.first_line && span.last_offset < span.first_offset))
+            return false;
+        if (span.first_line >= size)
+            span = Span{size, 0, size, 0, span.text};
+        else if (span.last_line >= size) {
+            span.last_line = size;
+            span.last_offset = 0;
+        }
+        if (span.first_line < size)
+            span.first_offset = std::min(span.first_offset, line_length(span.first_line));
+        if (span.last_line < size)
+            span.last_offset = std::min(span.last_offset, line_length(span.last_line));
+        spans.push_back(span);
+    }
+
+    // Insertions are put before a replacement starting at the same position.
+    const auto before = [](const long left_line, const std::size_t left_offset,
+                           const long right_line, const std::size_t right_offset) {
+        return left_line < right_line ||
+               (left_line == right_line && left_offset < right_offset);
+    };
+    const auto in_order = [&before](const Span &left, const Span &right) {
+        if (before(left.first_line, left.first_offset, right.first_line, right.first_offset))
+            return true;
+        if (before(right.first_line, right.first_offset, left.first_line, left.first_offset))
+            return false;
+        return before(left.last_line, left.last_offset, right.last_line, right.last_offset);
+    };
+    if (!std::is_sorted(spans.begin(), spans.end(), in_order))
+        std::stable_sort(spans.begin(), spans.end(), in_order);
+
+    std::vector<Run> runs;
+    for (std::size_t i = 0; i < spans.size(); ++i) {
+        const Span &span = spans[i];
+        if (i > 0 && before(span.first_line, span.first_offset, spans[i - 1].last_line,
+                            spans[i - 1].last_offset))
+            return false;
+        const bool within_line = span.first_line == span.last_line && span.first_line < size &&
+                                 span.text->find('\n') == std::string::npos;
+        const long last = std::min(span.last_line, size - 1);
+
+        // Text added at the end of the file follows any unfinished line before it.
+        const bool joined = i > 0 && span.first_line == size && spans[i - 1].last_line == size;
+        if (runs.empty() ||
+            (span.first_line > std::max(runs.back().first, runs.back().last) && !joined)) {
+            runs.push_back(Run{span.first_line, last, i, i + 1, within_line});
+            continue;
+        }
+        Run &run = runs.back();
+        run.last = std::max(run.last, last);
+        run.end = i + 1;
+        run.within_line = run.within_line && within_line;
+    }
+
+    long top = LONG_MAX;
+    long bottom = -1L;
+    bool moved = false;
+    try {
+        // The runs are done from the last so the line numbers of the others stay valid.
+        std::vector<EditBuffer> fresh;
+        std::string pending;
+        for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+            top = std::min(top, run->first);
+            bottom = std::max(bottom, run->last);
+            pending.clear();
+
+            if (run->within_line) {
+                file_data.jump_to(run->first);
+                EditBuffer *const line = file_data.get();
+                const std::string_view old_text = line->view();
+                std::size_t offset = 0;
+                for (std::size_t i = run->begin; i < run->end; ++i) {
+                    pending.append(old_text, offset, spans[i].first_offset - offset);
+                    pending.append(*spans[i].text);
+                    offset = spans[i].last_offset;
+                }
+                pending.append(old_text, offset, std::string_view::npos);
+
+                // Record only the part of the line that changed.
+                std::size_t prefix = 0;
+                const std::size_t shorter = std::min(old_text.size(), pending.size());
+                while (prefix < shorter && old_text[prefix] == pending[prefix])
+                    ++prefix;
+                std::size_t suffix = 0;
+                while (suffix < shorter - prefix &&
+                       old_text[old_text.size() - suffix - 1] ==
+                           pending[pending.size() - suffix - 1])
+                    ++suffix;
+                if (prefix == old_text.size() && prefix == pending.size())
+                    continue;
+                record_text(run->first, prefix, old_text.size(),
+                            old_text.substr(prefix, old_text.size() - prefix - suffix),
+                            std::string_view(pending).substr(
+                                prefix, pending.size() - prefix - suffix));
+                *line = EditBuffer(pending.data(), pending.size());
+                is_changed = true;
+                continue;
+            }
+
+            fresh.clear();
+            long line = run->first;
+            std::size_t offset = 0;
+
+            // Copies the text of the run from line and offset up to the given position.
+            const auto copy_to = [&](const long to_line, const std::size_t to_offset) {
+                for (; line < to_line && line <= run->last; ++line, offset = 0) {
+                    file_data.jump_to(line);
+                    const EditBuffer &old_line = *file_data.get();
+                    if (pending.empty() && offset == 0) {
+                        fresh.push_back(old_line);
+                        continue;
+                    }
+                    const std::string_view text = old_line.view();
+                    if (offset < text.size())
+                        pending.append(text, offset, std::string_view::npos);
+                    fresh.emplace_back(pending.data(), pending.size());
+                    pending.clear();
+                }
+                if (line == to_line && line <= run->last) {
+                    file_data.jump_to(line);
+                    const std::string_view text = file_data.get()->view();
+                    if (offset < to_offset)
+                        pending.append(text, offset, to_offset - offset);
+                }
+            };
+
+            for (std::size_t i = run->begin; i < run->end; ++i) {
+                const Span &span = spans[i];
+                copy_to(span.first_line, span.first_offset);
+                for (const char letter : *span.text) {
+                    if (letter != '\n') {
+                        pending.push_back(letter);
+                        continue;
+                    }
+                    fresh.emplace_back(pending.data(), pending.size());
+                    pending.clear();
+                }
+                line = std::min(span.last_line, run->last + 1);
+                offset = (line == span.last_line) ? span.last_offset : 0;
+            }
+            copy_to(run->last + 1, 0);
+            if (!pending.empty())
+                fresh.emplace_back(pending.data(), pending.size());
+
+            // The lines rebuilt take the place of the old ones.
+            const long old_count = run->last - run->first + 1;
+            const long new_count = static_cast<long>(fresh.size());
+            record_lines(run->first, old_count);
+            is_changed = true;
+            moved = moved || new_count != old_count;
+            file_data.jump_to(run->first);
+            const long common = std::min(old_count, new_count);
+            for (long i = 0; i < common; ++i)
+                *file_data.next() = std::move(fresh[static_cast<std::size_t>(i)]);
+            for (long i = common; i < old_count; ++i) {
+                delete file_data.get();
+                file_data.erase();
+            }
+            for (long i = common; i < new_count; ++i)
+                file_data.insert(new EditBuffer(std::move(fresh[static_cast<std::size_t>(i)])));
+        }
+    }
+    catch (std::bad_alloc &) {
+        mark_damaged_from(top);
+        memory_message("Can't make the edits to the file");
+        return false;
+    }
+
+    if (moved)
+        mark_damaged_from(top);
+    else
+        mark_damaged(top, bottom);
+    return true;
+}
+
 //! Return the range of the current block, if any.
 /*!
  * A block exists if the 'block' flag is set. Under that condition, the block ranges between
@@ -104,13 +528,31 @@ void EditFile::block_limits(long &top, long &bottom)
         top = current_point.cursor_line();
         bottom = current_point.cursor_line();
     }
-    else if (anchor <= current_point.cursor_line()) {
-        top = anchor;
-        bottom = current_point.cursor_line();
-    }
     else {
-        top = current_point.cursor_line();
-        bottom = anchor;
+        const long anchor_at = anchor_line();
+        top = std::min(anchor_at, current_point.cursor_line());
+        bottom = std::max(anchor_at, current_point.cursor_line());
+    }
+}
+
+//! Computes the columns spanned by a rectangular block.
+/*!
+ * The block includes the anchor column and the cursor column. If block mode is off or the
+ * block is not rectangular, the range is just the cursor column.
+ *
+ * \param left [out] The first column in the block.
+ * \param right [out] The column just past the last column in the block.
+ */
+void EditFile::column_limits(unsigned &left, unsigned &right)
+{
+    const unsigned column = current_point.cursor_column();
+    left = column;
+    right = column + 1;
+    if (column_block()) {
+        if (anchor_column < left)
+            left = anchor_column;
+        else
+            right = anchor_column + 1;
     }
 }
 
@@ -125,7 +567,8 @@ void EditFile::set_block_state(bool new_info)
 {
     block = new_info;
     if (block) {
-        anchor = current_point.cursor_line();
+        set_anchor(current_point.cursor_line());
+        columns = false;
     }
 }
 
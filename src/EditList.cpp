@@ -3,9 +3,460 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "Compression.hpp"
 #include "EditList.hpp"
 #include "EditBuffer.hpp"
 
+namespace {
+    // Chunks grow to twice this size before being split. Small chunks are merged.
+    constexpr std::size_t maximum_chunk_size = 512;
+
+    // Pending lines are appended at least this many at a time.
+    constexpr long pending_batch_size = 4096;
+
+    //! Returns the lowest set bit of a Fenwick tree position.
+    inline std::size_t low_bit(const std::size_t position)
+    {
+        return position & (~position + 1);
+    }
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Rebuilds the tree of chunk sizes from scratch in linear time.
+void EditList::rebuild_tree()
+{
+    const std::size_t count = chunks.size();
+    chunk_tree.assign(count + 1, 0L);
+    for (std::size_t position = 1; position <= count; ++position) {
+        chunk_tree[position] += static_cast<long>(chunks[position - 1].size());
+        const std::size_t parent = position + low_bit(position);
+        if (parent <= count)
+            chunk_tree[parent] += chunk_tree[position];
+    }
+    tree_valid = true;
+}
+
+//! Records that the size of the given chunk changed by delta.
+void EditList::adjust_tree(const std::size_t chunk_index, const long delta)
+{
+    if (!tree_valid)
+        return;
+    for (std::size_t position = chunk_index + 1; position < chunk_tree.size();
+         position += low_bit(position)) {
+        chunk_tree[position] += delta;
+    }
+}
+
+//! Extends the tree to cover a chunk just added at the end of the list.
+void EditList::append_to_tree()
+{
+    if (!tree_valid)
+        return;
+    // The new node covers the new chunk and the low_bit - 1 chunks before it.
+    const std::size_t position = chunks.size();
+    chunk_tree.push_back(static_cast<long>(chunks.back().size()) + tree_prefix(position - 1) -
+                         tree_prefix(position - low_bit(position)));
+}
+
+//! Returns the total size of the first count chunks.
+long EditList::tree_prefix(std::size_t count) const
+{
+    long sum = 0;
+    for (; count > 0; count -= low_bit(count)) {
+        sum += chunk_tree[count];
+    }
+    return sum;
+}
+
+//! Divides the current chunk into two halves, adjusting the current point as necessary.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void EditList::split_chunk()
+{
+    const std::size_t half = chunks[chunk].size() / 2;
+    Chunk upper(chunks[chunk].begin() + half, chunks[chunk].end());
+    upper.touched = chunks[chunk].touched;
+
+    chunks.insert(chunks.begin() + chunk + 1, std::move(upper));
+    chunks[chunk].resize(half);
+    tree_valid = false;
+
+    if (offset >= half) {
+        offset -= half;
+        ++chunk;
+    }
+}
+
+//! Absorbs the chunk following the given chunk if the two together are small enough.
+/*!
+ * A current point in the given chunk remains valid.
+ */
+void EditList::merge_chunk(const std::size_t chunk_index)
+{
+    if (chunk_index + 1 >= chunks.size())
+        return;
+    if (chunks[chunk_index].compressed() || chunks[chunk_index + 1].compressed())
+        return;
+    if (chunks[chunk_index].size() + chunks[chunk_index + 1].size() > maximum_chunk_size)
+        return;
+
+    chunks[chunk_index].insert(chunks[chunk_index].end(), chunks[chunk_index + 1].begin(),
+                               chunks[chunk_index + 1].end());
+    chunks.erase(chunks.begin() + chunk_index + 1);
+    tree_valid = false;
+}
+
+//! Returns the chunk holding the item at position and stores the item's offset in that chunk.
+/*!
+ * The position must be a valid index. The last position whose prefix sum is <= position is
+ * found by descending the tree of chunk sizes. That many chunks precede the item.
+ */
+std::size_t EditList::find_chunk(const long position, std::size_t &item_offset)
+{
+    if (!tree_valid)
+        rebuild_tree();
+
+    const std::size_t count = chunks.size();
+    std::size_t step = 1;
+    while (step * 2 <= count)
+        step *= 2;
+    std::size_t tree_position = 0;
+    long remaining = position;
+    for (; step > 0; step /= 2) {
+        if (tree_position + step <= count && chunk_tree[tree_position + step] <= remaining) {
+            tree_position += step;
+            remaining -= chunk_tree[tree_position];
+        }
+    }
+    item_offset = static_cast<std::size_t>(remaining);
+    return tree_position;
+}
+
+//! Ensures that a chunk begins with the item at position, splitting a chunk if necessary.
+/*!
+ * This invalidates the current point; the caller must reposition it afterward.
+ *
+ * \return The index of the chunk beginning at position (chunks.size() if position is just past
+ * the last item).
+ * \throws std::bad_alloc if insufficient memory.
+ */
+std::size_t EditList::split_at(const long position)
+{
+    if (position >= item_count)
+        return chunks.size();
+
+    std::size_t item_offset;
+    const std::size_t chunk_index = find_chunk(position, item_offset);
+    if (item_offset == 0)
+        return chunk_index;
+
+    expand(chunk_index);
+    Chunk upper(chunks[chunk_index].begin() + item_offset, chunks[chunk_index].end());
+    chunks[chunk_index].resize(item_offset);
+    chunks.insert(chunks.begin() + chunk_index + 1, std::move(upper));
+    tree_valid = false;
+    return chunk_index + 1;
+}
+
+//! Moves the current point to new_index after the chunks have been rearranged.
+void EditList::reposition(const long new_index)
+{
+    index = item_count;
+    chunk = chunks.size();
+    offset = 0;
+    jump_to(new_index);
+}
+
+//! Appends pending lines until the given index exists or there are no more pending lines.
+/*!
+ * The current point keeps its index. If it was just past the end it now refers to the first of
+ * the appended lines.
+ *
+ * \return true if the item at through_index exists.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+bool EditList::supply(const long through_index)
+{
+    if (!pending)
+        return through_index < item_count;
+
+    // Note where the first new item will go in case the current point must move to it.
+    const bool at_end = (chunk == chunks.size());
+    std::size_t first_chunk = chunks.size();
+    std::size_t first_offset = 0;
+    if (!chunks.empty() && chunks.back().size() < maximum_chunk_size &&
+        !chunks.back().compressed()) {
+        first_chunk = chunks.size() - 1;
+        first_offset = chunks.back().size();
+    }
+
+    const long target = through_index + pending_batch_size;
+    while (item_count <= target) {
+        EditBuffer *const line = pending->next_line();
+        if (line == nullptr) {
+            pending.reset();
+            break;
+        }
+        if (chunks.empty() || chunks.back().size() >= maximum_chunk_size ||
+            chunks.back().compressed()) {
+            chunks.push_back(Chunk());
+            chunks.back().reserve(maximum_chunk_size);
+            chunks.back().push_back(line);
+            chunks.back().touched = clock;
+            append_to_tree();
+
+            // Don't let a long batch expand more than the limit at once.
+            const std::size_t lagging = chunks.size() - 1 - warm_limit;
+            if (warm_limit != 0 && chunks.size() > warm_limit + 1 && lagging != chunk &&
+                !chunks[lagging].compressed())
+                compress_chunk(lagging);
+        }
+        else {
+            chunks.back().push_back(line);
+            adjust_tree(chunks.size() - 1, 1L);
+        }
+        ++item_count;
+    }
+
+    // The current point was just past the end of the items; it now refers to the first new one.
+    if (at_end && index < item_count) {
+        chunk = first_chunk;
+        offset = first_offset;
+    }
+    compress_cold(chunk);
+    return through_index < item_count;
+}
+
+//! Restores the EditBuffers of a compressed chunk.
+/*!
+ * The chunk counts as the one visited most recently. Other chunks may be compressed to keep
+ * within the warm limit, but not the chunk holding the current point.
+ *
+ * \return The chunk.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+EditList::Chunk &EditList::expand(const std::size_t chunk_index)
+{
+    Chunk &target = chunks[chunk_index];
+    if (!target.compressed())
+        return target;
+    if (target.blank) {
+        std::size_t item = 0;
+        try {
+            for (; item < target.size(); ++item)
+                target[item] = new EditBuffer;
+        }
+        catch (std::bad_alloc &) {
+            while (item > 0) {
+                delete target[--item];
+                target[item] = nullptr;
+            }
+            throw;
+        }
+        target.blank = false;
+        target.touched = ++clock;
+        compress_cold(chunk_index);
+        return target;
+    }
+
+    std::string text(target.text_size, '\0');
+    if (!Compression::expand(target.packed, &text[0], text.size()))
+        throw std::logic_error("EditList: compressed chunk is damaged");
+
+    std::size_t position = 0;
+    std::size_t item = 0;
+    try {
+        for (; item < target.size(); ++item) {
+            std::size_t length = 0;
+            unsigned shift = 0;
+            unsigned char byte;
+            do {
+                byte = static_cast<unsigned char>(text[position++]);
+                length |= static_cast<std::size_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+            target[item] = new EditBuffer(text.data() + position, length);
+            position += length;
+        }
+    }
+    catch (std::bad_alloc &) {
+        while (item > 0) {
+            delete target[--item];
+            target[item] = nullptr;
+        }
+        throw;
+    }
+
+    std::string().swap(target.packed);
+    target.text_size = 0;
+    target.touched = ++clock;
+    compress_cold(chunk_index);
+    return target;
+}
+
+//! Returns the EditBuffer that read_next gives for every line of a blank chunk.
+const EditBuffer *EditList::blank_line()
+{
+    static const EditBuffer empty;
+    return &empty;
+}
+
+//! Compresses the chunks visited least recently until no more than warm_limit are expanded.
+/*!
+ * Neither the chunk holding the current point nor the given chunk is compressed.
+ */
+void EditList::compress_cold(const std::size_t keep)
+{
+    if (warm_limit == 0)
+        return;
+
+    std::vector<std::size_t> warm;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i].compressed())
+            warm.push_back(i);
+    }
+    if (warm.size() <= warm_limit)
+        return;
+
+    std::size_t excess = warm.size() - warm_limit;
+    std::stable_sort(warm.begin(), warm.end(), [this](std::size_t left, std::size_t right) {
+        return chunks[left].touched < chunks[right].touched;
+    });
+    for (std::size_t i = 0; i < warm.size() && excess > 0; ++i) {
+        if (warm[i] == chunk || warm[i] == keep)
+            continue;
+        if (!compress_chunk(warm[i]))
+            return;
+        --excess;
+    }
+}
+
+//! Replaces the EditBuffers of a chunk with their compressed text.
+/*!
+ * \return false if there is not enough memory to compress the chunk (it is left as it is).
+ */
+bool EditList::compress_chunk(const std::size_t chunk_index)
+{
+    Chunk &target = chunks[chunk_index];
+    try {
+        std::string text;
+        for (EditBuffer *line : target) {
+            line->compact();
+            const std::string_view view = line->view();
+            std::size_t length = view.size();
+            while (length >= 0x80) {
+                text.push_back(static_cast<char>((length & 0x7F) | 0x80));
+                length >>= 7;
+            }
+            text.push_back(static_cast<char>(length));
+            text.append(view);
+        }
+        std::string packed;
+        Compression::compress(text, packed);
+        packed.shrink_to_fit();
+        target.packed = std::move(packed);
+        target.text_size = text.size();
+    }
+    catch (std::bad_alloc &) {
+        return false;
+    }
+
+    for (EditBuffer *&line : target) {
+        delete line;
+        line = nullptr;
+    }
+    return true;
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Creates an empty list.
+EditList::EditList()
+    : chunk_tree(1, 0L), tree_valid(true), item_count(0L), index(0L), chunk(0), offset(0),
+      warm_limit(0), clock(0)
+{
+}
+
+//! Inserts a new EditBuffer* before the list's current point.
+/*!
+ * The current point continues to refer to the same item (its index is incremented).
+ *
+ * \param item A pointer to a dynamically allocated EditBuffer to be added to the list before
+ * the list's current point.
+ * \return The same pointer it is given.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+EditBuffer *EditList::insert(EditBuffer *const item)
+{
+    // Appending is the common case when files are loaded; keep the tree up to date cheaply.
+    if (chunk == chunks.size()) {
+        if (chunks.empty() || chunks.back().size() >= maximum_chunk_size ||
+            chunks.back().compressed()) {
+            chunks.push_back(Chunk(1, item));
+            chunks.back().touched = clock;
+            append_to_tree();
+        }
+        else {
+            chunks.back().push_back(item);
+            adjust_tree(chunks.size() - 1, 1L);
+        }
+        ++item_count;
+        ++index;
+        chunk = chunks.size();
+        return item;
+    }
+
+    Chunk &target = expand(chunk);
+    target.insert(target.begin() + offset, item);
+    ++offset;
+    ++index;
+    ++item_count;
+    adjust_tree(chunk, 1L);
+    if (chunks[chunk].size() > 2 * maximum_chunk_size)
+        split_chunk();
+    return item;
+}
+
+//! Erases the item at the current point and advances the current point.
+/*!
+ * The EditBuffer pointed at by the erased item is not deleted. The current index is unchanged
+ * and thus refers to the item that followed the erased one.
+ */
+void EditList::erase()
+{
+    if (chunk == chunks.size() && !supply(index))
+        return;
+
+    Chunk &target = expand(chunk);
+    target.erase(target.begin() + offset);
+    --item_count;
+    if (chunks[chunk].empty()) {
+        chunks.erase(chunks.begin() + chunk);
+        tree_valid = false;
+        offset = 0;
+        return;
+    }
+
+    adjust_tree(chunk, -1L);
+    merge_chunk(chunk);
+    if (offset == chunks[chunk].size()) {
+        ++chunk;
+        offset = 0;
+    }
+}
+
 //! Removes all the EditBuffers in the list.
 /*!
  * This function clears the list without destroying it. The EditBuffers pointed at by the list
@@ -13,11 +464,186 @@
  */
 void EditList::clear()
 {
-    EditBuffer *p;
+    pending.reset();
+    for (Chunk &current_chunk : chunks) {
+        for (EditBuffer *p : current_chunk) {
+            delete p;
+        }
+    }
+    chunks.clear();
+    chunk_tree.assign(1, 0L);
+    tree_valid = true;
+    item_count = 0L;
+    index = 0L;
+    chunk = 0;
+    offset = 0;
+}
+
+//! Moves the current point to the specified index.
+/*!
+ * Indices inside the chunk holding the current point are reached directly. Otherwise the
+ * chunk containing the new index is found by descending the tree of chunk sizes.
+ * If the given index is out of bounds, the current point is left just past the end of the
+ * list.
+ *
+ * \param new_index The desired location of the current point (zero based).
+ */
+void EditList::jump_to(const long new_index)
+{
+    // Handle case of out of bounds index.
+    if (new_index >= item_count)
+        supply(new_index);
+    if (new_index < 0L || new_index >= item_count) {
+        index = item_count;
+        chunk = chunks.size();
+        offset = 0;
+        return;
+    }
 
-    jump_to(0);
-    while ((p = next()) != nullptr) {
-        delete p;
+    // Is the new index in the current chunk?
+    if (chunk < chunks.size()) {
+        const long base = index - static_cast<long>(offset);
+        if (new_index >= base && new_index < base + static_cast<long>(chunks[chunk].size())) {
+            offset = static_cast<std::size_t>(new_index - base);
+            index = new_index;
+            return;
+        }
     }
-    List<EditBuffer *>::clear();
+
+    if (chunk < chunks.size())
+        chunks[chunk].touched = clock;
+    chunk = find_chunk(new_index, offset);
+    index = new_index;
+}
+
+//! Moves items starting at the current point to the end of another list.
+/*!
+ * Whole chunks of items are moved so the cost depends on the number of chunks involved rather
+ * than on the number of items. At most two chunks are divided. The current point refers to the
+ * item that followed the last one moved. The destination's current point is left at its end.
+ *
+ * \param count The number of items to move. Fewer are moved if the list ends first.
+ * \param destination The list to receive the items. It must not have pending lines.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void EditList::splice_out(long count, EditList &destination)
+{
+    if (count <= 0 || &destination == this)
+        return;
+    supply(index + count - 1);
+    if (count > item_count - index)
+        count = item_count - index;
+    if (count <= 0)
+        return;
+
+    const long start = index;
+    const std::size_t first = split_at(start);
+    const std::size_t last = split_at(start + count);
+
+    destination.chunks.insert(destination.chunks.end(),
+                              std::make_move_iterator(chunks.begin() + first),
+                              std::make_move_iterator(chunks.begin() + last));
+    destination.item_count += count;
+    destination.tree_valid = false;
+    destination.reposition(destination.item_count);
+
+    chunks.erase(chunks.begin() + first, chunks.begin() + last);
+    item_count -= count;
+    tree_valid = false;
+    if (first > 0)
+        merge_chunk(first - 1);
+    reposition(start);
+}
+
+//! Moves all the items of another list before the current point.
+/*!
+ * As with splice_out, whole chunks are moved. The current point continues to refer to the same
+ * item (its index is increased). The source list is left empty.
+ *
+ * \param source The list providing the items. Its pending lines, if any, are included.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void EditList::splice_in(EditList &source)
+{
+    if (&source == this)
+        return;
+    source.set_end();
+    if (source.item_count == 0)
+        return;
+    if (index == item_count)
+        supply(index);
+
+    const long count = source.item_count;
+    const long new_index = index + count;
+    const std::size_t position = split_at(index);
+
+    chunks.insert(chunks.begin() + position, std::make_move_iterator(source.chunks.begin()),
+                  std::make_move_iterator(source.chunks.end()));
+    item_count += count;
+    tree_valid = false;
+
+    // Merge small chunks at the seams, the later one first so the earlier index stays valid.
+    const std::size_t end_seam = position + source.chunks.size();
+    if (end_seam > 0)
+        merge_chunk(end_seam - 1);
+    if (position > 0)
+        merge_chunk(position - 1);
+    reposition(new_index);
+
+    source.chunks.clear();
+    source.chunk_tree.assign(1, 0L);
+    source.tree_valid = true;
+    source.item_count = 0L;
+    source.index = 0L;
+    source.chunk = 0;
+    source.offset = 0;
+}
+
+//! Appends empty lines that have no EditBuffers until they are visited.
+/*!
+ * Any pending lines are appended first. The lines are held in blank chunks, which take much
+ * less memory than EditBuffers, and each chunk is expanded only when the current point reaches
+ * it (see read_next). The current point is left just past the end.
+ *
+ * \param count The number of lines to append.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void EditList::append_blank(long count)
+{
+    set_end();
+    while (count > 0) {
+        const long length = std::min(count, static_cast<long>(maximum_chunk_size));
+        chunks.push_back(Chunk(static_cast<std::size_t>(length), nullptr));
+        chunks.back().blank = true;
+        chunks.back().touched = clock;
+        append_to_tree();
+        item_count += length;
+        count -= length;
+    }
+    index = item_count;
+    chunk = chunks.size();
+    offset = 0;
+}
+
+//! Gives the list lines that follow its last item, replacing any it already has.
+/*!
+ * The lines do not become items until the current point reaches them.
+ */
+void EditList::set_pending(std::unique_ptr<PendingLines> source)
+{
+    pending = std::move(source);
+}
+
+//! Keeps all but the given number of chunks compressed.
+/*!
+ * The chunks visited least recently are compressed now and whenever chunks are expanded or
+ * appended. A chunk_count of zero leaves chunks expanded once they have been visited.
+ *
+ * \param chunk_count The most chunks to keep expanded. It should be large enough to cover the
+ * lines that are shown, being edited, or otherwise in use at once.
+ */
+void EditList::set_warm_limit(const std::size_t chunk_count)
+{
+    warm_limit = chunk_count;
+    compress_cold(chunk);
 }
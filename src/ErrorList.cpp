@@ -0,0 +1,380 @@
+/*! \file    ErrorList.cpp
+ *  \brief   Implementation of the ErrorList abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "EditBuffer.hpp"
+#include "ErrorList.hpp"
+#include "FileList.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
+#include "global.hpp"
+#include "support.hpp"
+
+using ErrorList::Entry;
+using ErrorList::Severity;
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    // A line of output longer than this without a line break is not scanned.
+    constexpr std::size_t partial_limit = 64U * 1024U;
+
+    std::vector<Entry> entries;
+    std::string partial; //!< The output after the last line break.
+    long visited = -1;   //!< The index of the entry last visited.
+
+    bool is_digit(const char ch)
+    {
+        return ch >= '0' && ch <= '9';
+    }
+
+    std::string_view trim_front(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+        return text;
+    }
+
+    //! Reads a decimal number at offset, moving offset past it.
+    /*!
+     * \return The number or -1 if there are no digits at offset.
+     */
+    long read_number(const std::string_view text, std::size_t &offset)
+    {
+        long value = -1;
+        for (; offset < text.size() && is_digit(text[offset]); ++offset) {
+            if (value < 100000000L)
+                value = ((value < 0) ? 0 : value * 10) + (text[offset] - '0');
+        }
+        return value;
+    }
+
+    //! Recognizes a severity at the start of text, as in "error: ..." or "error C2065: ...".
+    /*!
+     * \param text [in, out] Left holding the rest of the text after the colon. A code between
+     * the severity and the colon, given by MSVC and its linker, is kept.
+     */
+    bool take_severity(std::string_view &text, Severity &severity)
+    {
+        static const struct {
+            std::string_view word;
+            Severity severity;
+        } words[] = {{"fatal error", ErrorList::ERROR},
+                     {"error", ErrorList::ERROR},
+                     {"warning", ErrorList::WARNING},
+                     {"note", ErrorList::NOTE}};
+
+        for (const auto &word : words) {
+            if (text.substr(0, word.word.size()) != word.word)
+                continue;
+            std::string_view rest = text.substr(word.word.size());
+            if (!rest.empty() && rest.front() == ':') {
+                rest.remove_prefix(1);
+            }
+            else if (!rest.empty() && rest.front() == ' ') {
+                std::size_t end = 1;
+                while (end < rest.size() && std::isalnum(static_cast<unsigned char>(rest[end])))
+                    ++end;
+                if (end == 1 || end == rest.size() || rest[end] != ':')
+                    return false;
+                rest.remove_prefix(1);
+            }
+            else {
+                return false;
+            }
+            text = trim_front(rest);
+            severity = word.severity;
+            return true;
+        }
+        return false;
+    }
+
+    //! Returns true if text is a GNU linker message, which is given without a severity.
+    bool is_linker_message(const std::string_view text)
+    {
+        return text.substr(0, 19) == "undefined reference" ||
+               text.substr(0, 19) == "multiple definition";
+    }
+
+    void set_entry(Entry &entry, const std::string_view file, const long line,
+                   const long column, const Severity severity, const std::string_view message)
+    {
+        entry.file.assign(file);
+        entry.line = (line > 0) ? line - 1 : -1;
+        entry.column = (column > 0) ? column - 1 : -1;
+        entry.severity = severity;
+        entry.message.assign(message);
+    }
+
+    //! Recognizes the formats of MSVC: "name(line): ..." or "name(line,column): ...".
+    /*!
+     * The Microsoft linker's problems, as in "main.obj : error LNK2019: ...", name no source
+     * file.
+     */
+    bool parse_microsoft(const std::string_view line, Entry &entry)
+    {
+        for (std::size_t close = line.find(')'); close != std::string_view::npos;
+             close = line.find(')', close + 1)) {
+            std::size_t after = close + 1;
+            if (line.substr(after, 1) == " ")
+                ++after;
+            if (line.substr(after, 2) != ": ")
+                continue;
+
+            std::size_t open = close;
+            while (open > 0 && (is_digit(line[open - 1]) || line[open - 1] == ','))
+                --open;
+            if (open < 2 || open == close || line[open - 1] != '(')
+                continue;
+            std::size_t offset = open;
+            const long number = read_number(line, offset);
+            long column = -1;
+            if (offset < close && line[offset] == ',') {
+                ++offset;
+                column = read_number(line, offset);
+            }
+            std::string_view rest = trim_front(line.substr(after + 2));
+            Severity severity;
+            if (number < 0 || offset != close || !take_severity(rest, severity))
+                continue;
+            set_entry(entry, line.substr(0, open - 1), number, column, severity, rest);
+            return true;
+        }
+
+        const std::size_t separator = line.find(" : ");
+        if (separator == std::string_view::npos)
+            return false;
+        std::string_view rest = trim_front(line.substr(separator + 3));
+        Severity severity;
+        if (!take_severity(rest, severity) || rest.substr(0, 3) != "LNK")
+            return false;
+        set_entry(entry, std::string_view(), -1, -1, severity, rest);
+        return true;
+    }
+
+    //! Recognizes the formats of gcc, clang, and the GNU linker.
+    /*!
+     * Compilers give "name:line:column: severity: ..." or "name:line: severity: ...". The
+     * linker gives "name:line: ..." or "name:(section): ...", sometimes after its own name.
+     * Problems with the tools themselves, as in "collect2: error: ...", name no file.
+     */
+    bool parse_gnu(const std::string_view line, Entry &entry)
+    {
+        // The colon of a drive letter, as in C:/src/main.c, is part of the name.
+        std::size_t colon = 0;
+        if (line.size() > 2 && std::isalpha(static_cast<unsigned char>(line[0])) &&
+            line[1] == ':' && (line[2] == '/' || line[2] == '\\'))
+            colon = 2;
+
+        while ((colon = line.find(':', colon + 1)) != std::string_view::npos) {
+            std::size_t offset = colon + 1;
+            long column = -1;
+            const long number = read_number(line, offset);
+            bool located = true;
+            if (number >= 0) {
+                if (offset == line.size() || line[offset] != ':')
+                    continue;
+                std::size_t after = ++offset;
+                column = read_number(line, after);
+                if (column >= 0 && after < line.size() && line[after] == ':')
+                    offset = after + 1;
+                else
+                    column = -1;
+            }
+            else if (offset < line.size() && line[offset] == '(') {
+                const std::size_t close = line.find("):", offset);
+                if (close == std::string_view::npos)
+                    continue;
+                offset = close + 2;
+            }
+            else {
+                located = false;
+            }
+
+            if (offset == line.size() || line[offset] != ' ')
+                continue;
+            std::string_view rest = trim_front(line.substr(offset));
+            Severity severity = ErrorList::ERROR;
+            if (!take_severity(rest, severity) && !(located && is_linker_message(rest)))
+                continue;
+
+            // The linker puts its own name before the file's.
+            std::string_view file = line.substr(0, colon);
+            const std::size_t prefix = file.rfind(": ");
+            if (prefix != std::string_view::npos)
+                file.remove_prefix(prefix + 2);
+            if (!located)
+                file = std::string_view();
+            set_entry(entry, file, number, column, severity, rest);
+            return true;
+        }
+        return false;
+    }
+
+    //! Adds the problem reported by a line of output, if any.
+    void add_line(const std::string_view line)
+    {
+        try {
+            Entry entry;
+            if (ErrorList::parse(line, entry))
+                entries.push_back(std::move(entry));
+        }
+        catch (std::bad_alloc &) {
+            // The problem is left out.
+        }
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace ErrorList {
+
+    bool parse(std::string_view line, Entry &entry)
+    {
+        // Programs on Windows end their lines with a carriage return.
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        line = trim_front(line);
+        if (line.empty())
+            return false;
+        return parse_microsoft(line, entry) || parse_gnu(line, entry);
+    }
+
+    void start()
+    {
+        entries.clear();
+        partial.clear();
+        visited = -1;
+    }
+
+    void scan(const std::string_view text)
+    {
+        std::size_t start = 0;
+        std::size_t end;
+        while ((end = text.find('\n', start)) != std::string_view::npos) {
+            if (partial.empty())
+                add_line(text.substr(start, end - start));
+            else {
+                partial.append(text.substr(start, end - start));
+                add_line(partial);
+                partial.clear();
+            }
+            start = end + 1;
+        }
+        if (partial.size() + (text.size() - start) <= partial_limit)
+            partial.append(text.substr(start));
+        else
+            partial.clear();
+    }
+
+    void finish()
+    {
+        if (!partial.empty())
+            add_line(partial);
+        partial.clear();
+    }
+
+    long count()
+    {
+        return static_cast<long>(entries.size());
+    }
+
+    const Entry &entry(const long index)
+    {
+        return entries[static_cast<std::size_t>(index)];
+    }
+
+    std::string describe(const Entry &entry, const std::size_t width)
+    {
+        static const char *const severity_names[] = {"error", "warning", "note"};
+        std::string result;
+        if (!entry.file.empty()) {
+            result = entry.file;
+            if (entry.line >= 0)
+                result += ":" + std::to_string(entry.line + 1);
+            if (entry.line >= 0 && entry.column >= 0)
+                result += ":" + std::to_string(entry.column + 1);
+            result += ": ";
+        }
+        result += severity_names[entry.severity];
+        result += ": ";
+        result += entry.message;
+        if (result.size() > width)
+            result.resize(width);
+        return result;
+    }
+
+    long current()
+    {
+        return visited;
+    }
+
+    long next()
+    {
+        const long size = count();
+        for (long i = 1; i <= size; ++i) {
+            const long index = (std::max(visited, -1L) + i) % size;
+            if (entries[static_cast<std::size_t>(index)].severity != NOTE)
+                return index;
+        }
+        return -1;
+    }
+
+    bool jump(const long index)
+    {
+        visited = index;
+        const Entry problem = entries[static_cast<std::size_t>(index)];
+        if (!problem.file.empty() && !FileList::lookup(problem.file.c_str())) {
+            std::FILE *const source = std::fopen(problem.file.c_str(), "r");
+            if (source == nullptr) {
+                error_message("Can't find %.100s", problem.file.c_str());
+                return false;
+            }
+            std::fclose(source);
+            if (restricted_mode) {
+                error_message("Can't load additional files in restricted mode");
+                return false;
+            }
+            if (!FileList::new_file(problem.file.c_str()))
+                return false;
+        }
+
+        // A column is a byte offset in the line, which may hold tabs.
+        if (!problem.file.empty() && problem.line >= 0) {
+            YEditFile &the_file = FileList::active_file();
+            const EditBuffer *const text = the_file.line_at(problem.line);
+            the_file.CP().jump_to_line(problem.line);
+            if (text != nullptr && problem.column >= 0)
+                the_file.CP().jump_to_column(static_cast<unsigned>(text->column_of(
+                    std::min(static_cast<std::size_t>(problem.column), text->length()),
+                    the_file.tab_distance())));
+            else
+                the_file.CP().jump_to_column(0);
+        }
+
+        // The problem is shown where it is, under its description.
+        WindowList::display();
+        if (problem.severity == ERROR)
+            error_message("%.120s", problem.message.c_str());
+        else
+            warning_message("%.120s", problem.message.c_str());
+        return true;
+    }
+
+} // namespace ErrorList
@@ -0,0 +1,360 @@
+/*! \file    EventLoop.cpp
+ *  \brief   Implementation of the EventLoop abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <screen/environ.hpp>
+#include <screen/screen.hpp>
+
+#if eOPSYS == ePOSIX
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <windows.h>
+#endif
+
+#include "EventLoop.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Timer {
+        unsigned id;
+        Clock::time_point due;
+        Clock::duration interval;
+        bool repeat;
+        EventLoop::Callback callback;
+    };
+
+    struct Watch {
+        EventLoop::Source source;
+        EventLoop::Callback callback;
+    };
+
+    //! Things other threads may touch, together with the means of waking the main thread.
+    class Mailbox {
+      public:
+        Mailbox();
+
+        void post(EventLoop::Callback callback);
+        void take(std::vector<EventLoop::Callback> &callbacks);
+
+#if eOPSYS == ePOSIX
+        int wake_fd() const { return wake_read; }
+#elif eOPSYS == eWINDOWS
+        HANDLE wake_event() const { return wake; }
+#endif
+
+      private:
+        std::mutex lock;                           //!< Protects posted.
+        std::vector<EventLoop::Callback> posted;   //!< Callbacks not yet run.
+#if eOPSYS == ePOSIX
+        int wake_read;  //!< A byte is written to the pipe to wake the main thread.
+        int wake_write;
+#elif eOPSYS == eWINDOWS
+        HANDLE wake;    //!< Signaled to wake the main thread.
+#endif
+    };
+
+    Mailbox::Mailbox()
+    {
+#if eOPSYS == ePOSIX
+        int ends[2];
+        if (pipe(ends) == -1) {
+            ends[0] = -1;
+            ends[1] = -1;
+        }
+        else {
+            for (int end : ends) {
+                fcntl(end, F_SETFD, FD_CLOEXEC);
+                fcntl(end, F_SETFL, fcntl(end, F_GETFL) | O_NONBLOCK);
+            }
+        }
+        wake_read = ends[0];
+        wake_write = ends[1];
+#elif eOPSYS == eWINDOWS
+        wake = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+#endif
+    }
+
+    void Mailbox::post(EventLoop::Callback callback)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            posted.push_back(std::move(callback));
+        }
+#if eOPSYS == ePOSIX
+        // If the pipe is full the main thread is already certain to wake.
+        const char byte = 0;
+        if (wake_write != -1 && write(wake_write, &byte, 1) == -1) {
+        }
+#elif eOPSYS == eWINDOWS
+        SetEvent(wake);
+#endif
+    }
+
+    //! Moves the posted callbacks into callbacks (which should be empty).
+    void Mailbox::take(std::vector<EventLoop::Callback> &callbacks)
+    {
+#if eOPSYS == ePOSIX
+        char buffer[64];
+        while (wake_read != -1 && read(wake_read, buffer, sizeof(buffer)) > 0) {
+        }
+#endif
+        std::lock_guard<std::mutex> guard(lock);
+        callbacks.swap(posted);
+    }
+
+    //! Returns the mailbox. It is never destroyed so that threads may post during exit.
+    Mailbox &mailbox()
+    {
+        static Mailbox *const box = new Mailbox;
+        return *box;
+    }
+
+    std::vector<Timer> timers;                   //!< Pending timers in no particular order.
+    unsigned last_timer = 0;                     //!< Identifier of the newest timer.
+    std::vector<Watch> watches;                  //!< Sources being waited for.
+    std::vector<std::function<bool()>> idlers;   //!< Idle tasks.
+    std::size_t next_idler = 0;                  //!< The idle task to call next.
+    bool idle_finished = false;                  //!< =true if no idle task has work to do.
+
+    //! Runs the callbacks posted by other threads. Returns true if there were any.
+    bool run_posted()
+    {
+        std::vector<EventLoop::Callback> callbacks;
+        mailbox().take(callbacks);
+        for (EventLoop::Callback &callback : callbacks) {
+            callback();
+        }
+        return !callbacks.empty();
+    }
+
+    //! Runs the timers that are due. Returns true if there were any.
+    bool run_timers()
+    {
+        bool ran = false;
+        const Clock::time_point now = Clock::now();
+
+        // Callbacks may add or cancel timers so the earliest due timer is found each time.
+        for (;;) {
+            auto timer = std::min_element(timers.begin(), timers.end(),
+                                          [](const Timer &left, const Timer &right) {
+                                              return left.due < right.due;
+                                          });
+            if (timer == timers.end() || timer->due > now)
+                return ran;
+
+            EventLoop::Callback callback = timer->callback;
+            if (timer->repeat)
+                timer->due = std::max(timer->due + timer->interval, now);
+            else
+                timers.erase(timer);
+            callback();
+            ran = true;
+        }
+    }
+
+    //! Calls one idle task that has work to do. Returns false if none of them does.
+    bool run_idle()
+    {
+        for (std::size_t tried = 0; tried < idlers.size(); ++tried) {
+            if (next_idler >= idlers.size())
+                next_idler = 0;
+            if (idlers[next_idler++]())
+                return true;
+        }
+        return false;
+    }
+
+    //! Returns the number of milliseconds until the next timer is due (-1 if there is none).
+    int time_to_next_timer()
+    {
+        if (timers.empty())
+            return -1;
+        Clock::time_point earliest = timers.front().due;
+        for (const Timer &timer : timers) {
+            earliest = std::min(earliest, timer.due);
+        }
+        const auto delay =
+            std::chrono::ceil<std::chrono::milliseconds>(earliest - Clock::now()).count();
+        return static_cast<int>(std::clamp<long long>(delay, 0, 60 * 1000));
+    }
+
+    //! Sleeps until a key or a source is ready, something is posted, or the timeout expires.
+    /*!
+     * The sleep also ends if the terminal reports a change in its size, which the idle tasks
+     * may want to look at.
+     *
+     * \return true if a source's callback was run or the terminal reported a new size.
+     */
+    bool sleep(const int timeout)
+    {
+        const unsigned long size_reports = scr::size_reports();
+#if eOPSYS == ePOSIX
+        std::vector<pollfd> ready;
+        ready.push_back(pollfd{STDIN_FILENO, POLLIN, 0});
+        ready.push_back(pollfd{mailbox().wake_fd(), POLLIN, 0});
+        for (const Watch &watch : watches) {
+            ready.push_back(pollfd{watch.source, POLLIN, 0});
+        }
+        if (poll(ready.data(), ready.size(), timeout) <= 0)
+            return scr::size_reports() != size_reports;
+
+        // Copy the ready sources first since callbacks may change the watches.
+        std::vector<EventLoop::Source> sources;
+        for (std::size_t i = 2; i < ready.size(); ++i) {
+            if (ready[i].revents != 0)
+                sources.push_back(ready[i].fd);
+        }
+#elif eOPSYS == eWINDOWS
+        // The console can't be waited on for keystrokes alone, so it is checked in slices.
+        std::vector<HANDLE> handles;
+        handles.push_back(mailbox().wake_event());
+        for (const Watch &watch : watches) {
+            handles.push_back(watch.source);
+        }
+        const Clock::time_point give_up = Clock::now() + std::chrono::milliseconds(timeout);
+        std::vector<EventLoop::Source> sources;
+        for (;;) {
+            if (scr::key_available(0))
+                return false;
+            if (scr::size_reports() != size_reports)
+                return true;
+            const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()),
+                                                        handles.data(), FALSE, 10);
+            if (result == WAIT_OBJECT_0)
+                return false;
+            if (result > WAIT_OBJECT_0 && result < WAIT_OBJECT_0 + handles.size()) {
+                sources.push_back(handles[result - WAIT_OBJECT_0]);
+                break;
+            }
+            if (timeout >= 0 && Clock::now() >= give_up)
+                return false;
+        }
+#endif
+
+        bool ran = false;
+        for (const EventLoop::Source source : sources) {
+            auto watch = std::find_if(watches.begin(), watches.end(),
+                                      [source](const Watch &w) { return w.source == source; });
+            if (watch != watches.end()) {
+                EventLoop::Callback callback = watch->callback;
+                callback();
+                ran = true;
+            }
+        }
+        return ran;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace EventLoop {
+
+    void post(Callback callback)
+    {
+        mailbox().post(std::move(callback));
+    }
+
+    unsigned add_timer(const long milliseconds, Callback callback, const bool repeat)
+    {
+        const Clock::duration interval = std::chrono::milliseconds(milliseconds);
+        if (++last_timer == 0)
+            ++last_timer;
+        timers.push_back(Timer{last_timer, Clock::now() + interval, interval, repeat,
+                               std::move(callback)});
+        return last_timer;
+    }
+
+    void cancel_timer(const unsigned id)
+    {
+        timers.erase(std::remove_if(timers.begin(), timers.end(),
+                                    [id](const Timer &timer) { return timer.id == id; }),
+                     timers.end());
+    }
+
+    void add_source(const Source source, Callback callback)
+    {
+        remove_source(source);
+        watches.push_back(Watch{source, std::move(callback)});
+    }
+
+    void remove_source(const Source source)
+    {
+        watches.erase(std::remove_if(watches.begin(), watches.end(),
+                                     [source](const Watch &watch) {
+                                         return watch.source == source;
+                                     }),
+                      watches.end());
+    }
+
+    void add_idle(std::function<bool()> task)
+    {
+        idlers.push_back(std::move(task));
+    }
+
+    void wait_for_key()
+    {
+        // A keystroke may have given the idle tasks more to do.
+        idle_finished = false;
+
+        for (;;) {
+            bool handled = run_posted();
+            handled = run_timers() || handled;
+            if (handled)
+                idle_finished = false;
+
+            if (scr::key_available(0))
+                return;
+
+            if (!idle_finished) {
+                if (run_idle())
+                    continue;
+                idle_finished = true;
+            }
+
+            if (sleep(time_to_next_timer()))
+                idle_finished = false;
+        }
+    }
+
+    void run_pending()
+    {
+        run_posted();
+        run_timers();
+        sleep(0);
+    }
+
+    void wait_for_event(const int milliseconds)
+    {
+        bool handled = run_posted();
+        handled = run_timers() || handled;
+        if (handled || scr::key_available(0))
+            return;
+
+        const int next_timer = time_to_next_timer();
+        sleep((next_timer >= 0 && next_timer < milliseconds) ? next_timer : milliseconds);
+        run_posted();
+        run_timers();
+    }
+
+} // namespace EventLoop
@@ -0,0 +1,283 @@
+/*! \file    ExternalFilter.cpp
+ *  \brief   Implementation of class ExternalFilter
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstddef>
+#include <utility>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <algorithm>
+#include <thread>
+#include <windows.h>
+#endif
+
+#include "ExternalFilter.hpp"
+
+namespace {
+
+    // The number of bytes read from the command's output at a time.
+    constexpr std::size_t read_size = 64 * 1024;
+
+#if eOPSYS == ePOSIX
+
+    //! Creates a pipe whose descriptors are not inherited across exec.
+    bool make_pipe(int (&ends)[2])
+    {
+        if (pipe(ends) == -1)
+            return false;
+        fcntl(ends[0], F_SETFD, FD_CLOEXEC);
+        fcntl(ends[1], F_SETFD, FD_CLOEXEC);
+        return true;
+    }
+
+    //! Closes a descriptor (if open) and marks it closed.
+    void close_end(int &fd)
+    {
+        if (fd != -1) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    //! Appends whatever can be read from fd to text. Closes fd at end of file or on error.
+    void drain(int &fd, std::string &text)
+    {
+        char buffer[read_size];
+        const ssize_t count = read(fd, buffer, sizeof(buffer));
+        if (count > 0)
+            text.append(buffer, static_cast<std::size_t>(count));
+        else if (count == 0 || errno != EINTR)
+            close_end(fd);
+    }
+
+#endif
+
+#if eOPSYS == eWINDOWS
+
+    //! Appends everything read from handle to text until end of file.
+    void read_all(HANDLE handle, std::string &text)
+    {
+        char buffer[read_size];
+        DWORD count;
+        while (ReadFile(handle, buffer, sizeof(buffer), &count, nullptr) && count > 0) {
+            text.append(buffer, count);
+        }
+    }
+
+#endif
+
+} // namespace
+
+//! Prepares to run the given command. Nothing is started until run is called.
+ExternalFilter::ExternalFilter(std::string command)
+    : command(std::move(command)), exit_status(-1)
+{
+}
+
+//! Runs the command, giving it input, and waits for it to finish.
+/*!
+ * Any output from a previous run is discarded. If the command exits without reading all of its
+ * input the rest of the input is silently dropped.
+ *
+ * \param input The text given to the command's standard input. The stream is closed after it.
+ * \return false if the command could not be started. Otherwise true, even if the command
+ * failed; check status() for the result.
+ */
+bool ExternalFilter::run(const std::string_view input)
+{
+    output_text.clear();
+    error_text.clear();
+    exit_status = -1;
+
+#if eOPSYS == ePOSIX
+    int to_child[2], from_child[2], errors_from_child[2];
+    if (!make_pipe(to_child))
+        return false;
+    if (!make_pipe(from_child)) {
+        close(to_child[0]);
+        close(to_child[1]);
+        return false;
+    }
+    if (!make_pipe(errors_from_child)) {
+        close(to_child[0]);
+        close(to_child[1]);
+        close(from_child[0]);
+        close(from_child[1]);
+        return false;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, to_child[0], 0);
+    posix_spawn_file_actions_adddup2(&actions, from_child[1], 1);
+    posix_spawn_file_actions_adddup2(&actions, errors_from_child[1], 2);
+
+    char shell[] = "/bin/sh";
+    char option[] = "-c";
+    char *const arguments[] = {shell, option, &command[0], nullptr};
+    pid_t child;
+    const int spawn_error = posix_spawn(&child, shell, &actions, nullptr, arguments, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(to_child[0]);
+    close(from_child[1]);
+    close(errors_from_child[1]);
+    int input_fd = to_child[1];
+    int output_fd = from_child[0];
+    int error_fd = errors_from_child[0];
+    if (spawn_error != 0) {
+        close_end(input_fd);
+        close_end(output_fd);
+        close_end(error_fd);
+        return false;
+    }
+
+    // A command that stops reading early must not kill the editor with SIGPIPE.
+    struct sigaction ignore, previous;
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    ignore.sa_flags = 0;
+    sigaction(SIGPIPE, &ignore, &previous);
+
+    fcntl(input_fd, F_SETFL, fcntl(input_fd, F_GETFL) | O_NONBLOCK);
+    std::size_t written = 0;
+    if (input.empty())
+        close_end(input_fd);
+
+    // Feed the input and collect both outputs as each stream becomes ready.
+    while (input_fd != -1 || output_fd != -1 || error_fd != -1) {
+        pollfd streams[3];
+        nfds_t count = 0;
+        if (input_fd != -1)
+            streams[count++] = pollfd{input_fd, POLLOUT, 0};
+        if (output_fd != -1)
+            streams[count++] = pollfd{output_fd, POLLIN, 0};
+        if (error_fd != -1)
+            streams[count++] = pollfd{error_fd, POLLIN, 0};
+        if (poll(streams, count, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (nfds_t i = 0; i < count; ++i) {
+            if (streams[i].revents == 0)
+                continue;
+            if (streams[i].fd == input_fd) {
+                const ssize_t sent =
+                    write(input_fd, input.data() + written, input.size() - written);
+                if (sent > 0)
+                    written += static_cast<std::size_t>(sent);
+                if ((sent == -1 && errno != EINTR && errno != EAGAIN) ||
+                    written == input.size())
+                    close_end(input_fd);
+            }
+            else if (streams[i].fd == output_fd)
+                drain(output_fd, output_text);
+            else
+                drain(error_fd, error_text);
+        }
+    }
+    close_end(input_fd);
+    close_end(output_fd);
+    close_end(error_fd);
+    sigaction(SIGPIPE, &previous, nullptr);
+
+    int child_status;
+    while (waitpid(child, &child_status, 0) == -1) {
+        if (errno != EINTR)
+            return true;
+    }
+    if (WIFEXITED(child_status))
+        exit_status = WEXITSTATUS(child_status);
+    return true;
+#endif
+
+#if eOPSYS == eWINDOWS
+    // Only the child's ends of the pipes are inherited.
+    SECURITY_ATTRIBUTES attributes = {sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HANDLE input_read, input_write, output_read, output_write, error_read, error_write;
+    if (!CreatePipe(&input_read, &input_write, &attributes, 0))
+        return false;
+    if (!CreatePipe(&output_read, &output_write, &attributes, 0)) {
+        CloseHandle(input_read);
+        CloseHandle(input_write);
+        return false;
+    }
+    if (!CreatePipe(&error_read, &error_write, &attributes, 0)) {
+        CloseHandle(input_read);
+        CloseHandle(input_write);
+        CloseHandle(output_read);
+        CloseHandle(output_write);
+        return false;
+    }
+    SetHandleInformation(input_write, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(output_read, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(error_read, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA startup = {};
+    startup.cb = sizeof(startup);
+    startup.dwFlags = STARTF_USESTDHANDLES;
+    startup.hStdInput = input_read;
+    startup.hStdOutput = output_write;
+    startup.hStdError = error_write;
+    PROCESS_INFORMATION process;
+    std::string command_line("cmd.exe /c ");
+    command_line.append(command);
+    const BOOL started =
+        CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, TRUE, CREATE_NO_WINDOW,
+                       nullptr, nullptr, &startup, &process);
+    CloseHandle(input_read);
+    CloseHandle(output_write);
+    CloseHandle(error_write);
+    if (!started) {
+        CloseHandle(input_write);
+        CloseHandle(output_read);
+        CloseHandle(error_read);
+        return false;
+    }
+    CloseHandle(process.hThread);
+
+    // Anonymous pipes can't be waited on together so the input and errors get threads.
+    std::thread writer([input_write, input]() {
+        std::size_t written = 0;
+        DWORD sent;
+        while (written < input.size() &&
+               WriteFile(input_write, input.data() + written,
+                         static_cast<DWORD>(std::min<std::size_t>(input.size() - written,
+                                                                  read_size)),
+                         &sent, nullptr)) {
+            written += sent;
+        }
+        CloseHandle(input_write);
+    });
+    std::thread error_reader([this, error_read]() { read_all(error_read, error_text); });
+    read_all(output_read, output_text);
+    writer.join();
+    error_reader.join();
+    CloseHandle(output_read);
+    CloseHandle(error_read);
+
+    DWORD child_status;
+    WaitForSingleObject(process.hProcess, INFINITE);
+    if (GetExitCodeProcess(process.hProcess, &child_status))
+        exit_status = static_cast<int>(child_status);
+    CloseHandle(process.hProcess);
+    return true;
+#endif
+}
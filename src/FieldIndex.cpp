@@ -0,0 +1,199 @@
+/*! \file    FieldIndex.cpp
+ *  \brief   Implementation of class FieldIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+
+#include "EditBuffer.hpp"
+#include "FieldIndex.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define FIELDINDEX_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    //! Calls separate with the offset of each delimiter outside quotes, until it returns false.
+    /*!
+     * With SSE2 the delimiters and quotes among 16 characters are found at once, and only those
+     * characters are examined further.
+     */
+    template <typename Function>
+    void for_each_delimiter(const std::string_view text, const char delimiter,
+                            const Function &separate)
+    {
+        const std::size_t size = text.size();
+        bool quoted = false;
+        std::size_t offset = 0;
+#if defined(FIELDINDEX_SSE2)
+        const __m128i delimiters = _mm_set1_epi8(delimiter);
+        const __m128i quotes = _mm_set1_epi8('"');
+        for (; size - offset >= 16; offset += 16) {
+            const __m128i block =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + offset));
+            const __m128i found =
+                _mm_or_si128(_mm_cmpeq_epi8(block, delimiters), _mm_cmpeq_epi8(block, quotes));
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+            while (mask != 0) {
+#if defined(__GNUC__)
+                const unsigned bit = static_cast<unsigned>(__builtin_ctz(mask));
+#else
+                unsigned bit = 0;
+                while ((mask & (1U << bit)) == 0)
+                    ++bit;
+#endif
+                if (text[offset + bit] == '"')
+                    quoted = !quoted;
+                else if (!quoted && !separate(offset + bit))
+                    return;
+                mask &= mask - 1;
+            }
+        }
+#endif
+        for (; offset < size; ++offset) {
+            if (text[offset] == '"')
+                quoted = !quoted;
+            else if (text[offset] == delimiter && !quoted && !separate(offset))
+                return;
+        }
+    }
+
+} // namespace
+
+//! Finds the offsets where the fields of the text start.
+/*!
+ * \param text The line.
+ * \param delimiter The character that separates the fields.
+ * \param starts [out] The offset of each field, the first being zero.
+ */
+void FieldIndex::split(const std::string_view text, const char delimiter,
+                       std::vector<std::size_t> &starts)
+{
+    starts.assign(1, 0);
+    for_each_delimiter(text, delimiter, [&starts](const std::size_t offset) {
+        starts.push_back(offset + 1);
+        return true;
+    });
+}
+
+//! Returns the text of a field, counting from zero. It is empty if there is no such field.
+std::string_view FieldIndex::field(const std::string_view text, const char delimiter,
+                                   const std::size_t number)
+{
+    std::size_t count = 0;
+    std::size_t start = (number == 0) ? 0 : std::string_view::npos;
+    std::size_t end = text.size();
+    for_each_delimiter(text, delimiter, [&](const std::size_t offset) {
+        ++count;
+        if (count == number)
+            start = offset + 1;
+        else if (count == number + 1) {
+            end = offset;
+            return false;
+        }
+        return true;
+    });
+    if (start == std::string_view::npos)
+        return std::string_view();
+    return text.substr(start, end - start);
+}
+
+//! Returns the fields of a line, scanning it if that hasn't been done since it was modified.
+const FieldIndex::Line &FieldIndex::scan(const long line, const EditBuffer &text,
+                                         const unsigned tab)
+{
+    const auto known = lines.find(line);
+    if (known != lines.end())
+        return known->second;
+    if (lines.size() >= maximum_lines)
+        lines.clear();
+
+    Line &fields = lines[line];
+    split(text.view(), separator, fields.starts);
+    const std::size_t count = fields.starts.size();
+    fields.widths.resize(count);
+    if (widest.size() < count)
+        widest.resize(count, 0U);
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t end = (i + 1 < count) ? fields.starts[i + 1] - 1 : text.length();
+        fields.widths[i] = static_cast<unsigned>(text.column_of(end, tab) -
+                                                 text.column_of(fields.starts[i], tab));
+        if (fields.widths[i] > widest[i]) {
+            widest[i] = fields.widths[i];
+            widened = true;
+        }
+    }
+    return fields;
+}
+
+//! Returns the offsets where the fields of a line start, the first being zero.
+const std::vector<std::size_t> &FieldIndex::starts(const long line, const EditBuffer &text,
+                                                   const unsigned tab)
+{
+    return scan(line, text, tab).starts;
+}
+
+//! Scans a line about to be shown. Returns true if a field has widened since the last call.
+/*!
+ * The lines already shown must then be shown again, since their fields are no longer aligned.
+ * A field may have widened when any line was scanned, not only this one.
+ */
+bool FieldIndex::prepare(const long line, const EditBuffer &text, const unsigned tab)
+{
+    scan(line, text, tab);
+    const bool result = widened;
+    widened = false;
+    return result;
+}
+
+//! Puts the text of a line, with its fields aligned, into row.
+void FieldIndex::render(const long line, const EditBuffer &text, const unsigned tab,
+                        std::string &row)
+{
+    const Line &fields = scan(line, text, tab);
+    const std::string_view view = text.view();
+    const std::size_t count = fields.starts.size();
+    row.clear();
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t end = (i + 1 < count) ? fields.starts[i + 1] - 1 : view.size();
+        row.append(view.substr(fields.starts[i], end - fields.starts[i]));
+        if (i + 1 == count)
+            break;
+        row.append(widest[i] - fields.widths[i], ' ');
+        row.push_back(separator == '\t' ? ' ' : separator);
+        row.push_back(' ');
+    }
+}
+
+//! Returns the column where the given column of a line is shown when the fields are aligned.
+unsigned FieldIndex::shown_column(const long line, const EditBuffer &text,
+                                  const unsigned column, const unsigned tab)
+{
+    const Line &fields = scan(line, text, tab);
+    const std::size_t offset = text.offset_of(column, tab);
+    const std::size_t field = static_cast<std::size_t>(
+        std::upper_bound(fields.starts.begin(), fields.starts.end(), offset) -
+        fields.starts.begin() - 1);
+
+    unsigned shown = 0;
+    for (std::size_t i = 0; i < field; ++i)
+        shown += widest[i] + 2;
+    const unsigned start = static_cast<unsigned>(text.column_of(fields.starts[field], tab));
+    return shown + (column - start);
+}
+
+//! Forgets the fields of the lines modified (see EditFile::take_modifications).
+/*!
+ * The lines after those modified are forgotten too if they have moved.
+ */
+void FieldIndex::invalidate(const EditDelta &change)
+{
+    if (change.empty())
+        return;
+    const auto first = lines.lower_bound(change.first);
+    const auto last = (change.moved() == 0) ? lines.lower_bound(change.first + change.old_count)
+                                            : lines.end();
+    lines.erase(first, last);
+}
@@ -3,15 +3,36 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "Completion.hpp"
+#include "DiffView.hpp"
+#include "DiskEditFile.hpp"
 #include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "EventLoop.hpp"
 #include "FileList.hpp"
 #include "FileNameMatcher.hpp"
+#include "FileWatcher.hpp"
+#include "HexImage.hpp"
+#include "LanguageServer.hpp"
+#include "Plugins.hpp"
+#include "Recovery.hpp"
+#include "UndoLog.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
-#include "mylist.hpp"
 #include "special.hpp"
 #include "support.hpp"
 #include "yfile.hpp"
@@ -23,23 +44,194 @@
 //! List of YEditFile objects forming the file list.
 /*!
  * This list is implemented as a list of pointers since the actual types of objects on the list
- * are from various classes derived from YEditFile. This class introduces a destructor so that
- * the YEditFile objects are properly deleted when this list is destroyed (and not *just* the
- * pointers to those objects). As a result, the pointers on this list must point at dynamically
- * allocated YEditFile objects.
+ * are from various classes derived from YEditFile. The destructor deletes the YEditFile objects
+ * (and not *just* the pointers to those objects). As a result, the pointers on this list must
+ * point at dynamically allocated YEditFile objects.
+ *
+ * The list has a current point like List, but is kept in a vector so that any position can be
+ * reached at once. The files are also indexed by the name_key of their names and ordered by
+ * when they were last active, so that a file can be found by name or by recent use without
+ * visiting the others. Where two files have the same key, the earlier one on the list is
+ * found. Pointers into the list are invalidated by insert and erase.
  */
-class YFileList : public List<YEditFile *> {
+class YFileList {
   public:
+    //! Special index used to represent the next new slot.
+    static const long off_end = -1L;
+
+    YFileList() = default;
+    YFileList(const YFileList &) = delete;
+    YFileList &operator=(const YFileList &) = delete;
     ~YFileList();
+
+    void jump_to(long new_index);
+    YEditFile **next();
+    YEditFile **previous();
+    YEditFile **insert(YEditFile *new_file);
+    void erase();
+
+    //! Returns a pointer to the file at the current point or nullptr if off the end.
+    YEditFile **get() { return position < files.size() ? &files[position] : nullptr; }
+
+    //! Returns the index of the current point.
+    long current_index() const { return static_cast<long>(position); }
+
+    //! Returns the number of files in the list.
+    long size() const { return static_cast<long>(files.size()); }
+
+    //! Returns the index of the file with the given name or off_end if there is none.
+    long find(const char *name) const;
+
+    //! Returns the index of the given file or off_end if it isn't on the list.
+    long find(const YEditFile *file) const;
+
+    //! Notes that the file at the current point is the active one.
+    void note_active();
+
+    //! Returns the file that was active before the current one or nullptr if there is none.
+    YEditFile *recent() const;
+
+    //! Remembers the current point and restores it when destroyed (see List::Mark).
+    class Mark {
+      public:
+        explicit Mark(YFileList &L) : old_index(L.current_index()), the_list(L) {}
+        Mark(const Mark &) = delete;
+        Mark &operator=(const Mark &) = delete;
+        ~Mark() { the_list.jump_to(old_index); }
+
+      protected:
+        long old_index;
+        YFileList &the_list;
+    };
+
+    //! Visits the files in order, restoring the current point afterward (see List::Iterator).
+    class Iterator : private Mark {
+      public:
+        explicit Iterator(YFileList &L) : Mark(L) { Mark::the_list.jump_to(0); }
+        YEditFile **operator()() { return Mark::the_list.next(); }
+    };
+
+  private:
+    //! What is known about each file on the list, apart from its place in the vector.
+    struct Entry {
+        std::size_t index;                    //!< Position in files.
+        std::list<YEditFile *>::iterator use; //!< Place in the order of recent use.
+    };
+
+    std::vector<YEditFile *> files;                      //!< The files in order.
+    std::vector<std::string> keys;                       //!< The name key of each file.
+    std::size_t position = 0;                            //!< The current point.
+    std::unordered_map<const YEditFile *, Entry> entries; //!< Every file on the list.
+    std::unordered_map<std::string, YEditFile *> names;   //!< The first file with each key.
+    std::list<YEditFile *> used;                          //!< Most recently active first.
+
+    void renumber(std::size_t from);
 };
 
 YFileList::~YFileList()
 {
-    YEditFile **File;
+    for (YEditFile *const file : files)
+        delete file;
+}
+
+//! Moves the current point; an index that is out of bounds moves it off the end.
+void YFileList::jump_to(const long new_index)
+{
+    if (new_index < 0L || new_index >= size())
+        position = files.size();
+    else
+        position = static_cast<std::size_t>(new_index);
+}
 
-    jump_to(0);
-    while ((File = next()) != nullptr)
-        delete *File;
+//! Like *p++.
+YEditFile **YFileList::next()
+{
+    if (position == files.size())
+        return nullptr;
+    return &files[position++];
+}
+
+//! Like *--p. Returns nullptr (without moving) at the start of the list.
+YEditFile **YFileList::previous()
+{
+    if (position == 0)
+        return nullptr;
+    return &files[--position];
+}
+
+//! Inserts a file before the current point, which continues to refer to the same place.
+YEditFile **YFileList::insert(YEditFile *const new_file)
+{
+    const std::size_t at = position;
+    files.insert(files.begin() + at, new_file);
+    keys.insert(keys.begin() + at, name_key(new_file->name()));
+    entries[new_file] = Entry{at, used.insert(used.end(), new_file)};
+    renumber(at + 1);
+
+    const auto named = names.emplace(keys[at], new_file);
+    if (!named.second && entries[named.first->second].index > at)
+        named.first->second = new_file;
+    ++position;
+    return &files[at];
+}
+
+//! Erases the file at the current point (without deleting it) and advances the current point.
+void YFileList::erase()
+{
+    if (position == files.size())
+        return;
+    YEditFile *const old_file = files[position];
+    const std::string key = keys[position];
+    files.erase(files.begin() + position);
+    keys.erase(keys.begin() + position);
+    const auto entry = entries.find(old_file);
+    used.erase(entry->second.use);
+    entries.erase(entry);
+    renumber(position);
+
+    // If the file was the one found by its key, a later file with the same key takes over.
+    const auto named = names.find(key);
+    if (named->second == old_file) {
+        names.erase(named);
+        for (std::size_t i = position; i < keys.size(); ++i) {
+            if (keys[i] == key) {
+                names[key] = files[i];
+                break;
+            }
+        }
+    }
+}
+
+long YFileList::find(const char *const name) const
+{
+    const auto named = names.find(name_key(name));
+    return named == names.end() ? off_end : find(named->second);
+}
+
+long YFileList::find(const YEditFile *const file) const
+{
+    const auto entry = entries.find(file);
+    return entry == entries.end() ? off_end : static_cast<long>(entry->second.index);
+}
+
+void YFileList::note_active()
+{
+    if (position < files.size())
+        used.splice(used.begin(), used, entries[files[position]].use);
+}
+
+YEditFile *YFileList::recent() const
+{
+    if (used.size() < 2)
+        return nullptr;
+    return *std::next(used.begin());
+}
+
+//! Updates the recorded positions of the files from the given index on.
+void YFileList::renumber(const std::size_t from)
+{
+    for (std::size_t i = from; i < files.size(); ++i)
+        entries[files[i]].index = i;
 }
 
 /*=========================================*/
@@ -47,9 +239,18 @@ YFileList::~YFileList()
 /*=========================================*/
 
 static EditBuffer mark_name;    //!< The name of the file with the mark.
-static FilePosition mark_point; //!< The position of the mark in the file.
+static FilePosition mark_point; //!< The position of the mark in the file when it was set.
+static YEditFile *mark_file = nullptr;            //!< The file with the mark while it's loaded.
+static MarkSet::Mark mark_anchor = MarkSet::none; //!< The mark in that file.
 static YFileList the_list;      //!< This is the file list itself.
 
+// The number of milliseconds between autosaves of the recovery data.
+static const long autosave_interval = 30L * 1000L;
+
+// The most memory the text of the files may take (zero for no limit). See set_memory_budget.
+static std::size_t memory_budget = 0;
+static unsigned long use_clock = 0; // Counts the checks of the budget.
+
 // static OTHER_YEditFile scratch_file( "scratch.yfy" );
 //
 // This file is held and managed outside of the file list. FileList::active_file() returns a
@@ -58,7 +259,7 @@ static YFileList the_list;      //!< This is the file list itself.
 // "scratch.yfy" exists, it will be loaded! However unless the user explicitly saves
 // scratch.yfy, it will never be saved.
 
-enum FileType { ADA, ASM, C, DOC, PCD, SCALA, OTHER };
+enum FileType { ADA, ASM, C, CSV, DOC, PCD, SCALA, TSV, HEX, OTHER };
 
 struct InitialAttributes {
     const char *extension;
@@ -92,6 +293,10 @@ static InitialAttributes default_attributes[] = {
     {".CXX", C},
     {".HXX", C},
 
+    // Tables.
+    {".CSV", CSV},
+    {".TSV", TSV},
+
     // D (for now just use the C support)
     {".D", C},
 
@@ -109,6 +314,169 @@ static InitialAttributes default_attributes[] = {
     // Anything else. This entry has to be at the end of the list.
     {"", OTHER}};
 
+/*======================================*/
+/*           Private Functions          */
+/*======================================*/
+
+//! Brings the position of the bookmark up to date and removes its mark from its file.
+static void release_bookmark()
+{
+    if (mark_file == nullptr)
+        return;
+    Caret position;
+    if (mark_file->mark_position(mark_anchor, position)) {
+        mark_point.jump_to_line(position.line);
+        mark_point.jump_to_column(position.column);
+        mark_file->remove_mark(mark_anchor);
+    }
+    mark_file = nullptr;
+    mark_anchor = MarkSet::none;
+}
+
+//! Returns true if the given file object is still in the file list.
+static bool is_loaded(const YEditFile *const target)
+{
+    YEditFile **file;
+    YFileList::Iterator stepper(the_list);
+
+    while ((file = stepper()) != nullptr)
+        if (*file == target)
+            return true;
+
+    return false;
+}
+
+//! Returns true if the disk version of the file is more recent than the file's data.
+/*!
+ * Only files the FileWatcher reports as stale are examined.
+ *
+ * \param unchanged_only If true, files with unsaved changes are left alone (and stay stale).
+ */
+static bool disk_is_newer(YEditFile &file, const bool unchanged_only)
+{
+    if (!FileWatcher::stale(file.name()) || (unchanged_only && file.changed()))
+        return false;
+    FileWatcher::checked(file.name());
+
+    // Read date and time stamp for disk versions of files.
+    FileNameMatcher stamper;
+    stamper.set_name(file.name());
+    return stamper.next() != nullptr && stamper.modify_time() > file.time();
+}
+
+/*!
+ * Called when the FileWatcher reports changes. Files without unsaved changes are reloaded at
+ * once (large ones in the background); the others are reloaded by the next explicit
+ * reload_files(). Text appended to files being followed is read.
+ */
+static void reload_changed_files()
+{
+    if (DiskEditFile::background_loads() != 0)
+        return;
+
+    // The iterator moves the list's current position so the files are reloaded afterward.
+    std::vector<YEditFile *> newer;
+    std::vector<YEditFile *> grown;
+    {
+        YEditFile **file;
+        YFileList::Iterator stepper(the_list);
+        while ((file = stepper()) != nullptr) {
+            YEditFile &candidate = **file;
+            if (!candidate.is_following()) {
+                if (disk_is_newer(candidate, true))
+                    newer.push_back(&candidate);
+            }
+            else if (FileWatcher::stale(candidate.name())) {
+                // Followed files are read whether or not they have unsaved changes.
+                FileWatcher::checked(candidate.name());
+                grown.push_back(&candidate);
+            }
+        }
+    }
+    for (YEditFile *const file : newer) {
+        file->reload_in_background(file->name(), [file]() {
+            if (WindowList::shows(file))
+                WindowList::display();
+        });
+    }
+    for (YEditFile *const file : grown) {
+        if (file->read_appended(file->name()) && WindowList::shows(file))
+            WindowList::display();
+    }
+}
+
+/*!
+ * Brings the recovery data of every file up to date (see DiskEditFile::checkpoint). Nothing is
+ * done while files are being read in the background since their lines aren't available yet.
+ *
+ * \param autosave If true, large journals are also replaced by snapshots.
+ */
+static void checkpoint_files(const bool autosave)
+{
+    if (DiskEditFile::background_loads() != 0)
+        return;
+
+    YEditFile **file;
+    YFileList::Iterator stepper(the_list);
+    while ((file = stepper()) != nullptr) {
+        if (autosave)
+            (*file)->autosave((*file)->name());
+        else
+            (*file)->checkpoint((*file)->name());
+    }
+}
+
+/*!
+ * Notes which files are in use and, if the files take more memory than the budget allows,
+ * evicts the unchanged ones used least recently until they fit. Files shown in a window are
+ * in use.
+ */
+static void enforce_budget()
+{
+    std::vector<YEditFile *> candidates;
+    {
+        ++use_clock;
+        YEditFile **file;
+        YFileList::Iterator stepper(the_list);
+        while ((file = stepper()) != nullptr) {
+            if (WindowList::shows(*file))
+                (*file)->note_use(use_clock);
+            else if (!(*file)->changed())
+                candidates.push_back(*file);
+        }
+    }
+    if (memory_budget == 0 || DiskEditFile::background_loads() != 0)
+        return;
+
+    std::sort(candidates.begin(), candidates.end(),
+              [](YEditFile *const left, YEditFile *const right) {
+                  return left->last_use() < right->last_use();
+              });
+    bool evicted = false;
+    for (YEditFile *const file : candidates) {
+        if (EditBuffer::memory_in_use() <= memory_budget)
+            break;
+        evicted = file->evict(file->name()) || evicted;
+    }
+
+#if defined(__GLIBC__)
+    // The allocator keeps what is released for reuse unless asked to give it back.
+    if (evicted)
+        malloc_trim(0);
+#endif
+    (void)evicted;
+}
+
+//! Arranges for the recovery data to be kept up to date while the editor waits for keys.
+static void start_recovery()
+{
+    EventLoop::add_idle([]() {
+        checkpoint_files(false);
+        return false;
+    });
+    EventLoop::add_timer(autosave_interval, []() { checkpoint_files(true); }, true);
+}
+
 /*======================================*/
 /*           Public Functions           */
 /*======================================*/
@@ -117,6 +485,18 @@ namespace FileList {
 
     bool new_file(const char *name)
     {
+        static const bool handler_set =
+            (FileWatcher::set_change_handler(reload_changed_files), true);
+        static const bool recovery_started = (start_recovery(), true);
+        static const bool budget_enforced = (EventLoop::add_idle([]() {
+                                                 enforce_budget();
+                                                 return false;
+                                             }),
+                                             true);
+        (void)handler_set;
+        (void)recovery_started;
+        (void)budget_enforced;
+
         char raw_extension[256];
         // Allow for extensions that are longer than three characters.
 
@@ -140,6 +520,9 @@ namespace FileList {
         }
 
         FileType this_type = default_attributes[i].type;
+        // Files viewed as bytes are of their own type, whatever their extension.
+        if (HexImage::is_hex(name))
+            this_type = HEX;
         bool return_value = false;
 
         // Create the appropriate type of YEditFile. Note that this is the only place this type
@@ -156,6 +539,9 @@ namespace FileList {
         case C:
             new_thing = new C_YEditFile(name);
             break;
+        case CSV:
+            new_thing = new CSV_YEditFile(name, ',');
+            break;
         case DOC:
             new_thing = new DOC_YEditFile(name);
             break;
@@ -165,6 +551,12 @@ namespace FileList {
         case SCALA:
             new_thing = new SCALA_YEditFile(name);
             break;
+        case TSV:
+            new_thing = new CSV_YEditFile(name, '\t');
+            break;
+        case HEX:
+            new_thing = new HEX_YEditFile(name);
+            break;
         case OTHER:
             new_thing = new OTHER_YEditFile(name);
             break;
@@ -187,30 +579,37 @@ namespace FileList {
                 // It did work. Make the new file the currently active one.
                 return_value = true;
                 the_list.previous();
+                the_list.note_active();
 
                 // See if this file has been in the editor before and if so set up its
                 // attributes to agree with the descriptor.
                 //
                 active_file().set_attributes();
+                FileWatcher::watch(name);
+                note_session_change();
             }
         }
         return return_value;
     }
 
-    bool lookup(const char *the_name)
+    YEditFile *file(unsigned index)
     {
-        YEditFile **file;
-        long current_index = the_list.current_index();
+        YFileList::Mark position(the_list);
 
-        the_list.jump_to(0);
-        while ((file = the_list.next()) != nullptr)
-            if (my_stricmp((*file)->name(), the_name) == 0) {
-                the_list.previous();
-                return true;
-            }
+        the_list.jump_to(index);
+        YEditFile **result = the_list.get();
+        return result == nullptr ? nullptr : *result;
+    }
 
-        the_list.jump_to(current_index);
-        return false;
+    bool lookup(const char *the_name)
+    {
+        const long index = the_list.find(the_name);
+        if (index == YFileList::off_end)
+            return false;
+
+        the_list.jump_to(index);
+        the_list.note_active();
+        return true;
     }
 
     void next()
@@ -219,6 +618,7 @@ namespace FileList {
         the_list.next();
         if (the_list.get() == nullptr)
             the_list.jump_to(0);
+        the_list.note_active();
     }
 
     void previous()
@@ -228,6 +628,23 @@ namespace FileList {
             the_list.jump_to(YFileList::off_end);
             the_list.previous();
         }
+        the_list.note_active();
+    }
+
+    bool recent()
+    {
+        YEditFile *const file = the_list.recent();
+        if (file == nullptr)
+            return false;
+
+        the_list.jump_to(the_list.find(file));
+        the_list.note_active();
+        return true;
+    }
+
+    bool contains(const YEditFile *const file)
+    {
+        return the_list.find(file) != YFileList::off_end;
     }
 
     YEditFile &active_file()
@@ -278,18 +695,23 @@ namespace FileList {
             // Adjust bottom if entire file is blocked.
             bottom = (old_state == true) ? bottom : bottom - 1;
 
-            // Copy the text of the original file into the new file.
+            // Copy the text of the original file into a list of its own and then into the new
+            // file at once, so the new file is modified only once.
+            EditList copies;
             for (long line_number = top; return_value == true && line_number <= bottom;
                  line_number++) {
-                if (new_entry->insert_line(old_entry.get_line()) == false) {
-                    error_message("Unable to completely build new file object");
+                const EditBuffer *const line = old_entry.get_line();
+                if (line == nullptr)
                     return_value = false;
-                }
                 else {
-                    new_entry->CP().cursor_down();
+                    copies.insert(new EditBuffer(*line));
                     old_entry.CP().jump_to_line(line_number + 1);
                 }
             }
+            if (return_value == true)
+                return_value = new_entry->insert_block(copies);
+            if (return_value == false)
+                error_message("Unable to completely build new file object");
             old_entry.CP() = old_CP;
 
             // If the old file had block mode on, delete the block.
@@ -322,12 +744,22 @@ namespace FileList {
             delete new_descriptor;
 
             // Trash the file object and the list node.
+            if (*file == mark_file)
+                release_bookmark();
+            FileWatcher::forget((*file)->name());
+            WindowList::forget(*file);
+            LanguageServer::forget(**file);
+            Completion::forget(**file);
+            Plugins::forget(**file);
+            DiffView::forget(*file);
             delete *file;
             the_list.erase();
 
             // Wrap back to the beginning if necessary.
             if (the_list.get() == NULL)
                 the_list.jump_to(0);
+            the_list.note_active();
+            note_session_change();
         }
     }
 
@@ -338,26 +770,22 @@ namespace FileList {
 
     bool save_changes()
     {
-        bool return_value = true;
+        std::vector<DiskEditFile::SaveRequest> requests;
         YEditFile **file;
         YFileList::Iterator stepper(the_list);
 
-        // Look for files which have changed and save those files.
+        // Look for files which have changed and save those files together.
         while ((file = stepper()) != nullptr) {
-
-            if ((*file)->changed()) {
-                // Try saving the file. Update records if save worked.
-                bool save_worked = (*file)->save((*file)->name());
-                if (!save_worked)
-                    return_value = false;
-                else {
-                    (*file)->set_timestamp((*file)->name());
-                    (*file)->mark_as_unchanged();
-                }
-            }
+            if ((*file)->changed())
+                requests.push_back(DiskEditFile::SaveRequest{*file, (*file)->name()});
         }
 
-        return return_value;
+        return DiskEditFile::save_all(requests);
+    }
+
+    void set_memory_budget(const std::size_t bytes)
+    {
+        memory_budget = bytes;
     }
 
     bool reload_files()
@@ -366,38 +794,39 @@ namespace FileList {
         YFileList::Iterator stepper(the_list);
 
         while ((file = stepper()) != nullptr) {
+            if (disk_is_newer(**file, false))
+                (*file)->reload((*file)->name());
+        }
 
-            // Read date and time stamp for disk versions of files.
-            FileNameMatcher stamper;
-            char *name_string;
-
-            stamper.set_name((*file)->name());
-            if ((name_string = stamper.next()) != nullptr) {
-
-                // Check to see if disk version is more recent. If so, reload.
-                if (stamper.modify_time() > (*file)->time()) {
-
-                    // Remember current point in file.
-                    FilePosition point = (*file)->CP();
-
-                    // Erase the file's data.
-                    (*file)->top_of_file();
-                    (*file)->set_block_state(true);
-                    (*file)->bottom_of_file();
-                    (*file)->delete_block();
-                    (*file)->set_block_state(false);
-                    (*file)->top_of_file();
+        return true;
+    }
 
-                    // Get the new stuff.
-                    (*file)->load(name_string);
-                    (*file)->set_timestamp(name_string);
-                    (*file)->CP() = point;
-                    (*file)->mark_as_unchanged();
-                }
-            }
+    void recover_files()
+    {
+        std::vector<Recovery::Recovered> found = Recovery::recover();
+        if (found.empty())
+            return;
+        const std::string active_name = (count() > 0) ? active_file().name() : "";
+
+        for (Recovery::Recovered &recovered : found) {
+            const char *const name = recovered.name.c_str();
+            if (!lookup(name) && !new_file(name))
+                continue;
+            YEditFile &file = active_file();
+            UndoLog::next_command();
+            const bool restored = file.restore(*recovered.lines);
+            UndoLog::next_command();
+            if (!restored)
+                continue;
+
+            // The changes are kept again before the old copy of them is discarded.
+            file.checkpoint(file.name());
+            Recovery::remove(recovered);
+            warning_message("Recovered unsaved changes to %s", name);
         }
 
-        return true;
+        if (!active_name.empty())
+            lookup(active_name.c_str());
     }
 
     bool no_changes()
@@ -418,8 +847,11 @@ namespace FileList {
 
     void set_bookmark()
     {
+        release_bookmark();
         mark_name = active_file().name();
         mark_point = active_file().CP();
+        mark_file = &active_file();
+        mark_anchor = mark_file->add_mark(mark_point.cursor_line(), mark_point.cursor_column());
     }
 
     void toggle_bookmark()
@@ -431,6 +863,8 @@ namespace FileList {
             // Get info on current position.
             EditBuffer temp_name = active_file().name();
             FilePosition temp_point = active_file().CP();
+            YEditFile *const temp_file = &active_file();
+            release_bookmark();
 
             // Change to saved current point. First see if the file is still loaded.
             if (lookup(mark_name.to_string().c_str()) == true) {
@@ -453,6 +887,11 @@ namespace FileList {
             //
             mark_name = temp_name;
             mark_point = temp_point;
+            if (is_loaded(temp_file)) {
+                mark_file = temp_file;
+                mark_anchor =
+                    temp_file->add_mark(temp_point.cursor_line(), temp_point.cursor_column());
+            }
         }
     }
 
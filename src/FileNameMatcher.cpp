@@ -10,14 +10,21 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <screen/environ.hpp>
 
 #if eOPSYS == ePOSIX
+#include <dirent.h>
+#include <fnmatch.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #endif
 
 #include "FileNameMatcher.hpp"
+#include "TaskPool.hpp"
 
 // The Unix version is very different than the other versions.
 #if eOPSYS == ePOSIX
@@ -48,7 +55,7 @@ FileNameMatcher::FileNameMatcher()
 FileNameMatcher::~FileNameMatcher()
 {
     // If we were in the middle of a scan but didn't finish, then clean up.
-    if (!done)
+    if (!done && !first_match)
         globfree(&glob_data);
 }
 
@@ -95,7 +102,7 @@ char *FileNameMatcher::next()
             }
 
             // If the file's not a regular file, it's "not there."
-            if (!S_ISREG(file_info.st_dev)) {
+            if (!S_ISREG(file_info.st_mode)) {
                 done = true;
                 return 0;
             }
@@ -118,17 +125,213 @@ char *FileNameMatcher::next()
         char *end = strchr(buffer, '\0');
         end--;
         if (*end != '/')
-            break;
+            return return_value;
     }
 
     // If we ran out of globbed data, then we are done.
-    if (match_index >= static_cast<int>(glob_data.gl_pathc)) {
-        done = true;
-        return_value = 0;
-        globfree(&glob_data);
+    done = true;
+    globfree(&glob_data);
+    return 0;
+}
+
+namespace {
+
+    //! A name matching part of a wildcard spec, and what kind of thing it names.
+    struct Candidate {
+        enum Kind { UNKNOWN, DIRECTORY, REGULAR, OTHER };
+
+        std::string path;
+        Kind kind;
+    };
+
+    const std::size_t STAT_SHARE = 64; // The fewest names worth stat()ing on a worker.
+
+    //! Returns the kind of a directory entry from its type, or UNKNOWN if it must be stat()ed.
+    /*!
+     * \param follow True if symbolic links are to be followed. Otherwise they are OTHER.
+     */
+    Candidate::Kind kind_of(const struct dirent *entry, const bool follow)
+    {
+#if defined(DT_DIR)
+        switch (entry->d_type) {
+        case DT_DIR:
+            return Candidate::DIRECTORY;
+        case DT_REG:
+            return Candidate::REGULAR;
+        case DT_LNK:
+            return follow ? Candidate::UNKNOWN : Candidate::OTHER;
+        case DT_UNKNOWN:
+            return Candidate::UNKNOWN;
+        default:
+            return Candidate::OTHER;
+        }
+#else
+        return Candidate::UNKNOWN;
+#endif
     }
 
-    return return_value;
+    //! Finds the kinds of the candidates whose directory entries didn't say.
+    /*!
+     * Only in directories on file systems that don't fill in the entries' types, or for
+     * symbolic links, does this do anything. Many names are stat()ed on the workers at once,
+     * since each stat() may wait on a network.
+     */
+    void resolve(std::vector<Candidate> &candidates, const bool follow)
+    {
+        std::vector<std::size_t> unknown;
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (candidates[i].kind == Candidate::UNKNOWN)
+                unknown.push_back(i);
+        }
+
+        auto work = [&](const std::size_t first, const std::size_t last) {
+            for (std::size_t i = first; i < last; ++i) {
+                Candidate &candidate = candidates[unknown[i]];
+                struct stat file_info;
+                const int result = follow ? stat(candidate.path.c_str(), &file_info)
+                                          : lstat(candidate.path.c_str(), &file_info);
+                if (result != 0)
+                    candidate.kind = Candidate::OTHER;
+                else if (S_ISDIR(file_info.st_mode))
+                    candidate.kind = Candidate::DIRECTORY;
+                else if (S_ISREG(file_info.st_mode))
+                    candidate.kind = Candidate::REGULAR;
+                else
+                    candidate.kind = Candidate::OTHER;
+            }
+        };
+
+        const std::size_t count = unknown.size();
+        if (count < 2 * STAT_SHARE) {
+            work(0, count);
+            return;
+        }
+        TaskPool::Group stats;
+        for (std::size_t first = 0; first < count; first += STAT_SHARE) {
+            const std::size_t last = std::min(first + STAT_SHARE, count);
+            stats.run([&work, first, last] { work(first, last); });
+        }
+        stats.wait();
+    }
+
+    //! Adds the entries of a directory matching the pattern to found.
+    /*!
+     * \param directory The directory's path ending with '/', or empty for the current
+     * directory. It starts the path of each entry found.
+     */
+    void read_directory(const std::string &directory, const char *pattern, const bool follow,
+                        std::vector<Candidate> &found)
+    {
+        DIR *listing = opendir(directory.empty() ? "." : directory.c_str());
+        if (listing == nullptr)
+            return;
+
+        // The C library reads many entries with each system call (getdents on Linux).
+        while (struct dirent *entry = readdir(listing)) {
+            if (fnmatch(pattern, entry->d_name, FNM_PERIOD) == 0)
+                found.push_back(Candidate{directory + entry->d_name, kind_of(entry, follow)});
+        }
+        closedir(listing);
+    }
+
+    //! Returns the directories, and all the directories beneath them, for the segment "**".
+    /*!
+     * Hidden directories and symbolic links are left out so that cycles can't occur.
+     */
+    std::vector<std::string> read_trees(const std::vector<std::string> &directories)
+    {
+        std::vector<std::string> all;
+        std::vector<std::string> level = directories;
+        while (!level.empty()) {
+            std::vector<Candidate> found;
+            for (const std::string &directory : level)
+                read_directory(directory, "*", false, found);
+            resolve(found, false);
+
+            all.insert(all.end(), level.begin(), level.end());
+            level.clear();
+            for (const Candidate &candidate : found) {
+                if (candidate.kind == Candidate::DIRECTORY)
+                    level.push_back(candidate.path + '/');
+            }
+        }
+        return all;
+    }
+
+} // namespace
+
+/*!
+ * The spec is taken apart at the slashes once, and each directory that can match is read only
+ * once. The types in the directory entries say which names are regular files or directories,
+ * so only names whose entries don't say are stat()ed. A segment of "**" matches any number of
+ * directories, including none.
+ */
+std::vector<std::string> FileNameMatcher::expand(const char *const wild_name)
+{
+    std::vector<std::string> names;
+    if (!wild(wild_name)) {
+        struct stat file_info;
+        if (stat(wild_name, &file_info) == 0 && S_ISREG(file_info.st_mode))
+            names.push_back(wild_name);
+        return names;
+    }
+
+    // Only directories match a spec that ends with a slash.
+    const std::string spec(wild_name);
+    if (spec.back() == '/')
+        return names;
+
+    std::vector<std::string> segments;
+    std::vector<std::string> directories(1, (spec.front() == '/') ? "/" : "");
+    for (std::string::size_type start = 0; start < spec.size();) {
+        std::string::size_type end = spec.find('/', start);
+        if (end == std::string::npos)
+            end = spec.size();
+        if (end > start)
+            segments.push_back(spec.substr(start, end - start));
+        start = end + 1;
+    }
+
+    for (std::size_t i = 0; i < segments.size() && !directories.empty(); ++i) {
+        const bool last = (i + 1 == segments.size());
+        const char *pattern = segments[i].c_str();
+        if (segments[i] == "**") {
+            directories = read_trees(directories);
+            if (!last)
+                continue;
+            pattern = "*";
+        }
+
+        // Directories named without wildcards aren't read (or even looked for) here.
+        std::vector<Candidate> found;
+        if (!wild(pattern)) {
+            if (!last) {
+                for (std::string &directory : directories)
+                    directory.append(pattern).push_back('/');
+                continue;
+            }
+            for (const std::string &directory : directories)
+                found.push_back(Candidate{directory + pattern, Candidate::UNKNOWN});
+        }
+        else {
+            for (const std::string &directory : directories)
+                read_directory(directory, pattern, true, found);
+        }
+        resolve(found, true);
+
+        directories.clear();
+        for (const Candidate &candidate : found) {
+            if (last && candidate.kind == Candidate::REGULAR)
+                names.push_back(candidate.path);
+            else if (!last && candidate.kind == Candidate::DIRECTORY)
+                directories.push_back(candidate.path + '/');
+        }
+    }
+
+    // The same name can be reached more than once through several segments of "**".
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
 }
 
 time_t FileNameMatcher::modify_time()
@@ -148,6 +351,17 @@ time_t FileNameMatcher::modify_time()
     return file_info.st_mtime;
 }
 
+unsigned long FileNameMatcher::size()
+{
+    // As with modify_time(), a file deleted since buffer was filled is treated as empty.
+    struct stat file_info;
+    if (stat(buffer, &file_info) != 0) {
+        return 0;
+    }
+
+    return static_cast<unsigned long>(file_info.st_size);
+}
+
 #elif eOPSYS == eWIN32
 
 FileNameMatcher::FileNameMatcher()
@@ -343,3 +557,21 @@ char *FileNameMatcher::next()
 }
 
 #endif
+
+#if eOPSYS != ePOSIX
+
+/*!
+ * The names are those next() finds, in the order it finds them.
+ */
+std::vector<std::string> FileNameMatcher::expand(const char *const wild_name)
+{
+    std::vector<std::string> names;
+    FileNameMatcher matcher;
+    if (!matcher.set_name(wild_name))
+        return names;
+    while (const char *const name = matcher.next())
+        names.push_back(name);
+    return names;
+}
+
+#endif
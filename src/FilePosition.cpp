@@ -16,7 +16,8 @@ const unsigned window_horizontal_jump_distance = 1U;
 
 //! Initializes a FilePosition object so the cursor is at the top of the file.
 FilePosition::FilePosition()
-    : c_line(0L), c_column(0U), w_line(0L), w_column(0U), w_heigth(scr::number_of_rows() - 2),
+    : c_line(0L), c_column(0U), w_line(0L), w_column(0U), w_row(0U),
+      w_heigth(scr::number_of_rows() - 2),
       w_width(static_cast<unsigned>(scr::number_of_columns()) - 2)
 {
     // TODO: Assert that w_heigth and w_width are adequate.
@@ -34,7 +35,7 @@ FilePosition::FilePosition()
 FilePosition::FilePosition(const long initial_cursor_line, const unsigned initial_cursor_column,
                            const long initial_window_line, const unsigned initial_window_column)
     : c_line(initial_cursor_line), c_column(initial_cursor_column), w_line(initial_window_line),
-      w_column(initial_window_column), w_heigth(scr::number_of_rows() - 2),
+      w_column(initial_window_column), w_row(0U), w_heigth(scr::number_of_rows() - 2),
       w_width(static_cast<unsigned>(scr::number_of_columns()) - 2)
 {
     // Check sanity on cursor position.
@@ -55,6 +56,24 @@ FilePosition::FilePosition(const long initial_cursor_line, const unsigned initia
         w_column = (c_column - w_width) + 1;
 }
 
+//! Changes the dimensions of the window.
+/*!
+ * The window keeps its top line and left column unless the cursor would then be outside it. In
+ * that case the window is moved just enough to bring the cursor back inside.
+ *
+ * \param height The number of lines in the window. Values less than one are treated as one.
+ * \param width The number of columns in the window. Zero is treated as one.
+ */
+void FilePosition::set_size(const int height, const unsigned width)
+{
+    w_heigth = (height < 1) ? 1 : height;
+    w_width = (width < 1U) ? 1U : width;
+    if (c_line >= w_line + w_heigth)
+        w_line = (c_line - w_heigth) + 1;
+    if (c_column >= w_column + w_width)
+        w_column = (c_column - w_width) + 1;
+}
+
 //! Move the view down one page.
 /*!
  * When the jump is done, the cursor keeps the same position relatiave to the window.
@@ -276,6 +295,20 @@ void FilePosition::cursor_left(const unsigned count)
     }
 }
 
+//! Places the window for a file whose lines are wrapped or folded.
+/*!
+ * The caller is responsible for keeping the cursor inside the window (see
+ * YEditFile::align_window).
+ *
+ * \param new_line The line at the top of the window.
+ * \param new_row The row of that line at the top of the window, counted from zero.
+ */
+void FilePosition::set_window(const long new_line, const unsigned new_row)
+{
+    w_line = (new_line < 0L) ? 0L : new_line;
+    w_row = new_row;
+}
+
 //! Jump the cursor to a specific line.
 /*!
  * \param new_line The target line.
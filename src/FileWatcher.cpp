@@ -0,0 +1,327 @@
+/*! \file    FileWatcher.cpp
+ *  \brief   Implementation of the FileWatcher abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <map>
+#include <utility>
+
+#include <screen/environ.hpp>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define WATCH_INOTIFY
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || \
+    defined(__OpenBSD__) || defined(__DragonFly__)
+#include <fcntl.h>
+#include <sys/event.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+#define WATCH_KQUEUE
+#elif eOPSYS == eWINDOWS
+#include <windows.h>
+#define WATCH_CHANGE_HANDLES
+#endif
+
+#include "EventLoop.hpp"
+#include "FileWatcher.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    // Milliseconds to wait for more changes before reporting them.
+    constexpr long settle_time = 200;
+
+    struct WatchedFile {
+        std::string directory; //!< The directory that holds the file.
+        std::string base_name; //!< The name of the file within the directory.
+        bool watched;          //!< =true if changes to the file are being reported.
+        bool stale;            //!< =true if the file may have changed since it was checked.
+#if defined(WATCH_INOTIFY)
+        int watch;             //!< The inotify watch descriptor of the directory.
+#elif defined(WATCH_KQUEUE)
+        int fd;                //!< The open file registered with the kqueue (-1 if none).
+#elif defined(WATCH_CHANGE_HANDLES)
+        HANDLE notification;   //!< The change notification handle of the directory.
+#endif
+    };
+
+    std::map<std::string, WatchedFile> files; //!< Indexed by the name given to watch().
+    std::function<void()> change_handler;     //!< Called after changes settle.
+    unsigned settle_timer = 0;                //!< Timer that calls the handler (0 if none).
+
+    //! Arranges for the change handler to be called once the changes settle.
+    void report_changes()
+    {
+        if (settle_timer != 0 || !change_handler)
+            return;
+        settle_timer = EventLoop::add_timer(settle_time, [] {
+            settle_timer = 0;
+            if (change_handler)
+                change_handler();
+        });
+    }
+
+    //! Breaks a file name into its directory and its name within the directory.
+    void split_name(const std::string &name, WatchedFile &file)
+    {
+#if eOPSYS == eWINDOWS
+        const std::string::size_type slash = name.find_last_of("/\\:");
+#else
+        const std::string::size_type slash = name.rfind('/');
+#endif
+        if (slash == std::string::npos) {
+            file.directory = ".";
+            file.base_name = name;
+        }
+        else {
+            file.directory = name.substr(0, slash == 0 ? 1 : slash);
+            file.base_name = name.substr(slash + 1);
+        }
+    }
+
+#if defined(WATCH_INOTIFY)
+
+    int notify_fd = -1; //!< The inotify instance, once created.
+
+    //! Marks the files reported by the inotify events that are waiting.
+    void read_events()
+    {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t count;
+        bool any = false;
+        while ((count = read(notify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char *next = buffer; next < buffer + count;) {
+                const inotify_event *const event = reinterpret_cast<inotify_event *>(next);
+                next += sizeof(inotify_event) + event->len;
+                for (auto &entry : files) {
+                    WatchedFile &file = entry.second;
+                    if ((event->mask & IN_Q_OVERFLOW) != 0) {
+                        file.stale = any = true;
+                    }
+                    else if (file.watched && file.watch == event->wd) {
+                        // The directory itself is gone. The file can only be polled now.
+                        if ((event->mask & IN_IGNORED) != 0)
+                            file.watched = false;
+                        if ((event->mask & IN_IGNORED) != 0 ||
+                            (event->len > 0 && file.base_name == event->name))
+                            file.stale = any = true;
+                    }
+                }
+            }
+        }
+        if (any)
+            report_changes();
+    }
+
+    void start_watching(WatchedFile &file)
+    {
+        if (notify_fd == -1) {
+            notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (notify_fd == -1)
+                return;
+            EventLoop::add_source(notify_fd, read_events);
+        }
+
+        // The directory is watched since saving a file often replaces it with a new one.
+        const int watch =
+            inotify_add_watch(notify_fd, file.directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE |
+                                  IN_MOVED_FROM | IN_MOVED_TO);
+        if (watch != -1) {
+            file.watch = watch;
+            file.watched = true;
+        }
+    }
+
+    void stop_watching(WatchedFile &file)
+    {
+        if (!file.watched)
+            return;
+        file.watched = false;
+        for (const auto &entry : files) {
+            if (entry.second.watched && entry.second.watch == file.watch)
+                return;
+        }
+        inotify_rm_watch(notify_fd, file.watch);
+    }
+
+#elif defined(WATCH_KQUEUE)
+
+    int queue = -1; //!< The kqueue, once created.
+
+    void stop_watching(WatchedFile &file)
+    {
+        if (file.fd != -1)
+            close(file.fd);
+        file.fd = -1;
+        file.watched = false;
+    }
+
+    //! Marks the files reported by the kqueue events that are waiting.
+    void read_events()
+    {
+        struct kevent events[16];
+        const timespec no_wait = {0, 0};
+        int count;
+        bool any = false;
+        while ((count = kevent(queue, nullptr, 0, events, 16, &no_wait)) > 0) {
+            for (int i = 0; i < count; ++i) {
+                for (auto &entry : files) {
+                    WatchedFile &file = entry.second;
+                    if (file.fd == -1 || file.fd != static_cast<int>(events[i].ident))
+                        continue;
+                    file.stale = any = true;
+                    // A file that was replaced is watched again when it is next checked.
+                    if ((events[i].fflags & (NOTE_DELETE | NOTE_RENAME)) != 0)
+                        stop_watching(file);
+                }
+            }
+        }
+        if (any)
+            report_changes();
+    }
+
+    void start_watching(WatchedFile &file, const std::string &name)
+    {
+        if (queue == -1) {
+            queue = kqueue();
+            if (queue == -1)
+                return;
+            fcntl(queue, F_SETFD, FD_CLOEXEC);
+            EventLoop::add_source(queue, read_events);
+        }
+
+#if defined(O_EVTONLY)
+        file.fd = open(name.c_str(), O_EVTONLY | O_CLOEXEC);
+#else
+        file.fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+        if (file.fd == -1)
+            return;
+        struct kevent change;
+        EV_SET(&change, file.fd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+               NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME, 0, 0);
+        if (kevent(queue, &change, 1, nullptr, 0, nullptr) == -1) {
+            close(file.fd);
+            file.fd = -1;
+            return;
+        }
+        file.watched = true;
+    }
+
+#elif defined(WATCH_CHANGE_HANDLES)
+
+    //! Marks the files in the directory whose notification handle was signaled.
+    void directory_changed(const HANDLE notification)
+    {
+        FindNextChangeNotification(notification);
+        for (auto &entry : files) {
+            if (entry.second.watched && entry.second.notification == notification)
+                entry.second.stale = true;
+        }
+        report_changes();
+    }
+
+    void start_watching(WatchedFile &file)
+    {
+        for (const auto &entry : files) {
+            if (entry.second.watched && entry.second.directory == file.directory) {
+                file.notification = entry.second.notification;
+                file.watched = true;
+                return;
+            }
+        }
+        const HANDLE notification = FindFirstChangeNotificationA(
+            file.directory.c_str(), FALSE,
+            FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE |
+                FILE_NOTIFY_CHANGE_LAST_WRITE);
+        if (notification == INVALID_HANDLE_VALUE)
+            return;
+        EventLoop::add_source(notification,
+                              [notification] { directory_changed(notification); });
+        file.notification = notification;
+        file.watched = true;
+    }
+
+    void stop_watching(WatchedFile &file)
+    {
+        if (!file.watched)
+            return;
+        file.watched = false;
+        for (const auto &entry : files) {
+            if (entry.second.watched && entry.second.notification == file.notification)
+                return;
+        }
+        EventLoop::remove_source(file.notification);
+        FindCloseChangeNotification(file.notification);
+    }
+
+#endif
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace FileWatcher {
+
+    void watch(const std::string &name)
+    {
+        if (files.find(name) != files.end())
+            return;
+        WatchedFile &file = files[name];
+        split_name(name, file);
+        file.watched = false;
+        file.stale = true;
+#if defined(WATCH_INOTIFY) || defined(WATCH_CHANGE_HANDLES)
+        start_watching(file);
+#elif defined(WATCH_KQUEUE)
+        file.fd = -1;
+        start_watching(file, name);
+#endif
+    }
+
+    void forget(const std::string &name)
+    {
+        auto file = files.find(name);
+        if (file == files.end())
+            return;
+#if defined(WATCH_INOTIFY) || defined(WATCH_KQUEUE) || defined(WATCH_CHANGE_HANDLES)
+        stop_watching(file->second);
+#endif
+        files.erase(file);
+    }
+
+    bool stale(const std::string &name)
+    {
+        auto file = files.find(name);
+        return file == files.end() || !file->second.watched || file->second.stale;
+    }
+
+    void checked(const std::string &name)
+    {
+        auto file = files.find(name);
+        if (file == files.end())
+            return;
+#if defined(WATCH_KQUEUE)
+        // Files that didn't exist, or were replaced, can only be watched once they are there.
+        if (!file->second.watched)
+            start_watching(file->second, name);
+#endif
+        file->second.stale = false;
+    }
+
+    void set_change_handler(std::function<void()> handler)
+    {
+        change_handler = std::move(handler);
+    }
+
+} // namespace FileWatcher
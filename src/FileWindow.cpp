@@ -0,0 +1,96 @@
+/*! \file    FileWindow.cpp
+ *  \brief   Implementation of class FileWindow
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include "FileWindow.hpp"
+
+//! Creates a window showing a file and registers it with the manager.
+/*!
+ * \param manager The manager that composites the window with the others on the screen.
+ * \param file The file shown in the window.
+ * \param position The position in the file the window starts with.
+ * \param row The top row of the window, including its border.
+ * \param column The left column of the window, including its border.
+ * \param width The total width of the window.
+ * \param height The total height of the window.
+ */
+FileWindow::FileWindow(scr::Manager *manager, YEditFile *file, const FilePosition &position,
+                       int row, int column, int width, int height)
+    : scr::Window(manager, row, column, width, height, false), viewed(file), point(position),
+      cursor_offset_row(2), cursor_offset_column(2)
+{
+    point.set_size(image.get_height() - 2, static_cast<unsigned>(image.get_width()) - 2);
+}
+
+//! Shows a file in the window, starting at the given position.
+/*!
+ * This is also used to remember where the window is in its file when it stops being active.
+ */
+void FileWindow::show(YEditFile *file, const FilePosition &position)
+{
+    if (file != viewed)
+        shown.valid = false;
+    viewed = file;
+    point = position;
+    point.set_size(image.get_height() - 2, static_cast<unsigned>(image.get_width()) - 2);
+}
+
+//! Stops showing a file that is being removed from the file list.
+void FileWindow::forget(const YEditFile *const file)
+{
+    if (file == viewed) {
+        viewed = nullptr;
+        shown.valid = false;
+    }
+}
+
+//! Paints the window's file into its image.
+/*!
+ * The window is only marked dirty, to be shown again by the manager, if its image changed.
+ *
+ * \param active True if this is the window the user is working in. Its file is shown at the
+ * file's current point, which is given the dimensions of the window.
+ */
+void FileWindow::paint(const bool active)
+{
+    if (viewed == nullptr)
+        return;
+
+    FilePosition *where = &point;
+    if (active) {
+        FilePosition &current = viewed->CP();
+        const long top_line = current.window_line();
+        const unsigned top_row = current.window_row();
+        current.set_size(image.get_height() - 2, static_cast<unsigned>(image.get_width()) - 2);
+
+        // The size moves the window by lines. Wrapped or folded lines are aligned by rows.
+        if (viewed->moves_by_rows())
+            current.set_window(top_line, top_row);
+        where = &current;
+    }
+    viewed->align_window(*where);
+    if (viewed->display(image, *where, active, shown))
+        mark_dirty();
+
+    // The text rows that scrolled in the image can be scrolled on the screen as well.
+    if (shown.scrolled != 0)
+        my_manager->scroll_window(this, 2, image.get_height() - 2,
+                                  static_cast<int>(shown.scrolled));
+    long row, column;
+    viewed->cursor_cell(*where, row, column);
+    cursor_offset_row = static_cast<int>(2 + row);
+    cursor_offset_column = static_cast<int>(2 + column);
+}
+
+//! Changes the size of the window's image.
+/*!
+ * The image is repainted the next time the window is painted. The window's text area is what
+ * remains inside its border.
+ */
+bool FileWindow::resize(const int new_width, const int new_height)
+{
+    scr::Window::resize(new_width, new_height);
+    point.set_size(image.get_height() - 2, static_cast<unsigned>(image.get_width()) - 2);
+    return true;
+}
@@ -0,0 +1,81 @@
+/*! \file    FixedPool.cpp
+ *  \brief   Implementation of class FixedPool
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstddef>
+#include <new>
+
+#include "FixedPool.hpp"
+
+//! Creates an empty pool.
+/*!
+ * No memory is obtained until the first block is allocated.
+ *
+ * \param object_size The size of the objects to be allocated from this pool.
+ * \param blocks_per_slab The number of blocks obtained from the system at a time.
+ */
+FixedPool::FixedPool(const std::size_t object_size, const std::size_t blocks_per_slab)
+    : block_size(0), slab_blocks(blocks_per_slab), free_list(nullptr), in_use(0)
+{
+    // Every block must be able to hold a free list link and be suitably aligned.
+    const std::size_t alignment = alignof(std::max_align_t);
+    std::size_t required = (object_size < sizeof(FreeBlock)) ? sizeof(FreeBlock) : object_size;
+    block_size = (required + alignment - 1) / alignment * alignment;
+    if (slab_blocks == 0)
+        slab_blocks = 1;
+}
+
+//! Returns all slabs to the system.
+/*!
+ * Any blocks still allocated from the pool become invalid.
+ */
+FixedPool::~FixedPool()
+{
+    for (char *slab : slabs) {
+        ::operator delete(slab);
+    }
+}
+
+//! Allocates a block.
+/*!
+ * \return A pointer to uninitialized storage of the pool's object size.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void *FixedPool::allocate()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (free_list == nullptr) {
+        // Get a new slab and thread all its blocks onto the free list.
+        slabs.reserve(slabs.size() + 1);
+        char *const slab = static_cast<char *>(::operator new(block_size * slab_blocks));
+        slabs.push_back(slab);
+        for (std::size_t i = slab_blocks; i > 0; --i) {
+            FreeBlock *const block = reinterpret_cast<FreeBlock *>(slab + (i - 1) * block_size);
+            block->next = free_list;
+            free_list = block;
+        }
+    }
+
+    FreeBlock *const result = free_list;
+    free_list = free_list->next;
+    ++in_use;
+    return result;
+}
+
+//! Returns a block to the pool.
+/*!
+ * \param block A pointer previously returned by allocate. If nullptr there is no effect.
+ */
+void FixedPool::deallocate(void *const block)
+{
+    if (block == nullptr)
+        return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    FreeBlock *const returned = static_cast<FreeBlock *>(block);
+    returned->next = free_list;
+    free_list = returned;
+    --in_use;
+}
@@ -0,0 +1,239 @@
+/*! \file    FuzzyMatcher.cpp
+ *  \brief   Implementation of class FuzzyMatcher.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "FuzzyMatcher.hpp"
+
+namespace {
+
+    // Paths are examined in blocks. The masks of a block are checked in one tight loop, which
+    // compilers can vectorize, before any text is looked at.
+    constexpr std::size_t block_size = 256;
+
+    // The points for each matched character and the bonuses added to them.
+    constexpr int match_points = 16;
+    constexpr int word_bonus = 8;  // The character starts a word.
+    constexpr int run_bonus = 4;   // Each character in a run of consecutive matches.
+    constexpr int name_bonus = 16; // The whole match is in the file's name.
+
+    inline bool is_separator(const char c) { return c == '/' || c == '\\'; }
+
+    //! Returns true if the character at offset starts a word in path.
+    bool starts_word(const std::string_view path, const std::size_t offset)
+    {
+        if (offset == 0)
+            return true;
+        const char previous = path[offset - 1];
+        const char current = path[offset];
+        if (is_separator(previous) || previous == '_' || previous == '-' || previous == '.' ||
+            previous == ' ')
+            return true;
+        return previous >= 'a' && previous <= 'z' && current >= 'A' && current <= 'Z';
+    }
+
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Examines a block of paths [first, last) of the index, adding those that match.
+void FuzzyMatcher::scan(const PathIndex &index, const std::size_t first, const std::size_t last)
+{
+    bool possible[block_size];
+    const std::size_t count = last - first;
+    for (std::size_t i = 0; i < count; ++i)
+        possible[i] = (index.mask(first + i) & query_mask) == query_mask;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!possible[i])
+            continue;
+        const std::string_view path = index.path(first + i);
+        int points;
+        if (score(path, index.folded_path(first + i), query, points))
+            matches.push_back(Match{points, static_cast<std::uint32_t>(path.size()),
+                                    static_cast<std::uint32_t>(first + i)});
+    }
+}
+
+//! Checks the matches up to last again, moving those that still match to the front.
+void FuzzyMatcher::rescore(const PathIndex &index, const std::size_t last)
+{
+    for (; rescored < last; ++rescored) {
+        Match match = matches[rescored];
+        int points;
+        if ((index.mask(match.index) & query_mask) == query_mask &&
+            score(index.path(match.index), index.folded_path(match.index), query, points)) {
+            match.points = points;
+            matches[kept++] = match;
+        }
+    }
+}
+
+//! Finds the best matches and puts them in order.
+void FuzzyMatcher::rank()
+{
+    auto better = [](const Match &left, const Match &right) {
+        if (left.points != right.points)
+            return left.points > right.points;
+        if (left.length != right.length)
+            return left.length < right.length;
+        return left.index < right.index;
+    };
+
+    // While the matches are checked again only those already checked are ranked.
+    const std::size_t usable = rescoring ? kept : matches.size();
+    const std::size_t count = std::min(best_limit, usable);
+    std::partial_sort(matches.begin(), matches.begin() + count, matches.begin() + usable,
+                      better);
+    ranked.clear();
+    for (std::size_t i = 0; i < count; ++i)
+        ranked.push_back(matches[i].index);
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Changes the query.
+/*!
+ * If the new query only adds characters to the end of the old one, the paths that don't match
+ * the old query can't match the new one either. They are not examined again by `update`.
+ */
+void FuzzyMatcher::set_query(const std::string_view new_query)
+{
+    std::string folded;
+    for (const char c : new_query)
+        folded.push_back(PathIndex::fold(c));
+    if (folded == query)
+        return;
+
+    const bool narrowed = folded.compare(0, query.size(), query) == 0;
+    query = std::move(folded);
+    query_mask = PathIndex::character_mask(query);
+    if (narrowed) {
+        // Matches not yet checked against the old query are checked against the new one.
+        if (rescoring)
+            matches.erase(matches.begin() + kept, matches.begin() + rescored);
+        rescoring = true;
+        rescored = 0;
+        kept = 0;
+    }
+    else {
+        matches.clear();
+        scanned = 0;
+        rescoring = false;
+    }
+}
+
+//! Brings the matches up to date with the query and the paths in the index.
+/*!
+ * The cost is proportional to the number of paths that matched the previous query (when it
+ * was narrowed) plus the number of paths added to the index since the last update. The best
+ * matches are ranked even if the work is not finished.
+ *
+ * \param index The paths. Paths may be added to it between updates but not removed.
+ * \param budget The time after which the work stops (at the end of a block of paths).
+ * \return true if every path in the index has been examined for the current query.
+ */
+bool FuzzyMatcher::update(const PathIndex &index,
+                          const std::chrono::steady_clock::duration budget)
+{
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + budget;
+    auto in_time = [&deadline] { return std::chrono::steady_clock::now() < deadline; };
+
+    while (rescoring && in_time()) {
+        rescore(index, std::min(matches.size(), rescored + block_size));
+        if (rescored == matches.size()) {
+            matches.resize(kept);
+            rescoring = false;
+        }
+    }
+    while (!rescoring && scanned < index.size() && in_time()) {
+        const std::size_t last = std::min(index.size(), scanned + block_size);
+        scan(index, scanned, last);
+        scanned = last;
+    }
+    rank();
+    return !rescoring && scanned == index.size();
+}
+
+//! Scores a path against a query.
+/*!
+ * The query must already have its letters folded to lower case. The match scored is the
+ * shortest one ending where the query first completes in the path: the characters are found
+ * going forward, then the start is found by matching the query backward from the end. Each
+ * matched character is worth some points, more if it starts a word or continues a run of
+ * matched characters. A point is lost for each unmatched character between the first and last
+ * matched ones. A match that is entirely in the file's name (after the last separator) earns a
+ * bonus.
+ *
+ * \param path The path to score.
+ * \param folded_path The path with its letters folded to lower case.
+ * \param folded_query The query. Every path matches an empty query with zero points.
+ * \param points Set to the score if the path matches.
+ * \return true if the characters of the query appear in order in the path.
+ */
+bool FuzzyMatcher::score(const std::string_view path, const std::string_view folded_path,
+                         const std::string_view folded_query, int &points)
+{
+    points = 0;
+    const std::size_t size = folded_query.size();
+    if (size == 0)
+        return true;
+
+    // Find where the first complete match ends.
+    const char *const text = folded_path.data();
+    std::size_t end = 0;
+    std::size_t position = 0;
+    for (const char c : folded_query) {
+        const void *found = std::memchr(text + position, c, folded_path.size() - position);
+        if (found == nullptr)
+            return false;
+        end = static_cast<std::size_t>(static_cast<const char *>(found) - text);
+        position = end + 1;
+    }
+
+    // Find the latest start of a match ending there.
+    std::size_t start = end;
+    for (std::size_t matched = size;; --start) {
+        if (text[start] == folded_query[matched - 1] && --matched == 0)
+            break;
+    }
+
+    // Score the characters matched going forward from the start.
+    int total = 0;
+    int run = 0;
+    std::size_t previous = start;
+    std::size_t matched = 0;
+    for (std::size_t i = start; i <= end && matched < size; ++i) {
+        if (text[i] != folded_query[matched])
+            continue;
+        int character_points = match_points;
+        if (starts_word(path, i))
+            character_points += word_bonus;
+        if (matched != 0 && i == previous + 1)
+            character_points += run_bonus * ++run;
+        else
+            run = 0;
+        total += character_points;
+        previous = i;
+        ++matched;
+    }
+    total -= static_cast<int>(end + 1 - start - size);
+
+    std::size_t name_start = path.size();
+    while (name_start > 0 && !is_separator(path[name_start - 1]))
+        --name_start;
+    if (start >= name_start)
+        total += name_bonus;
+
+    points = total;
+    return true;
+}
@@ -0,0 +1,228 @@
+/*! \file    HexImage.cpp
+ *  \brief   Implementation of class HexImage
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "HexImage.hpp"
+
+namespace {
+
+    const char prefix[] = "hex:";
+    const char digits[] = "0123456789abcdef";
+
+    //! Writes a run of bytes at the given offset of an open file. Returns false if that fails.
+#if eOPSYS == ePOSIX
+    bool write_run(const int fd, std::uint64_t offset, const std::string &run)
+    {
+        const char *text = run.data();
+        std::size_t size = run.size();
+        while (size > 0) {
+            const ssize_t count = pwrite(fd, text, size, static_cast<off_t>(offset));
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+            text += count;
+            size -= static_cast<std::size_t>(count);
+            offset += static_cast<std::uint64_t>(count);
+        }
+        return true;
+    }
+#else
+    bool write_run(std::FILE *const file, const std::uint64_t offset, const std::string &run)
+    {
+#if eOPSYS == eWINDOWS
+        const bool placed = _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+        const bool placed = std::fseek(file, static_cast<long>(offset), SEEK_SET) == 0;
+#endif
+        return placed && std::fwrite(run.data(), 1, run.size(), file) == run.size();
+    }
+#endif
+
+} // namespace
+
+HexImage::HexImage() : offset_digits(8)
+{
+}
+
+//! Returns true if the name is of the form hex:path.
+bool HexImage::is_hex(const char *const name)
+{
+    return std::strncmp(name, prefix, sizeof(prefix) - 1) == 0;
+}
+
+//! Returns the path of the file shown by a view of the given name.
+const char *HexImage::path_of(const char *const name)
+{
+    return is_hex(name) ? name + sizeof(prefix) - 1 : name;
+}
+
+//! Maps the file at the given path, forgetting the bytes changed in any file opened before.
+/*!
+ * \return false if the file could not be mapped (for example if it isn't a regular file). No
+ * message is printed.
+ */
+bool HexImage::open(const char *const path)
+{
+    overlay.clear();
+    if (!image.open(path))
+        return false;
+
+    // Every row's offset has as many digits as the last one needs, and at least eight.
+    offset_digits = 8;
+    for (std::uint64_t last = size() >> 32; last != 0; last >>= 4)
+        ++offset_digits;
+    return true;
+}
+
+//! Returns the byte at the given offset, as changed.
+unsigned char HexImage::byte(const std::uint64_t offset) const
+{
+    const auto changed = overlay.find(offset);
+    if (changed != overlay.end())
+        return changed->second;
+    return static_cast<unsigned char>(image.data()[offset]);
+}
+
+//! Changes the byte at the given offset. Bytes beyond the end of the file are ignored.
+void HexImage::patch(const std::uint64_t offset, const unsigned char value)
+{
+    if (offset >= size())
+        return;
+    if (value == static_cast<unsigned char>(image.data()[offset]))
+        overlay.erase(offset);
+    else
+        overlay[offset] = value;
+}
+
+//! Puts the text of the given row into text.
+/*!
+ * A row holds the offset of its first byte, then its bytes as pairs of hexadecimal digits (in
+ * two groups of eight), and then as characters. Bytes that aren't printable ASCII characters
+ * are shown as dots. The last row is cut short at the end of the file and rows after it are
+ * empty.
+ */
+void HexImage::render(const long row, std::string &text) const
+{
+    const std::uint64_t first = static_cast<std::uint64_t>(row) * row_bytes;
+    if (row < 0 || first >= size()) {
+        text.clear();
+        return;
+    }
+    const unsigned count =
+        static_cast<unsigned>(std::min<std::uint64_t>(row_bytes, size() - first));
+    text.assign(characters_start() + count, ' ');
+    for (unsigned i = 0; i < offset_digits; ++i)
+        text[offset_digits - 1 - i] = digits[(first >> (4 * i)) & 0x0F];
+    for (unsigned i = 0; i < count; ++i) {
+        const unsigned char value = byte(first + i);
+        const unsigned column = column_of(Cell{first + i, false, 0U});
+        text[column] = digits[value >> 4];
+        text[column + 1] = digits[value & 0x0F];
+        text[characters_start() + i] =
+            (value >= ' ' && value <= '~') ? static_cast<char>(value) : '.';
+    }
+}
+
+//! Finds the cell shown at the given row and column.
+/*!
+ * \return false if the column doesn't show a digit or character of a byte in the file.
+ */
+bool HexImage::locate(const long row, const unsigned column, Cell &cell) const
+{
+    if (row < 0)
+        return false;
+    const std::uint64_t first = static_cast<std::uint64_t>(row) * row_bytes;
+    unsigned index;
+    if (column >= characters_start()) {
+        index = column - characters_start();
+        cell.character = true;
+        cell.digit = 0U;
+    }
+    else if (column >= digits_start()) {
+        // The second group of digits is set off by an extra space.
+        unsigned position = column - digits_start();
+        if (position >= 3 * row_bytes / 2)
+            --position;
+        index = position / 3;
+        cell.character = false;
+        cell.digit = position % 3;
+        if (cell.digit > 1U)
+            return false;
+    }
+    else
+        return false;
+    cell.offset = first + index;
+    return index < row_bytes && cell.offset < size();
+}
+
+//! Returns the column of a cell, on the row holding its byte.
+unsigned HexImage::column_of(const Cell &cell) const
+{
+    const unsigned index = static_cast<unsigned>(cell.offset % row_bytes);
+    if (cell.character)
+        return characters_start() + index;
+    return digits_start() + 3 * index + (index >= row_bytes / 2 ? 1U : 0U) + cell.digit;
+}
+
+//! Writes the bytes changed into the file at the given path, in place.
+/*!
+ * Consecutive bytes are written together, each run with a single positional write. The file
+ * is then mapped again so that it is shown as written. The bytes changed are forgotten only
+ * if they were all written.
+ */
+HexImage::WriteStatus HexImage::write(const char *const path)
+{
+    // The mapping is released first since some systems don't allow a mapped file to be written.
+    image.close();
+    WriteStatus status = WRITTEN;
+#if eOPSYS == ePOSIX
+    const int file = ::open(path, O_WRONLY | O_CLOEXEC);
+    const bool opened = file != -1;
+#else
+    std::FILE *const file = std::fopen(path, "r+b");
+    const bool opened = file != nullptr;
+#endif
+    if (!opened)
+        status = NOT_OPENED;
+    else {
+        std::string run;
+        for (auto patched = overlay.begin(); patched != overlay.end() && status == WRITTEN;) {
+            const std::uint64_t start = patched->first;
+            run.clear();
+            do {
+                run.push_back(static_cast<char>(patched++->second));
+            } while (patched != overlay.end() && patched->first == start + run.size());
+            if (!write_run(file, start, run))
+                status = DAMAGED;
+        }
+#if eOPSYS == ePOSIX
+        if (::close(file) != 0)
+            status = DAMAGED;
+#else
+        if (std::fclose(file) != 0)
+            status = DAMAGED;
+#endif
+    }
+
+    std::map<std::uint64_t, unsigned char> unwritten;
+    if (status != WRITTEN)
+        unwritten.swap(overlay);
+    open(path);
+    overlay.swap(unwritten);
+    return status;
+}
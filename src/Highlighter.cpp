@@ -0,0 +1,283 @@
+/*! \file    Highlighter.cpp
+ *  \brief   Implementation of class Highlighter
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <string>
+
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "Highlighter.hpp"
+
+namespace {
+    const char *const ada_keywords[] = {
+        "abort", "abs", "abstract", "accept", "access", "aliased", "all", "and", "array", "at",
+        "begin", "body", "case", "constant", "declare", "delay", "delta", "digits", "do",
+        "else", "elsif", "end", "entry", "exception", "exit", "for", "function", "generic",
+        "goto", "if", "in", "interface", "is", "limited", "loop", "mod", "new", "not", "null",
+        "of", "or", "others", "out", "overriding", "package", "pragma", "private", "procedure",
+        "protected", "raise", "range", "record", "rem", "renames", "requeue", "return",
+        "reverse", "select", "separate", "some", "subtype", "synchronized", "tagged", "task",
+        "terminate", "then", "type", "until", "use", "when", "while", "with", "xor"
+    };
+
+    const char *const asm_keywords[] = {
+        "assume", "byte", "db", "dd", "dq", "dt", "dw", "dword", "end", "endm", "endp", "ends",
+        "equ", "extrn", "include", "label", "local", "macro", "model", "offset", "org", "proc",
+        "ptr", "public", "qword", "seg", "segment", "struct", "word"
+    };
+
+    const char *const c_keywords[] = {
+        "alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch", "char",
+        "char16_t", "char32_t", "char8_t", "class", "co_await", "co_return", "co_yield",
+        "concept", "const", "const_cast", "consteval", "constexpr", "constinit", "continue",
+        "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum",
+        "explicit", "export", "extern", "false", "float", "for", "friend", "goto", "if",
+        "inline", "int", "long", "mutable", "namespace", "new", "noexcept", "nullptr",
+        "operator", "private", "protected", "public", "register", "reinterpret_cast",
+        "requires", "return", "short", "signed", "sizeof", "static", "static_assert",
+        "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "true",
+        "try", "typedef", "typeid", "typename", "union", "unsigned", "using", "virtual", "void",
+        "volatile", "wchar_t", "while"
+    };
+
+    const char *const pcd_keywords[] = {
+        "CLASS", "ELSE", "END", "FOR", "FUNCTION", "IF", "RETURN", "THEN", "TYPE", "WHILE"
+    };
+
+    const char *const scala_keywords[] = {
+        "abstract", "case", "catch", "class", "def", "do", "else", "extends", "false", "final",
+        "finally", "for", "forSome", "if", "implicit", "import", "lazy", "match", "new", "null",
+        "object", "override", "package", "private", "protected", "return", "sealed", "super",
+        "this", "throw", "trait", "true", "try", "type", "val", "var", "while", "with", "yield"
+    };
+
+    template<std::size_t count>
+    constexpr std::size_t size_of(const char *const (&)[count])
+    {
+        return count;
+    }
+
+    //! Returns true if the text at the given offset begins with the given marker.
+    bool starts(const std::string_view text, const std::size_t offset, const char *const marker)
+    {
+        return marker != nullptr && text.compare(offset, std::strlen(marker), marker) == 0;
+    }
+
+    //! Returns true if the word is one of the language's keywords.
+    bool is_keyword(const Language &language, std::string_view word)
+    {
+        // No keyword is this long. Shorter words are folded to lower case without allocating.
+        char folded[24];
+        if (word.size() > sizeof(folded))
+            return false;
+        if (language.ignore_case) {
+            std::transform(word.begin(), word.end(), folded, [](unsigned char ch) {
+                return static_cast<char>(std::tolower(ch));
+            });
+            word = std::string_view(folded, word.size());
+        }
+        const char *const *const end = language.keywords + language.keyword_count;
+        const char *const *const found = std::lower_bound(
+            language.keywords, end, word,
+            [](const char *keyword, std::string_view key) { return key.compare(keyword) > 0; });
+        return found != end && word == *found;
+    }
+
+    bool word_char(const char ch)
+    {
+        return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_';
+    }
+} // namespace
+
+const Language ada_language = {
+    "--", nullptr, nullptr, "\"", false, '\0', true, ada_keywords, size_of(ada_keywords)};
+
+const Language asm_language = {
+    ";", nullptr, nullptr, "\"'", false, '\0', true, asm_keywords, size_of(asm_keywords)};
+
+const Language c_language = {
+    "//", "/*", "*/", "\"'", true, '#', false, c_keywords, size_of(c_keywords)};
+
+const Language pcd_language = {
+    nullptr, nullptr, nullptr, "\"", false, '\0', false, pcd_keywords, size_of(pcd_keywords)};
+
+const Language scala_language = {
+    "//", "/*", "*/", "\"'", true, '\0', false, scala_keywords, size_of(scala_keywords)};
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Divides a line into tokens.
+/*!
+ * \param language The language of the line.
+ * \param text The text of the line.
+ * \param state The state at the end of the previous line.
+ * \param tokens An array receiving the token of each character, or nullptr if not wanted.
+ * \return The state at the end of the line.
+ */
+Highlighter::State Highlighter::scan(const Language &language, const std::string_view text,
+                                     State state, Token *const tokens)
+{
+    const std::size_t size = text.size();
+    auto mark = [tokens](std::size_t first, std::size_t last, Token token) {
+        if (tokens != nullptr)
+            std::fill(tokens + first, tokens + last, token);
+    };
+    mark(0, size, PLAIN);
+
+    std::size_t position = 0;
+    if (state == IN_COMMENT) {
+        const std::size_t end = text.find(language.comment_end);
+        if (end == std::string_view::npos) {
+            mark(0, size, COMMENT);
+            return IN_COMMENT;
+        }
+        position = end + std::strlen(language.comment_end);
+        mark(0, position, COMMENT);
+    }
+
+    // Everything but comments in a directive is shown the same way.
+    bool directive = false;
+    if (language.directive != '\0') {
+        const std::size_t first = text.find_first_not_of(' ');
+        directive = first != std::string_view::npos && first >= position &&
+                    text[first] == language.directive;
+    }
+
+    while (position < size) {
+        const char ch = text[position];
+        std::size_t end = position + 1;
+
+        if (starts(text, position, language.line_comment)) {
+            mark(position, size, COMMENT);
+            return NORMAL;
+        }
+        if (starts(text, position, language.comment_start)) {
+            const std::size_t body = position + std::strlen(language.comment_start);
+            end = text.find(language.comment_end, body);
+            if (end == std::string_view::npos) {
+                mark(position, size, COMMENT);
+                return IN_COMMENT;
+            }
+            end += std::strlen(language.comment_end);
+            mark(position, end, COMMENT);
+        }
+        else if (ch != '\0' && std::strchr(language.quotes, ch) != nullptr) {
+            while (end < size && text[end] != ch) {
+                if (language.escapes && text[end] == '\\')
+                    ++end;
+                ++end;
+            }
+            end = std::min(end + 1, size);
+            mark(position, end, directive ? DIRECTIVE : STRING);
+        }
+        else if (std::isdigit(static_cast<unsigned char>(ch))) {
+            while (end < size && (word_char(text[end]) || text[end] == '.'))
+                ++end;
+            mark(position, end, directive ? DIRECTIVE : NUMBER);
+        }
+        else if (word_char(ch)) {
+            while (end < size && word_char(text[end]))
+                ++end;
+            if (directive)
+                mark(position, end, DIRECTIVE);
+            else if (is_keyword(language, text.substr(position, end - position)))
+                mark(position, end, KEYWORD);
+        }
+        else if (directive) {
+            mark(position, end, DIRECTIVE);
+        }
+        position = end;
+    }
+    return NORMAL;
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Creates a highlighter for an empty file.
+Highlighter::Highlighter() : valid(0), resume(0)
+{
+}
+
+//! Adjusts the cached states for a modification of the file (see EditFile::take_modifications).
+void Highlighter::invalidate(const EditDelta &change)
+{
+    // The states of the unmodified lines are kept, moved to the lines' new positions. There are
+    // no states to keep in a range of lines still waiting to be computed after an earlier
+    // modification.
+    long keep = change.first + change.old_count;
+    if (keep >= valid && keep < resume)
+        keep = resume;
+    const long moved_to = keep + change.moved();
+    valid = std::min(valid, change.first);
+    if (keep < static_cast<long>(states.size()) && moved_to >= valid) {
+        states.erase(states.begin() + valid, states.begin() + keep);
+        states.insert(states.begin() + valid, moved_to - valid, NORMAL);
+        resume = moved_to;
+    }
+    else {
+        states.resize(valid);
+        resume = valid;
+    }
+}
+
+//! Computes the states of the lines up to through_line.
+/*!
+ * \param language The language of the file.
+ * \param data The file's lines. The current point is moved.
+ * \param through_line The last line that will be colored.
+ * \return The last line that begins in a different state than when it was last colored, or -1
+ * if there is no such line.
+ */
+long Highlighter::update(const Language &language, EditList &data, const long through_line)
+{
+    long recolored = -1;
+    if (valid > through_line)
+        return recolored;
+
+    State state = (valid == 0) ? NORMAL : states[valid - 1];
+    data.jump_to(valid);
+    while (valid <= through_line) {
+        const EditBuffer *const line = data.next();
+        if (line == nullptr)
+            break;
+        state = scan(language, line->view(), state, nullptr);
+
+        if (valid >= static_cast<long>(states.size())) {
+            states.push_back(state);
+            recolored = ++valid;
+            continue;
+        }
+
+        // The states kept from before a modification are correct once a line ends as before.
+        if (valid >= resume && states[valid] == state) {
+            valid = static_cast<long>(states.size());
+            if (valid <= through_line) {
+                state = states[valid - 1];
+                data.jump_to(valid);
+            }
+            continue;
+        }
+        states[valid] = state;
+        recolored = ++valid;
+    }
+    resume = std::max(resume, valid);
+    return recolored;
+}
+
+//! Divides a line into tokens. The states of the lines before it must be up to date.
+void Highlighter::color_line(const Language &language, const long line_number,
+                             const std::string_view text, std::vector<Token> &tokens) const
+{
+    const State state =
+        (line_number == 0 || line_number > valid) ? NORMAL : states[line_number - 1];
+    tokens.resize(text.size());
+    scan(language, text, state, tokens.data());
+}
@@ -0,0 +1,203 @@
+/*! \file    IncrementalSearch.cpp
+ *  \brief   Implementation of the IncrementalSearch abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <screen/screen.hpp>
+
+#include "EditBuffer.hpp"
+#include "EventLoop.hpp"
+#include "FilePosition.hpp"
+#include "IncrementalSearch.hpp"
+#include "SearchPattern.hpp"
+#include "Utf8.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
+#include "keyboard.hpp"
+
+#define SEARCH_STEP 1048576 // Bytes searched by each call of the idle task.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! What is known about one of the patterns typed.
+    struct Step {
+        std::string text;   //!< The pattern.
+        bool searching;     //!< =true while the pattern is being looked for...
+        long line;          //!<   ... from here. Otherwise the occurrence (-1 if none).
+        std::size_t offset; //!< The byte offset in the line.
+    };
+
+    YEditFile *file = nullptr;   //!< The file being searched (nullptr when there is no search).
+    SearchPattern::Mode mode;
+    unsigned options;            //!< The SearchPattern options.
+    std::vector<Step> steps;     //!< The patterns typed, the latest last. The first is empty.
+    SearchPattern pattern;       //!< The latest pattern, compiled.
+    bool valid = true;           //!< =false if the latest pattern is a bad regular expression.
+
+    //! Compiles the latest pattern, abandoning the search for it if it is not valid.
+    void compile()
+    {
+        Step &step = steps.back();
+        valid = pattern.compile(step.text, mode, options);
+        if (!valid) {
+            step.searching = false;
+            step.line = -1L;
+        }
+    }
+
+    //! Moves the cursor to the latest occurrence found and describes the search in the prompt.
+    void update()
+    {
+        std::size_t found = steps.size() - 1;
+        while (found > 0 && (steps[found].searching || steps[found].line < 0L))
+            --found;
+        const Step &shown = steps[found];
+        FilePosition &position = file->CP();
+        position.jump_to_line(shown.line);
+        const EditBuffer *const text = file->line_at(shown.line);
+        if (text != nullptr)
+            position.jump_to_column(
+                static_cast<unsigned>(text->column_of(shown.offset, file->tab_distance())));
+
+        const Step &latest = steps.back();
+        std::string prompt =
+            (mode == SearchPattern::REGULAR_EXPRESSION) ? " Regex I-search: " : " I-search: ";
+        if (!valid)
+            prompt = " Bad regular expression: ";
+        else if (!latest.searching && latest.line < 0L)
+            prompt.insert(1, "Failing ");
+        prompt += latest.text;
+        if (latest.searching)
+            prompt += "   (searching)";
+        WindowList::show_prompt(prompt);
+        YEditFile::show_matches((valid && !latest.text.empty()) ? &pattern : nullptr);
+    }
+
+    //! Looks for the latest pattern a part of the file at a time. An idle task.
+    bool search_part()
+    {
+        if (file == nullptr || !steps.back().searching)
+            return false;
+        Step &step = steps.back();
+        if (file->search_part(pattern, step.line, step.offset, SEARCH_STEP)) {
+            step.searching = false;
+            update();
+            WindowList::display();
+        }
+        return true;
+    }
+
+    //! Adds a character to the pattern.
+    void extend(const char letter)
+    {
+        Step next = steps.back();
+        next.text.push_back(letter);
+
+        // A longer literal pattern is found where the shorter one is, or further on. Where the
+        // shorter one has not been found yet is where its search had got to. That isn't so
+        // for whole words, as the shorter word may have been passed over within the longer.
+        if (mode == SearchPattern::LITERAL && (options & SearchPattern::WHOLE_WORD) == 0 &&
+            valid) {
+            next.searching = next.line >= 0L;
+        }
+        else {
+            next.searching = true;
+            next.line = steps.front().line;
+            next.offset = steps.front().offset;
+        }
+        steps.push_back(next);
+        compile();
+    }
+
+    //! Looks for the next occurrence of the pattern, from the top of the file after the last.
+    void repeat()
+    {
+        const Step &last = steps.back();
+        if (steps.size() == 1 || last.searching || !valid)
+            return;
+        Step next = last;
+        next.searching = true;
+        if (last.line < 0L) {
+            next.line = 0L;
+            next.offset = 0;
+        }
+        else {
+            const EditBuffer *const text = file->line_at(last.line);
+            next.offset =
+                (text != nullptr) ? Utf8::next(text->view(), last.offset) : last.offset + 1;
+        }
+        steps.push_back(next);
+    }
+
+    //! Takes the last character off the pattern, or undoes the last repeat.
+    void retract()
+    {
+        if (steps.size() == 1)
+            return;
+        steps.pop_back();
+        compile();
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace IncrementalSearch {
+
+    bool run(YEditFile &the_file, const SearchPattern::Mode search_mode,
+             const unsigned search_options, std::string &text)
+    {
+        static const bool task_added = (EventLoop::add_idle(search_part), true);
+        (void)task_added;
+
+        // The empty pattern is found where the cursor is.
+        const FilePosition start = the_file.CP();
+        const SearchPattern *const shown = YEditFile::shown_matches();
+        const EditBuffer *const line = the_file.line_at(start.cursor_line());
+        file = &the_file;
+        mode = search_mode;
+        options = search_options;
+        steps.assign(1, Step{std::string(), false, start.cursor_line(),
+                             (line != nullptr) ? line->offset_of(start.cursor_column(),
+                                                                 the_file.tab_distance())
+                                               : std::size_t(0)});
+        valid = true;
+        update();
+
+        int key;
+        for (;;) {
+            key = KeyHandler::get_key();
+            if (key == scr::K_BACKSPACE || key == 127)
+                retract();
+            else if (key == scr::K_DOWN)
+                repeat();
+            else if ((key & 0x8000) != 0 || (key >= ' ' && key < scr::XF && key != 127))
+                extend(static_cast<char>(key));
+            else
+                break;
+            update();
+        }
+
+        text = steps.back().text;
+        YEditFile::show_matches(shown);
+        WindowList::hide_prompt();
+        file = nullptr;
+        steps.clear();
+        if (key == scr::K_ESC) {
+            the_file.CP() = start;
+            return false;
+        }
+        return true;
+    }
+
+} // namespace IncrementalSearch
@@ -0,0 +1,133 @@
+/*! \file    JobList.cpp
+ *  \brief   Implementation of the JobList abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BackgroundJob.hpp"
+#include "ErrorList.hpp"
+#include "FileList.hpp"
+#include "JobList.hpp"
+#include "YEditFile.hpp"
+#include "support.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    struct Job {
+        std::unique_ptr<BackgroundJob> process;
+        YEditFile *output; //!< The file receiving the output. It belongs to the file list.
+        long lines;        //!< Number of lines of output so far.
+        bool scanned;      //!< =true if the output is scanned for problems (see ErrorList).
+    };
+
+    std::vector<Job> jobs;
+    unsigned last_number = 0; //!< Used to give each job's file a distinct name.
+
+    //! Returns true if the file is still on the file list.
+    bool listed(const YEditFile *const file)
+    {
+        return FileList::contains(file);
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace JobList {
+
+    bool start(const std::string &command)
+    {
+        std::unique_ptr<BackgroundJob> process(new BackgroundJob(command));
+        if (!process->start()) {
+            error_message("Can't run %s", command.c_str());
+            return false;
+        }
+
+        // The name can't be that of a file on disk; '*' is not allowed in Windows file names.
+        char name[32];
+        std::snprintf(name, sizeof(name), "*job%u*", ++last_number);
+        if (!FileList::new_file(name))
+            return false;
+        YEditFile &output = FileList::active_file();
+        output.set_read_only(true);
+
+        const std::string heading = "*** " + command + "\n";
+        output.append_text(heading.data(), heading.size());
+
+        // The problems listed are those of the latest job.
+        for (Job &job : jobs)
+            job.scanned = false;
+        ErrorList::start();
+        jobs.push_back(Job{std::move(process), &output, 0, true});
+        return true;
+    }
+
+    bool poll()
+    {
+        bool active_changed = false;
+        std::string text;
+
+        for (auto job = jobs.begin(); job != jobs.end();) {
+            // Dropping the job of a killed file stops the command.
+            if (!listed(job->output)) {
+                job = jobs.erase(job);
+                continue;
+            }
+
+            text.clear();
+            job->process->collect(text);
+            job->lines += static_cast<long>(std::count(text.begin(), text.end(), '\n'));
+            const bool running = job->process->running();
+            if (job->scanned) {
+                ErrorList::scan(text);
+                if (!running)
+                    ErrorList::finish();
+            }
+            if (!running) {
+                char summary[64];
+                std::snprintf(summary, sizeof(summary), "*** Command exited with status: %d\n",
+                              job->process->status());
+                text.append(summary);
+            }
+            if (!text.empty()) {
+                job->output->append_text(text.data(), text.size());
+                if (job->output == &FileList::active_file())
+                    active_changed = true;
+            }
+
+            if (running)
+                ++job;
+            else
+                job = jobs.erase(job);
+        }
+        return active_changed;
+    }
+
+    unsigned count()
+    {
+        return static_cast<unsigned>(jobs.size());
+    }
+
+    const char *status()
+    {
+        static char line[81];
+        if (jobs.size() == 1)
+            std::snprintf(line, sizeof(line), " Running in the background: %.40s (%ld lines)",
+                          jobs.front().process->command().c_str(), jobs.front().lines);
+        else
+            std::snprintf(line, sizeof(line), " Running in the background: %u jobs", count());
+        return line;
+    }
+
+} // namespace JobList
@@ -0,0 +1,371 @@
+/*! \file    Json.cpp
+ *  \brief   Implementation of classes JsonValue and JsonParser
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+#include "Json.hpp"
+
+namespace {
+
+    //! The value of missing members and elements.
+    const JsonValue null_value;
+
+    //! Returns the value of a hexadecimal digit or -1 if the character isn't one.
+    int hex_value(const char ch)
+    {
+        if (ch >= '0' && ch <= '9')
+            return ch - '0';
+        if (ch >= 'a' && ch <= 'f')
+            return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F')
+            return ch - 'A' + 10;
+        return -1;
+    }
+
+    //! Appends the UTF-8 encoding of a code point.
+    void append_utf8(std::string &text, const unsigned code)
+    {
+        if (code < 0x80) {
+            text.push_back(static_cast<char>(code));
+        }
+        else if (code < 0x800) {
+            text.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else if (code < 0x10000) {
+            text.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else {
+            text.push_back(static_cast<char>(0xF0 | (code >> 18)));
+            text.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            text.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            text.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    // Stands for a character that could not be decoded.
+    const unsigned replacement_character = 0xFFFD;
+
+} // namespace
+
+/*===================================*/
+/*           JsonValue               */
+/*===================================*/
+
+const JsonValue &JsonValue::operator[](const std::size_t index) const
+{
+    return index < elements.size() ? elements[index] : null_value;
+}
+
+const JsonValue &JsonValue::operator[](const char *const key) const
+{
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key)
+            return elements[i];
+    }
+    return null_value;
+}
+
+bool JsonValue::has(const char *const key) const
+{
+    for (const std::string &name : keys) {
+        if (name == key)
+            return true;
+    }
+    return false;
+}
+
+/*===================================*/
+/*           JsonParser              */
+/*===================================*/
+
+JsonParser::JsonParser()
+{
+    reset();
+}
+
+//! Forgets everything read so far, preparing to read another value.
+void JsonParser::reset()
+{
+    expect = VALUE;
+    token = NONE;
+    key_token = false;
+    escape = false;
+    hex_digits = 0;
+    code_point = 0;
+    high_surrogate = 0;
+    text.clear();
+    open.clear();
+    key.clear();
+    result = JsonValue();
+    complete = false;
+    broken = false;
+}
+
+//! Reads more of the text.
+/*!
+ * \return The number of characters used. Reading stops after the end of a complete value (and
+ * at the first character that can't be part of a valid value).
+ */
+std::size_t JsonParser::feed(const char *const data, const std::size_t length)
+{
+    std::size_t used = 0;
+    while (used < length && !complete && !broken) {
+        if (take(data[used]))
+            ++used;
+    }
+    return used;
+}
+
+//! Reads one character. Returns false if it ended a token and must be read again.
+bool JsonParser::take(const char ch)
+{
+    if (token == STRING) {
+        if (hex_digits > 0) {
+            const int digit = hex_value(ch);
+            if (digit < 0) {
+                broken = true;
+                return true;
+            }
+            code_point = code_point * 16 + static_cast<unsigned>(digit);
+            if (--hex_digits == 0)
+                append_code_point(code_point);
+            return true;
+        }
+        if (escape) {
+            escape = false;
+            const char *const escapes = "\"\"\\\\//b\bf\fn\nr\rt\t";
+            const char *const found = std::strchr(escapes, ch);
+            if (ch == 'u') {
+                hex_digits = 4;
+                code_point = 0;
+            }
+            else if (ch != '\0' && found != nullptr && (found - escapes) % 2 == 0) {
+                append_code_point(static_cast<unsigned char>(found[1]));
+            }
+            else
+                broken = true;
+            return true;
+        }
+        if (ch == '\\') {
+            escape = true;
+            return true;
+        }
+        if (high_surrogate != 0) {
+            append_utf8(text, replacement_character);
+            high_surrogate = 0;
+        }
+        if (ch == '"') {
+            token = NONE;
+            if (key_token) {
+                key.back() = std::move(text);
+                expect = COLON;
+            }
+            else {
+                JsonValue value;
+                value.type = JsonValue::STRING;
+                value.text = std::move(text);
+                finish_value(std::move(value));
+            }
+            text.clear();
+            return true;
+        }
+        text.push_back(ch);
+        return true;
+    }
+
+    if (token == NUMBER || token == LITERAL) {
+        const bool more = (token == NUMBER)
+                              ? (std::isdigit(static_cast<unsigned char>(ch)) || ch == '+' ||
+                                 ch == '-' || ch == '.' || ch == 'e' || ch == 'E')
+                              : std::isalpha(static_cast<unsigned char>(ch)) != 0;
+        if (more) {
+            text.push_back(ch);
+            return true;
+        }
+        if (!finish_token())
+            broken = true;
+        return false;
+    }
+
+    if (ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r')
+        return true;
+
+    auto close = [this]() {
+        JsonValue container = std::move(open.back());
+        open.pop_back();
+        key.pop_back();
+        finish_value(std::move(container));
+    };
+
+    switch (expect) {
+    case FIRST_VALUE:
+        if (ch == ']') {
+            close();
+            return true;
+        }
+        // Fall through.
+    case VALUE:
+        if (ch == '{' || ch == '[') {
+            open.emplace_back();
+            open.back().type = (ch == '{') ? JsonValue::OBJECT : JsonValue::ARRAY;
+            key.emplace_back();
+            expect = (ch == '{') ? FIRST_KEY : FIRST_VALUE;
+        }
+        else if (ch == '"') {
+            token = STRING;
+            key_token = false;
+        }
+        else if (ch == '-' || std::isdigit(static_cast<unsigned char>(ch))) {
+            token = NUMBER;
+            text.push_back(ch);
+        }
+        else if (std::isalpha(static_cast<unsigned char>(ch))) {
+            token = LITERAL;
+            text.push_back(ch);
+        }
+        else
+            broken = true;
+        return true;
+
+    case FIRST_KEY:
+        if (ch == '}') {
+            close();
+            return true;
+        }
+        // Fall through.
+    case KEY:
+        if (ch == '"') {
+            token = STRING;
+            key_token = true;
+        }
+        else
+            broken = true;
+        return true;
+
+    case COLON:
+        if (ch == ':')
+            expect = VALUE;
+        else
+            broken = true;
+        return true;
+
+    case SEPARATOR: {
+        const bool in_object = open.back().type == JsonValue::OBJECT;
+        if (ch == ',')
+            expect = in_object ? KEY : VALUE;
+        else if (ch == (in_object ? '}' : ']'))
+            close();
+        else
+            broken = true;
+        return true;
+    }
+    }
+    return true;
+}
+
+//! Finishes reading a number or a literal. Returns false if it isn't valid.
+bool JsonParser::finish_token()
+{
+    JsonValue value;
+    if (token == NUMBER) {
+        char *end;
+        value.type = JsonValue::NUMBER;
+        value.amount = std::strtod(text.c_str(), &end);
+        if (end != text.c_str() + text.size())
+            return false;
+    }
+    else if (text == "true" || text == "false") {
+        value.type = JsonValue::BOOLEAN;
+        value.flag = text == "true";
+    }
+    else if (text != "null")
+        return false;
+
+    token = NONE;
+    text.clear();
+    finish_value(std::move(value));
+    return true;
+}
+
+//! Places a complete value in the array or object that holds it (or makes it the result).
+void JsonParser::finish_value(JsonValue &&value)
+{
+    if (open.empty()) {
+        result = std::move(value);
+        complete = true;
+        return;
+    }
+    JsonValue &container = open.back();
+    if (container.type == JsonValue::OBJECT)
+        container.keys.push_back(std::move(key.back()));
+    container.elements.push_back(std::move(value));
+    expect = SEPARATOR;
+}
+
+//! Appends a character given by an escape to the string being read, joining surrogate pairs.
+void JsonParser::append_code_point(unsigned code)
+{
+    if (code >= 0xD800 && code < 0xDC00) {
+        if (high_surrogate != 0)
+            append_utf8(text, replacement_character);
+        high_surrogate = code;
+        return;
+    }
+    if (code >= 0xDC00 && code < 0xE000) {
+        code = (high_surrogate != 0)
+                   ? 0x10000 + ((high_surrogate - 0xD800) << 10) + (code - 0xDC00)
+                   : replacement_character;
+    }
+    else if (high_surrogate != 0)
+        append_utf8(text, replacement_character);
+    high_surrogate = 0;
+    append_utf8(text, code);
+}
+
+/*===================================*/
+/*           Functions               */
+/*===================================*/
+
+void json_quote(std::string &output, const std::string_view text)
+{
+    output.push_back('"');
+    for (const char ch : text) {
+        switch (ch) {
+        case '"':
+            output.append("\\\"");
+            break;
+        case '\\':
+            output.append("\\\\");
+            break;
+        case '\n':
+            output.append("\\n");
+            break;
+        case '\r':
+            output.append("\\r");
+            break;
+        case '\t':
+            output.append("\\t");
+            break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                              static_cast<unsigned>(static_cast<unsigned char>(ch)));
+                output.append(escaped);
+            }
+            else
+                output.push_back(ch);
+            break;
+        }
+    }
+    output.push_back('"');
+}
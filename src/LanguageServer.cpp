@@ -0,0 +1,744 @@
+/*! \file    LanguageServer.cpp
+ *  \brief   Implementation of the LanguageServer abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#include "Diagnostics.hpp"
+#include "DiskEditFile.hpp"
+#include "EventLoop.hpp"
+#include "FileList.hpp"
+#include "Json.hpp"
+#include "LanguageServer.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
+#include "support.hpp"
+
+#define MAX_DOCUMENT_LINES 200000 // Larger files are not sent to language servers.
+#define WRITE_RETRY_INTERVAL 10   // Milliseconds between attempts to write to a full pipe.
+#define READ_SIZE (16 * 1024)     // Bytes read from a server at a time.
+
+#if eOPSYS == ePOSIX
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! How a server wants to be told of modifications (TextDocumentSyncKind).
+    enum SyncKind { SYNC_NONE = 0, SYNC_FULL = 1, SYNC_INCREMENTAL = 2 };
+
+    //! A language server process and the state of the conversation with it.
+    struct Server {
+        std::vector<std::string> extensions; //!< The files it serves, by extension.
+        std::string command;
+        pid_t process = -1;
+        int input_fd = -1;  //!< Writing end of the server's standard input (-1 if closed).
+        int output_fd = -1; //!< Reading end of the server's standard output (-1 if closed).
+        bool started = false;
+        bool ready = false;  //!< =true once the server has answered the initialize request.
+        bool failed = false; //!< =true if the server could not be started or has died.
+        bool utf8 = false;   //!< =true if positions count bytes rather than UTF-16 units.
+        SyncKind sync = SYNC_INCREMENTAL;
+        long next_id = 1;
+        long initialize_id = 0;
+
+        std::string outgoing;   //!< Messages not yet written.
+        unsigned write_timer = 0;
+        std::string header;     //!< The header of the message being read.
+        std::size_t body_left = 0; //!< Bytes of the message body still to come.
+        JsonParser parser;      //!< Parses the body as it arrives.
+    };
+
+    //! A file that has been opened with its server.
+    struct Document {
+        YEditFile *file;
+        Server *server;
+        std::string path; //!< The full path of the file.
+        long version; //!< The file's edit version when last sent (see EditDelta).
+    };
+
+    std::vector<std::unique_ptr<Server>> servers;
+    std::vector<Document> documents;
+
+    //! The language identifiers of the extensions servers are likely to know.
+    struct LanguageName {
+        const char *extension;
+        const char *language;
+    };
+
+    const LanguageName language_names[] = {
+        {".ada", "ada"},     {".adb", "ada"},       {".ads", "ada"},      {".c", "c"},
+        {".cc", "cpp"},      {".cpp", "cpp"},       {".cxx", "cpp"},      {".go", "go"},
+        {".h", "c"},         {".hh", "cpp"},        {".hpp", "cpp"},      {".hxx", "cpp"},
+        {".java", "java"},   {".js", "javascript"}, {".md", "markdown"},  {".py", "python"},
+        {".rs", "rust"},     {".scala", "scala"},   {".tex", "latex"},    {".ts", "typescript"},
+        {nullptr, nullptr}};
+
+    //! Returns the extension of a file name, including the dot (empty if there is none).
+    std::string extension_of(const char *const name)
+    {
+        const char *dot = nullptr;
+        for (const char *p = name; *p != '\0'; ++p) {
+            if (*p == '.')
+                dot = p;
+            else if (*p == '/' || *p == '\\')
+                dot = nullptr;
+        }
+        return dot == nullptr ? std::string() : std::string(dot);
+    }
+
+    const char *language_of(const char *const name)
+    {
+        const std::string extension = extension_of(name);
+        for (const LanguageName *entry = language_names; entry->extension != nullptr; ++entry) {
+            if (my_stricmp(entry->extension, extension.c_str()) == 0)
+                return entry->language;
+        }
+        return "plaintext";
+    }
+
+    //! Returns the server for a file, or nullptr if there is none.
+    Server *server_for(const char *const name)
+    {
+        const std::string extension = extension_of(name);
+        if (extension.empty())
+            return nullptr;
+        for (const std::unique_ptr<Server> &server : servers) {
+            for (const std::string &candidate : server->extensions) {
+                if (my_stricmp(candidate.c_str(), extension.c_str()) == 0)
+                    return server->failed ? nullptr : server.get();
+            }
+        }
+        return nullptr;
+    }
+
+    Document *document_for(const YEditFile *const file)
+    {
+        for (Document &document : documents) {
+            if (document.file == file)
+                return &document;
+        }
+        return nullptr;
+    }
+
+    //! Returns the full path of a file, which need not exist.
+    std::string full_path(const char *const name)
+    {
+        if (char *const resolved = realpath(name, nullptr)) {
+            std::string path(resolved);
+            std::free(resolved);
+            return path;
+        }
+        if (name[0] == '/')
+            return name;
+        char directory[4096];
+        if (getcwd(directory, sizeof(directory)) == nullptr)
+            return name;
+        return std::string(directory) + "/" + name;
+    }
+
+    //! Returns the URI of the file with the given full path.
+    std::string uri_of(const std::string &path)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        std::string uri("file://");
+        for (const char ch : path) {
+            const unsigned char byte = static_cast<unsigned char>(ch);
+            if (std::isalnum(byte) || std::strchr("/-._~", ch) != nullptr)
+                uri.push_back(ch);
+            else {
+                uri.push_back('%');
+                uri.push_back(hex[byte >> 4]);
+                uri.push_back(hex[byte & 0xF]);
+            }
+        }
+        return uri;
+    }
+
+    //! Returns the full path named by a file URI (empty if it isn't one).
+    std::string path_of(const std::string &uri)
+    {
+        if (uri.compare(0, 7, "file://") != 0)
+            return std::string();
+        std::string path;
+        for (std::size_t i = 7; i < uri.size(); ++i) {
+            if (uri[i] == '%' && i + 2 < uri.size()) {
+                path.push_back(static_cast<char>(std::strtol(uri.substr(i + 1, 2).c_str(),
+                                                             nullptr, 16)));
+                i += 2;
+            }
+            else
+                path.push_back(uri[i]);
+        }
+        return path;
+    }
+
+    //! Returns the offset of a character in a line given the server's count of its position.
+    std::size_t offset_of(const std::string_view text, const Server &server, long character)
+    {
+        if (character <= 0)
+            return 0;
+        if (server.utf8)
+            return std::min(text.size(), static_cast<std::size_t>(character));
+
+        // Characters outside the Basic Multilingual Plane (with four byte encodings) count as
+        // two UTF-16 units.
+        std::size_t offset = 0;
+        while (offset < text.size() && character > 0) {
+            const unsigned char lead = static_cast<unsigned char>(text[offset]);
+            character -= (lead >= 0xF0) ? 2 : 1;
+            do
+                ++offset;
+            while (offset < text.size() && (text[offset] & 0xC0) == 0x80);
+        }
+        return offset;
+    }
+
+    void stop(Server &server);
+
+    //! Writes as much of the queued output as the pipe will take.
+    void flush(Server &server)
+    {
+        // A server that exits must not kill the editor with SIGPIPE.
+        struct sigaction ignore;
+        struct sigaction previous;
+        std::memset(&ignore, 0, sizeof(ignore));
+        ignore.sa_handler = SIG_IGN;
+        sigaction(SIGPIPE, &ignore, &previous);
+
+        std::size_t written = 0;
+        bool broken = false;
+        while (written < server.outgoing.size()) {
+            const ssize_t count = write(server.input_fd, server.outgoing.data() + written,
+                                        server.outgoing.size() - written);
+            if (count > 0)
+                written += static_cast<std::size_t>(count);
+            else if (count == -1 && errno == EINTR)
+                continue;
+            else {
+                broken = !(count == -1 && errno == EAGAIN);
+                break;
+            }
+        }
+        sigaction(SIGPIPE, &previous, nullptr);
+        server.outgoing.erase(0, written);
+
+        if (broken) {
+            stop(server);
+            return;
+        }
+
+        // Try again later if the pipe is full. The server is reading, or it will be stopped.
+        Server *const waiting = &server;
+        if (!server.outgoing.empty() && server.write_timer == 0)
+            server.write_timer = EventLoop::add_timer(
+                WRITE_RETRY_INTERVAL, [waiting]() { flush(*waiting); }, true);
+        else if (server.outgoing.empty() && server.write_timer != 0) {
+            EventLoop::cancel_timer(server.write_timer);
+            server.write_timer = 0;
+        }
+    }
+
+    //! Sends a message whose body is given.
+    void send(Server &server, const std::string &body)
+    {
+        if (server.input_fd == -1)
+            return;
+        char header[64];
+        std::snprintf(header, sizeof(header), "Content-Length: %zu\r\n\r\n", body.size());
+        server.outgoing.append(header);
+        server.outgoing.append(body);
+        flush(server);
+    }
+
+    //! Sends a notification (a message that gets no response).
+    void notify(Server &server, const char *const method, const std::string &parameters)
+    {
+        std::string body("{\"jsonrpc\":\"2.0\",\"method\":");
+        json_quote(body, method);
+        body.append(",\"params\":").append(parameters).append("}");
+        send(server, body);
+    }
+
+    //! Sends a request. Returns its identifier.
+    long request(Server &server, const char *const method, const std::string &parameters)
+    {
+        const long id = server.next_id++;
+        std::string body("{\"jsonrpc\":\"2.0\",\"id\":");
+        body.append(std::to_string(id)).append(",\"method\":");
+        json_quote(body, method);
+        body.append(",\"params\":").append(parameters).append("}");
+        send(server, body);
+        return id;
+    }
+
+    //! Appends the identifier of a document (and optionally its version) to a message.
+    void append_document(std::string &text, const Document &document, const bool versioned)
+    {
+        text.append("\"textDocument\":{\"uri\":");
+        json_quote(text, uri_of(document.path));
+        if (versioned)
+            text.append(",\"version\":").append(std::to_string(document.version));
+    }
+
+    //! Appends the text of lines, each with a newline, to a message as a quoted string.
+    void append_lines(std::string &text, YEditFile &file, const long first, const long count)
+    {
+        std::string lines;
+        for (long line = first; line < first + count; ++line) {
+            const EditBuffer *const buffer = file.line_at(line);
+            if (buffer != nullptr)
+                lines.append(buffer->view());
+            lines.push_back('\n');
+        }
+        json_quote(text, lines);
+    }
+
+    //! Sends the whole text of a file to its server.
+    void open_document(Document &document)
+    {
+        YEditFile &file = *document.file;
+        document.version = static_cast<long>(file.take_server_edits().version);
+
+        std::string parameters("{");
+        append_document(parameters, document, false);
+        parameters.append(",\"languageId\":");
+        json_quote(parameters, language_of(file.name()));
+        parameters.append(",\"version\":").append(std::to_string(document.version));
+        parameters.append(",\"text\":");
+        append_lines(parameters, file, 0, file.line_count());
+        parameters.append("}}");
+        notify(*document.server, "textDocument/didOpen", parameters);
+    }
+
+    //! Sends the lines modified since the last report, if any, as one change.
+    void send_changes(Document &document)
+    {
+        YEditFile &file = *document.file;
+        const EditDelta change = file.take_server_edits();
+        if (change.empty())
+            return;
+        file.move_diagnostics(change.first, change.old_count, change.new_count);
+        document.version = static_cast<long>(change.version);
+
+        std::string parameters("{");
+        append_document(parameters, document, true);
+        parameters.append("},\"contentChanges\":[{");
+        if (document.server->sync == SYNC_INCREMENTAL) {
+            parameters.append("\"range\":{\"start\":{\"line\":")
+                .append(std::to_string(change.first))
+                .append(",\"character\":0},\"end\":{\"line\":")
+                .append(std::to_string(change.first + change.old_count))
+                .append(",\"character\":0}},\"text\":");
+            append_lines(parameters, file, change.first, change.new_count);
+        }
+        else {
+            parameters.append("\"text\":");
+            append_lines(parameters, file, 0, file.line_count());
+        }
+        parameters.append("}]}");
+        notify(*document.server, "textDocument/didChange", parameters);
+    }
+
+    //! Replaces the problems shown in a file with those in a publishDiagnostics notification.
+    void take_diagnostics(const Server &server, const JsonValue &parameters)
+    {
+        const std::string path = path_of(parameters["uri"].string());
+        Document *document = nullptr;
+        for (Document &candidate : documents) {
+            if (candidate.path == path && candidate.server == &server)
+                document = &candidate;
+        }
+        if (document == nullptr)
+            return;
+
+        // Diagnostics of an older version will soon be replaced by those of the current one.
+        const JsonValue &version = parameters["version"];
+        if (version.is_number() && static_cast<long>(version.number()) != document->version)
+            return;
+
+        YEditFile &file = *document->file;
+        const long last_line = file.line_count() - 1;
+        auto position = [&](const JsonValue &where, long &line, std::size_t &offset) {
+            line = std::min(static_cast<long>(where["line"].number()), last_line);
+            const EditBuffer *const buffer = file.line_at(line);
+            const std::string_view text = (buffer != nullptr) ? buffer->view() : "";
+            offset = offset_of(text, server, static_cast<long>(where["character"].number()));
+        };
+
+        Diagnostics reported;
+        const JsonValue &list = parameters["diagnostics"];
+        for (std::size_t i = 0; i < list.size() && last_line >= 0; ++i) {
+            const JsonValue &item = list[i];
+            long first, last;
+            std::size_t start, end;
+            position(item["range"]["start"], first, start);
+            position(item["range"]["end"], last, end);
+            int severity = static_cast<int>(item["severity"].number(Diagnostics::ERROR));
+            severity = std::min(std::max(severity, 1), static_cast<int>(Diagnostics::HINT));
+            reported.add(first, start, last, end, static_cast<Diagnostics::Severity>(severity),
+                         item["message"].string());
+        }
+        reported.finish();
+        file.set_diagnostics(std::move(reported));
+        if (WindowList::shows(&file))
+            WindowList::display();
+    }
+
+    //! Acts on a complete message from a server.
+    void handle(Server &server, const JsonValue &message)
+    {
+        const JsonValue &id = message["id"];
+        const JsonValue &method = message["method"];
+
+        // A response to one of our requests.
+        if (!id.is_null() && !method.is_string()) {
+            if (static_cast<long>(id.number(-1)) != server.initialize_id || server.ready)
+                return;
+            const JsonValue &capabilities = message["result"]["capabilities"];
+            server.utf8 = capabilities["positionEncoding"].string() == "utf-8";
+            const JsonValue &sync = capabilities["textDocumentSync"];
+            const double kind = sync.is_object() ? sync["change"].number(SYNC_NONE)
+                                                 : sync.number(SYNC_NONE);
+            server.sync = static_cast<SyncKind>(static_cast<int>(kind));
+            server.ready = true;
+            notify(server, "initialized", "{}");
+            return;
+        }
+
+        // A request from the server. None are supported, but each must be answered.
+        if (!id.is_null()) {
+            std::string body("{\"jsonrpc\":\"2.0\",\"id\":");
+            if (id.is_string())
+                json_quote(body, id.string());
+            else
+                body.append(std::to_string(static_cast<long>(id.number())));
+            if (method.string() == "workspace/configuration") {
+                body.append(",\"result\":[");
+                for (std::size_t i = 0; i < message["params"]["items"].size(); ++i)
+                    body.append(i == 0 ? "null" : ",null");
+                body.append("]}");
+            }
+            else
+                body.append(",\"result\":null}");
+            send(server, body);
+            return;
+        }
+
+        if (method.string() == "textDocument/publishDiagnostics")
+            take_diagnostics(server, message["params"]);
+    }
+
+    //! Takes bytes read from a server, acting on each message as its body is completed.
+    void receive(Server &server, const char *data, std::size_t length)
+    {
+        while (length > 0 && !server.failed) {
+            if (server.body_left == 0) {
+                // The header ends with an empty line. Only the length in it matters.
+                server.header.push_back(*data++);
+                --length;
+                const std::size_t end = server.header.size();
+                if (end < 4 || server.header.compare(end - 4, 4, "\r\n\r\n") != 0)
+                    continue;
+                for (char &ch : server.header)
+                    ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+                const char *const field = "content-length:";
+                const std::size_t found = server.header.find(field);
+                if (found != std::string::npos)
+                    server.body_left = std::strtoul(
+                        server.header.c_str() + found + std::strlen(field), nullptr, 10);
+                server.header.clear();
+                server.parser.reset();
+                continue;
+            }
+
+            const std::size_t part = std::min(length, server.body_left);
+            server.parser.feed(data, part);
+            data += part;
+            length -= part;
+            server.body_left -= part;
+            if (server.body_left == 0 && server.parser.done())
+                handle(server, server.parser.value());
+        }
+    }
+
+    //! Reads what a server has written. A server that closes its output is stopped.
+    void read_from(Server &server)
+    {
+        char buffer[READ_SIZE];
+        for (;;) {
+            const ssize_t count = read(server.output_fd, buffer, sizeof(buffer));
+            if (count > 0) {
+                receive(server, buffer, static_cast<std::size_t>(count));
+                if (server.failed)
+                    return;
+            }
+            else if (count == -1 && errno == EINTR)
+                continue;
+            else {
+                if (!(count == -1 && errno == EAGAIN))
+                    stop(server);
+                return;
+            }
+        }
+    }
+
+    //! Starts a server and asks it to initialize. Returns false if it couldn't be started.
+    bool start(Server &server)
+    {
+        server.started = true;
+        int to_server[2];
+        int from_server[2];
+        if (pipe(to_server) == -1)
+            return false;
+        if (pipe(from_server) == -1) {
+            close(to_server[0]);
+            close(to_server[1]);
+            return false;
+        }
+        for (const int end : {to_server[0], to_server[1], from_server[0], from_server[1]})
+            fcntl(end, F_SETFD, FD_CLOEXEC);
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, to_server[0], 0);
+        posix_spawn_file_actions_adddup2(&actions, from_server[1], 1);
+        posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+
+        std::string command = "exec " + server.command;
+        char shell[] = "/bin/sh";
+        char option[] = "-c";
+        char *const arguments[] = {shell, option, &command[0], nullptr};
+        pid_t child;
+        const int spawn_error =
+            posix_spawn(&child, shell, &actions, nullptr, arguments, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(to_server[0]);
+        close(from_server[1]);
+        if (spawn_error != 0) {
+            close(to_server[1]);
+            close(from_server[0]);
+            return false;
+        }
+
+        server.process = child;
+        server.input_fd = to_server[1];
+        server.output_fd = from_server[0];
+        fcntl(server.input_fd, F_SETFL, fcntl(server.input_fd, F_GETFL) | O_NONBLOCK);
+        fcntl(server.output_fd, F_SETFL, fcntl(server.output_fd, F_GETFL) | O_NONBLOCK);
+        Server *const reading = &server;
+        EventLoop::add_source(server.output_fd, [reading]() { read_from(*reading); });
+
+        const std::string root = full_path(".");
+        std::string parameters("{\"processId\":");
+        parameters.append(std::to_string(static_cast<long>(getpid())));
+        parameters.append(",\"clientInfo\":{\"name\":\"yexa\"},\"rootUri\":");
+        json_quote(parameters, uri_of(root));
+        parameters.append(",\"capabilities\":{"
+                          "\"general\":{\"positionEncodings\":[\"utf-8\",\"utf-16\"]},"
+                          "\"textDocument\":{\"synchronization\":{\"didSave\":false},"
+                          "\"publishDiagnostics\":{\"versionSupport\":true}}}}");
+        server.initialize_id = request(server, "initialize", parameters);
+        return true;
+    }
+
+    //! Stops a server and forgets the documents opened with it. It is not started again.
+    void stop(Server &server)
+    {
+        if (server.output_fd != -1) {
+            EventLoop::remove_source(server.output_fd);
+            close(server.output_fd);
+            server.output_fd = -1;
+        }
+        if (server.input_fd != -1) {
+            close(server.input_fd);
+            server.input_fd = -1;
+        }
+        if (server.write_timer != 0) {
+            EventLoop::cancel_timer(server.write_timer);
+            server.write_timer = 0;
+        }
+        if (server.process != -1) {
+            int status;
+            if (waitpid(server.process, &status, WNOHANG) == 0) {
+                kill(server.process, SIGKILL);
+                waitpid(server.process, &status, 0);
+            }
+            server.process = -1;
+        }
+        server.outgoing.clear();
+        server.failed = true;
+        server.ready = false;
+
+        for (auto document = documents.begin(); document != documents.end();) {
+            if (document->server != &server) {
+                ++document;
+                continue;
+            }
+            YEditFile *const file = document->file;
+            file->set_diagnostics(Diagnostics());
+            document = documents.erase(document);
+            if (WindowList::shows(file))
+                WindowList::display();
+        }
+    }
+
+    //! Tells the servers that are running that the editor is exiting.
+    void stop_all()
+    {
+        for (const std::unique_ptr<Server> &server : servers) {
+            if (server->input_fd != -1 && server->ready) {
+                notify(*server, "exit", "null");
+                close(server->input_fd);
+                server->input_fd = -1;
+            }
+            if (server->process != -1)
+                kill(server->process, SIGTERM);
+        }
+    }
+
+    //! Opens the files shown in windows with their servers and reports modifications.
+    /*!
+     * This is an idle task (see EventLoop::add_idle). It does everything at once since only
+     * the lines modified are examined.
+     */
+    bool synchronize()
+    {
+        if (DiskEditFile::background_loads() != 0)
+            return false;
+        for (unsigned i = 0; i < FileList::count(); ++i) {
+            YEditFile *const file = FileList::file(i);
+            Document *const document = document_for(file);
+            if (document != nullptr) {
+                if (document->server->ready && document->server->sync != SYNC_NONE)
+                    send_changes(*document);
+                continue;
+            }
+
+            Server *const server = server_for(file->name());
+            if (server == nullptr || !WindowList::shows(file) ||
+                file->line_count() > MAX_DOCUMENT_LINES)
+                continue;
+            if (!server->started && !start(*server)) {
+                server->failed = true;
+                continue;
+            }
+            if (!server->ready)
+                continue;
+            documents.push_back(Document{file, server, full_path(file->name()), 0});
+            open_document(documents.back());
+        }
+        return false;
+    }
+
+} // namespace
+
+#endif
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace LanguageServer {
+
+#if eOPSYS == ePOSIX
+
+    bool configure(const std::string &extensions, const std::string &command)
+    {
+        static const bool initialized =
+            (EventLoop::add_idle(synchronize), std::atexit(stop_all), true);
+        (void)initialized;
+
+        std::vector<std::string> claimed;
+        std::size_t start = 0;
+        while ((start = extensions.find_first_not_of(" \t,", start)) != std::string::npos) {
+            const std::size_t end = extensions.find_first_of(" \t,", start);
+            claimed.push_back(extensions.substr(start, end - start));
+            start = end;
+        }
+
+        // A server that no longer has any extensions is stopped.
+        for (auto server = servers.begin(); server != servers.end();) {
+            std::vector<std::string> &kept = (*server)->extensions;
+            kept.erase(std::remove_if(kept.begin(), kept.end(),
+                                      [&](const std::string &extension) {
+                                          for (const std::string &taken : claimed) {
+                                              if (my_stricmp(taken.c_str(),
+                                                             extension.c_str()) == 0)
+                                                  return true;
+                                          }
+                                          return false;
+                                      }),
+                       kept.end());
+            if (kept.empty()) {
+                stop(**server);
+                server = servers.erase(server);
+            }
+            else
+                ++server;
+        }
+
+        if (!command.empty() && !claimed.empty()) {
+            servers.emplace_back(new Server);
+            servers.back()->extensions = std::move(claimed);
+            servers.back()->command = command;
+        }
+        return true;
+    }
+
+    void forget(YEditFile &file)
+    {
+        for (auto document = documents.begin(); document != documents.end(); ++document) {
+            if (document->file != &file)
+                continue;
+            if (document->server->ready) {
+                std::string parameters("{");
+                append_document(parameters, *document, false);
+                parameters.append("}}");
+                notify(*document->server, "textDocument/didClose", parameters);
+            }
+            documents.erase(document);
+            return;
+        }
+    }
+
+#else
+
+    bool configure(const std::string &, const std::string &)
+    {
+        return false;
+    }
+
+    void forget(YEditFile &)
+    {
+    }
+
+#endif
+
+} // namespace LanguageServer
@@ -0,0 +1,222 @@
+/*! \file    LineDiff.cpp
+ *  \brief   Implementation of the LineDiff functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+
+#include "LineDiff.hpp"
+
+using LineDiff::Hunk;
+
+namespace {
+
+    // The search for a middle snake grows with the square of the number of differences between
+    // the ranges. It gives up after this many, leaving the ranges to be replaced wholesale.
+    constexpr long difference_limit = 4096;
+
+    //! Finds the differences between ranges of two sequences of line hashes.
+    /*!
+     * This is the linear space refinement of Myers' algorithm: the middle of an optimal path
+     * is found by searching forward from the start and backward from the end at once, and the
+     * two halves on either side of it are then compared recursively.
+     */
+    class Comparison {
+      public:
+        Comparison(const std::vector<std::size_t> &old_lines,
+                   const std::vector<std::size_t> &new_lines)
+            : a(old_lines), b(new_lines)
+        {
+        }
+
+        void compare(long a_low, long a_high, long b_low, long b_high);
+        std::vector<Hunk> hunks;
+
+      private:
+        const std::vector<std::size_t> &a; //!< The old lines.
+        const std::vector<std::size_t> &b; //!< The new lines.
+        std::vector<long> forward;         //!< Furthest x reached on each forward diagonal.
+        std::vector<long> backward;        //!< Furthest x reached on each backward diagonal.
+
+        void add_hunk(long a_first, long a_count, long b_first, long b_count);
+        bool middle_snake(long a_low, long a_high, long b_low, long b_high, long &a_split_low,
+                          long &b_split_low, long &a_split_high, long &b_split_high);
+    };
+
+    //! Adds a hunk, joining it to the previous one if they touch.
+    void Comparison::add_hunk(const long a_first, const long a_count, const long b_first,
+                              const long b_count)
+    {
+        if (!hunks.empty()) {
+            Hunk &last = hunks.back();
+            if (last.old_first + last.old_count == a_first &&
+                last.new_first + last.new_count == b_first) {
+                last.old_count += a_count;
+                last.new_count += b_count;
+                return;
+            }
+        }
+        hunks.push_back(Hunk{a_first, a_count, b_first, b_count});
+    }
+
+    //! Compares a[a_low, a_high) with b[b_low, b_high), adding hunks in order.
+    void Comparison::compare(long a_low, long a_high, long b_low, long b_high)
+    {
+        // Lines common to the start and end of both ranges can't be part of any hunk.
+        while (a_low < a_high && b_low < b_high && a[a_low] == b[b_low]) {
+            ++a_low;
+            ++b_low;
+        }
+        while (a_low < a_high && b_low < b_high && a[a_high - 1] == b[b_high - 1]) {
+            --a_high;
+            --b_high;
+        }
+
+        if (a_low == a_high || b_low == b_high) {
+            if (a_low != a_high || b_low != b_high)
+                add_hunk(a_low, a_high - a_low, b_low, b_high - b_low);
+            return;
+        }
+
+        long a_split_low, b_split_low, a_split_high, b_split_high;
+        if (!middle_snake(a_low, a_high, b_low, b_high, a_split_low, b_split_low, a_split_high,
+                          b_split_high)) {
+            add_hunk(a_low, a_high - a_low, b_low, b_high - b_low);
+            return;
+        }
+        compare(a_low, a_split_low, b_low, b_split_low);
+        compare(a_split_high, a_high, b_split_high, b_high);
+    }
+
+    //! Locates the middle snake of an optimal path through the given ranges.
+    /*!
+     * The ranges must be non-empty and must differ at both ends. The lines in
+     * [a_split_low, a_split_high) then equal those in [b_split_low, b_split_high) and the
+     * parts before and after the snake can be compared separately.
+     *
+     * \return false if the ranges are too different to be worth comparing exactly.
+     */
+    bool Comparison::middle_snake(const long a_low, const long a_high, const long b_low,
+                                  const long b_high, long &a_split_low, long &b_split_low,
+                                  long &a_split_high, long &b_split_high)
+    {
+        const long n = a_high - a_low;
+        const long m = b_high - b_low;
+        const long delta = n - m;
+        const bool odd = (delta & 1) != 0;
+        const long maximum = (n + m + 1) / 2;
+
+
+        // Diagonal k (x - y) is stored at k + origin (-1 if it hasn't been reached). Backward
+        // diagonals are numbered in the reversed ranges, where x counts lines from the ends.
+        const long origin = std::min(maximum, difference_limit) + 1;
+        forward.assign(static_cast<std::size_t>(2 * origin + 1), -1);
+        backward.assign(static_cast<std::size_t>(2 * origin + 1), -1);
+        forward[origin + 1] = 0;
+        backward[origin + 1] = 0;
+
+        // Diagonals that have left the grid are trimmed from both ends of the search.
+        long forward_start = 0, forward_end = 0, backward_start = 0, backward_end = 0;
+
+        for (long d = 0; d <= maximum && d <= difference_limit; ++d) {
+            for (long k = -d + forward_start; k <= d - forward_end; k += 2) {
+                long x;
+                if (k == -d || (k != d && forward[origin + k - 1] < forward[origin + k + 1]))
+                    x = forward[origin + k + 1];
+                else
+                    x = forward[origin + k - 1] + 1;
+                long y = x - k;
+                const long x_start = x;
+                const long y_start = y;
+                while (x < n && y < m && a[a_low + x] == b[b_low + y]) {
+                    ++x;
+                    ++y;
+                }
+                forward[origin + k] = x;
+
+                if (x > n)
+                    forward_end += 2;
+                else if (y > m)
+                    forward_start += 2;
+                else if (odd) {
+                    const long reversed = origin + delta - k;
+                    if (reversed >= 0 && reversed <= 2 * origin && backward[reversed] != -1 &&
+                        x + backward[reversed] >= n) {
+                        a_split_low = a_low + x_start;
+                        b_split_low = b_low + y_start;
+                        a_split_high = a_low + x;
+                        b_split_high = b_low + y;
+                        return true;
+                    }
+                }
+            }
+
+            for (long k = -d + backward_start; k <= d - backward_end; k += 2) {
+                long x;
+                if (k == -d || (k != d && backward[origin + k - 1] < backward[origin + k + 1]))
+                    x = backward[origin + k + 1];
+                else
+                    x = backward[origin + k - 1] + 1;
+                long y = x - k;
+                const long x_start = x;
+                const long y_start = y;
+                while (x < n && y < m && a[a_high - 1 - x] == b[b_high - 1 - y]) {
+                    ++x;
+                    ++y;
+                }
+                backward[origin + k] = x;
+
+                if (x > n)
+                    backward_end += 2;
+                else if (y > m)
+                    backward_start += 2;
+                else if (!odd) {
+                    const long original = origin + delta - k;
+                    if (original >= 0 && original <= 2 * origin && forward[original] != -1 &&
+                        x + forward[original] >= n) {
+                        a_split_low = a_high - x;
+                        b_split_low = b_high - y;
+                        a_split_high = a_high - x_start;
+                        b_split_high = b_high - y_start;
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+} // namespace
+
+namespace LineDiff {
+
+    std::vector<Hunk> compare(const std::vector<std::size_t> &old_lines,
+                              const std::vector<std::size_t> &new_lines)
+    {
+        Comparison comparison(old_lines, new_lines);
+        comparison.compare(0, static_cast<long>(old_lines.size()), 0,
+                           static_cast<long>(new_lines.size()));
+        return std::move(comparison.hunks);
+    }
+
+    long follow(const std::vector<Hunk> &hunks, const long line, const bool forward)
+    {
+        // The hunks are in order in both versions, so the last starting at or before the line
+        // is found by a binary search.
+        const auto after = std::upper_bound(
+            hunks.begin(), hunks.end(), line, [forward](const long wanted, const Hunk &hunk) {
+                return wanted < (forward ? hunk.old_first : hunk.new_first);
+            });
+        if (after == hunks.begin())
+            return line;
+        const Hunk &hunk = *(after - 1);
+        const long from_first = forward ? hunk.old_first : hunk.new_first;
+        const long from_count = forward ? hunk.old_count : hunk.new_count;
+        const long to_first = forward ? hunk.new_first : hunk.old_first;
+        const long to_count = forward ? hunk.new_count : hunk.old_count;
+        if (line < from_first + from_count)
+            return to_first + std::min(line - from_first, std::max(to_count - 1, 0L));
+        return line - (from_first + from_count) + (to_first + to_count);
+    }
+
+} // namespace LineDiff
@@ -4,6 +4,8 @@
  */
 
 #include <cstring>
+#include <new>
+#include <string_view>
 
 #include "EditBuffer.hpp"
 #include "LineEditFile.hpp"
@@ -30,7 +32,7 @@ unsigned LineEditFile::CP_line_length()
     current_line = file_data.get();
     if (current_line == nullptr)
         return 0;
-    return current_line->length();
+    return static_cast<unsigned>(current_line->columns(tab_stop));
 }
 
 /*!
@@ -42,10 +44,12 @@ bool LineEditFile::insert_line(const EditBuffer *new_line)
     // Extend file data if necessary.
     if (!extend_to_line(current_point.cursor_line()))
         return false;
+    record_lines(current_point.cursor_line(), 0L);
     file_data.jump_to(current_point.cursor_line());
 
     // Make changes.
     is_changed = true;
+    mark_damaged_from(current_point.cursor_line());
     EditBuffer *new_stuff = new EditBuffer(*new_line);
     if (file_data.insert(new_stuff) == nullptr) {
         memory_message("Can't insert line into file");
@@ -63,10 +67,12 @@ bool LineEditFile::replace_line(const EditBuffer *new_line)
     // Extend file data if necessary.
     if (!extend_to_line(current_point.cursor_line()))
         return false;
+    record_lines(current_point.cursor_line(), 1L);
     file_data.jump_to(current_point.cursor_line());
 
     // Make changes.
     is_changed = true;
+    mark_damaged(current_point.cursor_line(), current_point.cursor_line());
     delete file_data.get();
     file_data.erase();
 
@@ -87,9 +93,12 @@ void LineEditFile::delete_line()
     // Do nothing if the cursor is off the end of the file.
     if (file_data.get() == NULL)
         return;
+    record_lines(current_point.cursor_line(), 1L);
+    file_data.jump_to(current_point.cursor_line());
 
     // Make changes.
     is_changed = true;
+    mark_damaged_from(current_point.cursor_line());
     delete file_data.get();
     file_data.erase();
 }
@@ -113,11 +122,70 @@ void LineEditFile::delete_to_EOL()
             break;
 
         // Delete all the characters on this line to the end.
-        while (file_data.get()->length() > current_point.cursor_column()) {
+        EditBuffer *const line = file_data.get();
+        const std::size_t offset = line->offset_of(current_point.cursor_column(), tab_stop);
+        const std::string_view old_text = line->view();
+        if (old_text.size() > offset) {
+            record_text(top - 1, offset, old_text.size(), old_text.substr(offset), "");
             is_changed = true;
-            file_data.get()->erase(current_point.cursor_column());
+            mark_damaged(top - 1, top - 1);
+            line->trim(offset);
         }
 
         file_data.next();
     }
 }
+
+//! Returns the text of the given line without extending the file.
+/*!
+ * Lines are usually visited in order, which the EditList makes cheap. The pointer is valid
+ * until the file is next modified.
+ */
+const EditBuffer *LineEditFile::line_at(const long line)
+{
+    if (line < 0 || line >= file_data.size())
+        return nullptr;
+    file_data.jump_to(line);
+    return file_data.get();
+}
+
+/*!
+ * The lines removed are recorded for undo as a single operation, however many there are. If
+ * first is past the end of the file, the file is extended to it. Lines past the end of the
+ * file are not removed (they don't exist) so count may be larger than necessary.
+ */
+bool LineEditFile::replace_lines(const long first, long count,
+                                 const std::vector<std::string> &new_lines)
+{
+    if (first < 0 || count < 0)
+        return false;
+    if (!extend_to_line(first - 1))
+        return false;
+    if (count > file_data.size() - first)
+        count = file_data.size() - first;
+    if (count == 0 && new_lines.empty())
+        return true;
+
+    try {
+        record_lines(first, count);
+        is_changed = true;
+        if (count == static_cast<long>(new_lines.size()))
+            mark_damaged(first, first + count - 1);
+        else
+            mark_damaged_from(first);
+
+        file_data.jump_to(first);
+        for (long i = 0; i < count; ++i) {
+            delete file_data.get();
+            file_data.erase();
+        }
+        for (const std::string &text : new_lines) {
+            file_data.insert(new EditBuffer(text.data(), text.size()));
+        }
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't replace lines in the file");
+        return false;
+    }
+    return true;
+}
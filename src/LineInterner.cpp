@@ -0,0 +1,32 @@
+/*! \file    LineInterner.cpp
+ *  \brief   Implementation of class LineInterner
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <memory>
+
+#include "LineDiff.hpp"
+#include "LineInterner.hpp"
+
+//! Makes a new EditBuffer holding text, sharing the text of an identical earlier line.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+EditBuffer *LineInterner::make(const std::string_view text)
+{
+    const std::size_t hash = LineDiff::hash(text);
+    const auto range = remembered.equal_range(hash);
+    for (auto entry = range.first; entry != range.second; ++entry) {
+        if (entry->second.view() == text) {
+            EditBuffer *const line = new EditBuffer(entry->second);
+            ++savings.lines;
+            savings.bytes += entry->second.storage();
+            return line;
+        }
+    }
+
+    std::unique_ptr<EditBuffer> line(new EditBuffer(text.data(), text.size()));
+    if (line->storage() != 0 && remembered.size() < max_remembered)
+        remembered.emplace(hash, *line);
+    return line.release();
+}
@@ -0,0 +1,209 @@
+/*! \file    LineSort.cpp
+ *  \brief   Implementation of the LineSort functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "EditBuffer.hpp"
+#include "FieldIndex.hpp"
+#include "LineSort.hpp"
+#include "TaskPool.hpp"
+
+#define MINIMUM_SHARE 16384 // The fewest lines worth sorting on a thread of their own.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! A line being sorted.
+    struct Handle {
+        std::string_view key; //!< From the key column to the end of the line, or the key field.
+        double number;        //!< The number the key starts with, if sorting numerically.
+        std::size_t index;    //!< The line's position in the list being arranged.
+    };
+
+    //! Returns true if left comes before right.
+    bool less(const Handle &left, const Handle &right, const LineSort::Options &options)
+    {
+        if (options.numeric)
+            return left.number < right.number;
+        if (options.ignore_case)
+            return LineSort::compare_folded(left.key, right.key) < 0;
+        return left.key < right.key;
+    }
+
+    //! Returns the number a key starts with (after any blanks), or zero if it doesn't.
+    double number_of(std::string_view key)
+    {
+        while (!key.empty() && (key.front() == ' ' || key.front() == '\t'))
+            key.remove_prefix(1);
+        char buffer[64];
+        const std::size_t length = std::min(key.size(), sizeof(buffer) - 1);
+        std::memcpy(buffer, key.data(), length);
+        buffer[length] = '\0';
+        return std::strtod(buffer, nullptr);
+    }
+
+    //! Runs task(0) through task(count - 1) at once on the worker threads (see TaskPool).
+    //! This thread does task(0) and then any that no worker has started.
+    template <typename Task> void in_parallel(const std::size_t count, const Task &task)
+    {
+        TaskPool::Group group;
+        for (std::size_t i = 1; i < count; ++i) {
+            group.run([&task, i]() { task(i); });
+        }
+        task(0);
+        group.wait();
+    }
+
+    //! Sorts the handles stably, dividing the work among threads.
+    /*!
+     * Each thread sorts one run. Pairs of adjacent runs are then merged, the pairs at once,
+     * into the other of two buffers until a single run remains.
+     */
+    void parallel_sort(std::vector<Handle> &handles, const LineSort::Options &options)
+    {
+        const auto order = [&options](const Handle &left, const Handle &right) {
+            return less(left, right, options);
+        };
+        const std::size_t hardware = TaskPool::size();
+        std::size_t runs = std::min(hardware, handles.size() / MINIMUM_SHARE);
+        if (runs <= 1) {
+            std::stable_sort(handles.begin(), handles.end(), order);
+            return;
+        }
+
+        // The runs are split as evenly as possible. Run i is [bounds[i], bounds[i + 1]).
+        std::vector<std::size_t> bounds;
+        for (std::size_t i = 0; i <= runs; ++i) {
+            bounds.push_back(handles.size() * i / runs);
+        }
+        in_parallel(runs, [&](const std::size_t i) {
+            std::stable_sort(handles.begin() + bounds[i], handles.begin() + bounds[i + 1],
+                             order);
+        });
+
+        std::vector<Handle> other(handles.size());
+        std::vector<Handle> *source = &handles;
+        std::vector<Handle> *destination = &other;
+        while (runs > 1) {
+            const std::size_t pairs = (runs + 1) / 2;
+            in_parallel(pairs, [&](const std::size_t i) {
+                const auto from = source->begin();
+                const std::size_t first = bounds[2 * i];
+                const std::size_t middle = bounds[std::min(2 * i + 1, runs)];
+                const std::size_t last = bounds[std::min(2 * i + 2, runs)];
+                std::merge(from + first, from + middle, from + middle, from + last,
+                           destination->begin() + first, order);
+            });
+            for (std::size_t i = 0; i < pairs; ++i) {
+                bounds[i] = bounds[2 * i];
+            }
+            bounds[pairs] = bounds[runs];
+            bounds.resize(pairs + 1);
+            runs = pairs;
+            std::swap(source, destination);
+        }
+        if (source != &handles)
+            handles.swap(other);
+    }
+
+    //! Returns x with each ASCII lower case letter in it made upper case.
+    std::uint64_t fold_word(const std::uint64_t x)
+    {
+        const std::uint64_t ones = 0x0101010101010101ULL;
+        const std::uint64_t high = 0x8080808080808080ULL;
+        const std::uint64_t low_bits = x & ~high;
+
+        // The high bit of a byte is set by these sums if the byte is above 'z' or at least 'a'.
+        const std::uint64_t above_z = low_bits + (0x7F - 'z') * ones;
+        const std::uint64_t from_a = low_bits + (0x80 - 'a') * ones;
+        const std::uint64_t lower = (from_a & ~above_z) & ~x & high;
+        return x & ~(lower >> 2);
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace LineSort {
+
+    /*!
+     * Only ASCII letters are folded, as std::toupper does in the "C" locale. Blocks of eight
+     * bytes that are equal after folding are skipped without looking at each byte.
+     */
+    int compare_folded(const std::string_view left, const std::string_view right)
+    {
+        const std::size_t length = std::min(left.size(), right.size());
+        std::size_t i = 0;
+        for (; i + 8 <= length; i += 8) {
+            std::uint64_t x, y;
+            std::memcpy(&x, left.data() + i, 8);
+            std::memcpy(&y, right.data() + i, 8);
+            if (x != y && fold_word(x) != fold_word(y))
+                break;
+        }
+        for (; i < length; ++i) {
+            const unsigned char x = static_cast<unsigned char>(left[i]);
+            const unsigned char y = static_cast<unsigned char>(right[i]);
+            const int folded_x = (x < 0x80) ? std::toupper(x) : x;
+            const int folded_y = (y < 0x80) ? std::toupper(y) : y;
+            if (folded_x != folded_y)
+                return (folded_x < folded_y) ? -1 : 1;
+        }
+        if (left.size() == right.size())
+            return 0;
+        return (left.size() < right.size()) ? -1 : 1;
+    }
+
+    void arrange(std::vector<std::unique_ptr<EditBuffer>> &lines, const Options &options)
+    {
+        std::vector<Handle> handles;
+        handles.reserve(lines.size());
+        for (std::size_t i = 0; i < lines.size(); ++i) {
+            const std::string_view text = lines[i]->view();
+            std::string_view key;
+            if (options.delimiter != '\0')
+                key = FieldIndex::field(text, options.delimiter, options.field);
+            else {
+                std::size_t offset = 0;
+                if (options.column != 0)
+                    offset = lines[i]->offset_of(options.column, options.tab);
+                key = text.substr(std::min(offset, text.size()));
+            }
+            handles.push_back(Handle{key, options.numeric ? number_of(key) : 0.0, i});
+        }
+
+        if (options.sort)
+            parallel_sort(handles, options);
+        if (options.unique) {
+            const auto same = [&options](const Handle &left, const Handle &right) {
+                return !less(left, right, options) && !less(right, left, options);
+            };
+            handles.erase(std::unique(handles.begin(), handles.end(), same), handles.end());
+        }
+        if (options.reverse)
+            std::reverse(handles.begin(), handles.end());
+
+        // The lines are moved only once nothing else can fail.
+        std::vector<std::unique_ptr<EditBuffer>> arranged;
+        arranged.reserve(handles.size());
+        for (const Handle &handle : handles) {
+            arranged.push_back(std::move(lines[handle.index]));
+        }
+        lines.swap(arranged);
+    }
+
+} // namespace LineSort
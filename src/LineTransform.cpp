@@ -0,0 +1,215 @@
+/*! \file    LineTransform.cpp
+ *  \brief   Implementation of the LineTransform functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_SSE2
+#endif
+
+#include "LineTransform.hpp"
+#include "Utf8.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    struct Name {
+        const char *name;
+        LineTransform::Kind kind;
+    };
+
+    const Name names[] = {{"cr", LineTransform::REMOVE_CR},
+                          {"lower", LineTransform::LOWER_CASE},
+                          {"tabs", LineTransform::INDENT_TABS},
+                          {"trim", LineTransform::TRIM},
+                          {"untab", LineTransform::EXPAND_TABS},
+                          {"upper", LineTransform::UPPER_CASE}};
+
+    //! Returns the offset of the first letter between first and last in the text.
+    /*!
+     * \return text.size() if there is none.
+     */
+    std::size_t find_letter(const std::string_view text, const char first, const char last)
+    {
+        std::size_t i = 0;
+#ifdef TRANSFORM_SSE2
+        // Bytes above 127 are negative when taken as signed, so they are never in the range.
+        const __m128i below = _mm_set1_epi8(static_cast<char>(first - 1));
+        const __m128i above = _mm_set1_epi8(static_cast<char>(last + 1));
+        for (; i + 16 <= text.size(); i += 16) {
+            const __m128i block =
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + i));
+            const __m128i found =
+                _mm_and_si128(_mm_cmpgt_epi8(block, below), _mm_cmplt_epi8(block, above));
+            if (_mm_movemask_epi8(found) != 0)
+                break;
+        }
+#endif
+        for (; i < text.size(); ++i) {
+            if (text[i] >= first && text[i] <= last)
+                return i;
+        }
+        return text.size();
+    }
+
+    //! Changes the case of the ASCII letters between first and last.
+    bool change_case(const std::string_view text, const char first, const char last,
+                     std::string &result)
+    {
+        std::size_t i = find_letter(text, first, last);
+        if (i == text.size())
+            return false;
+
+        result.assign(text.data(), text.size());
+        char *const characters = &result[0];
+#ifdef TRANSFORM_SSE2
+        const __m128i below = _mm_set1_epi8(static_cast<char>(first - 1));
+        const __m128i above = _mm_set1_epi8(static_cast<char>(last + 1));
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        for (i &= ~std::size_t(15); i + 16 <= result.size(); i += 16) {
+            __m128i *const address = reinterpret_cast<__m128i *>(characters + i);
+            const __m128i block = _mm_loadu_si128(address);
+            const __m128i found =
+                _mm_and_si128(_mm_cmpgt_epi8(block, below), _mm_cmplt_epi8(block, above));
+            _mm_storeu_si128(address, _mm_xor_si128(block, _mm_and_si128(found, case_bit)));
+        }
+#endif
+        for (; i < result.size(); ++i) {
+            if (characters[i] >= first && characters[i] <= last)
+                characters[i] ^= 0x20;
+        }
+        return true;
+    }
+
+    bool trim(const std::string_view text, std::string &result)
+    {
+        std::size_t end = text.size();
+        while (end > 0 && (text[end - 1] == ' ' || text[end - 1] == '\t'))
+            --end;
+        if (end == text.size())
+            return false;
+        result.assign(text.data(), end);
+        return true;
+    }
+
+    bool remove_cr(const std::string_view text, std::string &result)
+    {
+        if (std::memchr(text.data(), '\r', text.size()) == nullptr)
+            return false;
+        result.clear();
+        for (const char ch : text) {
+            if (ch != '\r')
+                result.push_back(ch);
+        }
+        return true;
+    }
+
+    bool expand_tabs(const std::string_view text, const unsigned tab, std::string &result)
+    {
+        if (std::memchr(text.data(), '\t', text.size()) == nullptr)
+            return false;
+        result.clear();
+        std::size_t column = 0;
+        for (const char ch : text) {
+            if (ch == '\t') {
+                const std::size_t next = Utf8::advance(column, ch, tab);
+                result.append(next - column, ' ');
+                column = next;
+                continue;
+            }
+            result.push_back(ch);
+            if (!Utf8::is_continuation(ch))
+                ++column;
+        }
+        return true;
+    }
+
+    bool indent_tabs(const std::string_view text, const unsigned tab, std::string &result)
+    {
+        std::size_t column = 0;
+        std::size_t end = 0;
+        for (; end < text.size() && (text[end] == ' ' || text[end] == '\t'); ++end)
+            column = Utf8::advance(column, text[end], tab);
+
+        // The indentation is already right if it is all tabs followed by fewer than tab spaces.
+        const std::size_t tabs = column / tab;
+        const std::size_t spaces = column % tab;
+        bool right = true;
+        for (std::size_t i = 0; right && i < end; ++i)
+            right = (text[i] == ((i < tabs) ? '\t' : ' '));
+        if (right && end == tabs + spaces)
+            return false;
+
+        result.assign(tabs, '\t');
+        result.append(spaces, ' ');
+        result.append(text.substr(end));
+        return true;
+    }
+
+    //! Applies one transform. Returns false if it doesn't change the text.
+    bool transform(const LineTransform::Kind kind, const std::string_view text,
+                   const unsigned tab, std::string &result)
+    {
+        switch (kind) {
+        case LineTransform::TRIM:
+            return trim(text, result);
+        case LineTransform::EXPAND_TABS:
+            return expand_tabs(text, tab, result);
+        case LineTransform::INDENT_TABS:
+            return indent_tabs(text, tab, result);
+        case LineTransform::UPPER_CASE:
+            return change_case(text, 'a', 'z', result);
+        case LineTransform::LOWER_CASE:
+            return change_case(text, 'A', 'Z', result);
+        case LineTransform::REMOVE_CR:
+            return remove_cr(text, result);
+        }
+        return false;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace LineTransform {
+
+    bool find(const std::string_view name, Kind &kind)
+    {
+        for (const Name &entry : names) {
+            if (name == entry.name) {
+                kind = entry.kind;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool apply(const std::vector<Kind> &pipeline, const std::string_view text,
+               const unsigned tab, std::string &result)
+    {
+        // Each transform reads the output of the one before it.
+        std::string other;
+        bool changed = false;
+        for (const Kind kind : pipeline) {
+            const std::string_view input = changed ? std::string_view(result) : text;
+            if (transform(kind, input, tab, other)) {
+                result.swap(other);
+                changed = true;
+            }
+        }
+        return changed && result != text;
+    }
+
+} // namespace LineTransform
@@ -0,0 +1,324 @@
+/*! \file    LuaEngine.cpp
+ *  \brief   Implementation of the LuaEngine abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * Lua reports errors by longjmp (when it is compiled as C), which skips C++ destructors. The
+ * functions called from Lua therefore check their arguments before creating any objects and
+ * raise errors only once those objects are gone.
+ */
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "LuaEngine.hpp"
+#include "support.hpp"
+
+#if defined(YEXA_LUA)
+
+extern "C" {
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+}
+
+#include "EditBuffer.hpp"
+#include "FileList.hpp"
+#include "SearchPattern.hpp"
+#include "YEditFile.hpp"
+#include "command_table.hpp"
+#include "parameter_stack.hpp"
+
+namespace {
+
+    lua_State *state = nullptr; //!< The interpreter, created when first needed.
+
+    //! Returns the length of the array at the given index.
+    std::size_t array_length(lua_State *const L, const int index)
+    {
+#if LUA_VERSION_NUM >= 502
+        return lua_rawlen(L, index);
+#else
+        return lua_objlen(L, index);
+#endif
+    }
+
+    //! Returns the line number (from 1) at the given argument as a line of the file (from 0).
+    long line_argument(lua_State *const L, const int argument)
+    {
+        const lua_Integer line = luaL_checkinteger(L, argument);
+        luaL_argcheck(L, line >= 1, argument, "lines are numbered from 1");
+        return static_cast<long>(line - 1);
+    }
+
+    //! Pushes the text of a line.
+    void push_line(lua_State *const L, const EditBuffer &line)
+    {
+        const std::string_view text = line.view();
+        lua_pushlstring(L, text.data(), text.size());
+    }
+
+    int line_count(lua_State *const L)
+    {
+        lua_pushinteger(L, FileList::active_file().line_count());
+        return 1;
+    }
+
+    int get_line(lua_State *const L)
+    {
+        const EditBuffer *const line = FileList::active_file().line_at(line_argument(L, 1));
+        if (line == nullptr)
+            lua_pushnil(L);
+        else
+            push_line(L, *line);
+        return 1;
+    }
+
+    int set_line(lua_State *const L)
+    {
+        const long line = line_argument(L, 1);
+        std::size_t length;
+        const char *const text = luaL_checklstring(L, 2, &length);
+        bool result;
+        {
+            const std::vector<std::string> new_lines(1, std::string(text, length));
+            result = FileList::active_file().replace_lines(line, 1L, new_lines);
+        }
+        lua_pushboolean(L, result);
+        return 1;
+    }
+
+    int get_lines(lua_State *const L)
+    {
+        YEditFile &the_file = FileList::active_file();
+        const long first = line_argument(L, 1);
+        long last = the_file.line_count() - 1;
+        if (!lua_isnoneornil(L, 2))
+            last = std::min(last, static_cast<long>(luaL_checkinteger(L, 2)) - 1);
+
+        const int count = first <= last ? static_cast<int>(last - first + 1) : 0;
+        lua_createtable(L, count, 0);
+        for (int i = 0; i < count; ++i) {
+            push_line(L, *the_file.line_at(first + i));
+            lua_rawseti(L, -2, i + 1);
+        }
+        return 1;
+    }
+
+    int set_lines(lua_State *const L)
+    {
+        const long first = line_argument(L, 1);
+        const long last = static_cast<long>(luaL_checkinteger(L, 2)) - 1;
+        luaL_argcheck(L, last >= first - 1, 2, "last line is before the first");
+        luaL_checktype(L, 3, LUA_TTABLE);
+        const std::size_t count = array_length(L, 3);
+        for (std::size_t i = 1; i <= count; ++i) {
+            lua_rawgeti(L, 3, static_cast<int>(i));
+            if (lua_type(L, -1) != LUA_TSTRING)
+                return luaL_error(L, "array element %d is not a string", static_cast<int>(i));
+            lua_pop(L, 1);
+        }
+
+        bool result;
+        {
+            std::vector<std::string> new_lines;
+            new_lines.reserve(count);
+            for (std::size_t i = 1; i <= count; ++i) {
+                lua_rawgeti(L, 3, static_cast<int>(i));
+                std::size_t length;
+                const char *const text = lua_tolstring(L, -1, &length);
+                new_lines.emplace_back(text, length);
+                lua_pop(L, 1);
+            }
+            result = FileList::active_file().replace_lines(first, last - first + 1, new_lines);
+        }
+        lua_pushboolean(L, result);
+        return 1;
+    }
+
+    int cursor(lua_State *const L)
+    {
+        FilePosition &point = FileList::active_file().CP();
+        lua_pushinteger(L, point.cursor_line() + 1);
+        lua_pushinteger(L, point.cursor_column() + 1);
+        return 2;
+    }
+
+    int set_cursor(lua_State *const L)
+    {
+        FilePosition &point = FileList::active_file().CP();
+        point.jump_to_line(line_argument(L, 1));
+        if (!lua_isnoneornil(L, 2)) {
+            const lua_Integer column = luaL_checkinteger(L, 2);
+            luaL_argcheck(L, column >= 1, 2, "columns are numbered from 1");
+            point.jump_to_column(static_cast<unsigned>(column - 1));
+        }
+        return 0;
+    }
+
+    int block(lua_State *const L)
+    {
+        YEditFile &the_file = FileList::active_file();
+        if (!the_file.get_block_state()) {
+            lua_pushnil(L);
+            return 1;
+        }
+        long top, bottom;
+        the_file.block_limits(top, bottom);
+        lua_pushinteger(L, top + 1);
+        lua_pushinteger(L, bottom + 1);
+        return 2;
+    }
+
+    int search(lua_State *const L)
+    {
+        std::size_t length;
+        const char *const text = luaL_checklstring(L, 1, &length);
+        const bool regex = lua_toboolean(L, 2) != 0;
+
+        bool compiled;
+        bool found = false;
+        std::size_t match_length = 0;
+        {
+            const SearchPattern::Mode mode =
+                regex ? SearchPattern::REGULAR_EXPRESSION : SearchPattern::LITERAL;
+            SearchPattern pattern;
+            compiled = pattern.compile(std::string_view(text, length), mode);
+            if (!compiled)
+                lua_pushstring(L, pattern.error().c_str());
+            else
+                found = FileList::active_file().search(pattern, &match_length);
+        }
+        if (!compiled)
+            return lua_error(L);
+        if (!found) {
+            lua_pushnil(L);
+            return 1;
+        }
+        cursor(L);
+        lua_pushinteger(L, static_cast<lua_Integer>(match_length));
+        return 3;
+    }
+
+    int command(lua_State *const L)
+    {
+        std::size_t length;
+        const char *const name = luaL_checklstring(L, 1, &length);
+        const int index = find_command(std::string_view(name, length));
+        if (index < 0)
+            return luaL_error(L, "unknown command %s", name);
+        const int top = lua_gettop(L);
+        for (int i = 2; i <= top; ++i) {
+            const int type = lua_type(L, i);
+            if (type != LUA_TNUMBER && type != LUA_TSTRING)
+                return luaL_argerror(L, i, "parameters must be numbers or strings");
+        }
+
+        // The command pops its first parameter first, so that one goes on top.
+        for (int i = top; i >= 2; --i) {
+            if (lua_type(L, i) == LUA_TNUMBER) {
+                const lua_Number number = lua_tonumber(L, i);
+                const long integer = static_cast<long>(number);
+                if (static_cast<lua_Number>(integer) == number) {
+                    parameter_stack.push_integer(integer);
+                    continue;
+                }
+            }
+            std::size_t text_length;
+            const char *const text = lua_tolstring(L, i, &text_length);
+            parameter_stack.push(EditBuffer(text, text_length));
+        }
+        execute_command(index);
+        return 0;
+    }
+
+    const luaL_Reg editor_functions[] = {
+        {"block", block},
+        {"command", command},
+        {"cursor", cursor},
+        {"get_line", get_line},
+        {"get_lines", get_lines},
+        {"line_count", line_count},
+        {"search", search},
+        {"set_cursor", set_cursor},
+        {"set_line", set_line},
+        {"set_lines", set_lines},
+        {nullptr, nullptr},
+    };
+
+    //! Returns the interpreter, creating it if necessary. Returns nullptr if out of memory.
+    lua_State *interpreter()
+    {
+        if (state != nullptr)
+            return state;
+        state = luaL_newstate();
+        if (state == nullptr) {
+            memory_message("Can't start the Lua interpreter");
+            return nullptr;
+        }
+        luaL_openlibs(state);
+        lua_newtable(state);
+        for (const luaL_Reg *function = editor_functions; function->name != nullptr;
+             ++function) {
+            lua_pushcfunction(state, function->func);
+            lua_setfield(state, -2, function->name);
+        }
+        lua_setglobal(state, "yexa");
+        return state;
+    }
+
+    //! Runs the chunk loaded onto the stack (if load_status indicates success).
+    bool run_chunk(lua_State *const L, const int load_status)
+    {
+        if (load_status != 0 || lua_pcall(L, 0, 0, 0) != 0) {
+            const char *const message = lua_tostring(L, -1);
+            error_message("%s", message == nullptr ? "Lua error" : message);
+            lua_pop(L, 1);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+namespace LuaEngine {
+
+    bool run_file(const char *const file_name)
+    {
+        lua_State *const L = interpreter();
+        if (L == nullptr)
+            return false;
+        return run_chunk(L, luaL_loadfile(L, file_name));
+    }
+
+    bool run_text(const std::string_view code)
+    {
+        lua_State *const L = interpreter();
+        if (L == nullptr)
+            return false;
+        return run_chunk(L, luaL_loadbuffer(L, code.data(), code.size(), "=macro text"));
+    }
+
+} // namespace LuaEngine
+
+#else
+
+namespace LuaEngine {
+
+    bool run_file(const char *)
+    {
+        error_message("This version of Yexa was built without Lua support");
+        return false;
+    }
+
+    bool run_text(std::string_view)
+    {
+        error_message("This version of Yexa was built without Lua support");
+        return false;
+    }
+
+} // namespace LuaEngine
+
+#endif
@@ -0,0 +1,239 @@
+/*! \file    MacroProfile.cpp
+ *  \brief   Implementation of the MacroProfile abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MacroProfile.hpp"
+#include "command_table.hpp"
+#include "parameter_stack.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! What is known about one command or source. Times are in nanoseconds.
+    struct Counts {
+        unsigned long calls = 0;
+        long long inclusive = 0;
+        long long exclusive = 0;
+        std::size_t depth = 0; //!< The deepest the parameter stack was seen.
+    };
+
+    //! A command that has been entered and not yet left.
+    struct CommandFrame {
+        int index;
+        long long start;
+        long long children; //!< The inclusive time of the commands it ran.
+        std::size_t depth;
+    };
+
+    //! A source on the macro stack that has given a word and not yet been popped.
+    struct SourceFrame {
+        const void *source;
+        std::string_view name; //!< Held by the source.
+        long long start;
+        long long waited;   //!< The value of suspended_total at start.
+        long long children; //!< The inclusive time of the sources above it.
+        std::size_t depth;
+    };
+
+    //! A line of the report.
+    struct Entry {
+        std::string name;
+        Counts counts;
+    };
+
+    bool running = false;
+    std::vector<Counts> commands; // Indexed by dispatch table index.
+    std::map<std::string, Counts, std::less<>> sources;
+    std::vector<CommandFrame> command_frames;
+    std::vector<SourceFrame> source_frames;
+    long long suspended_total = 0;
+
+    long long now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    //! Adds one call, with its times and depth, to counts.
+    void count(Counts &counts, const long long inclusive, const long long exclusive,
+               const std::size_t depth)
+    {
+        ++counts.calls;
+        counts.inclusive += inclusive;
+        counts.exclusive += exclusive;
+        counts.depth = std::max(counts.depth, depth);
+    }
+
+    //! Sorts the entries into the given order. Entries that are otherwise equal go by name.
+    void sort_entries(std::vector<Entry> &entries, const MacroProfile::Order order)
+    {
+        auto key = [order](const Counts &counts) -> long long {
+            switch (order) {
+            case MacroProfile::BY_CALLS:
+                return static_cast<long long>(counts.calls);
+            case MacroProfile::BY_INCLUSIVE:
+                return counts.inclusive;
+            case MacroProfile::BY_EXCLUSIVE:
+                return counts.exclusive;
+            case MacroProfile::BY_DEPTH:
+                return static_cast<long long>(counts.depth);
+            default:
+                return 0;
+            }
+        };
+        auto before = [&key](const Entry &left, const Entry &right) {
+            const long long left_key = key(left.counts);
+            const long long right_key = key(right.counts);
+            if (left_key != right_key)
+                return left_key > right_key;
+            return left.name < right.name;
+        };
+        std::sort(entries.begin(), entries.end(), before);
+    }
+
+    //! Adds the lines showing the entries, under a heading with the given title, to lines.
+    void report_entries(const char *const title, const std::vector<Entry> &entries,
+                        std::vector<std::string> &lines)
+    {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-24s %9s %12s %12s %11s %6s", title, "Calls",
+                      "Inclusive ms", "Exclusive ms", "Mean us", "Depth");
+        lines.push_back(line);
+        for (const Entry &entry : entries) {
+            const Counts &counts = entry.counts;
+            std::snprintf(line, sizeof(line), "%-24s %9lu %12.1f %12.1f %11.1f %6zu",
+                          entry.name.c_str(), counts.calls, counts.inclusive / 1e6,
+                          counts.exclusive / 1e6, counts.inclusive / 1e3 / counts.calls,
+                          counts.depth);
+            lines.push_back(line);
+        }
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace MacroProfile {
+
+    void start()
+    {
+        commands.clear();
+        sources.clear();
+        command_frames.clear();
+        source_frames.clear();
+        suspended_total = 0;
+        running = true;
+    }
+
+    void stop()
+    {
+        running = false;
+        command_frames.clear();
+        source_frames.clear();
+    }
+
+    bool active()
+    {
+        return running;
+    }
+
+    void enter_command(const int index)
+    {
+        command_frames.push_back(CommandFrame{index, now(), 0, parameter_stack.size()});
+    }
+
+    void leave_command()
+    {
+        // The profile may have been started by the command itself.
+        if (command_frames.empty())
+            return;
+        const CommandFrame frame = command_frames.back();
+        command_frames.pop_back();
+        const long long inclusive = now() - frame.start;
+        if (!command_frames.empty())
+            command_frames.back().children += inclusive;
+
+        const std::size_t index = static_cast<std::size_t>(frame.index);
+        if (index >= commands.size())
+            commands.resize(index + 1);
+        count(commands[index], inclusive, inclusive - frame.children,
+              std::max(frame.depth, parameter_stack.size()));
+    }
+
+    /*!
+     * A source is entered the first time it gives a word. A source pushed beneath another one
+     * (by a command that pushed two) is entered when it comes to the top.
+     */
+    void source_word(const void *const source, const std::string_view name)
+    {
+        if (!running)
+            return;
+        const std::size_t depth = parameter_stack.size();
+        if (!source_frames.empty() && source_frames.back().source == source) {
+            source_frames.back().depth = std::max(source_frames.back().depth, depth);
+            return;
+        }
+        source_frames.push_back(SourceFrame{source, name, now(), suspended_total, 0, depth});
+    }
+
+    void source_popped(const void *const source)
+    {
+        if (!running || source_frames.empty() || source_frames.back().source != source)
+            return;
+        const SourceFrame frame = source_frames.back();
+        source_frames.pop_back();
+        const long long inclusive = now() - frame.start - (suspended_total - frame.waited);
+        if (!source_frames.empty())
+            source_frames.back().children += inclusive;
+
+        auto counts = sources.find(frame.name);
+        if (counts == sources.end())
+            counts = sources.emplace(std::string(frame.name), Counts()).first;
+        count(counts->second, inclusive, inclusive - frame.children, frame.depth);
+    }
+
+    void suspended(const long long nanoseconds)
+    {
+        if (running)
+            suspended_total += nanoseconds;
+    }
+
+    std::vector<std::string> report(const Order order)
+    {
+        std::vector<Entry> entries;
+        for (std::size_t index = 0; index < commands.size(); ++index) {
+            if (commands[index].calls != 0)
+                entries.push_back(
+                    Entry{std::string(command_name(static_cast<int>(index))), commands[index]});
+        }
+        sort_entries(entries, order);
+        std::vector<std::string> lines;
+        report_entries("Command", entries, lines);
+
+        entries.clear();
+        for (const auto &source : sources)
+            entries.push_back(Entry{source.first, source.second});
+        sort_entries(entries, order);
+        lines.push_back("");
+        report_entries("Source", entries, lines);
+        return lines;
+    }
+
+} // namespace MacroProfile
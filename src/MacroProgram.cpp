@@ -0,0 +1,145 @@
+/*! \file    MacroProgram.cpp
+ *  \brief   Implementation of class MacroProgram and the compiled program cache.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * Macro files are compiled the first time they are executed and the resulting programs are
+ * kept in memory. A cached program is reused as long as the file's modification time and size
+ * are unchanged, so editing a macro file causes it to be recompiled on its next use.
+ */
+
+#include <cstdio>
+#include <ctime>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <screen/environ.hpp>
+
+#include "Allocations.hpp"
+#include "MacroProgram.hpp"
+#include "MacroTokenizer.hpp"
+#include "MappedFile.hpp"
+#include "command_table.hpp"
+#include "parameter_stack.hpp"
+#include "support.hpp"
+
+namespace {
+
+    struct CachedProgram {
+        std::time_t modify_time;
+        off_t size;
+        std::shared_ptr<const MacroProgram> program;
+    };
+
+    std::map<std::string, CachedProgram> program_cache;
+
+    //! Reads the entire contents of a file. Returns false if the file can't be read.
+    bool read_file(const char *file_name, std::string &contents)
+    {
+        MappedFile image;
+        if (image.open(file_name)) {
+            contents.assign(image.data(), image.size());
+            return true;
+        }
+
+        std::FILE *file = std::fopen(file_name, "rb");
+        if (file == nullptr)
+            return false;
+
+        char buffer[4096];
+        std::size_t count;
+        contents.clear();
+        while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            contents.append(buffer, count);
+        }
+        const bool result = !std::ferror(file);
+        std::fclose(file);
+        return result;
+    }
+
+} // namespace
+
+//! Translates macro text into instructions, appending them to the program.
+void MacroProgram::compile(const char *text, std::size_t length)
+{
+#if eOPSYS != ePOSIX
+    // Files are read in binary so discard the carriage return of each line ending.
+    std::string without_returns;
+    for (std::size_t i = 0; i < length; ++i) {
+        if (!(text[i] == '\r' && i + 1 < length && text[i + 1] == '\n'))
+            without_returns.push_back(text[i]);
+    }
+    text = without_returns.data();
+    length = without_returns.size();
+#endif
+
+    MacroTokenizer tokens(std::string_view(text, length));
+    MacroTokenizer::Token token;
+    while (tokens.next(token)) {
+        if (token.kind == MacroTokenizer::NAME)
+            add_word(token.text);
+        else
+            add_constant(token.text);
+    }
+}
+
+//! Appends an instruction that pushes the given text (or number) onto the parameter stack.
+void MacroProgram::add_constant(const std::string_view text)
+{
+    constants.push_back(ParameterStack::Value::from_text(text));
+    code.push_back(Instruction{PUSH_CONSTANT, static_cast<unsigned>(constants.size() - 1)});
+}
+
+/*!
+ * Appends an instruction for the given macro word. Command words are resolved now; any other
+ * word is pushed onto the parameter stack when executed, just as handle_word() would do.
+ */
+void MacroProgram::add_word(const std::string_view word)
+{
+    const int index = find_command(word);
+    if (index < 0)
+        add_constant(word);
+    else
+        code.push_back(Instruction{EXECUTE_COMMAND, static_cast<unsigned>(index)});
+}
+
+//! Returns the compiled program for the named macro file.
+/*!
+ * The program is taken from the cache if the file has not changed since it was compiled.
+ *
+ * \return nullptr if the file can't be read. An error message has been displayed.
+ */
+std::shared_ptr<const MacroProgram> load_macro_program(const char *file_name)
+{
+    Allocations::Scope tag(Allocations::MACRO);
+
+    // Files that can't be examined are compiled every time and never cached.
+    struct stat file_information;
+    const bool cacheable = (stat(file_name, &file_information) == 0);
+
+    auto cached = program_cache.find(file_name);
+    if (cacheable && cached != program_cache.end() &&
+        cached->second.modify_time == file_information.st_mtime &&
+        cached->second.size == file_information.st_size)
+        return cached->second.program;
+
+    std::string contents;
+    if (!read_file(file_name, contents)) {
+        error_message("Can't open macro file %s for reading", file_name);
+        if (cached != program_cache.end())
+            program_cache.erase(cached);
+        return nullptr;
+    }
+
+    auto program = std::make_shared<MacroProgram>();
+    program->compile(contents.data(), contents.size());
+    if (cacheable) {
+        program_cache[file_name] =
+            CachedProgram{file_information.st_mtime, file_information.st_size, program};
+    }
+    return program;
+}
@@ -0,0 +1,140 @@
+/*! \file    MacroTokenizer.cpp
+ *  \brief   Implementation of class MacroTokenizer.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cctype>
+
+#include "MacroTokenizer.hpp"
+
+namespace {
+
+    //! Returns true if ch is "whitespace".
+    inline bool is_white(const char ch)
+    {
+        return std::isspace(static_cast<unsigned char>(ch)) != 0;
+    }
+
+    //! Returns true if ch is a character that could be part of an identifier name.
+    inline bool is_name(const char ch)
+    {
+        return !is_white(ch) && ch != '{' && ch != '#' && ch != '"';
+    }
+
+} // namespace
+
+//! Finds the next token.
+/*!
+ * \param token [out] The token found. Unchanged if there are no more tokens.
+ * \return false if the rest of the text holds no tokens.
+ */
+bool MacroTokenizer::next(Token &token)
+{
+    const std::size_t length = source.size();
+
+    while (offset < length) {
+        const char ch = source[offset];
+        if (is_white(ch)) {
+            ++offset;
+        }
+        else if (ch == '#') {
+            const std::size_t end = source.find('\n', offset);
+            offset = (end == std::string_view::npos) ? length : end + 1;
+        }
+        else if (ch == '"') {
+            ++offset;
+            token = Token{STRING, quoted_string()};
+            return true;
+        }
+        else if (ch == '{') {
+            ++offset;
+            std::string_view text;
+            if (!brace_string(text))
+                return false;
+            token = Token{STRING, text};
+            return true;
+        }
+        else {
+            const std::size_t start = offset;
+            while (offset < length && is_name(source[offset]))
+                ++offset;
+            token = Token{NAME, source.substr(start, offset - start)};
+            return true;
+        }
+    }
+    return false;
+}
+
+//! Scans a quoted string whose opening quote has been consumed. It may end with the text.
+std::string_view MacroTokenizer::quoted_string()
+{
+    const std::size_t length = source.size();
+    const std::size_t start = offset;
+
+    // Most strings have no escapes and can be returned in place.
+    while (offset < length && source[offset] != '"' && source[offset] != '\\')
+        ++offset;
+    if (offset >= length || source[offset] == '"') {
+        const std::string_view text = source.substr(start, offset - start);
+        if (offset < length)
+            ++offset;
+        return text;
+    }
+
+    workspace.assign(source.data() + start, offset - start);
+    while (offset < length && source[offset] != '"') {
+        if (source[offset] == '\\' && ++offset >= length)
+            break;
+        workspace.push_back(source[offset++]);
+    }
+    if (offset < length)
+        ++offset;
+    return workspace;
+}
+
+//! Scans a brace string whose opening brace has been consumed.
+/*!
+ * \param text [out] The string's text.
+ * \return false if the text ends before the string is closed.
+ */
+bool MacroTokenizer::brace_string(std::string_view &text)
+{
+    const std::size_t length = source.size();
+    int nested_count = 1;
+
+    workspace.clear();
+    while (offset < length) {
+        const char ch = source[offset++];
+        if (is_white(ch)) {
+            workspace.push_back(' ');
+            while (offset < length && is_white(source[offset]))
+                ++offset;
+        }
+        else if (ch == '#') {
+            workspace.push_back(' ');
+            const std::size_t end = source.find('\n', offset);
+            offset = (end == std::string_view::npos) ? length : end + 1;
+        }
+        else if (ch == '"') {
+            // Quoted parts are copied as they are, escapes included.
+            workspace.push_back(ch);
+            while (offset < length && source[offset] != '"') {
+                if (source[offset] == '\\' && offset + 1 < length)
+                    workspace.push_back(source[offset++]);
+                workspace.push_back(source[offset++]);
+            }
+            if (offset < length)
+                workspace.push_back(source[offset++]);
+        }
+        else if (ch == '}' && --nested_count == 0) {
+            text = workspace;
+            return true;
+        }
+        else {
+            if (ch == '{')
+                ++nested_count;
+            workspace.push_back(ch);
+        }
+    }
+    return false;
+}
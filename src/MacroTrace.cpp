@@ -0,0 +1,133 @@
+/*! \file    MacroTrace.cpp
+ *  \brief   Implementation of class MacroTrace
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+
+#include "Allocations.hpp"
+#include "MacroTrace.hpp"
+#include "support.hpp"
+
+namespace {
+    // The largest number of events in a learned macro.
+    constexpr std::size_t maximum_events = 64 * 1024;
+} // namespace
+
+MacroTrace keyboard_macro;
+
+//! Forgets the current macro and starts recording a new one.
+void MacroTrace::start_recording()
+{
+    events.clear();
+    programs.clear();
+    answers.clear();
+    next = 0;
+    is_recording = true;
+    is_defined = false;
+    info_message("Recording keyboard macro");
+}
+
+//! Stops recording. The events recorded so far become the macro.
+void MacroTrace::finish_recording()
+{
+    is_recording = false;
+    is_defined = true;
+    info_message("Finished");
+}
+
+//! Appends an event. Returns false (after a warning) if the trace is full.
+bool MacroTrace::add(const Kind kind, const unsigned operand)
+{
+    if (events.size() == maximum_events) {
+        warning_message("Keyboard macro buffer is full");
+        return false;
+    }
+    Allocations::Scope tag(Allocations::MACRO);
+    events.push_back(Event{kind, operand});
+    return true;
+}
+
+//! Records that the program was run for a keystroke.
+void MacroTrace::record_program(const std::shared_ptr<const MacroProgram> &program,
+                                const bool direct)
+{
+    if (!is_recording)
+        return;
+    auto existing = std::find(programs.begin(), programs.end(), program);
+    const unsigned index = static_cast<unsigned>(existing - programs.begin());
+    if (add(direct ? DIRECT_PROGRAM : PROGRAM, index) && existing == programs.end()) {
+        Allocations::Scope tag(Allocations::MACRO);
+        programs.push_back(program);
+    }
+}
+
+//! Records that a quoted keystroke added the letter to the file.
+void MacroTrace::record_character(const char letter)
+{
+    if (is_recording)
+        add(CHARACTER, static_cast<unsigned char>(letter));
+}
+
+//! Records the text entered at a prompt.
+void MacroTrace::record_answer(const std::string_view answer)
+{
+    if (is_recording && add(ANSWER, static_cast<unsigned>(answers.size())))
+        answers.emplace_back(answer);
+}
+
+//! Records that a prompt was cancelled.
+void MacroTrace::record_cancel()
+{
+    if (is_recording)
+        add(CANCEL, 0);
+}
+
+//! Prepares to replay the macro from its first event.
+void MacroTrace::start_replay()
+{
+    next = 0;
+    is_replaying = true;
+}
+
+//! Ends the replay. Prompts are answered by the user again.
+void MacroTrace::finish_replay()
+{
+    is_replaying = false;
+}
+
+//! Returns the next keystroke's event, or nullptr at the end of the macro.
+/*!
+ * Answers not taken by a prompt (because the command found its parameter on the stack, for
+ * example) are skipped.
+ */
+const MacroTrace::Event *MacroTrace::next_event()
+{
+    while (next < events.size()) {
+        const Event &event = events[next++];
+        if (event.kind != ANSWER && event.kind != CANCEL)
+            return &event;
+    }
+    return nullptr;
+}
+
+//! Supplies the answer to a prompt during a replay.
+/*!
+ * \param answer [out] The recorded text.
+ * \param cancelled [out] =true if the prompt was cancelled when the macro was recorded.
+ * \return false if the next event isn't an answer (or there is no replay), in which case the
+ * user should be prompted.
+ */
+bool MacroTrace::take_answer(std::string &answer, bool &cancelled)
+{
+    if (!is_replaying || next >= events.size())
+        return false;
+    const Event &event = events[next];
+    if (event.kind != ANSWER && event.kind != CANCEL)
+        return false;
+    ++next;
+    cancelled = (event.kind == CANCEL);
+    if (!cancelled)
+        answer = answers[event.operand];
+    return true;
+}
@@ -0,0 +1,135 @@
+/*! \file    MappedFile.cpp
+ *  \brief   Implementation of class MappedFile
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <windows.h>
+#endif
+
+#include "MappedFile.hpp"
+
+//! Constructs a MappedFile that does not yet refer to any file.
+MappedFile::MappedFile() : base(nullptr), length(0)
+{
+#if eOPSYS == eWINDOWS
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = nullptr;
+#endif
+}
+
+//! Releases the mapping, if any.
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+//! Maps the named file into memory.
+/*!
+ * Any previously mapped file is first released. An empty file is successfully "mapped" with a
+ * size of zero and a nullptr data pointer.
+ *
+ * \param name The name of the file to map.
+ * \return true if the file was mapped; false if the file could not be opened, is not a regular
+ * file, or could not be mapped. No message is printed.
+ */
+bool MappedFile::open(const char *const name)
+{
+    close();
+
+#if eOPSYS == ePOSIX
+    int fd = ::open(name, O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat file_information;
+    if (fstat(fd, &file_information) == -1 || !S_ISREG(file_information.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    length = static_cast<std::size_t>(file_information.st_size);
+    if (length != 0) {
+        void *view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            length = 0;
+            ::close(fd);
+            return false;
+        }
+        base = static_cast<const char *>(view);
+#if defined(MADV_SEQUENTIAL)
+        madvise(view, length, MADV_SEQUENTIAL);
+#endif
+    }
+
+    // The mapping remains valid after the descriptor is closed.
+    ::close(fd);
+    return true;
+#endif
+
+#if eOPSYS == eWINDOWS
+    HANDLE file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    file_handle = file;
+    if (file_size.QuadPart == 0)
+        return true;
+
+    mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        close();
+        return false;
+    }
+    void *view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        close();
+        return false;
+    }
+    base = static_cast<const char *>(view);
+    length = static_cast<std::size_t>(file_size.QuadPart);
+    return true;
+#endif
+}
+
+//! Releases the mapping. It is not an error to close a MappedFile that is not open.
+void MappedFile::close()
+{
+#if eOPSYS == ePOSIX
+    if (base != nullptr) {
+        munmap(const_cast<char *>(base), length);
+    }
+#endif
+
+#if eOPSYS == eWINDOWS
+    if (base != nullptr) {
+        UnmapViewOfFile(base);
+    }
+    if (mapping_handle != nullptr) {
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+    }
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+        file_handle = INVALID_HANDLE_VALUE;
+    }
+#endif
+
+    base = nullptr;
+    length = 0;
+}
@@ -0,0 +1,200 @@
+/*! \file    MarkSet.cpp
+ *  \brief   Implementation of class MarkSet
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+
+#include "MarkSet.hpp"
+
+//! Adds distance (which may be negative) to the step of a sorted mark and to those after it.
+void MarkSet::add_step(const std::size_t index, const long distance)
+{
+    steps[index] += distance;
+    for (std::size_t i = index + 1; i < tree.size(); i += i & (~i + 1))
+        tree[i] += distance;
+}
+
+//! Returns the line of the mark at the given position in order.
+long MarkSet::line_at(const std::size_t index) const
+{
+    long line = 0;
+    for (std::size_t i = index + 1; i > 0; i -= i & (~i + 1))
+        line += tree[i];
+    return line;
+}
+
+//! Returns the position in order of the first mark at or after the given line.
+/*!
+ * \return The number of positions in order if every mark is before the line.
+ */
+std::size_t MarkSet::first_at(long line) const
+{
+    // Descend the tree, skipping the marks before the line. No step is negative.
+    const std::size_t size = order.size();
+    std::size_t index = 0;
+    std::size_t step = 1;
+    while (step * 2 <= size)
+        step *= 2;
+    for (; step > 0; step /= 2) {
+        if (index + step <= size && tree[index + step] < line) {
+            index += step;
+            line -= tree[index];
+        }
+    }
+    return index;
+}
+
+//! Sorts the marks held aside into the others and builds the tree again, in O(n log n) time.
+void MarkSet::sort()
+{
+    std::vector<Mark> sorted;
+    sorted.reserve(count);
+    long line = 0;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        line += steps[i];
+        Slot &slot = slots[order[i]];
+        if (slot.state == SORTED && slot.index == i) {
+            slot.line = line;
+            sorted.push_back(order[i]);
+        }
+    }
+    // A mark placed more than once since the last sort is held more than once.
+    for (const Mark mark : held) {
+        if (slots[mark].state == HELD) {
+            slots[mark].state = SORTED;
+            sorted.push_back(mark);
+        }
+    }
+    held.clear();
+    std::stable_sort(sorted.begin(), sorted.end(), [this](const Mark left, const Mark right) {
+        return slots[left].line < slots[right].line;
+    });
+
+    order.swap(sorted);
+    const std::size_t size = order.size();
+    steps.assign(size, 0L);
+    tree.assign(size + 1, 0L);
+    long previous = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        Slot &slot = slots[order[i]];
+        slot.index = i;
+        steps[i] = slot.line - previous;
+        previous = slot.line;
+        tree[i + 1] += steps[i];
+        const std::size_t parent = (i + 1) + ((i + 1) & (~(i + 1) + 1));
+        if (parent <= size)
+            tree[parent] += tree[i + 1];
+    }
+}
+
+//! Adds a mark. Lines before the start of the file are taken as the first line.
+MarkSet::Mark MarkSet::add(const long line, const unsigned column)
+{
+    Mark mark;
+    if (!free_slots.empty()) {
+        mark = free_slots.back();
+        free_slots.pop_back();
+    }
+    else {
+        mark = slots.size();
+        slots.push_back(Slot{FREE, 0, 0L, 0U});
+    }
+    slots[mark] = Slot{HELD, 0, std::max(line, 0L), column};
+    held.push_back(mark);
+    ++count;
+    return mark;
+}
+
+//! Puts a mark somewhere else. Nothing is done if there is no such mark.
+void MarkSet::place(const Mark mark, const long line, const unsigned column)
+{
+    if (!contains(mark))
+        return;
+    slots[mark] = Slot{HELD, 0, std::max(line, 0L), column};
+    held.push_back(mark);
+}
+
+//! Removes a mark. Nothing is done if there is no such mark.
+/*!
+ * The mark's position in order, if it is sorted, is left until the next sort.
+ */
+void MarkSet::remove(const Mark mark)
+{
+    if (!contains(mark))
+        return;
+    slots[mark].state = FREE;
+    free_slots.push_back(mark);
+    --count;
+}
+
+//! Returns true if the mark exists.
+bool MarkSet::contains(const Mark mark) const
+{
+    return mark < slots.size() && slots[mark].state != FREE;
+}
+
+//! Returns the line of a mark, which must exist.
+long MarkSet::line(const Mark mark) const
+{
+    const Slot &slot = slots[mark];
+    return (slot.state == HELD) ? slot.line : line_at(slot.index);
+}
+
+//! Returns the column of a mark, which must exist.
+unsigned MarkSet::column(const Mark mark) const
+{
+    return slots[mark].column;
+}
+
+//! Moves the marks as the lines of the file were moved (see EditFile::take_modifications).
+/*!
+ * The marks on the lines replaced that are still lines of the file stay where they are. This
+ * takes logarithmic time, and in addition constant time for each mark on a line deleted.
+ */
+void MarkSet::move(const EditDelta &change)
+{
+    if (change.empty() || change.moved() == 0)
+        return;
+    if (!held.empty())
+        sort();
+    const std::size_t size = order.size();
+    const long old_end = change.first + change.old_count;
+    const long new_end = change.first + change.new_count;
+    const std::size_t after = first_at(old_end);
+
+    if (change.moved() < 0) {
+        std::size_t index = first_at(new_end);
+        if (index < after) {
+            // The marks on the lines deleted go to the line after those that replaced them.
+            long last = line_at(index);
+            add_step(index, new_end - last);
+            for (std::size_t i = index; i < after; ++i) {
+                if (i > index) {
+                    last += steps[i];
+                    add_step(i, -steps[i]);
+                }
+                Slot &slot = slots[order[i]];
+                if (slot.state == SORTED && slot.index == i)
+                    slot.column = 0U;
+            }
+            // The next mark stays where it was until all are moved below.
+            if (after < size)
+                add_step(after, last - new_end);
+        }
+    }
+    if (after < size)
+        add_step(after, change.moved());
+}
+
+//! Removes every mark.
+void MarkSet::clear()
+{
+    slots.clear();
+    free_slots.clear();
+    held.clear();
+    order.clear();
+    steps.clear();
+    tree.clear();
+    count = 0;
+}
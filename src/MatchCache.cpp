@@ -0,0 +1,71 @@
+/*! \file    MatchCache.cpp
+ *  \brief   Implementation of class MatchCache.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <iterator>
+
+#include "MatchCache.hpp"
+
+#define MAX_CACHED_LINES 8192  // More lines than this are forgotten all at once.
+#define MAX_CACHED_LENGTH 65536 // Longer lines are not kept.
+
+void MatchCache::reset()
+{
+    lines.clear();
+    pattern = nullptr;
+    text.clear();
+}
+
+void MatchCache::prepare(const SearchPattern &new_pattern)
+{
+    if (pattern == nullptr || new_pattern.text() != text || new_pattern.mode() != mode) {
+        lines.clear();
+        text = new_pattern.text();
+        mode = new_pattern.mode();
+    }
+    pattern = &new_pattern;
+}
+
+/*!
+ * The lines replaced are forgotten and the lines after them are renumbered. Only lines that
+ * are kept are visited, so this costs little however large the file is.
+ */
+void MatchCache::invalidate(const EditDelta &change)
+{
+    if (lines.empty())
+        return;
+
+    auto moved = lines.erase(lines.lower_bound(change.first),
+                             lines.lower_bound(change.first + change.old_count));
+    if (change.moved() == 0)
+        return;
+    std::map<long, std::vector<Match>> after;
+    for (; moved != lines.end(); moved = lines.erase(moved))
+        after.emplace_hint(after.end(), moved->first + change.moved(),
+                           std::move(moved->second));
+    lines.insert(std::make_move_iterator(after.begin()), std::make_move_iterator(after.end()));
+}
+
+const std::vector<MatchCache::Match> *MatchCache::matches(const long line,
+                                                          const std::string_view line_text)
+{
+    if (line_text.size() > MAX_CACHED_LENGTH || pattern == nullptr)
+        return nullptr;
+    const auto found = lines.find(line);
+    if (found != lines.end())
+        return &found->second;
+
+    if (lines.size() >= MAX_CACHED_LINES)
+        lines.clear();
+    std::vector<Match> &result = lines[line];
+    std::size_t offset = 0;
+    std::size_t length;
+    while ((offset = pattern->find(line_text, offset, &length)) != SearchPattern::npos) {
+        if (length != 0)
+            result.push_back(Match{offset, length});
+        offset += std::max<std::size_t>(length, 1);
+    }
+    return &result;
+}
@@ -0,0 +1,143 @@
+/*! \file    PathIndex.cpp
+ *  \brief   Implementation of class PathIndex.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "PathIndex.hpp"
+#include "ProjectSearch.hpp"
+
+namespace {
+
+    // The walk stops after this many paths to bound the memory used by the index.
+    constexpr std::size_t maximum_paths = 2000000;
+
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Lists directories until none are left. Runs as a task (see TaskPool).
+void PathIndex::work()
+{
+    std::vector<std::string> directories;
+    std::vector<std::string> files;
+
+    for (;;) {
+        std::string directory;
+        {
+            std::unique_lock<std::mutex> guard(queue_lock);
+            changed.wait(guard, [this] { return cancelled || !pending.empty() || busy == 0; });
+            if (cancelled || pending.empty())
+                break;
+            directory = std::move(pending.back());
+            pending.pop_back();
+            ++busy;
+        }
+
+        directories.clear();
+        files.clear();
+        ProjectSearch::list_directory(directory, directories, files);
+        std::sort(files.begin(), files.end());
+
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            path_count += files.size();
+            std::move(files.begin(), files.end(), std::back_inserter(queue));
+            std::move(directories.begin(), directories.end(), std::back_inserter(pending));
+            if (path_count >= maximum_paths)
+                cancelled = true;
+            --busy;
+        }
+        changed.notify_all();
+    }
+
+    std::lock_guard<std::mutex> guard(queue_lock);
+    --running;
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Starts listing the directory tree at root.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+PathIndex::PathIndex(const std::string &root)
+    : starts(1, 0), cancelled(false), busy(0), path_count(0), running(0)
+{
+    pending.push_back(root);
+
+    const unsigned count = TaskPool::size();
+    running = count;
+    for (unsigned i = 0; i < count; ++i) {
+        workers.run([this]() { work(); });
+    }
+}
+
+//! Stops the walk and waits for the tasks to finish.
+PathIndex::~PathIndex()
+{
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        cancelled = true;
+    }
+    changed.notify_all();
+    workers.wait();
+}
+
+//! Adds the paths found since the last call to the index.
+/*!
+ * Paths from one directory are in order, but otherwise paths arrive in no particular order.
+ *
+ * \return false if the walk is over. The paths added by that call are the last ones.
+ */
+bool PathIndex::update()
+{
+    std::vector<std::string> found;
+    bool walking;
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        found.swap(queue);
+        walking = running != 0;
+    }
+
+    for (const std::string &path : found) {
+        text += path;
+        for (const char c : path)
+            folded.push_back(fold(c));
+        starts.push_back(text.size());
+        masks.push_back(character_mask(path));
+    }
+    return walking;
+}
+
+//! Returns a mask with a bit for each kind of character in text.
+/*!
+ * Letters (in either case) and digits each have a bit of their own. Every other byte shares
+ * one of the remaining bits. If the mask of one string has bits that are not in the mask of
+ * another, the first string can't be a subsequence of the second.
+ */
+std::uint64_t PathIndex::character_mask(const std::string_view characters)
+{
+    std::uint64_t mask = 0;
+    for (const char c : characters) {
+        const unsigned byte = static_cast<unsigned char>(c);
+        unsigned bit;
+        if (byte >= 'a' && byte <= 'z')
+            bit = byte - 'a';
+        else if (byte >= 'A' && byte <= 'Z')
+            bit = byte - 'A';
+        else if (byte >= '0' && byte <= '9')
+            bit = 26 + (byte - '0');
+        else
+            bit = 36 + byte % 28;
+        mask |= std::uint64_t(1) << bit;
+    }
+    return mask;
+}
@@ -0,0 +1,200 @@
+/*! \file    PipeInput.cpp
+ *  \brief   Implementation of the PipeInput abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "EventLoop.hpp"
+#include "FileList.hpp"
+#include "PipeInput.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
+#include "support.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! Returns the name of the file holding a pipe's text.
+    std::string file_name(const char *const name)
+    {
+        if (std::strcmp(name, "-") == 0)
+            return "*stdin*";
+        return std::string("*") + name + "*";
+    }
+
+#if eOPSYS == ePOSIX
+
+    // The number of bytes read from a pipe at a time.
+    constexpr std::size_t read_size = 64 * 1024;
+
+    // The most bytes taken from a pipe before keystrokes are looked at again.
+    constexpr std::size_t slice_limit = 1024 * 1024;
+
+    int standard_input = -1;        //!< Standard input once claimed (-1 if not or if taken).
+    bool standard_claimed = false;  //!< =true if claim_standard_input succeeded.
+
+    //! A pipe being read into a file.
+    struct Feed {
+        int fd;
+        YEditFile *file;     //!< The file receiving the text. It belongs to the file list.
+        std::string partial; //!< Text following the last complete line.
+    };
+
+    std::vector<Feed> feeds;
+
+    //! Stops reading a pipe.
+    void stop(const int fd)
+    {
+        EventLoop::remove_source(fd);
+        close(fd);
+        feeds.erase(std::remove_if(feeds.begin(), feeds.end(),
+                                   [fd](const Feed &feed) { return feed.fd == fd; }),
+                    feeds.end());
+    }
+
+    //! Adds the complete lines that have arrived on a pipe to its file.
+    void take(const int fd)
+    {
+        auto feed = std::find_if(feeds.begin(), feeds.end(),
+                                 [fd](const Feed &candidate) { return candidate.fd == fd; });
+        if (feed == feeds.end())
+            return;
+        if (!FileList::contains(feed->file)) {
+            stop(fd);
+            return;
+        }
+
+        char buffer[read_size];
+        std::size_t taken = 0;
+        bool at_end = false;
+        while (taken < slice_limit) {
+            const ssize_t count = read(fd, buffer, sizeof(buffer));
+            if (count > 0) {
+                feed->partial.append(buffer, static_cast<std::size_t>(count));
+                taken += static_cast<std::size_t>(count);
+            }
+            else if (count == -1 && errno == EINTR)
+                continue;
+            else {
+                at_end = !(count == -1 && errno == EAGAIN);
+                break;
+            }
+        }
+
+        YEditFile *const file = feed->file;
+        std::size_t complete = feed->partial.size();
+        if (!at_end) {
+            const std::size_t last_newline = feed->partial.rfind('\n');
+            complete = (last_newline == std::string::npos) ? 0 : last_newline + 1;
+        }
+        const bool added = complete != 0;
+        if (added) {
+            file->append_text(feed->partial.data(), complete);
+            feed->partial.erase(0, complete);
+        }
+        if (at_end)
+            stop(fd);
+        if (added && file == &FileList::active_file())
+            WindowList::display();
+    }
+
+#endif
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace PipeInput {
+
+    bool claim_standard_input()
+    {
+#if eOPSYS == ePOSIX
+        if (standard_claimed || isatty(STDIN_FILENO))
+            return false;
+        const int input = dup(STDIN_FILENO);
+        if (input == -1)
+            return false;
+        const int terminal = ::open("/dev/tty", O_RDWR);
+        if (terminal == -1 || dup2(terminal, STDIN_FILENO) == -1) {
+            if (terminal != -1)
+                close(terminal);
+            close(input);
+            return false;
+        }
+        close(terminal);
+        fcntl(input, F_SETFD, FD_CLOEXEC);
+        standard_input = input;
+        standard_claimed = true;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool is_pipe(const char *const name)
+    {
+#if eOPSYS == ePOSIX
+        if (std::strcmp(name, "-") == 0)
+            return standard_claimed;
+        struct stat information;
+        return stat(name, &information) == 0 && S_ISFIFO(information.st_mode);
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    /*!
+     * A named pipe is opened without waiting for a program to write it. Its file stays empty
+     * until one does.
+     */
+    bool open(const char *const name)
+    {
+        const std::string target = file_name(name);
+        if (FileList::lookup(target.c_str()))
+            return true;
+#if eOPSYS == ePOSIX
+        int fd;
+        if (std::strcmp(name, "-") == 0) {
+            fd = standard_input;
+            standard_input = -1;
+        }
+        else
+            fd = ::open(name, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd == -1) {
+            error_message("Can't open %s for reading", name);
+            return false;
+        }
+        if (!FileList::new_file(target.c_str())) {
+            close(fd);
+            return false;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        feeds.push_back(Feed{fd, &FileList::active_file(), std::string()});
+        EventLoop::add_source(fd, [fd]() { take(fd); });
+        return true;
+#else
+        error_message("Can't read %s (pipes are not supported)", name);
+        return false;
+#endif
+    }
+
+} // namespace PipeInput
@@ -0,0 +1,336 @@
+/*! \file    Plugins.cpp
+ *  \brief   Implementation of the Plugins abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <dlfcn.h>
+#elif eOPSYS == eWINDOWS
+#include <windows.h>
+#endif
+
+#include "DiskEditFile.hpp"
+#include "EditBuffer.hpp"
+#include "EventLoop.hpp"
+#include "FileList.hpp"
+#include "Plugins.hpp"
+#include "Profiler.hpp"
+#include "YEditFile.hpp"
+#include "command_table.hpp"
+#include "parameter_stack.hpp"
+#include "support.hpp"
+#include "yexa_plugin.h"
+
+#define SLOW_CALL_TIME 250000000LL // Nanoseconds a plugin may take without a strike.
+#define MAX_STRIKES 3              // Slow calls after which a plugin is disabled.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    struct Plugin {
+        std::string name; //!< The name of its file.
+        void *handle;
+        int strikes = 0;  //!< The number of slow calls.
+        bool disabled = false;
+    };
+
+    struct Command {
+        Plugin *plugin;
+        yexa_command_function function;
+        void *context;
+    };
+
+    struct Subscriber {
+        Plugin *plugin;
+        yexa_edit_function function;
+        void *context;
+    };
+
+    std::vector<std::unique_ptr<Plugin>> plugins;
+    std::deque<Command> commands; //!< Never moved, since add_command is given their addresses.
+    std::vector<Subscriber> subscribers;
+
+    //! The plugin being called, which is the one registering commands or subscribing.
+    Plugin *current = nullptr;
+
+    //! The files whose modifications plugins are told of.
+    std::unordered_set<const YEditFile *> known_files;
+
+    //! Stops calling a plugin that has been too slow.
+    void disable(Plugin &plugin)
+    {
+        plugin.disabled = true;
+        subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                         [&plugin](const Subscriber &subscriber) {
+                                             return subscriber.plugin == &plugin;
+                                         }),
+                          subscribers.end());
+        warning_message("The plugin %.80s was too slow and has been disabled",
+                        plugin.name.c_str());
+    }
+
+    //! Calls into a plugin, timing the call. Returns what the hook returns.
+    template <typename Hook> int call(Plugin &plugin, const Hook &hook)
+    {
+        Plugin *const caller = current;
+        current = &plugin;
+        int result;
+        {
+            Profiler::Scope zone(Profiler::PLUGIN);
+            result = hook();
+        }
+        current = caller;
+        if (Profiler::latest(Profiler::PLUGIN) > SLOW_CALL_TIME && !plugin.disabled &&
+            ++plugin.strikes >= MAX_STRIKES)
+            disable(plugin);
+        return result;
+    }
+
+    //! Runs a command registered by a plugin (see add_command).
+    bool run_plugin_command(void *const context)
+    {
+        const Command &command = *static_cast<const Command *>(context);
+        if (command.plugin->disabled) {
+            error_message("The plugin %.80s is disabled", command.plugin->name.c_str());
+            return false;
+        }
+        return call(*command.plugin,
+                    [&command]() { return command.function(command.context); }) != 0;
+    }
+
+    //! Tells the subscribers of the modifications made since the last call. An idle task.
+    bool publish_edits()
+    {
+        if (subscribers.empty() || DiskEditFile::background_loads() != 0)
+            return false;
+
+        std::vector<yexa_edit> edits;
+        for (unsigned i = 0; i < FileList::count(); ++i) {
+            YEditFile &file = *FileList::file(i);
+            const EditDelta change = file.take_plugin_edits();
+
+            // Files seen for the first time are not reported; their lines can be read.
+            if (known_files.insert(&file).second || change.empty())
+                continue;
+            edits.push_back(
+                yexa_edit{file.name(), change.first, change.old_count, change.new_count});
+        }
+        if (edits.empty())
+            return false;
+
+        // A subscriber may be disabled during the calls.
+        const std::vector<Subscriber> told(subscribers);
+        for (const Subscriber &subscriber : told) {
+            if (subscriber.plugin->disabled)
+                continue;
+            call(*subscriber.plugin, [&]() {
+                subscriber.function(subscriber.context, edits.data(), edits.size());
+                return 1;
+            });
+        }
+        return false;
+    }
+
+    /*------------------------------*/
+    /*  The functions in yexa_api   */
+    /*------------------------------*/
+
+    extern "C" int api_register_command(const char *const name,
+                                        const yexa_command_function function,
+                                        void *const context)
+    {
+        if (current == nullptr || name == nullptr || function == nullptr)
+            return 0;
+        commands.push_back(Command{current, function, context});
+        if (!add_command(name, run_plugin_command, &commands.back())) {
+            commands.pop_back();
+            return 0;
+        }
+        return 1;
+    }
+
+    extern "C" int api_subscribe_edits(const yexa_edit_function function, void *const context)
+    {
+        if (current == nullptr || function == nullptr)
+            return 0;
+
+        // Modifications are reported from now on.
+        if (subscribers.empty()) {
+            static const bool publishing = (EventLoop::add_idle(publish_edits), true);
+            (void)publishing;
+            for (unsigned i = 0; i < FileList::count(); ++i) {
+                YEditFile &file = *FileList::file(i);
+                file.take_plugin_edits();
+                known_files.insert(&file);
+            }
+        }
+        subscribers.push_back(Subscriber{current, function, context});
+        return 1;
+    }
+
+    extern "C" const char *api_file_name()
+    {
+        return FileList::active_file().name();
+    }
+
+    extern "C" long api_line_count()
+    {
+        return FileList::active_file().line_count();
+    }
+
+    extern "C" int api_get_line(const long line, yexa_view *const view)
+    {
+        const EditBuffer *const text = FileList::active_file().line_at(line);
+        if (text == nullptr || view == nullptr)
+            return 0;
+        view->text = text->view().data();
+        view->length = text->view().size();
+        return 1;
+    }
+
+    extern "C" int api_replace_lines(const long first, const long count,
+                                     const yexa_view *const lines, const size_t line_count)
+    {
+        if (first < 0L || count < 0L || (lines == nullptr && line_count != 0))
+            return 0;
+        std::vector<std::string> new_lines;
+        new_lines.reserve(line_count);
+        for (size_t i = 0; i < line_count; ++i)
+            new_lines.emplace_back(lines[i].text, lines[i].length);
+        return FileList::active_file().replace_lines(first, count, new_lines) ? 1 : 0;
+    }
+
+    extern "C" void api_cursor(long *const line, long *const column)
+    {
+        YEditFile &the_file = FileList::active_file();
+        if (line != nullptr)
+            *line = the_file.CP().cursor_line();
+        if (column != nullptr)
+            *column = static_cast<long>(the_file.CP().cursor_column());
+    }
+
+    extern "C" int api_command(const char *const name, const char *const *const parameters,
+                               const size_t parameter_count)
+    {
+        const int index = (name == nullptr) ? -1 : find_command(name);
+        if (index < 0)
+            return 0;
+
+        // The command pops its first parameter first, so that one goes on top.
+        for (size_t i = parameter_count; i > 0; --i)
+            parameter_stack.push(EditBuffer(parameters[i - 1], std::strlen(parameters[i - 1])));
+        execute_command(index);
+        return 1;
+    }
+
+    extern "C" void api_message(const char *const text)
+    {
+        if (text != nullptr)
+            warning_message("%.120s", text);
+    }
+
+    const yexa_api api = {YEXA_PLUGIN_ABI_VERSION, sizeof(yexa_api), api_register_command,
+                          api_subscribe_edits,     api_file_name,     api_line_count,
+                          api_get_line,            api_replace_lines, api_cursor,
+                          api_command,             api_message};
+
+    /*------------------------------*/
+    /*  Shared libraries            */
+    /*------------------------------*/
+
+    void *open_library(const char *const file_name)
+    {
+#if eOPSYS == ePOSIX
+        return dlopen(file_name, RTLD_NOW | RTLD_LOCAL);
+#elif eOPSYS == eWINDOWS
+        return reinterpret_cast<void *>(LoadLibraryA(file_name));
+#endif
+    }
+
+    void *find_symbol(void *const handle, const char *const name)
+    {
+#if eOPSYS == ePOSIX
+        return dlsym(handle, name);
+#elif eOPSYS == eWINDOWS
+        return reinterpret_cast<void *>(GetProcAddress(static_cast<HMODULE>(handle), name));
+#endif
+    }
+
+    void close_library(void *const handle)
+    {
+#if eOPSYS == ePOSIX
+        dlclose(handle);
+#elif eOPSYS == eWINDOWS
+        FreeLibrary(static_cast<HMODULE>(handle));
+#endif
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Plugins {
+
+    bool load(const char *const file_name)
+    {
+        for (const std::unique_ptr<Plugin> &plugin : plugins) {
+            if (plugin->name == file_name) {
+                error_message("The plugin %.80s is already loaded", file_name);
+                return false;
+            }
+        }
+
+        void *const handle = open_library(file_name);
+        if (handle == nullptr) {
+            error_message("Can't load the plugin %.80s", file_name);
+            return false;
+        }
+        typedef unsigned (*VersionFunction)();
+        typedef int (*StartFunction)(const yexa_api *);
+        const auto version = reinterpret_cast<VersionFunction>(
+            find_symbol(handle, "yexa_plugin_abi_version"));
+        const auto start =
+            reinterpret_cast<StartFunction>(find_symbol(handle, "yexa_plugin_start"));
+        if (version == nullptr || start == nullptr) {
+            close_library(handle);
+            error_message("%.80s is not a plugin", file_name);
+            return false;
+        }
+        if (version() == 0 || version() > YEXA_PLUGIN_ABI_VERSION) {
+            close_library(handle);
+            error_message("The plugin %.80s needs a newer editor", file_name);
+            return false;
+        }
+
+        // A plugin that fails to start may have registered commands, so it is kept, disabled.
+        plugins.emplace_back(new Plugin{file_name, handle});
+        Plugin &plugin = *plugins.back();
+        if (call(plugin, [start]() { return start(&api); }) == 0) {
+            plugin.disabled = true;
+            error_message("The plugin %.80s failed to start", file_name);
+            return false;
+        }
+        return true;
+    }
+
+    void forget(YEditFile &file)
+    {
+        known_files.erase(&file);
+    }
+
+} // namespace Plugins
@@ -0,0 +1,139 @@
+/*! \file    ProcedureIndex.cpp
+ *  \brief   Implementation of class ProcedureIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstddef>
+
+#include "ProcedureIndex.hpp"
+
+namespace {
+    bool start_before(const ProcedureIndex::Procedure &procedure, const long line)
+    {
+        return procedure.start < line;
+    }
+
+    bool open_before(const ProcedureIndex::Scope &scope, const long line)
+    {
+        return scope.open < line;
+    }
+} // namespace
+
+//! Creates an index of a file in which no lines have been examined.
+ProcedureIndex::ProcedureIndex() : scanned_lines(0), finished(false)
+{
+}
+
+//! Forgets everything learned about the lines from first_line on.
+/*!
+ * Examination resumes at first_line. This must be called whenever a line is modified,
+ * inserted, or deleted, with the lowest such line. The scopes that were open before first_line
+ * are reopened. They are the last scope opened before first_line, if it was still open, and
+ * its ancestors (every scope open at a line encloses every scope opened after it).
+ */
+void ProcedureIndex::invalidate(long first_line)
+{
+    finished = false;
+    if (first_line >= scanned_lines)
+        return;
+
+    first_line = std::max(first_line, 0L);
+    scanned_lines = first_line;
+    found.erase(std::lower_bound(found.begin(), found.end(), scanned_lines, start_before),
+                found.end());
+    tree.erase(std::lower_bound(tree.begin(), tree.end(), scanned_lines, open_before),
+               tree.end());
+
+    open_scopes.clear();
+    long scope = static_cast<long>(tree.size()) - 1;
+    while (scope >= 0 && tree[scope].close >= 0 && tree[scope].close < scanned_lines) {
+        scope = tree[scope].parent;
+    }
+    for (; scope >= 0; scope = tree[scope].parent) {
+        tree[scope].close = -1;
+        open_scopes.push_back(scope);
+    }
+    std::reverse(open_scopes.begin(), open_scopes.end());
+}
+
+//! Records a procedure identified by the next line to be examined.
+void ProcedureIndex::add(const long head, const long start)
+{
+    found.push_back(Procedure{head, start});
+}
+
+//! Records that the next line to be examined opens a scope.
+void ProcedureIndex::open_scope()
+{
+    const long parent = open_scopes.empty() ? -1L : open_scopes.back();
+    open_scopes.push_back(static_cast<long>(tree.size()));
+    tree.push_back(Scope{scanned_lines, -1L, parent});
+}
+
+//! Records that the next line to be examined closes the innermost open scope.
+/*!
+ * Closing a scope when none are open is ignored.
+ */
+void ProcedureIndex::close_scope()
+{
+    if (open_scopes.empty())
+        return;
+    tree[open_scopes.back()].close = scanned_lines;
+    open_scopes.pop_back();
+}
+
+//! Returns the first procedure starting after the given line, or nullptr if there is none.
+const ProcedureIndex::Procedure *ProcedureIndex::following(const long line) const
+{
+    auto result = std::lower_bound(found.begin(), found.end(), line + 1, start_before);
+    return (result == found.end()) ? nullptr : &*result;
+}
+
+//! Returns the last procedure starting before the given line, or nullptr if there is none.
+const ProcedureIndex::Procedure *ProcedureIndex::preceding(const long line) const
+{
+    auto result = std::lower_bound(found.begin(), found.end(), line, start_before);
+    return (result == found.begin()) ? nullptr : &*(result - 1);
+}
+
+//! Returns a procedure with the given head line, or nullptr if there is none.
+/*!
+ * The head of a procedure is never after its start and never more than a few lines before it.
+ */
+const ProcedureIndex::Procedure *ProcedureIndex::headed_at(const long line) const
+{
+    for (auto it = std::lower_bound(found.begin(), found.end(), line, start_before);
+         it != found.end() && it->head <= line; ++it) {
+        if (it->head == line)
+            return &*it;
+    }
+    return nullptr;
+}
+
+//! Returns the innermost scope enclosing the given line, or nullptr if there is none.
+/*!
+ * A scope encloses the lines after its open line up to and including its close line. The
+ * search starts with the last scope opened before the line and moves outward, so it takes
+ * time proportional to the nesting depth.
+ */
+const ProcedureIndex::Scope *ProcedureIndex::enclosing(const long line) const
+{
+    long scope = (std::lower_bound(tree.begin(), tree.end(), line, open_before) - tree.begin());
+    for (--scope; scope >= 0; scope = tree[scope].parent) {
+        if (tree[scope].close < 0 || tree[scope].close >= line)
+            return &tree[scope];
+    }
+    return nullptr;
+}
+
+//! Returns true if the given line opens a scope that it does not also close.
+bool ProcedureIndex::opens_scope(const long line) const
+{
+    for (auto it = std::lower_bound(tree.begin(), tree.end(), line, open_before);
+         it != tree.end() && it->open == line; ++it) {
+        if (it->close != line)
+            return true;
+    }
+    return false;
+}
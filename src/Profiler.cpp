@@ -0,0 +1,138 @@
+/*! \file    Profiler.cpp
+ *  \brief   Implementation of the Profiler abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Profiler.hpp"
+#include "Trace.hpp"
+
+#define BUCKET_COUNT 24 // Time buckets: < 1 us, < 2 us, ... and 4 s or more.
+#define BAR_WIDTH 30    // Longest bar shown by report().
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! What is known about the times of one zone. Times are in nanoseconds.
+    struct ZoneTimes {
+        unsigned long count = 0;
+        long long total = 0;
+        long long least = 0;
+        long long most = 0;
+        long long latest = 0;
+        unsigned long buckets[BUCKET_COUNT] = {};
+    };
+
+    const char *const zone_names[Profiler::ZONE_COUNT] = {
+        "load", "save", "search", "display", "flush", "macro", "plugin"};
+
+    std::mutex lock; // Protects zones (files are loaded and saved on other threads too).
+    ZoneTimes zones[Profiler::ZONE_COUNT];
+
+    //! Adds the lines showing the histogram of a zone to lines.
+    void report_buckets(const ZoneTimes &times, std::vector<std::string> &lines)
+    {
+        const unsigned long *const end = times.buckets + BUCKET_COUNT;
+        const int first = static_cast<int>(
+            std::find_if(times.buckets, end, [](unsigned long n) { return n != 0; }) -
+            times.buckets);
+        int last = BUCKET_COUNT - 1;
+        while (last > first && times.buckets[last] == 0)
+            --last;
+
+        // Each bucket is shown with a bar scaled to the largest one.
+        const unsigned long largest = *std::max_element(times.buckets, end);
+        char line[81];
+        for (int bucket = first; bucket <= last; ++bucket) {
+            if (bucket < BUCKET_COUNT - 1)
+                std::snprintf(line, sizeof(line), "  < %7ld us %7lu ", 1L << bucket,
+                              times.buckets[bucket]);
+            else
+                std::snprintf(line, sizeof(line), " >= %7ld us %7lu ", 1L << (bucket - 1),
+                              times.buckets[bucket]);
+            std::string text(line);
+            text.append((times.buckets[bucket] * BAR_WIDTH + largest - 1) / largest, '#');
+            lines.push_back(text);
+        }
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Profiler {
+
+    void record(const Zone zone, const long long nanoseconds)
+    {
+        Trace::complete(zone_names[zone], "zone", Trace::now() - nanoseconds, nanoseconds);
+
+        int bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && nanoseconds >= (1000LL << bucket))
+            ++bucket;
+
+        std::lock_guard<std::mutex> guard(lock);
+        ZoneTimes &times = zones[zone];
+        ++times.buckets[bucket];
+        times.least = (times.count == 0) ? nanoseconds : std::min(times.least, nanoseconds);
+        times.most = std::max(times.most, nanoseconds);
+        times.total += nanoseconds;
+        times.latest = nanoseconds;
+        ++times.count;
+    }
+
+    long long latest(const Zone zone)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        return zones[zone].latest;
+    }
+
+    void reset()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        std::fill(std::begin(zones), std::end(zones), ZoneTimes());
+    }
+
+    std::vector<std::string> report()
+    {
+        ZoneTimes copy[ZONE_COUNT];
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::copy(std::begin(zones), std::end(zones), copy);
+        }
+
+        std::vector<std::string> lines;
+        char line[81];
+        lines.push_back("Zone         Count    Total ms     Mean us    Least us     Most us");
+        for (int zone = 0; zone < ZONE_COUNT; ++zone) {
+            const ZoneTimes &times = copy[zone];
+            if (times.count == 0)
+                std::snprintf(line, sizeof(line), "%-8s %9lu", zone_names[zone], times.count);
+            else
+                std::snprintf(line, sizeof(line), "%-8s %9lu %11.1f %11.1f %11.1f %11.1f",
+                              zone_names[zone], times.count, times.total / 1e6,
+                              times.total / 1e3 / times.count, times.least / 1e3,
+                              times.most / 1e3);
+            lines.push_back(line);
+        }
+
+        for (int zone = 0; zone < ZONE_COUNT; ++zone) {
+            if (copy[zone].count == 0)
+                continue;
+            lines.push_back("");
+            lines.push_back(zone_names[zone]);
+            report_buckets(copy[zone], lines);
+        }
+        return lines;
+    }
+
+} // namespace Profiler
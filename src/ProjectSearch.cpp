@@ -0,0 +1,294 @@
+/*! \file    ProjectSearch.cpp
+ *  \brief   Implementation of class ProjectSearch.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <dirent.h>
+#include <sys/stat.h>
+#elif eOPSYS == eWINDOWS
+#include <windows.h>
+#endif
+
+#include "MappedFile.hpp"
+#include "ProjectSearch.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+#if eOPSYS == eWINDOWS
+    constexpr char separator = '\\';
+#else
+    constexpr char separator = '/';
+#endif
+
+    // Directories that are never searched, in addition to those whose names start with '.'.
+    const char *const ignored_directories[] = {"CVS", "node_modules", "__pycache__"};
+
+    // Files with a null byte in this many leading bytes are assumed to be binary.
+    constexpr std::size_t binary_check_size = 4096;
+
+    // Long lines are shortened to this many characters in the hits.
+    constexpr std::size_t maximum_hit_text = 256;
+
+    // The search stops after this many hits; more would not be useful to browse.
+    constexpr std::size_t maximum_hits = 100000;
+
+    // Hits are handed over to the queue in batches to keep lock traffic down.
+    constexpr std::size_t batch_size = 64;
+
+    bool is_ignored(const char *name)
+    {
+        if (name[0] == '.')
+            return true;
+        for (const char *ignored : ignored_directories) {
+            if (std::strcmp(name, ignored) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    std::string join(const std::string &directory, const char *name)
+    {
+        if (directory == ".")
+            return name;
+        std::string result(directory);
+        if (result.back() != separator)
+            result.push_back(separator);
+        return result += name;
+    }
+
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Searches one file, adding a hit for each line that contains the pattern.
+void ProjectSearch::search_file(const std::string &path, const SearchPattern &pattern,
+                                std::vector<Hit> &hits)
+{
+    MappedFile image;
+    if (!image.open(path.c_str()) || image.size() == 0)
+        return;
+    ++searched;
+
+    const std::string_view text(image.data(), image.size());
+    if (std::memchr(text.data(), '\0', std::min(text.size(), binary_check_size)) != nullptr)
+        return;
+
+    auto add_hit = [&](const long line_number, std::string_view line, std::size_t column) {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        hits.push_back(Hit{path, line_number, static_cast<unsigned>(column),
+                           std::string(line.substr(0, maximum_hit_text))});
+    };
+
+    // Literal patterns can't span lines so the whole file is searched at once. The line
+    // numbers are then worked out only for the lines that match.
+    if (pattern.mode() == SearchPattern::LITERAL) {
+        long line_number = 0;
+        std::size_t line_start = 0;
+        std::size_t found;
+        while ((found = pattern.find(text, line_start)) != SearchPattern::npos) {
+            for (std::size_t newline = text.find('\n', line_start); newline < found;
+                 newline = text.find('\n', line_start)) {
+                ++line_number;
+                line_start = newline + 1;
+            }
+            std::size_t line_end = text.find('\n', found);
+            if (line_end == std::string_view::npos)
+                line_end = text.size();
+            add_hit(line_number, text.substr(line_start, line_end - line_start),
+                    found - line_start);
+            if (line_end == text.size() || cancelled)
+                break;
+            ++line_number;
+            line_start = line_end + 1;
+        }
+        return;
+    }
+
+    // Regular expressions may be anchored to the ends of lines, so they are applied one line
+    // at a time.
+    long line_number = 0;
+    for (std::size_t line_start = 0; line_start < text.size() && !cancelled; ++line_number) {
+        std::size_t line_end = text.find('\n', line_start);
+        if (line_end == std::string_view::npos)
+            line_end = text.size();
+        std::string_view line = text.substr(line_start, line_end - line_start);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        const std::size_t found = pattern.find(line);
+        if (found != SearchPattern::npos)
+            add_hit(line_number, line, found);
+        line_start = line_end + 1;
+    }
+}
+
+//! Lists and searches directories until none are left. Runs as a task (see TaskPool).
+void ProjectSearch::work(SearchPattern pattern)
+{
+    std::vector<std::string> directories;
+    std::vector<std::string> files;
+    std::vector<Hit> hits;
+
+    for (;;) {
+        std::string directory;
+        {
+            std::unique_lock<std::mutex> guard(queue_lock);
+            changed.wait(guard, [this] { return cancelled || !pending.empty() || busy == 0; });
+            if (cancelled || pending.empty())
+                break;
+            directory = std::move(pending.back());
+            pending.pop_back();
+            ++busy;
+        }
+
+        Trace::Span span("search directory");
+        directories.clear();
+        files.clear();
+        list_directory(directory, directories, files);
+        std::sort(files.begin(), files.end());
+        for (const std::string &file : files) {
+            if (cancelled)
+                break;
+            search_file(file, pattern, hits);
+            if (hits.size() >= batch_size) {
+                std::lock_guard<std::mutex> guard(queue_lock);
+                hit_count += hits.size();
+                std::move(hits.begin(), hits.end(), std::back_inserter(queue));
+                hits.clear();
+                if (hit_count >= maximum_hits)
+                    cancelled = true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            hit_count += hits.size();
+            std::move(hits.begin(), hits.end(), std::back_inserter(queue));
+            hits.clear();
+            std::move(directories.begin(), directories.end(), std::back_inserter(pending));
+            --busy;
+        }
+        changed.notify_all();
+    }
+
+    std::lock_guard<std::mutex> guard(queue_lock);
+    --running;
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Starts searching the directory tree at root for the pattern.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+ProjectSearch::ProjectSearch(const SearchPattern &pattern, const std::string &root)
+    : cancelled(false), searched(0), busy(0), hit_count(0), running(0)
+{
+    pending.push_back(root);
+
+    const unsigned count = TaskPool::size();
+    running = count;
+    for (unsigned i = 0; i < count; ++i) {
+        workers.run([this, pattern]() { work(pattern); });
+    }
+}
+
+//! Stops the search and waits for the tasks to finish.
+ProjectSearch::~ProjectSearch()
+{
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        cancelled = true;
+    }
+    changed.notify_all();
+    workers.wait();
+}
+
+//! Moves the hits found since the last call onto the end of the given vector.
+/*!
+ * Hits from one file are in order, but otherwise hits arrive in no particular order.
+ *
+ * \return false if the search is over. The hits moved by that call are the last ones.
+ */
+bool ProjectSearch::collect(std::vector<Hit> &hits)
+{
+    std::lock_guard<std::mutex> guard(queue_lock);
+    std::move(queue.begin(), queue.end(), std::back_inserter(hits));
+    queue.clear();
+    return running != 0;
+}
+
+//! Lists a directory, sorting its entries into subdirectories and regular files.
+/*!
+ * Symbolic links to directories are not followed so that cycles can't occur. Directories that a
+ * search passes over are left out of the subdirectories.
+ */
+void ProjectSearch::list_directory(const std::string &directory,
+                                   std::vector<std::string> &directories,
+                                   std::vector<std::string> &files)
+{
+#if eOPSYS == ePOSIX
+    DIR *listing = opendir(directory.c_str());
+    if (listing == nullptr)
+        return;
+
+    while (struct dirent *entry = readdir(listing)) {
+        bool is_directory = false;
+        bool is_file = false;
+#if defined(DT_DIR)
+        if (entry->d_type == DT_DIR)
+            is_directory = true;
+        else if (entry->d_type == DT_REG)
+            is_file = true;
+        else if (entry->d_type == DT_UNKNOWN)
+#endif
+        {
+            // The file system doesn't report types in directory entries.
+            struct stat file_info;
+            if (lstat(join(directory, entry->d_name).c_str(), &file_info) == 0) {
+                is_directory = S_ISDIR(file_info.st_mode);
+                is_file = S_ISREG(file_info.st_mode);
+            }
+        }
+
+        if (is_directory && !is_ignored(entry->d_name))
+            directories.push_back(join(directory, entry->d_name));
+        else if (is_file)
+            files.push_back(join(directory, entry->d_name));
+    }
+    closedir(listing);
+
+#elif eOPSYS == eWINDOWS
+    WIN32_FIND_DATA entry;
+    HANDLE listing = FindFirstFile(join(directory, "*").c_str(), &entry);
+    if (listing == INVALID_HANDLE_VALUE)
+        return;
+
+    do {
+        if (entry.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)
+            continue;
+        if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (!is_ignored(entry.cFileName))
+                directories.push_back(join(directory, entry.cFileName));
+        }
+        else {
+            files.push_back(join(directory, entry.cFileName));
+        }
+    } while (FindNextFile(listing, &entry));
+    FindClose(listing);
+#endif
+}
@@ -0,0 +1,263 @@
+/*! \file    PromptHistory.cpp
+ *  \brief   Implementation of the PromptHistory abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ *
+ * The history is saved as text. The first line names the format. Each line after that is an
+ * entry: its prompt, a tab, and its text, with backslashes, tabs, and line breaks written as
+ * escapes. The entries of each prompt are written oldest first, so reading them back with add
+ * numbers them as they were.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "PromptHistory.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    const char header[] = "Y History 1";
+
+    //! A place in a ring. It is empty if its number is zero.
+    struct Slot {
+        std::uint64_t number = 0;
+        std::string text;
+    };
+
+    //! The history of one prompt.
+    struct History {
+        std::vector<Slot> ring;   //!< Entry n is in slot (n - 1) % capacity, if it is kept.
+        std::uint64_t latest = 0; //!< The number of the latest entry.
+        std::map<std::string, std::uint64_t, std::less<>> index; //!< Numbers by text.
+
+        //! Returns the slot holding the given entry, or nullptr if it isn't kept.
+        const Slot *slot(const std::uint64_t number) const
+        {
+            if (number == 0 || number > latest || latest - number >= PromptHistory::capacity)
+                return nullptr;
+            const Slot &place = ring[(number - 1) % PromptHistory::capacity];
+            return (place.number == number) ? &place : nullptr;
+        }
+
+        //! Returns the number of the oldest entry that might still be kept.
+        std::uint64_t oldest() const
+        {
+            const std::uint64_t kept = PromptHistory::capacity;
+            return (latest > kept) ? latest - kept + 1 : 1;
+        }
+    };
+
+    std::map<std::string, History, std::less<>> histories;
+
+    //! Appends text to line with backslashes, tabs, and line breaks escaped.
+    void escape(const std::string_view text, std::string &line)
+    {
+        for (const char ch : text) {
+            switch (ch) {
+            case '\\':
+                line.append("\\\\");
+                break;
+            case '\t':
+                line.append("\\t");
+                break;
+            case '\n':
+                line.append("\\n");
+                break;
+            case '\r':
+                line.append("\\r");
+                break;
+            default:
+                line.push_back(ch);
+                break;
+            }
+        }
+    }
+
+    //! Returns text with the escapes written by escape undone.
+    std::string unescape(const std::string_view text)
+    {
+        std::string result;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (text[i] != '\\' || i + 1 == text.size()) {
+                result.push_back(text[i]);
+                continue;
+            }
+            switch (text[++i]) {
+            case 't':
+                result.push_back('\t');
+                break;
+            case 'n':
+                result.push_back('\n');
+                break;
+            case 'r':
+                result.push_back('\r');
+                break;
+            default:
+                result.push_back(text[i]);
+                break;
+            }
+        }
+        return result;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace PromptHistory {
+
+    void add(const std::string_view prompt, const std::string_view text)
+    {
+        auto found = histories.find(prompt);
+        if (found == histories.end())
+            found = histories.emplace(std::string(prompt), History()).first;
+        History &history = found->second;
+        if (history.ring.empty())
+            history.ring.resize(capacity);
+
+        // Text entered before leaves an empty slot where it was.
+        const auto known = history.index.find(text);
+        if (known != history.index.end()) {
+            Slot &old = history.ring[(known->second - 1) % capacity];
+            old.number = 0;
+            old.text.clear();
+            history.index.erase(known);
+        }
+
+        // The oldest entry is forgotten when its slot is needed.
+        const std::uint64_t number = ++history.latest;
+        Slot &place = history.ring[(number - 1) % capacity];
+        if (place.number != 0)
+            history.index.erase(place.text);
+        place.number = number;
+        place.text.assign(text.data(), text.size());
+        history.index.emplace(place.text, number);
+    }
+
+    std::size_t size(const std::string_view prompt)
+    {
+        const auto found = histories.find(prompt);
+        return (found == histories.end()) ? 0 : found->second.index.size();
+    }
+
+    /*!
+     * Without a prefix the ring is stepped through from the given entry, so each step costs
+     * only the empty slots passed over. With a prefix only the entries starting with it are
+     * looked at, found together in the index.
+     */
+    bool find(const std::string_view prompt, const std::string_view prefix, const bool older,
+              std::uint64_t &entry, std::string &text)
+    {
+        const auto found = histories.find(prompt);
+        if (found == histories.end() || (!older && entry == 0))
+            return false;
+        const History &history = found->second;
+
+        std::uint64_t result = 0;
+        if (prefix.empty()) {
+            if (older) {
+                for (std::uint64_t number = (entry == 0) ? history.latest : entry - 1;
+                     number >= history.oldest() && result == 0; --number) {
+                    if (history.slot(number) != nullptr)
+                        result = number;
+                }
+            }
+            else {
+                for (std::uint64_t number = std::max(entry + 1, history.oldest());
+                     number <= history.latest && result == 0; ++number) {
+                    if (history.slot(number) != nullptr)
+                        result = number;
+                }
+            }
+        }
+        else {
+            for (auto it = history.index.lower_bound(prefix);
+                 it != history.index.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+                 ++it) {
+                const std::uint64_t number = it->second;
+                if (older && (entry == 0 || number < entry) && number > result)
+                    result = number;
+                else if (!older && number > entry && (result == 0 || number < result))
+                    result = number;
+            }
+        }
+
+        if (result == 0)
+            return false;
+        entry = result;
+        text = history.slot(result)->text;
+        return true;
+    }
+
+    bool read(const char *const path)
+    {
+        std::FILE *input;
+        if ((input = std::fopen(path, "rb")) == nullptr)
+            return false;
+        std::string contents;
+        char block[8192];
+        std::size_t count;
+        while ((count = std::fread(block, 1, sizeof(block), input)) > 0)
+            contents.append(block, count);
+        std::fclose(input);
+
+        const std::string_view text(contents);
+        std::size_t start = text.find('\n');
+        if (start == std::string_view::npos || text.substr(0, start) != header)
+            return false;
+
+        histories.clear();
+        while (++start < text.size()) {
+            std::size_t end = text.find('\n', start);
+            if (end == std::string_view::npos)
+                end = text.size();
+            const std::string_view line = text.substr(start, end - start);
+            const std::size_t tab = line.find('\t');
+            if (tab != std::string_view::npos)
+                add(unescape(line.substr(0, tab)), unescape(line.substr(tab + 1)));
+            start = end;
+        }
+        return true;
+    }
+
+    bool write(const char *const path)
+    {
+        std::string contents(header);
+        contents.push_back('\n');
+        for (const auto &prompt : histories) {
+            const History &history = prompt.second;
+            for (std::uint64_t number = history.oldest(); number <= history.latest; ++number) {
+                const Slot *const place = history.slot(number);
+                if (place == nullptr)
+                    continue;
+                escape(prompt.first, contents);
+                contents.push_back('\t');
+                escape(place->text, contents);
+                contents.push_back('\n');
+            }
+        }
+
+        std::FILE *output;
+        if ((output = std::fopen(path, "wb")) == nullptr)
+            return false;
+        const bool written =
+            std::fwrite(contents.data(), 1, contents.size(), output) == contents.size();
+        if (std::fclose(output) != 0 || !written) {
+            std::remove(path);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace PromptHistory
@@ -0,0 +1,935 @@
+/*! \file    Recovery.cpp
+ *  \brief   Implementation of the Recovery abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <new>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <io.h>
+#include <windows.h>
+#endif
+
+#include "EditBuffer.hpp"
+#include "Recovery.hpp"
+#include "Trace.hpp"
+#include "support.hpp"
+
+using Recovery::Slot;
+
+/*
+ * A snapshot is a single record holding the generation of the snapshot, the name of the file,
+ * and its lines. A journal starts with a record holding the generation of the snapshot it
+ * follows. Each of its other records replaces a range of lines. Numbers are written in decimal
+ * and each line (or name) as its length, a space, and its text. Every record ends with a
+ * checksum so that a record left incomplete by a crash is recognized and ignored.
+ *
+ *     YEXA SNAPSHOT 2\n              YEXA JOURNAL 2\n
+ *     <generation>\n                 <generation>\n
+ *     <length> <name>\n              E <checksum>\n
+ *     <count>\n                      <first> <old count> <new count>\n
+ *     <length> <line>\n ...          <length> <line>\n ...
+ *     E <checksum>\n                 E <checksum>\n ...
+ */
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    // After writing a batch the writer waits this long, letting the next batch collect.
+    constexpr std::chrono::milliseconds batch_interval(200);
+
+    // A new snapshot is wanted once the journal is this fraction of the snapshot's size.
+    constexpr std::size_t snapshot_ratio = 4;
+
+    // The approximate number of bytes used to record a line in addition to its text.
+    constexpr std::size_t line_overhead = 8;
+
+    // Output is accumulated in blocks of this size before being handed to the OS.
+    constexpr std::size_t output_block_size = 64 * 1024;
+
+    const char snapshot_magic[] = "YEXA SNAPSHOT 2\n";
+    const char journal_magic[] = "YEXA JOURNAL 2\n";
+    const char snapshot_extension[] = ".ys";
+    const char journal_extension[] = ".yj";
+    const char temporary_extension[] = ".ys.tmp";
+
+    //! Returns the checksum written for a record: the low 32 bits of its FNV-1a hash.
+    std::uint32_t checksum(const std::uint64_t hash)
+    {
+        return static_cast<std::uint32_t>(hash);
+    }
+
+    //! Writes records to a file.
+    class Encoder {
+      public:
+        explicit Encoder(std::FILE *file) : output(file), sum(fnv_basis), good(true) {}
+
+        //! Writes bytes as they are.
+        void literal(const std::string_view bytes) { put(bytes); }
+
+        //! Writes a number followed by the terminator.
+        void number(const unsigned long value, const char terminator)
+        {
+            put(std::to_string(value));
+            put(std::string_view(&terminator, 1));
+        }
+
+        //! Writes a line (or a name).
+        void text(const std::string_view value)
+        {
+            number(value.size(), ' ');
+            put(value);
+            put("\n");
+        }
+
+        //! Ends the current record with its checksum.
+        void seal()
+        {
+            pending.append("E ");
+            pending.append(std::to_string(checksum(sum)));
+            pending.push_back('\n');
+            sum = fnv_basis;
+            if (pending.size() >= output_block_size)
+                flush();
+        }
+
+        //! Hands the bytes written so far to the OS. Returns false if any write failed.
+        bool flush()
+        {
+            if (!pending.empty() &&
+                std::fwrite(pending.data(), 1, pending.size(), output) != pending.size())
+                good = false;
+            pending.clear();
+            return good;
+        }
+
+      private:
+        std::FILE *output;
+        std::string pending; //!< Bytes not yet handed to the OS.
+        std::uint64_t sum;   //!< The hash of the current record so far.
+        bool good;           //!< =false if a write has failed.
+
+        void put(const std::string_view bytes)
+        {
+            sum = fnv1a(bytes, sum);
+            pending.append(bytes);
+            if (pending.size() >= output_block_size)
+                flush();
+        }
+    };
+
+    //! Reads records written by an Encoder.
+    class Decoder {
+      public:
+        explicit Decoder(const std::string_view text) : rest(text), start(text.data()) {}
+
+        //! Reads exactly the expected bytes.
+        bool literal(const std::string_view expected)
+        {
+            if (rest.substr(0, expected.size()) != expected)
+                return false;
+            rest.remove_prefix(expected.size());
+            return true;
+        }
+
+        //! Reads a number followed by the terminator.
+        bool number(unsigned long &value, const char terminator)
+        {
+            std::size_t digits = 0;
+            value = 0;
+            while (digits < rest.size() && rest[digits] >= '0' && rest[digits] <= '9') {
+                value = 10 * value + static_cast<unsigned long>(rest[digits] - '0');
+                ++digits;
+            }
+            if (digits == 0 || digits > 18 || digits >= rest.size() ||
+                rest[digits] != terminator)
+                return false;
+            rest.remove_prefix(digits + 1);
+            return true;
+        }
+
+        //! Reads a line (or a name).
+        bool text(std::string_view &value)
+        {
+            unsigned long length;
+            if (!number(length, ' ') || length >= rest.size() || rest[length] != '\n')
+                return false;
+            value = rest.substr(0, length);
+            rest.remove_prefix(length + 1);
+            return true;
+        }
+
+        //! Reads the checksum that ends a record. Returns false if it is missing or wrong.
+        bool seal()
+        {
+            const std::string_view record(start, static_cast<std::size_t>(rest.data() - start));
+            unsigned long sum;
+            if (!literal("E ") || !number(sum, '\n') || sum != checksum(fnv1a(record)))
+                return false;
+            start = rest.data();
+            return true;
+        }
+
+        bool at_end() const { return rest.empty(); }
+
+      private:
+        std::string_view rest; //!< The text not yet read.
+        const char *start;     //!< The start of the current record.
+    };
+
+    //! Lines copied for the writer. Runs of empty lines are counted rather than copied.
+    struct Lines {
+        std::vector<EditBuffer> text; //!< The lines that are not empty.
+        long count = 0;               //!< The number of lines in all, empty or not.
+
+        //! The runs of empty lines: the index in text of the line after each and its length.
+        std::vector<std::pair<std::size_t, long>> empty;
+    };
+
+    //! Something for the writer to do.
+    struct Task {
+        enum Kind { SNAPSHOT, RECORD, CLOSE, REMOVE };
+
+        Kind kind;
+        Slot slot;                     //!< The file concerned (not used by REMOVE).
+        unsigned long generation;      //!< SNAPSHOT: The generation of the new snapshot.
+        std::string name;              //!< SNAPSHOT: The file's name. REMOVE: The data's stem.
+        long first;                    //!< RECORD: The first line replaced.
+        long old_count;                //!< RECORD: The number of lines replaced.
+        Lines lines;                   //!< SNAPSHOT: The lines. RECORD: The new lines.
+    };
+
+    //! What the main thread knows about the data kept for one file.
+    struct Kept {
+        std::string name;              //!< The file's name.
+        unsigned long generation = 0;  //!< The generation of the newest snapshot.
+        std::size_t snapshot_bytes = 0; //!< The approximate size of the newest snapshot.
+        std::size_t journal_bytes = 0; //!< The approximate size of the journal since then.
+        bool stale = false;            //!< =true if a record was lost; a snapshot is needed.
+    };
+
+    //! Writes snapshots and journal records on a thread of its own.
+    class Writer {
+      public:
+        void submit(Task task);
+        void finish();
+
+      private:
+        std::mutex lock;                 //!< Protects tasks and stopping.
+        std::condition_variable wake;    //!< Signaled when there is a task or stopping is set.
+        std::deque<Task> tasks;          //!< Tasks not yet started, in order.
+        bool stopping = false;           //!< =true when the writer should stop.
+        std::thread worker;
+
+        // Used only by the worker (or once it has stopped).
+        std::map<Slot, std::FILE *> journals; //!< Open journals.
+
+        void run();
+        void perform(Task &task, std::set<Slot> &written);
+        void close_journal(Slot slot);
+    };
+
+    //! Everything known about the data being kept.
+    struct State {
+        std::string directory;     //!< The recovery directory with a trailing separator.
+        std::map<Slot, Kept> kept; //!< The files with recovery data.
+        Slot last_slot = 0;        //!< The newest slot.
+        Writer writer;
+    };
+
+    //! Returns the state. It is never destroyed so that files may be closed during exit.
+    State &state()
+    {
+        static State *const the_state = new State;
+        return *the_state;
+    }
+
+    //! Returns the writer.
+    Writer &writer()
+    {
+        return state().writer;
+    }
+
+    //! Returns the identifier of this process.
+    unsigned long process_id()
+    {
+#if eOPSYS == ePOSIX
+        return static_cast<unsigned long>(getpid());
+#elif eOPSYS == eWINDOWS
+        return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+        return 0;
+#endif
+    }
+
+    //! Returns true if the process with the given identifier is running.
+    bool running(const unsigned long id)
+    {
+#if eOPSYS == ePOSIX
+        return kill(static_cast<pid_t>(id), 0) == 0 || errno == EPERM;
+#elif eOPSYS == eWINDOWS
+        HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(id));
+        if (process == nullptr)
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        const bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+        CloseHandle(process);
+        return alive;
+#else
+        (void)id;
+        return true;
+#endif
+    }
+
+    //! Returns the path of the current directory with a trailing separator ("" if unknown).
+    std::string current_directory()
+    {
+        std::string result;
+#if eOPSYS == ePOSIX
+        char buffer[4096];
+        if (getcwd(buffer, sizeof(buffer)) != nullptr) {
+            result = buffer;
+            if (result.empty() || result.back() != '/')
+                result.push_back('/');
+        }
+#elif eOPSYS == eWINDOWS
+        char buffer[MAX_PATH];
+        const DWORD length = GetCurrentDirectoryA(MAX_PATH, buffer);
+        if (length > 0 && length < MAX_PATH) {
+            result.assign(buffer, length);
+            if (result.back() != '\\')
+                result.push_back('\\');
+        }
+#endif
+        return result;
+    }
+
+    //! Returns the name of a file as it would be given from any directory.
+    std::string absolute_name(const std::string &name)
+    {
+#if eOPSYS == ePOSIX
+        if (!name.empty() && name[0] == '/')
+            return name;
+        return current_directory() + name;
+#elif eOPSYS == eWINDOWS
+        char buffer[MAX_PATH];
+        const DWORD length = GetFullPathNameA(name.c_str(), MAX_PATH, buffer, nullptr);
+        if (length == 0 || length >= MAX_PATH)
+            return name;
+        return std::string(buffer, length);
+#else
+        return name;
+#endif
+    }
+
+    //! Returns the name of a file relative to the current directory if it is inside it.
+    std::string relative_name(const std::string &name)
+    {
+        const std::string here = current_directory();
+        if (!here.empty() && name.size() > here.size() &&
+            name.compare(0, here.size(), here) == 0)
+            return name.substr(here.size());
+        return name;
+    }
+
+    //! Finds (creating it if necessary) the recovery directory. Returns "" if there is none.
+    std::string find_directory()
+    {
+        std::string result;
+        const char *const named = std::getenv("YRECOVERY");
+        if (named != nullptr && *named != '\0') {
+            result = named;
+        }
+        else {
+#if eOPSYS == ePOSIX
+            const char *const home = std::getenv("HOME");
+            if (home == nullptr || *home == '\0')
+                return "";
+            result = home;
+            result.append("/.yexa-recovery");
+#elif eOPSYS == eWINDOWS
+            const char *const local = std::getenv("LOCALAPPDATA");
+            if (local == nullptr || *local == '\0')
+                return "";
+            result = local;
+            result.append("\\yexa-recovery");
+#else
+            return "";
+#endif
+        }
+
+#if eOPSYS == ePOSIX
+        if (mkdir(result.c_str(), 0700) != 0 && errno != EEXIST)
+            return "";
+        result.push_back('/');
+#elif eOPSYS == eWINDOWS
+        if (!CreateDirectoryA(result.c_str(), nullptr) &&
+            GetLastError() != ERROR_ALREADY_EXISTS)
+            return "";
+        result.push_back('\\');
+#endif
+        return result;
+    }
+
+    //! Discards the data of every file when the editor exits normally.
+    void finish_recovery()
+    {
+        writer().finish();
+    }
+
+    //! Returns true if recovery data can be kept. The first call locates the directory.
+    bool available()
+    {
+        static const bool ready = []() {
+            state().directory = find_directory();
+            if (state().directory.empty())
+                return false;
+            std::atexit(finish_recovery);
+            return true;
+        }();
+        return ready;
+    }
+
+    //! Returns the stem of the names of the files holding a slot's data.
+    std::string stem_of(const Slot slot)
+    {
+        return state().directory + std::to_string(process_id()) + "-" + std::to_string(slot);
+    }
+
+    //! Removes the files holding the data with the given stem.
+    void remove_files(const std::string &stem)
+    {
+        // The snapshot goes first. A journal without one is never read.
+        std::remove((stem + snapshot_extension).c_str());
+        std::remove((stem + journal_extension).c_str());
+        std::remove((stem + temporary_extension).c_str());
+    }
+
+    //! Makes sure everything written to the file so far is on the disk.
+    bool sync_file(std::FILE *file)
+    {
+        if (std::fflush(file) != 0)
+            return false;
+#if eOPSYS == ePOSIX
+        return fsync(fileno(file)) == 0;
+#elif eOPSYS == eWINDOWS
+        return _commit(_fileno(file)) == 0;
+#else
+        return true;
+#endif
+    }
+
+    //! Makes sure a file renamed into the recovery directory survives a crash.
+    void sync_directory()
+    {
+#if eOPSYS == ePOSIX
+        const int descriptor = ::open(state().directory.c_str(), O_RDONLY);
+        if (descriptor != -1) {
+            fsync(descriptor);
+            ::close(descriptor);
+        }
+#endif
+    }
+
+    //! Copies count lines of data (fewer if the data ends first) starting at first.
+    /*!
+     * \param bytes [in, out] Increased by the approximate size of the copies.
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    Lines copy_lines(EditList &data, const long first, long count, std::size_t &bytes)
+    {
+        Lines lines;
+        long empty = 0;
+        data.jump_to(first);
+        const EditBuffer *line;
+        while (count-- > 0 && (line = data.read_next()) != nullptr) {
+            ++lines.count;
+            bytes += line->length() + line_overhead;
+            if (line->length() == 0) {
+                ++empty;
+                continue;
+            }
+            if (empty != 0)
+                lines.empty.emplace_back(lines.text.size(), empty);
+            empty = 0;
+            lines.text.push_back(*line);
+        }
+        if (empty != 0)
+            lines.empty.emplace_back(lines.text.size(), empty);
+        return lines;
+    }
+
+    //! Writes the count of lines and then the lines themselves.
+    void write_lines(Encoder &encoder, const Lines &lines)
+    {
+        encoder.number(static_cast<unsigned long>(lines.count), '\n');
+        auto run = lines.empty.begin();
+        for (std::size_t i = 0; i <= lines.text.size(); ++i) {
+            if (run != lines.empty.end() && run->first == i) {
+                for (long j = 0; j < run->second; ++j)
+                    encoder.text(std::string_view());
+                ++run;
+            }
+            if (i < lines.text.size())
+                encoder.text(lines.text[i].view());
+        }
+    }
+
+    //! Returns the stems of the data left behind by editors that are no longer running.
+    std::vector<std::string> abandoned_stems()
+    {
+        std::vector<std::string> stems;
+        const std::string extension(snapshot_extension);
+        const auto consider = [&](const std::string &file_name) {
+            if (file_name.size() <= extension.size() ||
+                file_name.compare(file_name.size() - extension.size(), extension.size(),
+                                  extension) != 0)
+                return;
+            char *end;
+            const unsigned long id = std::strtoul(file_name.c_str(), &end, 10);
+            if (*end != '-' || id == process_id() || running(id))
+                return;
+            stems.push_back(state().directory +
+                            file_name.substr(0, file_name.size() - extension.size()));
+        };
+
+#if eOPSYS == ePOSIX
+        DIR *const listing = opendir(state().directory.c_str());
+        if (listing == nullptr)
+            return stems;
+        const dirent *entry;
+        while ((entry = readdir(listing)) != nullptr)
+            consider(entry->d_name);
+        closedir(listing);
+#elif eOPSYS == eWINDOWS
+        WIN32_FIND_DATAA found;
+        HANDLE search = FindFirstFileA((state().directory + "*" + extension).c_str(), &found);
+        if (search == INVALID_HANDLE_VALUE)
+            return stems;
+        do {
+            consider(found.cFileName);
+        } while (FindNextFileA(search, &found));
+        FindClose(search);
+#endif
+        return stems;
+    }
+
+    //! Reads an entire file into contents. Returns false if it can't be read.
+    bool read_file(const std::string &name, std::string &contents)
+    {
+        std::FILE *const file = std::fopen(name.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+        char buffer[16 * 1024];
+        std::size_t count;
+        while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+            contents.append(buffer, count);
+        const bool result = !std::ferror(file);
+        std::fclose(file);
+        return result;
+    }
+
+    //! Reads a snapshot into lines (which should be empty). Returns false if it is damaged.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    bool read_snapshot(const std::string &file_name, std::string &name,
+                       unsigned long &generation, EditList &lines)
+    {
+        std::string contents;
+        if (!read_file(file_name, contents))
+            return false;
+
+        Decoder decoder(contents);
+        std::string_view text;
+        unsigned long count;
+        if (!decoder.literal(snapshot_magic) || !decoder.number(generation, '\n') ||
+            !decoder.text(text) || !decoder.number(count, '\n'))
+            return false;
+        name.assign(text);
+        for (unsigned long i = 0; i < count; ++i) {
+            if (!decoder.text(text))
+                return false;
+            lines.insert(new EditBuffer(text.data(), text.size()));
+        }
+        return decoder.seal();
+    }
+
+    //! Applies the records of a journal that follow the given snapshot to its lines.
+    /*!
+     * Reading stops at the first record that is incomplete or damaged.
+     *
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    void read_journal(const std::string &file_name, const unsigned long generation,
+                      EditList &lines)
+    {
+        std::string contents;
+        if (!read_file(file_name, contents))
+            return;
+
+        Decoder decoder(contents);
+        unsigned long followed;
+        if (!decoder.literal(journal_magic) || !decoder.number(followed, '\n') ||
+            !decoder.seal() || followed != generation)
+            return;
+
+        std::vector<std::string_view> replacement;
+        while (!decoder.at_end()) {
+            unsigned long first, old_count, new_count;
+            if (!decoder.number(first, ' ') || !decoder.number(old_count, ' ') ||
+                !decoder.number(new_count, '\n'))
+                return;
+            replacement.clear();
+            std::string_view text;
+            for (unsigned long i = 0; i < new_count; ++i) {
+                if (!decoder.text(text))
+                    return;
+                replacement.push_back(text);
+            }
+
+            const unsigned long size = static_cast<unsigned long>(lines.size());
+            if (!decoder.seal() || first > size || old_count > size - first)
+                return;
+            lines.jump_to(static_cast<long>(first));
+            for (unsigned long i = 0; i < old_count; ++i) {
+                delete lines.get();
+                lines.erase();
+            }
+            for (const std::string_view line : replacement)
+                lines.insert(new EditBuffer(line.data(), line.size()));
+        }
+    }
+
+    /*=====================================*/
+    /*           Writer Members           */
+    /*=====================================*/
+
+    //! Queues a task, starting the worker if necessary.
+    void Writer::submit(Task task)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (stopping)
+            return;
+        if (!worker.joinable())
+            worker = std::thread(&Writer::run, this);
+        tasks.push_back(std::move(task));
+        wake.notify_one();
+    }
+
+    //! Stops the worker and discards the data of every file.
+    /*!
+     * Recovered data whose removal has been requested is also discarded. Other tasks that have
+     * not been started are abandoned.
+     */
+    void Writer::finish()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        if (worker.joinable())
+            worker.join();
+
+        for (const Task &task : tasks) {
+            if (task.kind == Task::REMOVE)
+                remove_files(task.name);
+        }
+        tasks.clear();
+        while (!journals.empty())
+            close_journal(journals.begin()->first);
+        for (Slot slot = 1; slot <= state().last_slot; ++slot)
+            remove_files(stem_of(slot));
+    }
+
+    //! Performs the tasks in batches until asked to stop.
+    void Writer::run()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        for (;;) {
+            wake.wait(guard, [this]() { return stopping || !tasks.empty(); });
+            if (stopping)
+                return;
+            std::deque<Task> batch;
+            batch.swap(tasks);
+            guard.unlock();
+
+            // Each journal written is synchronized once for the whole batch.
+            {
+                Trace::Span span("write journals");
+                std::set<Slot> written;
+                for (Task &task : batch)
+                    perform(task, written);
+                for (const Slot slot : written) {
+                    auto journal = journals.find(slot);
+                    if (journal != journals.end() && !sync_file(journal->second))
+                        close_journal(slot);
+                }
+                batch.clear();
+            }
+
+            guard.lock();
+            wake.wait_for(guard, batch_interval, [this]() { return stopping; });
+        }
+    }
+
+    //! Closes a slot's journal, if it is open.
+    void Writer::close_journal(const Slot slot)
+    {
+        auto journal = journals.find(slot);
+        if (journal == journals.end())
+            return;
+        if (journal->second != nullptr)
+            std::fclose(journal->second);
+        journals.erase(journal);
+    }
+
+    //! Performs one task.
+    /*!
+     * A journal that can't be written is closed. Since its records no longer describe the
+     * file, no more are written until the next snapshot (which also rewrites the journal).
+     *
+     * \param written [in, out] The slots whose journals were written are added.
+     */
+    void Writer::perform(Task &task, std::set<Slot> &written)
+    {
+        const std::string stem = (task.kind == Task::REMOVE) ? task.name : stem_of(task.slot);
+
+        switch (task.kind) {
+        case Task::SNAPSHOT: {
+            close_journal(task.slot);
+            const std::string temporary_name = stem + temporary_extension;
+            std::FILE *file = std::fopen(temporary_name.c_str(), "wb");
+            if (file == nullptr)
+                return;
+            Encoder snapshot(file);
+            snapshot.literal(snapshot_magic);
+            snapshot.number(task.generation, '\n');
+            snapshot.text(task.name);
+            write_lines(snapshot, task.lines);
+            snapshot.seal();
+            bool good = snapshot.flush() && sync_file(file);
+            good = (std::fclose(file) == 0) && good;
+            const std::string snapshot_name = stem + snapshot_extension;
+            if (!good || !replace_file(temporary_name.c_str(), snapshot_name.c_str())) {
+                std::remove(temporary_name.c_str());
+                return;
+            }
+            sync_directory();
+
+            file = std::fopen((stem + journal_extension).c_str(), "wb");
+            if (file == nullptr)
+                return;
+            Encoder journal(file);
+            journal.literal(journal_magic);
+            journal.number(task.generation, '\n');
+            journal.seal();
+            if (!journal.flush()) {
+                std::fclose(file);
+                return;
+            }
+            journals[task.slot] = file;
+            written.insert(task.slot);
+            break;
+        }
+
+        case Task::RECORD: {
+            auto journal = journals.find(task.slot);
+            if (journal == journals.end())
+                return;
+            Encoder record(journal->second);
+            record.number(static_cast<unsigned long>(task.first), ' ');
+            record.number(static_cast<unsigned long>(task.old_count), ' ');
+            write_lines(record, task.lines);
+            record.seal();
+            if (!record.flush())
+                close_journal(task.slot);
+            else
+                written.insert(task.slot);
+            break;
+        }
+
+        case Task::CLOSE:
+            close_journal(task.slot);
+            remove_files(stem);
+            break;
+
+        case Task::REMOVE:
+            remove_files(stem);
+            break;
+        }
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Recovery {
+
+    Slot open(const std::string &name, EditList &data)
+    {
+        if (!available())
+            return 0;
+        const Slot slot = ++state().last_slot;
+        state().kept[slot].name = absolute_name(name);
+        snapshot(slot, data);
+        return slot;
+    }
+
+    void snapshot(const Slot slot, EditList &data)
+    {
+        auto file = state().kept.find(slot);
+        if (file == state().kept.end())
+            return;
+        Kept &kept = file->second;
+
+        Task task;
+        task.kind = Task::SNAPSHOT;
+        task.slot = slot;
+        task.generation = kept.generation + 1;
+        task.name = kept.name;
+        task.first = 0;
+        task.old_count = 0;
+        std::size_t bytes = 0;
+        try {
+            task.lines = copy_lines(data, 0, data.size(), bytes);
+        }
+        catch (std::bad_alloc &) {
+            kept.stale = true;
+            return;
+        }
+        kept.generation = task.generation;
+        kept.snapshot_bytes = bytes;
+        kept.journal_bytes = 0;
+        kept.stale = false;
+        writer().submit(std::move(task));
+    }
+
+    void append(const Slot slot, const long first, const long old_count, EditList &data,
+                const long new_count)
+    {
+        auto file = state().kept.find(slot);
+        if (file == state().kept.end())
+            return;
+        Kept &kept = file->second;
+        if (kept.stale) {
+            snapshot(slot, data);
+            return;
+        }
+
+        Task task;
+        task.kind = Task::RECORD;
+        task.slot = slot;
+        task.generation = kept.generation;
+        task.first = first;
+        task.old_count = old_count;
+        std::size_t bytes = line_overhead;
+        try {
+            task.lines = copy_lines(data, first, new_count, bytes);
+        }
+        catch (std::bad_alloc &) {
+            kept.stale = true;
+            return;
+        }
+        kept.journal_bytes += bytes;
+        writer().submit(std::move(task));
+    }
+
+    bool needs_snapshot(const Slot slot)
+    {
+        auto file = state().kept.find(slot);
+        if (file == state().kept.end())
+            return false;
+        const Kept &kept = file->second;
+        return kept.stale ||
+               (kept.journal_bytes > 0 &&
+                kept.journal_bytes * snapshot_ratio >= kept.snapshot_bytes);
+    }
+
+    void close(const Slot slot)
+    {
+        if (state().kept.erase(slot) == 0)
+            return;
+        Task task;
+        task.kind = Task::CLOSE;
+        task.slot = slot;
+        task.generation = 0;
+        task.first = 0;
+        task.old_count = 0;
+        writer().submit(std::move(task));
+    }
+
+    std::vector<Recovered> recover()
+    {
+        std::vector<Recovered> found;
+        if (!available())
+            return found;
+
+        for (const std::string &stem : abandoned_stems()) {
+            Recovered recovered;
+            recovered.stem = stem;
+            try {
+                recovered.lines.reset(new EditList);
+                unsigned long generation;
+                if (!read_snapshot(stem + snapshot_extension, recovered.name, generation,
+                                   *recovered.lines)) {
+                    // A snapshot is only ever renamed into place whole, so this one is junk.
+                    remove_files(stem);
+                    continue;
+                }
+                read_journal(stem + journal_extension, generation, *recovered.lines);
+            }
+            catch (std::bad_alloc &) {
+                continue;
+            }
+            recovered.name = relative_name(recovered.name);
+            found.push_back(std::move(recovered));
+        }
+        return found;
+    }
+
+    void remove(const Recovered &recovered)
+    {
+        // The removal waits behind the snapshots of the files the data was restored to.
+        Task task;
+        task.kind = Task::REMOVE;
+        task.slot = 0;
+        task.generation = 0;
+        task.name = recovered.stem;
+        task.first = 0;
+        task.old_count = 0;
+        writer().submit(std::move(task));
+    }
+
+} // namespace Recovery
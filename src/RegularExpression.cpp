@@ -0,0 +1,559 @@
+/*! \file    RegularExpression.cpp
+ *  \brief   Implementation of class RegularExpression.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+#include "RegularExpression.hpp"
+
+namespace {
+    // Repetition operators need something to repeat.
+    bool is_repetition(const char ch) { return ch == '*' || ch == '+' || ch == '?'; }
+} // namespace
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Adds a state of the given type to the NFA and returns its index.
+int RegularExpression::new_state(const StateType type, const int set)
+{
+    states.push_back(State{type, set, -1, -1});
+    return static_cast<int>(states.size()) - 1;
+}
+
+//! Connects each of the given dangling exits to the target state.
+void RegularExpression::patch(std::vector<State> &state_list,
+                              const std::vector<std::pair<int, int>> &exits, const int target)
+{
+    for (const auto &exit : exits) {
+        if (exit.second == 0)
+            state_list[exit.first].out = target;
+        else
+            state_list[exit.first].out2 = target;
+    }
+}
+
+//! Adds the other case of each ASCII letter in the set, if case is being ignored.
+/*!
+ * This is done to each set of characters before it is complemented, so that a complemented
+ * set leaves out both cases of its letters.
+ */
+void RegularExpression::fold(std::bitset<256> &set) const
+{
+    if (!ignore_case)
+        return;
+    for (int letter = 'a'; letter <= 'z'; ++letter) {
+        const int upper = letter - ('a' - 'A');
+        if (set.test(letter) || set.test(upper)) {
+            set.set(letter);
+            set.set(upper);
+        }
+    }
+}
+
+//! Records a syntax error and returns false so parsing functions can return its result.
+bool RegularExpression::syntax_error(const char *const message)
+{
+    error_text = message;
+    error_text += " at offset ";
+    error_text += std::to_string(position);
+    return false;
+}
+
+//! alternation := concatenation ( '|' concatenation )*
+bool RegularExpression::parse_alternation(Fragment &result)
+{
+    if (!parse_concatenation(result))
+        return false;
+    while (position < source.size() && source[position] == '|') {
+        ++position;
+        Fragment right;
+        if (!parse_concatenation(right))
+            return false;
+        const int split = new_state(SPLIT);
+        states[split].out = result.start;
+        states[split].out2 = right.start;
+        result.start = split;
+        result.exits.insert(result.exits.end(), right.exits.begin(), right.exits.end());
+    }
+    return true;
+}
+
+//! concatenation := repetition*
+bool RegularExpression::parse_concatenation(Fragment &result)
+{
+    // An empty concatenation matches the empty string.
+    const int empty = new_state(EMPTY);
+    result.start = empty;
+    result.exits.assign(1, std::make_pair(empty, 0));
+
+    while (position < source.size() && source[position] != '|' && source[position] != ')') {
+        Fragment next;
+        if (!parse_repetition(next))
+            return false;
+        patch(states, result.exits, next.start);
+        result.exits = std::move(next.exits);
+    }
+    return true;
+}
+
+//! repetition := atom ( '*' | '+' | '?' )*
+bool RegularExpression::parse_repetition(Fragment &result)
+{
+    if (is_repetition(source[position]))
+        return syntax_error("Nothing to repeat");
+    if (!parse_atom(result))
+        return false;
+
+    while (position < source.size() && is_repetition(source[position])) {
+        const char op = source[position++];
+        const int split = new_state(SPLIT);
+        states[split].out = result.start;
+        switch (op) {
+        case '*':
+            patch(states, result.exits, split);
+            result.start = split;
+            result.exits.assign(1, std::make_pair(split, 1));
+            break;
+        case '+':
+            patch(states, result.exits, split);
+            result.exits.assign(1, std::make_pair(split, 1));
+            break;
+        case '?':
+            result.start = split;
+            result.exits.emplace_back(split, 1);
+            break;
+        }
+    }
+    return true;
+}
+
+//! Parses the character following a backslash, leaving the set of characters it denotes.
+bool RegularExpression::parse_escape(std::bitset<256> &set)
+{
+    if (position >= source.size())
+        return syntax_error("Trailing backslash");
+
+    const unsigned char ch = static_cast<unsigned char>(source[position++]);
+    bool complement = false;
+    switch (ch) {
+    case 'D':
+        complement = true;
+        // Fall through.
+    case 'd':
+        for (int i = '0'; i <= '9'; ++i)
+            set.set(i);
+        break;
+
+    case 'W':
+        complement = true;
+        // Fall through.
+    case 'w':
+        for (int i = 0; i < 256; ++i)
+            if (std::isalnum(i) || i == '_')
+                set.set(i);
+        break;
+
+    case 'S':
+        complement = true;
+        // Fall through.
+    case 's':
+        for (int i = 0; i < 256; ++i)
+            if (std::isspace(i))
+                set.set(i);
+        break;
+
+    case 't':
+        set.set('\t');
+        break;
+
+    default:
+        set.set(ch);
+        break;
+    }
+    fold(set);
+    if (complement)
+        set.flip();
+    return true;
+}
+
+//! Parses a bracketed class. The position is just past the opening '['.
+bool RegularExpression::parse_class(std::bitset<256> &set)
+{
+    bool negate = false;
+    if (position < source.size() && source[position] == '^') {
+        negate = true;
+        ++position;
+    }
+
+    // A ']' at the very start of the class is literal.
+    bool first = true;
+    while (position < source.size() && (first || source[position] != ']')) {
+        first = false;
+        std::bitset<256> item;
+        const unsigned char low = static_cast<unsigned char>(source[position]);
+        ++position;
+        if (low == '\\') {
+            if (!parse_escape(item))
+                return false;
+            set |= item;
+            continue;
+        }
+
+        // Is this a range?
+        if (position + 1 < source.size() && source[position] == '-' &&
+            source[position + 1] != ']') {
+            const unsigned char high = static_cast<unsigned char>(source[position + 1]);
+            position += 2;
+            if (high < low)
+                return syntax_error("Invalid range in character class");
+            for (int i = low; i <= high; ++i)
+                set.set(i);
+        }
+        else {
+            set.set(low);
+        }
+    }
+    if (position >= source.size())
+        return syntax_error("Unterminated character class");
+    ++position;
+
+    fold(set);
+    if (negate)
+        set.flip();
+    return true;
+}
+
+//! atom := '(' alternation ')' | '[' class ']' | '.' | '^' | '$' | '\' escape | character
+bool RegularExpression::parse_atom(Fragment &result)
+{
+    const char ch = source[position++];
+    std::bitset<256> set;
+    int state;
+
+    switch (ch) {
+    case '(':
+        if (!parse_alternation(result))
+            return false;
+        if (position >= source.size() || source[position] != ')')
+            return syntax_error("Missing ')'");
+        ++position;
+        return true;
+
+    case ')':
+        --position;
+        return syntax_error("Unmatched ')'");
+
+    case '^':
+        state = new_state(LINE_START);
+        result.start = state;
+        result.exits.assign(1, std::make_pair(state, 0));
+        return true;
+
+    case '$':
+        state = new_state(LINE_END);
+        result.start = state;
+        result.exits.assign(1, std::make_pair(state, 0));
+        return true;
+
+    case '.':
+        set.set();
+        break;
+
+    case '[':
+        if (!parse_class(set))
+            return false;
+        break;
+
+    case '\\':
+        if (!parse_escape(set))
+            return false;
+        break;
+
+    default:
+        set.set(static_cast<unsigned char>(ch));
+        fold(set);
+        break;
+    }
+
+    sets.push_back(set);
+    state = new_state(CHARACTER_SET, static_cast<int>(sets.size()) - 1);
+    result.start = state;
+    result.exits.assign(1, std::make_pair(state, 0));
+    return true;
+}
+
+//! Adds the non-epsilon states reachable from the given state to result.
+/*!
+ * LINE_END states are kept in the result since they can only be followed once the end of the
+ * line is known. The closure is computed with respect to the current generation of marks.
+ */
+void RegularExpression::add_closure(std::vector<int> &result, const int state,
+                                    const bool at_start)
+{
+    if (marks[state] == generation)
+        return;
+    marks[state] = generation;
+
+    const State &current = states[state];
+    switch (current.type) {
+    case SPLIT:
+        add_closure(result, current.out, at_start);
+        add_closure(result, current.out2, at_start);
+        break;
+    case EMPTY:
+        add_closure(result, current.out, at_start);
+        break;
+    case LINE_START:
+        if (at_start)
+            add_closure(result, current.out, at_start);
+        break;
+    case CHARACTER_SET:
+    case LINE_END:
+    case MATCH:
+        result.push_back(state);
+        break;
+    }
+}
+
+//! Returns the index of the DFA state for the given set of NFA states, creating it if needed.
+int RegularExpression::dfa_state(std::vector<int> &nfa_states)
+{
+    std::sort(nfa_states.begin(), nfa_states.end());
+    auto const existing = dfa_index.find(nfa_states);
+    if (existing != dfa_index.end())
+        return existing->second;
+
+    DFAState new_dfa_state;
+    new_dfa_state.accepting = false;
+    new_dfa_state.accepting_at_end = false;
+    std::fill(std::begin(new_dfa_state.next), std::end(new_dfa_state.next), -1);
+
+    std::vector<int> at_end;
+    ++generation;
+    for (const int state : nfa_states) {
+        if (states[state].type == MATCH)
+            new_dfa_state.accepting = true;
+        else if (states[state].type == LINE_END)
+            add_closure(at_end, states[state].out, false);
+    }
+    new_dfa_state.accepting_at_end = new_dfa_state.accepting;
+    for (const int state : at_end) {
+        if (states[state].type == MATCH)
+            new_dfa_state.accepting_at_end = true;
+    }
+
+    new_dfa_state.nfa_states = nfa_states;
+    dfa.push_back(std::move(new_dfa_state));
+    const int index = static_cast<int>(dfa.size()) - 1;
+    dfa_index.emplace(std::move(nfa_states), index);
+    return index;
+}
+
+//! Returns the DFA state in which a search begins.
+int RegularExpression::initial(const bool at_start)
+{
+    int &initial_index = initial_state[at_start ? 1 : 0];
+    if (initial_index < 0) {
+        std::vector<int> nfa_states;
+        ++generation;
+        add_closure(nfa_states, start_state, at_start);
+        initial_index = dfa_state(nfa_states);
+    }
+    return initial_index;
+}
+
+//! Returns the DFA state reached from the given state on the given character.
+/*!
+ * The search is unanchored so every transition also restarts the expression at the next
+ * position. Returns -1 if the cache is full; the caller must then use another method.
+ */
+int RegularExpression::transition(const int from, const unsigned char character)
+{
+    if (dfa[from].next[character] >= 0)
+        return dfa[from].next[character];
+    if (dfa.size() >= maximum_dfa_states)
+        return -1;
+
+    std::vector<int> nfa_states;
+    ++generation;
+    for (const int state : dfa[from].nfa_states) {
+        const State &current = states[state];
+        if (current.type == CHARACTER_SET && sets[current.set].test(character))
+            add_closure(nfa_states, current.out, false);
+    }
+    add_closure(nfa_states, start_state, false);
+
+    const int result = dfa_state(nfa_states);
+    dfa[from].next[character] = result;
+    return result;
+}
+
+//! Returns true if the subject might contain a match starting at or after start.
+bool RegularExpression::contains_match(const std::string_view subject, const std::size_t start)
+{
+    // Start over if the cache has filled. Large DFAs are rare in practice.
+    if (dfa.size() >= maximum_dfa_states) {
+        dfa.clear();
+        dfa_index.clear();
+        initial_state[0] = initial_state[1] = -1;
+    }
+
+    int current = initial(start == 0);
+    for (std::size_t i = start; i < subject.size(); ++i) {
+        if (dfa[current].accepting)
+            return true;
+        current = transition(current, static_cast<unsigned char>(subject[i]));
+        if (current < 0)
+            return true;
+    }
+    return dfa[current].accepting_at_end;
+}
+
+//! Adds a thread for the given state to the list, following epsilon transitions.
+void RegularExpression::add_thread(std::vector<Thread> &list, const int state,
+                                   const std::size_t start, const std::size_t position,
+                                   const std::size_t length)
+{
+    if (marks[state] == generation)
+        return;
+    marks[state] = generation;
+
+    const State &current = states[state];
+    switch (current.type) {
+    case SPLIT:
+        add_thread(list, current.out, start, position, length);
+        add_thread(list, current.out2, start, position, length);
+        break;
+    case EMPTY:
+        add_thread(list, current.out, start, position, length);
+        break;
+    case LINE_START:
+        if (position == 0)
+            add_thread(list, current.out, start, position, length);
+        break;
+    case LINE_END:
+        if (position == length)
+            add_thread(list, current.out, start, position, length);
+        break;
+    case CHARACTER_SET:
+    case MATCH:
+        list.push_back(Thread{state, start});
+        break;
+    }
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Creates an expression that matches nothing until compile() succeeds.
+RegularExpression::RegularExpression()
+    : start_state(-1), position(0), ignore_case(false), generation(0)
+{
+    initial_state[0] = initial_state[1] = -1;
+}
+
+//! Compiles the given expression, replacing any previously compiled one.
+/*!
+ * \param text The expression.
+ * \param fold_case If true, ASCII letters in the expression match letters of either case.
+ * \return false if the expression has a syntax error. The error() function then describes it
+ * and the object matches nothing.
+ */
+bool RegularExpression::compile(const std::string_view text, const bool fold_case)
+{
+    ignore_case = fold_case;
+    states.clear();
+    sets.clear();
+    dfa.clear();
+    dfa_index.clear();
+    initial_state[0] = initial_state[1] = -1;
+    error_text.clear();
+    source = text;
+    position = 0;
+    start_state = -1;
+
+    Fragment whole;
+    bool ok = parse_alternation(whole);
+    if (ok && position < source.size())
+        ok = syntax_error("Unmatched ')'");
+    if (!ok) {
+        states.clear();
+        sets.clear();
+        return false;
+    }
+
+    patch(states, whole.exits, new_state(MATCH));
+    start_state = whole.start;
+    marks.assign(states.size(), 0);
+    generation = 0;
+    return true;
+}
+
+//! Locates the leftmost-longest match in subject that starts at or after start.
+/*!
+ * \param subject The line to search. Anchors refer to the ends of this text.
+ * \param start The offset in subject where the search begins.
+ * \param match_start Set to the offset of the match, if any.
+ * \param match_length Set to the length of the match, if any. It may be zero.
+ * \return true if a match was found.
+ */
+bool RegularExpression::find(const std::string_view subject, const std::size_t start,
+                             std::size_t &match_start, std::size_t &match_length)
+{
+    if (start_state < 0 || start > subject.size())
+        return false;
+    if (!contains_match(subject, start))
+        return false;
+
+    // Threads are kept in priority order: those that started earlier come first.
+    std::vector<Thread> current;
+    std::vector<Thread> next;
+    bool found = false;
+    std::size_t best_start = 0;
+    std::size_t best_end = 0;
+
+    ++generation;
+    add_thread(current, start_state, start, start, subject.size());
+    for (std::size_t i = start;; ++i) {
+        for (const Thread &thread : current) {
+            if (states[thread.state].type != MATCH)
+                continue;
+            if (!found || thread.start < best_start ||
+                (thread.start == best_start && i > best_end)) {
+                found = true;
+                best_start = thread.start;
+                best_end = i;
+            }
+        }
+        if (i == subject.size())
+            break;
+
+        const unsigned char character = static_cast<unsigned char>(subject[i]);
+        next.clear();
+        ++generation;
+        for (const Thread &thread : current) {
+            if (found && thread.start > best_start)
+                continue;
+            const State &state = states[thread.state];
+            if (state.type == CHARACTER_SET && sets[state.set].test(character))
+                add_thread(next, state.out, thread.start, i + 1, subject.size());
+        }
+        if (!found)
+            add_thread(next, start_state, i + 1, i + 1, subject.size());
+        current.swap(next);
+        if (found && current.empty())
+            break;
+    }
+
+    if (found) {
+        match_start = best_start;
+        match_length = best_end - best_start;
+    }
+    return found;
+}
@@ -0,0 +1,554 @@
+/*! \file    RemoteFile.cpp
+ *  \brief   Implementation of class RemoteFile
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#include "RemoteFile.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    const char prefix[] = "ssh://";
+    constexpr std::size_t prefix_size = sizeof(prefix) - 1;
+
+    // Blocks are compared and sent in pieces this large when a file is written. Each piece
+    // compared costs the host a couple of processes, so they are larger than the blocks read.
+    constexpr std::size_t write_piece_size = 1024 * 1024;
+
+    // The number of blocks requested ahead of the one being received by read_all.
+    constexpr std::size_t read_ahead = 16;
+
+    // The most milliseconds to wait for the host to send anything before giving up.
+    constexpr int reply_timeout = 30000;
+
+    // The most milliseconds to wait for the host to finish once the connection is closed.
+    constexpr int close_timeout = 1000;
+
+    // The most connections kept for reuse by connect.
+    constexpr std::size_t idle_limit = 4;
+
+    std::mutex idle_lock;
+    std::vector<std::unique_ptr<RemoteFile>> idle; //!< Connections kept by keep.
+
+    // Run on the host with the path of the file as $1. It answers one request per line. A read
+    // is answered with the number of bytes read and then the bytes. Writes go into a copy of
+    // the file (or the file itself if it is a symbolic link) and are not answered; a commit
+    // answers "ok" if all of them and the replacement of the file worked. The head used must
+    // not read past the bytes it copies, as GNU head does not.
+    const char script[] =
+        "f=$1\n"
+        "t=$(mktemp) || exit 1\n"
+        "w=\n"
+        "trap 'rm -f \"$t\"; if [ -n \"$w\" ] && [ \"$w\" != \"$f\" ]; then rm -f \"$w\"; fi'"
+        " EXIT\n"
+        "trap 'exit 1' HUP INT TERM\n"
+        "echo yexa\n"
+        "while read c a b d; do\n"
+        "    case $c in\n"
+        "    size)\n"
+        "        if [ -f \"$f\" ]; then wc -c < \"$f\"; else echo -1; fi ;;\n"
+        "    read)\n"
+        "        dd if=\"$f\" bs=$b skip=$a count=1 2>/dev/null > \"$t\"\n"
+        "        wc -c < \"$t\"\n"
+        "        cat \"$t\" ;;\n"
+        "    lines)\n"
+        "        if [ \"$a\" = cr ]; then tr '\\r' '\\n' < \"$f\" | wc -l\n"
+        "        else wc -l < \"$f\"; fi ;;\n"
+        "    sums)\n"
+        "        i=0\n"
+        "        while [ $i -lt $a ]; do\n"
+        "            dd if=\"$f\" bs=$b skip=$i count=1 2>/dev/null | cksum\n"
+        "            i=$((i + 1))\n"
+        "        done ;;\n"
+        "    begin)\n"
+        "        bad=\n"
+        "        if [ -L \"$f\" ]; then w=$f\n"
+        "        elif [ -f \"$f\" ]; then w=$f.yxt; cp -p \"$f\" \"$w\" || bad=1\n"
+        "        else w=$f.yxt; : > \"$w\" || bad=1; fi ;;\n"
+        "    write)\n"
+        "        head -c \"$b\" > \"$t\" || bad=1\n"
+        "        if [ -z \"$bad\" ]; then\n"
+        "            dd if=\"$t\" of=\"$w\" bs=$d seek=$a conv=notrunc 2>/dev/null || bad=1\n"
+        "        fi ;;\n"
+        "    commit)\n"
+        "        if [ -z \"$bad\" ] && dd if=/dev/null of=\"$w\" bs=1 seek=$a 2>/dev/null &&\n"
+        "           { [ \"$w\" = \"$f\" ] || mv \"$w\" \"$f\"; }; then echo ok\n"
+        "        else echo no; fi\n"
+        "        if [ \"$w\" != \"$f\" ]; then rm -f \"$w\"; fi\n"
+        "        w= ;;\n"
+        "    esac\n"
+        "done\n";
+
+    //! Quotes text for the shell.
+    std::string quoted(const std::string_view text)
+    {
+        std::string result("'");
+        for (const char ch : text) {
+            if (ch == '\'')
+                result.append("'\\''");
+            else
+                result.push_back(ch);
+        }
+        result.push_back('\'');
+        return result;
+    }
+
+    //! Separates a remote file's name into its host and path.
+    /*!
+     * \return false if name is not the name of a remote file.
+     */
+    bool split_name(const char *const name, std::string &host, std::string &path)
+    {
+        if (std::strncmp(name, prefix, prefix_size) != 0)
+            return false;
+        const char *const start = name + prefix_size;
+        const char *const slash = std::strchr(start, '/');
+        if (slash == nullptr || slash == start || *start == '-' || slash[1] == '\0')
+            return false;
+        host.assign(start, slash);
+        path = slash;
+        if (path.compare(0, 3, "/~/") == 0)
+            path.erase(0, 3);
+        return !path.empty();
+    }
+
+    //! Returns the checksum computed by cksum for text.
+    std::uint32_t checksum(const std::string_view text)
+    {
+        static const std::vector<std::uint32_t> table = [] {
+            std::vector<std::uint32_t> result(256);
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t value = i << 24;
+                for (int bit = 0; bit < 8; ++bit)
+                    value = (value & 0x80000000U) ? (value << 1) ^ 0x04C11DB7U : value << 1;
+                result[i] = value;
+            }
+            return result;
+        }();
+
+        std::uint32_t crc = 0;
+        for (const char ch : text)
+            crc = (crc << 8) ^ table[((crc >> 24) ^ static_cast<unsigned char>(ch)) & 0xFFU];
+        for (std::uint64_t length = text.size(); length != 0; length >>= 8)
+            crc = (crc << 8) ^ table[((crc >> 24) ^ length) & 0xFFU];
+        return ~crc;
+    }
+
+} // namespace
+
+/*=============================================*/
+/*           Public Member Functions           */
+/*=============================================*/
+
+RemoteFile::RemoteFile()
+    : length(-1), requested(0), failed(false)
+#if eOPSYS == ePOSIX
+      ,
+      to_host(-1), from_host(-1), helper(0)
+#endif
+{
+}
+
+RemoteFile::~RemoteFile()
+{
+    close();
+}
+
+//! Returns true if name is the name of a remote file (see the class description).
+bool RemoteFile::is_remote(const char *const name)
+{
+    return std::strncmp(name, prefix, prefix_size) == 0;
+}
+
+//! Returns a connection to the named file, reusing one that was kept if possible.
+/*!
+ * The size of a file reached through a kept connection is read again.
+ *
+ * \return nullptr if the host could not be reached.
+ */
+std::unique_ptr<RemoteFile> RemoteFile::connect(const char *const name)
+{
+    std::unique_ptr<RemoteFile> result;
+    {
+        std::lock_guard<std::mutex> guard(idle_lock);
+        for (auto p = idle.begin(); p != idle.end(); ++p) {
+            if ((*p)->name == name) {
+                result = std::move(*p);
+                idle.erase(p);
+                break;
+            }
+        }
+    }
+    if (result && result->refresh())
+        return result;
+    result.reset(new RemoteFile);
+    if (!result->open(name))
+        result.reset();
+    return result;
+}
+
+//! Keeps a connection so that connect can reuse it. Broken connections are closed.
+void RemoteFile::keep(std::unique_ptr<RemoteFile> file)
+{
+    if (!file || file->failed || file->requested != 0)
+        return;
+    std::lock_guard<std::mutex> guard(idle_lock);
+    idle.push_back(std::move(file));
+    if (idle.size() > idle_limit)
+        idle.erase(idle.begin());
+}
+
+//! Connects to the host of the named file and finds the size of the file.
+/*!
+ * \return false if the name is not that of a remote file or the host could not be reached. It
+ * is not an error for the file not to exist.
+ */
+bool RemoteFile::open(const char *const the_name)
+{
+    close();
+#if eOPSYS == ePOSIX
+    std::string host;
+    std::string path;
+    if (!split_name(the_name, host, path))
+        return false;
+
+    int to_child[2];
+    int from_child[2];
+    if (pipe(to_child) == -1)
+        return false;
+    if (pipe(from_child) == -1) {
+        ::close(to_child[0]);
+        ::close(to_child[1]);
+        return false;
+    }
+    fcntl(to_child[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_child[0], F_SETFD, FD_CLOEXEC);
+
+    // The helper's errors would spoil the display.
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, to_child[0], 0);
+    posix_spawn_file_actions_adddup2(&actions, from_child[1], 1);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addclose(&actions, to_child[0]);
+    posix_spawn_file_actions_addclose(&actions, from_child[1]);
+
+    const char *program = std::getenv("YSSH");
+    if (program == nullptr || *program == '\0')
+        program = "ssh";
+    std::string program_name(program);
+    std::string no_tty("-T");
+    std::string option("-o");
+    std::string batch("BatchMode=yes");
+    std::string command = "exec sh -c " + quoted(script) + " yexa " + quoted(path);
+    char *const arguments[] = {&program_name[0], &no_tty[0], &option[0], &batch[0],
+                               &host[0],         &command[0], nullptr};
+    pid_t child;
+    const int spawn_error =
+        posix_spawnp(&child, program, &actions, nullptr, arguments, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(to_child[0]);
+    ::close(from_child[1]);
+    to_host = to_child[1];
+    from_host = from_child[0];
+    if (spawn_error != 0) {
+        ::close(to_host);
+        ::close(from_host);
+        to_host = -1;
+        from_host = -1;
+        return false;
+    }
+    helper = child;
+    name = the_name;
+
+    std::string greeting;
+    if (!read_line(greeting) || greeting != "yexa" || !refresh()) {
+        close();
+        return false;
+    }
+    return true;
+#else
+    (void)the_name;
+    return false;
+#endif
+}
+
+//! Ends the connection, if any.
+void RemoteFile::close()
+{
+#if eOPSYS == ePOSIX
+    if (to_host == -1)
+        return;
+    // The script exits, removing its temporary files, when its input ends. A connection that
+    // has hung is given a moment to end before ssh is stopped.
+    ::close(to_host);
+    to_host = -1;
+    input.clear();
+    while (!failed && fill(close_timeout))
+        input.clear();
+    ::close(from_host);
+    from_host = -1;
+    kill(static_cast<pid_t>(helper), SIGTERM);
+    int status;
+    while (waitpid(static_cast<pid_t>(helper), &status, 0) == -1 && errno == EINTR)
+        ;
+    helper = 0;
+#endif
+    name.clear();
+    input.clear();
+    length = -1;
+    requested = 0;
+    failed = false;
+}
+
+//! Finds the size of the file again.
+/*!
+ * \return false if the connection is broken or blocks are outstanding.
+ */
+bool RemoteFile::refresh()
+{
+    std::string line;
+    if (requested != 0 || !send("size\n") || !read_line(line))
+        return false;
+    length = std::strtoll(line.c_str(), nullptr, 10);
+    return true;
+}
+
+//! Asks for a block of the file. The blocks requested are received in order (see receive).
+bool RemoteFile::request(const std::uint64_t block)
+{
+    char line[64];
+    std::snprintf(line, sizeof(line), "read %llu %lu\n", static_cast<unsigned long long>(block),
+                  static_cast<unsigned long>(block_size));
+    if (!send(line))
+        return false;
+    ++requested;
+    return true;
+}
+
+//! Receives the oldest block requested, appending it to text.
+/*!
+ * \return false if nothing is outstanding or the connection broke. The block of a file that
+ * was shortened since it was opened may be short or empty.
+ */
+bool RemoteFile::receive(std::string &text)
+{
+    std::string line;
+    if (requested == 0 || !read_line(line))
+        return false;
+    --requested;
+    const long long count = std::strtoll(line.c_str(), nullptr, 10);
+    if (count < 0 || static_cast<unsigned long long>(count) > block_size) {
+        failed = true;
+        return false;
+    }
+    return read_exact(static_cast<std::size_t>(count), text);
+}
+
+//! Reads the entire file into text, keeping several requests outstanding.
+/*!
+ * \throws std::bad_alloc if insufficient memory.
+ */
+bool RemoteFile::read_all(std::string &text)
+{
+    text.clear();
+    text.reserve(static_cast<std::size_t>(size()));
+    const std::uint64_t count = blocks();
+    std::uint64_t next = 0;
+    for (std::uint64_t block = 0; block < count; ++block) {
+        while (next < count && next < block + read_ahead) {
+            if (!request(next++))
+                return false;
+        }
+        if (!receive(text))
+            return false;
+    }
+    return true;
+}
+
+//! Counts the line breaks in the file without reading it.
+/*!
+ * \param cr_endings If true, carriage returns are counted. Otherwise line feeds are counted.
+ * \return false if the connection is broken or blocks are outstanding.
+ */
+bool RemoteFile::count_lines(const bool cr_endings, long &count)
+{
+    std::string line;
+    if (requested != 0 || !send(cr_endings ? "lines cr\n" : "lines lf\n") || !read_line(line))
+        return false;
+    count = std::strtol(line.c_str(), nullptr, 10);
+    return true;
+}
+
+//! Makes the file hold image, sending only the pieces that differ from the file on the host.
+/*!
+ * \return false if the file could not be written. The file on the host is unchanged unless it
+ * is a symbolic link, which is written in place.
+ */
+bool RemoteFile::write(const std::string_view image)
+{
+    if (requested != 0)
+        return false;
+
+    // Ask for the checksums of the pieces of the file as it is.
+    std::vector<std::pair<std::uint32_t, std::uint64_t>> sums;
+    if (exists()) {
+        const std::uint64_t count = (size() + write_piece_size - 1) / write_piece_size;
+        char line[64];
+        std::snprintf(line, sizeof(line), "sums %llu %lu\n",
+                      static_cast<unsigned long long>(count),
+                      static_cast<unsigned long>(write_piece_size));
+        if (!send(line))
+            return false;
+        std::string answer;
+        for (std::uint64_t i = 0; i < count; ++i) {
+            if (!read_line(answer))
+                return false;
+            char *end;
+            const unsigned long crc = std::strtoul(answer.c_str(), &end, 10);
+            const unsigned long long bytes = std::strtoull(end, nullptr, 10);
+            sums.emplace_back(static_cast<std::uint32_t>(crc), bytes);
+        }
+    }
+
+    // Nothing is answered until the commit, so the pieces go out without waiting.
+    if (!send("begin\n"))
+        return false;
+    for (std::size_t offset = 0, piece = 0; offset < image.size();
+         offset += write_piece_size, ++piece) {
+        const std::string_view part = image.substr(offset, write_piece_size);
+        if (piece < sums.size() && sums[piece].second == part.size() &&
+            sums[piece].first == checksum(part))
+            continue;
+        char line[96];
+        std::snprintf(line, sizeof(line), "write %lu %lu %lu\n",
+                      static_cast<unsigned long>(piece),
+                      static_cast<unsigned long>(part.size()),
+                      static_cast<unsigned long>(write_piece_size));
+        if (!send(line) || !send(part))
+            return false;
+    }
+    char line[64];
+    std::snprintf(line, sizeof(line), "commit %llu\n",
+                  static_cast<unsigned long long>(image.size()));
+    std::string answer;
+    if (!send(line) || !read_line(answer) || answer != "ok")
+        return false;
+    length = static_cast<std::int64_t>(image.size());
+    return true;
+}
+
+/*==============================================*/
+/*           Private Member Functions           */
+/*==============================================*/
+
+//! Writes all of text to the helper.
+bool RemoteFile::send(const std::string_view text)
+{
+#if eOPSYS == ePOSIX
+    if (failed || to_host == -1)
+        return false;
+
+    // A helper that exits must not kill the editor with SIGPIPE.
+    struct sigaction ignore;
+    struct sigaction previous;
+    std::memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &ignore, &previous);
+
+    std::size_t written = 0;
+    while (written < text.size()) {
+        const ssize_t count = ::write(to_host, text.data() + written, text.size() - written);
+        if (count > 0)
+            written += static_cast<std::size_t>(count);
+        else if (!(count == -1 && errno == EINTR)) {
+            failed = true;
+            break;
+        }
+    }
+    sigaction(SIGPIPE, &previous, nullptr);
+    return !failed;
+#else
+    (void)text;
+    return false;
+#endif
+}
+
+//! Reads a line from the helper, without its line feed.
+bool RemoteFile::read_line(std::string &line)
+{
+    std::size_t end;
+    while ((end = input.find('\n')) == std::string::npos) {
+        if (!fill(reply_timeout))
+            return false;
+    }
+    line.assign(input, 0, end);
+    input.erase(0, end + 1);
+    return true;
+}
+
+//! Appends count bytes from the helper to text.
+bool RemoteFile::read_exact(const std::size_t count, std::string &text)
+{
+    while (input.size() < count) {
+        if (!fill(reply_timeout))
+            return false;
+    }
+    text.append(input, 0, count);
+    input.erase(0, count);
+    return true;
+}
+
+//! Adds whatever the helper sends next to the bytes received but not yet used.
+/*!
+ * \param timeout The most milliseconds to wait.
+ * \return false if nothing arrives in time, or the connection is broken or ended.
+ */
+bool RemoteFile::fill(const int timeout)
+{
+#if eOPSYS == ePOSIX
+    char buffer[64 * 1024];
+    while (!failed && from_host != -1) {
+        pollfd stream{from_host, POLLIN, 0};
+        const int ready = poll(&stream, 1, timeout);
+        if (ready == -1 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            break;
+        const ssize_t received = ::read(from_host, buffer, sizeof(buffer));
+        if (received == -1 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            break;
+        input.append(buffer, static_cast<std::size_t>(received));
+        return true;
+    }
+#endif
+    failed = true;
+    return false;
+}
@@ -0,0 +1,231 @@
+/*! \file    Renderer.cpp
+ *  \brief   Implementation of the Renderer abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <screen/screen.hpp>
+
+#include "Allocations.hpp"
+#include "DiskEditFile.hpp"
+#include "EditBuffer.hpp"
+#include "EventLoop.hpp"
+#include "JobList.hpp"
+#include "Profiler.hpp"
+#include "Renderer.hpp"
+#include "Startup.hpp"
+#include "WindowList.hpp"
+
+#define DEFAULT_INTERVAL 16 // Milliseconds between frames (a display's refresh period).
+#define RESIZE_DELAY 50     // Milliseconds without a change in size before it is taken on.
+#define BUCKET_COUNT 12     // Latency buckets: < 1 ms, < 2 ms, ... and 1024 ms or more.
+#define BAR_WIDTH 30        // Longest bar shown by report().
+#define HISTORY 32          // Frames whose times are shown by the overlay.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    typedef std::chrono::steady_clock Clock;
+
+    int frame_interval = DEFAULT_INTERVAL;
+    Clock::time_point last_frame;          // When the last frame was finished.
+    std::vector<Clock::time_point> inputs; // When each keystroke not yet shown was read.
+    unsigned long keys_noted = 0;          // What scr::keys_read() was after the last one.
+    unsigned long sizes_noted = 0;         // What scr::size_reports() was at the last look.
+    unsigned resize_timer = 0;             // Waits for the reports to stop (zero if not).
+
+    unsigned long frames = 0;                 // Number of frames shown.
+    unsigned long measured = 0;               // Number of keystrokes whose latency is known.
+    unsigned long buckets[BUCKET_COUNT] = {}; // Keystrokes by latency.
+    long long total_latency = 0;              // Sum of the latencies in microseconds.
+    long long least_latency = 0;              // Limits of the latencies in microseconds.
+    long long most_latency = 0;
+
+    // What the overlay shows. Each figure is taken at the end of a frame.
+    long long frame_times[HISTORY] = {};     // Nanoseconds painting and flushing recent frames.
+    unsigned long long last_cells = 0;       // Output counts at the end of the last frame.
+    unsigned long long last_bytes = 0;
+    unsigned long long last_allocations = 0; // Allocation count at the end of the last frame.
+    unsigned long long frame_cells = 0;      // What the last frame wrote and allocated.
+    unsigned long long frame_bytes = 0;
+    unsigned long long frame_allocations = 0;
+
+    //! Gives the screen the terminal's size and shows the windows arranged for it.
+    void take_size()
+    {
+        resize_timer = 0;
+        if (scr::update_size()) {
+            WindowList::invalidate();
+            Renderer::frame();
+        }
+    }
+
+    //! Notes what the frame that just ended took, for the overlay.
+    void note_frame()
+    {
+        frame_times[frames % HISTORY] =
+            Profiler::latest(Profiler::DISPLAY) + Profiler::latest(Profiler::FLUSH);
+
+        unsigned long long cells, bytes;
+        scr::output_counts(cells, bytes);
+        frame_cells = cells - last_cells;
+        frame_bytes = bytes - last_bytes;
+        last_cells = cells;
+        last_bytes = bytes;
+
+        const unsigned long long allocations = Allocations::count();
+        frame_allocations = allocations - last_allocations;
+        last_allocations = allocations;
+    }
+
+    //! Adds a latency, in microseconds, to the statistics.
+    void record(const long long latency)
+    {
+        int bucket = 0;
+        while (bucket < BUCKET_COUNT - 1 && latency >= (1000LL << bucket))
+            ++bucket;
+        ++buckets[bucket];
+
+        least_latency = (measured == 0) ? latency : std::min(least_latency, latency);
+        most_latency = std::max(most_latency, latency);
+        total_latency += latency;
+        ++measured;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Renderer {
+
+    void note_input(const int keys)
+    {
+        if (scr::keys_read() - keys_noted != static_cast<unsigned long>(keys))
+            inputs.clear();
+        inputs.push_back(Clock::now());
+        keys_noted = scr::keys_read();
+    }
+
+    int time_to_frame()
+    {
+        const long long elapsed =
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - last_frame)
+                .count();
+        return (elapsed >= frame_interval) ? 0 : frame_interval - static_cast<int>(elapsed);
+    }
+
+    void frame()
+    {
+        if (scr::keys_read() != keys_noted)
+            inputs.clear();
+        WindowList::display();
+        Startup::first_frame();
+        last_frame = Clock::now();
+        note_frame();
+        Allocations::trace();
+        ++frames;
+        for (const Clock::time_point input : inputs)
+            record(std::chrono::duration_cast<std::chrono::microseconds>(last_frame - input)
+                       .count());
+        inputs.clear();
+    }
+
+    bool follow_size()
+    {
+        const unsigned long reports = scr::size_reports();
+        if (reports != sizes_noted) {
+            sizes_noted = reports;
+            EventLoop::cancel_timer(resize_timer);
+            resize_timer = EventLoop::add_timer(RESIZE_DELAY, take_size);
+        }
+        return false;
+    }
+
+    int interval()
+    {
+        return frame_interval;
+    }
+
+    void set_interval(const int milliseconds)
+    {
+        frame_interval = std::max(0, milliseconds);
+    }
+
+    std::vector<std::string> overlay()
+    {
+        std::vector<std::string> lines;
+        char line[81];
+
+        // The times are those of the last HISTORY frames.
+        const unsigned long shown = std::min<unsigned long>(frames, HISTORY);
+        long long total = 0, most = 0;
+        for (unsigned long i = 0; i < shown; ++i) {
+            total += frame_times[i];
+            most = std::max(most, frame_times[i]);
+        }
+        const long long last = (frames == 0) ? 0 : frame_times[(frames - 1) % HISTORY];
+        std::snprintf(line, sizeof(line), "Frame ms %6.2f mean %6.2f most %6.2f", last / 1e6,
+                      (shown == 0) ? 0.0 : total / 1e6 / shown, most / 1e6);
+        lines.push_back(line);
+        std::snprintf(line, sizeof(line), "Output   %6llu cells  %7llu bytes", frame_cells,
+                      frame_bytes);
+        lines.push_back(line);
+        std::snprintf(line, sizeof(line), "Allocs   %6llu       total %9llu", frame_allocations,
+                      last_allocations);
+        lines.push_back(line);
+        std::snprintf(line, sizeof(line), "Lines    %6zu KB",
+                      EditBuffer::memory_in_use() / 1024);
+        lines.push_back(line);
+        std::snprintf(line, sizeof(line), "Queue    %6d loads  %6u jobs",
+                      DiskEditFile::background_loads(), JobList::count());
+        lines.push_back(line);
+        return lines;
+    }
+
+    std::vector<std::string> report()
+    {
+        std::vector<std::string> lines;
+        char line[81];
+
+        std::snprintf(line, sizeof(line), "Frames shown:          %lu", frames);
+        lines.push_back(line);
+        std::snprintf(line, sizeof(line), "Frame interval:        %d ms", frame_interval);
+        lines.push_back(line);
+        std::snprintf(line, sizeof(line), "Keystrokes measured:   %lu", measured);
+        lines.push_back(line);
+        if (measured != 0) {
+            std::snprintf(line, sizeof(line), "Latency (ms):  least %.1f  mean %.1f  most %.1f",
+                          least_latency / 1000.0, total_latency / 1000.0 / measured,
+                          most_latency / 1000.0);
+            lines.push_back(line);
+        }
+        lines.push_back("");
+
+        // Each bucket is shown with a bar scaled to the largest one.
+        const unsigned long largest = *std::max_element(buckets, buckets + BUCKET_COUNT);
+        for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            if (bucket < BUCKET_COUNT - 1)
+                std::snprintf(line, sizeof(line), "  < %4d ms %7lu ", 1 << bucket,
+                              buckets[bucket]);
+            else
+                std::snprintf(line, sizeof(line), " >= %4d ms %7lu ", 1 << (bucket - 1),
+                              buckets[bucket]);
+            std::string text(line);
+            if (largest != 0)
+                text.append((buckets[bucket] * BAR_WIDTH + largest - 1) / largest, '#');
+            lines.push_back(text);
+        }
+        return lines;
+    }
+
+} // namespace Renderer
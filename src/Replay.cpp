@@ -0,0 +1,312 @@
+/*! \file    Replay.cpp
+ *  \brief   Implementation of the Replay abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <screen/screen.hpp>
+
+#include "Replay.hpp"
+#include "Startup.hpp"
+#include "Trace.hpp"
+#include "WordSource.hpp"
+
+#define SLOWEST_SHOWN 5 // Keystrokes listed in the summary as the slowest.
+#define RECORD_WIDTH 72 // Recorded scripts start a new line after about this many characters.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! What is known about one keystroke of the script.
+    struct Sample {
+        int key;
+        long long nanoseconds = 0;    //!< Time until the editor asked for the next key.
+        unsigned long long bytes = 0; //!< Bytes sent meanwhile.
+    };
+
+    std::string script;          // The name of the script.
+    std::string log;             // The name of the log (empty for none).
+    std::vector<Sample> samples; // The keystrokes of the script.
+    std::size_t next = 0;        // The index of the sample to hand out next.
+    long long started = 0;       // When the script was read.
+    long long handed_at = 0;     // When the last key was handed out.
+    unsigned long long bytes_at = 0; // The bytes sent by then.
+
+    std::FILE *recording = nullptr; // The script being recorded (nullptr if none).
+    int recorded_width = 0;         // Characters on the recorded line so far.
+    bool in_quotes = false;         // =true if the recording is in the middle of some text.
+
+    //! Returns the number of bytes sent to the display so far.
+    unsigned long long bytes_sent()
+    {
+        unsigned long long cells, bytes;
+        scr::output_counts(cells, bytes);
+        return bytes;
+    }
+
+    //! Reads a script into samples. Prints the reason and returns false if it can't.
+    bool parse(const char *const name)
+    {
+        std::FILE *const file = std::fopen(name, "r");
+        if (file == nullptr) {
+            std::fprintf(stderr, "Can't open %s\n", name);
+            return false;
+        }
+        std::string text;
+        char block[4096];
+        std::size_t count;
+        while ((count = std::fread(block, 1, sizeof(block), file)) > 0)
+            text.append(block, count);
+        std::fclose(file);
+
+        int line = 1;
+        std::size_t i = 0;
+        auto fail = [&](const char *const problem, const std::string &detail) {
+            std::fprintf(stderr, "%s:%d: %s%s\n", name, line, problem, detail.c_str());
+            return false;
+        };
+        while (i < text.size()) {
+            const char letter = text[i];
+            if (letter == '\n')
+                ++line;
+            if (std::isspace(static_cast<unsigned char>(letter))) {
+                ++i;
+                continue;
+            }
+            if (letter == '#') {
+                while (i < text.size() && text[i] != '\n')
+                    ++i;
+                continue;
+            }
+
+            // Get the keys of the item.
+            std::vector<int> keys;
+            if (letter == '"') {
+                for (++i; i < text.size() && text[i] != '"' && text[i] != '\n'; ++i) {
+                    if (text[i] == '\\' && i + 1 < text.size())
+                        ++i;
+                    keys.push_back(static_cast<unsigned char>(text[i]));
+                }
+                if (i == text.size() || text[i] != '"')
+                    return fail("Unterminated text", "");
+                ++i;
+            }
+            else {
+                const std::size_t start = i;
+                while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])) &&
+                       text[i] != '*' && text[i] != '#')
+                    ++i;
+                const std::string key_text = text.substr(start, i - start);
+                const int code = key_code(key_text.c_str());
+                if (code == -1)
+                    return fail("Unknown key ", key_text);
+                keys.push_back(code);
+            }
+
+            // Get the count, if any.
+            long repeats = 1;
+            if (i < text.size() && text[i] == '*') {
+                char *end;
+                repeats = std::strtol(text.c_str() + i + 1, &end, 10);
+                if (end == text.c_str() + i + 1 || repeats < 0)
+                    return fail("Bad count", "");
+                i = static_cast<std::size_t>(end - text.c_str());
+            }
+            for (long repeat = 0; repeat < repeats; ++repeat) {
+                for (const int key : keys)
+                    samples.push_back(Sample{key});
+            }
+        }
+        return true;
+    }
+
+    //! Returns the value below which a fraction of the sorted values lie. There must be some.
+    template <typename T> T percentile(const std::vector<T> &sorted, const double fraction)
+    {
+        const std::size_t index = static_cast<std::size_t>(fraction * (sorted.size() - 1));
+        return sorted[index];
+    }
+
+    //! Writes every keystroke to the log as comma separated values.
+    void write_log()
+    {
+        std::FILE *const file = std::fopen(log.c_str(), "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "Can't write %s\n", log.c_str());
+            return;
+        }
+        std::fprintf(file, "index,key,microseconds,bytes\n");
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            const char *const name = key_name(samples[i].key);
+            std::fprintf(file, "%zu,%s,%.1f,%llu\n", i + 1, (name != nullptr) ? name : "?",
+                         samples[i].nanoseconds / 1000.0, samples[i].bytes);
+        }
+        std::fclose(file);
+    }
+
+    //! Prints a summary of the keystrokes and the slowest of them.
+    void print_summary(const long long first_key)
+    {
+        std::vector<double> times;
+        std::vector<unsigned long long> bytes;
+        double total_time = 0.0;
+        unsigned long long total_bytes = 0;
+        for (const Sample &sample : samples) {
+            times.push_back(sample.nanoseconds / 1e6);
+            bytes.push_back(sample.bytes);
+            total_time += sample.nanoseconds / 1e6;
+            total_bytes += sample.bytes;
+        }
+
+        std::printf("Replayed %zu keys from %s in %.1f ms (%.1f ms before the first key)\n",
+                    samples.size(), script.c_str(), total_time, (first_key - started) / 1e6);
+        std::printf("\n");
+        for (const std::string &line : Startup::report())
+            std::printf("%s\n", line.c_str());
+        if (samples.empty())
+            return;
+        std::printf("\nSent %llu bytes to the terminal\n\n", total_bytes);
+
+        std::sort(times.begin(), times.end());
+        std::sort(bytes.begin(), bytes.end());
+        std::printf("%-10s %10s %10s %10s %10s %10s\n", "", "Mean", "Median", "90%", "99%",
+                    "Most");
+        std::printf("%-10s %10.3f %10.3f %10.3f %10.3f %10.3f\n", "Time (ms)",
+                    total_time / samples.size(), percentile(times, 0.5), percentile(times, 0.9),
+                    percentile(times, 0.99), times.back());
+        std::printf("%-10s %10.1f %10llu %10llu %10llu %10llu\n", "Bytes",
+                    static_cast<double>(total_bytes) / samples.size(), percentile(bytes, 0.5),
+                    percentile(bytes, 0.9), percentile(bytes, 0.99), bytes.back());
+
+        std::vector<std::size_t> order(samples.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        const std::size_t shown = std::min<std::size_t>(SLOWEST_SHOWN, order.size());
+        std::partial_sort(order.begin(), order.begin() + shown, order.end(),
+                          [](const std::size_t left, const std::size_t right) {
+                              return samples[left].nanoseconds > samples[right].nanoseconds;
+                          });
+        std::printf("\nSlowest keys:\n");
+        for (std::size_t i = 0; i < shown; ++i) {
+            const Sample &sample = samples[order[i]];
+            const char *const name = key_name(sample.key);
+            std::printf("  %8zu %-12s %10.3f ms %10llu bytes\n", order[i] + 1,
+                        (name != nullptr) ? name : "?", sample.nanoseconds / 1e6, sample.bytes);
+        }
+    }
+
+    //! Returns the next key of the script, measuring the one before it. Exits at the end.
+    int next_key()
+    {
+        const long long now = Trace::now();
+        const unsigned long long bytes = bytes_sent();
+        static long long first_key = 0;
+        if (next == 0)
+            first_key = now;
+        else {
+            samples[next - 1].nanoseconds = now - handed_at;
+            samples[next - 1].bytes = bytes - bytes_at;
+        }
+
+        if (next == samples.size()) {
+            print_summary(first_key);
+            if (!log.empty())
+                write_log();
+            std::exit(EXIT_SUCCESS);
+        }
+        handed_at = Trace::now();
+        bytes_at = bytes;
+        return samples[next++].key;
+    }
+
+    //! Writes something to the recorded script, starting a new line if this one is full.
+    void write_recorded(const char *const text)
+    {
+        const int width = static_cast<int>(std::strlen(text));
+        if (recorded_width > 0 && recorded_width + width > RECORD_WIDTH && !in_quotes) {
+            std::fputc('\n', recording);
+            recorded_width = 0;
+        }
+        std::fputs(text, recording);
+        std::fflush(recording); // The script survives even if the editor is killed.
+        recorded_width += width;
+    }
+
+    //! Adds a keystroke to the recorded script. Printable characters are kept as text.
+    void record_key(const int key)
+    {
+        const bool printable = key >= ' ' && key <= '~';
+        if (in_quotes && !printable) {
+            write_recorded("\" ");
+            in_quotes = false;
+        }
+        if (printable) {
+            if (!in_quotes) {
+                write_recorded("\"");
+                in_quotes = true;
+            }
+            const char text[] = {'\\', static_cast<char>(key), '\0'};
+            write_recorded((key == '"' || key == '\\') ? text : text + 1);
+            return;
+        }
+
+        const char *const name = key_name(key);
+        if (name == nullptr)
+            return;
+        write_recorded(name);
+        write_recorded(" ");
+    }
+
+    //! Finishes the recorded script when the editor exits.
+    void finish_recording()
+    {
+        if (in_quotes)
+            std::fputc('"', recording);
+        std::fputc('\n', recording);
+        std::fclose(recording);
+        recording = nullptr;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Replay {
+
+    bool start(const char *const script_name, const char *const log_name, const int rows,
+               const int columns)
+    {
+        started = Trace::now();
+        if (!parse(script_name))
+            return false;
+        script = script_name;
+        log = (log_name != nullptr) ? log_name : "";
+        scr::use_headless(rows, columns, next_key);
+        return true;
+    }
+
+    bool record(const char *const file_name)
+    {
+        recording = std::fopen(file_name, "w");
+        if (recording == nullptr)
+            return false;
+        std::fputs("# Keystrokes recorded by yexa. Set YEXA_REPLAY to replay them.\n",
+                   recording);
+        std::atexit(finish_recording);
+        scr::record_keys(record_key);
+        return true;
+    }
+
+} // namespace Replay
@@ -3,16 +3,27 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cstring>
+#include <algorithm>
 
+#include "EditBatch.hpp"
 #include "EditBuffer.hpp"
+#include "Profiler.hpp"
 #include "SearchEditFile.hpp"
+#include "SearchPattern.hpp"
+#include "Utf8.hpp"
+
+namespace {
+    // Replacements are made in batches of about this many so the batch itself stays small.
+    constexpr std::size_t batch_limit = 4096;
+} // namespace
 
 /*!
  * Search from the current point forward in the file's data looking for the first occurrence of
  * search_string. If the current point is already on the start of a valid copy of the search
  * string, the search stops at once and the current point is not moved.
  *
+ * Clients that search for the same string repeatedly should compile it into a SearchPattern
+ * once and use search() instead.
  *
  * \param search_string The string being searched for. The string must be contained entirely on
  * a single line to be considered found on that line.
@@ -21,39 +32,170 @@
  */
 bool SearchEditFile::simple_search(const char *search_string)
 {
-    const char *found_string; // Points at copy of string inside a line.
-    bool found = false;       // =true if the string is found.
+    return search(SearchPattern(search_string));
+}
+
+/*!
+ * Search from the current point forward in the file's data looking for the first occurrence of
+ * the pattern. The lines are scanned in place without being copied. If the current point is
+ * already on the start of a match, the search stops at once and the current point is not
+ * moved.
+ *
+ * \param pattern The compiled search string. It must be contained entirely on a single line to
+ * be considered found on that line.
+ * \param match_length If not nullptr, set to the number of characters in the occurrence found.
+ * \return True if an occurrence of the pattern is found, otherwise return false. If an
+ * occurrence is found the current point is moved to the start of that occurrence.
+ */
+bool SearchEditFile::search(const SearchPattern &pattern, std::size_t *const match_length)
+{
+    Profiler::Scope zone(Profiler::SEARCH);
+    std::size_t found_offset;
+    std::size_t found_length;
+
+    // Moves the current point to the occurrence and converts its length to characters.
+    auto found = [&](const EditBuffer &line) {
+        const std::size_t column = line.column_of(found_offset, tab_stop);
+        current_point.jump_to_column(static_cast<unsigned>(column));
+        if (match_length != nullptr)
+            *match_length = Utf8::characters(line.view().substr(found_offset, found_length));
+        return true;
+    };
 
     // Check the current line (if there is one).
     file_data.jump_to(current_point.cursor_line());
     if (file_data.get() != nullptr) {
 
         // If the current point on the text of a line, check the partial line.
-        if (current_point.cursor_column() < file_data.get()->length()) {
-            std::string line = file_data.get()->to_string();
-
-            // If we've found it already, jump to it and set found.
-            if ((found_string = std::strstr(line.c_str() + current_point.cursor_column(),
-                                            search_string)) != nullptr) {
-                found = true;
-                current_point.jump_to_column(found_string - line.c_str());
-            }
+        const EditBuffer &line = *file_data.get();
+        const std::size_t offset = line.offset_of(current_point.cursor_column(), tab_stop);
+        if (offset < line.length()) {
+            found_offset = pattern.find(line.view(), offset, &found_length);
+
+            // If we've found it already, jump to it.
+            if (found_offset != SearchPattern::npos)
+                return found(line);
         }
     }
 
-    // Check all other lines in the object if we haven't already found it.
-    if (found == false) {
+    // Check all other lines in the object.
+    for (file_data.next(); file_data.get() != nullptr; file_data.next()) {
+        found_offset = pattern.find(file_data.get()->view(), 0, &found_length);
+        if (found_offset != SearchPattern::npos) {
+            current_point.jump_to_line(file_data.current_index());
+            return found(*file_data.get());
+        }
+    }
 
-        for (file_data.next(); file_data.get() != nullptr; file_data.next()) {
-            std::string line = file_data.get()->to_string();
-            if ((found_string = std::strstr(line.c_str(), search_string)) != nullptr) {
-                found = true;
-                current_point.jump_to_line(file_data.current_index());
-                current_point.jump_to_column(found_string - line.c_str());
-                break;
+    return false;
+}
+
+/*!
+ * Search forward from an offset in a line for the first occurrence of the pattern, examining
+ * whole lines until about budget bytes have been searched. The current point is not moved.
+ *
+ * \param pattern The compiled search string.
+ * \param line [in, out] The line where the search starts. Once the search is over it is the
+ * line of the occurrence, or -1 if there is none. Otherwise it is where to continue.
+ * \param offset [in, out] The byte offset in the line where the search starts, and likewise
+ * the offset of the occurrence or the offset from which to continue.
+ * \param budget The number of bytes to examine before giving up for now.
+ * \param match_length If not nullptr, set to the number of bytes in the occurrence found.
+ * \return True if the search is over, false if the budget ran out first.
+ */
+bool SearchEditFile::search_part(const SearchPattern &pattern, long &line, std::size_t &offset,
+                                 std::size_t budget, std::size_t *const match_length)
+{
+    Profiler::Scope zone(Profiler::SEARCH);
+    std::size_t found_length;
+
+    file_data.jump_to(line);
+    for (const EditBuffer *text = file_data.next(); text != nullptr; text = file_data.next()) {
+        const std::string_view view = text->view();
+        if (offset <= view.size()) {
+            const std::size_t found = pattern.find(view, offset, &found_length);
+            if (found != SearchPattern::npos) {
+                line = file_data.current_index() - 1;
+                offset = found;
+                if (match_length != nullptr)
+                    *match_length = found_length;
+                return true;
             }
         }
+
+        // Each line costs at least a byte so that a file of empty lines is searched in parts.
+        const std::size_t examined = view.size() - std::min(offset, view.size()) + 1;
+        offset = 0;
+        if (examined >= budget) {
+            line = file_data.current_index();
+            return false;
+        }
+        budget -= examined;
     }
+    line = -1L;
+    return true;
+}
+
+/*!
+ * Replace every occurrence of the pattern that starts at or after the current point and lies on
+ * a line no later than last_line. The lines are scanned in one forward pass and the
+ * occurrences are then replaced together (see apply_edits), a few thousand at a time, so each
+ * line with an occurrence is rewritten and recorded for undo once. The current point is
+ * not moved. An empty match is replaced and then the character following it is skipped so
+ * that the pass always advances. An empty match just after another occurrence is ignored.
+ *
+ * \param pattern The compiled search string.
+ * \param replacement The text that replaces each occurrence.
+ * \param last_line The last line to consider.
+ * \return The number of occurrences replaced.
+ */
+long SearchEditFile::replace_all(const SearchPattern &pattern,
+                                 const std::string_view replacement, const long last_line)
+{
+    Profiler::Scope zone(Profiler::SEARCH);
+    long count = 0;
+    long done = 0; // The occurrences replaced by the parts of the batch already made.
+    EditBatch batch;
+
+    file_data.jump_to(current_point.cursor_line());
+    const unsigned cursor = current_point.cursor_column();
+    std::size_t column =
+        (file_data.get() != nullptr) ? file_data.get()->offset_of(cursor, tab_stop) : 0;
+    for (EditBuffer *line = file_data.get();
+         line != nullptr && file_data.current_index() <= last_line;
+         file_data.next(), line = file_data.get(), column = 0) {
 
-    return found;
+        const std::string_view old_text = line->view();
+        std::size_t match_length;
+        std::size_t found = pattern.find(old_text, column, &match_length);
+        bool after_match = false; // True if an occurrence ended at column.
+        while (found != SearchPattern::npos) {
+            // As with sed, an empty match just after another occurrence is not replaced.
+            if (!(match_length == 0 && after_match && found == column)) {
+                batch.replace(file_data.current_index(), found, match_length, replacement);
+                column = found + match_length;
+                ++count;
+            }
+            after_match = (match_length != 0);
+            if (match_length == 0) {
+                if (column >= old_text.length())
+                    break;
+                column = Utf8::next(old_text, column);
+            }
+            found = pattern.find(old_text, column, &match_length);
+        }
+
+        // A very large batch is made in parts, which is possible while lines are not broken.
+        if (batch.size() >= batch_limit && replacement.find('\n') == std::string_view::npos) {
+            const long line_number = file_data.current_index();
+            if (!apply_edits(batch))
+                return done;
+            done = count;
+            batch.clear();
+            file_data.jump_to(line_number);
+        }
+    }
+    if (!apply_edits(batch))
+        return done;
+    return count;
 }
@@ -0,0 +1,312 @@
+/*! \file    SearchPattern.cpp
+ *  \brief   Implementation of class SearchPattern.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstring>
+
+#include "SearchPattern.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SEARCHPATTERN_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+    //! Tables of what is known about each character, indexed by its unsigned value.
+    struct CharacterTables {
+        unsigned char lower[256]; //!< The character with ASCII letters folded to lower case.
+        bool word[256];           //!< =true for the characters of words.
+
+        constexpr CharacterTables() : lower(), word()
+        {
+            for (int ch = 0; ch < 256; ++ch) {
+                const bool upper = ch >= 'A' && ch <= 'Z';
+                lower[ch] = static_cast<unsigned char>(upper ? ch + ('a' - 'A') : ch);
+                word[ch] = upper || (lower[ch] >= 'a' && lower[ch] <= 'z') ||
+                           (ch >= '0' && ch <= '9') || ch == '_' || ch >= 0x80;
+            }
+        }
+    };
+
+    constexpr CharacterTables characters;
+
+    //! Returns the unsigned value of a character.
+    inline unsigned char byte(const char ch)
+    {
+        return static_cast<unsigned char>(ch);
+    }
+
+#if defined(SEARCHPATTERN_SSE2)
+    //! Folds the ASCII letters of 16 characters to lower case.
+    inline __m128i fold_block(const __m128i block)
+    {
+        // Characters above 0x7F compare as negative, so they are never taken for letters.
+        const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1)),
+                                            _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1)));
+        return _mm_or_si128(block, _mm_and_si128(upper, _mm_set1_epi8('a' - 'A')));
+    }
+#endif
+
+    //! Returns true if text, folded to lower case, is the same as the folded text given.
+    bool equal_folded(const char *text, const char *folded, std::size_t length)
+    {
+#if defined(SEARCHPATTERN_SSE2)
+        for (; length >= 16; length -= 16, text += 16, folded += 16) {
+            const __m128i block =
+                fold_block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(text)));
+            const __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i *>(folded));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, expected)) != 0xFFFF)
+                return false;
+        }
+#endif
+        for (; length > 0; --length, ++text, ++folded) {
+            if (characters.lower[byte(*text)] != byte(*folded))
+                return false;
+        }
+        return true;
+    }
+
+    //! Returns a lower case ASCII letter in upper case. Other characters are returned as is.
+    inline unsigned char other_case(const unsigned char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') ? static_cast<unsigned char>(ch - ('a' - 'A')) : ch;
+    }
+
+    //! Returns true if the match at offset isn't continued by word characters on either side.
+    bool whole_word(const std::string_view subject, const std::size_t offset,
+                    const std::size_t length)
+    {
+        if (length == 0)
+            return true;
+        const std::size_t end = offset + length;
+        if (characters.word[byte(subject[offset])] && offset > 0 &&
+            characters.word[byte(subject[offset - 1])])
+            return false;
+        if (characters.word[byte(subject[end - 1])] && end < subject.length() &&
+            characters.word[byte(subject[end])])
+            return false;
+        return true;
+    }
+
+#if defined(SEARCHPATTERN_SSE2)
+    //! Returns the index of the lowest set bit in a non-zero mask.
+    inline unsigned lowest_bit(unsigned mask)
+    {
+#if defined(__GNUC__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned bit = 0;
+        while ((mask & 1U) == 0) {
+            mask >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+#endif
+} // namespace
+
+//! Prepares the given text for searching, replacing any previous pattern.
+/*!
+ * \return false if mode is REGULAR_EXPRESSION and the text is not a valid regular expression.
+ * The error() function then describes the problem and the pattern matches nothing.
+ */
+bool SearchPattern::compile(const std::string_view text, const Mode mode,
+                            const unsigned options)
+{
+    pattern.assign(text.data(), text.size());
+    folded.clear();
+    pattern_mode = mode;
+    pattern_options = options;
+    if (mode == REGULAR_EXPRESSION)
+        return expression.compile(text, (options & IGNORE_CASE) != 0);
+
+    const std::size_t length = pattern.length();
+    for (std::size_t &distance : skip) {
+        distance = length;
+    }
+    if ((options & IGNORE_CASE) == 0) {
+        for (std::size_t i = 0; i + 1 < length; ++i) {
+            skip[byte(pattern[i])] = length - 1 - i;
+        }
+        return true;
+    }
+
+    // Ignoring case, a letter of either case ending the window shifts it the same distance.
+    for (const char ch : pattern)
+        folded.push_back(static_cast<char>(characters.lower[byte(ch)]));
+    for (std::size_t i = 0; i + 1 < length; ++i) {
+        const unsigned char letter = byte(folded[i]);
+        skip[letter] = length - 1 - i;
+        skip[other_case(letter)] = length - 1 - i;
+    }
+    return true;
+}
+
+//! Searches for the pattern.
+/*!
+ * \param subject The text to search.
+ * \param start The offset in subject where the search begins.
+ * \param match_length If not nullptr, set to the length of the text matched. For regular
+ * expressions this may differ from the length of the pattern and may be zero.
+ * \return The offset of the first occurrence of the pattern at or after start, or npos if
+ * there is none. An empty pattern is found at start.
+ */
+std::size_t SearchPattern::find(const std::string_view subject, const std::size_t start,
+                                std::size_t *const match_length) const
+{
+    std::size_t length;
+    std::size_t result = find_match(subject, start, length);
+
+    // A match that is part of a longer word is passed over. The next may start within it.
+    if ((pattern_options & WHOLE_WORD) != 0) {
+        while (result != npos && !whole_word(subject, result, length)) {
+            if (result >= subject.length())
+                return npos;
+            result = find_match(subject, result + 1, length);
+        }
+    }
+    if (result != npos && match_length != nullptr)
+        *match_length = length;
+    return result;
+}
+
+//! Searches for the pattern, taking no account of words.
+std::size_t SearchPattern::find_match(const std::string_view subject, const std::size_t start,
+                                      std::size_t &match_length) const
+{
+    if (pattern_mode == REGULAR_EXPRESSION) {
+        std::size_t match_start;
+        if (!expression.find(subject, start, match_start, match_length))
+            return npos;
+        return match_start;
+    }
+
+    match_length = pattern.length();
+    if ((pattern_options & IGNORE_CASE) != 0)
+        return find_folded(subject, start);
+    return find_literal(subject, start);
+}
+
+//! Searches for a literal pattern.
+std::size_t SearchPattern::find_literal(const std::string_view subject,
+                                        const std::size_t start) const
+{
+    const std::size_t length = pattern.length();
+    if (start > subject.length() || subject.length() - start < length)
+        return npos;
+    if (length == 0)
+        return start;
+
+    const char *const base = subject.data();
+    const char *const last = base + subject.length() - length; // Last possible match start.
+    const char first = pattern[0];
+    const char final = pattern[length - 1];
+    const char *window = base + start;
+
+    // A single character is found directly with memchr.
+    if (length == 1) {
+        const void *found = std::memchr(window, first, subject.length() - start);
+        return found == nullptr ? npos : static_cast<const char *>(found) - base;
+    }
+
+#if defined(SEARCHPATTERN_SSE2)
+    // Compare the first and last characters of the pattern against 16 window positions at
+    // once. Only positions where both match are verified with memcmp.
+    const __m128i first_block = _mm_set1_epi8(first);
+    const __m128i final_block = _mm_set1_epi8(final);
+    while (last - window >= 16) {
+        const __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i *>(window));
+        const __m128i tails =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(window + length - 1));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(heads, first_block), _mm_cmpeq_epi8(tails, final_block))));
+        while (mask != 0) {
+            const unsigned bit = lowest_bit(mask);
+            if (std::memcmp(window + bit + 1, pattern.data() + 1, length - 2) == 0)
+                return static_cast<std::size_t>(window + bit - base);
+            mask &= mask - 1;
+        }
+        window += 16;
+    }
+#endif
+
+    // Horspool's algorithm, comparing the last character of the window first. With SSE2 this
+    // only handles the final few positions.
+    while (window <= last) {
+        const char end_character = window[length - 1];
+        if (end_character == final && window[0] == first &&
+            std::memcmp(window + 1, pattern.data() + 1, length - 2) == 0)
+            return static_cast<std::size_t>(window - base);
+        window += skip[static_cast<unsigned char>(end_character)];
+    }
+    return npos;
+}
+
+//! Searches for a literal pattern, ignoring the case of ASCII letters.
+/*!
+ * This is find_literal with each character folded to lower case before it is compared. With
+ * SSE2 16 window positions are checked at once, and candidates are verified by folding 16
+ * characters at a time.
+ */
+std::size_t SearchPattern::find_folded(const std::string_view subject,
+                                       const std::size_t start) const
+{
+    const std::size_t length = folded.length();
+    if (start > subject.length() || subject.length() - start < length)
+        return npos;
+    if (length == 0)
+        return start;
+
+    const char *const base = subject.data();
+    const char *const last = base + subject.length() - length; // Last possible match start.
+    const unsigned char first = byte(folded[0]);
+    const unsigned char final = byte(folded[length - 1]);
+    const std::size_t middle = (length > 2) ? length - 2 : 0; // Characters between the two.
+    const char *window = base + start;
+
+    // A single character that isn't a letter is found directly with memchr.
+    if (length == 1 && !(first >= 'a' && first <= 'z')) {
+        const void *found = std::memchr(window, first, subject.length() - start);
+        return found == nullptr ? npos : static_cast<const char *>(found) - base;
+    }
+
+#if defined(SEARCHPATTERN_SSE2)
+    // The first and last characters are compared against both of their cases, which takes
+    // fewer instructions than folding the window positions.
+    const __m128i first_block = _mm_set1_epi8(static_cast<char>(first));
+    const __m128i first_other = _mm_set1_epi8(static_cast<char>(other_case(first)));
+    const __m128i final_block = _mm_set1_epi8(static_cast<char>(final));
+    const __m128i final_other = _mm_set1_epi8(static_cast<char>(other_case(final)));
+    while (last - window >= 16) {
+        const __m128i heads = _mm_loadu_si128(reinterpret_cast<const __m128i *>(window));
+        const __m128i tails =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(window + length - 1));
+        const __m128i head_matches = _mm_or_si128(_mm_cmpeq_epi8(heads, first_block),
+                                                  _mm_cmpeq_epi8(heads, first_other));
+        const __m128i tail_matches = _mm_or_si128(_mm_cmpeq_epi8(tails, final_block),
+                                                  _mm_cmpeq_epi8(tails, final_other));
+        unsigned mask =
+            static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(head_matches, tail_matches)));
+        while (mask != 0) {
+            const unsigned bit = lowest_bit(mask);
+            if (equal_folded(window + bit + 1, folded.data() + 1, middle))
+                return static_cast<std::size_t>(window + bit - base);
+            mask &= mask - 1;
+        }
+        window += 16;
+    }
+#endif
+
+    while (window <= last) {
+        const unsigned char end_character = byte(window[length - 1]);
+        if (characters.lower[end_character] == final &&
+            characters.lower[byte(window[0])] == first &&
+            equal_folded(window + 1, folded.data() + 1, middle))
+            return static_cast<std::size_t>(window - base);
+        window += skip[end_character];
+    }
+    return npos;
+}
@@ -0,0 +1,361 @@
+/*! \file    Server.cpp
+ *  \brief   Implementation of the Server abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "EventLoop.hpp"
+#include "Server.hpp"
+#include "support.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+#if eOPSYS == ePOSIX
+
+    // A request is the client's directory and then its arguments, each ending with a null
+    // character. The server answers "ok" once it has taken the arguments and closes the
+    // connection without answering if it refuses them.
+    constexpr std::size_t maximum_request = 64U * 1024U;
+    constexpr long request_timeout = 1000; // Milliseconds a whole request may take to arrive.
+    constexpr long reply_timeout = 2000;   // Milliseconds a client waits for the answer.
+    const char accepted[] = "ok";
+
+    int listener = -1;           //!< The socket listened on, if any.
+    std::string listener_name;   //!< Its name.
+    pid_t listener_process = 0;  //!< The process that made it (not a child made by a job).
+    bool (*opener)(std::vector<std::string> &) = nullptr;
+
+    bool enabled()
+    {
+        const char *const setting = std::getenv("YSERVER");
+        return setting != nullptr && *setting != '\0';
+    }
+
+    std::string current_directory()
+    {
+        std::vector<char> buffer(256);
+        while (getcwd(buffer.data(), buffer.size()) == nullptr) {
+            if (errno != ERANGE || buffer.size() > 65536)
+                return "";
+            buffer.resize(buffer.size() * 2);
+        }
+        return buffer.data();
+    }
+
+    //! Returns true if path is a directory that only the user can get into.
+    bool private_directory(const std::string &path)
+    {
+        struct stat information;
+        return lstat(path.c_str(), &information) == 0 && S_ISDIR(information.st_mode) &&
+               information.st_uid == getuid() &&
+               (information.st_mode & (S_IRWXG | S_IRWXO)) == 0;
+    }
+
+    //! Returns the directory holding the user's sockets or an empty string if there is none.
+    /*!
+     * Without XDG_RUNTIME_DIR the sockets go in a directory of their own under /tmp. Since
+     * anyone can make things in /tmp, a directory there that isn't the user's alone is refused
+     * rather than trusted.
+     */
+    std::string socket_directory()
+    {
+        const char *const runtime = std::getenv("XDG_RUNTIME_DIR");
+        if (runtime != nullptr && *runtime != '\0')
+            return runtime;
+        char name[32];
+        std::snprintf(
+            name, sizeof(name), "/tmp/yexa-%lu", static_cast<unsigned long>(getuid()));
+        if (mkdir(name, S_IRWXU) != 0 && errno != EEXIST)
+            return "";
+        return private_directory(name) ? name : "";
+    }
+
+    //! Returns the name of the socket used by the user's editors in directory.
+    /*!
+     * \return An empty string if there is no safe place for the socket.
+     */
+    std::string socket_name(const std::string &directory)
+    {
+        const std::string parent = socket_directory();
+        if (parent.empty())
+            return "";
+        // The FNV-1a hash of the directory keeps the name short enough for a socket address.
+        const std::uint64_t hash = fnv1a(directory);
+        char name[64];
+        std::snprintf(name, sizeof(name), "/yexa-%lu-%016llx.sock",
+                      static_cast<unsigned long>(getuid()),
+                      static_cast<unsigned long long>(hash));
+        return parent + name;
+    }
+
+    //! Returns true if the named socket exists and belongs to the user.
+    bool owned_socket(const std::string &name)
+    {
+        struct stat information;
+        return lstat(name.c_str(), &information) == 0 && S_ISSOCK(information.st_mode) &&
+               information.st_uid == getuid();
+    }
+
+    //! Returns true if the process at the other end of the connection is the user's.
+    bool trusted_peer(const int fd)
+    {
+#if defined(SO_PEERCRED)
+        ucred credentials;
+        socklen_t size = sizeof(credentials);
+        return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) == 0 &&
+               credentials.uid == getuid();
+#else
+        uid_t user;
+        gid_t group;
+        return getpeereid(fd, &user, &group) == 0 && user == getuid();
+#endif
+    }
+
+    //! Fills in the address of the named socket.
+    /*!
+     * \return false if the name is too long for a socket address.
+     */
+    bool make_address(const std::string &name, sockaddr_un &address)
+    {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (name.size() >= sizeof(address.sun_path))
+            return false;
+        std::memcpy(address.sun_path, name.c_str(), name.size() + 1);
+        return true;
+    }
+
+    void set_timeout(const int fd, const int option, const long milliseconds)
+    {
+        timeval limit;
+        limit.tv_sec = milliseconds / 1000;
+        limit.tv_usec = (milliseconds % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, option, &limit, sizeof(limit));
+    }
+
+    //! Writes all of text, returning false if that fails.
+    bool send_all(const int fd, const char *text, std::size_t size)
+    {
+#if defined(MSG_NOSIGNAL)
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        while (size > 0) {
+            const ssize_t sent = send(fd, text, size, flags);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent <= 0)
+                return false;
+            text += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+    //! Reads until the other end closes the connection or limit bytes have been read.
+    /*!
+     * The timeout covers the whole read, so a peer that trickles in a byte at a time can't
+     * hold things up any longer than one that sends nothing.
+     *
+     * \return false if reading failed or timed out before the connection was closed.
+     */
+    bool receive_all(
+        const int fd, std::string &text, const std::size_t limit, const long milliseconds)
+    {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point deadline =
+            Clock::now() + std::chrono::milliseconds(milliseconds);
+        char buffer[4096];
+        while (text.size() <= limit) {
+            const long remaining = static_cast<long>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now())
+                    .count());
+            if (remaining <= 0)
+                return false;
+            set_timeout(fd, SO_RCVTIMEO, remaining);
+            const ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count < 0)
+                return false;
+            if (count == 0)
+                return true;
+            text.append(buffer, static_cast<std::size_t>(count));
+        }
+        return false;
+    }
+
+    //! Removes the socket when the editor that made it exits.
+    void remove_socket()
+    {
+        if (listener == -1 || getpid() != listener_process)
+            return;
+        close(listener);
+        unlink(listener_name.c_str());
+        listener = -1;
+    }
+
+    //! Takes the command line sent over a connection, if it is for this directory.
+    void handle_request(const int client)
+    {
+        // A listening socket that doesn't block may give connections that don't either.
+        fcntl(client, F_SETFL, fcntl(client, F_GETFL) & ~O_NONBLOCK);
+        set_timeout(client, SO_SNDTIMEO, request_timeout);
+        if (!trusted_peer(client))
+            return;
+
+        std::string request;
+        if (!receive_all(client, request, maximum_request, request_timeout))
+            return;
+        std::vector<std::string> fields;
+        for (std::size_t start = 0; start < request.size();) {
+            std::size_t end = request.find('\0', start);
+            if (end == std::string::npos)
+                end = request.size();
+            fields.emplace_back(request, start, end - start);
+            start = end + 1;
+        }
+        if (fields.empty() || fields.front() != current_directory())
+            return;
+        fields.erase(fields.begin());
+        if (opener(fields))
+            send_all(client, accepted, sizeof(accepted) - 1);
+    }
+
+    //! Handles the connections waiting on the listening socket.
+    void accept_requests()
+    {
+        int client;
+        while (listener != -1 && (client = accept(listener, nullptr, nullptr)) != -1) {
+            fcntl(client, F_SETFD, FD_CLOEXEC);
+            handle_request(client);
+            close(client);
+        }
+    }
+
+#endif
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Server {
+
+    bool hand_over(const int argc, char *argv[])
+    {
+#if eOPSYS == ePOSIX
+        if (!enabled())
+            return false;
+        const std::string here = current_directory();
+        const std::string name = here.empty() ? here : socket_name(here);
+        sockaddr_un address;
+        if (name.empty() || !owned_socket(name) || !make_address(name, address))
+            return false;
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            return false;
+        if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+            !trusted_peer(fd)) {
+            close(fd);
+            return false;
+        }
+        set_timeout(fd, SO_SNDTIMEO, reply_timeout);
+
+        std::string request = here;
+        request.push_back('\0');
+        for (int i = 1; i < argc; ++i) {
+            request.append(argv[i]);
+            request.push_back('\0');
+        }
+        std::string reply;
+        const bool sent = request.size() <= maximum_request &&
+                          send_all(fd, request.data(), request.size()) &&
+                          shutdown(fd, SHUT_WR) == 0 &&
+                          receive_all(fd, reply, sizeof(accepted), reply_timeout);
+        close(fd);
+        return sent && reply == accepted;
+#else
+        (void)argc;
+        (void)argv;
+        return false;
+#endif
+    }
+
+    /*!
+     * A socket left behind by an editor that crashed is replaced. If another editor is still
+     * listening on the socket, this one doesn't listen at all.
+     */
+    void listen(bool (*const open)(std::vector<std::string> &arguments))
+    {
+#if eOPSYS == ePOSIX
+        if (!enabled() || listener != -1)
+            return;
+        const std::string here = current_directory();
+        const std::string name = here.empty() ? here : socket_name(here);
+        sockaddr_un address;
+        if (name.empty() || !make_address(name, address))
+            return;
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            return;
+        sockaddr *const generic = reinterpret_cast<sockaddr *>(&address);
+        if (bind(fd, generic, sizeof(address)) != 0) {
+            const int probe = (errno == EADDRINUSE) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+            const bool live = probe != -1 && connect(probe, generic, sizeof(address)) == 0;
+            if (probe != -1)
+                close(probe);
+            if (probe == -1 || live || !owned_socket(name) || unlink(name.c_str()) != 0 ||
+                bind(fd, generic, sizeof(address)) != 0) {
+                close(fd);
+                return;
+            }
+        }
+        chmod(name.c_str(), S_IRUSR | S_IWUSR);
+        if (::listen(fd, 8) != 0) {
+            close(fd);
+            unlink(name.c_str());
+            return;
+        }
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        listener = fd;
+        listener_name = name;
+        listener_process = getpid();
+        opener = open;
+        std::atexit(remove_socket);
+        EventLoop::add_source(listener, accept_requests);
+#else
+        (void)open;
+#endif
+    }
+
+} // namespace Server
@@ -0,0 +1,48 @@
+/*! \file    SpellCache.cpp
+ *  \brief   Implementation of class SpellCache.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <iterator>
+
+#include "SpellCache.hpp"
+
+#define MAX_CACHED_LINES 8192  // More lines than this are forgotten all at once.
+#define MAX_CACHED_LENGTH 65536 // Longer lines are not checked.
+
+using Spelling::Word;
+
+/*!
+ * The lines replaced are forgotten and the lines after them are renumbered. Only lines that
+ * are kept are visited, so this costs little however large the file is.
+ */
+void SpellCache::invalidate(const EditDelta &change)
+{
+    if (lines.empty())
+        return;
+
+    auto moved = lines.erase(lines.lower_bound(change.first),
+                             lines.lower_bound(change.first + change.old_count));
+    if (change.moved() == 0)
+        return;
+    std::map<long, std::vector<Word>> after;
+    for (; moved != lines.end(); moved = lines.erase(moved))
+        after.emplace_hint(after.end(), moved->first + change.moved(),
+                           std::move(moved->second));
+    lines.insert(std::make_move_iterator(after.begin()), std::make_move_iterator(after.end()));
+}
+
+const std::vector<Word> *SpellCache::misspellings(const long line, const std::string_view text)
+{
+    if (text.size() > MAX_CACHED_LENGTH)
+        return nullptr;
+    const auto found = lines.find(line);
+    if (found != lines.end())
+        return &found->second;
+
+    if (lines.size() >= MAX_CACHED_LINES)
+        lines.clear();
+    std::vector<Word> &result = lines[line];
+    Spelling::check(text, result);
+    return &result;
+}
@@ -0,0 +1,362 @@
+/*! \file    Spelling.cpp
+ *  \brief   Implementation of the Spelling abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <sys/stat.h>
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <sys/stat.h>
+#endif
+
+#include "MappedFile.hpp"
+#include "Spelling.hpp"
+#include "support.hpp"
+
+using Spelling::Word;
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    // The table starts with a signature, the size and time of the list it was made from, the
+    // hash of the list's name, and the number of slots (a power of two). The numbers are 64
+    // bits, least significant byte first. The slots follow, 32 bits each, and hold the offset
+    // in the table of a word or zero if they are empty. A word is found in the slot its hash
+    // selects or in one of those after it. Each word is its length in a byte and then its
+    // characters in lower case.
+    const char signature[] = "YEXAWORDS1\n";
+    constexpr std::size_t signature_size = sizeof(signature) - 1;
+    constexpr std::size_t header_size = signature_size + 4 * 8;
+    constexpr std::size_t longest_word = 255;
+
+    MappedFile table;               //!< The table of the dictionary, if open.
+    const char *slots = nullptr;    //!< The first slot of the table (nullptr if not open).
+    std::uint64_t slot_mask = 0;    //!< The number of slots less one.
+
+    std::uint64_t read_number(const char *const data, const int size = 8)
+    {
+        std::uint64_t value = 0;
+        for (int i = size - 1; i >= 0; --i)
+            value = (value << 8) | static_cast<unsigned char>(data[i]);
+        return value;
+    }
+
+    void write_number(std::string &image, std::uint64_t value, const int size = 8)
+    {
+        for (int i = 0; i < size; ++i) {
+            image.push_back(static_cast<char>(value & 0xFFU));
+            value >>= 8;
+        }
+    }
+
+    bool is_letter(const char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+    }
+
+    //! Returns true if ch can be part of a word, whether or not such words are checked.
+    bool is_word_character(const char ch)
+    {
+        return is_letter(ch) || (ch >= '0' && ch <= '9') || ch == '_' ||
+               static_cast<unsigned char>(ch) >= 0x80U;
+    }
+
+    char lower(const char ch)
+    {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    }
+
+    //! Returns the size and time of the named file.
+    /*!
+     * \return false if the file does not exist.
+     */
+    bool file_status(const char *const name, std::uint64_t &size, std::time_t &time)
+    {
+#if eOPSYS == ePOSIX
+        struct stat information;
+        if (stat(name, &information) != 0)
+            return false;
+#else
+        struct _stat information;
+        if (_stat(name, &information) != 0)
+            return false;
+#endif
+        size = static_cast<std::uint64_t>(information.st_size);
+        time = information.st_mtime;
+        return true;
+    }
+
+    //! Returns the name of the list of words (empty if there is none).
+    std::string list_name()
+    {
+        const char *const named = std::getenv("YDICTIONARY");
+        if (named != nullptr && *named != '\0')
+            return named;
+#if eOPSYS == ePOSIX
+        return "/usr/share/dict/words";
+#else
+        return "";
+#endif
+    }
+
+    //! Returns the name of the table (empty if there is nowhere to keep it).
+    std::string table_name()
+    {
+        std::string result;
+#if eOPSYS == ePOSIX
+        const char *const home = std::getenv("HOME");
+        if (home == nullptr || *home == '\0')
+            return "";
+        result = home;
+        result.append("/.yexa-words.yxd");
+#elif eOPSYS == eWINDOWS
+        const char *const local = std::getenv("LOCALAPPDATA");
+        if (local == nullptr || *local == '\0')
+            return "";
+        result = local;
+        result.append("\\yexa-words.yxd");
+#endif
+        return result;
+    }
+
+    //! Returns true if the word at offset in the table is word.
+    bool word_at(const std::uint64_t offset, const std::string_view word)
+    {
+        if (offset >= table.size())
+            return false;
+        const std::size_t length = static_cast<unsigned char>(table.data()[offset]);
+        return length == word.size() && offset + 1 + length <= table.size() &&
+               std::memcmp(table.data() + offset + 1, word.data(), length) == 0;
+    }
+
+    //! Returns true if word, which is in lower case, is in the table.
+    bool contains(const std::string_view word)
+    {
+        std::uint64_t slot = fnv1a(word) & slot_mask;
+        for (std::uint64_t probe = 0; probe <= slot_mask; ++probe) {
+            const std::uint64_t offset = read_number(slots + 4 * slot, 4);
+            if (offset == 0)
+                return false;
+            if (word_at(offset, word))
+                return true;
+            slot = (slot + 1) & slot_mask;
+        }
+        return false;
+    }
+
+    //! Puts the words of the list into a table and writes it.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    bool build_table(const std::string &list, const std::string &name, const std::uint64_t size,
+                     const std::time_t time)
+    {
+        MappedFile source;
+        if (!source.open(list.c_str()) && size != 0)
+            return false;
+        const std::string_view text(source.data(), source.size());
+
+        // There are at least twice as many slots as lines, so no search goes on for long.
+        std::uint64_t lines = 1;
+        for (const char ch : text)
+            if (ch == '\n')
+                ++lines;
+        std::uint64_t slot_count = 16;
+        while (slot_count < 2 * lines)
+            slot_count *= 2;
+
+        std::vector<std::uint32_t> slot_values(slot_count, 0U);
+        const std::uint64_t words_start = header_size + 4 * slot_count;
+        std::string words;
+        std::string word;
+        for (std::size_t start = 0; start < text.size();) {
+            std::size_t end = text.find('\n', start);
+            if (end == std::string_view::npos)
+                end = text.size();
+            std::string_view line = text.substr(start, end - start);
+            start = end + 1;
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+                line.remove_suffix(1);
+            while (!line.empty() && line.front() == ' ')
+                line.remove_prefix(1);
+            if (line.empty() || line.size() > longest_word)
+                continue;
+
+            word.clear();
+            for (const char ch : line)
+                word.push_back(lower(ch));
+            std::uint64_t slot = fnv1a(word) & (slot_count - 1);
+            bool present = false;
+            for (; slot_values[slot] != 0; slot = (slot + 1) & (slot_count - 1)) {
+                const std::size_t at = slot_values[slot] - words_start;
+                if (word.size() == static_cast<unsigned char>(words[at]) &&
+                    words.compare(at + 1, word.size(), word) == 0) {
+                    present = true;
+                    break;
+                }
+            }
+            if (present)
+                continue;
+            if (words_start + words.size() > UINT32_MAX - longest_word - 1)
+                return false;
+            slot_values[slot] = static_cast<std::uint32_t>(words_start + words.size());
+            words.push_back(static_cast<char>(word.size()));
+            words.append(word);
+        }
+
+        std::string image(signature, signature_size);
+        write_number(image, size);
+        write_number(image, static_cast<std::uint64_t>(time));
+        write_number(image, fnv1a(list));
+        write_number(image, slot_count);
+        for (const std::uint32_t value : slot_values)
+            write_number(image, value, 4);
+        image.append(words);
+
+        const std::string temporary_name = name + ".tmp";
+        std::FILE *const output = std::fopen(temporary_name.c_str(), "wb");
+        if (output == nullptr)
+            return false;
+        bool written = std::fwrite(image.data(), 1, image.size(), output) == image.size();
+        if (std::fclose(output) != 0)
+            written = false;
+        if (!written || !replace_file(temporary_name.c_str(), name.c_str())) {
+            std::remove(temporary_name.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    //! Returns true if the open table was made from the list with the given size and time.
+    bool table_valid(const std::string &list, const std::uint64_t size, const std::time_t time)
+    {
+        if (table.size() < header_size ||
+            std::memcmp(table.data(), signature, signature_size) != 0 ||
+            read_number(table.data() + signature_size) != size ||
+            read_number(table.data() + signature_size + 8) !=
+                static_cast<std::uint64_t>(time) ||
+            read_number(table.data() + signature_size + 16) != fnv1a(list))
+            return false;
+        const std::uint64_t count = read_number(table.data() + signature_size + 24);
+        if (count == 0 || (count & (count - 1)) != 0 ||
+            count > (table.size() - header_size) / 4)
+            return false;
+        slots = table.data() + header_size;
+        slot_mask = count - 1;
+        return true;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Spelling {
+
+    bool open()
+    {
+        const std::string list = list_name();
+        std::uint64_t size;
+        std::time_t time;
+        if (list.empty() || !file_status(list.c_str(), size, time)) {
+            table.close();
+            slots = nullptr;
+            error_message("No dictionary (set YDICTIONARY to a list of words)");
+            return false;
+        }
+        if (slots != nullptr && table_valid(list, size, time))
+            return true;
+
+        const std::string name = table_name();
+        slots = nullptr;
+        table.close();
+        if (!name.empty() && table.open(name.c_str()) && table_valid(list, size, time))
+            return true;
+        table.close();
+        try {
+            if (name.empty() || !build_table(list, name, size, time) ||
+                !table.open(name.c_str()) || !table_valid(list, size, time)) {
+                table.close();
+                slots = nullptr;
+                error_message("Can't make the dictionary's table %s", name.c_str());
+                return false;
+            }
+        }
+        catch (std::bad_alloc &) {
+            memory_message("Can't read the dictionary");
+            return false;
+        }
+        return true;
+    }
+
+    bool is_open()
+    {
+        return slots != nullptr;
+    }
+
+    bool is_word(const std::string_view word)
+    {
+        if (slots == nullptr || word.size() > longest_word)
+            return true;
+        char buffer[longest_word];
+        for (std::size_t i = 0; i < word.size(); ++i)
+            buffer[i] = lower(word[i]);
+        const std::string_view lowered(buffer, word.size());
+        if (contains(lowered))
+            return true;
+
+        // Possessives are not always listed.
+        return lowered.size() > 2 && lowered.substr(lowered.size() - 2) == "'s" &&
+               contains(lowered.substr(0, lowered.size() - 2));
+    }
+
+    /*!
+     * A word is a run of letters, digits, underscores, and characters outside of ASCII. An
+     * apostrophe between two letters is part of the word, as in "isn't". Words of a single
+     * letter are not checked.
+     */
+    void check(const std::string_view text, std::vector<Word> &misspelled)
+    {
+        std::size_t offset = 0;
+        while (offset < text.size()) {
+            if (!is_word_character(text[offset])) {
+                ++offset;
+                continue;
+            }
+            const std::size_t start = offset;
+            bool checked = true;
+            for (; offset < text.size(); ++offset) {
+                const char ch = text[offset];
+                if (ch == '\'' && offset + 1 < text.size() && is_letter(text[offset - 1]) &&
+                    is_letter(text[offset + 1]))
+                    continue;
+                if (!is_word_character(ch))
+                    break;
+                if (!is_letter(ch))
+                    checked = false;
+            }
+            const std::size_t length = offset - start;
+            if (checked && length > 1 && !is_word(text.substr(start, length)))
+                misspelled.push_back(Word{start, length});
+        }
+    }
+
+} // namespace Spelling
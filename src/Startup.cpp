@@ -0,0 +1,93 @@
+/*! \file    Startup.cpp
+ *  \brief   Implementation of the Startup abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Startup.hpp"
+#include "Trace.hpp"
+
+#define PHASE_COUNT 16 // The most phases kept. Any more are left out of the report.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    //! One phase of startup. Times are in nanoseconds on the clock of Trace::now.
+    struct Phase {
+        const char *name;
+        long long start;
+        long long duration;
+    };
+
+    Phase phases[PHASE_COUNT];
+    int phase_count = 0;
+    long long began = 0;    // When begin was called.
+    long long latest = 0;   // When the last phase finished.
+    bool started = false;   // =true between begin and the first frame.
+    long long elapsed = 0;  // The time from begin to the first frame, once it is shown.
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Startup {
+
+    void begin()
+    {
+        began = latest = Trace::now();
+        phase_count = 0;
+        elapsed = 0;
+        started = true;
+    }
+
+    void finished(const char *const name)
+    {
+        if (!started)
+            return;
+        const long long now = Trace::now();
+        Trace::complete(name, "startup", latest, now - latest);
+        if (phase_count < PHASE_COUNT)
+            phases[phase_count++] = Phase{name, latest, now - latest};
+        latest = now;
+    }
+
+    void first_frame()
+    {
+        if (!started)
+            return;
+        finished("first frame");
+        elapsed = latest - began;
+        started = false;
+    }
+
+    long long total()
+    {
+        return elapsed;
+    }
+
+    std::vector<std::string> report()
+    {
+        std::vector<std::string> lines;
+        char line[81];
+        lines.push_back("Startup               Start ms      Time ms");
+        for (int i = 0; i < phase_count; ++i) {
+            std::snprintf(line, sizeof(line), "%-16s %12.3f %12.3f", phases[i].name,
+                          (phases[i].start - began) / 1e6, phases[i].duration / 1e6);
+            lines.push_back(line);
+        }
+        if (elapsed > 0) {
+            std::snprintf(line, sizeof(line), "%-16s %12s %12.3f", "total", "", elapsed / 1e6);
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+} // namespace Startup
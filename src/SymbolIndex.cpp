@@ -0,0 +1,874 @@
+/*! \file    SymbolIndex.cpp
+ *  \brief   Implementation of the SymbolIndex abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <screen/environ.hpp>
+
+#if eOPSYS == ePOSIX
+#include <sys/stat.h>
+#endif
+
+#if eOPSYS == eWINDOWS
+#include <sys/stat.h>
+#endif
+
+#include "DocumentSnapshot.hpp"
+#include "EditBuffer.hpp"
+#include "FileList.hpp"
+#include "MappedFile.hpp"
+#include "ProjectSearch.hpp"
+#include "SymbolIndex.hpp"
+#include "TaskPool.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
+#include "global.hpp"
+#include "support.hpp"
+
+using SymbolIndex::Symbol;
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    const char tags_name[] = "tags";
+    const char table_name[] = ".tags.yxs";
+    const char temporary_table_name[] = ".tags.yxs.tmp";
+    const char temporary_tags_name[] = "tags.tmp";
+
+    // The table starts with a signature, the size and time of the tags file it was made from,
+    // and the number of records, followed by the offsets of the records in order of their
+    // names. The numbers are 64 bits, least significant byte first. Each record holds the
+    // name, file, and pattern of a symbol, each ending with a null character, and then the
+    // kind and the line (as decimal text, empty if unknown) ending with a null character.
+    const char signature[] = "YEXASYMS1\n";
+    constexpr std::size_t signature_size = sizeof(signature) - 1;
+    constexpr std::size_t header_size = signature_size + 3 * 8;
+
+    // Definitions are looked for this many lines above the line that opens a brace.
+    constexpr long header_lines = 10;
+
+    const char *const source_extensions[] = {
+        ".c", ".h", ".cc", ".cpp", ".cxx", ".hh", ".hpp", ".hxx", ".java", ".cs", ".js"};
+
+    //! The definitions found in a file indexed again since the tags file was written.
+    struct Rescan {
+        std::vector<Symbol> symbols;
+        std::time_t time = 0;       //!< The time of the file on disk when it was indexed.
+        unsigned long version = 0;  //!< The version of the open file indexed (see EditFile).
+        bool from_buffer = false;   //!< =true if the text indexed was that of an open file.
+    };
+
+    MappedFile table;                      //!< The table of the tags file, if open.
+    std::uint64_t table_count = 0;         //!< The number of records in the table.
+    std::time_t tags_time = 0;             //!< The time of the tags file the table is from.
+    std::map<std::string, Rescan> rescans; //!< Indexed again, by name_key of the file.
+
+    std::uint64_t read_number(const char *const data)
+    {
+        std::uint64_t value = 0;
+        for (int i = 7; i >= 0; --i)
+            value = (value << 8) | static_cast<unsigned char>(data[i]);
+        return value;
+    }
+
+    void write_number(std::string &image, std::uint64_t value)
+    {
+        for (int i = 0; i < 8; ++i) {
+            image.push_back(static_cast<char>(value & 0xFFU));
+            value >>= 8;
+        }
+    }
+
+    //! Returns the size and time of the named file.
+    /*!
+     * \return false if the file does not exist.
+     */
+    bool file_status(const char *const name, std::uint64_t &size, std::time_t &time)
+    {
+#if eOPSYS == ePOSIX
+        struct stat information;
+        if (stat(name, &information) != 0)
+            return false;
+#else
+        struct _stat information;
+        if (_stat(name, &information) != 0)
+            return false;
+#endif
+        size = static_cast<std::uint64_t>(information.st_size);
+        time = information.st_mtime;
+        return true;
+    }
+
+    //! Writes image to a temporary file and then puts it in place of the named file.
+    bool write_image(const std::string &image, const char *temporary_name, const char *name)
+    {
+        std::FILE *const output = std::fopen(temporary_name, "wb");
+        if (output == nullptr)
+            return false;
+        bool written = std::fwrite(image.data(), 1, image.size(), output) == image.size();
+        if (std::fclose(output) != 0)
+            written = false;
+        if (!written || !replace_file(temporary_name, name)) {
+            std::remove(temporary_name);
+            return false;
+        }
+        return true;
+    }
+
+    bool is_identifier(const char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+               (ch >= '0' && ch <= '9') || ch == '_' || ch == '$';
+    }
+
+    bool is_space(const char ch)
+    {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\f' || ch == '\v';
+    }
+
+    std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && is_space(text.front()))
+            text.remove_prefix(1);
+        while (!text.empty() && is_space(text.back()))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    //! Returns the offset of word in text where it is not part of a longer identifier.
+    std::size_t find_word(const std::string_view text, const std::string_view word)
+    {
+        for (std::size_t at = text.find(word); at != std::string_view::npos;
+             at = text.find(word, at + 1)) {
+            const std::size_t end = at + word.size();
+            if ((at == 0 || !is_identifier(text[at - 1])) &&
+                (end == text.size() || !is_identifier(text[end])))
+                return at;
+        }
+        return std::string_view::npos;
+    }
+
+    //! Makes a ctags search pattern matching the whole of a line.
+    std::string make_pattern(const std::string_view line)
+    {
+        std::string result("/^");
+        for (const char ch : line) {
+            if (ch == '\\' || ch == '/')
+                result.push_back('\\');
+            result.push_back(ch);
+        }
+        return result += "$/";
+    }
+
+    //! A pattern taken apart into the text it matches.
+    struct Match {
+        std::string text;
+        bool at_start = false; //!< =true if the text starts a line.
+        bool at_end = false;   //!< =true if the text ends a line.
+    };
+
+    Match read_pattern(const std::string_view pattern)
+    {
+        Match result;
+        if (pattern.size() < 2)
+            return result;
+        std::string_view body = pattern.substr(1);
+        if (body.back() == pattern.front())
+            body.remove_suffix(1);
+        if (!body.empty() && body.front() == '^') {
+            result.at_start = true;
+            body.remove_prefix(1);
+        }
+        if (!body.empty() && body.back() == '$' &&
+            (body.size() < 2 || body[body.size() - 2] != '\\')) {
+            result.at_end = true;
+            body.remove_suffix(1);
+        }
+        for (std::size_t i = 0; i < body.size(); ++i) {
+            if (body[i] == '\\' && i + 1 < body.size())
+                ++i;
+            result.text.push_back(body[i]);
+        }
+        return result;
+    }
+
+    //! Returns true if the line is matched by the pattern. Trailing white space is ignored.
+    bool matches(std::string_view line, const Match &match)
+    {
+        const std::string_view text = trim(match.text);
+        line = trim(line);
+        if (match.at_start && match.at_end)
+            return line == text;
+        if (match.at_start)
+            return line.substr(0, text.size()) == text;
+        return line.find(text) != std::string_view::npos;
+    }
+
+    //! Records the definition, if any, made by the text before a brace at the outermost level.
+    /*!
+     * \param lines The lines of the file.
+     * \param line The line holding the brace.
+     * \param column The offset of the brace in the line.
+     * \return true if the brace opens a namespace or a linkage block so that the braces inside
+     * it are also at the outermost level.
+     */
+    bool define(const std::vector<std::string_view> &lines, const long line,
+                const std::size_t column, const std::string &file, std::vector<Symbol> &symbols)
+    {
+        // The text before the brace back to the end of the declaration before it.
+        long first = line;
+        while (first > 0 && line - first < header_lines) {
+            const std::string_view above = trim(lines[static_cast<std::size_t>(first - 1)]);
+            if (above.empty() || above.front() == '#' || above.front() == '*' ||
+                above.substr(0, 2) == "//" || above.substr(0, 2) == "/*")
+                break;
+            // A label, as in "public:", ends a declaration but a qualified name does not.
+            const char last = above.back();
+            const bool label =
+                last == ':' && (above.size() < 2 || above[above.size() - 2] != ':');
+            if (last == ';' || last == '}' || last == '{' || label)
+                break;
+            --first;
+        }
+        std::string header;
+        std::vector<std::size_t> starts;
+        for (long i = first; i <= line; ++i) {
+            starts.push_back(header.size());
+            std::string_view text = lines[static_cast<std::size_t>(i)];
+            if (i == line)
+                text = text.substr(0, column);
+            header.append(text);
+            header.push_back(' ');
+        }
+
+        if (find_word(header, "namespace") != std::string::npos ||
+            header.find("extern \"C") != std::string::npos)
+            return true;
+
+        std::size_t name_start = 0;
+        std::size_t name_end = 0;
+        char kind = 0;
+        const std::size_t open = header.find('(');
+        const std::size_t equals = header.find('=');
+        if (open != std::string::npos && (equals == std::string::npos || open < equals)) {
+            static const std::string_view keywords[] = {
+                "catch", "do", "else", "for", "if", "return", "sizeof", "switch", "while"};
+            name_end = open;
+            while (name_end > 0 && is_space(header[name_end - 1]))
+                --name_end;
+            name_start = name_end;
+            while (name_start > 0 && is_identifier(header[name_start - 1]))
+                --name_start;
+            const std::string_view name(header.data() + name_start, name_end - name_start);
+            if (name.empty() || (name.front() >= '0' && name.front() <= '9') ||
+                std::find(std::begin(keywords), std::end(keywords), name) != std::end(keywords))
+                return false;
+            kind = 'f';
+        }
+        else if (equals == std::string::npos) {
+            // The first type keyword outside of template parameters, as in "template<class T>".
+            static const struct {
+                std::string_view word;
+                char kind;
+            } types[] = {{"class", 'c'}, {"struct", 's'}, {"union", 'u'}, {"enum", 'g'}};
+            int angles = 0;
+            for (std::size_t i = 0; i < header.size() && kind == 0; ++i) {
+                if (header[i] == '<')
+                    ++angles;
+                else if (header[i] == '>' && angles > 0)
+                    --angles;
+                if (angles != 0 || !is_identifier(header[i]) ||
+                    (i > 0 && is_identifier(header[i - 1])))
+                    continue;
+                for (const auto &type : types) {
+                    if (header.compare(i, type.word.size(), type.word) != 0 ||
+                        (i + type.word.size() < header.size() &&
+                         is_identifier(header[i + type.word.size()])))
+                        continue;
+                    // The last component of a qualified name, as in "struct Outer::Inner".
+                    std::size_t at = i + type.word.size();
+                    while (true) {
+                        while (at < header.size() && is_space(header[at]))
+                            ++at;
+                        if (header.compare(at, 5, "class") == 0 ||
+                            header.compare(at, 6, "struct") == 0) {
+                            at += (header[at] == 'c') ? 5 : 6;
+                            continue;
+                        }
+                        name_start = at;
+                        while (at < header.size() && is_identifier(header[at]))
+                            ++at;
+                        name_end = at;
+                        if (header.compare(at, 2, "::") != 0)
+                            break;
+                        at += 2;
+                    }
+                    if (name_end > name_start)
+                        kind = type.kind;
+                    break;
+                }
+            }
+            if (kind == 0)
+                return false;
+        }
+        else {
+            return false;
+        }
+
+        const auto piece = std::upper_bound(starts.begin(), starts.end(), name_start);
+        const long name_line = first + static_cast<long>(piece - starts.begin()) - 1;
+        symbols.push_back({header.substr(name_start, name_end - name_start), file, name_line,
+                           make_pattern(lines[static_cast<std::size_t>(name_line)]), kind});
+        return false;
+    }
+
+    //! Splits a line of a tags file into a symbol.
+    /*!
+     * \return false if the line is not a tag.
+     */
+    bool split_tag(std::string_view line, Symbol &symbol)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty() || line.substr(0, 2) == "!_")
+            return false;
+        const std::size_t name_end = line.find('\t');
+        if (name_end == std::string_view::npos || name_end == 0)
+            return false;
+        const std::size_t file_end = line.find('\t', name_end + 1);
+        if (file_end == std::string_view::npos)
+            return false;
+        symbol.name.assign(line.substr(0, name_end));
+        symbol.file.assign(line.substr(name_end + 1, file_end - name_end - 1));
+        symbol.line = -1;
+        symbol.pattern.clear();
+        symbol.kind = ' ';
+
+        // The address is a search pattern or a line number.
+        std::string_view rest = line.substr(file_end + 1);
+        std::size_t end = 0;
+        if (!rest.empty() && (rest.front() == '/' || rest.front() == '?')) {
+            for (end = 1; end < rest.size() && rest[end] != rest.front(); ++end) {
+                if (rest[end] == '\\')
+                    ++end;
+            }
+            end = std::min(end + 1, rest.size());
+            symbol.pattern.assign(rest.substr(0, end));
+        }
+        else {
+            long number = 0;
+            for (; end < rest.size() && rest[end] >= '0' && rest[end] <= '9'; ++end)
+                number = number * 10 + (rest[end] - '0');
+            if (end == 0)
+                return false;
+            symbol.line = number - 1;
+        }
+
+        // Extended fields, as in ';"<tab>f<tab>line:42'.
+        rest.remove_prefix(end);
+        if (rest.substr(0, 2) != ";\"")
+            return true;
+        rest.remove_prefix(2);
+        while (!rest.empty()) {
+            if (rest.front() == '\t')
+                rest.remove_prefix(1);
+            std::size_t field_end = rest.find('\t');
+            if (field_end == std::string_view::npos)
+                field_end = rest.size();
+            const std::string_view field = rest.substr(0, field_end);
+            if (field.size() == 1)
+                symbol.kind = field.front();
+            else if (field.substr(0, 5) == "kind:" && field.size() > 5)
+                symbol.kind = field[5];
+            else if (field.substr(0, 5) == "line:" && symbol.line < 0) {
+                long number = 0;
+                for (std::size_t i = 5; i < field.size() && field[i] >= '0' && field[i] <= '9';
+                     ++i)
+                    number = number * 10 + (field[i] - '0');
+                symbol.line = number - 1;
+            }
+            rest.remove_prefix(field_end);
+        }
+        return true;
+    }
+
+    //! Returns the name of the record at offset in the table.
+    std::string_view record_name(const std::uint64_t offset)
+    {
+        return std::string_view(table.data() + offset);
+    }
+
+    Symbol read_record(std::uint64_t offset)
+    {
+        Symbol result;
+        const char *field = table.data() + offset;
+        result.name = field;
+        field += result.name.size() + 1;
+        result.file = field;
+        field += result.file.size() + 1;
+        result.pattern = field;
+        field += result.pattern.size() + 1;
+        result.kind = *field++;
+        result.line = (*field == '\0') ? -1 : std::atol(field);
+        return result;
+    }
+
+    //! Sorts the tags file into a table and writes it.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    bool build_table(const std::uint64_t size, const std::time_t time)
+    {
+        MappedFile tags;
+        if (!tags.open(tags_name))
+            return false;
+        const std::string_view text(tags.data(), tags.size());
+
+        std::vector<Symbol> symbols;
+        Symbol symbol;
+        for (std::size_t start = 0; start < text.size();) {
+            std::size_t end = text.find('\n', start);
+            if (end == std::string_view::npos)
+                end = text.size();
+            if (split_tag(text.substr(start, end - start), symbol))
+                symbols.push_back(symbol);
+            start = end + 1;
+        }
+        // Tags files are usually sorted already, but not always with the same collation.
+        const auto by_name = [](const Symbol &left, const Symbol &right) {
+            return left.name < right.name;
+        };
+        if (!std::is_sorted(symbols.begin(), symbols.end(), by_name))
+            std::stable_sort(symbols.begin(), symbols.end(), by_name);
+
+        std::string image(signature, signature_size);
+        write_number(image, size);
+        write_number(image, static_cast<std::uint64_t>(time));
+        write_number(image, symbols.size());
+        const std::size_t records_start = image.size() + 8 * symbols.size();
+        std::string records;
+        for (const Symbol &entry : symbols) {
+            write_number(image, records_start + records.size());
+            records.append(entry.name).push_back('\0');
+            records.append(entry.file).push_back('\0');
+            records.append(entry.pattern).push_back('\0');
+            records.push_back(entry.kind);
+            if (entry.line >= 0)
+                records.append(std::to_string(entry.line));
+            records.push_back('\0');
+        }
+        image.append(records);
+        return write_image(image, temporary_table_name, table_name);
+    }
+
+    bool table_valid(const std::uint64_t size, const std::time_t time)
+    {
+        if (table.size() < header_size ||
+            std::memcmp(table.data(), signature, signature_size) != 0 ||
+            read_number(table.data() + signature_size) != size ||
+            read_number(table.data() + signature_size + 8) != static_cast<std::uint64_t>(time))
+            return false;
+        const std::uint64_t count = read_number(table.data() + signature_size + 16);
+        if (count > (table.size() - header_size) / 8)
+            return false;
+        table_count = count;
+        return true;
+    }
+
+    //! Makes sure the table reflects the tags file, building it again if necessary.
+    /*!
+     * \return false if there is no tags file. An error message has been displayed.
+     */
+    bool open_table()
+    {
+        std::uint64_t size;
+        std::time_t time;
+        if (!file_status(tags_name, size, time)) {
+            table.close();
+            error_message("No tags file (use index_symbols to make one)");
+            return false;
+        }
+        if (table.data() != nullptr && table_valid(size, time))
+            return true;
+
+        table.close();
+        if (table.open(table_name) && table_valid(size, time)) {
+            tags_time = time;
+            return true;
+        }
+        table.close();
+        try {
+            if (!build_table(size, time) || !table.open(table_name) ||
+                !table_valid(size, time)) {
+                table.close();
+                error_message("Can't make the symbol table %s", table_name);
+                return false;
+            }
+        }
+        catch (std::bad_alloc &) {
+            memory_message("Can't read the tags file");
+            return false;
+        }
+        if (tags_time != time)
+            rescans.clear();
+        tags_time = time;
+        return true;
+    }
+
+    //! Returns the offset of the first record in the table with the name, or the end.
+    std::uint64_t lower_bound(const std::string_view name)
+    {
+        std::uint64_t low = 0;
+        std::uint64_t high = table_count;
+        while (low < high) {
+            const std::uint64_t middle = low + (high - low) / 2;
+            const std::uint64_t offset = read_number(table.data() + header_size + 8 * middle);
+            if (record_name(offset) < name)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low;
+    }
+
+    //! Indexes the text of a file again.
+    void rescan(const std::string &key, const std::string &file, const std::string_view text,
+                const std::time_t time, const unsigned long version, const bool from_buffer)
+    {
+        Rescan &entry = rescans[key];
+        entry.symbols.clear();
+        SymbolIndex::scan(text, file, entry.symbols);
+        entry.time = time;
+        entry.version = version;
+        entry.from_buffer = from_buffer;
+    }
+
+    //! Indexes the open files that have been modified, or changed on disk, again.
+    void refresh_open_files()
+    {
+        for (unsigned i = 0; i < FileList::count(); ++i) {
+            YEditFile *const the_file = FileList::file(i);
+            const std::string key = name_key(the_file->name());
+            const auto existing = rescans.find(key);
+            const bool wanted = the_file->changed() || the_file->time() > tags_time;
+            if (!wanted) {
+                // Changes that were abandoned leave the file as the tags file describes it.
+                if (existing != rescans.end() && existing->second.from_buffer)
+                    rescans.erase(existing);
+                continue;
+            }
+            if (existing != rescans.end() && existing->second.from_buffer &&
+                existing->second.version == the_file->version())
+                continue;
+
+            const std::shared_ptr<const DocumentSnapshot> lines = the_file->snapshot();
+            std::string text;
+            for (long line = 0; line < lines->size(); ++line)
+                text.append(lines->line(line)).push_back('\n');
+            rescan(key, the_file->name(), text, the_file->time(), the_file->version(), true);
+        }
+    }
+
+    //! Indexes a file named by the table again if it changed on disk after the tags file.
+    void refresh_disk_file(const std::string &file)
+    {
+        const std::string key = name_key(file.c_str());
+        std::uint64_t size;
+        std::time_t time;
+        if (!file_status(file.c_str(), size, time) || time <= tags_time)
+            return;
+        const auto existing = rescans.find(key);
+        if (existing != rescans.end() && (existing->second.from_buffer ||
+                                          existing->second.time == time))
+            return;
+        MappedFile source;
+        if (source.open(file.c_str()))
+            rescan(key, file, std::string_view(source.data(), source.size()), time, 0, false);
+    }
+
+    bool has_source_extension(const std::string &name)
+    {
+        const std::size_t dot = name.rfind('.');
+        if (dot == std::string::npos)
+            return false;
+        const std::string extension = name.substr(dot);
+        for (const char *const candidate : source_extensions) {
+            if (extension == candidate)
+                return true;
+        }
+        return false;
+    }
+
+    //! Writes the lines of a tags file for the symbols.
+    std::string format_tags(const std::vector<Symbol> &symbols)
+    {
+        std::string result(
+            "!_TAG_FILE_FORMAT\t2\t/extended format/\n"
+            "!_TAG_FILE_SORTED\t1\t/0=unsorted, 1=sorted, 2=foldcase/\n"
+            "!_TAG_PROGRAM_NAME\tyexa\t//\n");
+        for (const Symbol &symbol : symbols) {
+            result.append(symbol.name).push_back('\t');
+            result.append(symbol.file).push_back('\t');
+            result.append(symbol.pattern).append(";\"\t").push_back(symbol.kind);
+            result.append("\tline:").append(std::to_string(symbol.line + 1)).push_back('\n');
+        }
+        return result;
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace SymbolIndex {
+
+    void scan(const std::string_view text, const std::string &file,
+              std::vector<Symbol> &symbols)
+    {
+        std::vector<std::string_view> lines;
+        for (std::size_t start = 0; start < text.size();) {
+            std::size_t end = text.find('\n', start);
+            if (end == std::string_view::npos)
+                end = text.size();
+            std::string_view line = text.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            lines.push_back(line);
+            start = end + 1;
+        }
+
+        std::vector<bool> counted; // For each open brace, =true if it is counted.
+        long depth = 0;            // The number of counted braces open.
+        bool in_comment = false;
+        for (std::size_t i = 0; i < lines.size(); ++i) {
+            const std::string_view line = lines[i];
+            if (!in_comment && trim(line).substr(0, 1) == "#")
+                continue;
+            char quote = 0;
+            for (std::size_t j = 0; j < line.size(); ++j) {
+                const char ch = line[j];
+                const char next = (j + 1 < line.size()) ? line[j + 1] : '\0';
+                if (in_comment) {
+                    if (ch == '*' && next == '/') {
+                        in_comment = false;
+                        ++j;
+                    }
+                }
+                else if (quote != 0) {
+                    if (ch == '\\')
+                        ++j;
+                    else if (ch == quote)
+                        quote = 0;
+                }
+                else if (ch == '/' && next == '/') {
+                    break;
+                }
+                else if (ch == '/' && next == '*') {
+                    in_comment = true;
+                    ++j;
+                }
+                else if (ch == '"' || ch == '\'') {
+                    quote = ch;
+                }
+                else if (ch == '{') {
+                    const bool counts =
+                        depth != 0 || !define(lines, static_cast<long>(i), j, file, symbols);
+                    counted.push_back(counts);
+                    if (counts)
+                        ++depth;
+                }
+                else if (ch == '}' && !counted.empty()) {
+                    if (counted.back())
+                        --depth;
+                    counted.pop_back();
+                }
+            }
+        }
+    }
+
+    bool generate()
+    {
+        std::vector<std::string> sources;
+        std::vector<std::vector<Symbol>> found;
+        std::vector<Symbol> symbols;
+        std::string image;
+        try {
+            std::vector<std::string> pending{"."};
+            std::vector<std::string> directories;
+            std::vector<std::string> files;
+            while (!pending.empty()) {
+                const std::string directory = std::move(pending.back());
+                pending.pop_back();
+                directories.clear();
+                files.clear();
+                ProjectSearch::list_directory(directory, directories, files);
+                for (std::string &name : files) {
+                    if (has_source_extension(name))
+                        sources.push_back(std::move(name));
+                }
+                pending.insert(pending.end(), directories.begin(), directories.end());
+            }
+            std::sort(sources.begin(), sources.end());
+
+            // Each worker takes the next file not yet taken.
+            found.resize(sources.size());
+            std::atomic<std::size_t> next(0);
+            std::atomic<bool> failed(false);
+            const auto work = [&]() {
+                std::size_t index;
+                while ((index = next++) < sources.size()) {
+                    MappedFile source;
+                    if (!source.open(sources[index].c_str()))
+                        continue;
+                    try {
+                        scan(std::string_view(source.data(), source.size()), sources[index],
+                             found[index]);
+                    }
+                    catch (std::bad_alloc &) {
+                        failed = true;
+                    }
+                }
+            };
+            {
+                TaskPool::Group workers;
+                for (unsigned i = 0; i < TaskPool::size(); ++i)
+                    workers.run(work);
+                workers.wait();
+            }
+            if (failed)
+                throw std::bad_alloc();
+
+            for (std::vector<Symbol> &file_symbols : found)
+                symbols.insert(symbols.end(), std::make_move_iterator(file_symbols.begin()),
+                               std::make_move_iterator(file_symbols.end()));
+            std::stable_sort(symbols.begin(), symbols.end(),
+                             [](const Symbol &left, const Symbol &right) {
+                                 return left.name < right.name;
+                             });
+            image = format_tags(symbols);
+        }
+        catch (std::bad_alloc &) {
+            memory_message("Can't index the symbols");
+            return false;
+        }
+
+        if (!write_image(image, temporary_tags_name, tags_name)) {
+            error_message("Can't write the tags file");
+            return false;
+        }
+        table.close();
+        rescans.clear();
+        if (!open_table())
+            return false;
+        info_message("Indexed %lu symbols in %lu files",
+                     static_cast<unsigned long>(symbols.size()),
+                     static_cast<unsigned long>(sources.size()));
+        return true;
+    }
+
+    bool find(const std::string &name, std::vector<Symbol> &found)
+    {
+        found.clear();
+        if (!open_table())
+            return false;
+        try {
+            refresh_open_files();
+
+            // The definitions in the table, except those in files indexed again.
+            std::map<std::string, bool> superseded;
+            for (std::uint64_t i = lower_bound(name); i < table_count; ++i) {
+                const std::uint64_t offset = read_number(table.data() + header_size + 8 * i);
+                if (record_name(offset) != name)
+                    break;
+                Symbol symbol = read_record(offset);
+                auto known = superseded.find(symbol.file);
+                if (known == superseded.end()) {
+                    refresh_disk_file(symbol.file);
+                    const bool indexed = rescans.count(name_key(symbol.file.c_str())) != 0;
+                    known = superseded.emplace(symbol.file, indexed).first;
+                }
+                if (!known->second)
+                    found.push_back(std::move(symbol));
+            }
+            for (const auto &entry : rescans) {
+                for (const Symbol &symbol : entry.second.symbols) {
+                    if (symbol.name == name)
+                        found.push_back(symbol);
+                }
+            }
+        }
+        catch (std::bad_alloc &) {
+            memory_message("Can't look up the symbol");
+            return false;
+        }
+        return true;
+    }
+
+    bool jump(const Symbol &symbol)
+    {
+        if (!FileList::lookup(symbol.file.c_str())) {
+            std::FILE *const source = std::fopen(symbol.file.c_str(), "r");
+            if (source == nullptr) {
+                error_message("Can't find %.100s", symbol.file.c_str());
+                return false;
+            }
+            std::fclose(source);
+            if (restricted_mode) {
+                error_message("Can't load additional files in restricted mode");
+                return false;
+            }
+            if (!FileList::new_file(symbol.file.c_str()))
+                return false;
+        }
+
+        // The line given may be out of date. The definition is searched for if so.
+        YEditFile &the_file = FileList::active_file();
+        long line = symbol.line;
+        if (!symbol.pattern.empty()) {
+            const Match match = read_pattern(symbol.pattern);
+            const EditBuffer *text = (line >= 0) ? the_file.line_at(line) : nullptr;
+            if (text == nullptr || !matches(text->view(), match)) {
+                long candidate = 0;
+                while ((text = the_file.line_at(candidate)) != nullptr &&
+                       !matches(text->view(), match))
+                    ++candidate;
+                if (text != nullptr)
+                    line = candidate;
+            }
+        }
+        if (line < 0 || the_file.line_at(line) == nullptr) {
+            WindowList::display();
+            error_message("Can't find the definition of %.100s", symbol.name.c_str());
+            return false;
+        }
+
+        const EditBuffer *const text = the_file.line_at(line);
+        const std::size_t offset = find_word(text->view(), symbol.name);
+        the_file.CP().jump_to_line(line);
+        the_file.CP().jump_to_column(
+            (offset == std::string_view::npos)
+                ? 0
+                : static_cast<unsigned>(text->column_of(offset, the_file.tab_distance())));
+        return true;
+    }
+
+} // namespace SymbolIndex
@@ -0,0 +1,289 @@
+/*! \file    TaskPool.cpp
+ *  \brief   Implementation of the TaskPool abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "TaskPool.hpp"
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    using TaskPool::Priority;
+    using TaskPool::Task;
+
+    //! Tasks waiting for a worker, one deque for each priority.
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks[TaskPool::PRIORITIES];
+    };
+
+    //! The worker threads and their queues.
+    class Pool {
+      public:
+        Pool();
+
+        void submit(Task task, Priority priority);
+        unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+      private:
+        // Queue i belongs to worker i. The last is shared by the other threads.
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex sleep_lock;          //!< Held while a worker decides whether to sleep.
+        std::condition_variable wake;   //!< Signaled when a task is submitted.
+        std::atomic<long> queued{0};    //!< The number of tasks in all the queues.
+
+        void work(std::size_t self);
+        bool take(std::size_t self, Task &task);
+    };
+
+    // The index of the worker running on this thread (none on other threads).
+    constexpr std::size_t no_worker = static_cast<std::size_t>(-1);
+    thread_local std::size_t current_worker = no_worker;
+
+    //! Returns the pool. It is never destroyed so workers are never stopped during exit.
+    Pool &pool()
+    {
+        static Pool *const the_pool = new Pool;
+        return *the_pool;
+    }
+
+    Pool::Pool()
+    {
+        const unsigned count = std::max(1U, std::thread::hardware_concurrency());
+        for (unsigned i = 0; i <= count; ++i)
+            queues.emplace_back(new Queue);
+        try {
+            for (unsigned i = 0; i < count; ++i)
+                workers.emplace_back(&Pool::work, this, static_cast<std::size_t>(i));
+        }
+        catch (const std::system_error &) {
+            // Fewer workers will have to do. The queues of those missing stay empty.
+            if (workers.empty())
+                throw;
+        }
+    }
+
+    void Pool::submit(Task task, const Priority priority)
+    {
+        Queue &queue = (current_worker != no_worker) ? *queues[current_worker] : *queues.back();
+        {
+            std::lock_guard<std::mutex> guard(queue.lock);
+            queue.tasks[priority].push_back(std::move(task));
+        }
+        ++queued;
+
+        // A worker deciding to sleep holds the lock, so it either sees the task or is woken.
+        { std::lock_guard<std::mutex> guard(sleep_lock); }
+        wake.notify_one();
+    }
+
+    //! Finds the most urgent task: the worker's latest, the oldest shared, or another's oldest.
+    bool Pool::take(const std::size_t self, Task &task)
+    {
+        const std::size_t shared = queues.size() - 1;
+        for (int priority = 0; priority < TaskPool::PRIORITIES; ++priority) {
+            {
+                Queue &own = *queues[self];
+                std::lock_guard<std::mutex> guard(own.lock);
+                std::deque<Task> &tasks = own.tasks[priority];
+                if (!tasks.empty()) {
+                    task = std::move(tasks.back());
+                    tasks.pop_back();
+                    --queued;
+                    return true;
+                }
+            }
+            for (std::size_t i = 0; i < shared; ++i) {
+                const std::size_t victim = (i == 0) ? shared : (self + i) % shared;
+                Queue &other = *queues[victim];
+                std::lock_guard<std::mutex> guard(other.lock);
+                std::deque<Task> &tasks = other.tasks[priority];
+                if (!tasks.empty()) {
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                    --queued;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void Pool::work(const std::size_t self)
+    {
+        current_worker = self;
+        Task task;
+        for (;;) {
+            if (take(self, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleep_lock);
+            wake.wait(guard, [this] { return queued > 0; });
+        }
+    }
+
+} // namespace
+
+/*===================================*/
+/*           Member Types            */
+/*===================================*/
+
+//! What the tasks queued on the workers for a group need, which may outlive the group.
+struct TaskPool::Group::State {
+    explicit State(const Priority priority, CancelToken token)
+        : priority(priority), token(std::move(token))
+    {
+    }
+
+    const Priority priority;
+    const CancelToken token;
+    std::mutex lock;                   //!< Protects the members below.
+    std::condition_variable changed;   //!< Signaled when a task is added or the last finishes.
+    std::deque<Task> waiting;          //!< The tasks not yet started, oldest first.
+    unsigned outstanding = 0;          //!< The tasks not yet finished.
+
+    bool run_one();
+};
+
+//! Runs the oldest task not yet started, unless the group has been cancelled.
+/*!
+ * \return false if every task had been started.
+ */
+bool TaskPool::Group::State::run_one()
+{
+    Task task;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (waiting.empty())
+            return false;
+        task = std::move(waiting.front());
+        waiting.pop_front();
+    }
+
+    // The task is counted as finished even if it throws (only possible on a waiting thread).
+    struct Finish {
+        State &state;
+        ~Finish()
+        {
+            std::lock_guard<std::mutex> guard(state.lock);
+            if (--state.outstanding == 0)
+                state.changed.notify_all();
+        }
+    } finish{*this};
+    if (!token.cancelled())
+        task();
+    return true;
+}
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace TaskPool {
+
+    unsigned size()
+    {
+        return pool().size();
+    }
+
+    void submit(Task task, const Priority priority)
+    {
+        pool().submit(std::move(task), priority);
+    }
+
+    void submit(Task work, EventLoop::Callback finished, CancelToken token,
+                const Priority priority)
+    {
+        pool().submit(
+            [work = std::move(work), finished = std::move(finished), token]() mutable {
+                if (token.cancelled())
+                    return;
+                work();
+                work = nullptr;
+                EventLoop::post([finished = std::move(finished), token]() {
+                    if (!token.cancelled())
+                        finished();
+                });
+            },
+            priority);
+    }
+
+    Group::Group(const Priority priority)
+        : state(std::make_shared<State>(priority, cancel_token))
+    {
+    }
+
+    //! Adds a task to the group. May be called by the group's tasks.
+    /*!
+     * \throws std::bad_alloc if insufficient memory.
+     */
+    void Group::run(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> guard(state->lock);
+            state->waiting.push_back(std::move(task));
+            ++state->outstanding;
+        }
+        state->changed.notify_all();
+
+        // Whichever thread gets to the task first runs it; the other finds nothing to do.
+        const std::shared_ptr<State> shared(state);
+        try {
+            pool().submit([shared]() { shared->run_one(); }, state->priority);
+        }
+        catch (const std::system_error &) {
+            // There are no workers. The task is run by wait().
+        }
+    }
+
+    //! Cancels the token and drops the tasks not yet started. Running tasks are not stopped.
+    void Group::cancel()
+    {
+        cancel_token.cancel();
+    }
+
+    //! Returns true if some of the group's tasks have not finished.
+    bool Group::busy() const
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        return state->outstanding != 0;
+    }
+
+    //! Runs the tasks not yet started and waits for the others to finish.
+    /*!
+     * An exception thrown by a task run here is passed on. The remaining tasks are still run
+     * when the group is destroyed.
+     */
+    void Group::wait()
+    {
+        for (;;) {
+            while (state->run_one()) {
+            }
+            std::unique_lock<std::mutex> guard(state->lock);
+            state->changed.wait(guard, [this] {
+                return state->outstanding == 0 || !state->waiting.empty();
+            });
+            if (state->outstanding == 0)
+                return;
+            // A running task added more.
+        }
+    }
+
+} // namespace TaskPool
@@ -0,0 +1,222 @@
+/*! \file    Trace.cpp
+ *  \brief   Implementation of the Trace abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include "Trace.hpp"
+
+#define RING_SIZE 16384 // Events kept for each thread.
+
+/*==================================*/
+/*           Private Data           */
+/*==================================*/
+
+namespace {
+
+    // The durations given to events that are not complete events.
+    const long long instant_event = -1;
+    const long long counter_event = -2;
+
+    //! One event. Instants and counters have a negative duration (see above).
+    struct Event {
+        long long start;
+        long long duration;
+        const char *name;
+        const char *category;
+        long value;
+    };
+
+    //! The events recorded by one thread. Only that thread changes them while tracing is on.
+    struct Ring {
+        Event events[RING_SIZE];
+        std::atomic<unsigned long> head{0}; //!< The number of events ever recorded.
+        bool in_use = false;                //!< True while a thread owns the ring.
+        const char *label = "worker";       //!< The name shown for the thread.
+    };
+
+    //! Gives the ring owned by a thread back when the thread ends.
+    struct Owner {
+        Ring *ring = nullptr;
+        ~Owner();
+    };
+
+    std::atomic<bool> enabled{false};
+    std::atomic<long long> epoch{0}; // The time at which tracing started.
+
+    // The registry is never destroyed so that threads ending during exit can still use it.
+    std::mutex registry_lock;
+    std::vector<std::unique_ptr<Ring>> &registry = *new std::vector<std::unique_ptr<Ring>>;
+
+    thread_local Owner owner;
+
+    Owner::~Owner()
+    {
+        if (ring != nullptr) {
+            std::lock_guard<std::mutex> guard(registry_lock);
+            ring->in_use = false;
+            ring->label = "worker";
+        }
+    }
+
+    //! Returns the ring of the calling thread, or nullptr if there is no memory for one.
+    Ring *my_ring()
+    {
+        if (owner.ring != nullptr)
+            return owner.ring;
+
+        std::lock_guard<std::mutex> guard(registry_lock);
+        for (const std::unique_ptr<Ring> &ring : registry) {
+            if (!ring->in_use) {
+                owner.ring = ring.get();
+                break;
+            }
+        }
+        if (owner.ring == nullptr) {
+            try {
+                registry.push_back(std::make_unique<Ring>());
+                owner.ring = registry.back().get();
+            }
+            catch (std::bad_alloc &) {
+                return nullptr;
+            }
+        }
+        owner.ring->in_use = true;
+        return owner.ring;
+    }
+
+    //! Adds an event to the ring of the calling thread.
+    void record(const Event &event)
+    {
+        Ring *const ring = my_ring();
+        if (ring == nullptr)
+            return;
+        const unsigned long slot = ring->head.load(std::memory_order_relaxed);
+        ring->events[slot % RING_SIZE] = event;
+        ring->head.store(slot + 1, std::memory_order_release);
+    }
+
+    //! Writes a time in nanoseconds as microseconds, which is what the format expects.
+    void write_microseconds(std::FILE *const file, const long long nanoseconds)
+    {
+        std::fprintf(file, "%lld.%03lld", nanoseconds / 1000, nanoseconds % 1000);
+    }
+
+} // namespace
+
+/*======================================*/
+/*           Public Functions           */
+/*======================================*/
+
+namespace Trace {
+
+    void start()
+    {
+        enabled = false;
+        {
+            std::lock_guard<std::mutex> guard(registry_lock);
+            for (const std::unique_ptr<Ring> &ring : registry)
+                ring->head = 0;
+        }
+        if (Ring *const ring = my_ring())
+            ring->label = "main";
+        epoch = now();
+        enabled = true;
+    }
+
+    bool active()
+    {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    long long now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void complete(const char *const name, const char *const category, const long long start,
+                  const long long duration)
+    {
+        if (active() && start >= epoch)
+            record(Event{start, duration, name, category, 0});
+    }
+
+    void instant(const char *const name, const char *const category, const long value)
+    {
+        if (active())
+            record(Event{now(), instant_event, name, category, value});
+    }
+
+    void counter(const char *const name, const char *const category, const long value)
+    {
+        if (active())
+            record(Event{now(), counter_event, name, category, value});
+    }
+
+    /*!
+     * Events being recorded by other threads as tracing stops may be left incomplete. Each
+     * thread appears under the ring it recorded into, so threads that ran one after another
+     * may share a line in the viewer.
+     *
+     * \param file_name The name of the file to write, replacing any file of that name.
+     * \return The number of events written, or -1 if the file could not be written.
+     */
+    long stop(const char *const file_name)
+    {
+        enabled = false;
+        std::FILE *const file = std::fopen(file_name, "w");
+        if (file == nullptr)
+            return -1;
+
+        std::lock_guard<std::mutex> guard(registry_lock);
+        long count = 0;
+        bool first = true;
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+        for (std::size_t thread = 0; thread < registry.size(); ++thread) {
+            const Ring &ring = *registry[thread];
+            const unsigned long head = ring.head.load(std::memory_order_acquire);
+            if (head == 0)
+                continue;
+            std::fprintf(file,
+                         "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+                         "\"args\":{\"name\":\"%s %zu\"}}",
+                         first ? "" : ",\n", thread + 1, ring.label, thread + 1);
+            first = false;
+
+            for (unsigned long i = (head > RING_SIZE) ? head - RING_SIZE : 0; i < head; ++i) {
+                const Event &event = ring.events[i % RING_SIZE];
+                const char *const phase = (event.duration == instant_event)   ? "i"
+                                          : (event.duration == counter_event) ? "C"
+                                                                              : "X";
+                std::fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":",
+                             event.name, event.category, phase);
+                write_microseconds(file, event.start - epoch);
+                if (event.duration == instant_event)
+                    std::fprintf(file, ",\"s\":\"t\",\"args\":{\"value\":%ld}", event.value);
+                else if (event.duration == counter_event)
+                    std::fprintf(file, ",\"args\":{\"bytes\":%ld}", event.value);
+                else {
+                    std::fputs(",\"dur\":", file);
+                    write_microseconds(file, event.duration);
+                }
+                std::fprintf(file, ",\"pid\":1,\"tid\":%zu}", thread + 1);
+                ++count;
+            }
+        }
+        std::fputs("\n]}\n", file);
+        const bool failed = std::ferror(file) != 0;
+        if (std::fclose(file) != 0 || failed)
+            return -1;
+        return count;
+    }
+
+} // namespace Trace
@@ -0,0 +1,44 @@
+/*! \file    UndoEditFile.cpp
+ *  \brief   Implementation of class UndoEditFile.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include "UndoEditFile.hpp"
+
+bool UndoEditFile::undo()
+{
+    long first_line;
+    long tail;
+    long cursor_line;
+    unsigned cursor_column;
+
+    if (!marks.empty())
+        move_marks();
+    if (!undo_log.undo(file_data, first_line, tail, cursor_line, cursor_column))
+        return false;
+    is_changed = true;
+    mark_damaged_from(first_line);
+    mark_modified(first_line, tail);
+    current_point.jump_to_line(cursor_line);
+    current_point.jump_to_column(cursor_column);
+    return true;
+}
+
+bool UndoEditFile::redo()
+{
+    long first_line;
+    long tail;
+    long cursor_line;
+    unsigned cursor_column;
+
+    if (!marks.empty())
+        move_marks();
+    if (!undo_log.redo(file_data, first_line, tail, cursor_line, cursor_column, tab_stop))
+        return false;
+    is_changed = true;
+    mark_damaged_from(first_line);
+    mark_modified(first_line, tail);
+    current_point.jump_to_line(cursor_line);
+    current_point.jump_to_column(cursor_column);
+    return true;
+}
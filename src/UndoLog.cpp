@@ -0,0 +1,654 @@
+/*! \file    UndoLog.cpp
+ *  \brief   Implementation of class UndoLog
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "EditBuffer.hpp"
+#include "UndoLog.hpp"
+#include "support.hpp"
+
+/*
+ * A history image starts with a signature. Each record after it is an operation or a check,
+ * followed by its length in four bytes (low byte first) so that the records can be read from
+ * the end. Numbers in a record take seven bits per byte, low bits first; text is its length
+ * and its bytes. A record starts with its kind and, for an operation, whether it is the first
+ * of its group. A check holds the hash of the file's lines at the point in the history where
+ * it lies.
+ *
+ *     TEXT:  kind, first, line, cursor line, cursor column, column, old length, removed,
+ *            inserted
+ *     LINES: kind, first, line, cursor line, cursor column, old count, new count, each line
+ *     CHECK: kind, hash
+ */
+
+namespace {
+    // The memory used by each saved line in addition to its text.
+    constexpr std::size_t line_overhead = sizeof(EditBuffer) + sizeof(EditBuffer *);
+
+    constexpr char signature[] = "YEXAUNDO1\n";
+    constexpr std::size_t signature_size = sizeof(signature) - 1;
+    constexpr std::size_t footer_size = 4;
+
+    //! Returns the length of the record that ends at end in an image, read from its footer.
+    std::size_t record_length(const char *const image, const std::size_t end)
+    {
+        std::size_t length = 0;
+        for (std::size_t i = 0; i < footer_size; ++i)
+            length |= static_cast<std::size_t>(
+                          static_cast<unsigned char>(image[end - footer_size + i]))
+                      << (8 * i);
+        return length;
+    }
+
+    void put_number(std::string &image, std::uint64_t value)
+    {
+        while (value >= 0x80) {
+            image.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        image.push_back(static_cast<char>(value));
+    }
+
+    void put_text(std::string &image, const std::string_view text)
+    {
+        put_number(image, text.size());
+        image.append(text);
+    }
+
+    //! Reads the records of a history image. Every read fails once one has gone past the end.
+    class Reader {
+      public:
+        Reader(const char *start, const char *end) : next(start), end(end) {}
+
+        bool good() const { return next != nullptr; }
+
+        std::uint64_t number()
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; next != nullptr && shift < 64; shift += 7) {
+                if (next == end)
+                    break;
+                const unsigned char byte = static_cast<unsigned char>(*next++);
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                    return value;
+            }
+            next = nullptr;
+            return 0;
+        }
+
+        std::string_view text()
+        {
+            const std::uint64_t length = number();
+            if (next == nullptr || length > static_cast<std::uint64_t>(end - next)) {
+                next = nullptr;
+                return std::string_view();
+            }
+            const std::string_view result(next, static_cast<std::size_t>(length));
+            next += length;
+            return result;
+        }
+
+      private:
+        const char *next; //!< nullptr once a read has failed.
+        const char *end;
+    };
+} // namespace
+
+// Groups are numbered from one so that zero can mean "no group."
+unsigned long UndoLog::current_command = 1;
+// Groups taken from a history are numbered downward so that they never meet the others.
+unsigned long UndoLog::history_command = ULONG_MAX;
+std::size_t UndoLog::limit = 16UL * 1024UL * 1024UL;
+
+/*=====================================*/
+/*           Private Members           */
+/*=====================================*/
+
+//! Returns the approximate number of bytes used by an operation.
+std::size_t UndoLog::Operation::bytes() const
+{
+    std::size_t result = sizeof(Operation) + removed.capacity() + inserted.capacity();
+    if (lines)
+        result += sizeof(EditList) + lines->size() * line_overhead + line_bytes;
+    return result;
+}
+
+//! Computes the number of lines produced by the most recent operation if it is not yet known.
+/*!
+ * A LINES operation saves the lines it is about to replace. How many lines replace them is
+ * known only after the modification, so it is learned from the size of the file the next time
+ * the log is used.
+ */
+void UndoLog::close(EditList &data)
+{
+    if (!done.empty() && done.back().kind == LINES && done.back().new_count < 0) {
+        Operation &last = done.back();
+        last.new_count = last.old_count + (data.size() - last.size_before);
+    }
+}
+
+//! Returns true if a splice on the given line may be merged into the most recent operation.
+/*!
+ * Only a splice that is the sole operation of its group is extended. Operations done together
+ * on several lines (for example, typing while a block is active) are kept as they are.
+ */
+bool UndoLog::can_extend(const long line) const
+{
+    if (sealed || done.empty())
+        return false;
+    const Operation &last = done.back();
+    if (last.kind != TEXT || last.line != line)
+        return false;
+    return done.size() == 1 || done[done.size() - 2].command != last.command;
+}
+
+//! Appends an operation to the log as part of the current group.
+void UndoLog::add(Operation &operation)
+{
+    operation.command = current_command;
+    done.push_back(std::move(operation));
+    used += done.back().bytes();
+    sealed = false;
+    enforce_limit();
+}
+
+//! Forgets the oldest groups until the log is within its limit.
+/*!
+ * The group in progress is never partially forgotten. If it alone exceeds the limit the entire
+ * log is cleared and the rest of the group is not recorded.
+ */
+void UndoLog::enforce_limit()
+{
+    while (used > limit && !done.empty() && done.front().command != current_command) {
+        // The history can't be undone once the groups between it and the file are forgotten.
+        drop_history();
+        const unsigned long oldest = done.front().command;
+        while (!done.empty() && done.front().command == oldest) {
+            used -= done.front().bytes();
+            done.pop_front();
+        }
+    }
+    if (used > limit) {
+        clear();
+        discarded = current_command;
+    }
+}
+
+//! Returns a hash of the text of a file's lines. This function moves the current point of data.
+std::uint64_t UndoLog::content_hash(EditList &data)
+{
+    // FNV-1a, with each line followed by a line break.
+    std::uint64_t hash = fnv_basis;
+    data.jump_to(0);
+    const EditBuffer *line;
+    while ((line = data.next()) != nullptr)
+        hash = fnv1a("\n", fnv1a(line->view(), hash));
+    return hash;
+}
+
+//! Moves the most recent group kept in the history onto the log, decoding its operations.
+/*!
+ * Checks met on the way are compared with the file's lines. The history is dropped if one
+ * doesn't match, if the image is damaged, or if no groups remain.
+ *
+ * \return false if there was no group to take.
+ */
+bool UndoLog::take_history(EditList &data)
+{
+    const char *const base = history->data();
+    std::vector<Operation> group; // Newest first.
+    std::size_t end = history_end;
+    bool complete = false;
+    try {
+        while (!complete) {
+            if (end < signature_size + footer_size)
+                break;
+            const std::size_t length = record_length(base, end);
+            if (length > end - footer_size - signature_size)
+                break;
+            const char *const start = base + end - footer_size - length;
+            Reader reader(start, base + end - footer_size);
+            end -= footer_size + length;
+
+            const std::uint64_t kind = reader.number();
+            if (kind == CHECK) {
+                // Checks lie only between groups, where the file's lines are known.
+                const std::uint64_t hash = reader.number();
+                if (!reader.good() || !group.empty() || hash != content_hash(data))
+                    break;
+                history_checked = true;
+                continue;
+            }
+            if ((kind != TEXT && kind != LINES) || !history_checked)
+                break;
+
+            Operation operation;
+            complete = reader.number() != 0;
+            operation.kind = static_cast<Kind>(kind);
+            operation.line = static_cast<long>(reader.number());
+            operation.cursor_line = static_cast<long>(reader.number());
+            operation.cursor_column = static_cast<unsigned>(reader.number());
+            operation.column = 0;
+            operation.old_length = 0;
+            operation.old_count = 0;
+            operation.new_count = 0;
+            operation.size_before = 0;
+            operation.line_bytes = 0;
+            if (kind == TEXT) {
+                operation.column = static_cast<std::size_t>(reader.number());
+                operation.old_length = static_cast<std::size_t>(reader.number());
+                operation.removed.assign(reader.text());
+                operation.inserted.assign(reader.text());
+            }
+            else {
+                operation.old_count = static_cast<long>(reader.number());
+                operation.new_count = static_cast<long>(reader.number());
+                operation.lines.reset(new EditList);
+                for (long i = 0; i < operation.old_count && reader.good(); ++i) {
+                    const std::string_view text = reader.text();
+                    operation.lines->insert(new EditBuffer(text.data(), text.size()));
+                    operation.line_bytes += text.size();
+                }
+            }
+            if (!reader.good())
+                break;
+            group.push_back(std::move(operation));
+        }
+    }
+    catch (std::bad_alloc &) {
+        complete = false;
+    }
+    if (!complete) {
+        drop_history();
+        return false;
+    }
+
+    // The group's operations are undone newest first, as those recorded in this session are.
+    history_end = end;
+    const unsigned long command = history_command--;
+    for (auto operation = group.rbegin(); operation != group.rend(); ++operation) {
+        operation->command = command;
+        done.push_back(std::move(*operation));
+        used += done.back().bytes();
+    }
+    return true;
+}
+
+//! Performs an operation (if forward is true) or reverses it.
+/*!
+ * Applying a LINES operation exchanges the lines in the file with the saved lines, so the same
+ * operation then reverses itself. TEXT operations are left unchanged.
+ *
+ * \param tail [in, out] Lowered to the number of lines after those the operation modifies.
+ */
+void UndoLog::apply(EditList &data, Operation &operation, const bool forward, long &tail)
+{
+    const long modified = (operation.kind == TEXT) ? 1 : operation.new_count;
+    tail = std::min(tail, std::max(data.size() - operation.line - modified, 0L));
+    data.jump_to(operation.line);
+
+    if (operation.kind == TEXT) {
+        EditBuffer *const line = data.get();
+        if (line == nullptr)
+            return;
+
+        const std::string_view text = line->view();
+        const std::string &present = forward ? operation.removed : operation.inserted;
+        const std::string &wanted = forward ? operation.inserted : operation.removed;
+        const std::size_t column = operation.column;
+
+        // Inserting past the end of a line pads it with spaces (see EditBuffer::insert).
+        std::string result(text.substr(0, std::min(column, text.size())));
+        result.resize(column, ' ');
+        result.append(wanted);
+        if (column + present.size() < text.size())
+            result.append(text.substr(column + present.size()));
+        if (!forward && result.size() > operation.old_length)
+            result.resize(operation.old_length);
+        *line = EditBuffer(result.data(), result.size());
+        return;
+    }
+
+    // Take out the lines now in the file, keeping them for the reverse operation. The length
+    // of their text is not known without visiting them so the saved length is retained.
+    std::unique_ptr<EditList> present(new EditList);
+    data.splice_out(operation.new_count, *present);
+    data.splice_in(*operation.lines);
+
+    operation.new_count = operation.old_count;
+    operation.old_count = present->size();
+    operation.lines.swap(present);
+}
+
+/*====================================*/
+/*           Public Members           */
+/*====================================*/
+
+//! Creates an empty log.
+UndoLog::UndoLog()
+    : used(0), sealed(false), discarded(0), history_end(0), history_checked(false)
+{
+}
+
+//! Records that text in a line is about to be replaced.
+/*!
+ * The splice is merged with the most recent operation when it continues it. This happens when
+ * characters are typed, overtyped, or deleted one after another, or are erased with backspace.
+ *
+ * \param data The file's data. Only used to complete the previous operation.
+ * \param cursor The current point, restored when the operation is undone.
+ * \param line The line to be modified.
+ * \param column The offset of the splice in the line's text.
+ * \param old_length The length of the line before the modification.
+ * \param removed The text that will be removed at column.
+ * \param inserted The text that will be inserted at column. If column is past the end of the
+ * line the line is first padded with spaces.
+ */
+void UndoLog::record_text(EditList &data, const FilePosition &cursor, const long line,
+                          const std::size_t column, const std::size_t old_length,
+                          const std::string_view removed, const std::string_view inserted)
+{
+    if (discarded == current_command)
+        return;
+    close(data);
+    for (const Operation &operation : undone) {
+        used -= operation.bytes();
+    }
+    undone.clear();
+
+    if (can_extend(line)) {
+        Operation &last = done.back();
+        const std::size_t end = last.column + last.inserted.size();
+        bool merged = true;
+        used -= last.bytes();
+
+        if (column == end) {
+            // Typing, overtyping, or deleting forward just after the previous splice.
+            last.removed.append(removed);
+            last.inserted.append(inserted);
+        }
+        else if (inserted.empty() && column + removed.size() == end &&
+                 removed.size() <= last.inserted.size() &&
+                 last.inserted.compare(last.inserted.size() - removed.size(), removed.size(),
+                                       removed) == 0) {
+            // Erasing text that the previous splice inserted.
+            last.inserted.resize(last.inserted.size() - removed.size());
+        }
+        else if (column + removed.size() == last.column) {
+            // Backspacing just before the previous splice.
+            last.removed.insert(0, removed);
+            last.inserted.insert(0, inserted);
+            last.column = column;
+        }
+        else {
+            merged = false;
+        }
+
+        used += last.bytes();
+        if (merged) {
+            last.command = current_command;
+            enforce_limit();
+            return;
+        }
+    }
+
+    Operation operation;
+    operation.kind = TEXT;
+    operation.line = line;
+    operation.column = column;
+    operation.old_length = old_length;
+    operation.old_count = 0;
+    operation.new_count = 0;
+    operation.size_before = 0;
+    operation.line_bytes = 0;
+    operation.removed.assign(removed);
+    operation.inserted.assign(inserted);
+    operation.cursor_line = cursor.cursor_line();
+    operation.cursor_column = cursor.cursor_column();
+    add(operation);
+}
+
+//! Records that a range of lines is about to be replaced by some number of other lines.
+/*!
+ * The lines are saved. The number of lines that replace them need not be given; it is worked
+ * out from the size of the file after the modification. Lines beyond the end of the file are
+ * ignored. This function moves the current point of data.
+ *
+ * \param data The file's data.
+ * \param cursor The current point, restored when the operation is undone.
+ * \param first The first line to be replaced. Lines are inserted here if count is zero.
+ * \param count The number of lines to be replaced.
+ */
+void UndoLog::record_lines(EditList &data, const FilePosition &cursor, const long first,
+                           long count)
+{
+    if (discarded == current_command)
+        return;
+    close(data);
+    for (const Operation &operation : undone) {
+        used -= operation.bytes();
+    }
+    undone.clear();
+
+    const long size = data.size();
+    if (count > size - first)
+        count = size - first;
+    if (count < 0)
+        count = 0;
+
+    // Don't save lines that could never be kept.
+    std::size_t total = static_cast<std::size_t>(count) * line_overhead;
+    data.jump_to(first);
+    for (long i = 0; i < count && total <= limit; ++i) {
+        total += data.next()->length();
+    }
+    if (total > limit) {
+        clear();
+        discarded = current_command;
+        return;
+    }
+
+    Operation operation;
+    operation.kind = LINES;
+    operation.line = first;
+    operation.column = 0;
+    operation.old_length = 0;
+    operation.old_count = count;
+    operation.new_count = -1;
+    operation.size_before = size;
+    operation.line_bytes = 0;
+    operation.lines.reset(new EditList);
+    data.jump_to(first);
+    for (long i = 0; i < count; ++i) {
+        const EditBuffer *const line = data.next();
+        operation.lines->insert(new EditBuffer(*line));
+        operation.line_bytes += line->length();
+    }
+    operation.cursor_line = cursor.cursor_line();
+    operation.cursor_column = cursor.cursor_column();
+    add(operation);
+}
+
+//! Reverses the most recent group of operations.
+/*!
+ * \param data The file's data.
+ * \param first_line [out] The first line modified. All following lines may have moved.
+ * \param tail [out] The number of lines at the end of the file that were not modified.
+ * \param cursor_line [out] The line of the current point before the group was performed.
+ * \param cursor_column [out] The column of the current point before the group was performed.
+ * \return false if there is nothing to undo.
+ */
+bool UndoLog::undo(EditList &data, long &first_line, long &tail, long &cursor_line,
+                   unsigned &cursor_column)
+{
+    close(data);
+    if (done.empty() && (history == nullptr || !take_history(data)))
+        return false;
+
+    const unsigned long command = done.back().command;
+    first_line = LONG_MAX;
+    tail = LONG_MAX;
+    while (!done.empty() && done.back().command == command) {
+        Operation &operation = done.back();
+        used -= operation.bytes();
+        apply(data, operation, false, tail);
+        used += operation.bytes();
+        first_line = std::min(first_line, operation.line);
+        cursor_line = operation.cursor_line;
+        cursor_column = operation.cursor_column;
+        undone.push_back(std::move(operation));
+        done.pop_back();
+    }
+    sealed = true;
+    discarded = 0;
+    return true;
+}
+
+//! Performs again the most recently undone group of operations.
+/*!
+ * \param data The file's data.
+ * \param first_line [out] The first line modified. All following lines may have moved.
+ * \param tail [out] The number of lines at the end of the file that were not modified.
+ * \param cursor_line [out] The line of the current point after the group is performed.
+ * \param cursor_column [out] The column of the current point after the group is performed.
+ * \param tab The distance between tab stops, used to find the column after inserted text.
+ * \return false if there is nothing to redo.
+ */
+bool UndoLog::redo(EditList &data, long &first_line, long &tail, long &cursor_line,
+                   unsigned &cursor_column, const unsigned tab)
+{
+    if (undone.empty())
+        return false;
+
+    const unsigned long command = undone.back().command;
+    first_line = LONG_MAX;
+    tail = LONG_MAX;
+    while (!undone.empty() && undone.back().command == command) {
+        Operation &operation = undone.back();
+        used -= operation.bytes();
+        apply(data, operation, true, tail);
+        used += operation.bytes();
+        first_line = std::min(first_line, operation.line);
+        cursor_line = operation.cursor_line;
+        cursor_column = operation.cursor_column;
+        if (operation.kind == TEXT) {
+            // The data is still at the line. The cursor goes after the inserted text.
+            const std::size_t offset = operation.column + operation.inserted.size();
+            const EditBuffer *const line = data.get();
+            cursor_line = operation.line;
+            cursor_column =
+                static_cast<unsigned>(line != nullptr ? line->column_of(offset, tab) : offset);
+        }
+        done.push_back(std::move(operation));
+        undone.pop_back();
+    }
+    sealed = true;
+    discarded = 0;
+    return true;
+}
+
+//! Forgets all operations.
+void UndoLog::clear()
+{
+    done.clear();
+    undone.clear();
+    used = 0;
+    sealed = false;
+    drop_history();
+}
+
+//! Takes the image of a log kept by an earlier session (see write_history) as its history.
+/*!
+ * Nothing in the image is decoded until it is undone, so this costs little more than mapping
+ * it. The history lies under the operations of this session. It must be opened while the file
+ * holds the lines it had when the image was written.
+ *
+ * \return false if the image is not a history. It is not kept.
+ */
+bool UndoLog::open_history(std::unique_ptr<MappedFile> image)
+{
+    if (image == nullptr || image->size() < signature_size ||
+        std::memcmp(image->data(), signature, signature_size) != 0)
+        return false;
+    history = std::move(image);
+    history_end = history->size();
+    history_checked = false;
+    return true;
+}
+
+//! Makes an image of the log to be kept with the file and opened in a later session.
+/*!
+ * The image holds what remains of the history and then the operations that can be undone now,
+ * followed by a check of the file's lines as they are. Operations that can be redone are not
+ * kept. This function moves the current point of data.
+ *
+ * \param data The file's data, as just saved.
+ * \param image [out] The image.
+ * \return false if there is nothing to undo, so nothing is worth keeping.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+bool UndoLog::write_history(EditList &data, std::string &image)
+{
+    close(data);
+    image.assign(signature, signature_size);
+    bool checked = false;
+    if (history != nullptr) {
+        image.append(history->data() + signature_size, history_end - signature_size);
+
+        // The kind is the first byte of a record. An unchanged history needs no new check.
+        if (history_end >= signature_size + footer_size) {
+            const std::size_t length = record_length(history->data(), history_end);
+            checked = length != 0 && length <= history_end - footer_size - signature_size &&
+                      history->data()[history_end - footer_size - length] == CHECK;
+        }
+    }
+
+    const auto finish_record = [&image](const std::size_t start) {
+        const std::size_t length = image.size() - start;
+        for (std::size_t i = 0; i < footer_size; ++i)
+            image.push_back(static_cast<char>((length >> (8 * i)) & 0xFF));
+        return length <= 0xFFFFFFFFU;
+    };
+    for (std::size_t i = 0; i < done.size(); ++i) {
+        Operation &operation = done[i];
+        const std::size_t start = image.size();
+        put_number(image, operation.kind);
+        put_number(image, i == 0 || done[i - 1].command != operation.command);
+        put_number(image, static_cast<std::uint64_t>(operation.line));
+        put_number(image, static_cast<std::uint64_t>(operation.cursor_line));
+        put_number(image, operation.cursor_column);
+        if (operation.kind == TEXT) {
+            put_number(image, operation.column);
+            put_number(image, operation.old_length);
+            put_text(image, operation.removed);
+            put_text(image, operation.inserted);
+        }
+        else {
+            put_number(image, static_cast<std::uint64_t>(operation.old_count));
+            put_number(image, static_cast<std::uint64_t>(operation.new_count));
+            operation.lines->jump_to(0);
+            const EditBuffer *line;
+            while ((line = operation.lines->next()) != nullptr)
+                put_text(image, line->view());
+        }
+        if (!finish_record(start))
+            return false;
+    }
+
+    if (done.empty() && checked)
+        return true;
+    if (done.empty() && history == nullptr)
+        return false;
+    const std::size_t start = image.size();
+    put_number(image, CHECK);
+    put_number(image, content_hash(data));
+    return finish_record(start);
+}
@@ -0,0 +1,110 @@
+/*! \file    Utf8.cpp
+ *  \brief   Implementation of the Utf8 functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define UTF8_SSE2
+#endif
+
+#include "Utf8.hpp"
+
+namespace {
+
+    constexpr std::uint64_t high_bits = 0x8080808080808080ULL;
+
+    //! Returns the number of continuation bytes in the size bytes at text.
+    std::size_t continuation_count(const char *const text, const std::size_t size)
+    {
+        std::size_t count = 0;
+        std::size_t i = 0;
+
+#ifdef UTF8_SSE2
+        // Continuation bytes are exactly those less than -64 when taken as signed.
+        const __m128i limit = _mm_set1_epi8(-64);
+        for (; i + 16 <= size; i += 16) {
+            const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i));
+            const __m128i found = _mm_cmplt_epi8(block, limit);
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+            for (; mask != 0; mask &= mask - 1)
+                ++count;
+        }
+#endif
+        for (; i < size; ++i) {
+            if (Utf8::is_continuation(text[i]))
+                ++count;
+        }
+        return count;
+    }
+
+} // namespace
+
+namespace Utf8 {
+
+    /*!
+     * Most lines are ASCII, so this is checked a block of bytes at a time: sixteen with SSE2,
+     * otherwise eight.
+     */
+    bool is_ascii(const char *const text, const std::size_t size)
+    {
+        std::size_t i = 0;
+#ifdef UTF8_SSE2
+        __m128i found = _mm_setzero_si128();
+        for (; i + 16 <= size; i += 16)
+            found = _mm_or_si128(
+                found, _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + i)));
+        if (_mm_movemask_epi8(found) != 0)
+            return false;
+#endif
+        std::uint64_t word_bits = 0;
+        for (; i + 8 <= size; i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, text + i, sizeof(word));
+            word_bits |= word;
+        }
+        if ((word_bits & high_bits) != 0)
+            return false;
+        for (; i < size; ++i) {
+            if (text[i] & 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    std::size_t characters(const std::string_view text)
+    {
+        if (text.empty())
+            return 0;
+        std::size_t count = text.size() - continuation_count(text.data(), text.size());
+        if (is_continuation(text[0]))
+            ++count;
+        return count;
+    }
+
+    std::size_t next(const std::string_view text, std::size_t offset)
+    {
+        if (offset >= text.size())
+            return offset + 1;
+        ++offset;
+        while (offset < text.size() && is_continuation(text[offset]))
+            ++offset;
+        return offset;
+    }
+
+    std::size_t previous(const std::string_view text, std::size_t offset)
+    {
+        if (offset > text.size())
+            return offset - 1;
+        if (offset == 0)
+            return 0;
+        --offset;
+        while (offset != 0 && is_continuation(text[offset]))
+            --offset;
+        return offset;
+    }
+
+} // namespace Utf8
@@ -10,13 +10,26 @@
  * It may be desirable to redesign this code in a later version of Y; it needs it.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
-#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "EditBuffer.hpp"
+#include "TaskPool.hpp"
+#include "Utf8.hpp"
 #include "WPEditFile.hpp"
 #include "support.hpp"
 
+namespace {
+    // Threads are only worth starting if each can reformat at least this many paragraphs.
+    constexpr std::size_t minimum_share = 64;
+} // namespace
+
 /*=======================================*/
 /*           Private Functions           */
 /*=======================================*/
@@ -24,19 +37,26 @@
 //! Return true if given character is a legitimate paragraph character.
 /*!
  * If characters of this type are the first characters on a line, then the line is taken as part
- * of a paragraph.
+ * of a paragraph. Characters outside of ASCII are taken to be letters.
  */
-static bool paragraph_char(int ch)
+static bool paragraph_char(char ch)
+{
+    const unsigned char letter = static_cast<unsigned char>(ch);
+    return static_cast<bool>(letter >= 0x80 || std::isalpha(letter) || std::isdigit(letter) ||
+                             ch == '(' || ch == '$' || ch == '\"' || ch == '\'');
+}
+
+//! Return true if the given character is a space or a tab.
+static bool is_blank(char ch)
 {
-    return static_cast<bool>(std::isalpha(ch) || std::isdigit(ch) || ch == '(' || ch == '$' ||
-                             ch == '\"' || ch == '\'');
+    return ch == ' ' || ch == '\t';
 }
 
 //! Return true if the given line is blank; false otherwise.
 static bool blank_line(EditBuffer *line)
 {
     for (unsigned i = 0; i < line->length(); i++) {
-        if ((*line)[i] != ' ')
+        if (!is_blank((*line)[i]))
             return false;
     }
     return true;
@@ -64,7 +84,7 @@ static long first_line(EditList &list)
     if (blank_line(list.get())) {
         list.next();
     }
-    if (!paragraph_char((*list.get())[0]) && (*list.get())[0] != ' ') {
+    if (!paragraph_char((*list.get())[0]) && !is_blank((*list.get())[0])) {
         list.next();
     }
 
@@ -96,87 +116,98 @@ static long last_line(EditList &list)
     return return_value;
 }
 
+//! The lines of one paragraph and the lines that replace them.
+struct Paragraph {
+    long first;                                      //!< The first line of the paragraph.
+    long last;                                       //!< The last line + 1.
+    std::vector<std::string_view> text;              //!< The text of the original lines.
+    std::vector<std::unique_ptr<EditBuffer>> result; //!< The lines after reformatting.
+};
+
 /*!
- * This function does the dirty work of reformatting a paragraph. It must be given the range of
- * lines to reformat (first <= range < last). It assumes that the lines exist in the given
- * EditList. This function returns false if it encounters memory problems during the operation.
+ * This function does the dirty work of reformatting a paragraph. It reads the original text of
+ * the paragraph and fills in the lines that replace it. It does not touch any EditList so
+ * several paragraphs can be reformatted at once on different threads.
  */
-static bool process_paragraph(EditList &list, long first, long last)
+static void reflow(Paragraph &paragraph)
 {
-    bool abort = false;        // =true if we've run out of memory.
-    EditList temp;             // Holds text of paragraph temporarly.
-    const char *indentor = ""; // Used to indent the first line of the para.
-
-    // Position the list to start of paragraph. Note if the paragraph is indented.
-    list.jump_to(first);
-    if ((*list.get())[0] == ' ')
-        indentor = "     ";
-
-    // Copy pointers to lines into temporary and delete free nodes from the list.
-    long count = last - first;
-    while (!abort && count--) {
-        if (temp.insert(list.get()) == nullptr)
-            abort = true;
-        else
-            list.erase();
-    }
-
-    // Tell user if it didn't work.
-    if (abort) {
-        memory_message("Can't create scratch copy of paragraph");
-        return false;
-    }
-
-    // Create a new line to hold the reformatted text.
-    EditBuffer *new_line = new EditBuffer(indentor);
-
-    // Loop over all the lines in the temporary list.
-    for (temp.jump_to(0); !abort && temp.get() != nullptr; temp.next()) {
-
-        // TODO: Clean this mess up!
-        std::string string_buffer = temp.get()->to_string();
-        char *buffer = new char[string_buffer.length() + 1];
-        std::strcpy(buffer, string_buffer.c_str());
-        char *word = std::strtok(buffer, " ");
-
-        // Loop over all words in the line from the temporary list.
-        while (word != nullptr) {
-
-            // If this line will become too long, insert what we've got and start next line.
-            if (new_line->length() + std::strlen(word) > 96) {
-                list.insert(new_line);
-                new_line = new EditBuffer(word);
-                new_line->append(' ');
-            }
-
-            // Otherwise put this word on the temporary line.
-            else {
-                new_line->append(word);
-                new_line->append(' ');
+    // Indent the first line of the new paragraph if the old one was indented.
+    std::string new_line;
+    if (!paragraph.text.empty() && !paragraph.text.front().empty() &&
+        is_blank(paragraph.text.front()[0]))
+        new_line = "     ";
+    std::size_t new_columns = new_line.size(); // The columns occupied by new_line.
+
+    for (const std::string_view line : paragraph.text) {
+        std::size_t position = 0;
+
+        // Loop over all words in the line.
+        while ((position = line.find_first_not_of(" \t", position)) != std::string_view::npos) {
+            std::size_t word_end = line.find_first_of(" \t", position);
+            if (word_end == std::string_view::npos)
+                word_end = line.size();
+            const std::string_view word = line.substr(position, word_end - position);
+            const std::size_t word_columns = Utf8::characters(word);
+            position = word_end;
+
+            // If this line will become too long, keep what we've got and start the next line.
+            if (new_columns + word_columns > 96) {
+                paragraph.result.emplace_back(new EditBuffer(new_line.data(), new_line.size()));
+                new_line.clear();
+                new_columns = 0;
             }
-
-            // Try to extract the next word.
-            word = std::strtok(nullptr, " ");
+            new_line.append(word);
+            new_line.append(1, ' ');
+            new_columns += word_columns + 1;
         }
+    }
 
-        delete buffer;
+    // If final line is partially filled keep it as well.
+    if (new_line.length() > 0) {
+        paragraph.result.emplace_back(new EditBuffer(new_line.data(), new_line.size()));
     }
+}
 
-    if (abort) {
-        memory_message("Can't rebuild entire paragraph");
-        delete new_line;
-        return false;
+//! Reformats paragraphs until none are left. Runs on a worker thread.
+static void reflow_all(std::vector<Paragraph> &paragraphs, std::atomic<std::size_t> &next)
+{
+    std::size_t index;
+    while ((index = next++) < paragraphs.size()) {
+        reflow(paragraphs[index]);
     }
+}
 
-    // If final line is partially filled. Insert it as well.
-    if (!abort && new_line->length() > 0) {
-        list.insert(new_line);
+//! Collects the text of the paragraph's lines. The list must hold the lines.
+static void gather(EditList &list, Paragraph &paragraph)
+{
+    list.jump_to(paragraph.first);
+    for (long i = paragraph.first; i < paragraph.last; ++i) {
+        paragraph.text.push_back(list.next()->view());
     }
-    else {
-        delete new_line;
+}
+
+/*!
+ * This function reformats a paragraph. It must be given the range of lines to reformat (first
+ * <= range < last). It assumes that the lines exist in the given EditList. The old lines are
+ * removed from the list and the new lines take their place as a single splice.
+ */
+static void process_paragraph(EditList &list, long first, long last)
+{
+    Paragraph paragraph{first, last, {}, {}};
+    gather(list, paragraph);
+    reflow(paragraph);
+
+    EditList new_lines;
+    for (std::unique_ptr<EditBuffer> &line : paragraph.result) {
+        new_lines.insert(line.release());
     }
 
-    return true;
+    // The views into the old lines must not be used once they are removed.
+    paragraph.text.clear();
+    EditList old_lines;
+    list.jump_to(first);
+    list.splice_out(last - first, old_lines);
+    list.splice_in(new_lines);
 }
 
 /*=============================================*/
@@ -189,8 +220,6 @@ static bool process_paragraph(EditList &list, long first, long last)
  */
 bool WPEditFile::reformat_paragraph()
 {
-    bool result = true;
-
     // Synchronize the file data and extract a pointer to the current line.
     file_data.jump_to(current_point.cursor_line());
     EditBuffer *current_line = file_data.get();
@@ -205,7 +234,96 @@ bool WPEditFile::reformat_paragraph()
 
         // Modify the object and mark it as changed.
         is_changed = true;
-        result = process_paragraph(file_data, first, last);
+        mark_damaged_from(first);
+        record_lines(first, last - first);
+        process_paragraph(file_data, first, last);
+    }
+    return true;
+}
+
+//! Reformats every paragraph in the block, or in the whole file if block mode is off.
+/*!
+ * The paragraphs are found in one pass over the lines. They are then reformatted at the same
+ * time on several threads and the reformatted text replaces the old lines as a single splice.
+ * The entire operation is undone as a unit.
+ *
+ * \return false if there are no paragraphs to reformat.
+ */
+bool WPEditFile::reformat_block()
+{
+    long begin = 0;
+    long end = file_data.size();
+    if (get_block_state()) {
+        block_limits(begin, end);
+        end = std::min(end + 1, file_data.size());
     }
-    return result;
+
+    // Find the paragraphs. A paragraph starts with a paragraph character or with an indented
+    // line and continues while the lines start with paragraph characters.
+    std::vector<Paragraph> paragraphs;
+    file_data.jump_to(begin);
+    EditBuffer *line = file_data.get();
+    long line_number = begin;
+    while (line_number < end) {
+        const char first_char = (*line)[0];
+        if (!paragraph_char(first_char) && (first_char != ' ' || blank_line(line))) {
+            file_data.next();
+            line = file_data.get();
+            ++line_number;
+            continue;
+        }
+        Paragraph paragraph{line_number, 0, {}, {}};
+        do {
+            paragraph.text.push_back(line->view());
+            file_data.next();
+            line = file_data.get();
+            ++line_number;
+        } while (line_number < end && paragraph_char((*line)[0]));
+        paragraph.last = line_number;
+        paragraphs.push_back(std::move(paragraph));
+    }
+    if (paragraphs.empty()) {
+        info_message("No paragraphs to reformat");
+        return false;
+    }
+
+    // Reformat the paragraphs. This thread does its share, and all of them if the workers are
+    // busy with something else.
+    std::atomic<std::size_t> next(0);
+    TaskPool::Group workers;
+    const std::size_t hardware = TaskPool::size();
+    const std::size_t count = std::min(hardware, paragraphs.size() / minimum_share);
+    for (std::size_t i = 1; i < count; ++i) {
+        workers.run([&]() { reflow_all(paragraphs, next); });
+    }
+    reflow_all(paragraphs, next);
+    workers.wait();
+
+    // Assemble the new lines, sharing the text of the lines between paragraphs.
+    EditList new_lines;
+    long copied = paragraphs.front().first;
+    file_data.jump_to(copied);
+    for (Paragraph &paragraph : paragraphs) {
+        for (; copied < paragraph.first; ++copied) {
+            new_lines.insert(new EditBuffer(*file_data.next()));
+        }
+        for (std::unique_ptr<EditBuffer> &new_line : paragraph.result) {
+            new_lines.insert(new_line.release());
+        }
+        paragraph.text.clear();
+        copied = paragraph.last;
+        file_data.jump_to(copied);
+    }
+
+    const long first = paragraphs.front().first;
+    const long last = paragraphs.back().last;
+    is_changed = true;
+    mark_damaged_from(first);
+    record_lines(first, last - first);
+
+    EditList old_lines;
+    file_data.jump_to(first);
+    file_data.splice_out(last - first, old_lines);
+    file_data.splice_in(new_lines);
+    return true;
 }
@@ -0,0 +1,337 @@
+/*! \file    WindowList.cpp
+ *  \brief   Implementation of the WindowList abstract object.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <screen/Manager.hpp>
+#include <screen/debug.hpp>
+#include <screen/screen.hpp>
+
+#include "Allocations.hpp"
+#include "DiffView.hpp"
+#include "FileList.hpp"
+#include "FileWindow.hpp"
+#include "Profiler.hpp"
+#include "Renderer.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
+#include "support.hpp"
+
+namespace {
+
+    //! A region of the screen holding one window or divided between two regions.
+    struct Tile {
+        Tile *parent = nullptr;
+        std::unique_ptr<Tile> first;  //!< The top or left part of a divided region.
+        std::unique_ptr<Tile> second; //!< The bottom or right part.
+        bool side_by_side = false;    //!< True if the parts are left and right.
+        FileWindow *window = nullptr; //!< The window filling the region (nullptr if divided).
+    };
+
+    // The smallest windows that split() creates, including their borders.
+    const int minimum_height = 4;
+    const int minimum_width = 20;
+
+    // The size of the overlay's text.
+    const int overlay_width = 40;
+    const int overlay_height = 5;
+
+    // The manager is created once the screen has been initialized. It is never destroyed since
+    // its destructor repaints the screen, which is shut down by then.
+    scr::Manager *manager = nullptr;
+    std::unique_ptr<Tile> root;
+    Tile *active = nullptr;
+    std::unique_ptr<scr::MonitorWindow> overlay; // The performance overlay (nullptr if hidden).
+    std::unique_ptr<scr::MonitorWindow> prompt;  // The prompt line (nullptr if hidden).
+
+    //! Creates the first window, filling the screen, if it does not exist yet.
+    void start()
+    {
+        if (root)
+            return;
+        if (manager == nullptr) {
+            manager = new scr::Manager;
+
+            // Popups closed over the windows are removed by compositing the windows again.
+            scr::SimpleWindow::set_repair_function(
+                [](int row, int column, int width, int height) {
+                    manager->repair(row, column, width, height);
+                });
+        }
+        YEditFile &file = FileList::active_file();
+        root = std::make_unique<Tile>();
+        root->window = new FileWindow(manager, &file, file.CP(), 1, 1, scr::number_of_columns(),
+                                      scr::number_of_rows());
+        active = root.get();
+    }
+
+    //! Appends the regions holding windows to tiles, from the top left.
+    void collect(Tile &tile, std::vector<Tile *> &tiles)
+    {
+        if (tile.window != nullptr) {
+            tiles.push_back(&tile);
+            return;
+        }
+        collect(*tile.first, tiles);
+        collect(*tile.second, tiles);
+    }
+
+    //! Returns the regions holding windows, from the top left.
+    std::vector<Tile *> windows()
+    {
+        std::vector<Tile *> tiles;
+        if (root)
+            collect(*root, tiles);
+        return tiles;
+    }
+
+    //! Places the windows in a region (each part getting half of it).
+    void arrange(Tile &tile, const int row, const int column, const int width, const int height)
+    {
+        if (tile.window != nullptr) {
+            manager->set_geometry(tile.window, row, column, width, height);
+            return;
+        }
+        if (tile.side_by_side) {
+            const int left = width / 2;
+            arrange(*tile.first, row, column, left, height);
+            arrange(*tile.second, row, column + left, width - left, height);
+        }
+        else {
+            const int top = height / 2;
+            arrange(*tile.first, row, column, width, top);
+            arrange(*tile.second, row + top, column, width, height - top);
+        }
+    }
+
+    //! Makes a window active along with the file it shows, at the window's position.
+    void activate(Tile *const tile)
+    {
+        active = tile;
+        YEditFile *const file = tile->window->file();
+        if (file != nullptr) {
+            FileList::lookup(file->name());
+            file->CP() = tile->window->position();
+        }
+        manager->raise_window(tile->window);
+        if (overlay) {
+            manager->raise_window(overlay.get());
+            overlay->follow_cursor(tile->window);
+        }
+    }
+
+    //! Brings the overlay's figures up to date and keeps it in the top right corner.
+    void update_overlay()
+    {
+        const int column = std::max(2, scr::number_of_columns() - overlay_width);
+        int row, current_column;
+        manager->get_position(overlay.get(), row, current_column);
+        if (current_column != column)
+            manager->set_geometry(overlay.get(), 2, column, overlay_width, overlay_height);
+
+        const std::vector<std::string> lines = Renderer::overlay();
+        for (std::size_t i = 0; i < lines.size(); ++i)
+            overlay->set_line(static_cast<int>(i + 1), lines[i]);
+    }
+
+} // namespace
+
+namespace WindowList {
+
+    void display()
+    {
+        Allocations::Scope tag(Allocations::SCREEN);
+        start();
+
+        // The active window shows the active file. Windows showing files that were removed show
+        // the active file instead.
+        YEditFile &file = FileList::active_file();
+        if (active->window->file() != &file)
+            active->window->show(&file, file.CP());
+        const std::vector<Tile *> tiles = windows();
+        for (Tile *const tile : tiles) {
+            if (tile->window->file() == nullptr)
+                tile->window->show(&file, file.CP());
+        }
+
+        // Windows showing the file the active one is compared with keep level with it.
+        for (Tile *const tile : tiles) {
+            YEditFile *const other = tile->window->file();
+            FilePosition position = tile->window->position();
+            if (tile != active && DiffView::follow(file, file.CP(), *other, position))
+                tile->window->show(other, position);
+        }
+
+        // The layout follows the size of the screen. The damage is forgotten only once every
+        // window showing a file has been painted.
+        arrange(*root, 1, 1, scr::number_of_columns(), scr::number_of_rows());
+        {
+            Profiler::Scope zone(Profiler::DISPLAY);
+            for (Tile *const tile : tiles)
+                tile->window->paint(tile == active);
+            for (Tile *const tile : tiles)
+                tile->window->file()->finish_display();
+        }
+        if (overlay)
+            update_overlay();
+        // The prompt line stays on the bottom row as the screen is resized.
+        if (prompt)
+            manager->set_geometry(prompt.get(), scr::number_of_rows(), 1,
+                                  scr::number_of_columns(), 1);
+        Profiler::Scope zone(Profiler::FLUSH);
+        manager->update_display();
+    }
+
+    void invalidate()
+    {
+        YEditFile::invalidate_display();
+        if (manager != nullptr)
+            manager->invalidate();
+    }
+
+    bool shows(const YEditFile *const file)
+    {
+        if (!root)
+            return file == &FileList::active_file();
+        for (Tile *const tile : windows()) {
+            if (tile->window->file() == file)
+                return true;
+        }
+        return false;
+    }
+
+    void forget(const YEditFile *const file)
+    {
+        for (Tile *const tile : windows())
+            tile->window->forget(file);
+    }
+
+    bool split(const bool side_by_side)
+    {
+        Allocations::Scope tag(Allocations::SCREEN);
+        start();
+        int width = 0, height = 0;
+        manager->get_size(active->window, width, height);
+        if ((side_by_side && width / 2 < minimum_width) ||
+            (!side_by_side && height / 2 < minimum_height)) {
+            error_message("The window is too small to split");
+            return false;
+        }
+
+        // The old window remembers where it is in the file; the new one starts there too.
+        YEditFile &file = FileList::active_file();
+        Tile &divided = *active;
+        divided.window->show(&file, file.CP());
+        divided.side_by_side = side_by_side;
+        divided.first = std::make_unique<Tile>();
+        divided.first->parent = &divided;
+        divided.first->window = divided.window;
+        divided.second = std::make_unique<Tile>();
+        divided.second->parent = &divided;
+        divided.second->window = new FileWindow(manager, &file, file.CP(), 1, 1, width, height);
+        divided.window = nullptr;
+
+        activate(divided.second.get());
+        return true;
+    }
+
+    void next()
+    {
+        start();
+        const std::vector<Tile *> tiles = windows();
+        if (tiles.size() < 2)
+            return;
+        YEditFile &file = FileList::active_file();
+        active->window->show(&file, file.CP());
+
+        std::size_t index = 0;
+        while (tiles[index] != active)
+            ++index;
+        activate(tiles[(index + 1) % tiles.size()]);
+    }
+
+    bool close()
+    {
+        start();
+        if (active == root.get()) {
+            error_message("The last window can't be closed");
+            return false;
+        }
+
+        // The region the closed window divided with takes over their parent region.
+        Tile *const parent = active->parent;
+        std::unique_ptr<Tile> survivor =
+            std::move((parent->first.get() == active) ? parent->second : parent->first);
+        if (overlay)
+            overlay->follow_cursor(survivor->window);
+        delete active->window;
+        parent->window = survivor->window;
+        parent->side_by_side = survivor->side_by_side;
+        parent->first = std::move(survivor->first);
+        parent->second = std::move(survivor->second);
+        if (parent->first)
+            parent->first->parent = parent;
+        if (parent->second)
+            parent->second->parent = parent;
+
+        Tile *successor = parent;
+        while (successor->window == nullptr)
+            successor = successor->first.get();
+        activate(successor);
+        return true;
+    }
+
+    unsigned count()
+    {
+        return root ? static_cast<unsigned>(windows().size()) : 1U;
+    }
+
+    void text_origin(int &row, int &column)
+    {
+        row = 2;
+        column = 2;
+        if (root) {
+            manager->get_position(active->window, row, column);
+            ++row;
+            ++column;
+        }
+    }
+
+    void toggle_overlay()
+    {
+        Allocations::Scope tag(Allocations::SCREEN);
+        start();
+        if (overlay) {
+            overlay.reset();
+            return;
+        }
+        overlay = std::make_unique<scr::MonitorWindow>(
+            manager, 2, std::max(2, scr::number_of_columns() - overlay_width), overlay_width,
+            overlay_height, scr::BRIGHT | scr::WHITE | scr::REV_BLUE);
+        overlay->follow_cursor(active->window);
+    }
+
+    void show_prompt(const std::string &text)
+    {
+        Allocations::Scope tag(Allocations::SCREEN);
+        start();
+        if (!prompt) {
+            prompt = std::make_unique<scr::MonitorWindow>(
+                manager, scr::number_of_rows(), 1, scr::number_of_columns(), 1,
+                scr::BLACK | scr::REV_WHITE);
+            prompt->follow_cursor(active->window);
+        }
+        prompt->set_line(1, text);
+    }
+
+    void hide_prompt()
+    {
+        prompt.reset();
+    }
+
+} // namespace WindowList
@@ -0,0 +1,111 @@
+/*! \file    WordIndex.cpp
+ *  \brief   Implementation of class WordIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+
+#include "EditBuffer.hpp"
+#include "WordIndex.hpp"
+
+//! Finds the words of the text.
+/*!
+ * \param text The line.
+ * \param bounds [out] The offset where each word starts followed by the offset just past its
+ * end, in order.
+ */
+void WordIndex::split(const std::string_view text, std::vector<std::size_t> &bounds)
+{
+    bounds.clear();
+    bool in_word = false;
+    for (std::size_t offset = 0; offset < text.size(); ++offset) {
+        const unsigned char letter = static_cast<unsigned char>(text[offset]);
+        const bool word = letter >= 0x80 || std::isalnum(letter);
+        if (word != in_word) {
+            bounds.push_back(offset);
+            in_word = word;
+        }
+    }
+    if (in_word)
+        bounds.push_back(text.size());
+}
+
+//! Returns the words of a line, scanning it if that hasn't been done since it was modified.
+const std::vector<std::size_t> &WordIndex::scan(const long line, const EditBuffer &text)
+{
+    const auto known = lines.find(line);
+    if (known != lines.end())
+        return known->second;
+    if (lines.size() >= maximum_lines)
+        lines.clear();
+
+    std::vector<std::size_t> &bounds = lines[line];
+    split(text.view(), bounds);
+    return bounds;
+}
+
+//! Returns the offset of the first word of a line that starts at or after offset.
+/*!
+ * \return std::string_view::npos if there is no such word.
+ */
+std::size_t WordIndex::start_from(const long line, const EditBuffer &text,
+                                  const std::size_t offset)
+{
+    const std::vector<std::size_t> &bounds = scan(line, text);
+    for (auto it = std::lower_bound(bounds.begin(), bounds.end(), offset); it != bounds.end();
+         ++it) {
+        if ((it - bounds.begin()) % 2 == 0)
+            return *it;
+    }
+    return std::string_view::npos;
+}
+
+//! Returns the offset of the last word of a line that starts before offset.
+/*!
+ * \return std::string_view::npos if there is no such word.
+ */
+std::size_t WordIndex::start_before(const long line, const EditBuffer &text,
+                                    const std::size_t offset)
+{
+    const std::vector<std::size_t> &bounds = scan(line, text);
+    auto it = std::lower_bound(bounds.begin(), bounds.end(), offset);
+    while (it != bounds.begin()) {
+        --it;
+        if ((it - bounds.begin()) % 2 == 0)
+            return *it;
+    }
+    return std::string_view::npos;
+}
+
+//! Finds the word of a line containing the character at offset.
+/*!
+ * \return false if that character isn't part of a word. Then start and end are unchanged.
+ */
+bool WordIndex::word_at(const long line, const EditBuffer &text, const std::size_t offset,
+                        std::size_t &start, std::size_t &end)
+{
+    const std::vector<std::size_t> &bounds = scan(line, text);
+    const auto it = std::upper_bound(bounds.begin(), bounds.end(), offset);
+    const std::size_t index = static_cast<std::size_t>(it - bounds.begin());
+    if (index % 2 == 0)
+        return false;
+    start = bounds[index - 1];
+    end = bounds[index];
+    return true;
+}
+
+//! Forgets the words of the lines modified (see EditFile::take_modifications).
+/*!
+ * The lines after those modified are forgotten too if they have moved.
+ */
+void WordIndex::invalidate(const EditDelta &change)
+{
+    if (change.empty())
+        return;
+    const auto first = lines.lower_bound(change.first);
+    const auto last = (change.moved() == 0) ? lines.lower_bound(change.first + change.old_count)
+                                            : lines.end();
+    lines.erase(first, last);
+}
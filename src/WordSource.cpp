@@ -4,274 +4,208 @@
  */
 
 #include <cctype>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
-#include <sstream>
+#include <memory>
+#include <utility>
+#include <vector>
 
 #include <screen/screen.hpp>
 
+#include "Allocations.hpp"
 #include "EditBuffer.hpp"
+#include "MacroTokenizer.hpp"
+#include "MacroTrace.hpp"
+#include "Renderer.hpp"
+#include "UndoLog.hpp"
 #include "WordSource.hpp"
+#include "command_table.hpp"
 #include "keyboard.hpp"
 #include "macro_stack.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
 
-//! Returns true if ch is "whitespace".
-static bool is_white(const int ch)
-{
-    return std::isspace(ch) != 0;
-}
+//= String_Word ===========================================================
 
-//! Returns true if ch is a character that could be part of an identifier name.
-static bool is_name(const int ch)
+bool StringWord::get_word(EditBuffer &word)
 {
-    if (!is_white(ch) && ch != '{' && ch != '#' && ch != '"')
-        return true;
+    MacroTokenizer::Token token;
+    while (tokens.next(token)) {
+        if (token.kind == MacroTokenizer::NAME) {
+            word = EditBuffer(token.text.data(), token.text.size());
+            return true;
+        }
+        parameter_stack.push(ParameterStack::Value::from_text(token.text));
+    }
     return false;
 }
 
-bool WordSource::get_word(EditBuffer &word)
-{
-    int ch;
-    int nested_count;
-    EditBuffer string_contents;
-
-    // Try to loop until the word source is exhausted.
-    while ((ch = get()) != EOF) {
-
-        // REFER TO THE FINITE STATE MACHINE DIAGRAM FOR DOCUMENTATION!!
-        switch (current_state) {
-        case NORMAL:
-            if (is_white(ch))
-                break;
-            if (is_name(ch)) {
-                word.erase();
-                word.append(static_cast<char>(ch));
-                current_state = COLLECT_NAME;
-                break;
-            }
-            switch (ch) {
-            case '#':
-                current_state = COMMENT;
-                break;
-            case '"':
-                string_contents.erase();
-                current_state = STRING;
-                break;
-            case '{':
-                string_contents.erase();
-                nested_count = 1;
-                current_state = BIG_STRING;
-                break;
-            default:
-                // For now, just ignore all other special characters.
-                // TODO: Produce an error or warning message for unexpected characters here?
-                break;
-            }
-            break;
-
-        case COMMENT:
-            if (ch == '\n')
-                current_state = NORMAL;
-            break;
-
-        case COLLECT_NAME:
-            if (is_name(ch))
-                word.append(static_cast<char>(ch));
-            else {
-                unget(ch);
-                current_state = NORMAL;
-                return true; // <== NOTE RETURN HERE!!
-            }
-            break;
-
-        case STRING:
-            switch (ch) {
-            case '\\':
-                current_state = ESC;
-                break;
-            case '"':
-                parameter_stack.push(string_contents);
-                current_state = NORMAL;
-                break;
-            default:
-                string_contents.append(static_cast<char>(ch));
-                break;
-            }
-            break;
-
-        case ESC:
-            string_contents.append(static_cast<char>(ch));
-            current_state = STRING;
-            break;
-
-        case BIG_STRING:
-            if (is_white(ch)) {
-                string_contents.append(' ');
-                current_state = BIG_WHITE;
-                break;
-            }
-            switch (ch) {
-            case '#':
-                string_contents.append(' ');
-                current_state = BIG_COMMENT;
-                break;
-            case '"':
-                string_contents.append(static_cast<char>(ch));
-                current_state = BIG_QUOTE;
-                break;
-            case '{':
-                string_contents.append(static_cast<char>(ch));
-                // The variable nested_count has been initialized.
-                // lint -e{644}
-                nested_count++;
-                break;
-            case '}':
-                nested_count--;
-                if (nested_count == 0) {
-                    parameter_stack.push(string_contents);
-                    current_state = NORMAL;
-                }
-                else {
-                    string_contents.append(static_cast<char>(ch));
-                }
-                break;
-            default:
-                string_contents.append(static_cast<char>(ch));
-                break;
-            }
-            break;
-
-        case BIG_WHITE:
-            if (!is_white(ch)) {
-                unget(ch);
-                current_state = BIG_STRING;
-            }
-            break;
-
-        case BIG_COMMENT:
-            if (ch == '\n')
-                current_state = BIG_STRING;
-            break;
-
-        case BIG_QUOTE:
-            if (ch == '\\') {
-                string_contents.append(static_cast<char>(ch));
-                current_state = BIG_ESC;
-            }
-            else if (ch == '"') {
-                string_contents.append(static_cast<char>(ch));
-                current_state = BIG_STRING;
-            }
-            else {
-                string_contents.append(static_cast<char>(ch));
-            }
-            break;
+//= File_Word =============================================================
 
-        case BIG_ESC:
-            string_contents.append(static_cast<char>(ch));
-            current_state = BIG_QUOTE;
-            break;
-        }
+FileWord::FileWord(const char *const file_name) : StringWord(), file_name(file_name)
+{
+    std::FILE *const input_file = std::fopen(file_name, "r");
+    if (input_file == nullptr) {
+        error_message("Can't open macro file %s for reading", file_name);
+        return;
     }
 
-    // ch == EOF. Let's see what state we're in now. Return true if we are at the end of a valid
-    // word, otherwise return false.
-
-    switch (current_state) {
-    case NORMAL:
-        return false;
-
-    case COMMENT:
-        return false;
+    std::string contents;
+    char buffer[4096];
+    std::size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), input_file)) > 0) {
+        contents.append(buffer, count);
+    }
+    std::fclose(input_file);
+    set_text(std::move(contents));
+}
 
-    case COLLECT_NAME:
-        current_state = NORMAL; // So we work on the next call to get_word( ).
-        return true;
+//= Program_Word ==========================================================
 
-    case STRING:
-        parameter_stack.push(string_contents);
-        return false;
-
-    case ESC:
-        parameter_stack.push(string_contents);
-        return false;
-
-    case BIG_ESC:
-        string_contents.append('"');
-        // lint -fallthrough
-    case BIG_QUOTE:
-        string_contents.append('"');
-        // lint -fallthrough
-    case BIG_STRING:
-    case BIG_WHITE:
-    case BIG_COMMENT:
-        for (int i = nested_count; i > 1; --i)
-            string_contents.append('}');
-        return false;
+/*!
+ * Constants are pushed in a tight loop. Each command is executed here and a null word returned
+ * so that the main loop consults the macro stack again before the next instruction; the
+ * command may have pushed a new word source.
+ */
+bool ProgramWord::get_word(EditBuffer &word)
+{
+    word.erase();
+    while (next_instruction < program->size()) {
+        const MacroProgram::Instruction &current = (*program)[next_instruction++];
+        if (current.opcode == MacroProgram::PUSH_CONSTANT) {
+            parameter_stack.push(program->constant(current.operand));
+        }
+        else {
+            execute_command(static_cast<int>(current.operand));
+            return true;
+        }
     }
-
-    // Should never get here. This line is to keep the compiler quiet.
     return false;
 }
 
-//= String_Word ===========================================================
+//= Trace_Word ============================================================
 
-int StringWord::get()
+TraceWord::TraceWord(const int repeats) : WordSource(), repeats_left(repeats - 1)
 {
-    if (offset >= length)
-        return EOF;
-    return string_buffer[offset++];
+    keyboard_macro.start_replay();
 }
 
-void StringWord::unget(const int ch)
+TraceWord::~TraceWord()
 {
-    string_buffer.replace(static_cast<char>(ch), --offset);
+    keyboard_macro.finish_replay();
 }
 
-//= Keyboard_Word =========================================================
+/*!
+ * Programs that run several commands are handed to a ProgramWord, and a null word returned, so
+ * that each command may push word sources of its own before the macro continues.
+ */
+bool TraceWord::get_word(EditBuffer &word)
+{
+    static const int add_text = find_command("add_text");
 
-int KeyboardWord::get()
+    word.erase();
+    for (;;) {
+        const MacroTrace::Event *const event = keyboard_macro.next_event();
+        if (event == nullptr) {
+            if (repeats_left <= 0)
+                return false;
+            --repeats_left;
+            keyboard_macro.start_replay();
+            continue;
+        }
+
+        // Each keystroke of the macro is undone separately, as it was when recorded.
+        UndoLog::next_command();
+        if (event->kind == MacroTrace::CHARACTER) {
+            const char letter = static_cast<char>(event->operand);
+            parameter_stack.push(EditBuffer(&letter, 1));
+            execute_command(add_text);
+        }
+        else if (event->kind == MacroTrace::DIRECT_PROGRAM) {
+            const MacroProgram &program = *keyboard_macro.program(*event);
+            for (std::size_t i = 0; i < program.size(); ++i) {
+                if (program[i].opcode == MacroProgram::PUSH_CONSTANT)
+                    parameter_stack.push(program.constant(program[i].operand));
+                else
+                    execute_command(static_cast<int>(program[i].operand));
+            }
+        }
+        else {
+            macro_stack.push(new ProgramWord(keyboard_macro.program(*event), "key"));
+            return true;
+        }
+    }
+}
+
+//= Prompt_Word ===========================================================
+
+PromptWord::PromptWord(std::string prompt)
+    : WordSource(), prompt_text(std::move(prompt)), input(prompt_text.c_str()),
+      status(input.begin(false))
 {
-    // This should never happen.
-    error_message("!!! Inside Keyboard_Word::get( ) !!!");
-    return EOF;
 }
 
-void KeyboardWord::unget(int)
+bool PromptWord::ready()
 {
-    // This should never happen.
-    error_message("!!! Inside Keyboard_Word::unget( int ) !!!");
+    return status != Parameter::PENDING || scr::key_available(0);
 }
 
-// Also see below for the definition of Keyboard_Word::get_word( )
+bool PromptWord::get_word(EditBuffer &word)
+{
+    word.erase();
+    if (status == Parameter::PENDING) {
+        status = input.step(scr::key());
+        if (status == Parameter::PENDING)
+            return true;
+    }
+    parameter_stack.push(status == Parameter::ACCEPTED ? input.value().c_str() : "");
+    return false;
+}
 
-//= File_Word =============================================================
+//= Key_Word ==============================================================
 
-FileWord::FileWord(const char *const file_name)
-    : WordSource(), input_file(std::fopen(file_name, "r"))
+//! The user is shown what the macro has done before the key is read.
+bool KeyWord::ready()
 {
-    if (input_file == nullptr)
-        error_message("Can't open macro file %s for reading", file_name);
+    if (!shown) {
+        Renderer::frame();
+        shown = true;
+    }
+    return scr::key_available(0);
 }
 
-FileWord::~FileWord()
+/*!
+ * A printable letter is pushed as itself. The keyboard manager is bypassed, so other keys are
+ * not known by name.
+ */
+bool KeyWord::get_word(EditBuffer &word)
 {
-    if (input_file != nullptr)
-        std::fclose(input_file);
+    word.erase();
+    const int key_code = scr::key();
+    EditBuffer temp;
+    if (key_code < 128 && std::isprint(key_code))
+        temp.append(static_cast<char>(key_code));
+    else
+        temp.append("*** UNKNOWN KEY ****");
+    parameter_stack.push(std::move(temp));
+    return false;
 }
 
-int FileWord::get()
+//= Wait_Word =============================================================
+
+bool WaitWord::ready()
 {
-    if (input_file == nullptr)
-        return EOF;
-    return std::getc(input_file);
+    if (!shown) {
+        Renderer::frame();
+        shown = true;
+    }
+    return finished() || scr::key_available(0);
 }
 
-void FileWord::unget(const int ch)
+bool WaitWord::get_word(EditBuffer &)
 {
-    if (input_file != nullptr)
-        std::ungetc(ch, input_file);
+    return false;
 }
 
 //=========================================================================
@@ -279,17 +213,36 @@ void FileWord::unget(const int ch)
 struct KeyboardAssociation {
     int key_code;
     EditBuffer macro_text;
+    std::shared_ptr<const MacroProgram> program; //!< The compiled macro text, once needed.
+    bool direct; //!< =true if the program's only command is its last instruction.
 
     KeyboardAssociation(const int code, const char *const text)
-        : key_code(code), macro_text(text)
+        : key_code(code), macro_text(text), direct(false)
     {
     }
+
+    void compile();
 };
 
+//! Compiles the macro text and notes whether the program can be run without a word source.
+void KeyboardAssociation::compile()
+{
+    Allocations::Scope tag(Allocations::MACRO);
+    auto new_program = std::make_shared<MacroProgram>();
+    new_program->compile(macro_text.view().data(), macro_text.length());
+    const std::size_t size = new_program->size();
+    direct = true;
+    for (std::size_t i = 0; i + 1 < size; ++i) {
+        if ((*new_program)[i].opcode != MacroProgram::PUSH_CONSTANT)
+            direct = false;
+    }
+    program = std::move(new_program);
+}
+
 // The following table forms the association between keystrokes and macro text. For each
 // keystroke that might be returned from get_key(), there is some default macro text. When a
-// KeyboardWord object gets a keystroke, it searches this table for the associated macro and
-// starts the execution of that macro.
+// KeyboardWord object gets a keystroke, it looks up the associated macro and starts the
+// execution of that macro. The macro text is compiled the first time it is used.
 //
 static KeyboardAssociation keyboard_map[] = {
 
@@ -559,29 +512,29 @@ static KeyboardAssociation keyboard_map[] = {
     KeyboardAssociation(scr::K_F10, "external_command"),
     KeyboardAssociation(scr::K_SF1, "help"), KeyboardAssociation(scr::K_SF2, "editor_info"),
     KeyboardAssociation(scr::K_SF3, "legal_info"),
-    KeyboardAssociation(scr::K_SF4, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_SF5, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_SF6, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_SF7, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_SF8, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_SF9, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_SF4, "frame_info"),
+    KeyboardAssociation(scr::K_SF5, "toggle_column_block"),
+    KeyboardAssociation(scr::K_SF6, "recent_file"),
+    KeyboardAssociation(scr::K_SF7, "split_window"),
+    KeyboardAssociation(scr::K_SF8, "split_window_beside"),
+    KeyboardAssociation(scr::K_SF9, "next_window"),
     KeyboardAssociation(scr::K_SF10, "redirect_to"),
     KeyboardAssociation(scr::K_CF1, "search_first"),
     KeyboardAssociation(scr::K_CF2, "search_next"),
     KeyboardAssociation(scr::K_CF3, "search_replace"),
-    KeyboardAssociation(scr::K_CF4, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_CF4, "search_all"),
     KeyboardAssociation(scr::K_CF5, "set_mark"), KeyboardAssociation(scr::K_CF6, "toggle_mark"),
-    KeyboardAssociation(scr::K_CF7, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_CF8, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_CF9, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_CF7, "search_files"),
+    KeyboardAssociation(scr::K_CF8, "profile_info"),
+    KeyboardAssociation(scr::K_CF9, "close_window"),
     KeyboardAssociation(scr::K_CF10, "redirect_from"),
     KeyboardAssociation(scr::K_AF1, "refresh_file"),
     KeyboardAssociation(scr::K_AF2, "rename_file"),
     KeyboardAssociation(scr::K_AF3, "previous_file"),
     KeyboardAssociation(scr::K_AF4, "kill_file"),
-    KeyboardAssociation(scr::K_AF5, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_AF5, "fuzzy_find"),
     KeyboardAssociation(scr::K_AF6, "copy"),
-    KeyboardAssociation(scr::K_AF7, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_AF7, "memory_info"),
     KeyboardAssociation(scr::K_AF8, "file_insert"),
     KeyboardAssociation(scr::K_AF9, "goto_column"),
     KeyboardAssociation(scr::K_AF10, "external_filter"),
@@ -602,28 +555,28 @@ static KeyboardAssociation keyboard_map[] = {
     KeyboardAssociation(scr::K_ALTA, "add_text"),
     KeyboardAssociation(scr::K_ALTB, "background_color"),
     KeyboardAssociation(scr::K_ALTC, "execute_file"),
-    KeyboardAssociation(scr::K_ALTD, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTD, "clear_cursors"),
     KeyboardAssociation(scr::K_ALTE, "error_message"),
     KeyboardAssociation(scr::K_ALTF, "foreground_color"),
     KeyboardAssociation(scr::K_ALTG, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_ALTH, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTH, "help_search"),
     KeyboardAssociation(scr::K_ALTI, "input"),
-    KeyboardAssociation(scr::K_ALTJ, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTJ, "next_diagnostic"),
     KeyboardAssociation(scr::K_ALTK, "define_key"),
-    KeyboardAssociation(scr::K_ALTL, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTL, "column_cursors"),
     KeyboardAssociation(scr::K_ALTM, "execute_macro"),
-    KeyboardAssociation(scr::K_ALTN, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_ALTO, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_ALTP, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTN, "toggle_cursor"),
+    KeyboardAssociation(scr::K_ALTO, "enclosing_scope"),
+    KeyboardAssociation(scr::K_ALTP, "complete_word"),
     KeyboardAssociation(scr::K_ALTQ, "quit"),
     KeyboardAssociation(scr::K_ALTR, "reformat_paragraph"),
     KeyboardAssociation(scr::K_ALTS, "\"Command Unknown\" error_message"),
     KeyboardAssociation(scr::K_ALTT, "set_tab"),
-    KeyboardAssociation(scr::K_ALTU, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTU, "undo"),
     KeyboardAssociation(scr::K_ALTV, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(scr::K_ALTW, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTW, "reformat_block"),
     KeyboardAssociation(scr::K_ALTX, "exit"), KeyboardAssociation(scr::K_ALTY, "yexit"),
-    KeyboardAssociation(scr::K_ALTZ, "\"Command Unknown\" error_message"),
+    KeyboardAssociation(scr::K_ALTZ, "redo"),
     KeyboardAssociation(scr::K_ALT1, "\"Command Unknown\" error_message"),
     KeyboardAssociation(scr::K_ALT2, "\"Command Unknown\" error_message"),
     KeyboardAssociation(scr::K_ALT3, "\"Command Unknown\" error_message"),
@@ -634,7 +587,9 @@ static KeyboardAssociation keyboard_map[] = {
     KeyboardAssociation(scr::K_ALT8, "\"Command Unknown\" error_message"),
     KeyboardAssociation(scr::K_ALT9, "\"Command Unknown\" error_message"),
     KeyboardAssociation(scr::K_ALT0, "\"Command Unknown\" error_message"),
-    KeyboardAssociation(-1, "")};
+
+    // Pseudo keys...
+    KeyboardAssociation(scr::K_PASTE, "paste_text"), KeyboardAssociation(-1, "")};
 
 // The order of the names in this array must match the keys in the array above.
 //
@@ -688,8 +643,8 @@ static const char *const key_names[] = {
     "K_ALTK",       "K_ALTL",      "K_ALTM",  "K_ALTN",   "K_ALTO",  "K_ALTP",    "K_ALTQ",
     "K_ALTR",       "K_ALTS",      "K_ALTT",  "K_ALTU",   "K_ALTV",  "K_ALTW",    "K_ALTX",
     "K_ALTY",       "K_ALTZ",      "K_ALT1",  "K_ALT2",   "K_ALT3",  "K_ALT4",    "K_ALT5",
-    "K_ALT6",       "K_ALT7",      "K_ALT8",  "K_ALT9",   "K_ALT0",  "K_ALTDASH", "K_ALTEQU",
-    "K_CTRL_PRTSC", nullptr};
+    "K_ALT6",       "K_ALT7",      "K_ALT8",  "K_ALT9",   "K_ALT0",  "K_PASTE",   "K_ALTDASH",
+    "K_ALTEQU",     "K_CTRL_PRTSC", nullptr};
 
 //=========================================================================
 
@@ -706,58 +661,107 @@ void modify_key_association(const char *const key_name, const char *const new_ma
         error_message("The key name \"%s\" is unrecognized", key_name);
     }
 
-    // Otherwise, make the modification.
-    else {
+    // Otherwise, make the modification. Names past the end of the table have no keys.
+    else if (keyboard_map[index].key_code != -1) {
         keyboard_map[index].macro_text.erase();
         keyboard_map[index].macro_text.append(new_macro_text);
+        keyboard_map[index].compile();
     }
 }
 
+int key_code(const char *const key_name)
+{
+    for (int index = 0; keyboard_map[index].key_code != -1; index++)
+        if (std::strcmp(key_name, key_names[index]) == 0)
+            return keyboard_map[index].key_code;
+    return -1;
+}
+
+const char *key_name(const int key_code)
+{
+    for (int index = 0; keyboard_map[index].key_code != -1; index++)
+        if (keyboard_map[index].key_code == key_code)
+            return key_names[index];
+    return nullptr;
+}
+
+//! Returns the association for the given key code, or nullptr if there isn't one.
+static KeyboardAssociation *find_association(const int key_code)
+{
+    // Maps key codes to their positions in keyboard_map (-1 if the code is not there).
+    static std::vector<int> positions;
+    if (positions.empty()) {
+        positions.assign(scr::XF + 256, -1);
+        for (int i = 0; keyboard_map[i].key_code != -1; ++i) {
+            positions[static_cast<std::size_t>(keyboard_map[i].key_code)] = i;
+        }
+    }
+
+    if (key_code < 0 || static_cast<std::size_t>(key_code) >= positions.size() ||
+        positions[static_cast<std::size_t>(key_code)] == -1)
+        return nullptr;
+    return &keyboard_map[positions[static_cast<std::size_t>(key_code)]];
+}
+
+/*!
+ * Keystrokes are dispatched without handling any text. A quoted keystroke is added to the file
+ * directly. Otherwise the compiled macro of the key is run: constants are pushed and, in the
+ * usual case of a single command at the end, the command is executed here. Macros that run
+ * several commands are handed to a ProgramWord so that each command can push word sources of
+ * its own before the next one runs.
+ */
 bool KeyboardWord::get_word(EditBuffer &word)
 {
-    std::string words;
+    static const int add_text = find_command("add_text");
 
-    // Return a null word to force the main loop to fetch from the new object.
+    // Return a null word to force the main loop to fetch from the next object.
     word.erase();
 
     // Get a keystroke from the KeyHandler. Note that the KeyHandler automatically deals with
     // repeat sequences, keyboard macros, and the like. Also get_key( ) will update the screen.
     const int ch = KeyHandler::get_key();
+    if (ch == KeyHandler::REPLAY_MACRO) {
+        macro_stack.push(new TraceWord(KeyHandler::replay_count()));
+        return true;
+    }
 
-    // If this is a quoted keystroke, compose a special macro right here. Do NOT search the
-    // keyboard mapping table.
+    // Everything this keystroke does is undone together.
+    UndoLog::next_command();
+
+    // If this is a quoted keystroke, add it right here. Do NOT search the keyboard mapping
+    // table.
     if (ch & 0x8000) {
-        std::ostringstream formatter;
-        formatter << '"' << static_cast<char>(ch) << "\" ADD_TEXT" << std::ends;
-        words = formatter.str();
-        // TODO: How does Open Watcom deallocate the buffer inside the ostrstream object?
-        // formatter.freeze( false );
+        const char letter = static_cast<char>(ch);
+        keyboard_macro.record_character(letter);
+        parameter_stack.push(EditBuffer(&letter, 1));
+        execute_command(add_text);
+        return true;
     }
 
-    else {
-        // Search the keyboard mapping table. See if we can locate this key.
-        const KeyboardAssociation *search = keyboard_map;
-        while (search->key_code != -1) {
-            if (search->key_code == ch)
-                break;
-            search++;
-        }
+    // If we can't find this key, complain.
+    KeyboardAssociation *const association = find_association(ch);
+    if (association == nullptr) {
+        error_message("Unknown Keystroke");
+        return true;
+        // Let the caller think this worked, so they won't pop the stack!
+    }
 
-        // If we didn't find it, complain.
-        if (search->key_code == -1) {
-            error_message("Unknown Keystroke");
-            return true;
-            // Let the caller think this worked, so they won't pop the stack!
+    if (association->program == nullptr)
+        association->compile();
+    const MacroProgram &program = *association->program;
+    keyboard_macro.record_program(association->program, association->direct);
+
+    if (association->direct) {
+        for (std::size_t i = 0; i < program.size(); ++i) {
+            if (program[i].opcode == MacroProgram::PUSH_CONSTANT)
+                parameter_stack.push(program.constant(program[i].operand));
+            else
+                execute_command(static_cast<int>(program[i].operand));
         }
-
-        words = search->macro_text.to_string();
     }
-
-    // Now let's create a new StringWord containing the macro.
-    StringWord *const new_source = new StringWord(words.c_str());
-
-    // Push it onto the word stack for later.
-    macro_stack.push(new_source);
+    else {
+        macro_stack.push(new ProgramWord(association->program, "key"));
+    }
 
     // Don't let this object get popped from the stack!
     return true;
@@ -0,0 +1,283 @@
+/*! \file    WrapIndex.cpp
+ *  \brief   Implementation of class WrapIndex
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <algorithm>
+#include <string_view>
+
+#include "EditBuffer.hpp"
+#include "EditList.hpp"
+#include "Utf8.hpp"
+#include "WrapIndex.hpp"
+
+namespace {
+
+    // Lines are examined this many bytes at a time (see EditBuffer::view).
+    constexpr std::size_t scan_size = 4096;
+
+} // namespace
+
+//! Breaks a line into rows. The starts of the rows after the first are put in result.
+/*!
+ * Offsets inside multi-byte characters are never chosen since continuation bytes are skipped.
+ * A character wider than the window (a tab in a very narrow window) is left on a row alone.
+ */
+void WrapIndex::wrap_line(const EditBuffer &line, std::vector<Break> &result) const
+{
+    result.clear();
+    std::size_t column = 0;   // The column of the next character.
+    Break start{0, 0};        // The start of the row being filled.
+    Break after_space{0, 0};  // The character after the last space on that row, if any.
+    const std::size_t length = line.length();
+    for (std::size_t base = 0; base < length; base += scan_size) {
+        const std::string_view text = line.view(base, scan_size);
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            const char ch = text[i];
+            if (Utf8::is_continuation(ch))
+                continue;
+            const std::size_t end = Utf8::advance(column, ch, tab);
+            if (end - start.column > width && column > start.column) {
+                start = (after_space.column > start.column) ? after_space
+                                                            : Break{base + i, column};
+                result.push_back(start);
+            }
+            column = end;
+            if (ch == ' ')
+                after_space = Break{base + i + 1, column};
+        }
+    }
+}
+
+//! Adds count rows (which may be negative) to a line in the tree.
+void WrapIndex::add_rows(const long line, const long count)
+{
+    const long size = static_cast<long>(tree.size());
+    for (long i = line + 1; i < size; i += i & -i)
+        tree[i] += count;
+}
+
+//! Hides a line or shows it, keeping the tree up to date.
+void WrapIndex::set_hidden(const long line, const bool flag)
+{
+    Line &entry = lines[line];
+    if (entry.hidden == flag)
+        return;
+    entry.hidden = flag;
+    hidden_count += flag ? 1 : -1;
+    if (!recount) {
+        const long count = static_cast<long>(entry.breaks.size()) + 1;
+        add_rows(line, flag ? -count : count);
+    }
+}
+
+//! Builds the tree from the numbers of rows of the lines, in linear time.
+void WrapIndex::build_tree()
+{
+    const long size = static_cast<long>(lines.size());
+    tree.assign(static_cast<std::size_t>(size) + 1, 0L);
+    for (long i = 1; i <= size; ++i) {
+        tree[i] += rows(i - 1);
+        const long parent = i + (i & -i);
+        if (parent <= size)
+            tree[parent] += tree[i];
+    }
+    recount = false;
+}
+
+//! Forgets every line, including the folds. Nothing is kept until the next update.
+void WrapIndex::reset()
+{
+    ready = false;
+    lines.clear();
+    tree.clear();
+    hidden_count = 0;
+    stale_first = stale_end = 0;
+    recount = false;
+}
+
+//! Notes that lines were modified (see EditFile::take_modifications).
+/*!
+ * The lines that replaced the old ones are wrapped again by the next update. The breaks of the
+ * unmodified lines are kept, moved to the lines' new positions, and so are the folds. The lines
+ * removed are no longer hidden, and the lines inserted are not.
+ */
+void WrapIndex::invalidate(const EditDelta &change)
+{
+    if (!ready)
+        return;
+    const long first_line = change.first;
+    const long old_end = first_line + change.old_count;
+    const long new_end = first_line + change.new_count;
+    if (old_end > static_cast<long>(lines.size())) {
+        // The index doesn't match the lines the change was made to.
+        reset();
+        return;
+    }
+
+    // Lines still waiting to be wrapped move with the lines around them.
+    if (stale_first < stale_end) {
+        long moved_end = stale_end;
+        if (stale_end > old_end)
+            moved_end += new_end - old_end;
+        else if (stale_end > first_line)
+            moved_end = new_end;
+        stale_first = std::min(stale_first, first_line);
+        stale_end = std::max(moved_end, new_end);
+    }
+    else {
+        stale_first = first_line;
+        stale_end = new_end;
+    }
+
+    if (new_end - first_line != old_end - first_line) {
+        const auto removed = lines.begin() + first_line;
+        hidden_count -= std::count_if(removed, lines.begin() + old_end,
+                                      [](const Line &line) { return line.hidden; });
+        lines.erase(removed, lines.begin() + old_end);
+        lines.insert(lines.begin() + first_line,
+                     static_cast<std::size_t>(new_end - first_line), Line());
+        recount = true;
+    }
+}
+
+//! Wraps the lines that need it to the given width.
+/*!
+ * \param data The file's lines. The current point is moved.
+ * \param new_width The number of columns in a row, or zero if lines are not wrapped.
+ * \param new_tab The distance between tab stops.
+ * \throws std::bad_alloc if insufficient memory.
+ */
+void WrapIndex::update(EditList &data, const unsigned new_width, const unsigned new_tab)
+{
+    const long size = data.size();
+    const bool fresh = !ready || static_cast<long>(lines.size()) != size;
+    if (fresh) {
+        reset();
+        lines.resize(static_cast<std::size_t>(size));
+        ready = true;
+    }
+    if (fresh || new_width != width || new_tab != tab) {
+        width = new_width;
+        tab = new_tab;
+        stale_first = 0;
+        stale_end = size;
+        recount = true;
+    }
+
+    if (stale_first < stale_end) {
+        if (width != 0)
+            data.jump_to(stale_first);
+        for (long i = stale_first; i < stale_end; ++i) {
+            const long old_rows = rows(i);
+            if (width == 0)
+                lines[i].breaks.clear();
+            else {
+                const EditBuffer *const line = data.next();
+                if (line == nullptr)
+                    break;
+                wrap_line(*line, lines[i].breaks);
+            }
+            if (!recount && rows(i) != old_rows)
+                add_rows(i, static_cast<long>(rows(i)) - old_rows);
+        }
+        stale_first = stale_end = 0;
+    }
+    if (recount)
+        build_tree();
+}
+
+//! Hides the lines [first_line, last_line] in a fold. The index must be up to date.
+void WrapIndex::hide(long first_line, long last_line)
+{
+    first_line = std::max(first_line, 0L);
+    last_line = std::min(last_line, static_cast<long>(lines.size()) - 1);
+    for (long i = first_line; i <= last_line; ++i)
+        set_hidden(i, true);
+}
+
+//! Shows the lines folded after a header. Returns the number of lines shown.
+long WrapIndex::unfold(const long header)
+{
+    if (!folded_after(header))
+        return 0;
+    long line = header + 1;
+    for (; hidden(line); ++line)
+        set_hidden(line, false);
+    return line - header - 1;
+}
+
+//! Shows the lines of the fold that hides a line. Returns the number of lines shown.
+long WrapIndex::reveal(const long line)
+{
+    if (!hidden(line))
+        return 0;
+    long header = line;
+    while (hidden(header))
+        --header;
+    return unfold(header);
+}
+
+//! Returns the row on which a line starts.
+/*!
+ * A hidden line occupies no rows, so the row is that of the next line shown.
+ */
+long WrapIndex::row_of(const long line) const
+{
+    const long size = static_cast<long>(lines.size());
+    long row = std::max(line - size, 0L);
+    for (long i = std::min(line, size); i > 0; i -= i & -i)
+        row += tree[i];
+    return row;
+}
+
+//! Returns the line shown on a row. Hidden lines are never returned.
+long WrapIndex::line_at(long row) const
+{
+    // Descend the tree, skipping the lines that end before the row.
+    const long size = static_cast<long>(lines.size());
+    long line = 0;
+    long step = 1;
+    while (step * 2 <= size)
+        step *= 2;
+    for (; step > 0; step /= 2) {
+        if (line + step <= size && tree[line + step] <= row) {
+            line += step;
+            row -= tree[line];
+        }
+    }
+    return (line < size) ? line : size + row;
+}
+
+//! Returns the number of rows a line occupies (zero if it is hidden).
+unsigned WrapIndex::rows(const long line) const
+{
+    if (line < 0 || line >= static_cast<long>(lines.size()))
+        return 1;
+    if (lines[line].hidden)
+        return 0;
+    return static_cast<unsigned>(lines[line].breaks.size()) + 1;
+}
+
+//! Returns where a row of a line starts. Rows are numbered from zero within the line.
+WrapIndex::Break WrapIndex::row_start(const long line, const unsigned row) const
+{
+    if (row == 0 || line < 0 || line >= static_cast<long>(lines.size()))
+        return Break{0, 0};
+    const std::vector<Break> &starts = lines[line].breaks;
+    if (starts.empty())
+        return Break{0, 0};
+    return starts[std::min<std::size_t>(row, starts.size()) - 1];
+}
+
+//! Returns the row of a line that shows a column. Columns past the end are on the last row.
+unsigned WrapIndex::row_containing(const long line, const std::size_t column) const
+{
+    if (line < 0 || line >= static_cast<long>(lines.size()))
+        return 0;
+    const std::vector<Break> &starts = lines[line].breaks;
+    const auto after = std::upper_bound(
+        starts.begin(), starts.end(), column,
+        [](const std::size_t wanted, const Break &start) { return wanted < start.column; });
+    return static_cast<unsigned>(after - starts.begin());
+}
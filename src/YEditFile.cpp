@@ -8,39 +8,125 @@
  * mostly with the display function.
  */
 
+#include <algorithm>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <screen/screen.hpp>
 #include <screen/scrtools.hpp>
 
 #include "EditBuffer.hpp"
+#include "FieldIndex.hpp"
 #include "FileList.hpp"
+#include "HexImage.hpp"
+#include "RemoteFile.hpp"
+#include "Spelling.hpp"
+#include "Utf8.hpp"
 #include "YEditFile.hpp"
 #include "support.hpp"
 #include "yfile.hpp"
 
+#define TOKEN_LOOKAHEAD 64 // Bytes scanned past a window so the tokens at its edge are whole.
+#define MATCH_MARGIN 256   // Bytes searched beyond a window so matches at its edges are found.
+
+unsigned long YEditFile::display_epoch = 0;
+const SearchPattern *YEditFile::highlighted = nullptr;
+bool YEditFile::spelling = false;
+
+//! Returns the attribute used to show a token in a file displayed with the given color.
+static int token_color(const Highlighter::Token token, const int color)
+{
+    const int background = color & 0x70;
+    int result = color;
+    switch (token) {
+    case Highlighter::PLAIN:
+        break;
+    case Highlighter::KEYWORD:
+        result = color | scr::BRIGHT;
+        break;
+    case Highlighter::COMMENT:
+        result = background | scr::CYAN;
+        break;
+    case Highlighter::STRING:
+        result = background | scr::GREEN;
+        break;
+    case Highlighter::NUMBER:
+        result = background | scr::MAGENTA;
+        break;
+    case Highlighter::DIRECTIVE:
+        result = background | scr::BROWN;
+        break;
+    }
+    return scr::convert_attribute(result);
+}
+
+//! Returns the attribute used to mark text that a language server reports a problem with.
+static int diagnostic_color(const Diagnostics::Severity severity)
+{
+    switch (severity) {
+    case Diagnostics::ERROR:
+        return scr::WHITE | scr::BRIGHT | scr::REV_RED;
+    case Diagnostics::WARNING:
+        return scr::BLACK | scr::REV_BROWN;
+    default:
+        return scr::WHITE | scr::REV_BLUE;
+    }
+}
+
+//! Returns what is shown in the screen cell for the character at offset in text.
+/*!
+ * A screen cell holds a single byte so characters outside of ASCII, which occupy one column
+ * like any other, are shown as a question mark. Their bytes are not changed. Each column of a
+ * tab is shown as a space.
+ */
+static char cell_character(const std::string_view text, const std::size_t offset)
+{
+    const char ch = text[offset];
+    if (ch == '\t')
+        return ' ';
+    return (ch & 0x80) ? '?' : ch;
+}
+
 /*=============================================*/
 /*           Public Member Functions           */
 /*=============================================*/
 
 /*!
- * This function constructs the generic YEditFile. It sets some attributes and sets up the
- * screen image so that the first call to Display() will show a border and name. Finally, it
- * loads the file for the first time.
+ * This function constructs the generic YEditFile. It sets some attributes and then loads the
+ * file for the first time.
  */
 YEditFile::YEditFile(const char *name_of_file, int tab_distance, int file_color)
-    : CharacterEditFile(tab_distance), file_name(name_of_file), color(file_color)
+    : CharacterEditFile(tab_distance), file_name(name_of_file), color(file_color),
+      read_only(false)
 {
     // Adjust the screen color if a monochrome screen is in use.
     if (scr::is_monochrome())
         color = scr::BRIGHT | scr::WHITE | scr::REV_BLACK;
 
-    // Load the file if it file exists. If does not exist, just stay blank.
-    std::FILE *file_to_edit;
-    if ((file_to_edit = std::fopen(file_name.c_str(), "r")) != nullptr) {
+    // Load the file if it file exists. If does not exist, just stay blank. The connection
+    // used to look for a remote file is kept for the load.
+    bool exists = false;
+    if (RemoteFile::is_remote(file_name.c_str())) {
+        std::unique_ptr<RemoteFile> remote = RemoteFile::connect(file_name.c_str());
+        if (!remote)
+            error_message("Can't reach the host of %s", file_name.c_str());
+        else
+            exists = remote->exists();
+        RemoteFile::keep(std::move(remote));
+    }
+    else if (HexImage::is_hex(file_name.c_str()))
+        exists = true;
+    else if (std::FILE *const file_to_edit = std::fopen(file_name.c_str(), "r")) {
         std::fclose(file_to_edit);
+        exists = true;
+    }
+    if (exists) {
         load(file_name.c_str());          // Read the file.
         set_timestamp(file_name.c_str()); // Read the time stamp for the first load.
     }
@@ -49,6 +135,8 @@ YEditFile::YEditFile(const char *name_of_file, int tab_distance, int file_color)
     // them).
     //
     is_changed = false;
+    undo_log.clear();
+    open_history(file_name.c_str());
 }
 
 /*!
@@ -57,7 +145,6 @@ YEditFile::YEditFile(const char *name_of_file, int tab_distance, int file_color)
  */
 YEditFile::~YEditFile()
 {
-    return;
 }
 
 //! This function allows clients to set the screen color anyway they want.
@@ -79,33 +166,27 @@ void YEditFile::set_color(int new_column)
  */
 void YEditFile::set_attributes()
 {
-    // First, search the file descriptor list for 'this' file.
-    List<FileDescriptor>::Iterator stepper(descriptor_list);
-    FileDescriptor *next;
-    while ((next = stepper()) != nullptr) {
-
-        // If we've found it...
-        if (my_stricmp(file_name.c_str(), next->name.to_string().c_str()) == 0) {
-
-            // Set all the attributes.
-            block = static_cast<bool>(next->block_flag);
-            anchor = next->block_line;
-            set_color(next->color_attribute);
-            CP().jump_to_column(next->cursor_column);
-            CP().jump_to_line(next->cursor_line);
-            set_insert((next->insert_flag == true) ? INSERT : REPLACE);
-            set_tab(next->tab_setting);
-            CP().adjust_window_line(int(next->cursor_line - next->window_line));
-            CP().adjust_window_column(int(next->cursor_column - next->window_column));
-
-            // Now delete the descriptor from the list. During normal operation, the descriptor
-            // list only stores information on files that are deleted. Don't loop back!
-            //
-            descriptor_list.previous();
-            descriptor_list.erase();
-            break;
-        }
-    }
+    // First, look up 'this' file in the file descriptor list.
+    FileDescriptor *next = descriptor_list.find(file_name.c_str());
+    if (next == nullptr)
+        return;
+
+    // Set all the attributes.
+    block = static_cast<bool>(next->block_flag);
+    if (block)
+        set_anchor(next->block_line);
+    set_color(next->color_attribute);
+    CP().jump_to_column(next->cursor_column);
+    CP().jump_to_line(next->cursor_line);
+    set_insert((next->insert_flag == true) ? INSERT : REPLACE);
+    set_tab(next->tab_setting);
+    CP().adjust_window_line(int(next->cursor_line - next->window_line));
+    CP().adjust_window_column(int(next->cursor_column - next->window_column));
+
+    // Now delete the descriptor from the list. During normal operation, the descriptor list
+    // only stores information on files that are deleted.
+    //
+    descriptor_list.erase(file_name.c_str());
 }
 
 /*!
@@ -119,7 +200,7 @@ void YEditFile::set_descriptor(FileDescriptor &new_descriptor)
 {
     new_descriptor.active_flag = true;
     new_descriptor.block_flag = (block == true) ? true : false;
-    new_descriptor.block_line = anchor;
+    new_descriptor.block_line = anchor_line();
     new_descriptor.color_attribute = color;
     new_descriptor.cursor_column = CP().cursor_column();
     new_descriptor.cursor_line = CP().cursor_line();
@@ -149,6 +230,11 @@ bool YEditFile::previous_procedure()
     return false;
 }
 
+bool YEditFile::procedure_line(std::string_view, ProcedureIndex &)
+{
+    return false;
+}
+
 bool YEditFile::extra_indent()
 {
     return false;
@@ -159,157 +245,1088 @@ bool YEditFile::insert_char(char letter)
     return CharacterEditFile::insert_char(letter);
 }
 
+//! Returns the index of the fields of a table that are shown aligned, or nullptr if none are.
+/*!
+ * Lines that are wrapped or folded are not aligned.
+ */
+FieldIndex *YEditFile::aligned_fields()
+{
+    FieldIndex *const table = fields();
+    if (table == nullptr || !table->is_aligned() || moves_by_rows())
+        return nullptr;
+    return table;
+}
+
+//! Returns the column where the cursor is shown.
+unsigned YEditFile::shown_column(const FilePosition &position)
+{
+    FieldIndex *const table = aligned_fields();
+    const EditBuffer *const text =
+        (table != nullptr) ? line_at(position.cursor_line()) : nullptr;
+    if (text == nullptr)
+        return position.cursor_column();
+    return table->shown_column(position.cursor_line(), *text, position.cursor_column(),
+                               tab_stop);
+}
+
+bool YEditFile::next_field()
+{
+    return move_to_field(true);
+}
+
+bool YEditFile::previous_field()
+{
+    return move_to_field(false);
+}
+
+//! Moves the cursor to the start of the next field, or the previous one, on its line.
+bool YEditFile::move_to_field(const bool forward)
+{
+    FieldIndex *const table = fields();
+    if (table == nullptr) {
+        error_message("Not a table");
+        return false;
+    }
+    const long line = CP().cursor_line();
+    const EditBuffer *const text = line_at(line);
+    if (text == nullptr)
+        return false;
+
+    const std::vector<std::size_t> &starts = table->starts(line, *text, tab_stop);
+    const std::size_t offset = text->offset_of(CP().cursor_column(), tab_stop);
+    std::size_t target;
+    if (forward) {
+        const auto next = std::upper_bound(starts.begin(), starts.end(), offset);
+        if (next == starts.end())
+            return false;
+        target = *next;
+    }
+    else {
+        const auto next = std::lower_bound(starts.begin(), starts.end(), offset);
+        if (next == starts.begin())
+            return false;
+        target = *(next - 1);
+    }
+    CP().jump_to_column(static_cast<unsigned>(text->column_of(target, tab_stop)));
+    return true;
+}
+
+//! Returns the index of the words, having forgotten the lines modified since it was last used.
+WordIndex &YEditFile::word_index()
+{
+    words.invalidate(take_modifications(WORDS));
+    return words;
+}
+
+/*!
+ * The cursor moves to the start of the next word on its line, or to the end of the line if
+ * there is none. From the end of the line (or beyond it) the cursor moves to the first word of
+ * the next line, or to the start of that line if it has no words.
+ */
+bool YEditFile::next_word()
+{
+    const long line = CP().cursor_line();
+    const EditBuffer *const text = line_at(line);
+    if (text == nullptr)
+        return true;
+
+    const std::size_t offset = text->offset_of(CP().cursor_column(), tab_stop);
+    if (offset < text->length()) {
+        std::size_t start = word_index().start_from(line, *text, offset + 1);
+        if (start == std::string_view::npos)
+            start = text->length();
+        CP().jump_to_column(static_cast<unsigned>(text->column_of(start, tab_stop)));
+        return true;
+    }
+
+    const EditBuffer *const next = line_at(line + 1);
+    if (next == nullptr)
+        return true;
+    std::size_t start = word_index().start_from(line + 1, *next, 0);
+    if (start == std::string_view::npos)
+        start = 0;
+    CP().jump_to_line(line + 1);
+    CP().jump_to_column(static_cast<unsigned>(next->column_of(start, tab_stop)));
+    return true;
+}
+
+/*!
+ * The cursor moves to the start of the word it is on, or of the word before it on its line, or
+ * to the start of the line if there is none. From the start of the line the cursor moves to
+ * the last word of the line before, or to the start of that line if it has no words. Beyond
+ * the end of its line the cursor moves to the end.
+ */
+bool YEditFile::previous_word()
+{
+    const long line = CP().cursor_line();
+    const EditBuffer *const text = line_at(line);
+    if (text == nullptr || CP().cursor_column() > text->columns(tab_stop)) {
+        end();
+        return true;
+    }
+
+    const std::size_t offset = text->offset_of(CP().cursor_column(), tab_stop);
+    if (offset > 0) {
+        std::size_t start = word_index().start_before(line, *text, offset);
+        if (start == std::string_view::npos)
+            start = 0;
+        CP().jump_to_column(static_cast<unsigned>(text->column_of(start, tab_stop)));
+        return true;
+    }
+
+    const EditBuffer *const previous = (line > 0) ? line_at(line - 1) : nullptr;
+    if (previous == nullptr)
+        return true;
+    std::size_t start = word_index().start_before(line - 1, *previous, previous->length());
+    if (start == std::string_view::npos)
+        start = 0;
+    CP().jump_to_line(line - 1);
+    CP().jump_to_column(static_cast<unsigned>(previous->column_of(start, tab_stop)));
+    return true;
+}
+
 /*!
- * This function displays the contents of an YEditFile on the screen. Everything is updated.
- * including the border, etc.
+ * The text from the cursor to where next_word would move it is deleted. At the end of the line
+ * (or beyond it) the next line is joined to it instead, as delete_char does.
  */
-void YEditFile::display()
+bool YEditFile::delete_word()
+{
+    const long line = CP().cursor_line();
+    const EditBuffer *const text = line_at(line);
+    const std::size_t offset =
+        (text != nullptr) ? text->offset_of(CP().cursor_column(), tab_stop) : 0;
+    if (text == nullptr || offset >= text->length())
+        return delete_char();
+
+    std::size_t stop = word_index().start_from(line, *text, offset + 1);
+    if (stop == std::string_view::npos)
+        stop = text->length();
+    const std::string_view view = text->view();
+    std::size_t count = 0;
+    for (std::size_t at = offset; at < stop; at = Utf8::next(view, at))
+        ++count;
+    while (count-- > 0) {
+        if (!delete_char())
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * The word under the cursor becomes a column block, with the cursor on its last character. Any
+ * block already marked is turned off first.
+ */
+bool YEditFile::select_word()
+{
+    const long line = CP().cursor_line();
+    const EditBuffer *const text = line_at(line);
+    std::size_t start, stop;
+    if (text == nullptr ||
+        !word_index().word_at(line, *text, text->offset_of(CP().cursor_column(), tab_stop),
+                              start, stop)) {
+        error_message("Not on a word");
+        return false;
+    }
+
+    if (get_block_state())
+        toggle_block();
+    CP().jump_to_column(static_cast<unsigned>(text->column_of(start, tab_stop)));
+    toggle_column_block();
+    const std::size_t last = Utf8::previous(text->view(), stop);
+    CP().jump_to_column(static_cast<unsigned>(text->column_of(last, tab_stop)));
+    return true;
+}
+
+//! Passes the lines modified since the last call to the information derived from them.
+void YEditFile::collect_changes()
+{
+    const EditDelta change = take_modifications(DISPLAY);
+    if (!moves_by_rows())
+        wraps.reset();
+    if (change.empty())
+        return;
+    outline.invalidate(change.first);
+    highlighter.invalidate(change);
+    if (moves_by_rows())
+        wraps.invalidate(change);
+    matches.invalidate(change);
+    misspelled.invalidate(change);
+}
+
+void YEditFile::toggle_wrap()
+{
+    wrapping = !wrapping;
+    if (!moves_by_rows())
+        wraps.reset();
+    CP().set_window(CP().window_line(), 0U);
+    invalidate_display();
+}
+
+//! Brings the rows of the lines up to date for a window of the given width.
+void YEditFile::update_rows(const unsigned width)
+{
+    collect_changes();
+    wraps.update(file_data, wrapping ? width : 0U, tab_stop);
+}
+
+/*!
+ * The window keeps its top row unless the cursor is above it or below the bottom row, in which
+ * case it moves just far enough to show the cursor. A cursor that was moved into a fold (by a
+ * search, say) opens the fold. Files whose lines are neither wrapped nor folded are left alone.
+ */
+void YEditFile::align_window(FilePosition &position)
+{
+    // When a table's fields are aligned the window is moved sideways to the column shown.
+    if (aligned_fields() != nullptr) {
+        const unsigned column = shown_column(position);
+        const unsigned width = position.window_width();
+        if (column < position.window_column())
+            position.set_window_column(column);
+        else if (column >= position.window_column() + width)
+            position.set_window_column(column - width + 1);
+        return;
+    }
+    if (!moves_by_rows())
+        return;
+    update_rows(position.window_width());
+    const long line = position.cursor_line();
+    if (wraps.reveal(line) != 0)
+        invalidate_display();
+
+    const long cursor =
+        wraps.row_of(line) + wraps.row_containing(line, position.cursor_column());
+    const long first = position.window_line();
+    const unsigned first_rows = wraps.rows(first);
+    long top = wraps.row_of(first);
+    if (first_rows != 0)
+        top += std::min(position.window_row(), first_rows - 1);
+    if (cursor < top)
+        top = cursor;
+    else if (cursor >= top + position.window_height())
+        top = cursor - position.window_height() + 1;
+    const long top_line = wraps.line_at(top);
+    position.set_window(top_line, static_cast<unsigned>(top - wraps.row_of(top_line)));
+}
+
+/*!
+ * When lines are wrapped the column may be past the right edge on the last row of a line. The
+ * window must have been aligned (see align_window).
+ */
+void YEditFile::cursor_cell(const FilePosition &position, long &row, long &column)
+{
+    const long line = position.cursor_line();
+    if (!moves_by_rows()) {
+        row = line - position.window_line();
+        column = static_cast<long>(shown_column(position)) - position.window_column();
+        return;
+    }
+    const unsigned line_row = wraps.row_containing(line, position.cursor_column());
+    row = wraps.row_of(line) + line_row - wraps.row_of(position.window_line()) -
+          position.window_row();
+    if (!wrapping) {
+        column = static_cast<long>(position.cursor_column()) - position.window_column();
+        return;
+    }
+    const std::size_t start = wraps.row_start(line, line_row).column;
+    column = std::min(static_cast<long>(position.cursor_column() - start),
+                      static_cast<long>(position.window_width()) - 1);
+}
+
+/*!
+ * The rows of folded lines are skipped. The cursor keeps its distance from the start of the row
+ * if the row it reaches is long enough, as it keeps its column when moving between lines that
+ * are not wrapped. Paging moves the window by the same number of rows so the cursor stays at
+ * the same place in the window.
+ *
+ * \param count The number of rows to move.
+ * \param page True if the window moves with the cursor.
+ */
+void YEditFile::move_rows(const long count, const bool page)
+{
+    FilePosition &position = CP();
+    align_window(position);
+    const long line = position.cursor_line();
+    const unsigned line_row = wraps.row_containing(line, position.cursor_column());
+    const std::size_t indent =
+        position.cursor_column() - wraps.row_start(line, line_row).column;
+    const long target = std::max(wraps.row_of(line) + line_row + count, 0L);
+    const long new_line = wraps.line_at(target);
+    const unsigned new_row = static_cast<unsigned>(target - wraps.row_of(new_line));
+    std::size_t column = wraps.row_start(new_line, new_row).column + indent;
+    if (new_row + 1 < wraps.rows(new_line))
+        column = std::min(column, wraps.row_start(new_line, new_row + 1).column - 1);
+
+    long top = wraps.row_of(position.window_line()) + position.window_row();
+    if (page)
+        top = std::max(top + (target - wraps.row_of(line) - line_row), 0L);
+    position.jump_to_line(new_line);
+    position.jump_to_column(static_cast<unsigned>(column));
+    const long top_line = wraps.line_at(top);
+    position.set_window(top_line, static_cast<unsigned>(top - wraps.row_of(top_line)));
+    align_window(position);
+}
+
+//! Returns the line shown for a fold of the procedure or scope whose first line is given.
+/*!
+ * A brace alone on that line is folded with the body so the line above it, which usually names
+ * the procedure, heads the fold.
+ */
+long YEditFile::fold_header(const long head)
+{
+    const EditBuffer *const text = (head > 0L) ? line_at(head) : nullptr;
+    if (text == nullptr)
+        return head;
+    const std::string_view view = text->view();
+    const std::size_t brace = view.find_first_not_of(" \t");
+    if (brace == std::string_view::npos || view[brace] != '{' ||
+        view.find_first_not_of(" \t", brace + 1) != std::string_view::npos)
+        return head;
+    const EditBuffer *const above = line_at(head - 1);
+    return (above != nullptr && above->length() != 0) ? head - 1 : head;
+}
+
+//! Returns the line that heads the procedure or scope that a fold of the given line hides.
+/*!
+ * The scope is the one the line opens, or the one opened by the procedure the line heads, or
+ * else the innermost scope enclosing the line. The fold hides everything after the header
+ * through the closing line of the scope.
+ *
+ * \param line The line to fold.
+ * \param last [out] The last line to hide.
+ * \return The header, or -1 if there is no closed scope to fold.
+ */
+long YEditFile::fold_range(const long line, long &last)
+{
+    long probe = opens_scope(line) ? line + 1 : line;
+    const ProcedureIndex::Procedure *const here = outline.headed_at(line);
+    if (here != nullptr)
+        probe = here->start + 1;
+    index_through(probe);
+    const ProcedureIndex::Scope *const scope = outline.enclosing(probe);
+    if (scope == nullptr || scope->close < 0L)
+        return -1L;
+
+    long header = scope->open;
+    const ProcedureIndex::Procedure *const procedure = outline.preceding(header + 1);
+    if (procedure != nullptr && procedure->start == header)
+        header = procedure->head;
+    header = fold_header(header);
+    last = scope->close;
+    return (last > header) ? header : -1L;
+}
+
+//! Folds the scope around the cursor, or opens the fold headed by the cursor line.
+bool YEditFile::toggle_fold()
+{
+    if (!has_procedures()) {
+        error_message("Can't find scopes in this file type");
+        return false;
+    }
+    update_rows(current_point.window_width());
+    const long line = current_point.cursor_line();
+    if (wraps.unfold(line) == 0) {
+        long last;
+        const long header = fold_range(line, last);
+        if (header < 0L) {
+            info_message("Not found");
+            return true;
+        }
+        update_rows(current_point.window_width());
+        wraps.hide(header + 1, last);
+        current_point.jump_to_line(header);
+    }
+    invalidate_display();
+    return true;
+}
+
+/*!
+ * Each procedure in the file is folded to its head, so the file shows as a list of its
+ * procedures. The cursor moves to the head of the procedure it was in.
+ */
+bool YEditFile::fold_procedures()
+{
+    if (!has_procedures()) {
+        error_message("Can't find scopes in this file type");
+        return false;
+    }
+    index_procedures(LONG_MAX);
+    update_rows(current_point.window_width());
+    const std::vector<ProcedureIndex::Scope> &scopes = outline.scopes();
+    for (const ProcedureIndex::Procedure &procedure : outline.procedures()) {
+        auto scope = std::lower_bound(scopes.begin(), scopes.end(), procedure.start,
+                                      [](const ProcedureIndex::Scope &scope, const long line) {
+                                          return scope.open < line;
+                                      });
+        if (scope != scopes.end() && scope->open == procedure.start &&
+            scope->close > procedure.head)
+            wraps.hide(fold_header(procedure.head) + 1, scope->close);
+    }
+
+    // The cursor goes to the line heading the fold it is in.
+    const long line = current_point.cursor_line();
+    if (wraps.hidden(line))
+        current_point.jump_to_line(wraps.line_at(wraps.row_of(line) - 1));
+    invalidate_display();
+    return true;
+}
+
+//! Opens every fold.
+void YEditFile::unfold_all()
+{
+    wraps.reset();
+    if (wrapping)
+        update_rows(current_point.window_width());
+    invalidate_display();
+}
+
+//! The rows of both the old and the new diagnostics are repainted by the next display.
+void YEditFile::set_diagnostics(Diagnostics &&reported)
+{
+    auto redecorate = [this](const Diagnostics &shown) {
+        if (shown.size() == 0)
+            return;
+        if (redecorate_top < 0L || shown.top() < redecorate_top)
+            redecorate_top = shown.top();
+        redecorate_bottom = std::max(redecorate_bottom, shown.bottom());
+    };
+    redecorate(problems);
+    problems = std::move(reported);
+    redecorate(problems);
+}
+
+//! Every window is repainted by the next display, with or without the old occurrences.
+void YEditFile::show_matches(const SearchPattern *const pattern)
+{
+    highlighted = pattern;
+    invalidate_display();
+}
+
+//! Every window is repainted by the next display. The words found are forgotten when hidden.
+void YEditFile::show_misspellings(const bool flag)
+{
+    spelling = flag;
+    invalidate_display();
+}
+
+void YEditFile::move_diagnostics(const long first, const long old_count, const long new_count)
+{
+    problems.move_lines(first, old_count, new_count);
+}
+
+//! Every window is repainted by the next display, with the new differences.
+void YEditFile::set_differences(const std::vector<LineDiff::Hunk> &hunks,
+                                const bool old_version)
+{
+    differences = hunks;
+    differences_old = old_version;
+    invalidate_display();
+}
+
+//! Returns true if the line is one that differs from the file this one is compared with.
+bool YEditFile::differs(const long line) const
+{
+    const bool old_version = differences_old;
+    const auto after = std::upper_bound(
+        differences.begin(), differences.end(), line,
+        [old_version](const long wanted, const LineDiff::Hunk &hunk) {
+            return wanted < (old_version ? hunk.old_first : hunk.new_first);
+        });
+    if (after == differences.begin())
+        return false;
+    const LineDiff::Hunk &hunk = *(after - 1);
+    return old_version ? line < hunk.old_first + hunk.old_count
+                       : line < hunk.new_first + hunk.new_count;
+}
+
+//! Moves the cursor to the head of the next (or previous) procedure.
+/*!
+ * The procedure index is brought up to date first. Usually it already is, so the procedure is
+ * found by a binary search. If the cursor is at the head of a procedure, the next procedure is
+ * the one starting after the line that identified this one.
+ *
+ * \param forward True to find the next procedure; false to find the previous procedure.
+ */
+bool YEditFile::find_procedure(const bool forward)
+{
+    index_procedures(LONG_MAX);
+
+    const ProcedureIndex::Procedure *found;
+    long line_number = current_point.cursor_line();
+    if (forward) {
+        const ProcedureIndex::Procedure *const here = outline.headed_at(line_number);
+        if (here != nullptr)
+            line_number = std::max(line_number, here->start);
+        found = outline.following(line_number);
+    }
+    else {
+        found = outline.preceding(line_number);
+    }
+
+    if (found != nullptr) {
+        current_point.jump_to_line(found->head);
+        current_point.adjust_window_line(1);
+    }
+    else
+        info_message("Not found");
+
+    return true;
+}
+
+//! Brings the procedure index up to date through the given line.
+void YEditFile::index_through(const long line)
+{
+    collect_changes();
+    if (outline.scanned() <= line)
+        index_procedures(line + 1 - outline.scanned());
+}
+
+//! Returns true if the given line opens a scope that remains open after it.
+bool YEditFile::opens_scope(const long line)
+{
+    index_through(line);
+    return outline.opens_scope(line);
+}
+
+//! Moves the cursor to the line that opens the scope enclosing the cursor line.
+/*!
+ * If that scope is a procedure, the cursor moves to the head of the procedure instead. Using
+ * this command repeatedly moves outward one scope at a time.
+ */
+bool YEditFile::enclosing_scope()
+{
+    if (!has_procedures()) {
+        error_message("Can't find scopes in this file type");
+        return false;
+    }
+
+    const long line_number = current_point.cursor_line();
+    index_through(line_number);
+    long target = line_number;
+    const ProcedureIndex::Scope *const scope = outline.enclosing(line_number);
+    if (scope != nullptr) {
+        target = scope->open;
+        const ProcedureIndex::Procedure *const procedure = outline.preceding(target + 1);
+        if (procedure != nullptr && procedure->start == target && procedure->head < line_number)
+            target = procedure->head;
+    }
+
+    if (target == line_number) {
+        info_message("Not found");
+        return true;
+    }
+    current_point.jump_to_line(target);
+    current_point.adjust_window_line(1);
+    return true;
+}
+
+//! Examines up to count more lines of the file for procedures.
+/*!
+ * Lines modified since the last call are first forgotten by the procedure index. The index is
+ * brought up to date a little at a time while the editor waits for keystrokes, so finding a
+ * procedure rarely has to examine any lines.
+ *
+ * \return True if there are more lines to examine.
+ */
+bool YEditFile::index_procedures(long count)
+{
+    collect_changes();
+    if (outline.complete() || !has_procedures())
+        return false;
+
+    long line_number = outline.scanned();
+    file_data.jump_to(line_number);
+    for (; count > 0; --count) {
+        const EditBuffer *const line = file_data.next();
+        if (line == nullptr) {
+            outline.finish();
+            return false;
+        }
+        if (procedure_line(line->view(), outline)) {
+            outline.add(procedure_head(line_number), line_number);
+            file_data.jump_to(line_number + 1);
+        }
+        outline.advance();
+        ++line_number;
+    }
+    return true;
+}
+
+/*!
+ * This function paints the contents of an YEditFile, as seen from the given position, into the
+ * image of a window. The image holds the file's border as well as its text. The state of the
+ * image after each call is remembered so that the next call can skip whatever has not changed.
+ * The border and file name are drawn only when the file is first shown in the image or the
+ * image's size, the color or the window's activity changes. The modified flag, the insert mode
+ * flag, and the position indicator are redrawn only when they change. Text rows are repainted
+ * if the window moved, if the lines they show were damaged by an edit, or if their block
+ * highlighting changed.
+ *
+ * The damage is not forgotten here since several windows may show the file. Once they have all
+ * been painted finish_display() must be called.
+ *
+ * \param image The image of the window. It must be at least three rows and 14 columns.
+ * \param position The cursor and window position in the file.
+ * \param active True if the window is the one the user is working in.
+ * \param shown What the image showed after the last call. Updated to what it now shows.
+ * \return true if anything in the image was changed.
+ */
+bool YEditFile::display(scr::ImageBuffer &image, const FilePosition &position,
+                        const bool active, DisplayState &shown)
 {
-    int i;
     char buffer[40 + 1];
     // Used to hold the row, column position. The arbitrary static limit will only be a problem
     // if the number of digits involved grows to this quantity.
 
-    int screen_width = scr::number_of_columns();
-    int screen_height = scr::number_of_rows();
-    scr::BoxChars *box_type = scr::get_box_characters(scr::DOUBLE_LINE);
+    const int screen_width = image.get_width();
+    const int screen_height = image.get_height();
+    const scr::BoxType border_type = active ? scr::DOUBLE_LINE : scr::SINGLE_LINE;
+    scr::BoxChars *box_type = scr::get_box_characters(border_type);
 
-    // The following have to do with where the file name is displayed. This function assumes the
-    // space is not "small." It displays very long names in a reasonable way and it will use the
-    // full width of a big screen. However, it will have problems with very small screens!
+    // Shows a character on the border.
+    auto put_border = [&](int row, int column, int border_character) {
+        const char text[2] = {static_cast<char>(border_character), '\0'};
+        image.copy_text(text, row, column, 1);
+    };
 
-    // Column for left side of file name.
-    const int left_anchor = 5;
+    const long window_line = position.window_line();
+    const unsigned window_column = position.window_column();
+    const bool by_rows = moves_by_rows();
+    const unsigned window_row = by_rows ? position.window_row() : 0U;
 
-    // Max column for right side of file name.
-    const int right_max = screen_width - 5;
+    // The fields of a table shown aligned are scanned first, since a field that is wider than
+    // before moves the fields after it on every row, in every window showing the table.
+    FieldIndex *const table = aligned_fields();
+    for (long line = window_line; table != nullptr && line < window_line + screen_height - 2;
+         ++line) {
+        file_data.jump_to(line);
+        const EditBuffer *const text = file_data.get();
+        if (text == nullptr)
+            break;
+        if (table->prepare(line, *text, tab_stop))
+            invalidate_display();
+    }
 
-    // Number of characters availble for name.
-    const int name_width = right_max - left_anchor - 3;
+    // The image must be painted from scratch if it is showing something else.
+    const bool full_repaint = !shown.valid || shown.epoch != display_epoch ||
+                              shown.rows != screen_height || shown.columns != screen_width ||
+                              shown.color != color || shown.active != active;
 
-    // First erase the old image.
-    scr::clear(1, 1, screen_width, screen_height, color);
+    // When the window only moved up or down the rows still visible are scrolled with the text
+    // and only the rows exposed are painted. Wrapped or folded lines are always repainted.
+    const int text_height = screen_height - 2;
+    const long shift = window_line - shown.window_line;
+    const bool scrolling = !full_repaint && !by_rows && shown.window_column == window_column &&
+                           shift != 0 && shift > -text_height && shift < text_height;
+    const bool moved =
+        shift != 0 || shown.window_column != window_column || shown.window_row != window_row;
+    const bool text_repaint = full_repaint || (moved && !scrolling);
+    bool painted = text_repaint || scrolling;
+    shown.scrolled = scrolling ? shift : 0;
+    if (scrolling)
+        image.scroll((shift > 0) ? scr::UP : scr::DOWN, 2, 2, screen_width - 2, text_height,
+                     static_cast<int>((shift > 0) ? shift : -shift), color);
+    auto exposed = [&](int row) {
+        return scrolling && ((shift > 0) ? row >= screen_height - shift : row < 2 - shift);
+    };
 
-    // Now draw the border.
-    scr::draw_box(1, 1, screen_width, screen_height, scr::DOUBLE_LINE, color);
+    if (full_repaint) {
 
-    // Set visual is_changed flag.
-    if (is_changed)
-        scr::print_text(1, 3, 1, "*");
-    else
-        scr::print_text(1, 3, 1, "%c", box_type->horizontal);
+        // The following have to do with where the file name is displayed. This function
+        // assumes the space is not "small." It displays very long names in a reasonable way and
+        // it will use the full width of a big screen. However, it will have problems with very
+        // small screens!
 
-    // The following several sections display the name of the file.
-    int screen_offset = left_anchor;
-    int file_name_length = file_name.length();
+        // Column for left side of file name.
+        const int left_anchor = 5;
 
-    // First, display the left hand border character.
-    scr::print_text(1, screen_offset, 2, "%c ", box_type->left_stop);
-    screen_offset += 2;
+        // Max column for right side of file name.
+        const int right_max = screen_width - 5;
 
-    // If the name fits, just print it.
-    if (file_name_length <= name_width) {
-        scr::print_text(1, screen_offset, file_name_length, "%s", file_name.c_str());
-        screen_offset += file_name_length;
-    }
-    // Otherwise print the right hand part and show some dots to indicate that not all the path
-    // is being displayed.
-    //
-    else {
-        scr::print_text(1, screen_offset, 3, "...");
-        screen_offset += 3;
-        int p = file_name_length - (name_width - 3);
-        scr::print_text(1, screen_offset, name_width - 3, "%s", file_name.c_str() + p);
-        screen_offset += name_width - 3;
+        // Number of characters availble for name.
+        const int name_width = right_max - left_anchor - 3;
+
+        // First erase the old image.
+        image.fill(1, 1, screen_width, screen_height, color);
+
+        // Now draw the border.
+        image.draw_box(1, 1, screen_width, screen_height, border_type, color);
+
+        // The following several sections display the name of the file.
+        int screen_offset = left_anchor;
+        int file_name_length = file_name.length();
+
+        // First, display the left hand border character.
+        put_border(1, screen_offset, box_type->left_stop);
+        put_border(1, screen_offset + 1, ' ');
+        screen_offset += 2;
+
+        // If the name fits, just print it.
+        if (file_name_length <= name_width) {
+            image.copy_text(file_name.c_str(), 1, screen_offset, file_name_length);
+            screen_offset += file_name_length;
+        }
+        // Otherwise print the right hand part and show some dots to indicate that not all the
+        // path is being displayed. In a very narrow window there is no room for the name.
+        //
+        else if (name_width > 3) {
+            image.copy_text("...", 1, screen_offset, 3);
+            screen_offset += 3;
+            int p = file_name_length - (name_width - 3);
+            image.copy_text(file_name.c_str() + p, 1, screen_offset, name_width - 3);
+            screen_offset += name_width - 3;
+        }
+
+        // Display the right hand border character.
+        put_border(1, screen_offset, ' ');
+        put_border(1, screen_offset + 1, box_type->right_stop);
     }
 
-    // Display the right hand border character.
-    scr::print_text(1, screen_offset, 2, " %c", box_type->right_stop);
+    // Set visual is_changed flag.
+    if (full_repaint || shown.changed != is_changed) {
+        put_border(1, 3, is_changed ? '*' : box_type->horizontal);
+        painted = true;
+    }
 
     // Display an 'I' in the upper left corner if we are in insert mode.
-    if (insert_mode() == INSERT)
-        scr::print_text(1, screen_width - 3, 1, "I");
-    else
-        scr::print_text(1, screen_width - 3, 1, "%c", box_type->horizontal);
-
-    // Write the position onto the lower right corner of the screen.
-    std::sprintf(buffer, "(%ld, %u)", current_point.cursor_line() + 1,
-                 current_point.cursor_column() + 1);
-
-    scr::print_text(screen_height, screen_width - std::strlen(buffer) - 3, std::strlen(buffer),
-                    "%s", buffer);
-
-    // Prepare list for sequential access.
-    file_data.jump_to(current_point.window_line());
-
-    // Loop until screen is full or list is empty.
-    const char *line;
-    EditBuffer *edit_line;
-    for (i = 2; i < screen_height; i++) {
-
-        // Get a pointer to this line.
-        if ((edit_line = file_data.next()) != nullptr) {
-            std::string temp = edit_line->to_string();
-            line = temp.c_str();
-
-            // Advance line to point at appropriate column (or at null byte).
-            const char *base = line;
-            while ((line - base) < static_cast<std::ptrdiff_t>(current_point.window_column()) &&
-                   *line)
-                line++;
-
-            // Copy text from list into screen until null is found (or right edge). print_text()
-            // can only handle 1024 byte strings (after formatting). I want to use print_text()
-            // in this way for performance reasons. I don't want to call print_text() for each
-            // and every character.
-            //
-            // Profiling shows that the call to draw_box() above requires 38% of the execution
-            // time of this function. Inside draw_box() calls to print() that print single
-            // characters account for over 70% of the execution time.
-            //
-            // BTW... 30% of the execution time for this function is in the call to clear(). The
-            // code below only accounts for 11% of the time.
+    const bool insert = (insert_mode() == INSERT);
+    if (full_repaint || shown.insert != insert) {
+        put_border(1, screen_width - 3, insert ? 'I' : box_type->horizontal);
+        painted = true;
+    }
 
-            static char line_buffer[1024 + 1];
-            // Used to hold a line of text before going to the screen. This is effectively the
-            // maximum width display Y20 can handle.
+    // Write the position, and how far through the file it is, onto the lower right corner of
+    // the image. A file viewed as bytes has rows rather than lines, and the position shown is
+    // the offset of the byte under the cursor (see HexImage).
+    const HexImage *const bytes = hex_image();
+    const long size = (bytes != nullptr) ? bytes->rows() : line_count();
+    const long percent =
+        std::min((position.cursor_line() + 1) * 100 / std::max(size, 1L), 100L);
+    HexImage::Cell cell;
+    if (bytes != nullptr &&
+        bytes->locate(position.cursor_line(), position.cursor_column(), cell))
+        std::sprintf(buffer, "(0x%llx) %ld%%", static_cast<unsigned long long>(cell.offset),
+                     percent);
+    else
+        std::sprintf(buffer, "(%ld, %u) %ld%%", position.cursor_line() + 1,
+                     position.cursor_column() + 1, percent);
 
-            std::size_t length = std::strlen(line) + 1;
-            length = (length > 1024) ? 1024 : length;
+    if (full_repaint || shown.position != buffer) {
 
-            std::memcpy(line_buffer, line, length);
-            scr::print_text(i, 2, screen_width - 2, "%s", line_buffer);
+        // Restore the border under an old indicator that might be longer than the new one.
+        if (!full_repaint) {
+            const std::string border(shown.position.length(),
+                                     static_cast<char>(box_type->horizontal));
+            image.copy_text(border.c_str(), screen_height,
+                            screen_width - static_cast<int>(border.length()) - 3,
+                            border.length());
         }
+        image.copy_text(buffer, screen_height,
+                        screen_width - static_cast<int>(std::strlen(buffer)) - 3,
+                        std::strlen(buffer));
+        shown.position = buffer;
+        painted = true;
     }
 
-    // If block mode is active, indicate block.
-    if (get_block_state()) {
-
-        long top, bottom;
+    // Find the lines that are highlighted as part of a block now and in the last display.
+    const bool block_on = get_block_state();
+    long top = 0, bottom = -1;
+    unsigned left = 0, right = UINT_MAX;
+    if (block_on)
         block_limits(top, bottom);
+    if (column_block())
+        column_limits(left, right);
+    const bool columns_moved = left != shown.block_left || right != shown.block_right;
+    auto in_block = [&](long line) { return block_on && line >= top && line <= bottom; };
+    auto was_in_block = [&](long line) {
+        return shown.block && line >= shown.block_top && line <= shown.block_bottom;
+    };
 
-        int top_row, bottom_row;
+    // Rows with a caret now or in the last display are repainted if the carets changed.
+    const bool carets_moved = shown.carets != carets;
+    auto first_caret = [](const std::vector<Caret> &list, long line) {
+        return std::lower_bound(list.begin(), list.end(), Caret{line, 0U});
+    };
+    auto has_caret = [&](const std::vector<Caret> &list, long line) {
+        auto it = first_caret(list, line);
+        return it != list.end() && it->line == line;
+    };
 
-        // Compute screen row number for top of block.
-        if (top < current_point.window_line())
-            top_row = 1 + 1;
-        else
-            top_row = (int)(top - current_point.window_line()) + 2;
+    // A wholesale repaint can clear the text area in a single operation.
+    if (text_repaint && !full_repaint)
+        image.fill(2, 2, screen_width - 2, screen_height - 2, color);
 
-        // Compute screen row number for bottom of block.
-        if (bottom >= current_point.window_line() + screen_height - 2)
-            bottom_row = screen_height - 1;
-        else
-            bottom_row = (int)(bottom - current_point.window_line()) + 2;
+    const std::size_t visible_width = static_cast<std::size_t>(screen_width - 2);
+
+    static std::string line_buffer;
+    // Used to hold the visible part of a line that is not plain before going to the image.
+
+    static std::vector<char> cell_buffer;
+    // Used to hold the characters and attributes of the visible part of a colored line.
+
+    static std::string hex_text;
+    static EditBuffer hex_row;
+    // Used to hold the row being displayed of a file viewed as bytes, or of a table whose
+    // fields are aligned.
+
+    line_buffer.resize(visible_width);
+    cell_buffer.resize(2 * visible_width);
+
+    // Bring the lexer states of the visible lines up to date. Lines after a modification may
+    // need to be recolored even though their text did not change.
+    const Language *const syntax = language();
+    long recolored = -1;
+    collect_changes();
+    long top_row = 0;
+    long bottom_line = window_line + text_height - 1;
+    if (by_rows) {
+        update_rows(static_cast<unsigned>(visible_width));
+        top_row = wraps.row_of(window_line) + window_row;
+        bottom_line = wraps.line_at(top_row + text_height - 1);
+    }
+    if (syntax != nullptr)
+        recolored = highlighter.update(*syntax, file_data, bottom_line);
+    if (highlighted != nullptr)
+        matches.prepare(*highlighted);
+    else
+        matches.reset();
+    const bool check_spelling = spelling && checks_spelling() && Spelling::is_open();
+    if (!check_spelling)
+        misspelled.reset();
+
+    // Loop over the text rows, bringing each one up to date if necessary. Each row shows the
+    // columns [row_column, row_column + row_width) of a line. When lines are wrapped or folded
+    // (see WrapIndex) the rows are looked up in the index: a long line takes several rows and
+    // folded lines take none. A modified line may then move the rows after it, so they are all
+    // repainted. The header of a fold is marked on the window's border.
+    for (int i = 2; i < screen_height; i++) {
+        long line = window_line + (i - 2);
+        unsigned row = 0U;
+        unsigned row_column = window_column;
+        std::size_t row_width = visible_width;
+        if (by_rows) {
+            line = wraps.line_at(top_row + (i - 2));
+            row = static_cast<unsigned>(top_row + (i - 2) - wraps.row_of(line));
+        }
+        if (wrapping) {
+            row_column = static_cast<unsigned>(wraps.row_start(line, row).column);
+            if (row + 1 < wraps.rows(line)) {
+                const std::size_t end = wraps.row_start(line, row + 1).column;
+                row_width = std::min(end - row_column, visible_width);
+            }
+        }
+
+        const bool damaged =
+            (line >= damage_top && line <= std::max(damage_bottom, recolored)) ||
+            (line >= redecorate_top && line <= redecorate_bottom) ||
+            (by_rows && damage_top >= 0L && line >= damage_top);
+        const bool caret_row =
+            carets_moved && (has_caret(carets, line) || has_caret(shown.carets, line));
+        const bool block_row = in_block(line) != was_in_block(line) ||
+                               (columns_moved && (in_block(line) || was_in_block(line)));
+        if (!text_repaint && !damaged && !caret_row && !block_row && !exposed(i))
+            continue;
+
+        // Rows repainted individually must be erased first. That also resets their color.
+        if (!text_repaint) {
+            image.fill(i, 2, screen_width - 2, 1, color);
+            painted = true;
+        }
+        if (by_rows) {
+            const bool header = row == 0U && wraps.folded_after(line);
+            put_border(i, 1, header ? '+' : box_type->vertical);
+        }
+
+        // The rows of a file viewed as bytes are made from the bytes.
+        EditBuffer *edit_line = nullptr;
+        if (bytes != nullptr) {
+            bytes->render(line, hex_text);
+            hex_row = EditBuffer(hex_text.data(), hex_text.size());
+            edit_line = &hex_row;
+        }
+        else {
+            file_data.jump_to(line);
+            edit_line = file_data.get();
+            if (table != nullptr && edit_line != nullptr) {
+                table->render(line, *edit_line, tab_stop, hex_text);
+                hex_row = EditBuffer(hex_text.data(), hex_text.size());
+                edit_line = &hex_row;
+            }
+        }
+        if (edit_line != nullptr) {
+
+            // Only the part of the line in the window is examined, so long lines cost no more
+            // than short ones. The window's first and last columns are located with the line's
+            // index of columns so they are found quickly even far along a long line. The part
+            // is viewed in place (see EditBuffer::view) and plain text goes straight to the
+            // image. Lines that are not plain ASCII are copied a character at a time, with tabs
+            // expanded to spaces reaching the next tab stop. The first column may fall inside
+            // a tab, in which case only the rest of it shows.
+            //
+            const std::size_t first = edit_line->offset_of(row_column, tab_stop);
+            const std::size_t last =
+                edit_line->offset_of(row_column + row_width, tab_stop);
+            const bool plain = edit_line->is_plain();
+            std::size_t column = plain ? row_column : edit_line->column_of(first, tab_stop);
+            if (syntax == nullptr) {
+                const std::string_view text = edit_line->view(first, last - first);
+                if (plain) {
+                    if (!text.empty())
+                        image.copy_text(text.data(), i, 2, text.size());
+                }
+                else {
+                    std::size_t length = 0;
+                    for (std::size_t offset = 0; offset < text.size() && length < row_width;
+                         offset = Utf8::next(text, offset)) {
+                        const std::size_t end = Utf8::advance(column, text[offset], tab_stop);
+                        const char cell = cell_character(text, offset);
+                        for (column = std::max<std::size_t>(column, row_column);
+                             column < end && length < row_width; ++column)
+                            line_buffer[length++] = cell;
+                    }
+                    image.copy_text(line_buffer.data(), i, 2, length);
+                }
+            }
+
+            // Colored lines are written with their attributes. Tokens are classified by their
+            // whole text (a keyword, say), so the line is scanned a little past the window.
+            else {
+                const std::string_view text = edit_line->view(0, last + TOKEN_LOOKAHEAD);
+                highlighter.color_line(*syntax, line, text, tokens);
+                std::size_t length = 0;
+                for (std::size_t offset = first; offset < text.size() && length < row_width;
+                     offset = Utf8::next(text, offset)) {
+                    const std::size_t end = Utf8::advance(column, text[offset], tab_stop);
+                    const char cell = cell_character(text, offset);
+                    const char cell_color =
+                        static_cast<char>(token_color(tokens[offset], color));
+                    for (column = std::max<std::size_t>(column, row_column);
+                         column < end && length < row_width; ++column, ++length) {
+                        cell_buffer[2 * length] = cell;
+                        cell_buffer[2 * length + 1] = cell_color;
+                    }
+                }
+                image.copy_cells(cell_buffer.data(), i, 2, length);
+            }
+        }
+
+        // Mark the lines that differ from the file this one is compared with (see DiffView).
+        if (!differences.empty() && differs(line))
+            image.set_color(i, 2, screen_width - 2, 1, scr::BLACK | scr::REV_GREEN);
+
+        // Mark the text with problems reported by the language server.
+        const auto marked = problems.on_line(line);
+        for (auto mark = marked.first; edit_line != nullptr && mark != marked.second; ++mark) {
+            const std::size_t size = edit_line->length();
+            const unsigned start = static_cast<unsigned>(
+                edit_line->column_of(std::min(mark->start, size), tab_stop));
+            const unsigned stop = static_cast<unsigned>(
+                edit_line->column_of(std::min(mark->end, size), tab_stop));
+            // A problem at a single point, such as a missing semicolon, still gets one cell.
+            const unsigned end = std::max(stop, start + 1);
+            if (end <= row_column || start >= row_column + row_width)
+                continue;
+            const unsigned first = std::max(start, row_column) - row_column;
+            const unsigned last = std::min<unsigned>(end - row_column, row_width);
+            image.set_color(i, 2 + static_cast<int>(first), static_cast<int>(last - first), 1,
+                            diagnostic_color(mark->severity));
+        }
+
+        // Mark the misspelled words. They are kept for each line (see SpellCache), so a line
+        // is checked again only once it has been modified.
+        const std::vector<Spelling::Word> *const words =
+            (check_spelling && edit_line != nullptr)
+                ? misspelled.misspellings(line, edit_line->view())
+                : nullptr;
+        for (std::size_t w = 0; words != nullptr && w < words->size(); ++w) {
+            const Spelling::Word &word = (*words)[w];
+            const std::size_t end = word.offset + word.length;
+            const unsigned start =
+                static_cast<unsigned>(edit_line->column_of(word.offset, tab_stop));
+            const unsigned stop = static_cast<unsigned>(edit_line->column_of(end, tab_stop));
+            if (stop <= row_column || start >= row_column + row_width)
+                continue;
+            const unsigned first = std::max(start, row_column) - row_column;
+            const unsigned last = std::min<unsigned>(stop - row_column, row_width);
+            image.set_color(i, 2 + static_cast<int>(first), static_cast<int>(last - first), 1,
+                            (color & 0x70) | scr::RED | scr::BRIGHT);
+        }
+
+        // Mark the occurrences of the pattern being searched for. They are kept for each line
+        // (see MatchCache), except on very long lines. On those only the part of the line in
+        // the window, and a margin either side of it, is searched.
+        if (highlighted != nullptr && edit_line != nullptr) {
+            auto mark = [&](const std::size_t offset, const std::size_t length) {
+                const unsigned start =
+                    static_cast<unsigned>(edit_line->column_of(offset, tab_stop));
+                const unsigned stop =
+                    static_cast<unsigned>(edit_line->column_of(offset + length, tab_stop));
+                if (stop <= row_column || start >= row_column + row_width)
+                    return;
+                const unsigned from = std::max(start, row_column) - row_column;
+                const unsigned to = std::min<unsigned>(stop - row_column, row_width);
+                image.set_color(i, 2 + static_cast<int>(from), static_cast<int>(to - from), 1,
+                                scr::BLACK | scr::REV_CYAN);
+            };
+            const std::size_t first = edit_line->offset_of(row_column, tab_stop);
+            const std::size_t last = edit_line->offset_of(row_column + row_width, tab_stop);
+            const std::vector<MatchCache::Match> *const kept =
+                matches.matches(line, edit_line->view());
+            if (kept != nullptr) {
+                for (const MatchCache::Match &match : *kept) {
+                    if (match.offset >= last)
+                        break;
+                    if (match.offset + match.length > first)
+                        mark(match.offset, match.length);
+                }
+            }
+            else {
+                const std::string_view text = edit_line->view(0, last + MATCH_MARGIN);
+                std::size_t found = (first > MATCH_MARGIN) ? first - MATCH_MARGIN : 0;
+                std::size_t length; // An occurrence not found is at npos, which is past last.
+                while ((found = highlighted->find(text, found, &length)) < last) {
+                    if (length != 0 && found + length > first)
+                        mark(found, length);
+                    found += std::max<std::size_t>(length, 1);
+                }
+            }
+        }
+
+        // If block mode is active, indicate block.
+        if (in_block(line) && right > row_column) {
+            const unsigned first = std::max(left, row_column) - row_column;
+            const unsigned last = std::min<unsigned>(right - row_column, row_width);
+            if (first < last)
+                image.set_color(i, 2 + static_cast<int>(first), static_cast<int>(last - first),
+                                1, scr::BLACK | scr::REV_WHITE);
+        }
 
-        // Insert revised attribute into screen image.
-        for (int j = top_row; j <= bottom_row; j++) {
-            scr::set_color(j, 2, screen_width - 2, 1, scr::BLACK | scr::REV_WHITE);
+        // Show the carets on this line that are in the window.
+        auto it = first_caret(carets, line);
+        for (; it != carets.end() && it->line == line; ++it) {
+            if (it->column >= row_column && it->column - row_column < row_width)
+                image.set_color(i, 2 + static_cast<int>(it->column - row_column), 1, 1,
+                                scr::BLACK | scr::REV_WHITE);
         }
     }
 
-    // Position cursor.
-    scr::set_cursor_position(
-        (int)(2 + current_point.cursor_line() - current_point.window_line()),
-        2 + current_point.cursor_column() - current_point.window_column());
+    // Remember what the image now shows.
+    shown.valid = true;
+    shown.epoch = display_epoch;
+    shown.rows = screen_height;
+    shown.columns = screen_width;
+    shown.color = color;
+    shown.active = active;
+    shown.window_line = window_line;
+    shown.window_column = window_column;
+    shown.window_row = window_row;
+    shown.changed = is_changed;
+    shown.insert = insert;
+    shown.block = block_on;
+    shown.block_top = top;
+    shown.block_bottom = bottom;
+    shown.block_left = left;
+    shown.block_right = right;
+    if (carets_moved)
+        shown.carets = carets;
+    return painted;
 }
@@ -6,5 +6,6 @@
 #include "clipboard.hpp"
 
 EditList clipboard;
+bool clipboard_columns = false;
 
 // Impressive wasn't it?
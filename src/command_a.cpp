@@ -5,9 +5,12 @@
 
 #include <cstdlib>
 
+#include "FieldIndex.hpp"
 #include "FileList.hpp"
+#include "Utf8.hpp"
 #include "command.hpp"
 #include "parameter_stack.hpp"
+#include "support.hpp"
 #include "yfile.hpp"
 
 bool add_text_command()
@@ -23,16 +26,39 @@ bool add_text_command()
     std::string parameter_value = parameter.value();
     const char *parameter_text = parameter_value.c_str();
 
+    // The continuation bytes of a multi-byte character are added to its first byte.
     while (*parameter_text && return_value == true) {
-        if (the_file.insert_mode() == YEditFile::INSERT)
+
+        // A file whose lines are fixed places each character itself (see HEX_YEditFile).
+        if (the_file.has_fixed_lines()) {
+            return_value = the_file.insert_char(*parameter_text++);
+            continue;
+        }
+
+        const bool continuation = Utf8::is_continuation(*parameter_text);
+        if (the_file.insert_mode() == YEditFile::INSERT || continuation)
             return_value = the_file.insert_char(*parameter_text);
         else
             return_value = the_file.replace_char(*parameter_text);
 
         parameter_text++;
-        if (return_value == true)
-            the_file.CP().cursor_right();
+        if (return_value == true && !continuation)
+            the_file.character_right();
     }
 
     return return_value;
 }
+
+//! Shows the fields of a table aligned in columns, or stops doing so.
+bool align_fields_command()
+{
+    FieldIndex *const table = FileList::active_file().fields();
+    if (table == nullptr) {
+        error_message("Not a table");
+        return false;
+    }
+    table->set_aligned(!table->is_aligned());
+    YEditFile::invalidate_display();
+    info_message(table->is_aligned() ? "Fields aligned" : "Fields not aligned");
+    return true;
+}
@@ -64,13 +64,12 @@ bool backspace_command()
         the_file.CP().jump_to_column(offset);
     }
 
-    // It's not a join operation.
+    // It's not a join operation. Backspacing moves the cursor to the deleted character.
     else {
         if (the_file.insert_mode() == YEditFile::INSERT)
             return_value = the_file.backspace();
-
-        if (return_value == true)
-            the_file.CP().cursor_left();
+        else
+            the_file.character_left();
     }
 
     return return_value;
@@ -3,19 +3,136 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include <screen/ItemSource.hpp>
+#include <screen/SelectWindow.hpp>
+#include <screen/screen.hpp>
+
+#include "Allocations.hpp"
+#include "Completion.hpp"
 #include "FileList.hpp"
+#include "WindowList.hpp"
 #include "clipboard.hpp"
+#include "support.hpp"
 #include "yfile.hpp"
 
+bool clear_cursors_command()
+{
+    FileList::active_file().clear_carets();
+    return true;
+}
+
+bool close_window_command()
+{
+    return WindowList::close();
+}
+
+bool column_cursors_command()
+{
+    if (!FileList::active_file().column_carets()) {
+        error_message("Block mode is not on");
+        return false;
+    }
+    return true;
+}
+
+bool complete_word_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    const long line = the_file.CP().cursor_line();
+    const EditBuffer *const text = the_file.line_at(line);
+    const std::string_view view = (text != nullptr) ? text->view() : std::string_view();
+
+    // The word to complete ends at the cursor.
+    const std::size_t end = std::min(
+        view.size(), text != nullptr ? text->offset_of(the_file.CP().cursor_column(),
+                                                       the_file.tab_distance())
+                                     : std::size_t(0));
+    std::size_t start = end;
+    while (start > 0 && Completion::is_word_character(view[start - 1]))
+        --start;
+    const std::string prefix(view.substr(start, end - start));
+    if (prefix.empty()) {
+        error_message("There is no word before the cursor");
+        return false;
+    }
+
+    std::string query = prefix;
+    std::vector<std::string> words = Completion::candidates(the_file, line, query);
+    if (words.empty()) {
+        error_message("No completions for %.100s", prefix.c_str());
+        return false;
+    }
+
+    int height = scr::number_of_rows() - 8;
+    if (height > 12)
+        height = 12;
+    const scr::FunctionSource results(
+        [&]() { return static_cast<long>(words.size()); },
+        [&](long first, long number, std::vector<std::string> &entries) {
+            for (; number > 0 && first < static_cast<long>(words.size()); --number, ++first)
+                entries.push_back(words[static_cast<std::size_t>(first)]);
+        });
+    scr::SelectWindow window;
+    window.set("Complete", &results);
+    window.open(4, 4, 40, height, scr::BLACK | scr::REV_WHITE, scr::WHITE, scr::SINGLE_LINE);
+
+    // Typing narrows the choices. The characters typed are kept even if nothing matches.
+    int choice;
+    for (;;) {
+        choice = window.select(0);
+        if (choice == scr::K_ESC || choice == scr::K_RETURN || choice == scr::K_CRETURN ||
+            choice == scr::K_TAB)
+            break;
+        if (choice == scr::K_BACKSPACE || choice == 127) {
+            if (query.size() == prefix.size())
+                continue;
+            query.pop_back();
+        }
+        else if (choice >= ' ' && choice <= 0xFF &&
+                 Completion::is_word_character(static_cast<char>(choice))) {
+            query.push_back(static_cast<char>(choice));
+        }
+        else {
+            continue;
+        }
+        words = Completion::candidates(the_file, line, query);
+        window.set_current_line(0);
+    }
+
+    std::string chosen;
+    if (choice != scr::K_ESC)
+        chosen = words.empty() ? query : words[static_cast<std::size_t>(window.current_line())];
+    window.close();
+
+    for (std::size_t i = prefix.size(); i < chosen.size(); i++) {
+        if (!the_file.insert_char(chosen[i]))
+            return false;
+        the_file.character_right();
+    }
+    return true;
+}
+
 bool copy_block_command()
 {
     bool return_value;
     YEditFile &the_file = FileList::active_file();
 
+    Allocations::Scope tag(Allocations::CLIPBOARD);
     clipboard.clear();
-    return_value = the_file.get_block(clipboard);
+    clipboard_columns = the_file.column_block();
+    if (clipboard_columns) {
+        the_file.get_columns(clipboard);
+        return_value = true;
+    }
+    else
+        return_value = the_file.get_block(clipboard);
 
     // Turn off block mode if it's on.
     if (the_file.get_block_state())
@@ -26,24 +143,32 @@ bool copy_block_command()
 
 bool CP_down_command()
 {
-    FileList::active_file().CP().cursor_down();
+    YEditFile &the_file = FileList::active_file();
+    if (the_file.moves_by_rows())
+        the_file.move_rows(1L, false);
+    else
+        the_file.CP().cursor_down();
     return true;
 }
 
 bool CP_left_command()
 {
-    FileList::active_file().CP().cursor_left();
+    FileList::active_file().character_left();
     return true;
 }
 
 bool CP_right_command()
 {
-    FileList::active_file().CP().cursor_right();
+    FileList::active_file().character_right();
     return true;
 }
 
 bool CP_up_command()
 {
-    FileList::active_file().CP().cursor_up();
+    YEditFile &the_file = FileList::active_file();
+    if (the_file.moves_by_rows())
+        the_file.move_rows(-1L, false);
+    else
+        the_file.CP().cursor_up();
     return true;
 }
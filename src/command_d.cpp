@@ -3,13 +3,20 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cstdio>
 #include <cstdlib>
+#include <string>
 
+#include "Allocations.hpp"
+#include "DiffView.hpp"
 #include "FileList.hpp"
+#include "WindowList.hpp"
 #include "WordSource.hpp"
 #include "clipboard.hpp"
 #include "command.hpp"
+#include "global.hpp"
 #include "parameter_stack.hpp"
+#include "support.hpp"
 #include "yfile.hpp"
 
 bool define_key_command()
@@ -29,6 +36,60 @@ bool define_key_command()
     return true;
 }
 
+//! Compares the active file with another, or with its saved copy, side by side.
+/*!
+ * The saved copy is loaded into a read only file of its own. The other file is shown in a
+ * window to the right of the active one, which is made for it unless it is already shown.
+ */
+bool diff_files_command()
+{
+    static Parameter other_name("COMPARE WITH (NOTHING FOR THE SAVED COPY):");
+    if (other_name.get() == false)
+        return false;
+    const std::string name = other_name.value();
+    YEditFile &left = FileList::active_file();
+
+    YEditFile *right = nullptr;
+    if (name.empty()) {
+        // As for a job, the name can't be that of a file on disk.
+        static unsigned last_number = 0;
+        char prefix[32];
+        std::snprintf(prefix, sizeof(prefix), "*disk%u*", ++last_number);
+        const std::string copy_name = prefix + std::string(left.name());
+        if (!FileList::new_file(copy_name.c_str()))
+            return false;
+        right = &FileList::active_file();
+        right->set_read_only(true);
+        if (!right->load(left.name())) {
+            FileList::kill();
+            FileList::lookup(left.name());
+            return false;
+        }
+    }
+    else if (FileList::lookup(name.c_str()))
+        right = &FileList::active_file();
+    else if (restricted_mode) {
+        error_message("Can't load additional files in restricted mode");
+        return false;
+    }
+    else if (FileList::new_file(name.c_str()))
+        right = &FileList::active_file();
+    else
+        return false;
+
+    FileList::lookup(left.name());
+    if (right == &left) {
+        error_message("A file can't be compared with itself");
+        return false;
+    }
+    if (!WindowList::shows(right) || WindowList::count() == 1) {
+        if (!WindowList::split(true))
+            return false;
+        FileList::lookup(right->name());
+    }
+    return DiffView::start(left, *right);
+}
+
 bool delete_command()
 {
     return FileList::active_file().delete_char();
@@ -51,15 +112,30 @@ bool delete_SOL_command()
     return true;
 }
 
+//! Deletes from the cursor to the start of the next word.
+bool delete_word_command()
+{
+    return FileList::active_file().delete_word();
+}
+
 bool delete_block_command()
 {
     bool return_value;
     YEditFile &the_file = FileList::active_file();
 
+    Allocations::Scope tag(Allocations::CLIPBOARD);
     clipboard.clear();
-    return_value = the_file.get_block(clipboard);
-    if (return_value == true)
-        the_file.delete_block();
+    clipboard_columns = the_file.column_block();
+    if (clipboard_columns) {
+        the_file.get_columns(clipboard);
+        the_file.delete_columns();
+        return_value = true;
+    }
+    else {
+        return_value = the_file.get_block(clipboard);
+        if (return_value == true)
+            the_file.delete_block();
+    }
 
     // Turn off block mode if it's on.
     if (the_file.get_block_state())
@@ -3,13 +3,22 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <string>
+#include <vector>
 
+#include <screen/ItemSource.hpp>
+#include <screen/SelectWindow.hpp>
 #include <screen/screen.hpp>
 
+#include "ErrorList.hpp"
 #include "FileList.hpp"
+#include "JobList.hpp"
+#include "LuaEngine.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
 #include "command.hpp"
 #include "global.hpp"
 #include "help.hpp"
@@ -24,6 +33,50 @@ bool editor_info_command()
     return true;
 }
 
+bool enclosing_scope_command()
+{
+    return FileList::active_file().enclosing_scope();
+}
+
+bool error_list_command()
+{
+    if (ErrorList::count() == 0 && JobList::count() == 0) {
+        info_message("No problems were reported by the last job");
+        return false;
+    }
+
+    // The screen library's windows display at most 80 columns.
+    const int columns = scr::number_of_columns() - 6;
+    const std::size_t width = static_cast<std::size_t>(columns > 76 ? 76 : columns);
+    int height = scr::number_of_rows() - 8;
+    if (height > 16)
+        height = 16;
+
+    // The entries are formatted only when they are shown. Those of a running job are added
+    // as it reports them.
+    const scr::FunctionSource problems(
+        []() { return ErrorList::count(); },
+        [width](long first, long number, std::vector<std::string> &entries) {
+            for (; number > 0 && first < ErrorList::count(); --number, ++first)
+                entries.push_back(ErrorList::describe(ErrorList::entry(first), width - 2));
+        });
+    scr::SelectWindow window;
+    window.set("Problems", &problems);
+    window.open(4, 4, static_cast<int>(width), height, scr::BLACK | scr::REV_WHITE, scr::WHITE,
+                scr::SINGLE_LINE);
+    window.set_current_line(std::max(ErrorList::current(), 0L));
+    window.set_idle([]() {
+        const long old_count = ErrorList::count();
+        JobList::poll();
+        return ErrorList::count() != old_count;
+    });
+    const int choice = window.select();
+    window.close();
+    if ((choice != scr::K_RETURN && choice != scr::K_CRETURN) || ErrorList::count() == 0)
+        return false;
+    return ErrorList::jump(window.current_line());
+}
+
 bool error_message_command()
 {
     static Parameter parameter("MESSAGE TEXT:");
@@ -53,6 +106,35 @@ bool execute_file_command()
     return true;
 }
 
+bool execute_lua_command()
+{
+    if (restricted_mode) {
+        error_message("Can't execute Lua code in restricted mode");
+        return false;
+    }
+
+    static Parameter parameter("LUA CODE:");
+
+    if (parameter.get() == false)
+        return false;
+    return LuaEngine::run_text(parameter.value());
+}
+
+bool execute_lua_file_command()
+{
+    if (restricted_mode) {
+        error_message("Can't execute Lua files in restricted mode");
+        return false;
+    }
+
+    static Parameter parameter("LUA FILE:");
+
+    if (parameter.get() == false)
+        return false;
+    std::string parameter_value = parameter.value();
+    return LuaEngine::run_file(parameter_value.c_str());
+}
+
 bool execute_macro_command()
 {
     if (restricted_mode) {
@@ -95,6 +177,15 @@ bool external_command_command()
     if (yfile_flag)
         write_yfile();
     FileList::save_changes();
+
+    // A command ending with '&' runs in the background with its output collected in a file.
+    const std::string::size_type last = command.find_last_not_of(' ');
+    if (last != std::string::npos && command[last] == '&' &&
+        (last == 0 || command[last - 1] != '&')) {
+        command.erase(last);
+        return JobList::start(command);
+    }
+
     scr::clear_screen();
 
     // Scr...() functions OFF. All I/O with standard functions!
@@ -112,8 +203,9 @@ bool external_command_command()
     scr::on();
 
     scr::clear_screen();
+    WindowList::invalidate();
     FileList::reload_files();
-    FileList::active_file().display();
+    WindowList::display();
 
     return true;
 }
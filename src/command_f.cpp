@@ -3,19 +3,38 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cstdlib>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <new>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include <screen/ItemSource.hpp>
+#include <screen/SelectWindow.hpp>
 #include <screen/screen.hpp>
 
+#include "DiskEditFile.hpp"
+#include "DocumentStats.hpp"
+#include "EditBuffer.hpp"
 #include "EditFile.hpp"
+#include "ExternalFilter.hpp"
 #include "FileList.hpp"
+#include "FuzzyMatcher.hpp"
+#include "LineInterner.hpp"
+#include "PathIndex.hpp"
+#include "Renderer.hpp"
+#include "SymbolIndex.hpp"
+#include "Utf8.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
 #include "global.hpp"
+#include "help.hpp"
 #include "support.hpp"
-#include "yfile.hpp"
 
 bool filelist_info_command()
 {
@@ -25,8 +44,58 @@ bool filelist_info_command()
 
 bool file_info_command()
 {
-    error_message("Not implemented");
-    return false;
+    YEditFile &the_file = FileList::active_file();
+    static const char *const ending_names[] = {"LF", "CRLF", "CR"};
+    const LineInterner::Savings &interned = the_file.interned_lines();
+    DocumentStats::Totals totals;
+    try {
+        totals = the_file.statistics();
+    }
+    catch (std::bad_alloc &) {
+        memory_message("Can't count the words of the file");
+        return false;
+    }
+
+    // The report is shown in the same viewer as the help screens.
+    std::vector<std::string> lines;
+    char line[128];
+    std::snprintf(line, sizeof(line), "File:           %.100s", the_file.name());
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Lines:          %ld", the_file.line_count());
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Characters:     %llu",
+                  static_cast<unsigned long long>(totals.characters));
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Words:          %llu",
+                  static_cast<unsigned long long>(totals.words));
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Longest line:   %zu", totals.longest);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Modified:       %s", the_file.changed() ? "yes" : "no");
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Line ending:    %s",
+                  ending_names[the_file.line_ending()]);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Shared lines:   %ld (%zu KB saved when read)",
+                  interned.lines, (interned.bytes + 1023) / 1024);
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Line interning: %s",
+                  DiskEditFile::is_interning() ? "on" : "off");
+    lines.push_back(line);
+    std::snprintf(line, sizeof(line), "Undo history:   %s",
+                  DiskEditFile::is_keeping_history() ? "kept when saved" : "not kept");
+    lines.push_back(line);
+
+    std::vector<const char *> screen;
+    for (const std::string &text : lines)
+        screen.push_back(text.c_str());
+    screen.push_back(nullptr);
+
+    HelpScreen report{screen.data(), nullptr, nullptr};
+    report.next_screen = &report;
+    report.previous_screen = &report;
+    display_screens(&report, &report, 1);
+    return true;
 }
 
 bool file_insert_command()
@@ -51,82 +120,55 @@ bool filter_command()
         return false;
     }
 
-    bool return_value = true;
     YEditFile &the_file = FileList::active_file();
 
     static Parameter parameter("FILTER COMMAND:");
     if (parameter.get() == false)
         return false;
     std::string command = parameter.value();
-
-    // Prepare command.
     insert_AWK(command);
-    command += " <STDIN$.TMP >STDOUT$.TMP";
-
-    // Save all information to disk. Abort if STDIN$.TMP cannot be created.
-    if (yfile_flag)
-        write_yfile();
-    FileList::save_changes();
-    if (the_file.get_block_state()) {
-        if (the_file.save("STDIN$.TMP", YEditFile::BLOCK_ONLY) == false)
-            return false;
-    }
-    else {
-        if (the_file.save("STDIN$.TMP") == false)
-            return false;
-    }
-
-    // Prepare display.
-    scr::clear_screen();
 
-    // Scr...() functions OFF. All I/O done with standard functions.
-    scr::off();
+    // The block (or the whole file) is given to the command directly through a pipe.
+    const bool block_only = the_file.get_block_state();
+    std::string input;
+    the_file.get_text(input, block_only ? YEditFile::BLOCK_ONLY : YEditFile::ALL);
 
-    // Execute command and ask for user confirmation. Ch holds the user's response.
-    int ch;
-
-    std::printf("%s\n", command.c_str());
-    int exit_status = std::system(command.c_str());
-    std::printf("\n********************************* ");
-    std::printf("\n Command exited with status: %d", exit_status);
-    std::printf("\n***** Do Replacement? [y]/n ***** ");
-
-    // Get the user's response and eat the rest of the line.
-    ch = std::getchar();
-    if (ch != '\n') {
-        while (std::getchar() != '\n') /* Null */
-            ;
+    ExternalFilter filter(command);
+    bool return_value = filter.run(input);
+    if (!return_value) {
+        error_message("Can't run %s", command.c_str());
+        return false;
     }
-
-    // Scr...() functions ON. All I/O done with the Scr package.
-    scr::on();
-
-    scr::clear_screen();
-    FileList::reload_files();
-
-    // Perform the replacement.
-    if (ch != 'n' && ch != 'N') {
-        if (the_file.get_block_state()) {
-            the_file.delete_block();
-            the_file.toggle_block();
-        }
-        else {
-            the_file.top_of_file();
-            the_file.toggle_block();
-            the_file.bottom_of_file();
-            the_file.delete_block();
-            the_file.toggle_block();
-            the_file.top_of_file();
-        }
-        return_value = the_file.load("STDOUT$.TMP");
+    if (filter.status() != 0) {
+        // Show the first line of the command's complaint, if any, and leave the text alone.
+        const std::string &errors = filter.errors();
+        const std::string complaint = errors.substr(0, errors.find('\n'));
+        if (complaint.empty())
+            error_message("Command exited with status %d", filter.status());
+        else
+            error_message("Command exited with status %d: %s", filter.status(),
+                          complaint.c_str());
+        return false;
     }
 
-    // Trash the temporary files.
-    std::remove("STDIN$.TMP");
-    std::remove("STDOUT$.TMP");
+    // Replace the text with the command's output. Undo restores the original.
+    if (block_only) {
+        the_file.delete_block();
+        the_file.toggle_block();
+    }
+    else {
+        the_file.top_of_file();
+        the_file.toggle_block();
+        the_file.bottom_of_file();
+        the_file.delete_block();
+        the_file.toggle_block();
+        the_file.top_of_file();
+    }
+    const std::string &output = filter.output();
+    return_value = the_file.insert_text(output.data(), output.size());
 
     // Update display.
-    the_file.display();
+    WindowList::display();
     return return_value;
 }
 
@@ -160,6 +202,114 @@ bool find_file_command()
     return load_files(argv);
 }
 
+bool find_symbol_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    static Parameter parameter("SYMBOL TO FIND (blank for the word at the cursor):");
+    if (parameter.get() == false)
+        return false;
+
+    std::string name = parameter.value();
+    if (name.empty()) {
+        const EditBuffer *const line = the_file.line_at(the_file.CP().cursor_line());
+        if (line != nullptr) {
+            const std::string_view text = line->view();
+            const auto is_word = [&text](std::size_t offset) {
+                const unsigned char ch = static_cast<unsigned char>(text[offset]);
+                return std::isalnum(ch) || ch == '_';
+            };
+            std::size_t start = std::min(
+                line->offset_of(the_file.CP().cursor_column(), the_file.tab_distance()),
+                text.size());
+            std::size_t end = start;
+            while (start > 0 && is_word(start - 1))
+                --start;
+            while (end < text.size() && is_word(end))
+                ++end;
+            name.assign(text.substr(start, end - start));
+        }
+        if (name.empty()) {
+            error_message("No symbol at the cursor");
+            return false;
+        }
+    }
+
+    std::vector<SymbolIndex::Symbol> found;
+    if (!SymbolIndex::find(name, found))
+        return false;
+    if (found.empty()) {
+        error_message("No definition of %.100s", name.c_str());
+        return false;
+    }
+    if (found.size() == 1)
+        return SymbolIndex::jump(found.front());
+
+    // The screen library's windows display at most 80 columns.
+    const int columns = scr::number_of_columns() - 6;
+    const std::size_t width = static_cast<std::size_t>(columns > 76 ? 76 : columns);
+    int height = scr::number_of_rows() - 8;
+    if (height > 16)
+        height = 16;
+
+    const scr::FunctionSource definitions(
+        [&found]() { return static_cast<long>(found.size()); },
+        [&found, width](long first, long number, std::vector<std::string> &entries) {
+            for (; number > 0 && first < static_cast<long>(found.size()); --number, ++first) {
+                const SymbolIndex::Symbol &symbol = found[static_cast<std::size_t>(first)];
+                std::string entry = symbol.file;
+                if (symbol.line >= 0)
+                    entry += ":" + std::to_string(symbol.line + 1);
+                entry += " (";
+                entry.push_back(symbol.kind);
+                entry += ")";
+                if (entry.size() > width - 2)
+                    entry.resize(width - 2);
+                entries.push_back(entry);
+            }
+        });
+    scr::SelectWindow window;
+    window.set(name.c_str(), &definitions);
+    window.open(4, 4, static_cast<int>(width), height, scr::BLACK | scr::REV_WHITE, scr::WHITE,
+                scr::SINGLE_LINE);
+    const int choice = window.select();
+    window.close();
+    if (choice != scr::K_RETURN && choice != scr::K_CRETURN)
+        return false;
+    return SymbolIndex::jump(found[static_cast<std::size_t>(window.current_line())]);
+}
+
+bool fold_procedures_command()
+{
+    return FileList::active_file().fold_procedures();
+}
+
+bool follow_file_command()
+{
+    YEditFile &the_file = FileList::active_file();
+
+    if (the_file.is_following()) {
+        the_file.stop_following();
+        info_message("No longer following %s", the_file.name());
+        return true;
+    }
+
+    long line_limit;
+    static Parameter parameter("LINES TO KEEP (0 FOR ALL):");
+    if (parameter.get_integer(line_limit) == false)
+        return false;
+    if (line_limit < 0) {
+        error_message("The number of lines to keep can't be negative");
+        return false;
+    }
+
+    if (the_file.changed()) {
+        if (confirm_message("Changes will be lost. Continue? [y]/n", 'N', false) == false)
+            return false;
+    }
+    the_file.set_block_state(false);
+    return the_file.start_following(the_file.name(), line_limit);
+}
+
 bool foreground_color_command()
 {
     YEditFile &the_file = FileList::active_file();
@@ -216,3 +366,149 @@ bool foreground_color_command()
     the_file.set_color(current_color);
     return true;
 }
+
+bool frame_info_command()
+{
+    // The report is shown in the same viewer as the help screens.
+    const std::vector<std::string> lines = Renderer::report();
+    std::vector<const char *> screen;
+    for (const std::string &line : lines)
+        screen.push_back(line.c_str());
+    screen.push_back(nullptr);
+
+    HelpScreen frames{screen.data(), nullptr, nullptr};
+    frames.next_screen = &frames;
+    frames.previous_screen = &frames;
+    display_screens(&frames, &frames, 1);
+    return true;
+}
+
+// The fuzzy finder ranks this many of the best matching paths.
+static const std::size_t finder_paths = 500;
+
+// The time spent matching after each keystroke. Whatever is left over is done while waiting for
+// the next keystroke.
+static const std::chrono::milliseconds finder_budget(12);
+
+//! Formats a path for the finder, keeping the end of paths that are too wide.
+static std::string finder_entry(const std::string_view path, const std::size_t width)
+{
+    if (path.size() <= width)
+        return std::string(path);
+    std::string entry("...");
+    entry += path.substr(path.size() - (width - entry.size()));
+    return entry;
+}
+
+/*!
+ * The files below the current directory are listed in the background while the user types part
+ * of a file's name. The best matches are shown as the user types, and can be chosen as with
+ * the search_files command.
+ */
+bool fuzzy_find_command()
+{
+    PathIndex index(".");
+    FuzzyMatcher matcher(finder_paths);
+    std::string query;
+    bool walking = true;
+    bool matching = true;
+
+    int height = scr::number_of_rows() - 8;
+    if (height > 16)
+        height = 16;
+    const int columns = (scr::number_of_columns() - 6 > 76) ? 76 : scr::number_of_columns() - 6;
+    const std::size_t width = static_cast<std::size_t>(columns - 2); // Less the borders.
+
+    // The entries are formatted only when they are shown.
+    const scr::FunctionSource results(
+        [&]() { return static_cast<long>(matcher.best().size()); },
+        [&](long first, long number, std::vector<std::string> &entries) {
+            const std::vector<std::size_t> &best = matcher.best();
+            for (; number > 0 && first < static_cast<long>(best.size()); --number, ++first)
+                entries.push_back(
+                    finder_entry(index.path(best[static_cast<std::size_t>(first)]), width));
+        });
+
+    scr::SelectWindow window;
+    window.set("Find File", &results);
+    window.open(4, 4, columns, height, scr::BLACK | scr::REV_WHITE, scr::WHITE,
+                scr::SINGLE_LINE);
+
+    // Shows the query and the number of matches on the bottom border.
+    auto show_query = [&]() {
+        std::string status = " " + std::to_string(matcher.match_count()) + "/" +
+                             std::to_string(index.size()) + (walking ? "+ " : " ");
+        std::string line = " " + query + "_ ";
+        const std::size_t room = width - 2;
+        if (line.size() + status.size() > room)
+            line.erase(1, line.size() + status.size() - room);
+        line.append(room - line.size() - status.size(), '\xC4');
+        line += status;
+        scr::write_span(window.row() + window.height(), window.column() + 1, line.data(),
+                        std::min(line.size(), room), window.border_color());
+    };
+
+    // Adds paths found by the walk and continues matching. Returns true if the entries changed.
+    auto update = [&]() {
+        const std::size_t old_size = index.size();
+        if (walking)
+            walking = index.update();
+        if (!matching && index.size() == old_size)
+            return false;
+        matching = !matcher.update(index, finder_budget);
+        show_query();
+        return true;
+    };
+    update();
+    window.set_idle(update);
+
+    int choice;
+    long top_line = -1L;
+    for (;;) {
+        choice = window.select(top_line);
+        top_line = -1L;
+        if (choice == scr::K_ESC)
+            break;
+        if (choice == scr::K_RETURN || choice == scr::K_CRETURN) {
+            if (!matcher.best().empty())
+                break;
+            continue;
+        }
+        if (choice == scr::K_BACKSPACE || choice == 127) {
+            if (query.empty())
+                continue;
+            query.erase(Utf8::previous(query, query.size()));
+        }
+        else if (choice >= ' ' && choice <= 0xFF) {
+            query.push_back(static_cast<char>(choice));
+        }
+        else {
+            continue;
+        }
+
+        // Matching starts over from the best entry.
+        matcher.set_query(query);
+        matching = !matcher.update(index, finder_budget);
+        window.set_current_line(0);
+        top_line = 0;
+        show_query();
+    }
+
+    std::string path;
+    if (choice != scr::K_ESC)
+        path = index.path(matcher.best()[static_cast<std::size_t>(window.current_line())]);
+    window.close();
+    if (path.empty())
+        return false;
+
+    // Load the file if necessary, as find_file would.
+    if (!FileList::lookup(path.c_str())) {
+        if (restricted_mode) {
+            error_message("Can't load additional files in restricted mode");
+            return false;
+        }
+        if (!FileList::new_file(path.c_str()))
+            return false;
+    }
+    return true;
+}
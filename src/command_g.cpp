@@ -3,23 +3,23 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cstdlib>
+#include <algorithm>
 
 #include "FileList.hpp"
+#include "HexImage.hpp"
 #include "YEditFile.hpp"
 #include "parameter_stack.hpp"
 
 bool goto_column_command()
 {
-    unsigned column_value;
+    long number;
 
     static Parameter parameter("COLUMN NUMBER:");
-    if (parameter.get() == false)
+    if (parameter.get_integer(number) == false)
         return false;
-    std::string parameter_value = parameter.value();
 
-    // Decode text entered by user (User see first column as line 1).
-    column_value = static_cast<unsigned>(std::atol(parameter_value.c_str()) - 1U);
+    // User sees first column as column 1.
+    unsigned column_value = static_cast<unsigned>(number - 1L);
 
     // Perform the action.
     YEditFile &the_file = FileList::active_file();
@@ -30,7 +30,12 @@ bool goto_column_command()
 
 bool goto_file_end_command()
 {
-    FileList::active_file().bottom_of_file();
+    YEditFile &the_file = FileList::active_file();
+    the_file.bottom_of_file();
+
+    // A file viewed as bytes has rows rather than lines.
+    if (const HexImage *const bytes = the_file.hex_image())
+        the_file.CP().jump_to_line(std::max(bytes->rows() - 1L, 0L));
     return true;
 }
 
@@ -43,15 +48,14 @@ bool goto_file_start_command()
 
 bool goto_line_command()
 {
-    long line_value;
+    long number;
 
     static Parameter parameter("LINE NUMBER:");
-    if (parameter.get() == false)
+    if (parameter.get_integer(number) == false)
         return false;
-    std::string parameter_value = parameter.value();
 
-    // Decode text entered by user (User sees first line as line 1).
-    line_value = std::atol(parameter_value.c_str()) - 1L;
+    // User sees first line as line 1.
+    long line_value = number - 1L;
 
     // Perform the action.
     FileList::active_file().CP().jump_to_line(line_value);
@@ -3,14 +3,97 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cctype>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <screen/ItemSource.hpp>
+#include <screen/SelectWindow.hpp>
+#include <screen/screen.hpp>
+
 #include "command.hpp"
+#include "command_table.hpp"
 #include "help.hpp"
+#include "parameter_stack.hpp"
+#include "support.hpp"
+
+#define MAX_HELP_TOPICS 100 // The most help lines listed by help_search.
+
+// Declare as static so Y remembers the last screen watched.
+static const HelpScreen *current_help = h_screens;
 
 bool help_command()
 {
-    // Declare as static so Y remembers the last screen watched.
-    static const HelpScreen *current = h_screens;
+    current_help = display_screens(h_screens, current_help, 10);
+    return true;
+}
+
+bool help_search_command()
+{
+    static Parameter parameter("HELP SEARCH:");
+
+    if (parameter.get() == false)
+        return false;
+    std::string query = parameter.value();
+
+    // Command names are all lower case.
+    std::string prefix;
+    for (const char ch : query) {
+        if (!std::isspace(static_cast<unsigned char>(ch)))
+            prefix.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
+    }
+
+    HelpTopic topics[MAX_HELP_TOPICS];
+    const std::size_t topic_count = find_help(query, topics, MAX_HELP_TOPICS);
+    const std::pair<int, int> commands =
+        prefix.empty() ? std::pair<int, int>(0, 0) : find_commands(prefix);
+    const long command_count = commands.second - commands.first;
+    if (topic_count == 0 && command_count == 0) {
+        error_message("Nothing in the help matches %.100s", query.c_str());
+        return false;
+    }
+
+    // The help lines are listed first, then the commands.
+    const long count = static_cast<long>(topic_count) + command_count;
+    const scr::FunctionSource results(
+        [count]() { return count; },
+        [&](long first, long number, std::vector<std::string> &entries) {
+            for (; number > 0 && first < count; --number, ++first) {
+                const int command = static_cast<int>(first - static_cast<long>(topic_count));
+                if (command < 0)
+                    entries.emplace_back(topics[first].text);
+                else
+                    entries.push_back("Command: " +
+                                      std::string(command_name(commands.first + command)));
+            }
+        });
+
+    int height = scr::number_of_rows() - 8;
+    if (height > 16)
+        height = 16;
+    scr::SelectWindow window;
+    window.set("Help", &results);
+    window.open(4, 4, 64, height, scr::BLACK | scr::REV_WHITE, scr::WHITE, scr::SINGLE_LINE);
+    int choice;
+    do {
+        choice = window.select(0);
+    } while (choice != scr::K_ESC && choice != scr::K_RETURN && choice != scr::K_CRETURN);
+    const long chosen = window.current_line();
+    window.close();
+    if (choice == scr::K_ESC)
+        return true;
 
-    current = display_screens(h_screens, current, 10);
+    // A help line is shown on its screen. A command is run.
+    if (chosen >= static_cast<long>(topic_count)) {
+        execute_command(commands.first + static_cast<int>(chosen - topic_count));
+        return true;
+    }
+    const HelpTopic &topic = topics[chosen];
+    const HelpScreen *const shown =
+        display_screens(topic.base, topic.screen, topic.size, topic.line);
+    if (topic.base == h_screens)
+        current_help = shown;
     return true;
 }
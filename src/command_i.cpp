@@ -6,28 +6,33 @@
 #include <cstdlib>
 
 #include "FileList.hpp"
+#include "SymbolIndex.hpp"
+#include "WordSource.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
+#include "global.hpp"
+#include "macro_stack.hpp"
 #include "parameter_stack.hpp"
+#include "support.hpp"
 
-bool input_command()
+//! Writes a tags file for the sources in the current directory tree (see SymbolIndex).
+bool index_symbols_command()
 {
-    const char *input_string;
+    if (restricted_mode) {
+        error_message("Can't write files in restricted mode");
+        return false;
+    }
+    return SymbolIndex::generate();
+}
 
+//! Pushes a line typed by the user. The macro is suspended until it is typed (see PromptWord).
+bool input_command()
+{
     static Parameter parameter("PROMPT:");
     if (parameter.get() == false)
         return false;
-    std::string parameter_value = parameter.value();
-
-    Parameter new_string(parameter_value.c_str());
-    if (new_string.get(false) == false)
-        input_string = "";
-    else {
-        std::string new_value = new_string.value();
-        input_string = new_value.c_str();
-    }
 
-    parameter_stack.push(input_string);
+    macro_stack.push(new PromptWord(parameter.value()));
     return true;
 }
 
@@ -52,7 +57,7 @@ bool insert_file_command()
         the_file.toggle_block();
     }
 
-    bool return_value = the_file.load(parameter_value.c_str());
+    bool return_value = the_file.insert_file(parameter_value.c_str());
     if (return_value == true)
         the_file.mark_as_changed();
     return return_value;
@@ -3,8 +3,14 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <string>
+
+#include "Plugins.hpp"
 #include "command.hpp"
+#include "global.hpp"
 #include "help.hpp"
+#include "parameter_stack.hpp"
+#include "support.hpp"
 
 bool legal_info_command()
 {
@@ -14,3 +20,18 @@ bool legal_info_command()
     current = display_screens(l_screens, current, 2);
     return true;
 }
+
+bool load_plugin_command()
+{
+    if (restricted_mode) {
+        error_message("Can't load plugins in restricted mode");
+        return false;
+    }
+
+    static Parameter parameter("PLUGIN FILE:");
+
+    if (parameter.get() == false)
+        return false;
+    const std::string parameter_value = parameter.value();
+    return Plugins::load(parameter_value.c_str());
+}
@@ -0,0 +1,95 @@
+/*! \file    command_m.cpp
+ *  \brief   Implementation of the 'm' command functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Allocations.hpp"
+#include "FileList.hpp"
+#include "MacroProfile.hpp"
+#include "YEditFile.hpp"
+#include "command.hpp"
+#include "parameter_stack.hpp"
+#include "support.hpp"
+
+bool macro_profile_command()
+{
+    if (MacroProfile::active()) {
+        MacroProfile::stop();
+        info_message("Macro profiling stopped");
+    }
+    else {
+        MacroProfile::start();
+        info_message("Macro profiling started");
+    }
+    return true;
+}
+
+bool macro_profile_info_command()
+{
+    // The order is given by a letter: C (calls), I (inclusive time), E (exclusive time), D
+    // (depth of the parameter stack), or N (name). Inclusive time is the default.
+    static Parameter parameter("SORT BY (C, I, E, D, N):");
+    if (parameter.get() == false)
+        return false;
+    const std::string parameter_value = parameter.value();
+    MacroProfile::Order order = MacroProfile::BY_INCLUSIVE;
+    const char letter = parameter_value.empty() ? 'I' : parameter_value[0];
+    switch (std::toupper(static_cast<unsigned char>(letter))) {
+    case 'C':
+        order = MacroProfile::BY_CALLS;
+        break;
+    case 'I':
+        break;
+    case 'E':
+        order = MacroProfile::BY_EXCLUSIVE;
+        break;
+    case 'D':
+        order = MacroProfile::BY_DEPTH;
+        break;
+    case 'N':
+        order = MacroProfile::BY_NAME;
+        break;
+    default:
+        error_message("Unknown order %s", parameter_value.c_str());
+        return false;
+    }
+
+    // Each report goes in a new file so that it can be compared with the earlier ones.
+    static unsigned last_number = 0;
+    char name[32];
+    std::snprintf(name, sizeof(name), "*macro-profile%u*", ++last_number);
+    const std::vector<std::string> lines = MacroProfile::report(order);
+    if (!FileList::new_file(name))
+        return false;
+    YEditFile &report = FileList::active_file();
+    report.set_read_only(true);
+
+    std::string text;
+    for (const std::string &line : lines)
+        text.append(line).append("\n");
+    return report.append_text(text.data(), text.size());
+}
+
+bool memory_info_command()
+{
+    // Each report goes in a new file so that it can be compared with the earlier ones. The
+    // report is taken before the file is made so that the file's own memory is not in it.
+    static unsigned last_number = 0;
+    char name[32];
+    std::snprintf(name, sizeof(name), "*memory%u*", ++last_number);
+    const std::vector<std::string> lines = Allocations::report();
+    if (!FileList::new_file(name))
+        return false;
+    YEditFile &report = FileList::active_file();
+    report.set_read_only(true);
+
+    std::string text;
+    for (const std::string &line : lines)
+        text.append(line).append("\n");
+    return report.append_text(text.data(), text.size());
+}
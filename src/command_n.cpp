@@ -3,11 +3,17 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cstddef>
 
 #include "FileList.hpp"
+#include "Diagnostics.hpp"
+#include "ErrorList.hpp"
+#include "JobList.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
+#include "support.hpp"
 
 bool new_line_command()
 {
@@ -47,6 +53,54 @@ bool new_line_command()
     return return_value;
 }
 
+bool next_diagnostic_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    const Diagnostics &problems = the_file.diagnostics();
+
+    // Find the first problem after the cursor, wrapping back to the top of the file.
+    const long line = the_file.CP().cursor_line();
+    const EditBuffer *const current_line = the_file.line_at(line);
+    const std::size_t offset =
+        (current_line == nullptr)
+            ? 0
+            : current_line->offset_of(the_file.CP().cursor_column(), the_file.tab_distance());
+    const Diagnostics::Mark *mark = problems.following(line, offset);
+    if (mark == nullptr)
+        mark = problems.first();
+    if (mark == nullptr) {
+        error_message("No problems reported in this file");
+        return false;
+    }
+
+    const EditBuffer *const marked_line = the_file.line_at(mark->line);
+    the_file.CP().jump_to_line(mark->line);
+    if (marked_line != nullptr)
+        the_file.CP().jump_to_column(static_cast<unsigned>(marked_line->column_of(
+            std::min(mark->start, marked_line->length()), the_file.tab_distance())));
+    if (mark->severity == Diagnostics::ERROR)
+        error_message("%.120s", problems.message(*mark).c_str());
+    else
+        warning_message("%.120s", problems.message(*mark).c_str());
+    return true;
+}
+
+bool next_error_command()
+{
+    JobList::poll();
+    const long index = ErrorList::next();
+    if (index < 0) {
+        info_message("No problems were reported by the last job");
+        return false;
+    }
+    return ErrorList::jump(index);
+}
+
+bool next_field_command()
+{
+    return FileList::active_file().next_field();
+}
+
 bool next_file_command()
 {
     FileList::next();
@@ -57,3 +111,9 @@ bool next_procedure_command()
 {
     return FileList::active_file().next_procedure();
 }
+
+bool next_window_command()
+{
+    WindowList::next();
+    return true;
+}
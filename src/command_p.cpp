@@ -3,20 +3,37 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <screen/screen.hpp>
+
 #include "FileList.hpp"
+#include "Profiler.hpp"
+#include "Startup.hpp"
 #include "YEditFile.hpp"
 #include "clipboard.hpp"
 #include "command.hpp"
 
 bool page_down_command()
 {
-    FileList::active_file().CP().page_down();
+    YEditFile &the_file = FileList::active_file();
+    if (the_file.moves_by_rows())
+        the_file.move_rows(the_file.CP().window_height(), true);
+    else
+        the_file.CP().page_down();
     return true;
 }
 
 bool page_up_command()
 {
-    FileList::active_file().CP().page_up();
+    YEditFile &the_file = FileList::active_file();
+    if (the_file.moves_by_rows())
+        the_file.move_rows(-the_file.CP().window_height(), true);
+    else
+        the_file.CP().page_up();
     return true;
 }
 
@@ -37,12 +54,29 @@ bool paste_block_command()
     YEditFile &The_File = FileList::active_file();
 
     if (The_File.get_block_state()) {
-        The_File.delete_block();
+        if (The_File.column_block())
+            The_File.delete_columns();
+        else
+            The_File.delete_block();
         The_File.toggle_block();
     }
+    if (clipboard_columns) {
+        The_File.insert_columns(clipboard);
+        return true;
+    }
     return The_File.insert_block(clipboard);
 }
 
+bool paste_text_command()
+{
+    return FileList::active_file().paste_text(scr::pasted_text());
+}
+
+bool previous_field_command()
+{
+    return FileList::active_file().previous_field();
+}
+
 bool previous_file_command()
 {
     FileList::previous();
@@ -53,3 +87,24 @@ bool previous_procedure_command()
 {
     return FileList::active_file().previous_procedure();
 }
+
+bool profile_info_command()
+{
+    // Each report goes in a new file so that it can be compared with the earlier ones.
+    static unsigned last_number = 0;
+    char name[32];
+    std::snprintf(name, sizeof(name), "*profile%u*", ++last_number);
+    std::vector<std::string> lines = Profiler::report();
+    lines.push_back("");
+    for (std::string &line : Startup::report())
+        lines.push_back(std::move(line));
+    if (!FileList::new_file(name))
+        return false;
+    YEditFile &report = FileList::active_file();
+    report.set_read_only(true);
+
+    std::string text;
+    for (const std::string &line : lines)
+        text.append(line).append("\n");
+    return report.append_text(text.data(), text.size());
+}
@@ -10,6 +10,9 @@
 #include <screen/screen.hpp>
 
 #include "FileList.hpp"
+#include "LineSort.hpp"
+#include "WindowList.hpp"
+#include "YEditFile.hpp"
 #include "command.hpp"
 #include "global.hpp"
 #include "help.hpp"
@@ -17,6 +20,15 @@
 #include "support.hpp"
 #include "yfile.hpp"
 
+bool recent_file_command()
+{
+    if (!FileList::recent()) {
+        error_message("No other file has been used");
+        return false;
+    }
+    return true;
+}
+
 bool redirect_from_command()
 {
     if (restricted_mode) {
@@ -67,6 +79,7 @@ bool redirect_from_command()
     scr::on();
 
     scr::clear_screen();
+    WindowList::invalidate();
     FileList::reload_files();
 
     // Perform the replacement.
@@ -84,7 +97,7 @@ bool redirect_from_command()
     std::remove("STDOUT$.TMP");
 
     // Update display.
-    the_file.display();
+    WindowList::display();
     return return_value;
 }
 
@@ -139,16 +152,38 @@ bool redirect_to_command()
     scr::on();
 
     scr::clear_screen();
+    WindowList::invalidate();
     FileList::reload_files();
 
     // Trash the temporary file.
     std::remove("STDIN$.TMP");
 
     // Update display.
-    FileList::active_file().display();
+    WindowList::display();
     return true;
 }
 
+bool redo_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    if (!the_file.redo()) {
+        info_message("Nothing to redo");
+        return false;
+    }
+    return true;
+}
+
+bool reformat_block_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    const bool return_value = the_file.reformat_block();
+
+    // Turn off block mode if it's on.
+    if (the_file.get_block_state())
+        the_file.toggle_block();
+    return return_value;
+}
+
 bool reformat_command()
 {
     YEditFile &the_file = FileList::active_file();
@@ -157,9 +192,7 @@ bool reformat_command()
 
 bool refresh_file_command()
 {
-    bool return_value;
     YEditFile &the_file = FileList::active_file();
-    FilePosition old_CP = the_file.CP();
 
     if (the_file.changed()) {
         if (confirm_message("Changes will be lost. Continue? [y]/n", 'N', false) == false)
@@ -169,25 +202,8 @@ bool refresh_file_command()
     // Make sure block mode is off.
     the_file.set_block_state(false);
 
-    // Erase entire file.
-    the_file.top_of_file();
-    the_file.toggle_block();
-    the_file.bottom_of_file();
-    the_file.delete_block();
-    the_file.toggle_block();
-
-    // Position cursor at the top of the file.
-    the_file.top_of_file();
-
-    // Load the file.
-    return_value = the_file.load(the_file.name());
-    the_file.set_timestamp(the_file.name());
-    the_file.mark_as_unchanged();
-
-    // Be sure cursor is positioned correctly.
-    the_file.CP() = old_CP;
-
-    return return_value;
+    // Only the lines that differ from the disk version are replaced.
+    return the_file.reload(the_file.name());
 }
 
 bool remove_file_command()
@@ -269,3 +285,11 @@ bool restricted_mode_command()
 
     return return_value;
 }
+
+bool reverse_lines_command()
+{
+    LineSort::Options options;
+    options.sort = false;
+    options.reverse = true;
+    return FileList::active_file().arrange_lines(options);
+}
@@ -3,34 +3,168 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <cctype>
 #include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
+#include <screen/ItemSource.hpp>
 #include <screen/MessageWindow.hpp>
+#include <screen/SelectWindow.hpp>
 #include <screen/screen.hpp>
 
+#include "BufferSearch.hpp"
+#include "FieldIndex.hpp"
 #include "FileList.hpp"
+#include "IncrementalSearch.hpp"
+#include "LanguageServer.hpp"
+#include "LineSort.hpp"
+#include "MacroTrace.hpp"
+#include "ProjectSearch.hpp"
+#include "Renderer.hpp"
+#include "SearchPattern.hpp"
+#include "Spelling.hpp"
+#include "UndoLog.hpp"
+#include "Utf8.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
 #include "global.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
 
-static void do_replacement(YEditFile &the_file, Parameter &search_parameter,
+//! Returns the SearchPattern options chosen with toggle_ignore_case and toggle_whole_word.
+static unsigned search_options()
+{
+    return (search_ignore_case ? SearchPattern::IGNORE_CASE : 0U) |
+           (search_whole_word ? SearchPattern::WHOLE_WORD : 0U);
+}
+
+//! Returns the given search string as a compiled pattern.
+/*!
+ * The string is a regular expression when regex_search is set, and it is compiled with the
+ * options of search_options(). The most recently used pattern
+ * is kept so that repeated searches for the same string (as with search_next) don't recompile
+ * it. A regular expression's cache of DFA states also survives from one search to the next.
+ * When highlight_matches is set the pattern's occurrences are highlighted in every file.
+ *
+ * \return nullptr if the string is not a valid regular expression. An error message has been
+ * displayed.
+ */
+static const SearchPattern *compiled_search(const std::string &search_value)
+{
+    static SearchPattern pattern;
+    static bool valid = true;
+
+    const SearchPattern::Mode mode =
+        regex_search ? SearchPattern::REGULAR_EXPRESSION : SearchPattern::LITERAL;
+    const unsigned options = search_options();
+    bool recompiled = false;
+    if (pattern.text() != search_value || pattern.mode() != mode ||
+        pattern.options() != options) {
+        valid = pattern.compile(search_value, mode, options);
+        recompiled = true;
+        if (!valid)
+            error_message("Bad regular expression: %s", pattern.error().c_str());
+    }
+    else if (!valid) {
+        error_message("Bad regular expression: %s", pattern.error().c_str());
+    }
+
+    // The occurrences of the pattern are shown if highlight_matches is set.
+    const SearchPattern *const shown = (highlight_matches && valid) ? &pattern : nullptr;
+    if (YEditFile::shown_matches() != shown || (recompiled && shown != nullptr))
+        YEditFile::show_matches(shown);
+    return valid ? &pattern : nullptr;
+}
+
+//! Returns the widest entry that can be shown in a list of search hits.
+static std::size_t hit_width()
+{
+    // The screen library's windows display at most 80 columns.
+    const int columns = scr::number_of_columns() - 6;
+    return static_cast<std::size_t>(columns > 76 ? 76 : columns);
+}
+
+//! Formats a search hit for display in the style of grep: "name:line: text".
+static std::string hit_entry(const std::string &name, long line, std::string_view text)
+{
+    std::string entry(name);
+    entry += ":" + std::to_string(line + 1) + ": ";
+    entry += text;
+    if (entry.length() > hit_width())
+        entry.resize(hit_width());
+    return entry;
+}
+
+//! Lets the user choose from a list of search hits while a background search adds to it.
+/*!
+ * \param title The title of the window showing the hits.
+ * \param results The entries shown. They are added by update.
+ * \param searching True while the background search continues. Maintained by update.
+ * \param update Called while waiting for keystrokes. Returns true if it added entries.
+ * \return The index of the chosen entry or -1 if there are no hits or none was chosen.
+ */
+static long choose_hit(const char *title, const scr::ItemSource &results,
+                       const bool &searching, const std::function<bool()> &update)
+{
+    // Wait for the first hit. A keystroke abandons the search.
+    while (searching && results.count() == 0) {
+        update();
+        if (scr::key_available(10)) {
+            scr::key();
+            info_message("Search cancelled");
+            return -1;
+        }
+    }
+    if (results.count() == 0) {
+        info_message("Not found");
+        return -1;
+    }
+
+    // Show the hits as they arrive and let the user choose one.
+    int height = scr::number_of_rows() - 8;
+    if (height > 16)
+        height = 16;
+    scr::SelectWindow window;
+    window.set(title, &results);
+    window.open(4, 4, static_cast<int>(hit_width()), height, scr::BLACK | scr::REV_WHITE,
+                scr::WHITE, scr::SINGLE_LINE);
+    window.set_idle(update);
+    const int choice = window.select();
+    window.close();
+    if (choice != scr::K_RETURN && choice != scr::K_CRETURN)
+        return -1;
+    return window.current_line();
+}
+
+//! Returns the column of a search hit found at the given offset in a line.
+static unsigned hit_column(YEditFile &the_file, const long line, const std::size_t offset)
+{
+    const EditBuffer *const text = the_file.line_at(line);
+    const unsigned tab = static_cast<unsigned>(the_file.tab_distance());
+    return static_cast<unsigned>(text != nullptr ? text->column_of(offset, tab) : offset);
+}
+
+static void do_replacement(YEditFile &the_file, std::size_t match_length,
                            Parameter &replace_parameter)
 {
-    std::string search_value = search_parameter.value();
     std::string replace_value = replace_parameter.value();
     unsigned i;
 
-    for (i = 0; i < search_value.length(); i++) {
+    for (i = 0; i < match_length; i++) {
         the_file.delete_char();
     }
     for (i = 0; i < replace_value.length(); i++) {
         the_file.insert_char(replace_value[i]);
-        the_file.CP().cursor_right();
+        if (!Utf8::is_continuation(replace_value[i]))
+            the_file.character_right();
     }
     return;
 }
@@ -81,6 +215,9 @@ bool search_and_replace_command()
         return false;
     std::string search_value = search_parameter.value();
     search_set = true;
+    const SearchPattern *pattern = compiled_search(search_value);
+    if (pattern == nullptr)
+        return false;
 
     if (replace_parameter.get() == false)
         return false;
@@ -109,82 +246,84 @@ bool search_and_replace_command()
     bool dont_question = false; // =true when user says to do all.
     bool done;                  // =true when no more instances found.
     bool wiggle;                // =true when CP must be adjusted to skip.
+    std::size_t match_length;   // Length of the text matched by the pattern.
 
     // See if there's a match in the range of lines of interest.
-    done = static_cast<bool>(!the_file.simple_search(search_value.c_str()));
+    done = static_cast<bool>(!the_file.search(*pattern, &match_length));
     if (the_file.CP().cursor_line() > bottom_line)
         done = true;
 
     wiggle = true;
     while (!stop && !done) {
-
-        if (dont_question) {
-            do_replacement(the_file, search_parameter, replace_parameter);
-            wiggle = false;
-        }
-
-        else {
-            FilePosition point = the_file.CP();
-
-            // Show the user what we've got.
-            the_file.display();
-
-            // Print the string into a holding buffer.
-            std::sprintf(buffer, "Replace with '%s'?  [y]/n/a", replace_value.c_str());
-
-            // Compute the desired line number of window's upper left corner.
-            int box_line = static_cast<int>((point.cursor_line() - point.window_line()) + 2);
-            box_line = (box_line > scr::number_of_rows() - 5) ? box_line - 4 : box_line + 1;
-
-            // Compute the desired column number of window's upper left corner.
-            int box_column = point.cursor_column() - point.window_column() + 2;
-            box_column = (box_column + std::strlen(buffer) + 6 >
-                          static_cast<std::size_t>(scr::number_of_columns() - 2))
-                             ? scr::number_of_columns() - 2 - std::strlen(buffer) - 6
-                             : box_column;
-
-            scr::MessageWindow prompt;
-            prompt.set(buffer, scr::MESSAGE_WINDOW_PROMPT);
-            switch (prompt.open(box_line, box_column)) {
-            case 'n':
-            case 'N':
-                break;
-
-            case scr::K_ESC:
-                stop = true;
-                break;
-
-            case 'a':
-            case 'A':
-                dont_question = true;
-                // Fall through to do this replacement.
-
-            default:
-                do_replacement(the_file, search_parameter, replace_parameter);
-                wiggle = false;
-
-                // Show the user the effect while s/he waits for next instance.
-                if (!dont_question)
-                    the_file.display();
-                break;
-            }
+        FilePosition point = the_file.CP();
+
+        // Show the user what we've got.
+        WindowList::display();
+
+        // Print the string into a holding buffer.
+        std::snprintf(
+            buffer, sizeof(buffer), "Replace with '%s'?  [y]/n/a", replace_value.c_str());
+
+        // Compute the desired line number of window's upper left corner.
+        int text_row, text_column;
+        WindowList::text_origin(text_row, text_column);
+        int box_line = static_cast<int>((point.cursor_line() - point.window_line()) + text_row);
+        box_line = (box_line > scr::number_of_rows() - 5) ? box_line - 4 : box_line + 1;
+
+        // Compute the desired column number of window's upper left corner.
+        int box_column = point.cursor_column() - point.window_column() + text_column;
+        box_column = (box_column + std::strlen(buffer) + 6 >
+                      static_cast<std::size_t>(scr::number_of_columns() - 2))
+                         ? scr::number_of_columns() - 2 - std::strlen(buffer) - 6
+                         : box_column;
+
+        scr::MessageWindow prompt;
+        prompt.set(buffer, scr::MESSAGE_WINDOW_PROMPT);
+        switch (prompt.open(box_line, box_column)) {
+        case 'n':
+        case 'N':
+            break;
+
+        case scr::K_ESC:
+            stop = true;
+            break;
+
+        case 'a':
+        case 'A':
+            // Replace this and all remaining instances in a single pass.
+            dont_question = true;
+            done = true;
+            info_message("%ld replacements made",
+                         the_file.replace_all(*pattern, replace_value, bottom_line));
+            break;
+
+        default:
+            do_replacement(the_file, match_length, replace_parameter);
+
+            // An empty match must still be skipped or it will be found again.
+            wiggle = (match_length == 0);
+
+            // Show the user the effect while s/he waits for next instance.
+            WindowList::display();
+            break;
         }
 
         // Try to get to next instance.
-        if (!stop) {
+        if (!stop && !done) {
 
             // Bump the CP if we didn't do a replacement to bypass the current instance.
+            const unsigned old_column = the_file.CP().cursor_column();
             if (wiggle)
-                the_file.CP().cursor_right();
+                the_file.character_right();
 
             // Find the next instance.
-            done = static_cast<bool>(!the_file.simple_search(search_value.c_str()));
+            done = static_cast<bool>(!the_file.search(*pattern, &match_length));
             if (the_file.CP().cursor_line() > bottom_line)
                 done = true;
 
             // Fix the CP adjustment if we are done so it looks nice for the user.
             if (done && wiggle)
-                the_file.CP().cursor_left();
+                the_file.CP().jump_to_column(old_column);
 
             // Assume user won't want to replace.
             wiggle = true;
@@ -203,6 +342,127 @@ bool search_and_replace_command()
     return return_value;
 }
 
+bool search_all_command()
+{
+    if (search_parameter.get() == false)
+        return false;
+    std::string search_value = search_parameter.value();
+    search_set = true;
+
+    const SearchPattern *pattern = compiled_search(search_value);
+    if (pattern == nullptr)
+        return false;
+
+    // Take the snapshots here. The worker threads never touch the file list itself.
+    std::vector<TextSnapshot> snapshots(FileList::count());
+    for (unsigned i = 0; i < snapshots.size(); ++i) {
+        YEditFile *file = FileList::file(i);
+        snapshots[i].name = file->name();
+        snapshots[i].lines = file->snapshot();
+    }
+    BufferSearch search(*pattern, std::move(snapshots));
+
+    std::vector<BufferSearch::Hit> hits;
+    bool searching = true;
+
+    // Collects new hits. Returns true if there are more to show.
+    auto update = [&]() {
+        if (!searching)
+            return false;
+        const std::size_t old_count = hits.size();
+        searching = search.collect(hits);
+        return hits.size() != old_count;
+    };
+
+    // The entries are formatted only when they are shown.
+    const scr::FunctionSource results(
+        [&]() { return static_cast<long>(hits.size()); },
+        [&](long first, long number, std::vector<std::string> &entries) {
+            for (; number > 0 && first < static_cast<long>(hits.size()); --number, ++first) {
+                const BufferSearch::Hit &hit = hits[static_cast<std::size_t>(first)];
+                entries.push_back(hit_entry(search.file(hit.file).name, hit.line,
+                                            search.line(hit.file, hit.line)));
+            }
+        });
+
+    const long choice = choose_hit("Search All Files", results, searching, update);
+    if (choice < 0)
+        return false;
+
+    // The files might have been rearranged, so find the selected one by name.
+    const BufferSearch::Hit &hit = hits[static_cast<std::size_t>(choice)];
+    if (!FileList::lookup(search.file(hit.file).name.c_str())) {
+        error_message("%s is no longer loaded", search.file(hit.file).name.c_str());
+        return false;
+    }
+    YEditFile &the_file = FileList::active_file();
+    the_file.CP().jump_to_line(hit.line);
+    the_file.CP().jump_to_column(hit_column(the_file, hit.line, hit.column));
+    return true;
+}
+
+bool search_files_command()
+{
+    static Parameter directory_parameter("SEARCH FILES UNDER DIRECTORY:");
+
+    if (search_parameter.get() == false)
+        return false;
+    std::string search_value = search_parameter.value();
+    search_set = true;
+
+    const SearchPattern *pattern = compiled_search(search_value);
+    if (pattern == nullptr)
+        return false;
+
+    if (directory_parameter.get() == false)
+        return false;
+    std::string directory = directory_parameter.value();
+    if (directory.empty())
+        directory = ".";
+
+    ProjectSearch search(*pattern, directory);
+    std::vector<ProjectSearch::Hit> hits;
+    bool searching = true;
+
+    // Collects new hits. Returns true if there are more to show.
+    auto update = [&]() {
+        if (!searching)
+            return false;
+        const std::size_t old_count = hits.size();
+        searching = search.collect(hits);
+        return hits.size() != old_count;
+    };
+
+    // The entries are formatted only when they are shown.
+    const scr::FunctionSource results(
+        [&]() { return static_cast<long>(hits.size()); },
+        [&](long first, long number, std::vector<std::string> &entries) {
+            for (; number > 0 && first < static_cast<long>(hits.size()); --number, ++first) {
+                const ProjectSearch::Hit &hit = hits[static_cast<std::size_t>(first)];
+                entries.push_back(hit_entry(hit.path, hit.line, hit.text));
+            }
+        });
+
+    const long choice = choose_hit("Search Files", results, searching, update);
+    if (choice < 0)
+        return false;
+
+    // Load the file if necessary, as find_file would.
+    const ProjectSearch::Hit &hit = hits[static_cast<std::size_t>(choice)];
+    if (!FileList::lookup(hit.path.c_str())) {
+        if (restricted_mode) {
+            error_message("Can't load additional files in restricted mode");
+            return false;
+        }
+        if (!FileList::new_file(hit.path.c_str()))
+            return false;
+    }
+    YEditFile &the_file = FileList::active_file();
+    the_file.CP().jump_to_line(hit.line);
+    the_file.CP().jump_to_column(hit_column(the_file, hit.line, hit.column));
+    return true;
+}
+
 bool search_first_command()
 {
     bool return_value = true;
@@ -213,14 +473,64 @@ bool search_first_command()
     std::string search_value = search_parameter.value();
     search_set = true;
 
+    const SearchPattern *pattern = compiled_search(search_value);
+    if (pattern == nullptr)
+        return false;
+
     // Do the actual search.
-    if (the_file.simple_search(search_value.c_str()) == false) {
+    if (the_file.search(*pattern) == false) {
         info_message("Not found");
         return_value = false;
     }
     return return_value;
 }
 
+bool search_highlight_command()
+{
+    highlight_matches = !highlight_matches;
+    if (highlight_matches && search_set)
+        compiled_search(search_parameter.value());
+    else
+        YEditFile::show_matches(nullptr);
+    info_message(highlight_matches ? "Highlighting the search string"
+                                   : "Not highlighting the search string");
+    return true;
+}
+
+bool search_incremental_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    std::string search_value;
+    bool cancelled;
+
+    // Macros give the whole pattern at once, as do keyboard macros being replayed.
+    if (parameter_stack.size() != 0)
+        return search_first_command();
+    if (keyboard_macro.take_answer(search_value, cancelled)) {
+        if (cancelled)
+            return false;
+        parameter_stack.push(EditBuffer(search_value.data(), search_value.size()));
+        return search_first_command();
+    }
+
+    const SearchPattern::Mode mode =
+        regex_search ? SearchPattern::REGULAR_EXPRESSION : SearchPattern::LITERAL;
+    if (!IncrementalSearch::run(the_file, mode, search_options(), search_value)) {
+        keyboard_macro.record_cancel();
+        return false;
+    }
+    keyboard_macro.record_answer(search_value);
+
+    // The pattern typed is the one that search_next looks for (and that is highlighted).
+    if (!search_value.empty()) {
+        parameter_stack.push(EditBuffer(search_value.data(), search_value.size()));
+        search_parameter.get();
+        search_set = true;
+        compiled_search(search_value);
+    }
+    return true;
+}
+
 bool search_next_command()
 {
     bool return_value = true;
@@ -232,16 +542,29 @@ bool search_next_command()
     }
     else {
         std::string search_value = search_parameter.value();
-        if (the_file.CP().cursor_right(),
-            the_file.simple_search(search_value.c_str()) == false) {
-            the_file.CP().cursor_left();
-            info_message("Not found");
+        const SearchPattern *pattern = compiled_search(search_value);
+        if (pattern == nullptr) {
             return_value = false;
         }
+        else {
+            const unsigned old_column = the_file.CP().cursor_column();
+            the_file.character_right();
+            if (the_file.search(*pattern) == false) {
+                the_file.CP().jump_to_column(old_column);
+                info_message("Not found");
+                return_value = false;
+            }
+        }
     }
     return return_value;
 }
 
+//! Marks the word under the cursor as a column block.
+bool select_word_command()
+{
+    return FileList::active_file().select_word();
+}
+
 bool set_bookmark_command()
 {
     FileList::set_bookmark();
@@ -249,6 +572,78 @@ bool set_bookmark_command()
     return true;
 }
 
+bool set_frame_interval_command()
+{
+    static Parameter parameter("FRAME INTERVAL (MS):");
+    if (parameter.get() == false)
+        return false;
+    std::string parameter_value = parameter.value();
+
+    const long milliseconds = std::atol(parameter_value.c_str());
+    if (milliseconds < 0 || milliseconds > 1000) {
+        error_message("The frame interval must be from 0 to 1000 ms");
+        return false;
+    }
+    Renderer::set_interval(static_cast<int>(milliseconds));
+    return true;
+}
+
+bool set_language_server_command()
+{
+    static Parameter command("LANGUAGE SERVER COMMAND (EMPTY FOR NONE):");
+    static Parameter extensions("FOR FILES WITH EXTENSIONS:");
+    if (command.get() == false)
+        return false;
+    if (extensions.get() == false)
+        return false;
+    std::string command_value = command.value();
+    std::string extensions_value = extensions.value();
+
+    if (!LanguageServer::configure(extensions_value, command_value)) {
+        error_message("Language servers aren't supported on this system");
+        return false;
+    }
+    return true;
+}
+
+bool set_line_ending_command()
+{
+    static Parameter parameter("LINE ENDING (LF, CRLF, CR):");
+    if (parameter.get() == false)
+        return false;
+    const std::string parameter_value = parameter.value();
+
+    DiskEditFile::LineEnding ending;
+    if (my_stricmp("LF", parameter_value.c_str()) == 0)
+        ending = DiskEditFile::LF;
+    else if (my_stricmp("CRLF", parameter_value.c_str()) == 0)
+        ending = DiskEditFile::CRLF;
+    else if (my_stricmp("CR", parameter_value.c_str()) == 0)
+        ending = DiskEditFile::CR;
+    else {
+        error_message("Use LF, CRLF, or CR for the line ending");
+        return false;
+    }
+    FileList::active_file().set_line_ending(ending);
+    return true;
+}
+
+bool set_memory_budget_command()
+{
+    static Parameter parameter("MEMORY BUDGET FOR FILES (KB, 0 FOR NONE):");
+    if (parameter.get() == false)
+        return false;
+    std::string parameter_value = parameter.value();
+
+    const long kilobytes = std::atol(parameter_value.c_str());
+    if (kilobytes < 0) {
+        error_message("The memory budget can't be negative");
+        return false;
+    }
+    FileList::set_memory_budget(static_cast<std::size_t>(kilobytes) * 1024U);
+    return true;
+}
+
 bool set_tab_command()
 {
     static Parameter parameter("NEW TAB DISTANCE:");
@@ -256,44 +651,133 @@ bool set_tab_command()
         return false;
     std::string parameter_value = parameter.value();
 
+    const int distance = std::atoi(parameter_value.c_str());
+    if (distance < 1) {
+        error_message("The tab distance must be at least one");
+        return false;
+    }
     YEditFile &the_file = FileList::active_file();
-    the_file.set_tab(std::atoi(parameter_value.c_str()));
+    the_file.set_tab(distance);
     return true;
 }
 
-bool skip_left_command()
+bool set_undo_limit_command()
 {
-    YEditFile &the_file = FileList::active_file();  // Assume active file does not change.
-    int old_column = the_file.CP().cursor_column(); // Original cursor column.
-    int column = old_column;                        // New cursor column position.
-    std::size_t length = the_file.CP_line_length();
-
-    // If cursor is at or off the end of the line, just advance to end.
-    if (static_cast<std::size_t>(column) > length) {
-        the_file.end();
-    }
-    else {
-        column = word_left(*the_file.get_line(), column);
+    static Parameter parameter("UNDO MEMORY LIMIT (KB):");
+    if (parameter.get() == false)
+        return false;
+    std::string parameter_value = parameter.value();
 
-        // Position cursor.
-        the_file.CP().cursor_left(old_column - column);
+    const long kilobytes = std::atol(parameter_value.c_str());
+    if (kilobytes < 0) {
+        error_message("The undo memory limit can't be negative");
+        return false;
     }
+    UndoLog::set_limit(static_cast<std::size_t>(kilobytes) * 1024U);
     return true;
 }
 
+bool skip_left_command()
+{
+    return FileList::active_file().previous_word();
+}
+
 bool skip_right_command()
 {
-    YEditFile &the_file = FileList::active_file();  // Assume active file does not change.
-    int old_column = the_file.CP().cursor_column(); // Original cursor column position.
-    int column = old_column;                        // New column position.
-    std::size_t length = the_file.CP_line_length(); // Length of line.
+    return FileList::active_file().next_word();
+}
 
-    // Do nothing if cursor off end of line.
-    if (static_cast<std::size_t>(column) < length) {
-        column = word_right(*the_file.get_line(), column);
+bool sort_lines_command()
+{
+    YEditFile &the_file = FileList::active_file();
 
-        // Position the cursor on the next word.
-        the_file.CP().cursor_right(column - old_column);
+    // The options are letters: N (numeric), I (ignore case), R (reverse), U (unique). A number
+    // gives the column where the key starts. A column block's left edge is the default. In a
+    // table F (field) makes the number that of the field that is the key instead.
+    static Parameter parameter("SORT OPTIONS (N, I, R, U, F, column):");
+    if (parameter.get() == false)
+        return false;
+    const std::string parameter_value = parameter.value();
+
+    LineSort::Options options;
+    options.tab = static_cast<unsigned>(the_file.tab_distance());
+    if (the_file.column_block()) {
+        unsigned right;
+        the_file.column_limits(options.column, right);
+    }
+    long column = 0;
+    bool by_field = false;
+    for (const char ch : parameter_value) {
+        switch (std::toupper(static_cast<unsigned char>(ch))) {
+        case 'N':
+            options.numeric = true;
+            break;
+        case 'I':
+            options.ignore_case = true;
+            break;
+        case 'R':
+            options.reverse = true;
+            break;
+        case 'U':
+            options.unique = true;
+            break;
+        case 'F':
+            by_field = true;
+            break;
+        case ' ':
+        case ',':
+            break;
+        default:
+            if (ch < '0' || ch > '9') {
+                error_message("Unknown sort option: %c", ch);
+                return false;
+            }
+            column = column * 10 + (ch - '0');
+            break;
+        }
+    }
+
+    if (by_field) {
+        FieldIndex *const table = the_file.fields();
+        if (table == nullptr) {
+            error_message("Not a table");
+            return false;
+        }
+        options.delimiter = table->delimiter();
+        options.column = 0;
+    }
+
+    // User sees first column (or field) as number 1.
+    if (column > 0) {
+        if (by_field)
+            options.field = static_cast<std::size_t>(column - 1);
+        else
+            options.column = static_cast<unsigned>(column - 1);
     }
+    return the_file.arrange_lines(options);
+}
+
+//! Shows (or stops showing) the misspelled words in documents.
+bool spell_check_command()
+{
+    if (YEditFile::shown_misspellings()) {
+        YEditFile::show_misspellings(false);
+        info_message("Not checking spelling");
+        return true;
+    }
+    if (!Spelling::open())
+        return false;
+    YEditFile::show_misspellings(true);
+    info_message("Checking spelling in documents");
     return true;
 }
+
+bool split_window_command()
+{
+    return WindowList::split(false);
+}
+
+bool split_window_beside_command()
+{
+    return WindowList::split(true);
+}
@@ -3,9 +3,20 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "DiskEditFile.hpp"
 #include "FileList.hpp"
+#include "LineTransform.hpp"
+#include "Trace.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
+#include "global.hpp"
+#include "parameter_stack.hpp"
+#include "support.hpp"
 
 bool tab_command()
 {
@@ -30,8 +41,134 @@ bool toggle_block_command()
     return true;
 }
 
+bool toggle_column_block_command()
+{
+    FileList::active_file().toggle_column_block();
+    return true;
+}
+
+bool toggle_cursor_command()
+{
+    FileList::active_file().toggle_caret();
+    return true;
+}
+
+bool toggle_fold_command()
+{
+    return FileList::active_file().toggle_fold();
+}
+
+bool toggle_ignore_case_command()
+{
+    search_ignore_case = !search_ignore_case;
+    info_message(search_ignore_case ? "Searching without regard to case"
+                                    : "Searching with regard to case");
+    return true;
+}
+
+bool toggle_interning_command()
+{
+    DiskEditFile::set_interning(!DiskEditFile::is_interning());
+    info_message(DiskEditFile::is_interning() ? "Repeated lines of files read will share text"
+                                              : "Every line of files read has its own text");
+    return true;
+}
+
 bool toggle_bookmark_command()
 {
     FileList::toggle_bookmark();
     return true;
 }
+
+bool toggle_overlay_command()
+{
+    WindowList::toggle_overlay();
+    return true;
+}
+
+bool toggle_regex_command()
+{
+    regex_search = !regex_search;
+    info_message(regex_search ? "Searching for regular expressions"
+                              : "Searching for literal text");
+    return true;
+}
+
+bool toggle_undo_history_command()
+{
+    DiskEditFile::set_keeping_history(!DiskEditFile::is_keeping_history());
+    info_message(DiskEditFile::is_keeping_history()
+                     ? "Undo history is kept with files saved"
+                     : "Undo history is not kept with files saved");
+    return true;
+}
+
+bool toggle_whole_word_command()
+{
+    search_whole_word = !search_whole_word;
+    info_message(search_whole_word ? "Searching for whole words" : "Searching for any text");
+    return true;
+}
+
+bool toggle_wrap_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    the_file.toggle_wrap();
+    info_message(the_file.is_wrapping() ? "Wrapping long lines" : "Not wrapping long lines");
+    return true;
+}
+
+bool transform_lines_command()
+{
+    // The transforms are named by words (see LineTransform::find) and applied in order.
+    static Parameter parameter("TRANSFORMS (trim, untab, tabs, upper, lower, cr):");
+    if (parameter.get() == false)
+        return false;
+    const std::string parameter_value = parameter.value();
+
+    std::vector<LineTransform::Kind> pipeline;
+    std::size_t offset = 0;
+    while ((offset = parameter_value.find_first_not_of(" ,", offset)) != std::string::npos) {
+        const std::size_t end = std::min(parameter_value.find_first_of(" ,", offset),
+                                         parameter_value.size());
+        const std::string name = parameter_value.substr(offset, end - offset);
+        LineTransform::Kind kind;
+        if (!LineTransform::find(name, kind)) {
+            error_message("Unknown transform: %.100s", name.c_str());
+            return false;
+        }
+        pipeline.push_back(kind);
+        offset = end;
+    }
+
+    YEditFile &the_file = FileList::active_file();
+    long changed;
+    if (!the_file.transform_lines(
+            pipeline, static_cast<unsigned>(the_file.tab_distance()), changed))
+        return false;
+    if (changed == 0)
+        info_message("No lines needed changing");
+    return true;
+}
+
+bool trace_command()
+{
+    if (!Trace::active()) {
+        Trace::start();
+        info_message("Tracing started");
+        return true;
+    }
+
+    // The trace keeps running if the user ESCapes out.
+    static Parameter parameter("WRITE TRACE TO:");
+    if (parameter.get() == false)
+        return false;
+    const std::string file_name = parameter.value();
+    const long count = Trace::stop(file_name.c_str());
+    if (count < 0) {
+        error_message("Can't write %s", file_name.c_str());
+        return false;
+    }
+    info_message("Wrote %ld events to %s", count, file_name.c_str());
+    return true;
+}
@@ -17,117 +17,309 @@
  * matter of adjustment.
  */
 
+#include <algorithm>
 #include <cstddef>
-#include <cstdlib>
-#include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include "Allocations.hpp"
+#include "FileList.hpp"
+#include "MacroProfile.hpp"
+#include "Profiler.hpp"
+#include "YEditFile.hpp"
 #include "command.hpp"
 #include "command_table.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
 
 struct DispatchTableEntry {
-    const char *macro_word;
+    std::string_view macro_word;
     bool (*command_function)();
 };
 
-static DispatchTableEntry command_table[] = {{"add_text", add_text_command},
-                                             {"background_color", background_color_command},
-                                             {"backspace", backspace_command},
-                                             {"block_off", block_off_command},
-                                             {"copy", copy_block_command},
-                                             {"cursor_down", CP_down_command},
-                                             {"cursor_left", CP_left_command},
-                                             {"cursor_right", CP_right_command},
-                                             {"cursor_up", CP_up_command},
-                                             {"cut", delete_block_command},
-                                             {"define_key", define_key_command},
-                                             {"delete", delete_command},
-                                             {"delete_to_eol", delete_EOL_command},
-                                             {"delete_to_sol", delete_SOL_command},
-                                             {"editor_info", editor_info_command},
-                                             {"end_of_file", goto_file_end_command},
-                                             {"end_of_line", goto_line_end_command},
-                                             {"error_message", error_message_command},
-                                             {"execute_file", execute_file_command},
-                                             {"execute_macro", execute_macro_command},
-                                             {"exit", exit_command},
-                                             {"external_command", external_command_command},
-                                             {"external_filter", filter_command},
-                                             {"filelist_info", filelist_info_command},
-                                             {"file_info", file_info_command},
-                                             {"file_insert", file_insert_command},
-                                             {"find_file", find_file_command},
-                                             {"foreground_color", foreground_color_command},
-                                             {"goto_column", goto_column_command},
-                                             {"goto_line", goto_line_command},
-                                             {"help", help_command},
-                                             {"input", input_command},
-                                             {"insert_file", insert_file_command},
-                                             {"kill_file", kill_file_command},
-                                             {"legal_info", legal_info_command},
-                                             {"new_line", new_line_command},
-                                             {"next_file", next_file_command},
-                                             {"next_procedure", next_procedure_command},
-                                             {"page_down", page_down_command},
-                                             {"page_up", page_up_command},
-                                             {"paste", paste_block_command},
-                                             {"previous_file", previous_file_command},
-                                             {"previous_procedure", previous_procedure_command},
-                                             {"quit", quit_command},
-                                             {"redirect_from", redirect_from_command},
-                                             {"redirect_to", redirect_to_command},
-                                             {"reformat_paragraph", reformat_command},
-                                             {"refresh_file", refresh_file_command},
-                                             {"remove_file", remove_file_command},
-                                             {"rename_file", rename_file_command},
-                                             {"restricted_mode", restricted_mode_command},
-                                             {"save_file", save_file_command},
-                                             {"search_first", search_first_command},
-                                             {"search_next", search_next_command},
-                                             {"search_replace", search_and_replace_command},
-                                             {"set_mark", set_bookmark_command},
-                                             {"set_tab", set_tab_command},
-                                             {"start_of_line", goto_line_start_command},
-                                             {"tab", tab_command},
-                                             {"toggle_block", toggle_block_command},
-                                             {"toggle_mark", toggle_bookmark_command},
-                                             {"toggle_replace", insert_command},
-                                             {"top_of_file", goto_file_start_command},
-                                             {"word_left", skip_left_command},
-                                             {"word_right", skip_right_command},
-                                             {"yexit", yexit_command},
-
-                                             // Parameter stack commands for the macro language.
-                                             {"drop", drop_command},
-                                             {"dup", dup_command},
-                                             {"xchg", xchg_command},
-
-                                             // Experimental for the moment.
-                                             {"getch", getch_command},
-
-                                             // Special marker at end.
-                                             {nullptr, nullptr}};
-
-//! Scan the command table looking for index of the specified macro word.
+// This table must be kept sorted by macro word (in strcmp order) so that it can be searched
+// with a binary search. The static_assert below checks this at compile time.
+static constexpr DispatchTableEntry command_table[] = {
+    {"add", add_command}, // Arithmetic.
+    {"add_text", add_text_command},
+    {"align_fields", align_fields_command},
+    {"background_color", background_color_command},
+    {"backspace", backspace_command},
+    {"block_off", block_off_command},
+    {"clear_cursors", clear_cursors_command},
+    {"close_window", close_window_command},
+    {"column_cursors", column_cursors_command},
+    {"complete_word", complete_word_command},
+    {"copy", copy_block_command},
+    {"current_column", current_column_command},
+    {"current_line", current_line_command},
+    {"cursor_down", CP_down_command},
+    {"cursor_left", CP_left_command},
+    {"cursor_right", CP_right_command},
+    {"cursor_up", CP_up_command},
+    {"cut", delete_block_command},
+    {"define_key", define_key_command},
+    {"delete", delete_command},
+    {"delete_to_eol", delete_EOL_command},
+    {"delete_to_sol", delete_SOL_command},
+    {"delete_word", delete_word_command},
+    {"diff_files", diff_files_command},
+    {"divide", divide_command}, // Arithmetic.
+    {"drop", drop_command}, // Parameter stack.
+    {"dup", dup_command}, // Parameter stack.
+    {"editor_info", editor_info_command},
+    {"enclosing_scope", enclosing_scope_command},
+    {"end_of_file", goto_file_end_command},
+    {"end_of_line", goto_line_end_command},
+    {"error_list", error_list_command},
+    {"error_message", error_message_command},
+    {"execute_file", execute_file_command},
+    {"execute_lua", execute_lua_command},
+    {"execute_lua_file", execute_lua_file_command},
+    {"execute_macro", execute_macro_command},
+    {"exit", exit_command},
+    {"external_command", external_command_command},
+    {"external_filter", filter_command},
+    {"file_info", file_info_command},
+    {"file_insert", file_insert_command},
+    {"filelist_info", filelist_info_command},
+    {"find_file", find_file_command},
+    {"find_symbol", find_symbol_command},
+    {"fold_procedures", fold_procedures_command},
+    {"follow_file", follow_file_command},
+    {"foreground_color", foreground_color_command},
+    {"frame_info", frame_info_command},
+    {"fuzzy_find", fuzzy_find_command},
+    {"getch", getch_command}, // Experimental.
+    {"goto_column", goto_column_command},
+    {"goto_line", goto_line_command},
+    {"help", help_command},
+    {"help_search", help_search_command},
+    {"index_symbols", index_symbols_command},
+    {"input", input_command},
+    {"insert_file", insert_file_command},
+    {"kill_file", kill_file_command},
+    {"legal_info", legal_info_command},
+    {"load_plugin", load_plugin_command},
+    {"macro_profile", macro_profile_command},
+    {"macro_profile_info", macro_profile_info_command},
+    {"memory_info", memory_info_command},
+    {"multiply", multiply_command}, // Arithmetic.
+    {"new_line", new_line_command},
+    {"next_diagnostic", next_diagnostic_command},
+    {"next_error", next_error_command},
+    {"next_field", next_field_command},
+    {"next_file", next_file_command},
+    {"next_procedure", next_procedure_command},
+    {"next_window", next_window_command},
+    {"page_down", page_down_command},
+    {"page_up", page_up_command},
+    {"paste", paste_block_command},
+    {"paste_text", paste_text_command},
+    {"previous_field", previous_field_command},
+    {"previous_file", previous_file_command},
+    {"previous_procedure", previous_procedure_command},
+    {"profile_info", profile_info_command},
+    {"quit", quit_command},
+    {"recent_file", recent_file_command},
+    {"redirect_from", redirect_from_command},
+    {"redirect_to", redirect_to_command},
+    {"redo", redo_command},
+    {"reformat_block", reformat_block_command},
+    {"reformat_paragraph", reformat_command},
+    {"refresh_file", refresh_file_command},
+    {"remove_file", remove_file_command},
+    {"rename_file", rename_file_command},
+    {"restricted_mode", restricted_mode_command},
+    {"reverse_lines", reverse_lines_command},
+    {"save_file", save_file_command},
+    {"search_all", search_all_command},
+    {"search_files", search_files_command},
+    {"search_first", search_first_command},
+    {"search_highlight", search_highlight_command},
+    {"search_incremental", search_incremental_command},
+    {"search_next", search_next_command},
+    {"search_replace", search_and_replace_command},
+    {"select_word", select_word_command},
+    {"set_frame_interval", set_frame_interval_command},
+    {"set_language_server", set_language_server_command},
+    {"set_line_ending", set_line_ending_command},
+    {"set_mark", set_bookmark_command},
+    {"set_memory_budget", set_memory_budget_command},
+    {"set_tab", set_tab_command},
+    {"set_undo_limit", set_undo_limit_command},
+    {"sort_lines", sort_lines_command},
+    {"spell_check", spell_check_command},
+    {"split_window", split_window_command},
+    {"split_window_beside", split_window_beside_command},
+    {"start_of_line", goto_line_start_command},
+    {"subtract", subtract_command}, // Arithmetic.
+    {"tab", tab_command},
+    {"toggle_block", toggle_block_command},
+    {"toggle_column_block", toggle_column_block_command},
+    {"toggle_cursor", toggle_cursor_command},
+    {"toggle_fold", toggle_fold_command},
+    {"toggle_ignore_case", toggle_ignore_case_command},
+    {"toggle_interning", toggle_interning_command},
+    {"toggle_mark", toggle_bookmark_command},
+    {"toggle_overlay", toggle_overlay_command},
+    {"toggle_regex", toggle_regex_command},
+    {"toggle_replace", insert_command},
+    {"toggle_undo_history", toggle_undo_history_command},
+    {"toggle_whole_word", toggle_whole_word_command},
+    {"toggle_wrap", toggle_wrap_command},
+    {"top_of_file", goto_file_start_command},
+    {"trace", trace_command},
+    {"transform_lines", transform_lines_command},
+    {"undo", undo_command},
+    {"unfold_all", unfold_all_command},
+    {"unique_lines", unique_lines_command},
+    {"wait_background", wait_background_command}, // Experimental.
+    {"word_left", skip_left_command},
+    {"word_right", skip_right_command},
+    {"xchg", xchg_command}, // Parameter stack.
+    {"yexit", yexit_command},
+};
+
+//! Returns true if the command table is strictly sorted by macro word.
+static constexpr bool command_table_sorted()
+{
+    for (std::size_t i = 1; i < std::size(command_table); ++i) {
+        if (!(command_table[i - 1].macro_word < command_table[i].macro_word))
+            return false;
+    }
+    return true;
+}
+
+static_assert(command_table_sorted(), "command_table must be sorted by macro word");
+
+//! A command added while the editor runs (see add_command). Its index follows the table's.
+struct AddedCommand {
+    bool (*function)(void *);
+    void *context;
+};
+
+static std::vector<AddedCommand> added_commands;
+static std::map<std::string, int, std::less<>> added_words; //!< Index in added_commands.
+
+//! Scan the command table looking for the entry of the specified macro word.
+/*!
+ * Returns nullptr if the word cannot be found. This function does a binary search of the table
+ * and does not allocate memory.
+ */
+static const DispatchTableEntry *scan_table(const std::string_view word)
+{
+    const DispatchTableEntry *const end = std::end(command_table);
+    const DispatchTableEntry *const entry = std::lower_bound(
+        std::begin(command_table), end, word,
+        [](const DispatchTableEntry &entry, std::string_view key) {
+            return entry.macro_word < key;
+        });
+
+    if (entry == end || entry->macro_word != word)
+        return nullptr;
+    return entry;
+}
+
+int find_command(const std::string_view word)
+{
+    if (const DispatchTableEntry *const entry = scan_table(word))
+        return static_cast<int>(entry - std::begin(command_table));
+    const auto added = added_words.find(word);
+    if (added == added_words.end())
+        return -1;
+    return static_cast<int>(std::size(command_table)) + added->second;
+}
+
+std::pair<int, int> find_commands(const std::string_view prefix)
+{
+    const DispatchTableEntry *const end = std::end(command_table);
+    const DispatchTableEntry *const first = std::lower_bound(
+        std::begin(command_table), end, prefix,
+        [](const DispatchTableEntry &entry, std::string_view key) {
+            return entry.macro_word < key;
+        });
+    const DispatchTableEntry *last = first;
+    while (last != end && last->macro_word.substr(0, prefix.size()) == prefix)
+        ++last;
+    return {static_cast<int>(first - std::begin(command_table)),
+            static_cast<int>(last - std::begin(command_table))};
+}
+
+std::string_view command_name(const int index)
+{
+    if (index >= 0 && index < static_cast<int>(std::size(command_table)))
+        return command_table[index].macro_word;
+    for (const auto &added : added_words) {
+        if (static_cast<int>(std::size(command_table)) + added.second == index)
+            return added.first;
+    }
+    return std::string_view();
+}
+
+bool add_command(const std::string_view word, bool (*const function)(void *),
+                 void *const context)
+{
+    if (find_command(word) >= 0)
+        return false;
+    added_words.emplace(std::string(word), static_cast<int>(added_commands.size()));
+    added_commands.push_back(AddedCommand{function, context});
+    return true;
+}
+
+//! Runs a command function, reversing anything it does to a read only active file.
 /*!
- * Returns -1 if the word cannot be found. This function does a simple linear search of the
- * table.
+ * Commands don't check whether the file they modify is read only. Instead the modifications
+ * are undone as a group, which also leaves the command's parameters consumed as usual. A file
+ * whose lines are fixed (see YEditFile::has_fixed_lines) may be marked as changed by what it
+ * does itself, so any modification of its lines is undone.
  */
-static int scan_table(const std::string &word)
+template <typename Function>
+static void run_command(const int index, const Function &command_function)
 {
-    // Start at the beginning.
-    int index = 0;
-
-    // While there is more to the table, return the current index if this is right entry.
-    while (command_table[index].macro_word != nullptr) {
-        if (std::strcmp(command_table[index].macro_word, word.c_str()) == 0)
-            return index;
-        index++;
+    YEditFile &the_file = FileList::active_file();
+    const bool fixed = the_file.is_read_only() && the_file.has_fixed_lines();
+    const bool guarded = fixed || (the_file.is_read_only() && !the_file.changed());
+    const bool was_changed = the_file.changed();
+    const unsigned long version = the_file.version();
+
+    // TODO: Do something with the bool return value from the command function!
+    // Most commands work on the text of a file so that is what their memory is charged to,
+    // unless they say otherwise.
+    {
+        Profiler::Scope zone(Profiler::MACRO);
+        MacroProfile::Command counted(index);
+        Allocations::Scope tag(Allocations::DOCUMENT);
+        command_function();
     }
 
-    // Got here? Must never have seen a match.
-    return -1;
+    if (guarded && &FileList::active_file() == &the_file &&
+        (fixed ? the_file.version() != version : the_file.changed())) {
+        the_file.undo();
+        if (!was_changed)
+            the_file.mark_as_unchanged();
+        error_message("%s is read only", the_file.name());
+    }
+}
+
+//! Runs the command added with add_command that has the given dispatch table index.
+static void run_added_command(const int index)
+{
+    const int table_size = static_cast<int>(std::size(command_table));
+    const AddedCommand &command = added_commands[static_cast<std::size_t>(index - table_size)];
+    run_command(index, [&command]() { return command.function(command.context); });
+}
+
+void execute_command(const int index)
+{
+    if (index < static_cast<int>(std::size(command_table)))
+        run_command(index, command_table[index].command_function);
+    else
+        run_added_command(index);
 }
 
 //! Performs actions corresponding to the specified word of macro text.
@@ -137,12 +329,15 @@ static int scan_table(const std::string &word)
  */
 void handle_word(const EditBuffer &word)
 {
-    int table_index;
-
     // Search the dispatch table.
-    if ((table_index = scan_table(word.to_string())) != -1) {
-        // TODO: Do something with the bool return value from the command function!
-        command_table[table_index].command_function();
+    if (const DispatchTableEntry *entry = scan_table(word.view())) {
+        const int index = static_cast<int>(entry - std::begin(command_table));
+        run_command(index, entry->command_function);
+    }
+
+    // Then the commands added while the editor runs.
+    else if (const auto added = added_words.find(word.view()); added != added_words.end()) {
+        run_added_command(static_cast<int>(std::size(command_table)) + added->second);
     }
 
     // Otherwise, we don't know what it is. Treat it like a string.
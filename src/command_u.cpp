@@ -0,0 +1,34 @@
+/*! \file    command_u.cpp
+ *  \brief   Implementation of the 'u' command functions.
+ *  \author  Peter Chapin <spicacality@kelseymountain.org>
+ */
+
+#include "FileList.hpp"
+#include "LineSort.hpp"
+#include "YEditFile.hpp"
+#include "command.hpp"
+#include "support.hpp"
+
+bool undo_command()
+{
+    YEditFile &the_file = FileList::active_file();
+    if (!the_file.undo()) {
+        info_message("Nothing to undo");
+        return false;
+    }
+    return true;
+}
+
+bool unfold_all_command()
+{
+    FileList::active_file().unfold_all();
+    return true;
+}
+
+bool unique_lines_command()
+{
+    LineSort::Options options;
+    options.sort = false;
+    options.unique = true;
+    return FileList::active_file().arrange_lines(options);
+}
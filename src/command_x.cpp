@@ -3,12 +3,17 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
-#include <cctype>
+#include <climits>
 #include <cstdlib>
+#include <utility>
 
-#include <screen/screen.hpp>
-
+#include "DiskEditFile.hpp"
+#include "FileList.hpp"
+#include "JobList.hpp"
+#include "WordSource.hpp"
+#include "YEditFile.hpp"
 #include "command.hpp"
+#include "macro_stack.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
 
@@ -30,11 +35,7 @@ bool dup_command()
         error_message("Cannot dup an empty stack");
         return false;
     }
-    EditBuffer top_object;
-
-    parameter_stack.pop(top_object);
-    parameter_stack.push(top_object);
-    parameter_stack.push(top_object);
+    parameter_stack.duplicate();
     return true;
 }
 
@@ -44,32 +45,99 @@ bool xchg_command()
         error_message("Cannot exchange top stack levels; not enough data");
         return false;
     }
-    EditBuffer top_object_1;
-    EditBuffer top_object_2;
-
-    parameter_stack.pop(top_object_1);
-    parameter_stack.pop(top_object_2);
-    parameter_stack.push(top_object_1);
-    parameter_stack.push(top_object_2);
+    parameter_stack.exchange();
     return true;
 }
 
-bool getch_command()
-{
-    // Get a keystroke directly from the keyboard. Bypass the keyboard manager.
-    int key_code = scr::key();
-    EditBuffer temp;
+// Arithmetic commands for the macro language. The operands are the top two stack levels, the
+// right operand on top. They are replaced by the result.
 
-    // If this is a printable letter, just push it onto the parameter stack.
-    if (key_code < 128 && std::isprint(key_code)) {
-        temp.append(static_cast<char>(key_code));
-    }
+namespace {
 
-    // Otherwise, I want to push the *name* of the key.
-    else {
-        temp.append("*** UNKNOWN KEY ****");
+    template <typename Operation>
+    bool arithmetic(const char *const description, Operation operation)
+    {
+        long left, right;
+        if (parameter_stack.size() < 2) {
+            error_message("Cannot %s; not enough data", description);
+            return false;
+        }
+        if (!parameter_stack.get_integer(1, left) || !parameter_stack.get_integer(0, right)) {
+            error_message("Cannot %s; operands must be integers", description);
+            return false;
+        }
+        long result;
+        if (!operation(left, right, result)) {
+            error_message("Cannot %s; result is undefined", description);
+            return false;
+        }
+        parameter_stack.delete_top();
+        parameter_stack.delete_top();
+        parameter_stack.push_integer(result);
+        return true;
     }
-    parameter_stack.push(temp);
 
+} // namespace
+
+bool add_command()
+{
+    return arithmetic("add", [](long left, long right, long &result) {
+        return !__builtin_add_overflow(left, right, &result);
+    });
+}
+
+bool subtract_command()
+{
+    return arithmetic("subtract", [](long left, long right, long &result) {
+        return !__builtin_sub_overflow(left, right, &result);
+    });
+}
+
+bool multiply_command()
+{
+    return arithmetic("multiply", [](long left, long right, long &result) {
+        return !__builtin_mul_overflow(left, right, &result);
+    });
+}
+
+bool divide_command()
+{
+    return arithmetic("divide", [](long left, long right, long &result) {
+        if (right == 0 || (left == LONG_MIN && right == -1))
+            return false;
+        result = left / right;
+        return true;
+    });
+}
+
+// Commands that push the position of the cursor. The first line and column are numbered 1.
+
+bool current_column_command()
+{
+    parameter_stack.push_integer(
+        static_cast<long>(FileList::active_file().CP().cursor_column()) + 1L);
+    return true;
+}
+
+bool current_line_command()
+{
+    parameter_stack.push_integer(FileList::active_file().CP().cursor_line() + 1L);
+    return true;
+}
+
+//! Pushes the next keystroke. The macro is suspended until it is typed (see KeyWord).
+bool getch_command()
+{
+    macro_stack.push(new KeyWord);
+    return true;
+}
+
+//! Suspends the macro until the files being read and the jobs running in the background finish.
+bool wait_background_command()
+{
+    macro_stack.push(new WaitWord([]() {
+        JobList::poll();
+        return DiskEditFile::background_loads() == 0 && JobList::count() == 0;
+    }));
     return true;
 }
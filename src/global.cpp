@@ -70,10 +70,14 @@ Parameter search_parameter("SEARCH FOR:");
 Parameter replace_parameter("REPLACE WITH:");
 bool search_set = false;  //!< =true when search string is set.
 bool replace_set = false; //!< =true when replace string is set.
+bool regex_search = false; //!< =true when search strings are regular expressions.
+bool search_ignore_case = false; //!< =true when searches ignore the case of letters.
+bool search_whole_word = false;  //!< =true when searches match only whole words.
+bool highlight_matches = false; //!< =true when the search string is highlighted in the files.
 int box_size = 0;         //!< The number of cols used for the input box.
 int start_row = 0;        //!< The row number of the top row of the box.
 int start_column = 0;     //!< The col number of the left col of the box.
-Stack<EditBuffer> parameter_stack;
+ParameterStack parameter_stack;
 bool restricted_mode = false; //!< =true when restricted mode is active.
 
 //! Table used by the commands that set colors to interpret the color words typed by the user.
@@ -7,9 +7,18 @@
  * This file contains only the declaration of several large arrays of char pointers. The text
  * defined by these arrays form all of the help screens used by Y. The format is not the easiest
  * to process, but it is easy to produce and change.
+ *
+ * The arrays are constant expressions, so the index of their words used by find_help is built
+ * and sorted by the compiler. Searching it needs no memory and does not parse the text.
  */
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
 #include <cstdio>
+#include <iterator>
+#include <string_view>
+#include <utility>
 
 #include <screen/TextWindow.hpp>
 #include <screen/screen.hpp>
@@ -17,7 +26,7 @@
 #include "help.hpp"
 #include "support.hpp"
 
-static const char *const help_1[] = {
+static constexpr const char *help_1[] = {
     "HELP ON HELP",
     "",
     "PgUp/PgDn      Page through the help screens.",
@@ -30,12 +39,15 @@ static const char *const help_1[] = {
     "Shift+F1       Command help",
     "Shift+F2       Editor notes and acknowledgments",
     "Shift+F3       License information and legal notes.",
+    "Shift+F4       Display update counts and keystroke latency.",
+    "Ctrl+F8        Time spent starting, loading, saving, etc.",
+    "Alt+F7         Memory held by files, the clipboard, etc.",
     "",
     "Shift+F5       Technical information on Y\'s file list.",
     "Shift+F6       Technical information on the current file.",
     nullptr};
 
-static const char *const help_2[] = {
+static constexpr const char *help_2[] = {
     "INVOKING AND TERMINATING",
     "",
     "The Y command line may contain a list of files to load.",
@@ -52,7 +64,7 @@ static const char *const help_2[] = {
     "Alt+Q          Exit, abandon changes.",
     nullptr};
 
-static const char *const help_3[] = {
+static constexpr const char *help_3[] = {
     "MOVING THE CURSOR",
     "",
     "The cursor can be moved off the end of the file. Y extends",
@@ -67,12 +79,13 @@ static const char *const help_3[] = {
     "Ctrl+Home                Top of file.",
     "Ctrl+End                 Just past the bottom of file.",
     "Ctrl+PgDn/PgUp           Next/Previous procedure.",
+    "Alt+O                    Start of the enclosing scope.",
     "",
     "F9                       Jump to line number.",
     "Alt+F9                   Jump to column number.",
     nullptr};
 
-static const char *const help_4[] = {
+static constexpr const char *help_4[] = {
     "CREATING AND DESTROYING TEXT",
     "",
     "If block mode is on, these operations occur on every line",
@@ -92,26 +105,29 @@ static const char *const help_4[] = {
     "^R, and ^[ (ESC). Don\'t try to put ^J or ^@ into the file.",
     nullptr};
 
-static const char *const help_5[] = {"HANDLING FILES",
-                                     "",
-                                     "Whenever files (or blocks) are saved, Y strips trailing",
-                                     "whitespace from each line. Y expands tabs to spaces when",
-                                     "reading files.",
-                                     "",
-                                     "F1        Edit another file (wildcards ok).",
-                                     "F2        Save current file or save block to a new file.",
-                                     "F3        Switch to the next file in Y\'s file list.",
-                                     "F4        Remove file from list, saving it.",
-                                     "Alt+F1    Reload a fresh copy of file from disk.",
-                                     "Alt+F2    Rename the current file or block.",
-                                     "Alt+F3    Switch to the previous file in Y\'s file list.",
-                                     "Alt+F4    Remove file or block without saving.",
-                                     "",
-                                     "F8        Insert a file into the current file.",
-                                     "Alt+F8    Insert current file or block into a file.",
-                                     nullptr};
-
-static const char *const help_6[] = {
+static constexpr const char *help_5[] = {
+    "HANDLING FILES",
+    "",
+    "Whenever files (or blocks) are saved, Y strips trailing",
+    "whitespace from each line. Y expands tabs to spaces when",
+    "reading files.",
+    "",
+    "F1        Edit another file (wildcards ok).",
+    "F2        Save current file or save block to a new file.",
+    "F3        Switch to the next file in Y\'s file list.",
+    "F4        Remove file from list, saving it.",
+    "Alt+F1    Reload a fresh copy of file from disk.",
+    "Alt+F2    Rename the current file or block.",
+    "Alt+F3    Switch to the previous file in Y\'s file list.",
+    "Alt+F4    Remove file or block without saving.",
+    "Alt+F5    Find a file below the current directory.",
+    "Shift+F6  Switch back to the file used before this one.",
+    "",
+    "F8        Insert a file into the current file.",
+    "Alt+F8    Insert current file or block into a file.",
+    nullptr};
+
+static constexpr const char *help_6[] = {
     "BLOCK MODE",
     "",
     "Many commands act differently  when block mode is on. In",
@@ -119,6 +135,7 @@ static const char *const help_6[] = {
     "(forever) any currently active block.",
     "",
     "F5                  Toggle block mode.",
+    "Shift+F5            Toggle column (rectangular) block mode.",
     "ESC                 Turn block mode off.",
     "",
     "Alt+F4              Cut current block forever.",
@@ -127,15 +144,18 @@ static const char *const help_6[] = {
     "F7                  Insert clipboard above cursor.",
     "",
     "If block mode is not on, F6 will cut the current line to",
-    "the clipboard. Alt+F6 works similarly.",
+    "the clipboard. Alt+F6 works similarly. Columns cut or",
+    "copied from a column block are inserted at the cursor.",
     nullptr};
 
-static const char *const help_7[] = {
+static constexpr const char *help_7[] = {
     "USING EXTERNAL COMMANDS",
     "",
     "When an external command is run, Y first saves all changed",
     "files. After the command finishes, Y reloads from disk any",
-    "files changed by the command.",
+    "files changed by the command. End a command with & to run",
+    "it in the background. Its output collects in a read only",
+    "file; killing that file stops the command.",
     "",
     "F10       Run an external program. RETURN at prompt gives",
     "          a new shell. Use EXIT to return to Y.",
@@ -150,7 +170,7 @@ static const char *const help_7[] = {
     "          program.",
     nullptr};
 
-static const char *const help_8[] = {
+static constexpr const char *help_8[] = {
     "SEARCH AND REPLACE",
     "",
     "Ctrl+F1   Set search string and search for first match.",
@@ -169,7 +189,7 @@ static const char *const help_8[] = {
     "done only over the block.",
     nullptr};
 
-static const char *const help_9[] = {
+static constexpr const char *help_9[] = {
     "KEYBOARD MACROS",
     "",
     "^R   Repeat prefix. All keystrokes can be repeated. This",
@@ -189,17 +209,25 @@ static const char *const help_9[] = {
     "macros can be repeated.",
     nullptr};
 
-static const char *const help_10[] = {
+static constexpr const char *help_10[] = {
     "MISC COMMANDS",
     "",
     "Alt+B     Change background color of the current file.",
-    "",
     "Alt+F     Change foreground color of the current file.",
     "",
     "Alt+R     Reformats the current paragraph. Long lines are",
     "          wrapped and short lines are filled.",
-    "",
     "Alt+T     Change tab stop distance for the current file.",
+    "",
+    "Alt+N     Add (or remove) an extra cursor at the current",
+    "          point. Typing and deleting happen at every cursor.",
+    "Alt+L     Put a cursor on each line of the block.",
+    "Alt+D     Remove the extra cursors.",
+    "",
+    "Alt+J     Next problem reported by the language server.",
+    "Alt+P     Complete the word before the cursor. Type to",
+    "          narrow the choices, RETURN or Tab to choose one.",
+    "Alt+H     Search the help screens and the command names.",
     nullptr};
 
 const HelpScreen h_screens[] = {
@@ -209,7 +237,7 @@ const HelpScreen h_screens[] = {
     {help_7, &h_screens[7], &h_screens[5]}, {help_8, &h_screens[8], &h_screens[6]},
     {help_9, &h_screens[9], &h_screens[7]}, {help_10, &h_screens[0], &h_screens[8]}};
 
-static const char *const editor_1[] = {
+static constexpr const char *editor_1[] = {
     "                             Y",
     "                A Programmer\'s Text Editor",
     "",
@@ -227,7 +255,7 @@ static const char *const editor_1[] = {
 
 const HelpScreen e_screens[] = {{editor_1, &e_screens[0], &e_screens[0]}};
 
-static const char *const legal_1[] = {
+static constexpr const char *legal_1[] = {
     "                  LICENSE INFORMATION",
     "",
     "This program is free software; you can redistribute it and",
@@ -243,24 +271,244 @@ static const char *const legal_1[] = {
     "details.",
     nullptr};
 
-static const char *const legal_2[] = {"                  CONTACT INFORMATION",
-                                      "",
-                                      "Y\'s author can be reached at",
-                                      "",
-                                      "     Peter C. Chapin",
-                                      "     Vermont Technical College",
-                                      "     Williston, VT 05495 (USA)",
-                                      "     chapinp@acm.org",
-                                      nullptr};
+static constexpr const char *legal_2[] = {
+    "                  CONTACT INFORMATION",
+    "",
+    "Y\'s author can be reached at",
+    "",
+    "     Peter C. Chapin",
+    "     Vermont Technical College",
+    "     Williston, VT 05495 (USA)",
+    "     chapinp@acm.org",
+    nullptr};
 
 const HelpScreen l_screens[] = {{legal_1, &l_screens[1], &l_screens[1]},
                                 {legal_2, &l_screens[0], &l_screens[0]}};
 
+
+/*==================================*/
+/*           Help Index             */
+/*==================================*/
+
+namespace {
+
+    //! A screen that is searched, with the set of screens it belongs to.
+    struct IndexedScreen {
+        const char *const *text;
+        const HelpScreen *base;
+        int size;
+        int number; //!< Its position in the set.
+    };
+
+    constexpr IndexedScreen indexed_screens[] = {
+        {help_1, h_screens, 10, 0},  {help_2, h_screens, 10, 1},  {help_3, h_screens, 10, 2},
+        {help_4, h_screens, 10, 3},  {help_5, h_screens, 10, 4},  {help_6, h_screens, 10, 5},
+        {help_7, h_screens, 10, 6},  {help_8, h_screens, 10, 7},  {help_9, h_screens, 10, 8},
+        {help_10, h_screens, 10, 9}, {editor_1, e_screens, 1, 0}, {legal_1, l_screens, 2, 0},
+        {legal_2, l_screens, 2, 1}};
+
+    //! An occurrence of a word in the help screens.
+    struct Posting {
+        unsigned char screen = 0; //!< Its index in indexed_screens.
+        unsigned char line = 0;
+        unsigned char column = 0;
+        unsigned char length = 0;
+    };
+
+    constexpr bool is_index_character(const char ch)
+    {
+        return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+               (ch >= '0' && ch <= '9') || ch == '_';
+    }
+
+    constexpr char fold(const char ch)
+    {
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+    }
+
+    //! Calls found with each word of the indexed screens, in order.
+    template <typename Found> constexpr void for_each_word(Found &&found)
+    {
+        for (std::size_t screen = 0; screen < std::size(indexed_screens); ++screen) {
+            const char *const *const text = indexed_screens[screen].text;
+            for (std::size_t line = 0; text[line] != nullptr; ++line) {
+                const char *const characters = text[line];
+                std::size_t column = 0;
+                while (characters[column] != '\0') {
+                    if (!is_index_character(characters[column])) {
+                        ++column;
+                        continue;
+                    }
+                    const std::size_t start = column;
+                    while (is_index_character(characters[column]))
+                        ++column;
+                    found(Posting{static_cast<unsigned char>(screen),
+                                  static_cast<unsigned char>(line),
+                                  static_cast<unsigned char>(start),
+                                  static_cast<unsigned char>(column - start)});
+                }
+            }
+        }
+    }
+
+    constexpr std::size_t count_words()
+    {
+        std::size_t count = 0;
+        for_each_word([&count](const Posting &) { ++count; });
+        return count;
+    }
+
+    constexpr std::string_view word_of(const Posting &posting)
+    {
+        return std::string_view(indexed_screens[posting.screen].text[posting.line] +
+                                    posting.column,
+                                posting.length);
+    }
+
+    //! Compares words, ignoring case, as strcmp does. A word's prefixes compare equal to it.
+    constexpr int compare_prefix(const std::string_view word, const std::string_view prefix)
+    {
+        for (std::size_t i = 0; i < prefix.size(); ++i) {
+            if (i == word.size())
+                return -1;
+            if (fold(word[i]) != fold(prefix[i]))
+                return fold(word[i]) < fold(prefix[i]) ? -1 : 1;
+        }
+        return 0;
+    }
+
+    constexpr bool in_order(const Posting &left, const Posting &right)
+    {
+        return left.screen < right.screen ||
+               (left.screen == right.screen && left.line < right.line);
+    }
+
+    constexpr bool same_line(const Posting &left, const Posting &right)
+    {
+        return left.screen == right.screen && left.line == right.line;
+    }
+
+    //! Orders postings by word, then by position.
+    constexpr bool before(const Posting &left, const Posting &right)
+    {
+        const std::string_view left_word = word_of(left);
+        const std::string_view right_word = word_of(right);
+        const int order = compare_prefix(left_word, right_word);
+        if (order != 0 || left_word.size() != right_word.size())
+            return order < 0 || (order == 0 && left_word.size() < right_word.size());
+        return in_order(left, right);
+    }
+
+    //! Moves postings[root] down the heap of the first size postings.
+    template <std::size_t N>
+    constexpr void sift_down(std::array<Posting, N> &postings, std::size_t root,
+                             const std::size_t size)
+    {
+        for (std::size_t child = 2 * root + 1; child < size; child = 2 * root + 1) {
+            if (child + 1 < size && before(postings[child], postings[child + 1]))
+                ++child;
+            if (!before(postings[root], postings[child]))
+                return;
+            const Posting temporary = postings[root];
+            postings[root] = postings[child];
+            postings[child] = temporary;
+            root = child;
+        }
+    }
+
+    //! Returns every posting, sorted. A heap sort keeps the work well within what compilers
+    //! allow for constant expressions.
+    template <std::size_t N> constexpr std::array<Posting, N> build_index()
+    {
+        std::array<Posting, N> postings{};
+        std::size_t count = 0;
+        for_each_word(
+            [&postings, &count](const Posting &posting) { postings[count++] = posting; });
+
+        for (std::size_t root = N / 2; root > 0; --root)
+            sift_down(postings, root - 1, N);
+        for (std::size_t size = N; size > 1; --size) {
+            const Posting temporary = postings[0];
+            postings[0] = postings[size - 1];
+            postings[size - 1] = temporary;
+            sift_down(postings, 0, size - 1);
+        }
+        return postings;
+    }
+
+    constexpr std::size_t WORD_COUNT = count_words();
+    constexpr std::array<Posting, WORD_COUNT> help_index = build_index<WORD_COUNT>();
+
+    //! Returns the postings of the words starting with prefix.
+    std::pair<const Posting *, const Posting *> find_postings(const std::string_view prefix)
+    {
+        const Posting *const first = std::lower_bound(
+            help_index.begin(), help_index.end(), prefix,
+            [](const Posting &posting, const std::string_view key) {
+                return compare_prefix(word_of(posting), key) < 0;
+            });
+        const Posting *last = first;
+        while (last != help_index.end() && compare_prefix(word_of(*last), prefix) == 0)
+            ++last;
+        return {first, last};
+    }
+
+} // namespace
+
+std::size_t find_help(const std::string_view query, HelpTopic *const topics,
+                      const std::size_t size)
+{
+    std::string_view words[MAX_QUERY_WORDS];
+    std::size_t word_count = 0;
+    for (std::size_t offset = 0; offset < query.size() && word_count < MAX_QUERY_WORDS;) {
+        if (!is_index_character(query[offset])) {
+            ++offset;
+            continue;
+        }
+        const std::size_t start = offset;
+        while (offset < query.size() && is_index_character(query[offset]))
+            ++offset;
+        words[word_count++] = query.substr(start, offset - start);
+    }
+    if (word_count == 0)
+        return 0;
+
+    // The lines with the first word are kept if they have the others too.
+    std::array<Posting, WORD_COUNT> lines;
+    std::size_t line_count = 0;
+    const auto candidates = find_postings(words[0]);
+    for (const Posting *candidate = candidates.first; candidate != candidates.second;
+         ++candidate) {
+        bool matches = true;
+        for (std::size_t i = 1; matches && i < word_count; ++i) {
+            const auto others = find_postings(words[i]);
+            matches = std::any_of(
+                others.first, others.second,
+                [candidate](const Posting &other) { return same_line(other, *candidate); });
+        }
+        if (matches)
+            lines[line_count++] = *candidate;
+    }
+
+    // Several words on a line may start with the first word of the query.
+    std::sort(lines.begin(), lines.begin() + line_count, in_order);
+    const auto end = std::unique(lines.begin(), lines.begin() + line_count, same_line);
+
+    std::size_t count = 0;
+    for (auto line = lines.begin(); line != end && count < size; ++line, ++count) {
+        const IndexedScreen &screen = indexed_screens[line->screen];
+        topics[count] = HelpTopic{screen.base, screen.size, &screen.base[screen.number],
+                                  line->line, screen.text[line->line]};
+    }
+    return count;
+}
+
 const HelpScreen *display_screens(const HelpScreen *const base, const HelpScreen *current,
-                                  const int size)
+                                  const int size, int line)
 {
     const int viewer_width = 60; // If these change, the data above will need to be reformated
     const int viewer_height = 20;
+    const int visible_lines = viewer_height - 2;
     scr::TextWindow view_port;
 
     view_port.open((scr::number_of_rows() / 2 - viewer_height / 2) + 1,
@@ -270,33 +518,54 @@ const HelpScreen *display_screens(const HelpScreen *const base, const HelpScreen
     // Turn cursor off.
     scr::set_cursor_position(scr::number_of_rows() + 1, 1);
 
+    // Screens longer than the window scroll. The given line is shown near the top.
+    int top = std::max(line - 2, 0);
+
     // Loop until the user says "enough!!"
+    bool repaint = true;
     for (;;) {
+        int length = 0;
+        while (current->current_screen[length] != nullptr)
+            ++length;
+        top = std::max(std::min(top, length - visible_lines), 0);
+
+        // Only the visible lines are painted, and only when they change.
+        if (repaint) {
+            view_port.home();
+            for (int i = 0; i < visible_lines; i++) {
+                const bool shown = top + i < length;
+                view_port.print("%s", shown ? current->current_screen[top + i] : "");
+            }
 
-        // Write the screen number in the lower left corner.
-        char buffer[20];
-        std::sprintf(buffer, "%2d/%2d", static_cast<int>(current - base) + 1, size);
-        view_port.print_at(viewer_height - 3, viewer_width - 8, buffer);
-
-        // Paint the help screen.
-        int i;
-        bool stop = false;
-        view_port.home();
-        for (i = 1; !stop && i <= viewer_height - 2; i++) {
-            if (current->current_screen[i - 1] == nullptr)
-                stop = true;
-            else
-                view_port.print(current->current_screen[i - 1]);
+            // Write the screen number in the lower left corner.
+            char buffer[20];
+            std::sprintf(buffer, "%2d/%2d", static_cast<int>(current - base) + 1, size);
+            view_port.print_at(viewer_height - 3, viewer_width - 8, buffer);
+            repaint = false;
         }
 
-        int ch;
-        switch (ch = scr::key()) {
+        const int ch = scr::key();
+        switch (ch) {
         case scr::K_PGDN:
             current = current->next_screen;
+            top = 0;
+            repaint = true;
             break;
 
         case scr::K_PGUP:
             current = current->previous_screen;
+            top = 0;
+            repaint = true;
+            break;
+
+        case scr::K_DOWN:
+            repaint = top + visible_lines < length;
+            top += repaint ? 1 : 0;
+            break;
+
+        case scr::K_UP:
+            repaint = top > 0;
+            top -= repaint ? 1 : 0;
             break;
 
         default:
@@ -304,11 +573,6 @@ const HelpScreen *display_screens(const HelpScreen *const base, const HelpScreen
             ;
         }
 
-        if (ch == scr::K_PGUP || ch == scr::K_PGDN) {
-            scr::clear(view_port.row(), view_port.column(), view_port.width(),
-                       view_port.height(), view_port.color());
-        }
-
         // Break out of infinite loop if user's seen enough.
         if (ch == scr::K_ESC)
             break;
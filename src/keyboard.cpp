@@ -3,18 +3,31 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <thread>
 
+#include <screen/StatusLine.hpp>
 #include <screen/screen.hpp>
 
+#include "Completion.hpp"
+#include "DiskEditFile.hpp"
+#include "EventLoop.hpp"
 #include "FileList.hpp"
+#include "JobList.hpp"
+#include "MacroTrace.hpp"
+#include "Renderer.hpp"
+#include "Trace.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
 #include "keyboard.hpp"
 #include "support.hpp"
 
-#define MAX_MACRO_LENGTH 256 // Max number of keystrokes in the keyboard macro.
-#define MAX_NESTED_MACROS 4  // Max number of nested keyboard macros.
+#define MAX_NESTED_MACROS 4  // Max number of nested repeat sequences.
+#define INDEX_STEP 4096      // Lines indexed for procedures between checks for a keystroke.
+#define PROGRESS_INTERVAL 100 // Milliseconds between updates of the background status line.
 
 /*======================================*/
 /*           Internal Classes           */
@@ -31,6 +44,9 @@ class KeyboardScript {
     virtual ~KeyboardScript() { return; }
     virtual int get_keystroke() = 0;
     virtual bool is_dynamic() = 0;
+
+    //! Takes the remaining repetitions of key so that they can be done in one batch.
+    virtual int take_repeats(int) { return 0; }
 };
 
 /*!
@@ -44,6 +60,85 @@ class NeverEndingSource : public KeyboardScript {
     virtual bool is_dynamic() { return false; }
 };
 
+//! Returns the text of the status line shown while work goes on in the background.
+static const char *background_status()
+{
+    static char line[81];
+    if (DiskEditFile::background_loads() == 0)
+        return JobList::status();
+    std::snprintf(line, sizeof(line), " Loading files in the background: %d remaining",
+                  DiskEditFile::background_loads());
+    return line;
+}
+
+static scr::StatusLine background_line; // Shows the work going on in the background.
+static bool background_shown = false;   // =true while background_line is open.
+
+//! Removes the background status line from the screen.
+static void hide_background_progress()
+{
+    if (background_shown) {
+        background_line.close();
+        background_shown = false;
+    }
+}
+
+/*!
+ * Shows the progress of background file reads and background jobs on the bottom line of the
+ * screen and gathers the output of the jobs into their files. Returns false once there is
+ * nothing left in the background.
+ */
+static bool show_background_progress()
+{
+    // The status line is closed while the file is shown since it keeps what it covers.
+    if (JobList::poll()) {
+        hide_background_progress();
+        WindowList::display();
+    }
+    if (DiskEditFile::background_loads() == 0 && JobList::count() == 0) {
+        hide_background_progress();
+        scr::refresh();
+        return false;
+    }
+
+    if (!background_shown) {
+        background_line.set(background_status);
+        background_line.open(scr::number_of_rows(), 1, scr::number_of_columns(),
+                             scr::REV_WHITE);
+        background_shown = true;
+    }
+    background_line.show();
+    scr::refresh();
+    return true;
+}
+
+//! Brings the procedure index of the active file up to date, a few lines at a time.
+/*!
+ * Files still being read in the background are left alone since examining them would wait for
+ * the read. This is an idle task (see EventLoop::add_idle).
+ */
+static bool index_active_file()
+{
+    return DiskEditFile::background_loads() == 0 &&
+           FileList::active_file().index_procedures(INDEX_STEP);
+}
+
+//! Reads a keystroke from the keyboard, handling quoted characters.
+static int read_keystroke()
+{
+    int return_value = scr::key();
+
+    // If this is a quoted character, turn on it's MSB!
+    if (return_value == scr::K_CTRLQ) {
+        return_value = scr::key() | 0x8000;
+        Renderer::note_input(2);
+    }
+    else
+        Renderer::note_input();
+    Trace::instant("key", "input", return_value);
+    return return_value;
+}
+
 /*!
  * This function gets a keystroke from a NeverEndingSource object. It is complicated by the
  * mouse handling. Mouse activity is detected and handled here in a way which is transparent to
@@ -54,16 +149,67 @@ class NeverEndingSource : public KeyboardScript {
  */
 int NeverEndingSource::get_keystroke()
 {
-    // Display everytime a keystroke is obtained from a NeverEnding_Source.
-    FileList::active_file().display();
+    static const bool idle_tasks_added = (EventLoop::add_idle(index_active_file),
+                                          EventLoop::add_idle(Completion::update),
+                                          EventLoop::add_idle(Renderer::follow_size), true);
+    (void)idle_tasks_added;
+
+    // Display before each keystroke obtained from a NeverEndingSource, but no more than once
+    // per frame interval. Keystrokes that are waiting, or that arrive before the next frame is
+    // due, are handled first so pastes and held keys don't spend their time painting frames
+    // that are never seen.
+    const int wait = Renderer::time_to_frame();
+    bool typeahead = scr::key_available(0);
+    if (!typeahead && wait > 0)
+        typeahead = scr::key_available(wait);
+    if (typeahead && wait > 0)
+        return read_keystroke();
+    Renderer::frame();
+    if (typeahead)
+        return read_keystroke();
+
+    // Attend to whatever is going on in the background until the user presses a key.
+    unsigned progress_timer = 0;
+    if (show_background_progress()) {
+        progress_timer = EventLoop::add_timer(
+            PROGRESS_INTERVAL,
+            [&progress_timer] {
+                if (!show_background_progress()) {
+                    EventLoop::cancel_timer(progress_timer);
+                    progress_timer = 0;
+                }
+            },
+            true);
+    }
+    EventLoop::wait_for_key();
+    EventLoop::cancel_timer(progress_timer);
+    hide_background_progress();
 
-    // Read a keystroke.
-    int return_value = scr::key();
+    return read_keystroke();
+}
 
-    // If this is a quoted character, turn on it's MSB!
-    if (return_value == scr::K_CTRLQ)
-        return_value = scr::key() | 0x8000;
-    return return_value;
+/*!
+ * This class supplies the keystrokes of a script being replayed (see Replay). They come from
+ * scr::key as usual, but each is shown in a frame of its own so that every keystroke pays for
+ * its display. Files still being read in the background when the script starts are finished
+ * first, and callbacks posted by other threads are run before each keystroke.
+ */
+class ReplaySource : public KeyboardScript {
+  public:
+    virtual int get_keystroke();
+    virtual bool is_dynamic() { return false; }
+};
+
+int ReplaySource::get_keystroke()
+{
+    static bool settled = false;
+    while (!settled && DiskEditFile::background_loads() > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    settled = true;
+
+    EventLoop::wait_for_key();
+    Renderer::frame();
+    return read_keystroke();
 }
 
 /*!
@@ -81,6 +227,7 @@ class RepeatSequence : public KeyboardScript {
 
     virtual int get_keystroke();
     virtual bool is_dynamic() { return true; }
+    virtual int take_repeats(int key);
 };
 
 /*!
@@ -123,97 +270,14 @@ int RepeatSequence::get_keystroke()
     return return_value;
 }
 
-/*!
- * This class stores and manages a learned keyboard macro. Unlike objects of type
- * RepeatSequence, objects of this type cannot be allocated dynamically in the same way. They
- * must be kept around so that a learned macro can be replayed several times.
- */
-class KeyboardMacro : public KeyboardScript {
-  private:
-    int macro_buffer[MAX_MACRO_LENGTH]; //!< Contains text of the macro.
-    int macro_size;                     //!< Number of valid characters in macro.
-    int macro_index;                    //!< Index of next character to use.
-    bool learning;                      //!< =true when recording a macro.
-    bool learned;                       //!< =true when macro is defined.
-    KeyboardScript *key_source;         //!< Source of keystrokes when recording.
-
-  public:
-    KeyboardMacro() { learned = false; }
-
-    void learn(KeyboardScript *source); // Start recording.
-    void prepare();                     // Get ready to execute.
-    virtual int get_keystroke();
-    virtual bool is_dynamic() { return false; }
-};
-
-/*!
- * This function must be called to prepare a Keyboard_Macro for learning.
- */
-void KeyboardMacro::learn(KeyboardScript *source)
-{
-    macro_size = 0;
-    macro_index = 0;
-    learning = true;
-    key_source = source;
-    info_message("Recording keyboard macro");
-    return;
-}
-
-/*!
- * This function must be called to prepare a Keyboard_Macro for execution.
- */
-void KeyboardMacro::prepare()
-{
-    macro_index = 0;
-    learning = false;
-    return;
-}
-
-/*!
- * This function either learns a keyboard macro or executes one depending on which of learn() or
- * prepare() was called beforehand.
- */
-int KeyboardMacro::get_keystroke()
+//! Returns the repetitions left if key is the key being repeated and stops repeating it.
+int RepeatSequence::take_repeats(const int key)
 {
-    int return_value;
-
-    if (learning) {
-        return_value = key_source->get_keystroke();
-        if (return_value == scr::K_CTRLK) {
-            info_message("Finished");
-            learning = false;
-            learned = true;
-            return_value = -1;
-        }
-        else if (return_value == scr::K_CTRLE) {
-            error_message("Can't execute a keyboard macro recursively");
-            info_message("Finished");
-            learning = false;
-            learned = true;
-            return_value = -1;
-        }
-        else if (macro_size == MAX_MACRO_LENGTH) {
-            warning_message("Keyboard macro buffer is full");
-        }
-        else {
-            macro_buffer[macro_size++] = return_value;
-        }
-    }
-
-    else if (!learned) {
-        error_message("Keyboard macro is not defined");
-        return_value = -1;
-    }
-
-    else {
-        if (macro_index == macro_size)
-            return_value = -1;
-        else {
-            return_value = macro_buffer[macro_index++];
-        }
-    }
-
-    return return_value;
+    if (get_count || key != repeat_key)
+        return 0;
+    const int result = repeat_count;
+    repeat_count = 0;
+    return result;
 }
 
 /*==================================*/
@@ -221,14 +285,15 @@ int KeyboardMacro::get_keystroke()
 /*==================================*/
 
 // The following data sets up a stack of keyboard source activation records. At the bottom of
-// that stack is a never ending source of keystrokes from the standard input device. This stack
-// greatly simplifies problems that arise from interactions between repeat sequences and the
-// keyboard macro. It also sets the stage for multiple keyboard macros and macro files.
+// that stack is a never ending source of keystrokes from the standard input device. Repeat
+// sequences are stacked above it. The keyboard macro is not a source of keystrokes; it is
+// recorded and replayed (see MacroTrace) by the KeyboardWord that asks for keys.
 //
 static NeverEndingSource standard_input;
+static ReplaySource replay_input;
 static KeyboardScript *activations[MAX_NESTED_MACROS] = {&standard_input};
 static KeyboardScript **current_script = &activations[0];
-static KeyboardMacro primary_macro;
+static int replays = 0; // The number of replays requested by the last REPLAY_MACRO.
 
 /*=====================================================*/
 /*           Member Functions of Key_Handler           */
@@ -238,7 +303,9 @@ namespace KeyHandler {
 
     /*!
      * This function gets a keystroke from the user. It waits until an acceptable keystroke is
-     * received. It returns keycodes in the same form as returned by scr::key( ).
+     * received. It returns keycodes in the same form as returned by scr::key( ), or
+     * REPLAY_MACRO. A request to replay the macro that is itself repeated \e n times is
+     * returned once, with a replay count of \e n, so that the replays run as a batch.
      */
     int get_key()
     {
@@ -253,31 +320,53 @@ namespace KeyHandler {
                 break;
 
             case scr::K_CTRLR: {
-                KeyboardScript *previous = *current_script;
-                *++current_script = new RepeatSequence(previous);
-                if (*current_script == nullptr) {
-                    memory_message("Can't process repeat request");
-                    current_script--;
+                if (current_script == &activations[MAX_NESTED_MACROS - 1]) {
+                    error_message("Repeat sequences are nested too deeply");
+                }
+                else {
+                    KeyboardScript *previous = *current_script;
+                    *++current_script = new RepeatSequence(previous);
                 }
                 key_code = -1;
             } break;
 
-            case scr::K_CTRLK: {
-                KeyboardScript *previous = *current_script;
-                primary_macro.learn(previous);
-                *++current_script = &primary_macro;
+            case scr::K_CTRLK:
+                if (keyboard_macro.recording())
+                    keyboard_macro.finish_recording();
+                else
+                    keyboard_macro.start_recording();
                 key_code = -1;
-            } break;
+                break;
 
-            case scr::K_CTRLE: {
-                primary_macro.prepare();
-                *++current_script = &primary_macro;
-                key_code = -1;
-            } break;
+            case scr::K_CTRLE:
+                if (keyboard_macro.recording()) {
+                    error_message("Can't execute a keyboard macro recursively");
+                    keyboard_macro.finish_recording();
+                    key_code = -1;
+                }
+                else if (!keyboard_macro.defined()) {
+                    error_message("Keyboard macro is not defined");
+                    key_code = -1;
+                }
+                else {
+                    replays = 1 + (*current_script)->take_repeats(key_code);
+                    key_code = REPLAY_MACRO;
+                }
+                break;
             }
         } while (key_code == -1);
 
         return key_code;
     }
 
+    int replay_count()
+    {
+        return replays;
+    }
+
+    void replay()
+    {
+        activations[0] = &replay_input;
+    }
+
 } // namespace KeyHandler
@@ -11,9 +11,18 @@
  * is necessary to support macros that make use of arbitrary recursion.
  */
 
+#include <chrono>
 #include <cstdlib>
+#include <memory>
+#include <utility>
+
+#include <screen/screen.hpp>
 
 #include "EditBuffer.hpp"
+#include "EventLoop.hpp"
+#include "MacroProfile.hpp"
+#include "MacroProgram.hpp"
+#include "Renderer.hpp"
 #include "WordSource.hpp"
 #include "macro_stack.hpp"
 
@@ -37,10 +46,40 @@ StackInitializer::StackInitializer()
 
 static StackInitializer setup_stack;
 
+namespace {
+
+    // While a macro is suspended, the longest time the event loop sleeps before the source
+    // waiting is asked again whether it is ready.
+    constexpr int suspend_poll = 100;
+
+    // The time a macro runs between attending to the events that have arrived meanwhile.
+    constexpr std::chrono::milliseconds macro_slice(100);
+
+    std::chrono::steady_clock::time_point slice_start;
+
+    //! Lets the display and the work finished in the background catch up with a long macro.
+    void yield_if_due()
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - slice_start < macro_slice)
+            return;
+        EventLoop::run_pending();
+        Renderer::frame();
+        slice_start = std::chrono::steady_clock::now();
+    }
+
+} // namespace
+
 /*!
  * Get the next macro word. This function invokes the get_word method for the object currently
  * at the top of the macro stack. If that function returns false, it tries to pop that object
  * off the stack and kill it.
+ *
+ * The word sources on the stack are the frames of a stackless coroutine: each keeps its place
+ * in the macro between calls. A source that isn't ready suspends the macro, which is resumed
+ * from the same place once the source is ready; meanwhile (between commands, so no command
+ * sees the files change under it) events are dispatched. A macro that runs for long without
+ * being suspended yields now and then to do the same and to show what it has done.
  */
 void get_word(EditBuffer &next_word)
 {
@@ -48,18 +87,32 @@ void get_word(EditBuffer &next_word)
     // object that can comply. The KeyboardWord object at the bottom of the stack will comply;
     // this loop can't run forever.
     //
-    bool result;
-    do {
+    for (;;) {
         WordSource *current_source = *macro_stack.get();
-        result = current_source->get_word(next_word);
+        if (macro_stack.size() == 1)
+            slice_start = std::chrono::steady_clock::now();
+        else
+            yield_if_due();
 
-        // If it couldn't do it, kill this WordSource and try the next.
-        if (result == false) {
-            macro_stack.pop(current_source);
-            delete current_source;
+        if (!current_source->ready()) {
+            scr::refresh();
+            const auto waited = std::chrono::steady_clock::now();
+            EventLoop::wait_for_event(suspend_poll);
+            slice_start = std::chrono::steady_clock::now();
+            const std::chrono::nanoseconds suspended(slice_start - waited);
+            MacroProfile::suspended(suspended.count());
+            continue;
         }
+        if (macro_stack.size() > 1)
+            MacroProfile::source_word(current_source, current_source->name());
+        if (current_source->get_word(next_word))
+            return;
 
-    } while (result == false);
+        // If it couldn't do it, kill this WordSource and try the next.
+        MacroProfile::source_popped(current_source);
+        macro_stack.pop(current_source);
+        delete current_source;
+    }
 }
 
 void start_macro_string(const char *macro_text)
@@ -69,9 +122,17 @@ void start_macro_string(const char *macro_text)
     macro_stack.push(new_source);
 }
 
+/*!
+ * The file is compiled into a MacroProgram (or taken from the cache of compiled programs) and a
+ * ProgramWord executing it is pushed onto the macro stack. Nothing is pushed if the file can't
+ * be read.
+ */
 void start_macro_file(const char *file_name)
 {
-    // Create a FileWord containing the macro and push it onto the macro stack.
-    FileWord *new_source = new FileWord(file_name);
+    std::shared_ptr<const MacroProgram> program = load_macro_program(file_name);
+    if (program == nullptr)
+        return;
+
+    ProgramWord *new_source = new ProgramWord(std::move(program), file_name);
     macro_stack.push(new_source);
 }
@@ -3,241 +3,408 @@
  *  \author  Peter Chapin <spicacality@kelseymountain.org>
  */
 
+#include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <utility>
 
 #include <screen/Shadow.hpp>
 #include <screen/Window.hpp>
 #include <screen/screen.hpp>
 
 #include "EditBuffer.hpp"
+#include "MacroTrace.hpp"
+#include "PromptHistory.hpp"
 #include "global.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
 
+//= ParameterStack ========================================================
+
+namespace {
+
+    //! Decodes text consisting entirely of an optionally signed decimal number.
+    bool parse_integer(const std::string_view text, long &result)
+    {
+        const char *const end = text.data() + text.size();
+        const std::from_chars_result parsed = std::from_chars(text.data(), end, result);
+        return parsed.ec == std::errc() && parsed.ptr == end;
+    }
+
+} // namespace
+
+/*!
+ * Creates an integer if the text is a number written the way it would be displayed (no leading
+ * zeros or plus sign). Such text converts back exactly, so commands that want text see no
+ * difference. Anything else is kept as text.
+ */
+ParameterStack::Value ParameterStack::Value::from_text(const std::string_view text)
+{
+    long number;
+    const std::size_t digits_start = (!text.empty() && text[0] == '-') ? 1 : 0;
+    if (text.size() > digits_start && text.size() - digits_start < 19 &&
+        (text[digits_start] != '0' || text.size() == 1) && parse_integer(text, number))
+        return Value(number);
+    return Value(EditBuffer(text.data(), text.size()));
+}
+
+//! Gets the value as a number. Returns false if it is text that isn't a decimal number.
+bool ParameterStack::Value::get_integer(long &result) const
+{
+    if (integer) {
+        result = number;
+        return true;
+    }
+    char buffer[32];
+    if (text.length() >= sizeof(buffer))
+        return false;
+    const std::size_t count = text.copy(buffer, text.length());
+    return parse_integer(std::string_view(buffer, count), result);
+}
+
+//! Moves the value into result as text. Integers are written in decimal.
+void ParameterStack::Value::take_text(EditBuffer &result)
+{
+    if (integer) {
+        char buffer[32];
+        const int count = std::snprintf(buffer, sizeof(buffer), "%ld", number);
+        result = EditBuffer(buffer, static_cast<std::size_t>(count));
+    }
+    else {
+        result = std::move(text);
+    }
+}
+
+//! Moves the top of the stack into text, converting integers. Does nothing if it is empty.
+void ParameterStack::pop(EditBuffer &text)
+{
+    if (values.empty())
+        return;
+    values.back().take_text(text);
+    values.pop_back();
+}
+
+//! Gets the level depth below the top (0 is the top) as a number. The stack is not changed.
+/*!
+ * \return false if there is no such level or it is text that isn't a decimal number.
+ */
+bool ParameterStack::get_integer(const std::size_t depth, long &number) const
+{
+    if (depth >= values.size())
+        return false;
+    return values[values.size() - 1 - depth].get_integer(number);
+}
+
+//! Removes the top of the stack. Does nothing if it is empty.
+void ParameterStack::delete_top()
+{
+    if (!values.empty())
+        values.pop_back();
+}
+
+//! Pushes a copy of the top of the stack. Does nothing if it is empty.
+void ParameterStack::duplicate()
+{
+    if (!values.empty())
+        values.push_back(values.back());
+}
+
+//! Exchanges the top two levels. Does nothing if there are fewer than two.
+void ParameterStack::exchange()
+{
+    if (values.size() >= 2)
+        std::swap(values[values.size() - 1], values[values.size() - 2]);
+}
+
+//= Parameter =============================================================
+
+//! The box the user types a parameter into, and the state of the editing.
+struct Parameter::Prompt {
+    scr::SimpleWindow box;
+    scr::Shadow box_shadow;
+    EditBuffer workspace;       //!< The text being edited.
+    std::uint64_t entry = 0;    //!< The entry of the history the workspace was taken from.
+    std::string recalled;       //!< The text of that entry.
+    std::string prefix;         //!< What the entries recalled start with.
+    unsigned cursor_offset = 0;
+    unsigned display_offset = 0;
+    bool replace_mode = false;
+    bool first_key = true;      //!< =true until a key has been handled.
+
+    ~Prompt()
+    {
+        box.close();
+        box_shadow.close();
+    }
+};
+
 Parameter::Parameter(const char *prompt_string)
 {
     this->prompt_string = prompt_string;
 }
 
-static bool add(EditBuffer *line, EditList &data)
+Parameter::~Parameter() = default;
+
+//! Starts editing the given entry of the history.
+void Parameter::load(const std::uint64_t entry, const std::string &text)
 {
-    // Insert into the EditList.
-    data.jump_to(0);
-    data.insert(line);
+    prompt->entry = entry;
+    prompt->recalled = text;
+    prompt->workspace = EditBuffer(text.data(), text.size());
+    prompt->cursor_offset = prompt->workspace.length();
+    prompt->display_offset = 0;
+    prompt->replace_mode = false;
+    prompt->first_key = true;
+    show();
+}
 
-    // If the list is too long, get rid of one of the parameter strings.
-    long item_count = data.size();
-    if (item_count > 8) {
-        data.jump_to(item_count - 1);
-        delete data.get();
-        data.erase();
+//! Starts editing the next older (or newer) entry of the history.
+/*!
+ * If the text was edited since it was recalled, the entries recalled from then on are those
+ * starting with it, newest first. Going newer than the newest of them brings the text back.
+ */
+void Parameter::recall(const bool older)
+{
+    std::uint64_t entry = prompt->entry;
+    const std::string text = prompt->workspace.to_string();
+    if (text != prompt->recalled) {
+        prompt->prefix = text;
+        entry = 0;
     }
-    return true;
+
+    std::string found;
+    if (PromptHistory::find(prompt_string, prompt->prefix, older, entry, found))
+        load(entry, found);
+    else if (!older && !prompt->prefix.empty())
+        load(0, prompt->prefix);
+    else
+        load(prompt->entry, prompt->recalled);
 }
 
-int Parameter::edit(EditBuffer &workspace)
+//! Writes the workspace into the box and puts the cursor where it is.
+void Parameter::show()
 {
-    int key;
-    bool first_key = true;
-    unsigned cursor_offset = workspace.length();
-    unsigned display_offset = 0;
+    EditBuffer &workspace = prompt->workspace;
+    unsigned &cursor_offset = prompt->cursor_offset;
+    unsigned &display_offset = prompt->display_offset;
     int text_column = start_column + std::strlen(prompt_string) + 3;
     int text_width = start_column + box_size - text_column - 1;
-    bool replace_mode = false;
+    std::string workspace_string = workspace.to_string();
 
-    do {
-        std::string workspace_string = workspace.to_string();
+    // Make sure our limits are ok. We want the display to look good!
+    if (cursor_offset < display_offset)
+        display_offset = cursor_offset;
 
-        // Make sure our limits are ok. We want the display to look good!
-        if (cursor_offset < display_offset)
-            display_offset = cursor_offset;
+    if (cursor_offset > display_offset + text_width)
+        display_offset = cursor_offset - text_width;
 
-        if (cursor_offset > display_offset + text_width)
-            display_offset = cursor_offset - text_width;
+    std::size_t displayed_length = std::strlen(workspace_string.c_str() + display_offset);
+    if (static_cast<int>(displayed_length) > text_width)
+        displayed_length = text_width;
 
-        std::size_t displayed_length = std::strlen(workspace_string.c_str() + display_offset);
-        if (static_cast<int>(displayed_length) > text_width)
-            displayed_length = text_width;
+    scr::write_span_text(start_row + 1, text_column, workspace_string.c_str() + display_offset,
+                         displayed_length);
+    scr::set_cursor_position(start_row + 1, text_column + cursor_offset - display_offset);
 
-        scr::print_text(start_row + 1, text_column, text_width, "%s",
-                        workspace_string.c_str() + display_offset);
-        scr::set_cursor_position(start_row + 1, text_column + cursor_offset - display_offset);
+    // Clear the rest.
+    if (text_width - displayed_length != 0) {
+        scr::clear(start_row + 1, text_column + displayed_length, text_width - displayed_length,
+                   1, scr::REV_WHITE);
+    }
+}
 
-        // Clear the rest.
-        if (text_width - displayed_length != 0) {
-            scr::clear(start_row + 1, text_column + displayed_length,
-                       text_width - displayed_length, 1, scr::REV_WHITE);
+//! Applies an editing key to the workspace.
+void Parameter::edit(const int key)
+{
+    EditBuffer &workspace = prompt->workspace;
+    unsigned &cursor_offset = prompt->cursor_offset;
+
+    // Handle editing.
+    switch (key) {
+
+    case scr::K_INS:
+        if (prompt->replace_mode)
+            prompt->replace_mode = false;
+        else
+            prompt->replace_mode = true;
+        break;
+
+    case scr::K_HOME:
+        cursor_offset = 0;
+        break;
+
+    case scr::K_END:
+        cursor_offset = workspace.length();
+        break;
+
+    case scr::K_RIGHT:
+        if (cursor_offset != workspace.length())
+            cursor_offset++;
+        break;
+
+    case scr::K_CRIGHT:
+        cursor_offset = word_right(workspace, cursor_offset, 1U);
+        break;
+
+    case scr::K_LEFT:
+        if (cursor_offset != 0)
+            cursor_offset--;
+        break;
+
+    case scr::K_CLEFT:
+        cursor_offset = word_left(workspace, cursor_offset, 1U);
+        break;
+
+    case scr::K_BACKSPACE:
+        if (cursor_offset != 0) {
+            cursor_offset--;
+            if (!prompt->replace_mode)
+                workspace.erase(cursor_offset);
         }
+        break;
 
-        // Handle editing.
-        switch (key = scr::key()) {
+    case scr::K_DEL:
+        if (cursor_offset != workspace.length()) {
+            workspace.erase(cursor_offset);
+        }
+        break;
 
-        case scr::K_DOWN:
-        case scr::K_ESC:
-        case scr::K_RETURN:
-        case scr::K_UP:
-            break;
+    default:
 
-        case scr::K_INS:
-            if (replace_mode)
-                replace_mode = false;
-            else
-                replace_mode = true;
-            break;
-
-        case scr::K_HOME:
-            cursor_offset = 0;
-            break;
-
-        case scr::K_END:
-            cursor_offset = workspace.length();
-            break;
-
-        case scr::K_RIGHT:
-            if (cursor_offset != workspace.length())
-                cursor_offset++;
-            break;
-
-        case scr::K_CRIGHT:
-            cursor_offset = word_right(workspace, cursor_offset);
-            break;
-
-        case scr::K_LEFT:
-            if (cursor_offset != 0)
-                cursor_offset--;
-            break;
-
-        case scr::K_CLEFT:
-            cursor_offset = word_left(workspace, cursor_offset);
-            break;
-
-        case scr::K_BACKSPACE:
-            if (cursor_offset != 0) {
-                cursor_offset--;
-                if (!replace_mode)
-                    workspace.erase(cursor_offset);
-            }
-            break;
+        // Ignore other special keys.
+        if (key < 128 && std::isprint(key)) {
 
-        case scr::K_DEL:
-            if (cursor_offset != workspace.length()) {
-                workspace.erase(cursor_offset);
-            }
-            break;
-
-        default:
-
-            // Ignore other special keys.
-            if (key < 128 && std::isprint(key)) {
-
-                // If first key is a letter, erase any initial buffer contents.
-                if (first_key) {
-                    workspace.erase();
-                    display_offset = 0;
-                    cursor_offset = 0;
-                }
-
-                char letter = static_cast<char>(key);
-                if (replace_mode)
-                    workspace.replace(letter, cursor_offset);
-                else
-                    workspace.insert(letter, cursor_offset);
-                cursor_offset++;
+            // If first key is a letter, erase any initial buffer contents.
+            if (prompt->first_key) {
+                workspace.erase();
+                prompt->display_offset = 0;
+                cursor_offset = 0;
             }
-            break;
-
-        } // End of switch.
 
-        // Turn off first key flag.
-        first_key = false;
+            char letter = static_cast<char>(key);
+            if (prompt->replace_mode)
+                workspace.replace(letter, cursor_offset);
+            else
+                workspace.insert(letter, cursor_offset);
+            cursor_offset++;
+        }
+        break;
 
-    } while (key != scr::K_ESC && key != scr::K_RETURN && key != scr::K_UP &&
-             key != scr::K_DOWN);
+    } // End of switch.
 
-    return key;
+    // Turn off first key flag.
+    prompt->first_key = false;
+    show();
 }
 
 int Parameter::get(bool pop)
 {
-    int return_value = true;
+    Status status = begin(pop);
+    while (status == PENDING)
+        status = step(scr::key());
+    return status == ACCEPTED;
+}
 
-    // Pop parameter directly off the parameter stack if pop == true and if there's something to
-    // pop.
-    //
+/*!
+ * The parameter is popped directly off the parameter stack if pop is true and there is
+ * something to pop. Otherwise a replayed keyboard macro answers as the user did when it was
+ * recorded. Otherwise the input box is opened and PENDING returned; the keys the user types
+ * are then given to step() until it returns something else.
+ */
+Parameter::Status Parameter::begin(bool pop)
+{
+    std::string answer;
+    bool cancelled;
+
+    // Parameters given by macros aren't kept in the history, which is for what the user enters.
     if (pop == true && parameter_stack.size() != 0) {
-        EditBuffer *inserted_line = new EditBuffer(*parameter_stack.get());
-        add(inserted_line, input_data);
-        parameter_stack.delete_top();
+        EditBuffer popped;
+        parameter_stack.pop(popped);
+        latest = popped.to_string();
+        return ACCEPTED;
     }
 
-    // Otherwise, let the user enter something.
-    else {
-        scr::SimpleWindow box;
-        scr::Shadow box_shadow;
-        EditBuffer *workspace;
-        long item_number = 0L;
-        int key;
-
-        // Draw the input box on the screen.
-        box_shadow.open(start_row + 1, start_column + 2, box_size, 3);
-        box.open(start_row, start_column, box_size, 3, scr::REV_WHITE, scr::SINGLE_LINE);
-
-        // Write the appropriate prompt into the box.
-        scr::print_text(start_row + 1, start_column + 2, box_size - 3, "%s", prompt_string);
-
-        do {
-            input_data.jump_to(item_number);
-            if (input_data.get() == nullptr)
-                workspace = new EditBuffer;
-            else
-                workspace = new EditBuffer(*input_data.get());
-
-            switch (key = edit(*workspace)) {
-            case scr::K_UP:
-                item_number++;
-                if (item_number >= input_data.size())
-                    item_number--;
-                delete workspace;
-                break;
-
-            case scr::K_DOWN:
-                item_number--;
-                if (item_number < 0)
-                    item_number++;
-                delete workspace;
-                break;
-
-            case scr::K_RETURN:
-                // If the parameter's list is not empty and the first item is what the user just
-                // typed, do nothing. Otherwise add the item to the list.
-                //
-                input_data.jump_to(0);
-                if (input_data.size() != 0 && *input_data.get() == *workspace)
-                    delete workspace;
-                else
-                    add(workspace, input_data);
-                break;
-
-            case scr::K_ESC:
-                delete workspace;
-                break;
-            }
+    if (keyboard_macro.take_answer(answer, cancelled)) {
+        if (cancelled)
+            return CANCELLED;
+        PromptHistory::add(prompt_string, answer);
+        latest = std::move(answer);
+        return ACCEPTED;
+    }
 
-        } while (key != scr::K_ESC && key != scr::K_RETURN);
+    // Draw the input box on the screen.
+    prompt = std::make_unique<Prompt>();
+    prompt->box_shadow.open(start_row + 1, start_column + 2, box_size, 3);
+    prompt->box.open(start_row, start_column, box_size, 3, scr::REV_WHITE, scr::SINGLE_LINE);
+
+    // Write the appropriate prompt into the box.
+    scr::write_span_text(start_row + 1, start_column + 2, prompt_string,
+                         std::min<std::size_t>(std::strlen(prompt_string), box_size - 3));
+    std::uint64_t entry = 0;
+    std::string text;
+    PromptHistory::find(prompt_string, "", true, entry, text);
+    load(entry, text);
+    return PENDING;
+}
 
-        box.close();
-        box_shadow.close();
-        if (key == scr::K_ESC)
-            return_value = false;
+/*!
+ * The up and down arrows step through the history (see recall), Enter accepts the text, and
+ * Esc cancels it. Other keys edit the text. The box is closed once the parameter is accepted
+ * or cancelled.
+ */
+Parameter::Status Parameter::step(const int key)
+{
+    switch (key) {
+    case scr::K_UP:
+        recall(true);
+        return PENDING;
+
+    case scr::K_DOWN:
+        recall(false);
+        return PENDING;
+
+    case scr::K_RETURN:
+        latest = prompt->workspace.to_string();
+        PromptHistory::add(prompt_string, latest);
+        prompt.reset();
+        keyboard_macro.record_answer(latest);
+        return ACCEPTED;
+
+    case scr::K_ESC:
+        prompt.reset();
+        keyboard_macro.record_cancel();
+        return CANCELLED;
+
+    default:
+        edit(key);
+        return PENDING;
     }
+}
 
-    return return_value;
+//! Reads a number. An integer on top of the parameter stack is taken without conversion.
+/*!
+ * Otherwise the parameter is read as text (from the stack or the user) and decoded. Text that
+ * isn't a number gives zero.
+ *
+ * \return false if the user aborted.
+ */
+int Parameter::get_integer(long &number)
+{
+    if (parameter_stack.get_integer(0, number)) {
+        parameter_stack.delete_top();
+        return true;
+    }
+    if (get() == false)
+        return false;
+    number = std::atol(value().c_str());
+    return true;
 }
 
 std::string Parameter::value()
 {
-    input_data.jump_to(0);
-    return input_data.get()->to_string();
+    return latest;
 }
@@ -4,13 +4,14 @@
  */
 
 #include <cctype>
-#include <cstring>
+#include <string>
+#include <string_view>
 
 #include <screen/screen.hpp>
 
 #include "EditBuffer.hpp"
+#include "HexImage.hpp"
 #include "special.hpp"
-#include "support.hpp"
 
 const char *asm_keys[] = {"MACRO", "macro", "PROC", "proc", "STRUCT", "struct", nullptr};
 
@@ -21,29 +22,39 @@ const char *ada_keys[] = {"FUNCTION",  "function", "Function",  "PACKAGE",
 
 const char *pseudocode_keys[] = {"CLASS", "FUNCTION", "TYPE", nullptr};
 
-static const char *check_keys(const std::string &line, const char **keys)
+//! Returns the position of the first of the keys found in the line (npos if none are found).
+static std::string_view::size_type check_keys(const std::string_view line, const char **keys)
 {
-    const char *subline = nullptr;
-
     while (*keys != nullptr) {
-        if ((subline = std::strstr(line.c_str(), *keys)) != nullptr)
-            return subline;
+        const std::string_view::size_type position = line.find(*keys);
+        if (position != std::string_view::npos)
+            return position;
         keys++;
     }
-    return subline;
+    return std::string_view::npos;
 }
 
-static int brace_count(const std::string &line)
+//! Reports the braces in a line to the outline as scopes.
+/*!
+ * \return True if the line opens a brace at the outermost level that remains open after it.
+ */
+static bool scan_braces(const std::string_view line, ProcedureIndex &outline)
 {
-    int count = 0;
+    bool outermost = false;
 
     for (char ch : line) {
-        if (ch == '{')
-            count++;
-        if (ch == '}')
-            count--;
+        if (ch == '{') {
+            if (outline.depth() == 0)
+                outermost = true;
+            outline.open_scope();
+        }
+        if (ch == '}') {
+            outline.close_scope();
+            if (outline.depth() == 0)
+                outermost = false;
+        }
     }
-    return count;
+    return outermost;
 }
 
 /*===================================================*/
@@ -52,65 +63,22 @@ static int brace_count(const std::string &line)
 
 bool ADA_YEditFile::next_procedure()
 {
-    bool found = false;
-    EditBuffer *line;
-
-    file_data.jump_to(current_point.cursor_line());
-    file_data.next();
-
-    while (!found && ((line = file_data.next()) != nullptr)) {
-        std::string temp = line->to_string();
-        const char *substring = check_keys(temp, ada_keys);
-        const char *comment;
-        if (substring) {
-
-            // Ignore keywords inside of comments.
-            if ((comment = std::strstr(temp.c_str(), "--")) == nullptr)
-                found = true;
-            else if (substring < comment)
-                found = true;
-        }
-    }
-
-    if (found) {
-        current_point.jump_to_line(file_data.current_index() - 1);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
-
-    return true;
+    return find_procedure(true);
 }
 
 bool ADA_YEditFile::previous_procedure()
 {
-    bool found = false;
-    EditBuffer *line;
-
-    file_data.jump_to(current_point.cursor_line());
-
-    while (!found && ((line = file_data.previous()) != nullptr)) {
-        std::string temp = line->to_string();
-        const char *substring = check_keys(temp, ada_keys);
-        const char *comment;
-        if (substring) {
-
-            // Ignore keywords inside of comments.
-            if ((comment = std::strstr(temp.c_str(), "--")) == nullptr)
-                found = true;
-            else if (substring < comment)
-                found = true;
-        }
-    }
+    return find_procedure(false);
+}
 
-    if (found) {
-        current_point.jump_to_line(file_data.current_index());
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
+bool ADA_YEditFile::procedure_line(const std::string_view line, ProcedureIndex &)
+{
+    const std::string_view::size_type keyword = check_keys(line, ada_keys);
+    if (keyword == std::string_view::npos)
+        return false;
 
-    return true;
+    // Ignore keywords inside of comments.
+    return keyword < line.find("--");
 }
 
 /*===================================================*/
@@ -119,59 +87,23 @@ bool ADA_YEditFile::previous_procedure()
 
 bool ASM_YEditFile::next_procedure()
 {
-    bool found = false;
-    EditBuffer *line;
-
-    file_data.jump_to(current_point.cursor_line());
-    file_data.next();
-
-    while (!found && ((line = file_data.next()) != nullptr)) {
-        std::string temp = line->to_string();
-        const char *substring = check_keys(temp, asm_keys);
-        if (substring) {
-
-            // Ignore "procedure", "process", etc.
-            if ((*substring != 'p' && *substring != 'P') || !std::isalpha(substring[4]))
-                found = true;
-        }
-    }
-
-    if (found) {
-        current_point.jump_to_line(file_data.current_index() - 1);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
-
-    return true;
+    return find_procedure(true);
 }
 
 bool ASM_YEditFile::previous_procedure()
 {
-    bool found = false;
-    EditBuffer *line;
-
-    file_data.jump_to(current_point.cursor_line());
-
-    while (!found && ((line = file_data.previous()) != nullptr)) {
-        std::string temp = line->to_string();
-        const char *substring = check_keys(temp, asm_keys);
-        if (substring) {
-
-            // Ignore "procedure", "process", etc.
-            if ((*substring != 'p' && *substring != 'P') || !std::isalpha(substring[4]))
-                found = true;
-        }
-    }
+    return find_procedure(false);
+}
 
-    if (found) {
-        current_point.jump_to_line(file_data.current_index());
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
+bool ASM_YEditFile::procedure_line(const std::string_view line, ProcedureIndex &)
+{
+    const std::string_view::size_type keyword = check_keys(line, asm_keys);
+    if (keyword == std::string_view::npos)
+        return false;
 
-    return true;
+    // Ignore "procedure", "process", etc.
+    return (line[keyword] != 'p' && line[keyword] != 'P') || keyword + 4 >= line.size() ||
+           !std::isalpha(static_cast<unsigned char>(line[keyword + 4]));
 }
 
 /*=================================================*/
@@ -199,93 +131,33 @@ static long find_head(EditList &data, long brace_line)
 
 bool C_YEditFile::next_procedure()
 {
-    bool found = false;
-    int total_count = 0;
-    int line_count;
-    EditBuffer *line;
-
-    if (marks_valid && current_point.cursor_line() == function_head)
-        current_point.jump_to_line(function_brace);
-
-    long line_number = current_point.cursor_line();
-
-    file_data.jump_to(0);
-
-    while ((line = file_data.next()) != NULL) {
-        std::string temp = line->to_string();
-        line_count = brace_count(temp);
-        if (total_count == 0 && line_count > 0 && file_data.current_index() - 1 > line_number) {
-
-            found = true;
-            break;
-        }
-        total_count += line_count;
-    }
-
-    if (found) {
-        marks_valid = true;
-        function_brace = file_data.current_index() - 1;
-        function_head = find_head(file_data, function_brace);
-        current_point.jump_to_line(function_head);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
-
-    return true;
+    return find_procedure(true);
 }
 
 bool C_YEditFile::previous_procedure()
 {
-    bool found = false;
-    int total_count = 0;
-    int line_count;
-    long line_number = current_point.cursor_line();
-    long last_found;
-    EditBuffer *line;
-
-    file_data.jump_to(0);
-
-    while ((line = file_data.next()) != NULL) {
-        if (file_data.current_index() - 1 == line_number)
-            break;
-        std::string temp = line->to_string();
-        line_count = brace_count(temp);
-        if (total_count == 0 && line_count > 0) {
-            last_found = file_data.current_index() - 1;
-            found = true;
-        }
-        total_count += line_count;
-    }
+    return find_procedure(false);
+}
 
-    if (found) {
-        marks_valid = true;
-        function_brace = last_found;
-        function_head = find_head(file_data, last_found);
-        current_point.jump_to_line(function_head);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
+//! A procedure starts with a line that leaves a brace open at the outermost level.
+bool C_YEditFile::procedure_line(const std::string_view line, ProcedureIndex &outline)
+{
+    return scan_braces(line, outline);
+}
 
-    return true;
+long C_YEditFile::procedure_head(const long line)
+{
+    return find_head(file_data, line);
 }
 
+//! The new line is indented further if the line before it opens a scope.
 bool C_YEditFile::extra_indent()
 {
-    long line_number = current_point.cursor_line();
+    const long line_number = current_point.cursor_line();
 
     if (line_number == 0L)
         return false;
-
-    line_number--;
-    file_data.jump_to(line_number);
-
-    std::string previous_line = file_data.get()->to_string();
-    std::string::size_type last = previous_line.find_last_not_of(" ");
-    if (last != std::string::npos && previous_line[last] == '{')
-        return true;
-    return false;
+    return opens_scope(line_number - 1);
 }
 
 bool C_YEditFile::insert_char(char letter)
@@ -293,29 +165,26 @@ bool C_YEditFile::insert_char(char letter)
     // Insert the character in the usual way.
     YEditFile::insert_char(letter);
 
-    // If this is a close brace, handle it in a special way.
-    if (letter == '}') {
+    // If this is a close brace, handle it in a special way. With several cursors the brace
+    // is left where it was typed.
+    if (letter == '}' && carets.empty()) {
 
-        bool spaces_only = true;                        // Assume everything is a space.
         file_data.jump_to(current_point.cursor_line()); // Position list at current line.
-
-        // Loop over all characters on this row up to the '}'.
-        unsigned space_count;
-        for (space_count = 0; space_count < current_point.cursor_column(); space_count++) {
-
-            // If this is a non-space, break out at once.
-            if ((*file_data.get())[space_count] != ' ') {
-                spaces_only = false;
-                break;
-            }
-        }
-
-        // If we found only spaces, backspace to the previous tab stop.
-        if (spaces_only && space_count != 0) {
-            do {
+        const EditBuffer *const line = file_data.get();
+        unsigned space_count = current_point.cursor_column();
+        const std::string_view before =
+            line->view().substr(0, line->offset_of(space_count, tab_stop));
+
+        // If there is only white space before the '}', backspace to the previous tab stop. A
+        // tab ends at a tab stop so only it is removed.
+        if (space_count != 0 && before.find_first_not_of(" \t") == std::string_view::npos) {
+            if (!before.empty() && before.back() == '\t')
                 backspace();
-                current_point.cursor_left();
-            } while (--space_count % tab_distance() != 0);
+            else {
+                do {
+                    backspace();
+                } while (--space_count % tab_distance() != 0);
+            }
         }
     }
     return true;
@@ -327,50 +196,74 @@ bool C_YEditFile::insert_char(char letter)
 
 bool PCD_YEditFile::next_procedure()
 {
-    bool found = false;
-    EditBuffer *line;
+    return find_procedure(true);
+}
 
-    file_data.jump_to(current_point.cursor_line());
-    file_data.next();
+bool PCD_YEditFile::previous_procedure()
+{
+    return find_procedure(false);
+}
 
-    while (!found && ((line = file_data.next()) != nullptr)) {
-        std::string temp = line->to_string();
-        const char *substring = check_keys(temp, pseudocode_keys);
-        if (substring)
-            found = true;
-    }
+bool PCD_YEditFile::procedure_line(const std::string_view line, ProcedureIndex &)
+{
+    return check_keys(line, pseudocode_keys) != std::string_view::npos;
+}
 
-    if (found) {
-        current_point.jump_to_line(file_data.current_index() - 1);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
+/*===================================================*/
+/*           CSV_YEditFile Specialization           */
+/*===================================================*/
 
-    return true;
+//! Returns the index of the fields, having forgotten the lines modified since it was last used.
+FieldIndex *CSV_YEditFile::fields()
+{
+    table.invalidate(take_modifications(FIELDS));
+    return &table;
 }
 
-bool PCD_YEditFile::previous_procedure()
-{
-    bool found = false;
-    EditBuffer *line;
+/*===================================================*/
+/*           HEX_YEditFile Specialization           */
+/*===================================================*/
 
-    file_data.jump_to(current_point.cursor_line());
+//! Replaces the byte (or half byte) under the cursor and moves to the next one.
+bool HEX_YEditFile::insert_char(const char letter)
+{
+    HexImage *const bytes = hex_image();
+    const long row = CP().cursor_line();
+    HexImage::Cell cell;
+    if (bytes == nullptr || !bytes->locate(row, CP().cursor_column(), cell))
+        return false;
 
-    while (!found && ((line = file_data.previous()) != nullptr)) {
-        std::string temp = line->to_string();
-        const char *substring = check_keys(temp, pseudocode_keys);
-        if (substring)
-            found = true;
+    unsigned char value = bytes->byte(cell.offset);
+    if (cell.character) {
+        if (letter < ' ' || letter > '~')
+            return false;
+        value = static_cast<unsigned char>(letter);
     }
-
-    if (found) {
-        current_point.jump_to_line(file_data.current_index());
-        current_point.adjust_window_line(1);
+    else {
+        if (!std::isxdigit(static_cast<unsigned char>(letter)))
+            return false;
+        const char digit = static_cast<char>(std::tolower(static_cast<unsigned char>(letter)));
+        const unsigned nibble =
+            static_cast<unsigned>((digit <= '9') ? digit - '0' : digit - 'a' + 10);
+        if (cell.digit == 0U)
+            value = static_cast<unsigned char>((nibble << 4) | (value & 0x0FU));
+        else
+            value = static_cast<unsigned char>((value & 0xF0U) | nibble);
     }
-    else
-        info_message("Not found");
-
+    bytes->patch(cell.offset, value);
+    mark_damaged(row, row);
+    if (bytes->patched() != 0)
+        mark_as_changed();
+
+    // Move to the next digit or character, staying put at the end of the file.
+    if (!cell.character && cell.digit == 0U)
+        cell.digit = 1U;
+    else if (cell.offset + 1 < bytes->size()) {
+        ++cell.offset;
+        cell.digit = 0U;
+    }
+    CP().jump_to_line(static_cast<long>(cell.offset / HexImage::row_bytes));
+    CP().jump_to_column(bytes->column_of(cell));
     return true;
 }
 
@@ -385,93 +278,32 @@ bool PCD_YEditFile::previous_procedure()
 
 bool SCALA_YEditFile::next_procedure()
 {
-    bool found = false;
-    int total_count = 0;
-    int line_count;
-    EditBuffer *line;
-
-    if (marks_valid && current_point.cursor_line() == function_head)
-        current_point.jump_to_line(function_brace);
-
-    long line_number = current_point.cursor_line();
-
-    file_data.jump_to(0);
-
-    while ((line = file_data.next()) != nullptr) {
-        std::string temp = line->to_string();
-        line_count = brace_count(temp);
-        if (total_count == 0 && line_count > 0 && file_data.current_index() - 1 > line_number) {
-
-            found = true;
-            break;
-        }
-        total_count += line_count;
-    }
-
-    if (found) {
-        marks_valid = true;
-        function_brace = file_data.current_index() - 1;
-        function_head = find_head(file_data, function_brace);
-        current_point.jump_to_line(function_head);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
-
-    return true;
+    return find_procedure(true);
 }
 
 bool SCALA_YEditFile::previous_procedure()
 {
-    bool found = false;
-    int total_count = 0;
-    int line_count;
-    long line_number = current_point.cursor_line();
-    long last_found;
-    EditBuffer *line;
-
-    file_data.jump_to(0);
-
-    while ((line = file_data.next()) != nullptr) {
-        if (file_data.current_index() - 1 == line_number)
-            break;
-        std::string temp = line->to_string();
-        line_count = brace_count(temp);
-        if (total_count == 0 && line_count > 0) {
-            last_found = file_data.current_index() - 1;
-            found = true;
-        }
-        total_count += line_count;
-    }
+    return find_procedure(false);
+}
 
-    if (found) {
-        marks_valid = true;
-        function_brace = last_found;
-        function_head = find_head(file_data, last_found);
-        current_point.jump_to_line(function_head);
-        current_point.adjust_window_line(1);
-    }
-    else
-        info_message("Not found");
+bool SCALA_YEditFile::procedure_line(const std::string_view line, ProcedureIndex &outline)
+{
+    return scan_braces(line, outline);
+}
 
-    return true;
+long SCALA_YEditFile::procedure_head(const long line)
+{
+    return find_head(file_data, line);
 }
 
+//! The new line is indented further if the line before it opens a scope.
 bool SCALA_YEditFile::extra_indent()
 {
-    long line_number = current_point.cursor_line();
+    const long line_number = current_point.cursor_line();
 
     if (line_number == 0L)
         return false;
-
-    line_number--;
-    file_data.jump_to(line_number);
-
-    std::string previous_line = file_data.get()->to_string();
-    std::string::size_type last = previous_line.find_last_not_of(" ");
-    if (last != std::string::npos && previous_line[last] == '{')
-        return true;
-    return false;
+    return opens_scope(line_number - 1);
 }
 
 bool SCALA_YEditFile::insert_char(char letter)
@@ -479,29 +311,26 @@ bool SCALA_YEditFile::insert_char(char letter)
     // Insert the character in the usual way.
     YEditFile::insert_char(letter);
 
-    // If this is a close brace, handle it in a special way.
-    if (letter == '}') {
+    // If this is a close brace, handle it in a special way. With several cursors the brace
+    // is left where it was typed.
+    if (letter == '}' && carets.empty()) {
 
-        bool spaces_only = true;                        // Assume everything is a space.
         file_data.jump_to(current_point.cursor_line()); // Position list at current line.
-
-        // Loop over all characters on this row up to the '}'.
-        unsigned space_count;
-        for (space_count = 0; space_count < current_point.cursor_column(); space_count++) {
-
-            // If this is a non-space, break out at once.
-            if ((*file_data.get())[space_count] != ' ') {
-                spaces_only = false;
-                break;
-            }
-        }
-
-        // If we found only spaces, backspace to the previous tab stop.
-        if (spaces_only && space_count != 0) {
-            do {
+        const EditBuffer *const line = file_data.get();
+        unsigned space_count = current_point.cursor_column();
+        const std::string_view before =
+            line->view().substr(0, line->offset_of(space_count, tab_stop));
+
+        // If there is only white space before the '}', backspace to the previous tab stop. A
+        // tab ends at a tab stop so only it is removed.
+        if (space_count != 0 && before.find_first_not_of(" \t") == std::string_view::npos) {
+            if (!before.empty() && before.back() == '\t')
                 backspace();
-                current_point.cursor_left();
-            } while (--space_count % tab_distance() != 0);
+            else {
+                do {
+                    backspace();
+                } while (--space_count % tab_distance() != 0);
+            }
         }
     }
     return true;
@@ -6,15 +6,24 @@
 #include <cctype>
 #include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include <screen/MessageWindow.hpp>
 #include <screen/environ.hpp>
 #include <screen/screen.hpp>
 
+#if eOPSYS == eWINDOWS
+#include <windows.h>
+#endif
+
 #include "FileList.hpp"
 #include "FileNameMatcher.hpp"
+#include "PipeInput.hpp"
 #include "Timer.hpp"
+#include "Utf8.hpp"
 #include "YEditFile.hpp"
 #include "global.hpp"
 #include "support.hpp"
@@ -56,56 +65,73 @@ char *adjust_date(const char *const raw_date)
     return buffer;
 }
 
-unsigned word_right(const EditBuffer &line, unsigned column)
+//! Returns true if the character at offset in text is part of a word.
+/*!
+ * Characters outside of ASCII are taken to be letters.
+ */
+static bool is_word_character(const std::string_view text, const std::size_t offset)
+{
+    if (offset >= text.size())
+        return false;
+    const unsigned char letter = static_cast<unsigned char>(text[offset]);
+    return letter >= 0x80 || std::isalnum(letter);
+}
+
+unsigned word_right(const EditBuffer &line, unsigned column, const unsigned tab)
 {
-    bool flag = std::isalnum(line[column]) ? true : false;
+    const std::string_view text = line.view();
+    std::size_t offset = line.offset_of(column, tab);
+    bool flag = is_word_character(text, offset);
 
     // If cursor on a character, skip all of them.
     while (flag == true) {
-        column++;
-        if (!std::isalnum(line[column]))
+        offset = Utf8::next(text, offset);
+        if (!is_word_character(text, offset))
             flag = false;
     }
 
     // Skip all non-alphanumeric characters.
-    while (flag == false && line[column]) {
-        column++;
-        if (std::isalnum(line[column]))
+    while (flag == false && offset < text.size()) {
+        offset = Utf8::next(text, offset);
+        if (is_word_character(text, offset))
             flag = true;
     }
-    return column;
+    return static_cast<unsigned>(line.column_of(offset, tab));
 }
 
-unsigned word_left(const EditBuffer &line, unsigned column)
+unsigned word_left(const EditBuffer &line, unsigned column, const unsigned tab)
 {
+    const std::string_view text = line.view();
+    std::size_t offset = line.offset_of(column, tab);
+
     // Are we on an alphanumeric character?
-    bool flag = std::isalnum(line[column]) ? true : false;
+    bool flag = is_word_character(text, offset);
 
     // If so, back the cursor up (if there's space).
-    if (flag == true && column != 0) {
-        column--;
-        flag = std::isalnum(line[column]) ? true : false;
+    if (flag == true && offset != 0) {
+        offset = Utf8::previous(text, offset);
+        flag = is_word_character(text, offset);
     }
 
     // Skip over any non-alphanumeric characters.
-    while (flag == false && column != 0) {
-        column--;
-        if (std::isalnum(line[column]))
+    while (flag == false && offset != 0) {
+        offset = Utf8::previous(text, offset);
+        if (is_word_character(text, offset))
             flag = true;
     }
 
     // Skip over alphanumeric characters (to just past beginning of word).
-    while (flag == true && column != 0) {
-        column--;
-        if (!std::isalnum(line[column]))
+    while (flag == true && offset != 0) {
+        offset = Utf8::previous(text, offset);
+        if (!is_word_character(text, offset))
             flag = false;
     }
 
     // Adjust back to beginning of word (word at start of line special case).
-    if (column != 0)
-        column++;
+    if (offset != 0)
+        offset = Utf8::next(text, offset);
 
-    return column;
+    return static_cast<unsigned>(line.column_of(offset, tab));
 }
 
 //! Loads the named file.
@@ -122,7 +148,8 @@ bool load_file(const char *name, long line_number, int column_number)
     bool return_value;
 
     if ((return_value = FileList::lookup(name)) == false) {
-        return_value = FileList::new_file(name);
+        return_value = PipeInput::is_pipe(name) ? PipeInput::open(name)
+                                                : FileList::new_file(name);
     }
 
     if (return_value == true) {
@@ -190,9 +217,6 @@ bool load_files(const char **argv)
 
         // Otherwise it was no switch, it must be a file name (or wildcard spec).
         else {
-            FileNameMatcher wild_match;
-            char *file_name;
-
             // If the current argument is an abbreviation, try expanding it.
             if (**argv == '.' && base_valid) {
                 workspace = base_name;
@@ -209,10 +233,11 @@ bool load_files(const char **argv)
                 }
             }
 
-            wild_match.set_name(*argv);
+            // The spec is expanded all at once, which is much faster for many matches.
+            const std::vector<std::string> file_names = FileNameMatcher::expand(*argv);
 
             // If no files match the spec, assume the spec is the name of a new file.
-            if ((file_name = wild_match.next()) == nullptr) {
+            if (file_names.empty()) {
                 if (std::strchr(*argv, '*') != nullptr || std::strchr(*argv, '?') != nullptr) {
                     warning_message("No files match %s", *argv);
                 }
@@ -229,14 +254,13 @@ bool load_files(const char **argv)
             else {
 
                 // Loop over all names which match the wildcard spec and load them.
-                while (file_name != nullptr) {
-                    load_file(file_name, line_number, column_number);
+                for (const std::string &file_name : file_names) {
+                    load_file(file_name.c_str(), line_number, column_number);
                     file_count++;
                     if (First_File) {
                         First_File = false;
                         leading_file = &FileList::active_file();
                     }
-                    file_name = wild_match.next();
                 }
             }
 
@@ -333,6 +357,62 @@ int my_strnicmp(const char *s1, const char *s2, int n)
     return 0;
 }
 
+//! Returns the full path of a file or nullptr if it can't be found. Free the result.
+static char *full_path(const char *const name)
+{
+#if defined(_WIN32)
+    return _fullpath(nullptr, name, 0);
+#else
+    return realpath(name, nullptr);
+#endif
+}
+
+std::string name_key(const char *const name)
+{
+    std::string key;
+    if (char *const path = full_path(name)) {
+        key = path;
+        std::free(path);
+    }
+    else {
+        // The file may not exist yet. Resolve the directory holding it instead.
+        const char *base = name;
+        for (const char *p = name; *p != '\0'; ++p) {
+            if (*p == '/' || *p == '\\')
+                base = p + 1;
+        }
+        const std::string directory =
+            (base == name) ? std::string(".") : std::string(name, base - name);
+        if (char *const path = full_path(directory.c_str())) {
+            key = path;
+            std::free(path);
+            if (key.empty() || (key.back() != '/' && key.back() != '\\'))
+                key += '/';
+            key += base;
+        }
+        else
+            key = name;
+    }
+    for (char &ch : key)
+        ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+    return key;
+}
+
+/*!
+ * The contents of the file are written through to the disk before the function returns on
+ * Windows. Elsewhere a rename is atomic already; callers that must survive a crash sync the
+ * temporary file before calling this.
+ */
+bool replace_file(const char *const temporary_name, const char *const name)
+{
+#if eOPSYS == eWINDOWS
+    return MoveFileExA(temporary_name, name,
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+    return std::rename(temporary_name, name) == 0;
+#endif
+}
+
 //! Displays a message for one second.
 /*!
  * This function displays the string specified by 'format' for one second. The string is
@@ -341,12 +421,12 @@ int my_strnicmp(const char *s1, const char *s2, int n)
  */
 void info_message(const char *format, ...)
 {
-    char buffer[128 + 1]; // Largest possible message without program failure.
+    char buffer[128 + 1];
     std::va_list arg_pointer;
 
-    // TODO: Fix problems if string becomes too long!
+    // Messages that are too long are cut short (some name long paths).
     va_start(arg_pointer, format);
-    std::vsprintf(buffer, format, arg_pointer);
+    std::vsnprintf(buffer, sizeof(buffer), format, arg_pointer);
     va_end(arg_pointer);
 
     scr::MessageWindow message(buffer, scr::MESSAGE_WINDOW_MESSAGE);
@@ -400,9 +480,9 @@ void warning_message(const char *format, ...)
     char buffer[128 + 1];
     std::va_list arg_pointer;
 
-    // TODO: Fix problems if string becomes too long!
+    // Messages that are too long are cut short (some name long paths).
     va_start(arg_pointer, format);
-    std::vsprintf(buffer, format, arg_pointer);
+    std::vsnprintf(buffer, sizeof(buffer), format, arg_pointer);
     va_end(arg_pointer);
 
     scr::MessageWindow message(buffer, scr::MESSAGE_WINDOW_WARNING);
@@ -418,9 +498,9 @@ void error_message(const char *format, ...)
     char buffer[128 + 1];
     std::va_list arg_pointer;
 
-    // TODO: Fix problems if string becomes too long!
+    // Messages that are too long are cut short (some list several file names).
     va_start(arg_pointer, format);
-    std::vsprintf(buffer, format, arg_pointer);
+    std::vsnprintf(buffer, sizeof(buffer), format, arg_pointer);
     va_end(arg_pointer);
 
     scr::MessageWindow message(buffer, scr::MESSAGE_WINDOW_ERROR);
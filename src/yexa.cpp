@@ -4,18 +4,30 @@
  */
 
 #include <cctype>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include <screen/MessageWindow.hpp>
 
+#include "DiskEditFile.hpp"
 #include "FileList.hpp"
 #include "FileNameMatcher.hpp"
+#include "PipeInput.hpp"
+#include "PromptHistory.hpp"
+#include "Replay.hpp"
+#include "Server.hpp"
+#include "Startup.hpp"
+#include "Trace.hpp"
+#include "WindowList.hpp"
 #include "YEditFile.hpp"
 #include "command.hpp"
 #include "command_table.hpp"
 #include "global.hpp"
+#include "keyboard.hpp"
 #include "macro_stack.hpp"
 #include "parameter_stack.hpp"
 #include "support.hpp"
@@ -73,7 +85,8 @@ static void execute_startup_macro(EditBuffer &EXE_directory)
         FileNameMatcher startup_file;
 
         EXE_directory.append("ystart.ymy");
-        startup_file.set_name(EXE_directory.to_string().c_str());
+        const std::string startup_name = EXE_directory.to_string();
+        startup_file.set_name(startup_name.c_str());
 
         if (startup_file.next() != nullptr) {
             parameter_stack.push(EXE_directory);
@@ -91,7 +104,8 @@ static bool load_file(const char *name, long line_number, int column_number)
     bool return_value;
 
     if ((return_value = FileList::lookup(name)) == false) {
-        return_value = FileList::new_file(name);
+        return_value = PipeInput::is_pipe(name) ? PipeInput::open(name)
+                                                : FileList::new_file(name);
     }
 
     if (return_value == true) {
@@ -109,19 +123,22 @@ static bool process_yfile()
 {
     EditBuffer active_name;
 
-    // First, read the file into the descriptor array.
+    // First, read the file into the descriptor array. The text entered at the prompts in the
+    // last session is kept with it.
     read_yfile();
+    PromptHistory::read("history.yfh");
 
-    // Save filelist.yfy when doing external commands.
+    // Save filelist.yfy when doing external commands, and now and then in the background.
     yfile_flag = true;
+    start_checkpoints();
 
-    // Scan the descriptor list and load up the non deleted files.
-    List<FileDescriptor>::Iterator stepper(descriptor_list);
-    FileDescriptor *next;
-    while ((next = stepper()) != nullptr) {
+    // Scan the descriptor list and load up the non deleted files. Loading a file erases its
+    // descriptor but leaves the positions of the others unchanged.
+    for (std::size_t position = 0; position < descriptor_list.slots(); ++position) {
+        FileDescriptor *next = descriptor_list.slot(position);
 
         // Only process files that are not "deleted."
-        if (!next->is_deleted()) {
+        if (next != nullptr && !next->is_deleted()) {
 
             // Save the name of this file for later if this file is "active." This assumes that
             // there is one non-deleted active file.
@@ -132,13 +149,6 @@ static bool process_yfile()
             // Get the file.
             parameter_stack.push(next->get_name());
             find_file_command();
-
-            // The operation above removed a descriptor from the list. This contracted the list
-            // by one position. I now have to back up my iterator by one to catch all the files.
-            // This assumes that the list marking done by the List template is based on
-            // indicies.
-            //
-            descriptor_list.previous();
         }
     }
 
@@ -158,7 +168,7 @@ static bool process_command_line()
     std::string base_name;   // Contains the base part of a saved name.
     bool base_valid = false; // =true if base_name valid.
     bool first_file = true;  // =false if at least one file loaded.
-    YEditFile *leading_file; // Reference to the first file loaded.
+    YEditFile *leading_file = nullptr; // Reference to the first file loaded.
 
     // Default value for the initial position = no change.
     long line_number = -1;
@@ -172,8 +182,9 @@ static bool process_command_line()
         parameter_stack.pop(workspace);
         std::string parameter = workspace.to_string();
 
-        // If we're looking at a switch (accept either '-' or '/')...
-        if (parameter[0U] == '-' || parameter[0U] == '/') {
+        // If we're looking at a switch (accept either '-' or '/')... A lone '-' is standard
+        // input.
+        if ((parameter[0U] == '-' && parameter != "-") || parameter[0U] == '/') {
             switch (parameter[1U]) {
 
             // Set the initial line number. Note that the user's line number is 1-based.
@@ -196,6 +207,18 @@ static bool process_command_line()
                 restricted_mode = true;
                 break;
 
+            // Repeated lines of the files named after this share their text.
+            case 'i':
+            case 'I':
+                DiskEditFile::set_interning(true);
+                break;
+
+            // The undo histories of the files named after this are kept when they are saved.
+            case 'u':
+            case 'U':
+                DiskEditFile::set_keeping_history(true);
+                break;
+
             // Print message and wait for acknowledgment.
             default:
                 warning_message("Unrecognized switch (%c) ignored", workspace[1U]);
@@ -206,9 +229,6 @@ static bool process_command_line()
 
         // Otherwise it was no switch, it must be a file name (or wildcard spec).
         else {
-            FileNameMatcher wild_match;
-            char *file_name;
-
             // If the current argument is an abbreviation, try expanding it. BUG: The filename
             // ..\foo.c will confuse this code. It will incorrectly think it is an abreviation.
             //
@@ -233,10 +253,12 @@ static bool process_command_line()
 
             // strupr( workspace );
             std::string workspace_string = workspace.to_string();
-            wild_match.set_name(workspace_string.c_str());
+            // The spec is expanded all at once, which is much faster for many matches.
+            const std::vector<std::string> file_names =
+                FileNameMatcher::expand(workspace_string.c_str());
 
             // If no files match the spec, assume the spec is the name of a new file.
-            if ((file_name = wild_match.next()) == nullptr) {
+            if (file_names.empty()) {
 
                 // Tell the user if they tried a wildcard and there were no matches. DON'T take
                 // the failed wildcard string as a filename!
@@ -262,25 +284,70 @@ static bool process_command_line()
             else {
 
                 // Loop over all names that match the wildcard spec and load them.
-                while (file_name != nullptr) {
+                for (const std::string &file_name : file_names) {
 
-                    load_file(file_name, line_number, column_number);
+                    load_file(file_name.c_str(), line_number, column_number);
 
                     // Remember the first file so we can show that to the user when we're done.
                     if (first_file) {
                         first_file = false;
                         leading_file = &FileList::active_file();
                     }
-                    file_name = wild_match.next();
                 }
             }
         } // End of if...else... that determines if we are looking at a switch.
     } // End of loop that passes over all command line arguments.
 
-    FileList::lookup(leading_file->name());
+    if (leading_file != nullptr)
+        FileList::lookup(leading_file->name());
     return true;
 }
 
+//! Opens the files named by the command line of a later invocation (see Server).
+/*!
+ * The command line is refused while the parameter stack is in use, by a macro or a prompt,
+ * since it is processed from there.
+ */
+static bool open_handed_over(std::vector<std::string> &arguments)
+{
+    if (parameter_stack.size() != 0)
+        return false;
+    for (auto argument = arguments.rbegin(); argument != arguments.rend(); ++argument)
+        parameter_stack.push(argument->c_str());
+    DiskEditFile::set_background_loading(true);
+    process_command_line();
+    DiskEditFile::set_background_loading(false);
+    WindowList::display();
+    return true;
+}
+
+//! Returns true if "-", meaning standard input, is among the arguments.
+static bool names_standard_input(const int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-") == 0)
+            return true;
+    }
+    return false;
+}
+
+static const char *trace_name = nullptr; // The file named by YEXA_TRACE, if it is set.
+
+//! Writes the trace of the session when the editor exits, unless it was stopped before.
+static void write_trace()
+{
+    if (Trace::active())
+        Trace::stop(trace_name);
+}
+
+//! Returns the positive number in the named environment variable, or fallback if there is none.
+static int size_setting(const char *name, int fallback)
+{
+    const char *const setting = std::getenv(name);
+    const int size = (setting != nullptr) ? std::atoi(setting) : 0;
+    return (size > 0) ? size : fallback;
+}
+
 /*!
  * Initialize the editor by searching for and executing a startup macro, processing the command
  * line, etc. It is called before any normal, interactive editing else is done. Be aware that
@@ -302,14 +369,23 @@ static bool initialize()
 
     // For now, just send execute_startup_macro( ) a null path.
     execute_startup_macro(executable_path);
+    Startup::finished("startup macro");
 
     // If there is nothing on the stack, try to process a .yfy file; otherwise the command line.
+    // The files are read in the background so that the active file can be shown at once.
+    DiskEditFile::set_background_loading(true);
     if (parameter_stack.size() == 0) {
         process_yfile();
     }
     else {
         process_command_line();
     }
+    DiskEditFile::set_background_loading(false);
+    Startup::finished("files");
+
+    // Bring back the work lost when an editor crashed.
+    FileList::recover_files();
+    Startup::finished("recovery");
 
     // Make sure the editor has at least one file loaded.
     if (FileList::count() == 0) {
@@ -330,9 +406,45 @@ static bool initialize()
  */
 int main(int argc, char *argv[])
 {
+    // The whole session, startup included, may be traced (see Trace).
+    if ((trace_name = std::getenv("YEXA_TRACE")) != nullptr) {
+        Trace::start();
+        std::atexit(write_trace);
+    }
+    Startup::begin();
+
+    // A script of keystrokes may be replayed on a headless screen, or the session recorded as
+    // one. The screen has the size given by LINES and COLUMNS, if they are set.
+    const char *const script = std::getenv("YEXA_REPLAY");
+    const char *const recording = std::getenv("YEXA_RECORD");
+    if (script != nullptr) {
+        if (!Replay::start(script, std::getenv("YEXA_REPLAY_LOG"), size_setting("LINES", 24),
+                           size_setting("COLUMNS", 80)))
+            return 1;
+        KeyHandler::replay();
+    }
+    else if (recording != nullptr && !Replay::record(recording)) {
+        std::fprintf(stderr, "Can't record keystrokes in %s\n", recording);
+        return 1;
+    }
+
+    // An editor already running in this directory may open the files instead (see Server).
+    // It can't read this editor's standard input.
+    else if (recording == nullptr && !names_standard_input(argc, argv) &&
+             Server::hand_over(argc, argv)) {
+        return 0;
+    }
+
+    // Standard input named on the command line is read as a file, so keystrokes must come
+    // from the terminal instead.
+    if (names_standard_input(argc, argv))
+        PipeInput::claim_standard_input();
+    Startup::finished("hand over");
+
     // Perform program-wide (cross file) initializations.
     global_setup();
     std::atexit(global_cleanup);
+    Startup::finished("screen");
 
     EditBuffer word;
 
@@ -342,6 +454,9 @@ int main(int argc, char *argv[])
     }
 
     if (initialize()) {
+        if (script == nullptr && recording == nullptr)
+            Server::listen(open_handed_over);
+        Startup::finished("listen");
         while (1) {
             get_word(word);
             if (word.length() != 0)
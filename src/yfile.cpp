@@ -5,29 +5,192 @@
  * This file contains the implementation of class File_Descriptor. Objects of this class
  * "describe" files in the manner used by filelist.yfy. This module also contains filelist.yfy
  * handling code.
+ *
+ * Whenever filelist.yfy is written a binary snapshot of the same descriptors is written to
+ * filelist.yfb. The snapshot records the size and modification time of the filelist.yfy it
+ * accompanies. It is used in preference to the text only if it is intact (its version and
+ * checksum agree) and filelist.yfy has not been changed since.
  */
 
+#include <cctype>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include <screen/environ.hpp>
 #include <screen/screen.hpp>
 
+#if eOPSYS == ePOSIX
+#include <sys/stat.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include "EventLoop.hpp"
 #include "FileList.hpp"
+#include "PromptHistory.hpp"
+#include "TaskPool.hpp"
+#include "Trace.hpp"
 #include "support.hpp"
 #include "yfile.hpp"
 
 namespace {
 
+    //! The descriptors of a session, in the order they are written.
+    typedef std::vector<FileDescriptor> Session;
+
     //! These are the keywords that appear in filelist.yfy.
     const char *key_words[] = {
         "ACTIVE",  "BLOCK",  "BLOCK_LINE", "COLOR",       "CURSOR_COLUMN", "CURSOR_LINE",
         "DELETED", "INSERT", "NAME",       "TAB_SETTING", "WINDOW_COLUMN", "WINDOW_LINE",
         nullptr};
 
+    // The binary snapshot starts with these bytes followed by the format version.
+    const char snapshot_magic[4] = {'Y', 'F', 'Y', 'B'};
+    constexpr std::uint32_t snapshot_version = 1;
+
+    // Size of the snapshot header: magic, version, count, text size, text time, checksum.
+    constexpr std::size_t snapshot_header_size = 4 + 4 + 4 + 8 + 8 + 8;
+
+    //! Appends the low size bytes of value to output, least significant byte first.
+    void put(std::string &output, const std::uint64_t value, const int size)
+    {
+        for (int i = 0; i < size; ++i) {
+            output.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    //! Reads a size byte value written by put. Returns false if there are too few bytes.
+    bool get(const unsigned char *&input, const unsigned char *const end, std::uint64_t &value,
+             const int size)
+    {
+        if (end - input < size)
+            return false;
+        value = 0;
+        for (int i = 0; i < size; ++i) {
+            value |= static_cast<std::uint64_t>(input[i]) << (8 * i);
+        }
+        input += size;
+        return true;
+    }
+
+    //! Finds the size and modification time of filelist.yfy. Returns false if it doesn't exist.
+    bool text_stamp(std::uint64_t &size, std::uint64_t &time)
+    {
+#if eOPSYS == ePOSIX
+        struct stat file_information;
+        if (stat("filelist.yfy", &file_information) != 0)
+            return false;
+#else
+        struct _stat file_information;
+        if (_stat("filelist.yfy", &file_information) != 0)
+            return false;
+#endif
+        size = static_cast<std::uint64_t>(file_information.st_size);
+        time = static_cast<std::uint64_t>(file_information.st_mtime);
+        return true;
+    }
+
+    //! Replaces the named file with contents, writing them under a temporary name first.
+    /*!
+     * \return false if the file can't be written. The file is then left as it was.
+     */
+    bool write_replacing(const char *const name, const std::string &contents)
+    {
+        const std::string temporary_name = std::string(name) + ".tmp";
+        std::FILE *output;
+        if ((output = std::fopen(temporary_name.c_str(), "wb")) == nullptr)
+            return false;
+        const bool written =
+            std::fwrite(contents.data(), 1, contents.size(), output) == contents.size();
+        if (std::fclose(output) != 0 || !written) {
+            std::remove(temporary_name.c_str());
+            return false;
+        }
+        if (!replace_file(temporary_name.c_str(), name)) {
+            std::remove(temporary_name.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // The session is checkpointed this often (in milliseconds), and this soon after the files
+    // in it change.
+    const long checkpoint_interval = 15L * 1000L;
+    const long change_delay = 1000L;
+
+    bool checkpoints_started = false; // =true once start_checkpoints has been called.
+    bool checkpoint_running = false;  // =true while a checkpoint is written in the background.
+    bool checkpoint_wanted = false;   // =true if another checkpoint is wanted after that one.
+    unsigned change_timer = 0;        // The timer set by note_session_change, if it is set.
+    std::uint64_t captured_generation = 0; // The number of the session last captured.
+
+    //! What is known about the session last written. Used by the thread writing it.
+    struct Committed {
+        std::mutex lock;              //!< Held while the session is written.
+        std::uint64_t generation = 0; //!< The number of the session last written.
+        std::string snapshot;         //!< Its descriptors, as encoded in filelist.yfb.
+    };
+
+    // This is never destroyed so that a checkpoint still being written at exit can finish.
+    Committed &committed = *new Committed;
+
 } // namespace
 
-List<FileDescriptor> descriptor_list;
+DescriptorList descriptor_list;
+
+/*===================================*/
+/*           DescriptorList          */
+/*===================================*/
+
+//! Adds a descriptor to the end of the list, replacing any descriptor with the same name.
+void DescriptorList::insert(const FileDescriptor &new_descriptor)
+{
+    const std::string key = name_key(new_descriptor.name.to_string().c_str());
+    const auto existing = index.find(key);
+    if (existing != index.end())
+        present[existing->second] = false;
+
+    entries.push_back(new_descriptor);
+    present.push_back(true);
+    index[key] = entries.size() - 1;
+}
+
+//! Returns the descriptor for the named file or nullptr if there is none.
+FileDescriptor *DescriptorList::find(const char *const name)
+{
+    const auto existing = index.find(name_key(name));
+    return existing == index.end() ? nullptr : &entries[existing->second];
+}
+
+//! Removes the descriptor for the named file, if any.
+void DescriptorList::erase(const char *const name)
+{
+    const auto existing = index.find(name_key(name));
+    if (existing != index.end()) {
+        present[existing->second] = false;
+        index.erase(existing);
+    }
+}
+
+//! Removes all descriptors.
+void DescriptorList::clear()
+{
+    entries.clear();
+    present.clear();
+    index.clear();
+}
+
+/*===================================*/
+/*           FileDescriptor          */
+/*===================================*/
 
 //! Constructor sets defaults for a file loaded into the editor for the first time.
 FileDescriptor::FileDescriptor(const EditBuffer &the_name) : name(the_name)
@@ -92,9 +255,133 @@ static int get_keyword(char *line, char **rest)
     return static_cast<int>(search - key_words);
 }
 
-//! Reads filelist.yfy and creates a list of FileDescriptor objects.
+//! Appends the binary form of a descriptor to a snapshot.
+void encode_descriptor(std::string &output, const FileDescriptor &the_descriptor)
+{
+    const std::string name = the_descriptor.name.to_string();
+    const unsigned flags = (the_descriptor.active_flag ? 1U : 0U) |
+                           (the_descriptor.block_flag ? 2U : 0U) |
+                           (the_descriptor.deleted_flag ? 4U : 0U) |
+                           (the_descriptor.insert_flag ? 8U : 0U);
+    put(output, flags, 1);
+    put(output, static_cast<std::uint64_t>(the_descriptor.block_line), 8);
+    put(output, static_cast<std::uint32_t>(the_descriptor.color_attribute), 4);
+    put(output, the_descriptor.cursor_column, 4);
+    put(output, static_cast<std::uint64_t>(the_descriptor.cursor_line), 8);
+    put(output, static_cast<std::uint32_t>(the_descriptor.tab_setting), 4);
+    put(output, the_descriptor.window_column, 4);
+    put(output, static_cast<std::uint64_t>(the_descriptor.window_line), 8);
+    put(output, name.size(), 4);
+    output.append(name);
+}
+
+//! Reads a descriptor written by encode_descriptor. Returns false if the data is malformed.
+bool decode_descriptor(const unsigned char *&input, const unsigned char *const end,
+                       FileDescriptor &the_descriptor)
+{
+    std::uint64_t flags, block_line, color, cursor_column, cursor_line;
+    std::uint64_t tab_setting, window_column, window_line, name_length;
+    if (!get(input, end, flags, 1) || !get(input, end, block_line, 8) ||
+        !get(input, end, color, 4) || !get(input, end, cursor_column, 4) ||
+        !get(input, end, cursor_line, 8) || !get(input, end, tab_setting, 4) ||
+        !get(input, end, window_column, 4) || !get(input, end, window_line, 8) ||
+        !get(input, end, name_length, 4) ||
+        static_cast<std::uint64_t>(end - input) < name_length)
+        return false;
+
+    the_descriptor.active_flag = (flags & 1U) != 0;
+    the_descriptor.block_flag = (flags & 2U) != 0;
+    the_descriptor.deleted_flag = (flags & 4U) != 0;
+    the_descriptor.insert_flag = (flags & 8U) != 0;
+    the_descriptor.block_line = static_cast<long>(static_cast<std::int64_t>(block_line));
+    the_descriptor.color_attribute = static_cast<int>(static_cast<std::int32_t>(color));
+    the_descriptor.cursor_column = static_cast<unsigned>(cursor_column);
+    the_descriptor.cursor_line = static_cast<long>(static_cast<std::int64_t>(cursor_line));
+    the_descriptor.tab_setting = static_cast<int>(static_cast<std::int32_t>(tab_setting));
+    the_descriptor.window_column = static_cast<unsigned>(window_column);
+    the_descriptor.window_line = static_cast<long>(static_cast<std::int64_t>(window_line));
+    the_descriptor.name =
+        EditBuffer(std::string(reinterpret_cast<const char *>(input), name_length).c_str());
+    input += name_length;
+    return true;
+}
+
+//! Reads filelist.yfb. Returns false, leaving the list empty, if the snapshot can't be used.
+static bool read_snapshot()
+{
+    std::uint64_t text_size, text_time;
+    if (!text_stamp(text_size, text_time))
+        return false;
+
+    std::FILE *snapshot;
+    if ((snapshot = std::fopen("filelist.yfb", "rb")) == nullptr)
+        return false;
+    std::string contents;
+    char block[4096];
+    std::size_t count;
+    while ((count = std::fread(block, 1, sizeof(block), snapshot)) > 0)
+        contents.append(block, count);
+    std::fclose(snapshot);
+
+    // Check the header.
+    const unsigned char *input = reinterpret_cast<const unsigned char *>(contents.data());
+    const unsigned char *const end = input + contents.size();
+    std::uint64_t version, descriptor_count, size, time, sum;
+    if (contents.size() < snapshot_header_size ||
+        std::memcmp(input, snapshot_magic, sizeof(snapshot_magic)) != 0)
+        return false;
+    input += sizeof(snapshot_magic);
+    get(input, end, version, 4);
+    get(input, end, descriptor_count, 4);
+    get(input, end, size, 8);
+    get(input, end, time, 8);
+    get(input, end, sum, 8);
+    if (version != snapshot_version || size != text_size || time != text_time ||
+        sum != fnv1a(std::string_view(reinterpret_cast<const char *>(input),
+                                      static_cast<std::size_t>(end - input))))
+        return false;
+
+    // Decode the descriptors.
+    for (std::uint64_t i = 0; i < descriptor_count; ++i) {
+        FileDescriptor new_descriptor(EditBuffer(""));
+        if (!decode_descriptor(input, end, new_descriptor)) {
+            descriptor_list.clear();
+            return false;
+        }
+        new_descriptor.sanity_check();
+        descriptor_list.insert(new_descriptor);
+    }
+    return true;
+}
+
+//! Writes filelist.yfb to match the filelist.yfy just written.
+static void write_snapshot(const std::string &descriptors, const std::uint64_t descriptor_count)
+{
+    std::uint64_t text_size, text_time;
+    if (!text_stamp(text_size, text_time))
+        return;
+
+    std::string contents(snapshot_magic, sizeof(snapshot_magic));
+    put(contents, snapshot_version, 4);
+    put(contents, descriptor_count, 4);
+    put(contents, text_size, 8);
+    put(contents, text_time, 8);
+    put(contents, fnv1a(descriptors), 8);
+    contents.append(descriptors);
+
+    // A damaged snapshot is harmless (it is ignored) so no message is printed on failure.
+    write_replacing("filelist.yfb", contents);
+}
+
+/*!
+ * Reads descriptors from filelist.yfb if it is usable. Otherwise reads filelist.yfy and creates
+ * a list of FileDescriptor objects.
+ */
 void read_yfile()
 {
+    if (read_snapshot())
+        return;
+
     const int linebuf_size = 256;
     char line[linebuf_size + 2];
     // Used for reading lines out of filelist.yfy. Note the static limit.
@@ -241,65 +528,146 @@ void read_yfile()
     // Add a sanity check to verify that there is one non-deleted active file.
 }
 
-//! Writes a single descriptor into filelist.yfy.
-void write_descriptor(std::FILE *output, const FileDescriptor &the_descriptor)
+//! Appends the text of a single descriptor, as written in filelist.yfy, to output.
+void write_descriptor(std::string &output, const FileDescriptor &the_descriptor)
 {
-    std::fprintf(output, "\n");
-    std::fprintf(output, "NAME=%s\n", the_descriptor.name.to_string().c_str());
-    std::fprintf(output, "ACTIVE=%s\n",
-                 (the_descriptor.active_flag == true) ? "true" : "false");
-    std::fprintf(output, "BLOCK=%s\n", (the_descriptor.block_flag == true) ? "true" : "false");
-    std::fprintf(output, "BLOCK_LINE=%ld\n", the_descriptor.block_line);
-    std::fprintf(output, "COLOR=%d\n", the_descriptor.color_attribute);
-    std::fprintf(output, "CURSOR_COLUMN=%u\n", the_descriptor.cursor_column);
-    std::fprintf(output, "CURSOR_LINE=%ld\n", the_descriptor.cursor_line);
-    std::fprintf(output, "DELETED=%s\n",
-                 (the_descriptor.deleted_flag == true) ? "true" : "false");
-    std::fprintf(output, "INSERT=%s\n",
-                 (the_descriptor.insert_flag == true) ? "true" : "false");
-    std::fprintf(output, "TAB_SETTING=%d\n", the_descriptor.tab_setting);
-    std::fprintf(output, "WINDOW_COLUMN=%u\n", the_descriptor.window_column);
-    std::fprintf(output, "WINDOW_LINE=%ld\n", the_descriptor.window_line);
+    char line[64];
+    output.append("\nNAME=").append(the_descriptor.name.to_string()).append("\n");
+    output.append("ACTIVE=").append(the_descriptor.active_flag ? "true\n" : "false\n");
+    output.append("BLOCK=").append(the_descriptor.block_flag ? "true\n" : "false\n");
+    std::snprintf(line, sizeof(line), "BLOCK_LINE=%ld\n", the_descriptor.block_line);
+    output.append(line);
+    std::snprintf(line, sizeof(line), "COLOR=%d\n", the_descriptor.color_attribute);
+    output.append(line);
+    std::snprintf(line, sizeof(line), "CURSOR_COLUMN=%u\n", the_descriptor.cursor_column);
+    output.append(line);
+    std::snprintf(line, sizeof(line), "CURSOR_LINE=%ld\n", the_descriptor.cursor_line);
+    output.append(line);
+    output.append("DELETED=").append(the_descriptor.deleted_flag ? "true\n" : "false\n");
+    output.append("INSERT=").append(the_descriptor.insert_flag ? "true\n" : "false\n");
+    std::snprintf(line, sizeof(line), "TAB_SETTING=%d\n", the_descriptor.tab_setting);
+    output.append(line);
+    std::snprintf(line, sizeof(line), "WINDOW_COLUMN=%u\n", the_descriptor.window_column);
+    output.append(line);
+    std::snprintf(line, sizeof(line), "WINDOW_LINE=%ld\n", the_descriptor.window_line);
+    output.append(line);
 }
 
-//! Writes filelist.yfy from the list of File_Descriptor objects.
-void write_yfile()
+//! Returns the descriptors of the session.
+/*!
+ * The files loaded come first, starting with the active one, and then the files described by
+ * the descriptor list.
+ */
+static Session capture_session()
 {
-    List<FileDescriptor>::Iterator stepper(descriptor_list);
-    FileDescriptor *next;
+    Session session;
+    const YEditFile *const active = &FileList::active_file();
+    const unsigned count = FileList::count();
+    unsigned first = 0;
+    while (first < count && FileList::file(first) != active)
+        ++first;
+    for (unsigned i = 0; i < count; ++i) {
+        YEditFile *const current = FileList::file((first + i) % count);
+        session.push_back(FileDescriptor(current->name()));
+        current->set_descriptor(session.back());
+        if (current != active)
+            session.back().make_inactive();
+    }
+    for (std::size_t position = 0; position < descriptor_list.slots(); ++position) {
+        if (const FileDescriptor *const next = descriptor_list.slot(position))
+            session.push_back(*next);
+    }
+    return session;
+}
 
-    // Try to open filelist.yfy
-    std::FILE *yfile;
-    if ((yfile = std::fopen("filelist.yfy", "w")) == nullptr) {
-        warning_message("Can't open filelist.yfy!");
-        return;
+//! Writes filelist.yfy and filelist.yfb from a session captured by capture_session.
+/*!
+ * This may be called on any thread. Sessions are numbered in the order they were captured; one
+ * older than the session last written is not written, nor is one that describes the files in
+ * just the same way. Each file is written under a temporary name and then renamed, so that
+ * they are never left half written.
+ *
+ * \return false if filelist.yfy can't be written.
+ */
+static bool commit_session(const Session &session, const std::uint64_t generation)
+{
+    std::string text;
+    std::string snapshot;
+    text.append("Y Version 1.90\n");
+    text.append("#\n# This file was created by Y itself.\n"
+                "# Consult the Y documentation before editing.\n#\n");
+    for (const FileDescriptor &descriptor : session) {
+        write_descriptor(text, descriptor);
+        encode_descriptor(snapshot, descriptor);
     }
 
-    // Print the preamble into the file.
-    std::fprintf(yfile, "Y Version %d.%d\n", 1, 90);
-    std::fprintf(yfile, "#\n# This file was created by Y itself.\n"
-                        "# Consult the Y documentation before editing.\n#\n");
+    std::lock_guard<std::mutex> guard(committed.lock);
+    if (generation <= committed.generation)
+        return true;
+    if (snapshot != committed.snapshot) {
+        if (!write_replacing("filelist.yfy", text))
+            return false;
+        write_snapshot(snapshot, session.size());
+        committed.snapshot.swap(snapshot);
+    }
+    committed.generation = generation;
+    return true;
+}
 
-    // First step over the file list and write out those descriptors as well. This code assumes
-    // that there is at least one file in the file list.
-    //
-    YEditFile *start_file = &FileList::active_file();
-    YEditFile *current = start_file;
-    do {
-        next = new FileDescriptor(current->name());
-        current->set_descriptor(*next);
-        if (current != start_file)
-            next->make_inactive();
-        write_descriptor(yfile, *next);
-        delete next;
-        FileList::next();
-        current = &FileList::active_file();
-    } while (current != start_file);
-
-    // Now step down the list of file descriptors.
-    while ((next = stepper()) != nullptr) {
-        write_descriptor(yfile, *next);
+//! Writes the session in the background, unless a write is already under way.
+/*!
+ * A checkpoint asked for meanwhile is taken once that write has finished.
+ */
+static void checkpoint_session()
+{
+    if (checkpoint_running) {
+        checkpoint_wanted = true;
+        return;
     }
+    checkpoint_running = true;
+    checkpoint_wanted = false;
+    auto session = std::make_shared<const Session>(capture_session());
+    const std::uint64_t generation = ++captured_generation;
+    TaskPool::submit(
+        [session, generation]() {
+            Trace::Span span("write session");
+            commit_session(*session, generation);
+        },
+        []() {
+            checkpoint_running = false;
+            if (checkpoint_wanted)
+                checkpoint_session();
+        },
+        TaskPool::CancelToken());
+}
 
-    std::fclose(yfile);
+void start_checkpoints()
+{
+    if (checkpoints_started)
+        return;
+    checkpoints_started = true;
+    EventLoop::add_timer(checkpoint_interval, checkpoint_session, true);
+}
+
+void note_session_change()
+{
+    if (!checkpoints_started || change_timer != 0)
+        return;
+    change_timer = EventLoop::add_timer(change_delay, []() {
+        change_timer = 0;
+        checkpoint_session();
+    });
+}
+
+//! Writes filelist.yfy and filelist.yfb from the list of File_Descriptor objects.
+/*!
+ * The files are written at once, waiting for a checkpoint being written in the background.
+ */
+void write_yfile()
+{
+    if (!commit_session(capture_session(), ++captured_generation))
+        warning_message("Can't write filelist.yfy!");
+
+    // The text entered at the prompts is kept with the descriptors.
+    PromptHistory::write("history.yfh");
 }